@@ -1,12 +1,20 @@
-// Magic3D.cpp : ̨Ӧóڵ㡣
+// Magic3D.cpp : 定义控制台应用程序的入口点。
 //
 
 #include "stdafx.h"
 #include "../Src/Common/MagicFramework.h"
+#include "../Src/Application/DumpReplayRunner.h"
 #pragma comment( linker,"/subsystem:\"windows\" /entry:\"mainCRTStartup\"" ) //hide cmd windows
 
 int _tmain(int argc, _TCHAR* argv[])
 {
+#if DEBUGDUMPFILE
+    // Headless dump replay for performance regression tests
+    if (MagicApp::DumpReplayRunner::IsReplayCommand(argc, argv))
+    {
+        return MagicApp::DumpReplayRunner::RunCommand(argc, argv);
+    }
+#endif
     MagicCore::MagicFramework magicFrame;
     magicFrame.Init();
     magicFrame.Run();
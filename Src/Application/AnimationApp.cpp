@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include <process.h>
+#include <algorithm>
 #include "AnimationApp.h"
 #include "AnimationAppUI.h"
 #include "AppManager.h"
@@ -9,17 +10,32 @@
 #include "../Common/ViewTool.h"
 #include "../Common/PickTool.h"
 #include "../Common/RenderSystem.h"
+#include "DeformSession.h"
+#include "DeformProxy.h"
 #include "GPP.h"
 
 namespace MagicApp
 {
+    // Meshes bigger than this are dragged through a simplified proxy
+    static const int gDeformProxyVertexThreshold = 200000;
+    static const int gDeformProxyVertexCount = 50000;
+    // A committed handle further than this from its target is reported
+    static const double gDeformTargetTolerance = 1.0e-3;
+
     AnimationApp::AnimationApp() :
         mpUI(NULL),
         mpViewTool(NULL),
         mDeformType(DT_NONE),
         mDeformPointList(NULL),
         mDeformMesh(NULL),
+        mpDeformSession(NULL),
+        mpDeformProxy(NULL),
+        mProxyDeformMesh(NULL),
+        mIsFullDeformationInitialised(false),
+        mProxyHandleIds(),
+        mProxyHandleCoords(),
         mControlIds(),
+        mControlCoords(),
         mIsDeformationInitialised(false),
         mPickControlId(-1),
         mPickTargetCoord(),
@@ -37,8 +53,11 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpDeformSession);
         GPPFREEPOINTER(mDeformPointList);
         GPPFREEPOINTER(mDeformMesh);
+        GPPFREEPOINTER(mProxyDeformMesh);
+        GPPFREEPOINTER(mpDeformProxy);
     }
 
     void AnimationApp::ClearData()
@@ -47,10 +66,12 @@ namespace MagicApp
         GPPFREEPOINTER(mpViewTool);
         ClearMeshData();
         ClearPointCloudData();
+        GPPFREEPOINTER(mpDeformSession);
         mRightMouseType = DEFORM;
         GPPFREEPOINTER(mDeformPointList);
         GPPFREEPOINTER(mDeformMesh);
         std::vector<GPP::Int>().swap(mControlIds);
+        std::vector<GPP::Vector3>().swap(mControlCoords);
         std::vector<int>().swap(mControlFlags);
         std::vector<GPP::Vector3>().swap(mTargetControlCoords);
         std::vector<int>().swap(mTargetControlIds);
@@ -58,17 +79,20 @@ namespace MagicApp
 
     void AnimationApp::ClearPointCloudData()
     {
+        ResetDeformSession();
         mIsDeformationInitialised = false;
         mPickControlId = -1;
         mTargetControlCoords.clear();
         mTargetControlIds.clear();
         mTargetControlCoords.clear();
         mControlIds.clear();
+        mControlCoords.clear();
         GPPFREEPOINTER(mDeformPointList);
     }
     
     void AnimationApp::ClearMeshData()
     {
+        ResetDeformSession();
         mIsDeformationInitialised = false;
         mDeformType = DT_NONE;
         mPickControlId = -1;
@@ -76,7 +100,13 @@ namespace MagicApp
         mTargetControlIds.clear();
         mTargetControlCoords.clear();
         mControlIds.clear();
+        mControlCoords.clear();
         GPPFREEPOINTER(mDeformMesh);
+        GPPFREEPOINTER(mProxyDeformMesh);
+        GPPFREEPOINTER(mpDeformProxy);
+        mIsFullDeformationInitialised = false;
+        mProxyHandleIds.clear();
+        mProxyHandleCoords.clear();
     }
 
     bool AnimationApp::Enter()
@@ -94,6 +124,31 @@ namespace MagicApp
 
     bool AnimationApp::Update(double timeElapsed)
     {
+        if (mpDeformSession)
+        {
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            if (mpDeformSession->FetchResult(&res))
+            {
+                if (res != GPP_NO_ERROR)
+                {
+                    MessageBox(NULL, "三维模型变形失败", "温馨提示", MB_OK);
+                    mPickControlId = -1;
+                }
+                else
+                {
+                    // Solver stays idle until Continue, the model can be read here
+                    if (ModelManager::Get()->GetMesh())
+                    {
+                        ModelManager::Get()->IncreaseMeshGeneration(ModelManager::Get()->GetMesh());
+                    }
+                    UpdateControlCoords();
+                    UpdateModelRendering();
+                    UpdateControlRendering();
+                }
+            }
+            // Only the latest drag target is solved after the result is shown
+            mpDeformSession->Continue();
+        }
         return true;
     }
 
@@ -112,7 +167,6 @@ namespace MagicApp
     void AnimationApp::PickControlPoint(int mouseCoordX, int mouseCoordY)
     {
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
 
         GPP::Vector2 mouseCoord(mouseCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
                     1.0 - mouseCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
@@ -120,6 +174,13 @@ namespace MagicApp
         {
             return;
         }
+        if (mpDeformSession && mpDeformSession->IsBusy())
+        {
+            // Model is being deformed by the previous drag
+            mPickControlId = -1;
+            return;
+        }
+        UpdateControlCoords();
         double pointSizeSquared = 0.01 * 0.01;
         Ogre::Matrix4 worldM = MagicCore::RenderSystem::Get()->GetSceneManager()->getSceneNode("ModelNode")->_getFullTransform();
         Ogre::Matrix4 viewM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getViewMatrix();
@@ -134,15 +195,7 @@ namespace MagicApp
             {
                 continue;
             }
-            GPP::Vector3 coord;
-            if (triMesh)
-            {
-                coord = triMesh->GetVertexCoord(mControlIds.at(pid));
-            }
-            else
-            {
-                coord = pointCloud->GetPointCoord(mControlIds.at(pid));
-            }
+            GPP::Vector3 coord = mControlCoords.at(pid);
             Ogre::Vector3 ogreCoord(coord[0], coord[1], coord[2]);
             ogreCoord = wvpM * ogreCoord;
             GPP::Vector2 screenCoord(ogreCoord.x, ogreCoord.y);
@@ -176,13 +229,19 @@ namespace MagicApp
                 }
             }
             MagicCore::RenderSystem::Get()->RenderLineSegments("Test", "Simple_Line", startCoords, endCoords);*/
-            if (triMesh)
-            {
-                mPickTargetCoord = triMesh->GetVertexCoord(mControlIds.at(mPickControlId));
-            }
-            else
+            mPickTargetCoord = mControlCoords.at(mPickControlId);
+            if (mRightMouseType == DEFORM && mpDeformSession)
             {
-                mPickTargetCoord = pointCloud->GetPointCoord(mControlIds.at(mPickControlId));
+                // Control set can not change during a drag
+                if (mpDeformProxy && mpDeformProxy->IsBuilt(triMesh))
+                {
+                    mpDeformSession->Setup(mProxyDeformMesh, NULL, triMesh, mpDeformProxy);
+                }
+                else
+                {
+                    mpDeformSession->Setup(mDeformMesh, mDeformPointList, triMesh);
+                }
+                mpDeformSession->SetControlFlags(mControlFlags);
             }
         }
     }
@@ -236,7 +295,7 @@ namespace MagicApp
 
     void AnimationApp::UpdateDeformation(int mouseCoordX, int mouseCoordY, bool isAccurate)
     {
-        if (mPickControlId == -1 || mControlFlags.at(mPickControlId) != 2)
+        if (mPickControlId == -1 || mControlFlags.at(mPickControlId) != 2 || mpDeformSession == NULL)
         {
             return;
         }
@@ -255,55 +314,62 @@ namespace MagicApp
         mPickTargetCoord = GPP::Vector3(targetCoord[0], targetCoord[1], targetCoord[2]);
         std::vector<GPP::Vector3> targetCoords;
         targetCoords.push_back(mPickTargetCoord);  
-        GPP::ErrorCode res = GPP_NO_ERROR;
+        std::vector<GPP::Int> targetIds;
         if (mDeformPointList)
         {
-            std::vector<int> controlIndex;
-            controlIndex.push_back(mPickControlId);
-            std::vector<bool> controlFixFlags;
-            controlFixFlags.reserve(mControlFlags.size());
-            for (std::vector<int>::iterator itr = mControlFlags.begin(); itr != mControlFlags.end(); ++itr)
+            targetIds.push_back(mPickControlId);
+        }
+        else if (mpDeformProxy && mpDeformProxy->IsBuilt(ModelManager::Get()->GetMesh()))
+        {
+            GPP::Int vertexId = mControlIds.at(mPickControlId);
+            targetIds.push_back(mpDeformProxy->MapVertex(vertexId));
+            targetCoords.at(0) = mpDeformProxy->MapTargetCoord(vertexId, mPickTargetCoord);
+            if (isAccurate)
             {
-                if (*itr == 1)
+                // The full resolution commit solves all handles at their targets, keep where this drag ends
+                std::vector<int>::iterator targetItr = std::find(mTargetControlIds.begin(), mTargetControlIds.end(), mPickControlId);
+                if (targetItr != mTargetControlIds.end())
                 {
-                    controlFixFlags.push_back(1);
-                }
-                else
-                {
-                    controlFixFlags.push_back(0);
+                    mTargetControlCoords.at(targetItr - mTargetControlIds.begin()) = mPickTargetCoord;
                 }
             }
-            res = mDeformPointList->Deform(controlIndex, targetCoords, controlFixFlags);
         }
         else if (mDeformMesh)
         {
-            std::vector<int> targetVertexIds;
-            targetVertexIds.push_back(mControlIds.at(mPickControlId));
-            if (isAccurate)
-            {
-                res = mDeformMesh->Deform(targetVertexIds, targetCoords, GPP::DEFORM_MESH_TYPE_ACCURATE);
-            }
-            else
-            {
-                res = mDeformMesh->Deform(targetVertexIds, targetCoords, GPP::DEFORM_MESH_TYPE_FAST);
-            }
-            ModelManager::Get()->GetMesh()->UpdateNormal();
+            targetIds.push_back(mControlIds.at(mPickControlId));
         }
-        if (res != GPP_NO_ERROR)
+        else
         {
-            MessageBox(NULL, "άģͱʧ", "ܰʾ", MB_OK);
-            mPickControlId = -1;
             return;
         }
-        UpdateModelRendering();
-        UpdateControlRendering();
+        // Solved on a pool thread, the result is rendered in Update
+        mpDeformSession->RequestDeform(targetIds, targetCoords, isAccurate);
     }
 
-    void AnimationApp::SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
+    void AnimationApp::ResetDeformSession()
     {
-        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        if (mpDeformSession)
+        {
+            mpDeformSession->Reset();
+        }
+    }
 
+    void AnimationApp::CollectVertexFixFlags(GPP::Int vertexCount, std::vector<bool>& vertexFixFlags) const
+    {
+        vertexFixFlags = std::vector<bool>(vertexCount, 0);
+        int controlSize = mControlFlags.size();
+        for (int cid = 0; cid < controlSize; cid++)
+        {
+            if (mControlFlags.at(cid) != 0)
+            {
+                vertexFixFlags.at(mControlIds.at(cid)) = 1;
+            }
+        }
+    }
+
+    void AnimationApp::SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
+    {
+        UpdateControlCoords();
         GPP::Vector2 pos0(startCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
                     1.0 - startCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
         GPP::Vector2 pos1(endCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
@@ -320,15 +386,7 @@ namespace MagicApp
         int controlFlag = mAddSelection ? 0 : 1;
         for (GPP::Int pid = 0; pid < pointCount; pid++)
         {
-            GPP::Vector3 coord;
-            if (triMesh)
-            {
-                coord = triMesh->GetVertexCoord(mControlIds.at(pid));
-            }
-            else
-            {
-                coord = pointCloud->GetPointCoord(mControlIds.at(pid));
-            }
+            GPP::Vector3 coord = mControlCoords.at(pid);
             Ogre::Vector3 ogreCoord(coord[0], coord[1], coord[2]);
             ogreCoord = wvpM * ogreCoord;
             if (ogreCoord.x > minX && ogreCoord.x < maxX && ogreCoord.y > minY && ogreCoord.y < maxY)
@@ -342,6 +400,30 @@ namespace MagicApp
         }
     }
 
+    void AnimationApp::UpdateControlCoords()
+    {
+        if (mpDeformSession && mpDeformSession->IsSolving())
+        {
+            // Keep the last snapshot, it is refreshed when the result is fetched
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        int controlCount = mControlIds.size();
+        mControlCoords.resize(controlCount);
+        for (int cid = 0; cid < controlCount; cid++)
+        {
+            if (triMesh)
+            {
+                mControlCoords.at(cid) = triMesh->GetVertexCoord(mControlIds.at(cid));
+            }
+            else if (pointCloud)
+            {
+                mControlCoords.at(cid) = pointCloud->GetPointCoord(mControlIds.at(cid));
+            }
+        }
+    }
+
     void AnimationApp::UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
     {
         Ogre::ManualObject* pMObj = NULL;
@@ -505,6 +587,7 @@ namespace MagicApp
 
     bool AnimationApp::ImportModel()
     {
+        ResetDeformSession();
         std::string fileName;
         char filterName[] = "OBJ Files(*.obj)\0*.obj\0STL Files(*.stl)\0*.stl\0OFF Files(*.off)\0*.off\0PLY Files(*.ply)\0*.ply\0ASC Files(*.asc)\0*.asc\0Geometry++ Point Cloud(*.gpc)\0*.gpc\0XYZ Files(*.xyz)\0*.xyz\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
@@ -522,7 +605,7 @@ namespace MagicApp
                 ModelManager::Get()->ClearPointCloud();
                 if (ModelManager::Get()->ImportMesh(fileName) == false)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                     return false;
                 }
                     
@@ -543,7 +626,7 @@ namespace MagicApp
                 ModelManager::Get()->ClearMesh();
                 if (ModelManager::Get()->ImportPointCloud(fileName) == false)
                 {
-                    MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                     return false;
                 }
 
@@ -583,13 +666,13 @@ namespace MagicApp
             mDeformType = DT_VERTEX;
             if (ModelManager::Get()->GetPointCloud() != NULL)
             {
-                MessageBox(NULL, "ֻ֧", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点变形只支持网格类型", "温馨提示", MB_OK);
                 mpUI->ShowVertexBar(false);
                 mDeformType = DT_NONE;
             }
             else if (ModelManager::Get()->GetMesh() == NULL)
             {
-                MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
                 mpUI->ShowVertexBar(false);
                 mDeformType = DT_NONE;
             }
@@ -618,7 +701,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
                 mpUI->ShowControlBar(false);
                 mDeformType = DT_NONE;
             }
@@ -632,9 +715,10 @@ namespace MagicApp
 
         if (pointCloud == NULL && triMesh == NULL)
         {
-            MessageBox(NULL, "ȵƻģ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入点云或者网格模型", "温馨提示", MB_OK);
             return;
         }
+        ResetDeformSession();
         GPP::ErrorCode res = GPP_NO_ERROR;
         if (pointCloud)
         {
@@ -666,69 +750,121 @@ namespace MagicApp
         }
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "γʼʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "变形初始化失败", "温馨提示", MB_OK);
             return;
         }
         mControlFlags = std::vector<int>(mControlIds.size(), 1);
+        UpdateControlCoords();
         UpdateControlRendering();
     }
 
     void AnimationApp::InitControlDeformation()
     {
+        ResetDeformSession();
         if (mDeformMesh)
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             int vertexCount = triMesh->GetVertexCount();
-            std::vector<bool> vertexFixFlags(vertexCount, 0);
+            GPPFREEPOINTER(mProxyDeformMesh);
+            GPPFREEPOINTER(mpDeformProxy);
+            mIsFullDeformationInitialised = false;
+            mProxyHandleIds.clear();
+            mProxyHandleCoords.clear();
+            if (vertexCount > gDeformProxyVertexThreshold)
+            {
+                // Drags are solved on the proxy, the full mesh is initialised lazily by DoControlDeformation
+                mpDeformProxy = new DeformProxy;
+                GPP::ErrorCode res = mpDeformProxy->Build(triMesh, gDeformProxyVertexCount);
+                if (res == GPP_NO_ERROR)
+                {
+                    std::vector<bool> vertexFixFlags;
+                    CollectVertexFixFlags(vertexCount, vertexFixFlags);
+                    std::vector<bool> proxyFixFlags;
+                    mpDeformProxy->MapFixFlags(vertexFixFlags, proxyFixFlags);
+                    mProxyDeformMesh = new GPP::DeformMesh;
+                    res = mProxyDeformMesh->Init(mpDeformProxy->GetProxyMesh(), proxyFixFlags);
+                }
+                if (res == GPP_NO_ERROR)
+                {
+                    mIsDeformationInitialised = true;
+                    return;
+                }
+                WarnLog << "AnimationApp::InitControlDeformation proxy failed, res=" << res << std::endl;
+                GPPFREEPOINTER(mProxyDeformMesh);
+                GPPFREEPOINTER(mpDeformProxy);
+            }
+            if (InitFullDeformation())
+            {
+                mIsDeformationInitialised = true;
+            }
+        }
+    }
+
+    bool AnimationApp::InitFullDeformation()
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (mpDeformProxy)
+        {
+            // Proxy drags have moved the mesh, keep where the handles are before going back to the rest pose
+            // the proxy is built on, so that the full solve starts from the dragged shape
+            mProxyHandleIds.clear();
+            mProxyHandleCoords.clear();
             int controlSize = mControlFlags.size();
             for (int cid = 0; cid < controlSize; cid++)
             {
-                if (mControlFlags.at(cid) != 0)
+                if (mControlFlags.at(cid) == 2)
                 {
-                    vertexFixFlags.at(mControlIds.at(cid)) = 1;
+                    mProxyHandleIds.push_back(cid);
+                    mProxyHandleCoords.push_back(triMesh->GetVertexCoord(mControlIds.at(cid)));
                 }
             }
+            mpDeformProxy->RestoreRestPose(triMesh);
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
+        }
+        std::vector<bool> vertexFixFlags;
+        CollectVertexFixFlags(triMesh->GetVertexCount(), vertexFixFlags);
 #if MAKEDUMPFILE
-            GPP::DumpOnce();
+        GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = mDeformMesh->Init(triMesh, vertexFixFlags);
-            if (res == GPP_API_IS_NOT_AVAILABLE)
+        GPP::ErrorCode res = mDeformMesh->Init(triMesh, vertexFixFlags);
+        if (res == GPP_API_IS_NOT_AVAILABLE)
+        {
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+            MagicCore::ToolKit::Get()->SetAppRunning(false);
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            if (res == GPP_INVALID_INPUT)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                MagicCore::ToolKit::Get()->SetAppRunning(false);
+                MessageBox(NULL, "网格有连通区域没有固定点", "温馨提示", MB_OK);
             }
-            if (res != GPP_NO_ERROR)
+            else
             {
-                if (res == GPP_INVALID_INPUT)
-                {
-                    MessageBox(NULL, "ͨûй̶", "ܰʾ", MB_OK);
-                }
-                else
-                {
-                    MessageBox(NULL, "γʼʧ", "ܰʾ", MB_OK);
-                }
-                return;
+                MessageBox(NULL, "变形初始化失败", "温馨提示", MB_OK);
             }
-            mIsDeformationInitialised = true;
+            return false;
         }
+        mIsFullDeformationInitialised = true;
+        return true;
     }
 
     void AnimationApp::DoControlDeformation()
     {
-        if (mTargetControlCoords.empty())
+        if (mTargetControlCoords.empty() && mpDeformProxy == NULL)
         {
             return;
         }
         if (!mIsDeformationInitialised)
         {
-            MessageBox(NULL, "ûгʼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "变形没有初始化", "温馨提示", MB_OK);
             return;
         }
+        ResetDeformSession();
         GPP::ErrorCode res = GPP_NO_ERROR;
         if (mDeformPointList)
         {
@@ -749,22 +885,63 @@ namespace MagicApp
         }
         else if (mDeformMesh)
         {
+            // Final result is always solved on the full mesh
+            if (!mIsFullDeformationInitialised && !InitFullDeformation())
+            {
+                return;
+            }
             std::vector<int> targetVertexIds;
+            std::vector<GPP::Vector3> targetCoords = mTargetControlCoords;
             for (std::vector<int>::iterator itr = mTargetControlIds.begin(); itr != mTargetControlIds.end(); ++itr)
             {
                 targetVertexIds.push_back(mControlIds.at(*itr));
             }
+            // Handles which are only dragged on the proxy keep their dragged position
+            int proxyHandleCount = mProxyHandleIds.size();
+            for (int hid = 0; hid < proxyHandleCount; hid++)
+            {
+                if (std::find(mTargetControlIds.begin(), mTargetControlIds.end(), mProxyHandleIds.at(hid)) == mTargetControlIds.end())
+                {
+                    targetVertexIds.push_back(mControlIds.at(mProxyHandleIds.at(hid)));
+                    targetCoords.push_back(mProxyHandleCoords.at(hid));
+                }
+            }
+            if (targetVertexIds.empty())
+            {
+                return;
+            }
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            res = mDeformMesh->Deform(targetVertexIds, mTargetControlCoords, GPP::DEFORM_MESH_TYPE_ACCURATE);
-            ModelManager::Get()->GetMesh()->UpdateNormal();
+            res = mDeformMesh->Deform(targetVertexIds, targetCoords, GPP::DEFORM_MESH_TYPE_ACCURATE);
+            GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+            triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
+            if (res == GPP_NO_ERROR && mpDeformProxy)
+            {
+                // Every handle must sit on its target after a commit, also the ones only dragged on the proxy
+                int targetCount = targetVertexIds.size();
+                for (int tid = 0; tid < targetCount; tid++)
+                {
+                    GPP::Real offset = (triMesh->GetVertexCoord(targetVertexIds.at(tid)) - targetCoords.at(tid)).Length();
+                    if (offset > gDeformTargetTolerance)
+                    {
+                        WarnLog << "AnimationApp::DoControlDeformation handle " << targetVertexIds.at(tid) 
+                            << " is " << offset << " away from its target" << std::endl;
+                    }
+                }
+                // Later proxy drags start from the committed shape, and the committed handles need no snapshot
+                mpDeformProxy->ResetRestPose(triMesh);
+                mProxyHandleIds.clear();
+                mProxyHandleCoords.clear();
+            }
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "άģͱʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "三维模型变形失败", "温馨提示", MB_OK);
             return;
         }
+        UpdateControlCoords();
         UpdateModelRendering();
         UpdateControlRendering();
     }
@@ -776,7 +953,7 @@ namespace MagicApp
         if (mFirstAlert)
         {
             mFirstAlert = false;
-            MessageBox(NULL, "ҼѡƵģʽ(+)ѡťƶƵģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入框选控制点模式(+)，点击选择按钮返回移动控制点模式", "温馨提示", MB_OK);
         }
     }
         
@@ -787,7 +964,7 @@ namespace MagicApp
         if (mFirstAlert)
         {
             mFirstAlert = false;
-            MessageBox(NULL, "ҼѡƵģʽ(-)ѡťƶƵģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入框选控制点模式(-)，点击选择按钮返回移动控制点模式", "温馨提示", MB_OK);
         }
     }
 
@@ -795,7 +972,7 @@ namespace MagicApp
     //{
     //    if (!mIsDeformationInitialised)
     //    {
-    //        MessageBox(NULL, "ûгʼ", "ܰʾ", MB_OK);
+    //        MessageBox(NULL, "变形没有初始化", "温馨提示", MB_OK);
     //        return;
     //    }
     //    mRightMouseType = DEFORM;
@@ -819,6 +996,10 @@ namespace MagicApp
         light->setSpecularColour(0.5, 0.5, 0.5);
 
         InitViewTool();
+        if (mpDeformSession == NULL)
+        {
+            mpDeformSession = new DeformSession;
+        }
 
         if (ModelManager::Get()->GetMesh() != NULL)
         {
@@ -850,6 +1031,7 @@ namespace MagicApp
         MagicCore::RenderSystem::Get()->HideRenderingObject("ControlPoint_Handle_AnimationApp");
         MagicCore::RenderSystem::Get()->HideRenderingObject("ControlPoint_Target_AnimationApp");
 
+        ResetDeformSession();
         GPPFREEPOINTER(mDeformPointList);
     }
 
@@ -899,49 +1081,25 @@ namespace MagicApp
         }
         else
         {
-            GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
-
             std::vector<GPP::Vector3> fixCoords;
             std::vector<GPP::Vector3> freeCoords;
             std::vector<GPP::Vector3> handleCoords;
-            std::vector<GPP::Vector3> targetCoords;
-            if (triMesh)
+            int coordCount = mControlCoords.size();
+            for (int cid = 0; cid < coordCount; cid++)
             {
-                for (int cid = 0; cid < mControlIds.size(); cid++)
+                if (mControlFlags.at(cid) == 0)
                 {
-                    if (mControlFlags.at(cid) == 0)
-                    {
-                        freeCoords.push_back(triMesh->GetVertexCoord(mControlIds.at(cid)));
-                    }
-                    else if (mControlFlags.at(cid) == 1)
-                    {
-                        fixCoords.push_back(triMesh->GetVertexCoord(mControlIds.at(cid)));
-                    }
-                    else if (mControlFlags.at(cid) == 2)
-                    {
-                        handleCoords.push_back(triMesh->GetVertexCoord(mControlIds.at(cid)));
-                    }
+                    freeCoords.push_back(mControlCoords.at(cid));
                 }
-            }
-            else if (pointCloud)
-            {
-                for (int cid = 0; cid < mControlIds.size(); cid++)
+                else if (mControlFlags.at(cid) == 1)
                 {
-                    if (mControlFlags.at(cid) == 0)
-                    {
-                        freeCoords.push_back(pointCloud->GetPointCoord(mControlIds.at(cid)));
-                    }
-                    else if (mControlFlags.at(cid) == 1)
-                    {
-                        fixCoords.push_back(pointCloud->GetPointCoord(mControlIds.at(cid)));
-                    }
-                    else if (mControlFlags.at(cid) == 2)
-                    {
-                        handleCoords.push_back(pointCloud->GetPointCoord(mControlIds.at(cid)));
-                    }
+                    fixCoords.push_back(mControlCoords.at(cid));
                 }
-            }            
+                else if (mControlFlags.at(cid) == 2)
+                {
+                    handleCoords.push_back(mControlCoords.at(cid));
+                }
+            }
             MagicCore::RenderSystem::Get()->RenderPointList("ControlPoint_Free_AnimationApp", "SimplePoint_Large", GPP::Vector3(0, 0, 1), freeCoords, MagicCore::RenderSystem::MODEL_NODE_CENTER);
             MagicCore::RenderSystem::Get()->RenderPointList("ControlPoint_Handle_AnimationApp", "SimplePoint_Large", GPP::Vector3(0, 1, 0), handleCoords, MagicCore::RenderSystem::MODEL_NODE_CENTER);
             if (mDeformType == AnimationApp::DT_CONTROL_POINT)
@@ -11,6 +11,8 @@ namespace MagicCore
 namespace MagicApp
 {
     class AnimationAppUI;
+    class DeformSession;
+    class DeformProxy;
     class AnimationApp : public AppBase
     {
         enum CommandType
@@ -62,9 +64,14 @@ namespace MagicApp
         void PickControlPoint(int mouseCoordX, int mouseCoordY);
         void DragControlPoint(int mouseCoordX, int mouseCoordY, bool mouseReleased);
         void UpdateDeformation(int mouseCoordX, int mouseCoordY, bool isAccurate);
+        void ResetDeformSession(void);
+        void CollectVertexFixFlags(GPP::Int vertexCount, std::vector<bool>& vertexFixFlags) const;
+        bool InitFullDeformation(void);
         void SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void ClearRectangleRendering(void);
+        // Control coordinates are read from the model only while no solve is writing it
+        void UpdateControlCoords(void);
 
         void UpdateModelRendering(void);
         void UpdateControlRendering(void);
@@ -82,7 +89,15 @@ namespace MagicApp
         DeformType mDeformType;
         GPP::DeformPointList* mDeformPointList;
         GPP::DeformMesh* mDeformMesh;
+        DeformSession* mpDeformSession;
+        DeformProxy* mpDeformProxy;
+        GPP::DeformMesh* mProxyDeformMesh;
+        bool mIsFullDeformationInitialised;
+        // Handle positions reached by proxy drags, they are the targets of the full solve
+        std::vector<int> mProxyHandleIds;
+        std::vector<GPP::Vector3> mProxyHandleCoords;
         std::vector<GPP::Int> mControlIds;
+        std::vector<GPP::Vector3> mControlCoords;
         bool mIsDeformationInitialised;
         int mPickControlId;
         GPP::Vector3 mPickTargetCoord;
@@ -0,0 +1,236 @@
+#include "AttributeChannels.h"
+#include "../Common/ThreadPool.h"
+
+namespace MagicApp
+{
+    class ChannelGatherTask : public MagicCore::ParallelTask
+    {
+    public:
+        ChannelGatherTask(const std::vector<IAttributeChannel*>* channels, const GPP::Int* sourceIds) :
+            mpChannels(channels),
+            mpSourceIds(sourceIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            // All channels of a block are gathered while its source ids are in cache
+            for (std::vector<IAttributeChannel*>::const_iterator itr = mpChannels->begin(); itr != mpChannels->end(); ++itr)
+            {
+                (*itr)->GatherRange(mpSourceIds, startId, endId);
+            }
+        }
+
+    private:
+        const std::vector<IAttributeChannel*>* mpChannels;
+        const GPP::Int* mpSourceIds;
+    };
+
+    class PointCloudWriteTask : public MagicCore::ParallelTask
+    {
+    public:
+        PointCloudWriteTask(GPP::PointCloud* pointCloud, const std::vector<GPP::Vector3>* coords,
+            const std::vector<GPP::Vector3>* normals, const std::vector<GPP::Vector3>* colors) :
+            mpPointCloud(pointCloud),
+            mpCoords(coords),
+            mpNormals(normals),
+            mpColors(colors)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            bool hasNormal = !mpNormals->empty();
+            bool hasColor = !mpColors->empty();
+            for (int pid = startId; pid < endId; pid++)
+            {
+                mpPointCloud->SetPointCoord(pid, (*mpCoords)[pid]);
+                if (hasNormal)
+                {
+                    mpPointCloud->SetPointNormal(pid, (*mpNormals)[pid]);
+                }
+                if (hasColor)
+                {
+                    mpPointCloud->SetPointColor(pid, (*mpColors)[pid]);
+                }
+            }
+        }
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<GPP::Vector3>* mpNormals;
+        const std::vector<GPP::Vector3>* mpColors;
+    };
+
+    IAttributeChannel::IAttributeChannel()
+    {
+    }
+
+    IAttributeChannel::~IAttributeChannel()
+    {
+    }
+
+    PointCloudChannel::PointCloudChannel(GPP::PointCloud* pointCloud) :
+        mpPointCloud(pointCloud),
+        mCoords(),
+        mNormals(),
+        mColors()
+    {
+    }
+
+    PointCloudChannel::~PointCloudChannel()
+    {
+    }
+
+    GPP::Int PointCloudChannel::GetElementCount() const
+    {
+        return mpPointCloud->GetPointCount();
+    }
+
+    void PointCloudChannel::BeginGather(GPP::Int targetCount)
+    {
+        mCoords.resize(targetCount);
+        if (mpPointCloud->HasNormal())
+        {
+            mNormals.resize(targetCount);
+        }
+        if (mpPointCloud->HasColor())
+        {
+            mColors.resize(targetCount);
+        }
+    }
+
+    void PointCloudChannel::GatherRange(const GPP::Int* sourceIds, GPP::Int startId, GPP::Int endId)
+    {
+        bool hasNormal = !mNormals.empty();
+        bool hasColor = !mColors.empty();
+        for (GPP::Int tid = startId; tid < endId; tid++)
+        {
+            GPP::Int sourceId = sourceIds[tid];
+            mCoords[tid] = mpPointCloud->GetPointCoord(sourceId);
+            if (hasNormal)
+            {
+                mNormals[tid] = mpPointCloud->GetPointNormal(sourceId);
+            }
+            if (hasColor)
+            {
+                mColors[tid] = mpPointCloud->GetPointColor(sourceId);
+            }
+        }
+    }
+
+    void PointCloudChannel::EndGather()
+    {
+        GPP::Int targetCount = mCoords.size();
+        GPP::Int pointCount = mpPointCloud->GetPointCount();
+        if (targetCount < pointCount)
+        {
+            mpPointCloud->PopbackPoints(pointCount - targetCount);
+        }
+        else
+        {
+            for (GPP::Int pid = pointCount; pid < targetCount; pid++)
+            {
+                mpPointCloud->InsertPoint(mCoords[pid]);
+            }
+        }
+        PointCloudWriteTask writeTask(mpPointCloud, &mCoords, &mNormals, &mColors);
+        MagicCore::ThreadPool::Get()->ParallelFor(targetCount, &writeTask, 8192);
+        std::vector<GPP::Vector3>().swap(mCoords);
+        std::vector<GPP::Vector3>().swap(mNormals);
+        std::vector<GPP::Vector3>().swap(mColors);
+    }
+
+    AttributeChannelRegistry::AttributeChannelRegistry(GPP::Int elementCount) :
+        mElementCount(elementCount),
+        mChannels()
+    {
+    }
+
+    AttributeChannelRegistry::~AttributeChannelRegistry()
+    {
+        Clear();
+    }
+
+    bool AttributeChannelRegistry::AddChannel(IAttributeChannel* channel)
+    {
+        if (channel == NULL)
+        {
+            return false;
+        }
+        if (channel->GetElementCount() != mElementCount)
+        {
+            GPPFREEPOINTER(channel);
+            return false;
+        }
+        mChannels.push_back(channel);
+        return true;
+    }
+
+    GPP::Int AttributeChannelRegistry::GetElementCount() const
+    {
+        return mElementCount;
+    }
+
+    GPP::Int AttributeChannelRegistry::GetChannelCount() const
+    {
+        return mChannels.size();
+    }
+
+    void AttributeChannelRegistry::Clear()
+    {
+        for (std::vector<IAttributeChannel*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mChannels.clear();
+    }
+
+    void AttributeChannelRegistry::Gather(const std::vector<GPP::Int>& sourceIds)
+    {
+        GPP::Int targetCount = sourceIds.size();
+        for (std::vector<IAttributeChannel*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            (*itr)->BeginGather(targetCount);
+        }
+        if (targetCount > 0)
+        {
+            ChannelGatherTask gatherTask(&mChannels, &sourceIds.at(0));
+            MagicCore::ThreadPool::Get()->ParallelFor(targetCount, &gatherTask, 8192);
+        }
+        for (std::vector<IAttributeChannel*>::iterator itr = mChannels.begin(); itr != mChannels.end(); ++itr)
+        {
+            (*itr)->EndGather();
+        }
+        mElementCount = targetCount;
+    }
+
+    GPP::ErrorCode AttributeChannelRegistry::Delete(const std::vector<GPP::Int>& deleteIds)
+    {
+        if (deleteIds.empty())
+        {
+            return GPP_NO_ERROR;
+        }
+        std::vector<bool> deleteFlags(mElementCount, false);
+        for (std::vector<GPP::Int>::const_iterator itr = deleteIds.begin(); itr != deleteIds.end(); ++itr)
+        {
+            if (*itr < 0 || *itr >= mElementCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            deleteFlags[*itr] = true;
+        }
+        std::vector<GPP::Int> keepIds;
+        keepIds.reserve(mElementCount);
+        for (GPP::Int eid = 0; eid < mElementCount; eid++)
+        {
+            if (!deleteFlags[eid])
+            {
+                keepIds.push_back(eid);
+            }
+        }
+        Gather(keepIds);
+        return GPP_NO_ERROR;
+    }
+}
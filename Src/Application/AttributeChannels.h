@@ -0,0 +1,118 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Per element data which should move together with the elements of a point cloud or mesh
+    class IAttributeChannel
+    {
+    public:
+        IAttributeChannel();
+        virtual ~IAttributeChannel();
+
+        virtual GPP::Int GetElementCount(void) const = 0;
+        // Allocate the destination of targetCount elements
+        virtual void BeginGather(GPP::Int targetCount) = 0;
+        // destination[tid] = source[sourceIds[tid]], tid in [startId, endId). Disjoint ranges could run in parallel.
+        virtual void GatherRange(const GPP::Int* sourceIds, GPP::Int startId, GPP::Int endId) = 0;
+        // Replace the source by the destination
+        virtual void EndGather(void) = 0;
+    };
+
+    template<class T>
+    class VectorChannel : public IAttributeChannel
+    {
+    public:
+        explicit VectorChannel(std::vector<T>* data) :
+            mpData(data),
+            mGatherData()
+        {
+        }
+
+        virtual ~VectorChannel()
+        {
+        }
+
+        virtual GPP::Int GetElementCount(void) const
+        {
+            return mpData->size();
+        }
+
+        virtual void BeginGather(GPP::Int targetCount)
+        {
+            mGatherData.resize(targetCount);
+        }
+
+        virtual void GatherRange(const GPP::Int* sourceIds, GPP::Int startId, GPP::Int endId)
+        {
+            const std::vector<T>& data = *mpData;
+            for (GPP::Int tid = startId; tid < endId; tid++)
+            {
+                mGatherData[tid] = data[sourceIds[tid]];
+            }
+        }
+
+        virtual void EndGather(void)
+        {
+            mpData->swap(mGatherData);
+            std::vector<T>().swap(mGatherData);
+        }
+
+    private:
+        std::vector<T>* mpData;
+        std::vector<T> mGatherData;
+    };
+
+    // Coordinates, normals and colors of a point cloud
+    class PointCloudChannel : public IAttributeChannel
+    {
+    public:
+        explicit PointCloudChannel(GPP::PointCloud* pointCloud);
+        virtual ~PointCloudChannel();
+
+        virtual GPP::Int GetElementCount(void) const;
+        virtual void BeginGather(GPP::Int targetCount);
+        virtual void GatherRange(const GPP::Int* sourceIds, GPP::Int startId, GPP::Int endId);
+        virtual void EndGather(void);
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        std::vector<GPP::Vector3> mCoords;
+        std::vector<GPP::Vector3> mNormals;
+        std::vector<GPP::Vector3> mColors;
+    };
+
+    // Registry of all channels of the same element set.
+    // Gather and Delete move every channel in one parallel pass over the target range, element order is kept.
+    class AttributeChannelRegistry
+    {
+    public:
+        explicit AttributeChannelRegistry(GPP::Int elementCount);
+        ~AttributeChannelRegistry();
+
+        // Take the ownership. A channel whose element count is different is rejected and deleted, return false.
+        bool AddChannel(IAttributeChannel* channel);
+        template<class T>
+        bool AddVector(std::vector<T>* data)
+        {
+            if (data == NULL)
+            {
+                return false;
+            }
+            return AddChannel(new VectorChannel<T>(data));
+        }
+        GPP::Int GetElementCount(void) const;
+        GPP::Int GetChannelCount(void) const;
+        void Clear(void);
+
+        // New element tid is the old element sourceIds[tid]
+        void Gather(const std::vector<GPP::Int>& sourceIds);
+        // GPP_INVALID_INPUT if any id is out of range, nothing is changed then
+        GPP::ErrorCode Delete(const std::vector<GPP::Int>& deleteIds);
+
+    private:
+        GPP::Int mElementCount;
+        std::vector<IAttributeChannel*> mChannels;
+    };
+}
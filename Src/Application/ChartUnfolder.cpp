@@ -0,0 +1,608 @@
+#include "ChartUnfolder.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/LogSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace MagicApp
+{
+    static const GPP::Real gChartPadding = 0.01;
+    static const GPP::ULongInt gHashOffset = 14695981039346656037ULL;
+    static const GPP::ULongInt gHashPrime = 1099511628211ULL;
+
+    // FNV-1a
+    static GPP::ULongInt HashBytes(GPP::ULongInt hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t byteId = 0; byteId < size; byteId++)
+        {
+            hash = (hash ^ bytes[byteId]) * gHashPrime;
+        }
+        return hash;
+    }
+
+    static GPP::ULongInt HashCoord(GPP::ULongInt hash, const GPP::Vector3& coord)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real value = coord[axis];
+            hash = HashBytes(hash, &value, sizeof(GPP::Real));
+        }
+        return hash;
+    }
+
+    static bool ComparePreviousVertex(const PreviousChartVertex& vertex0, const PreviousChartVertex& vertex1)
+    {
+        return vertex0.coordHash < vertex1.coordHash;
+    }
+
+    static GPP::Int FindRoot(std::vector<GPP::Int>& parents, GPP::Int vid)
+    {
+        GPP::Int root = vid;
+        while (parents[root] != root)
+        {
+            root = parents[root];
+        }
+        while (parents[vid] != root)
+        {
+            GPP::Int nextId = parents[vid];
+            parents[vid] = root;
+            vid = nextId;
+        }
+        return root;
+    }
+
+    static bool CompareChartSize(const UVChart* chart0, const UVChart* chart1)
+    {
+        return chart0->triangleIds.size() > chart1->triangleIds.size();
+    }
+
+    static GPP::ErrorCode MergeResult(GPP::ErrorCode res, GPP::ErrorCode chartRes)
+    {
+        if (res == GPP_API_IS_NOT_AVAILABLE || chartRes == GPP_NO_ERROR)
+        {
+            return res;
+        }
+        if (res == GPP_NO_ERROR || chartRes == GPP_API_IS_NOT_AVAILABLE)
+        {
+            return chartRes;
+        }
+        return res;
+    }
+
+    class ChartUnfoldTask : public MagicCore::ParallelTask
+    {
+    public:
+        ChartUnfoldTask(std::vector<UVChart*>* charts, const std::vector<UVChart*>* previousCharts,
+            const std::vector<PreviousChartVertex>* previousVertices, bool isAtlas, GPP::Int parameter, GPP::Real totalArea,
+            bool needSplitFoldOver, bool needSplitOverlap) :
+            mpCharts(charts),
+            mpPreviousCharts(previousCharts),
+            mpPreviousVertices(previousVertices),
+            mIsAtlas(isAtlas),
+            mParameter(parameter),
+            mTotalArea(totalArea),
+            mNeedSplitFoldOver(needSplitFoldOver),
+            mNeedSplitOverlap(needSplitOverlap)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int cid = startId; cid < endId; cid++)
+            {
+                UVChart* chart = mpCharts->at(cid);
+                chart->texCoords.clear();
+                chart->faceTexIds.clear();
+                chart->hasVertexTexCoords = false;
+                if (mIsAtlas)
+                {
+                    GPP::Int initChartCount = 1;
+                    if (mTotalArea > GPP::REAL_TOL)
+                    {
+                        initChartCount = GPP::Int(mParameter * chart->area / mTotalArea + 0.5);
+                    }
+                    initChartCount = initChartCount < 1 ? 1 : initChartCount;
+                    chart->result = GPP::UnfoldMesh::GenerateUVAtlas(chart->chartMesh, initChartCount, &(chart->texCoords),
+                        &(chart->faceTexIds), true, mNeedSplitFoldOver, mNeedSplitOverlap);
+                }
+                else if (chart->previousChartId != -1)
+                {
+                    const UVChart* previousChart = mpPreviousCharts->at(chart->previousChartId);
+                    chart->texCoords = previousChart->texCoords;
+                    chart->faceTexIds = previousChart->faceTexIds;
+                    chart->hasVertexTexCoords = previousChart->hasVertexTexCoords;
+                    chart->result = GPP_NO_ERROR;
+                }
+                else if (WarmStartChart(chart))
+                {
+                    chart->result = GPP_NO_ERROR;
+                }
+                else
+                {
+                    chart->result = UnfoldChart(chart);
+                }
+            }
+        }
+
+    private:
+        GPP::ErrorCode UnfoldChart(UVChart* chart)
+        {
+            std::vector<std::vector<GPP::Int> > holeIds;
+            GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(chart->chartMesh, &holeIds);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            if (holeIds.empty() || holeIds.at(0).size() < 2)
+            {
+                return GPP::UnfoldMesh::GenerateUVAtlas(chart->chartMesh, 1, &(chart->texCoords), &(chart->faceTexIds),
+                    false, false, false);
+            }
+            std::vector<GPP::Int> fixedVertexIndices(2);
+            std::vector<GPP::Real> fixedVertexCoords(4);
+            fixedVertexIndices.at(0) = holeIds.at(0).at(0);
+            fixedVertexIndices.at(1) = holeIds.at(0).at(holeIds.at(0).size() / 2);
+            fixedVertexCoords.at(0) = -1.0;
+            fixedVertexCoords.at(1) = -1.0;
+            fixedVertexCoords.at(2) = 1.0;
+            fixedVertexCoords.at(3) = 1.0;
+            res = GPP::UnfoldMesh::ConformalMap(chart->chartMesh, &fixedVertexIndices, &fixedVertexCoords, &(chart->texCoords));
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            if (mParameter > 0)
+            {
+                res = GPP::UnfoldMesh::OptimizeIsometric(chart->chartMesh, &(chart->texCoords), mParameter, NULL);
+                if (res != GPP_NO_ERROR)
+                {
+                    return res;
+                }
+            }
+            SetVertexFaceTexIds(chart);
+            chart->hasVertexTexCoords = true;
+            return GPP_NO_ERROR;
+        }
+
+        // A chart cut from a previous chart has all its vertex coordinates in it. The previous texture coordinates
+        // are a valid embedding of the chart, the new cut only relaxes it.
+        bool WarmStartChart(UVChart* chart)
+        {
+            if (chart->vertexIds.empty())
+            {
+                return false;
+            }
+            GPP::Int vertexCount = chart->chartMesh->GetVertexCount();
+            std::vector<GPP::Int> candidateChartIds;
+            FindPreviousVertices(chart->chartMesh->GetVertexCoord(0), -1, candidateChartIds, NULL);
+            std::vector<GPP::Int> previousVertexIds(vertexCount);
+            for (std::vector<GPP::Int>::iterator itr = candidateChartIds.begin(); itr != candidateChartIds.end(); ++itr)
+            {
+                bool isMatched = true;
+                for (GPP::Int vid = 0; vid < vertexCount; vid++)
+                {
+                    std::vector<GPP::Int> matchedChartIds;
+                    FindPreviousVertices(chart->chartMesh->GetVertexCoord(vid), *itr, matchedChartIds, &previousVertexIds.at(vid));
+                    if (matchedChartIds.empty())
+                    {
+                        isMatched = false;
+                        break;
+                    }
+                }
+                if (!isMatched)
+                {
+                    continue;
+                }
+                const std::vector<GPP::Real>& previousTexCoords = mpPreviousCharts->at(*itr)->texCoords;
+                chart->texCoords.resize(vertexCount * 2);
+                for (GPP::Int vid = 0; vid < vertexCount; vid++)
+                {
+                    chart->texCoords.at(vid * 2) = previousTexCoords.at(previousVertexIds.at(vid) * 2);
+                    chart->texCoords.at(vid * 2 + 1) = previousTexCoords.at(previousVertexIds.at(vid) * 2 + 1);
+                }
+                if (mParameter > 0 &&
+                    GPP::UnfoldMesh::OptimizeIsometric(chart->chartMesh, &(chart->texCoords), mParameter, NULL) != GPP_NO_ERROR)
+                {
+                    chart->texCoords.clear();
+                    return false;
+                }
+                SetVertexFaceTexIds(chart);
+                chart->hasVertexTexCoords = true;
+                return true;
+            }
+            return false;
+        }
+
+        // chartId == -1: collect every previous chart which has coord, otherwise only chartId and its vertex id
+        void FindPreviousVertices(const GPP::Vector3& coord, GPP::Int chartId, std::vector<GPP::Int>& chartIds,
+            GPP::Int* localVertexId) const
+        {
+            PreviousChartVertex key;
+            key.coordHash = HashCoord(gHashOffset, coord);
+            std::pair<std::vector<PreviousChartVertex>::const_iterator, std::vector<PreviousChartVertex>::const_iterator> range =
+                std::equal_range(mpPreviousVertices->begin(), mpPreviousVertices->end(), key, ComparePreviousVertex);
+            for (std::vector<PreviousChartVertex>::const_iterator itr = range.first; itr != range.second; ++itr)
+            {
+                if (chartId != -1 && itr->chartId != chartId)
+                {
+                    continue;
+                }
+                if ((mpPreviousCharts->at(itr->chartId)->chartMesh->GetVertexCoord(itr->localVertexId) == coord) == false)
+                {
+                    continue;
+                }
+                chartIds.push_back(itr->chartId);
+                if (localVertexId)
+                {
+                    *localVertexId = itr->localVertexId;
+                    return;
+                }
+            }
+        }
+
+        void SetVertexFaceTexIds(UVChart* chart)
+        {
+            GPP::Int faceCount = chart->chartMesh->GetTriangleCount();
+            chart->faceTexIds.resize(faceCount * 3);
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                chart->chartMesh->GetTriangleVertexIds(fid, &(chart->faceTexIds.at(fid * 3)));
+            }
+        }
+
+    private:
+        std::vector<UVChart*>* mpCharts;
+        const std::vector<UVChart*>* mpPreviousCharts;
+        const std::vector<PreviousChartVertex>* mpPreviousVertices;
+        bool mIsAtlas;
+        GPP::Int mParameter;
+        GPP::Real mTotalArea;
+        bool mNeedSplitFoldOver;
+        bool mNeedSplitOverlap;
+    };
+
+    UVChart::UVChart() :
+        triangleIds(),
+        vertexIds(),
+        chartMesh(NULL),
+        area(0),
+        texCoords(),
+        faceTexIds(),
+        hasVertexTexCoords(false),
+        result(GPP_NO_ERROR),
+        signature(0),
+        isAtlas(false),
+        previousChartId(-1)
+    {
+    }
+
+    UVChart::~UVChart()
+    {
+        GPPFREEPOINTER(chartMesh);
+    }
+
+    ChartUnfolder::ChartUnfolder() :
+        mCharts(),
+        mPreviousCharts(),
+        mPreviousVertices(),
+        mTriangleCount(0),
+        mArea(0)
+    {
+    }
+
+    ChartUnfolder::~ChartUnfolder()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode ChartUnfolder::Init(const GPP::ITriMesh* triMesh)
+    {
+        // Keep the last solve for warm start
+        ReleaseCharts(mPreviousCharts);
+        mPreviousCharts.swap(mCharts);
+        mPreviousVertices.clear();
+        mTriangleCount = 0;
+        mArea = 0;
+        if (triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int faceCount = triMesh->GetTriangleCount();
+        if (faceCount < 1)
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        // Charts of the split mesh share no vertex
+        std::vector<GPP::Int> parents(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            parents[vid] = vid;
+        }
+        GPP::Int vertexIds[3] = {-1};
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int root0 = FindRoot(parents, vertexIds[0]);
+            for (int localId = 1; localId < 3; localId++)
+            {
+                GPP::Int root = FindRoot(parents, vertexIds[localId]);
+                if (root != root0)
+                {
+                    parents[root] = root0;
+                }
+            }
+        }
+        std::vector<GPP::Int> rootChartIds(vertexCount, -1);
+        std::vector<GPP::Int> localVertexIds(vertexCount, -1);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Int root = FindRoot(parents, vertexIds[0]);
+            if (rootChartIds[root] == -1)
+            {
+                rootChartIds[root] = mCharts.size();
+                UVChart* chart = new UVChart;
+                chart->chartMesh = new GPP::TriMesh;
+                mCharts.push_back(chart);
+            }
+            UVChart* chart = mCharts.at(rootChartIds[root]);
+            for (int localId = 0; localId < 3; localId++)
+            {
+                if (localVertexIds[vertexIds[localId]] == -1)
+                {
+                    localVertexIds[vertexIds[localId]] = chart->chartMesh->InsertVertex(triMesh->GetVertexCoord(vertexIds[localId]));
+                    chart->vertexIds.push_back(vertexIds[localId]);
+                }
+            }
+            chart->chartMesh->InsertTriangle(localVertexIds[vertexIds[0]], localVertexIds[vertexIds[1]], localVertexIds[vertexIds[2]]);
+            chart->triangleIds.push_back(fid);
+            GPP::Real triangleArea = GPP::MeasureMesh::TriangleArea(triMesh->GetVertexCoord(vertexIds[0]),
+                triMesh->GetVertexCoord(vertexIds[1]), triMesh->GetVertexCoord(vertexIds[2]));
+            chart->area += triangleArea;
+            mArea += triangleArea;
+        }
+        for (std::vector<UVChart*>::iterator itr = mCharts.begin(); itr != mCharts.end(); ++itr)
+        {
+            UVChart* chart = *itr;
+            chart->chartMesh->UpdateNormal();
+            GPP::Int chartVertexCount = chart->chartMesh->GetVertexCount();
+            GPP::Int chartFaceCount = chart->chartMesh->GetTriangleCount();
+            GPP::ULongInt signature = HashBytes(gHashOffset, &chartVertexCount, sizeof(GPP::Int));
+            signature = HashBytes(signature, &chartFaceCount, sizeof(GPP::Int));
+            for (GPP::Int vid = 0; vid < chartVertexCount; vid++)
+            {
+                signature = HashCoord(signature, chart->chartMesh->GetVertexCoord(vid));
+            }
+            for (GPP::Int fid = 0; fid < chartFaceCount; fid++)
+            {
+                chart->chartMesh->GetTriangleVertexIds(fid, vertexIds);
+                signature = HashBytes(signature, vertexIds, sizeof(GPP::Int) * 3);
+            }
+            chart->signature = signature;
+        }
+        // Large charts are scheduled first, so small ones fill the idle workers at the end
+        std::sort(mCharts.begin(), mCharts.end(), CompareChartSize);
+        mTriangleCount = faceCount;
+        InfoLog << "ChartUnfolder::Init chartCount=" << mCharts.size() << " faceCount=" << faceCount << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int ChartUnfolder::GetChartCount() const
+    {
+        return mCharts.size();
+    }
+
+    void ChartUnfolder::Clear()
+    {
+        ReleaseCharts(mCharts);
+        ReleaseCharts(mPreviousCharts);
+        mPreviousVertices.clear();
+        mTriangleCount = 0;
+        mArea = 0;
+    }
+
+    GPP::ErrorCode ChartUnfolder::UnfoldCharts(GPP::Int isometricIterationCount)
+    {
+        return RunCharts(false, isometricIterationCount, false, false);
+    }
+
+    GPP::ErrorCode ChartUnfolder::GenerateChartAtlas(GPP::Int initChartCount, bool needSplitFoldOver, bool needSplitOverlap)
+    {
+        return RunCharts(true, initChartCount, needSplitFoldOver, needSplitOverlap);
+    }
+
+    GPP::ErrorCode ChartUnfolder::RunCharts(bool isAtlas, GPP::Int parameter, bool needSplitFoldOver, bool needSplitOverlap)
+    {
+        if (mCharts.empty())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        for (std::vector<UVChart*>::iterator itr = mCharts.begin(); itr != mCharts.end(); ++itr)
+        {
+            (*itr)->isAtlas = isAtlas;
+            (*itr)->previousChartId = -1;
+        }
+        if (!isAtlas)
+        {
+            MatchPreviousCharts();
+        }
+        ChartUnfoldTask unfoldTask(&mCharts, &mPreviousCharts, &mPreviousVertices, isAtlas, parameter, mArea,
+            needSplitFoldOver, needSplitOverlap);
+        MagicCore::ThreadPool::Get()->ParallelFor(mCharts.size(), &unfoldTask, 1);
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        for (std::vector<UVChart*>::iterator itr = mCharts.begin(); itr != mCharts.end(); ++itr)
+        {
+            res = MergeResult(res, (*itr)->result);
+        }
+        // The previous solve is not needed any more
+        ReleaseCharts(mPreviousCharts);
+        std::vector<PreviousChartVertex>().swap(mPreviousVertices);
+        return res;
+    }
+
+    void ChartUnfolder::MatchPreviousCharts()
+    {
+        mPreviousVertices.clear();
+        std::map<GPP::ULongInt, GPP::Int> signatureChartIds;
+        GPP::Int previousChartCount = mPreviousCharts.size();
+        for (GPP::Int pcid = 0; pcid < previousChartCount; pcid++)
+        {
+            const UVChart* previousChart = mPreviousCharts.at(pcid);
+            if (previousChart->isAtlas || previousChart->result != GPP_NO_ERROR || previousChart->texCoords.empty())
+            {
+                continue;
+            }
+            signatureChartIds[previousChart->signature] = pcid;
+            if (!previousChart->hasVertexTexCoords)
+            {
+                // The one chart atlas of a closed chart has texCoords per texture vertex, it can only be reused as a whole
+                continue;
+            }
+            GPP::Int vertexCount = previousChart->chartMesh->GetVertexCount();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                PreviousChartVertex previousVertex;
+                previousVertex.coordHash = HashCoord(gHashOffset, previousChart->chartMesh->GetVertexCoord(vid));
+                previousVertex.chartId = pcid;
+                previousVertex.localVertexId = vid;
+                mPreviousVertices.push_back(previousVertex);
+            }
+        }
+        std::sort(mPreviousVertices.begin(), mPreviousVertices.end(), ComparePreviousVertex);
+        GPP::Int reusedCount = 0;
+        for (std::vector<UVChart*>::iterator itr = mCharts.begin(); itr != mCharts.end(); ++itr)
+        {
+            std::map<GPP::ULongInt, GPP::Int>::iterator signatureItr = signatureChartIds.find((*itr)->signature);
+            if (signatureItr == signatureChartIds.end())
+            {
+                continue;
+            }
+            const UVChart* previousChart = mPreviousCharts.at(signatureItr->second);
+            if (previousChart->triangleIds.size() == (*itr)->triangleIds.size() &&
+                previousChart->vertexIds.size() == (*itr)->vertexIds.size())
+            {
+                (*itr)->previousChartId = signatureItr->second;
+                reusedCount++;
+            }
+        }
+        InfoLog << "ChartUnfolder::MatchPreviousCharts reused " << reusedCount << " of " << mCharts.size() << std::endl;
+    }
+
+    void ChartUnfolder::ReleaseCharts(std::vector<UVChart*>& charts)
+    {
+        for (std::vector<UVChart*>::iterator itr = charts.begin(); itr != charts.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        charts.clear();
+    }
+
+    struct ChartRect
+    {
+        GPP::Int chartId;
+        GPP::Real minCoord[2];
+        GPP::Real scale;
+        GPP::Real width;
+        GPP::Real height;
+    };
+
+    static bool CompareRectHeight(const ChartRect& rect0, const ChartRect& rect1)
+    {
+        return rect0.height > rect1.height;
+    }
+
+    GPP::ErrorCode ChartUnfolder::PackCharts(std::vector<GPP::Real>& texCoords, std::vector<GPP::Int>& faceTexIds) const
+    {
+        if (mCharts.empty())
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        GPP::Int chartCount = mCharts.size();
+        GPP::Real padding = gChartPadding * sqrt(mArea);
+        std::vector<ChartRect> chartRects(chartCount);
+        std::vector<GPP::Int> texOffsets(chartCount + 1, 0);
+        GPP::Real packedArea = 0;
+        GPP::Real maxWidth = 0;
+        for (GPP::Int cid = 0; cid < chartCount; cid++)
+        {
+            const UVChart* chart = mCharts.at(cid);
+            if (chart->result != GPP_NO_ERROR || chart->texCoords.size() < 2 ||
+                chart->faceTexIds.size() != chart->triangleIds.size() * 3)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            GPP::Int texCount = chart->texCoords.size() / 2;
+            texOffsets.at(cid + 1) = texOffsets.at(cid) + texCount;
+            GPP::Real minCoord[2] = {chart->texCoords.at(0), chart->texCoords.at(1)};
+            GPP::Real maxCoord[2] = {chart->texCoords.at(0), chart->texCoords.at(1)};
+            for (GPP::Int tid = 1; tid < texCount; tid++)
+            {
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    GPP::Real coord = chart->texCoords.at(tid * 2 + axis);
+                    minCoord[axis] = coord < minCoord[axis] ? coord : minCoord[axis];
+                    maxCoord[axis] = coord > maxCoord[axis] ? coord : maxCoord[axis];
+                }
+            }
+            GPP::Real uvArea = 0;
+            GPP::Int faceCount = chart->faceTexIds.size() / 3;
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                const GPP::Real* coord0 = &(chart->texCoords.at(chart->faceTexIds.at(fid * 3) * 2));
+                const GPP::Real* coord1 = &(chart->texCoords.at(chart->faceTexIds.at(fid * 3 + 1) * 2));
+                const GPP::Real* coord2 = &(chart->texCoords.at(chart->faceTexIds.at(fid * 3 + 2) * 2));
+                uvArea += fabs((coord1[0] - coord0[0]) * (coord2[1] - coord0[1]) - (coord2[0] - coord0[0]) * (coord1[1] - coord0[1])) / 2.0;
+            }
+            ChartRect& rect = chartRects.at(cid);
+            rect.chartId = cid;
+            rect.minCoord[0] = minCoord[0];
+            rect.minCoord[1] = minCoord[1];
+            rect.scale = (uvArea > GPP::REAL_TOL && chart->area > GPP::REAL_TOL) ? sqrt(chart->area / uvArea) : 1.0;
+            rect.width = (maxCoord[0] - minCoord[0]) * rect.scale + padding;
+            rect.height = (maxCoord[1] - minCoord[1]) * rect.scale + padding;
+            packedArea += rect.width * rect.height;
+            maxWidth = rect.width > maxWidth ? rect.width : maxWidth;
+        }
+        // Shelves of a nearly square atlas, the tallest charts first
+        std::sort(chartRects.begin(), chartRects.end(), CompareRectHeight);
+        GPP::Real shelfWidth = sqrt(packedArea);
+        shelfWidth = shelfWidth > maxWidth ? shelfWidth : maxWidth;
+        texCoords.resize(texOffsets.at(chartCount) * 2);
+        faceTexIds.resize(mTriangleCount * 3);
+        GPP::Real cursorX = 0;
+        GPP::Real shelfY = 0;
+        GPP::Real shelfHeight = 0;
+        for (std::vector<ChartRect>::iterator itr = chartRects.begin(); itr != chartRects.end(); ++itr)
+        {
+            if (cursorX > 0 && cursorX + itr->width > shelfWidth)
+            {
+                cursorX = 0;
+                shelfY += shelfHeight;
+                shelfHeight = 0;
+            }
+            const UVChart* chart = mCharts.at(itr->chartId);
+            GPP::Int texOffset = texOffsets.at(itr->chartId);
+            GPP::Int texCount = chart->texCoords.size() / 2;
+            for (GPP::Int tid = 0; tid < texCount; tid++)
+            {
+                texCoords.at((texOffset + tid) * 2) = (chart->texCoords.at(tid * 2) - itr->minCoord[0]) * itr->scale + cursorX;
+                texCoords.at((texOffset + tid) * 2 + 1) = (chart->texCoords.at(tid * 2 + 1) - itr->minCoord[1]) * itr->scale + shelfY;
+            }
+            GPP::Int faceCount = chart->triangleIds.size();
+            for (GPP::Int localFid = 0; localFid < faceCount; localFid++)
+            {
+                GPP::Int fid = chart->triangleIds.at(localFid);
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    faceTexIds.at(fid * 3 + localId) = texOffset + chart->faceTexIds.at(localFid * 3 + localId);
+                }
+            }
+            cursorX += itr->width;
+            shelfHeight = itr->height > shelfHeight ? itr->height : shelfHeight;
+        }
+        return GPP_NO_ERROR;
+    }
+}
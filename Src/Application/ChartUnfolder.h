@@ -0,0 +1,80 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // A connected part of the split mesh
+    struct UVChart
+    {
+        UVChart();
+        ~UVChart();
+
+        // Triangle ids of the split mesh
+        std::vector<GPP::Int> triangleIds;
+        // Vertex ids of the split mesh, indexed by local vertex id of chartMesh
+        std::vector<GPP::Int> vertexIds;
+        // Owned by the chart
+        GPP::TriMesh* chartMesh;
+        GPP::Real area;
+        // Two values per texture vertex
+        std::vector<GPP::Real> texCoords;
+        // Texture vertex ids of the chart triangle corners, three per triangle
+        std::vector<GPP::Int> faceTexIds;
+        // texCoords are indexed by local vertex id of chartMesh, false for the atlas solutions
+        bool hasVertexTexCoords;
+        GPP::ErrorCode result;
+        // Hash of the chart mesh, equal charts of two split meshes have equal signatures
+        GPP::ULongInt signature;
+        bool isAtlas;
+        // Unchanged chart of the last solve, -1 if there is none
+        GPP::Int previousChartId;
+    };
+
+    // A vertex of the charts of the last solve, sorted by coordHash
+    struct PreviousChartVertex
+    {
+        GPP::ULongInt coordHash;
+        GPP::Int chartId;
+        GPP::Int localVertexId;
+    };
+
+    // Splits a mesh into connected charts and parameterizes every chart on its own worker of ThreadPool,
+    // then packs the charts into one atlas. Output is in the format of GPP::UnfoldMesh::GenerateUVAtlas.
+    // Charts of the last UnfoldCharts are kept by the next Init. When the mesh is split further by new cut lines,
+    // unchanged charts reuse their previous solution, and charts cut from a previous chart start the isometric
+    // optimization from its texture coordinates instead of a new conformal map. Only previous charts with
+    // hasVertexTexCoords are used for warm start.
+    class ChartUnfolder
+    {
+    public:
+        ChartUnfolder();
+        ~ChartUnfolder();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh);
+        GPP::Int GetChartCount(void) const;
+        // Clear the charts and the kept solution
+        void Clear(void);
+
+        // Conformal map with isometric optimization. A chart without boundary is unfolded by a one chart atlas.
+        GPP::ErrorCode UnfoldCharts(GPP::Int isometricIterationCount);
+        // Atlas of each chart, initChartCount is distributed to the charts by area
+        GPP::ErrorCode GenerateChartAtlas(GPP::Int initChartCount, bool needSplitFoldOver, bool needSplitOverlap);
+
+        // Charts are scaled to the same texel density and packed row by row
+        GPP::ErrorCode PackCharts(std::vector<GPP::Real>& texCoords, std::vector<GPP::Int>& faceTexIds) const;
+
+    private:
+        // isAtlas == false: parameter is isometricIterationCount, otherwise initChartCount
+        GPP::ErrorCode RunCharts(bool isAtlas, GPP::Int parameter, bool needSplitFoldOver, bool needSplitOverlap);
+        void MatchPreviousCharts(void);
+        void ReleaseCharts(std::vector<UVChart*>& charts);
+
+    private:
+        std::vector<UVChart*> mCharts;
+        std::vector<UVChart*> mPreviousCharts;
+        std::vector<PreviousChartVertex> mPreviousVertices;
+        GPP::Int mTriangleCount;
+        GPP::Real mArea;
+    };
+}
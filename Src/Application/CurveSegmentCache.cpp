@@ -0,0 +1,138 @@
+#include "CurveSegmentCache.h"
+
+namespace MagicApp
+{
+    // Pieces of dropped marks are kept until the cache grows over this count
+    static const GPP::Int gMaxSegmentCount = 4096;
+
+    CurveSegmentKey::CurveSegmentKey() :
+        mCurveType(0),
+        mParameter(0)
+    {
+        mVertexIds[0] = mVertexIds[1] = -1;
+        mFaceIds[0] = mFaceIds[1] = -1;
+    }
+
+    CurveSegmentKey::CurveSegmentKey(int curveType, GPP::Real parameter, GPP::Int startVertexId, GPP::Int endVertexId) :
+        mCurveType(curveType),
+        mParameter(parameter)
+    {
+        mVertexIds[0] = startVertexId;
+        mVertexIds[1] = endVertexId;
+        mFaceIds[0] = mFaceIds[1] = -1;
+    }
+
+    CurveSegmentKey::CurveSegmentKey(int curveType, GPP::Real parameter, const GPP::PointOnFace& startPof, const GPP::PointOnFace& endPof) :
+        mCurveType(curveType),
+        mParameter(parameter)
+    {
+        mVertexIds[0] = mVertexIds[1] = -1;
+        mFaceIds[0] = startPof.mFaceId;
+        mFaceIds[1] = endPof.mFaceId;
+        mCoords[0] = startPof.mCoord;
+        mCoords[1] = endPof.mCoord;
+    }
+
+    bool CurveSegmentKey::operator < (const CurveSegmentKey& key) const
+    {
+        if (mCurveType != key.mCurveType)
+        {
+            return mCurveType < key.mCurveType;
+        }
+        if (mParameter != key.mParameter)
+        {
+            return mParameter < key.mParameter;
+        }
+        for (int eid = 0; eid < 2; eid++)
+        {
+            if (mVertexIds[eid] != key.mVertexIds[eid])
+            {
+                return mVertexIds[eid] < key.mVertexIds[eid];
+            }
+            if (mFaceIds[eid] != key.mFaceIds[eid])
+            {
+                return mFaceIds[eid] < key.mFaceIds[eid];
+            }
+            for (int cid = 0; cid < 3; cid++)
+            {
+                if (mCoords[eid][cid] != key.mCoords[eid][cid])
+                {
+                    return mCoords[eid][cid] < key.mCoords[eid][cid];
+                }
+            }
+        }
+        return false;
+    }
+
+    CurveSegmentCache::CurveSegmentCache() :
+        mpTriMesh(NULL),
+        mMeshGeneration(-1),
+        mSegments()
+    {
+    }
+
+    CurveSegmentCache::~CurveSegmentCache()
+    {
+    }
+
+    void CurveSegmentCache::SetMesh(const GPP::ITriMesh* triMesh, GPP::Int meshGeneration)
+    {
+        if (triMesh != mpTriMesh || meshGeneration != mMeshGeneration)
+        {
+            mSegments.clear();
+            mpTriMesh = triMesh;
+            mMeshGeneration = meshGeneration;
+        }
+    }
+
+    const CurveSegment* CurveSegmentCache::Find(const CurveSegmentKey& key) const
+    {
+        std::map<CurveSegmentKey, CurveSegment>::const_iterator itr = mSegments.find(key);
+        if (itr == mSegments.end())
+        {
+            return NULL;
+        }
+        return &(itr->second);
+    }
+
+    void CurveSegmentCache::Insert(const CurveSegmentKey& key, const CurveSegment& segment)
+    {
+        if (GPP::Int(mSegments.size()) >= gMaxSegmentCount)
+        {
+            mSegments.clear();
+        }
+        mSegments[key] = segment;
+    }
+
+    GPP::Int CurveSegmentCache::GetSegmentCount() const
+    {
+        return mSegments.size();
+    }
+
+    void CurveSegmentCache::Clear()
+    {
+        mSegments.clear();
+        mpTriMesh = NULL;
+        mMeshGeneration = -1;
+    }
+
+    void CurveSegmentCache::JoinSegment(const CurveSegment& segment, CurveSegment& curve)
+    {
+        GPP::Int pointCount = segment.mPathCoords.size();
+        GPP::Int startId = 0;
+        if (pointCount > 0 && !curve.mPathCoords.empty() &&
+            (curve.mPathCoords.back() - segment.mPathCoords.front()).Length() < GPP::REAL_TOL)
+        {
+            startId = 1;
+        }
+        curve.mPathCoords.insert(curve.mPathCoords.end(), segment.mPathCoords.begin() + startId, segment.mPathCoords.end());
+        if (GPP::Int(segment.mPathPofs.size()) == pointCount)
+        {
+            curve.mPathPofs.insert(curve.mPathPofs.end(), segment.mPathPofs.begin() + startId, segment.mPathPofs.end());
+        }
+        if (GPP::Int(segment.mPathVertexIds.size()) == pointCount)
+        {
+            curve.mPathVertexIds.insert(curve.mPathVertexIds.end(), segment.mPathVertexIds.begin() + startId, segment.mPathVertexIds.end());
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+#include <map>
+
+namespace MagicApp
+{
+    enum CurveSegmentType
+    {
+        CURVE_SECTION = 0,
+        CURVE_FACE_POINT,
+        CURVE_APPROXIMATE_GEODESICS,
+        CURVE_FAST_EXACT_GEODESICS,
+        CURVE_EXACT_GEODESICS
+    };
+
+    // Key of the curve piece between two adjacent marks. Vertex marks have face id -1.
+    // parameter is the option of the curve type which changes the piece, like the geodesic accuracy
+    struct CurveSegmentKey
+    {
+        CurveSegmentKey();
+        CurveSegmentKey(int curveType, GPP::Real parameter, GPP::Int startVertexId, GPP::Int endVertexId);
+        CurveSegmentKey(int curveType, GPP::Real parameter, const GPP::PointOnFace& startPof, const GPP::PointOnFace& endPof);
+        bool operator < (const CurveSegmentKey& key) const;
+
+        int mCurveType;
+        GPP::Real mParameter;
+        GPP::Int mVertexIds[2];
+        GPP::Int mFaceIds[2];
+        GPP::Vector3 mCoords[2];
+    };
+
+    // Polyline of a curve piece. mPathCoords is always filled, mPathPofs and mPathVertexIds are filled by
+    // the curve types which need them and have the same size as mPathCoords then.
+    struct CurveSegment
+    {
+        std::vector<GPP::PointOnFace> mPathPofs;
+        std::vector<GPP::Vector3> mPathCoords;
+        std::vector<GPP::Int> mPathVertexIds;
+    };
+
+    // Curve pieces of the last computations. A piece is dropped when the edit generation of the mesh changes,
+    // so adding or moving a mark only solves the pieces next to it.
+    class CurveSegmentCache
+    {
+    public:
+        CurveSegmentCache();
+        ~CurveSegmentCache();
+
+        // Drop all pieces if triMesh or its generation is not the cached one
+        void SetMesh(const GPP::ITriMesh* triMesh, GPP::Int meshGeneration);
+        // NULL if it is not cached
+        const CurveSegment* Find(const CurveSegmentKey& key) const;
+        void Insert(const CurveSegmentKey& key, const CurveSegment& segment);
+        GPP::Int GetSegmentCount(void) const;
+        void Clear(void);
+
+        // Append segment to curve, its first point is skipped if it coincides with the last point of curve
+        static void JoinSegment(const CurveSegment& segment, CurveSegment& curve);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mMeshGeneration;
+        std::map<CurveSegmentKey, CurveSegment> mSegments;
+    };
+}
@@ -0,0 +1,285 @@
+#include "DeformProxy.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/MeshQueryEngine.h"
+#include "../Common/LogSystem.h"
+#include <cfloat>
+#include <cmath>
+
+namespace MagicApp
+{
+    class ProxyBindTask : public MagicCore::ParallelTask
+    {
+    public:
+        ProxyBindTask(const GPP::TriMesh* proxyMesh, const std::vector<GPP::Int>* faceIds,
+            const std::vector<GPP::Vector3>* projectCoords, std::vector<GPP::Int>* bindVertexIds, std::vector<GPP::Real>* bindWeights) :
+            mpProxyMesh(proxyMesh),
+            mpFaceIds(faceIds),
+            mpProjectCoords(projectCoords),
+            mpBindVertexIds(bindVertexIds),
+            mpBindWeights(bindWeights)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Int faceId = (*mpFaceIds)[vid];
+                GPP::Int* vertexIds = &((*mpBindVertexIds)[vid * 3]);
+                GPP::Real* weights = &((*mpBindWeights)[vid * 3]);
+                if (faceId < 0)
+                {
+                    vertexIds[0] = vertexIds[1] = vertexIds[2] = 0;
+                    weights[0] = weights[1] = weights[2] = 0;
+                    continue;
+                }
+                mpProxyMesh->GetTriangleVertexIds(faceId, vertexIds);
+                // Barycentric coordinates of the projected point
+                GPP::Vector3 v0 = mpProxyMesh->GetVertexCoord(vertexIds[0]);
+                GPP::Vector3 edge0 = mpProxyMesh->GetVertexCoord(vertexIds[1]) - v0;
+                GPP::Vector3 edge1 = mpProxyMesh->GetVertexCoord(vertexIds[2]) - v0;
+                GPP::Vector3 delta = (*mpProjectCoords)[vid] - v0;
+                GPP::Real d00 = edge0 * edge0;
+                GPP::Real d01 = edge0 * edge1;
+                GPP::Real d11 = edge1 * edge1;
+                GPP::Real d20 = delta * edge0;
+                GPP::Real d21 = delta * edge1;
+                GPP::Real denom = d00 * d11 - d01 * d01;
+                if (fabs(denom) < GPP::REAL_TOL * GPP::REAL_TOL)
+                {
+                    weights[0] = 1;
+                    weights[1] = weights[2] = 0;
+                    continue;
+                }
+                weights[1] = (d11 * d20 - d01 * d21) / denom;
+                weights[2] = (d00 * d21 - d01 * d20) / denom;
+                weights[0] = 1.0 - weights[1] - weights[2];
+            }
+        }
+
+    private:
+        const GPP::TriMesh* mpProxyMesh;
+        const std::vector<GPP::Int>* mpFaceIds;
+        const std::vector<GPP::Vector3>* mpProjectCoords;
+        std::vector<GPP::Int>* mpBindVertexIds;
+        std::vector<GPP::Real>* mpBindWeights;
+    };
+
+    class ProxyTransferTask : public MagicCore::ParallelTask
+    {
+    public:
+        ProxyTransferTask(const std::vector<GPP::Vector3>* proxyDisplacements, const std::vector<GPP::Vector3>* restCoords,
+            const std::vector<GPP::Int>* bindVertexIds, const std::vector<GPP::Real>* bindWeights, GPP::TriMesh* triMesh) :
+            mpProxyDisplacements(proxyDisplacements),
+            mpRestCoords(restCoords),
+            mpBindVertexIds(bindVertexIds),
+            mpBindWeights(bindWeights),
+            mpTriMesh(triMesh)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            const GPP::Int* vertexIds = &((*mpBindVertexIds)[startId * 3]);
+            const GPP::Real* weights = &((*mpBindWeights)[startId * 3]);
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Vector3 coord = (*mpRestCoords)[vid] + (*mpProxyDisplacements)[vertexIds[0]] * weights[0] +
+                    (*mpProxyDisplacements)[vertexIds[1]] * weights[1] + (*mpProxyDisplacements)[vertexIds[2]] * weights[2];
+                mpTriMesh->SetVertexCoord(vid, coord);
+                vertexIds += 3;
+                weights += 3;
+            }
+        }
+
+    private:
+        const std::vector<GPP::Vector3>* mpProxyDisplacements;
+        const std::vector<GPP::Vector3>* mpRestCoords;
+        const std::vector<GPP::Int>* mpBindVertexIds;
+        const std::vector<GPP::Real>* mpBindWeights;
+        GPP::TriMesh* mpTriMesh;
+    };
+
+    DeformProxy::DeformProxy() :
+        mpSourceMesh(NULL),
+        mpProxyMesh(NULL),
+        mRestCoords(),
+        mProxyRestCoords(),
+        mBindVertexIds(),
+        mBindWeights()
+    {
+    }
+
+    DeformProxy::~DeformProxy()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode DeformProxy::Build(const GPP::TriMesh* triMesh, GPP::Int targetVertexCount)
+    {
+        Clear();
+        if (triMesh == NULL || targetVertexCount < 4)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int faceCount = triMesh->GetTriangleCount();
+        mpProxyMesh = new GPP::TriMesh;
+        mRestCoords.resize(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            mRestCoords.at(vid) = triMesh->GetVertexCoord(vid);
+            mpProxyMesh->InsertVertex(mRestCoords.at(vid));
+        }
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            mpProxyMesh->InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+        }
+        GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(mpProxyMesh, targetVertexCount);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+            return res;
+        }
+        mpProxyMesh->UpdateNormal();
+        GPP::Int proxyVertexCount = mpProxyMesh->GetVertexCount();
+        mProxyRestCoords.resize(proxyVertexCount);
+        for (GPP::Int vid = 0; vid < proxyVertexCount; vid++)
+        {
+            mProxyRestCoords.at(vid) = mpProxyMesh->GetVertexCoord(vid);
+        }
+
+        MagicCore::MeshQueryEngine queryEngine;
+        res = queryEngine.Init(mpProxyMesh);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+            return res;
+        }
+        std::vector<GPP::Int> faceIds;
+        std::vector<GPP::Vector3> projectCoords;
+        queryEngine.QueryNearestTriangles(mRestCoords, DBL_MAX, &faceIds, NULL, &projectCoords);
+        mBindVertexIds.resize(vertexCount * 3);
+        mBindWeights.resize(vertexCount * 3);
+        ProxyBindTask bindTask(mpProxyMesh, &faceIds, &projectCoords, &mBindVertexIds, &mBindWeights);
+        MagicCore::ThreadPool::Get()->ParallelFor(vertexCount, &bindTask, 4096);
+        mpSourceMesh = triMesh;
+        InfoLog << "DeformProxy::Build vertexCount=" << vertexCount << " proxyVertexCount=" << proxyVertexCount << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    bool DeformProxy::IsBuilt(const GPP::TriMesh* triMesh) const
+    {
+        return triMesh != NULL && triMesh == mpSourceMesh && mpProxyMesh != NULL && triMesh->GetVertexCount() == mRestCoords.size();
+    }
+
+    void DeformProxy::Clear()
+    {
+        mpSourceMesh = NULL;
+        GPPFREEPOINTER(mpProxyMesh);
+        mRestCoords.clear();
+        mProxyRestCoords.clear();
+        mBindVertexIds.clear();
+        mBindWeights.clear();
+    }
+
+    GPP::TriMesh* DeformProxy::GetProxyMesh()
+    {
+        return mpProxyMesh;
+    }
+
+    GPP::Int DeformProxy::MapVertex(GPP::Int vertexId) const
+    {
+        if (vertexId < 0 || vertexId * 3 >= mBindVertexIds.size())
+        {
+            return -1;
+        }
+        int maxIndex = 0;
+        for (int localId = 1; localId < 3; localId++)
+        {
+            if (mBindWeights.at(vertexId * 3 + localId) > mBindWeights.at(vertexId * 3 + maxIndex))
+            {
+                maxIndex = localId;
+            }
+        }
+        return mBindVertexIds.at(vertexId * 3 + maxIndex);
+    }
+
+    GPP::Vector3 DeformProxy::MapTargetCoord(GPP::Int vertexId, const GPP::Vector3& targetCoord) const
+    {
+        GPP::Int proxyId = MapVertex(vertexId);
+        if (proxyId < 0)
+        {
+            return targetCoord;
+        }
+        return targetCoord + mProxyRestCoords.at(proxyId) - mRestCoords.at(vertexId);
+    }
+
+    void DeformProxy::MapFixFlags(const std::vector<bool>& vertexFixFlags, std::vector<bool>& proxyFixFlags) const
+    {
+        proxyFixFlags.clear();
+        proxyFixFlags.resize(mProxyRestCoords.size(), false);
+        GPP::Int vertexCount = vertexFixFlags.size() < mRestCoords.size() ? vertexFixFlags.size() : mRestCoords.size();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            if (vertexFixFlags.at(vid))
+            {
+                proxyFixFlags.at(MapVertex(vid)) = true;
+            }
+        }
+    }
+
+    void DeformProxy::TransferDisplacement(GPP::TriMesh* triMesh) const
+    {
+        if (!IsBuilt(triMesh))
+        {
+            return;
+        }
+        GPP::Int proxyVertexCount = mProxyRestCoords.size();
+        std::vector<GPP::Vector3> proxyDisplacements(proxyVertexCount);
+        for (GPP::Int vid = 0; vid < proxyVertexCount; vid++)
+        {
+            proxyDisplacements.at(vid) = mpProxyMesh->GetVertexCoord(vid) - mProxyRestCoords.at(vid);
+        }
+        ProxyTransferTask transferTask(&proxyDisplacements, &mRestCoords, &mBindVertexIds, &mBindWeights, triMesh);
+        MagicCore::ThreadPool::Get()->ParallelFor(triMesh->GetVertexCount(), &transferTask, 4096);
+    }
+
+    void DeformProxy::RestoreRestPose(GPP::TriMesh* triMesh)
+    {
+        if (!IsBuilt(triMesh))
+        {
+            return;
+        }
+        GPP::Int vertexCount = mRestCoords.size();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->SetVertexCoord(vid, mRestCoords.at(vid));
+        }
+        GPP::Int proxyVertexCount = mProxyRestCoords.size();
+        for (GPP::Int vid = 0; vid < proxyVertexCount; vid++)
+        {
+            mpProxyMesh->SetVertexCoord(vid, mProxyRestCoords.at(vid));
+        }
+    }
+
+    void DeformProxy::ResetRestPose(const GPP::TriMesh* triMesh)
+    {
+        if (!IsBuilt(triMesh))
+        {
+            return;
+        }
+        GPP::Int vertexCount = mRestCoords.size();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            mRestCoords.at(vid) = triMesh->GetVertexCoord(vid);
+        }
+        GPP::Int proxyVertexCount = mProxyRestCoords.size();
+        for (GPP::Int vid = 0; vid < proxyVertexCount; vid++)
+        {
+            mpProxyMesh->SetVertexCoord(vid, mProxyRestCoords.at(vid));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Low resolution proxy of a big mesh for interactive deformation.
+    // Proxy is a quadric simplified copy; every vertex of the source mesh is bound to its nearest proxy triangle with
+    // barycentric weights, and proxy displacement is transferred back by a parallel gather over these weights.
+    class DeformProxy
+    {
+    public:
+        DeformProxy();
+        ~DeformProxy();
+
+        // Current coordinates of triMesh are the rest pose
+        GPP::ErrorCode Build(const GPP::TriMesh* triMesh, GPP::Int targetVertexCount);
+        // Whether it is built from triMesh and the vertex count is unchanged
+        bool IsBuilt(const GPP::TriMesh* triMesh) const;
+        void Clear(void);
+
+        GPP::TriMesh* GetProxyMesh(void);
+        // Proxy vertex which has the largest binding weight of the source vertex
+        GPP::Int MapVertex(GPP::Int vertexId) const;
+        // Target of the mapped proxy vertex, keeps its rest offset to the source vertex
+        GPP::Vector3 MapTargetCoord(GPP::Int vertexId, const GPP::Vector3& targetCoord) const;
+        // A proxy vertex is fixed if any source vertex mapped to it is fixed
+        void MapFixFlags(const std::vector<bool>& vertexFixFlags, std::vector<bool>& proxyFixFlags) const;
+
+        // triMesh = rest + sum(weight * proxy displacement)
+        void TransferDisplacement(GPP::TriMesh* triMesh) const;
+        // Reset triMesh and proxy mesh to the rest pose
+        void RestoreRestPose(GPP::TriMesh* triMesh);
+        // Current coordinates of triMesh become the rest pose, e.g. after a full resolution solve is committed.
+        // The proxy mesh goes back to its rest pose, so later proxy displacement is added to the committed shape.
+        void ResetRestPose(const GPP::TriMesh* triMesh);
+
+    private:
+        const GPP::TriMesh* mpSourceMesh;
+        GPP::TriMesh* mpProxyMesh;
+        std::vector<GPP::Vector3> mRestCoords;
+        std::vector<GPP::Vector3> mProxyRestCoords;
+        // 3 proxy vertices and weights per source vertex
+        std::vector<GPP::Int> mBindVertexIds;
+        std::vector<GPP::Real> mBindWeights;
+    };
+}
@@ -0,0 +1,180 @@
+#include "DeformSession.h"
+#include "DeformProxy.h"
+
+namespace MagicApp
+{
+    class DeformSolveTask : public MagicCore::ThreadTask
+    {
+    public:
+        DeformSolveTask() :
+            mpDeformMesh(NULL),
+            mpDeformPointList(NULL),
+            mpTriMesh(NULL),
+            mpDeformProxy(NULL),
+            mpControlFixFlags(NULL),
+            mTargetIds(),
+            mTargetCoords(),
+            mIsAccurate(false),
+            mResult(GPP_NO_ERROR)
+        {
+        }
+
+        virtual void Run(void)
+        {
+            if (mpDeformPointList)
+            {
+                mResult = mpDeformPointList->Deform(mTargetIds, mTargetCoords, *mpControlFixFlags);
+            }
+            else if (mpDeformMesh)
+            {
+                mResult = mpDeformMesh->Deform(mTargetIds, mTargetCoords,
+                    mIsAccurate ? GPP::DEFORM_MESH_TYPE_ACCURATE : GPP::DEFORM_MESH_TYPE_FAST);
+                if (mResult == GPP_NO_ERROR && mpTriMesh)
+                {
+                    if (mpDeformProxy)
+                    {
+                        mpDeformProxy->TransferDisplacement(mpTriMesh);
+                    }
+                    mpTriMesh->UpdateNormal();
+                }
+            }
+            else
+            {
+                mResult = GPP_INVALID_INPUT;
+            }
+        }
+
+        GPP::DeformMesh* mpDeformMesh;
+        GPP::DeformPointList* mpDeformPointList;
+        GPP::TriMesh* mpTriMesh;
+        DeformProxy* mpDeformProxy;
+        const std::vector<bool>* mpControlFixFlags;
+        std::vector<GPP::Int> mTargetIds;
+        std::vector<GPP::Vector3> mTargetCoords;
+        bool mIsAccurate;
+        GPP::ErrorCode mResult;
+    };
+
+    DeformSession::DeformSession() :
+        mpSolveTask(new DeformSolveTask),
+        mSolveGroup(),
+        mIsSolving(false),
+        mHasResult(false),
+        mHasPending(false),
+        mPendingIds(),
+        mPendingCoords(),
+        mPendingAccurate(false),
+        mControlFixFlags()
+    {
+    }
+
+    DeformSession::~DeformSession()
+    {
+        Wait();
+        GPPFREEPOINTER(mpSolveTask);
+    }
+
+    void DeformSession::Setup(GPP::DeformMesh* deformMesh, GPP::DeformPointList* deformPointList, GPP::TriMesh* triMesh,
+        DeformProxy* deformProxy)
+    {
+        Reset();
+        mpSolveTask->mpDeformMesh = deformMesh;
+        mpSolveTask->mpDeformPointList = deformPointList;
+        mpSolveTask->mpTriMesh = triMesh;
+        mpSolveTask->mpDeformProxy = deformProxy;
+        mpSolveTask->mpControlFixFlags = &mControlFixFlags;
+    }
+
+    void DeformSession::SetControlFlags(const std::vector<int>& controlFlags)
+    {
+        Wait();
+        mControlFixFlags.clear();
+        mControlFixFlags.reserve(controlFlags.size());
+        for (std::vector<int>::const_iterator itr = controlFlags.begin(); itr != controlFlags.end(); ++itr)
+        {
+            mControlFixFlags.push_back(*itr == 1);
+        }
+    }
+
+    void DeformSession::RequestDeform(const std::vector<GPP::Int>& targetIds, const std::vector<GPP::Vector3>& targetCoords,
+        bool isAccurate)
+    {
+        mPendingIds = targetIds;
+        mPendingCoords = targetCoords;
+        // An accurate request is not downgraded by a later fast one before it runs
+        mPendingAccurate = isAccurate || (mHasPending && mPendingAccurate);
+        mHasPending = true;
+        if (!mIsSolving && !mHasResult)
+        {
+            Continue();
+        }
+    }
+
+    bool DeformSession::FetchResult(GPP::ErrorCode* res)
+    {
+        if (mIsSolving && mSolveGroup.IsFinished())
+        {
+            mIsSolving = false;
+            mHasResult = true;
+        }
+        if (!mHasResult)
+        {
+            return false;
+        }
+        mHasResult = false;
+        if (res)
+        {
+            *res = mpSolveTask->mResult;
+        }
+        if (mpSolveTask->mResult != GPP_NO_ERROR)
+        {
+            mHasPending = false;
+        }
+        return true;
+    }
+
+    bool DeformSession::IsSolving() const
+    {
+        return mIsSolving && !mSolveGroup.IsFinished();
+    }
+
+    bool DeformSession::IsBusy() const
+    {
+        return mIsSolving || mHasResult || mHasPending;
+    }
+
+    void DeformSession::Wait()
+    {
+        mHasPending = false;
+        if (mIsSolving)
+        {
+            MagicCore::ThreadPool::Get()->Wait(&mSolveGroup);
+            mIsSolving = false;
+            mHasResult = true;
+        }
+    }
+
+    void DeformSession::Reset()
+    {
+        Wait();
+        mHasResult = false;
+        mPendingIds.clear();
+        mPendingCoords.clear();
+        mPendingAccurate = false;
+    }
+
+    void DeformSession::Continue()
+    {
+        if (!mHasPending || mIsSolving || mHasResult)
+        {
+            return;
+        }
+        mpSolveTask->mTargetIds.swap(mPendingIds);
+        mpSolveTask->mTargetCoords.swap(mPendingCoords);
+        mpSolveTask->mIsAccurate = mPendingAccurate;
+        mHasPending = false;
+        mPendingAccurate = false;
+        mIsSolving = true;
+        MagicCore::ThreadPool::Get()->Submit(mpSolveTask, &mSolveGroup);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "GPP.h"
+#include "../Common/ThreadPool.h"
+#include <vector>
+
+namespace MagicApp
+{
+    class DeformSolveTask;
+    class DeformProxy;
+
+    // Runs DeformMesh / DeformPointList solves of a drag on a pool thread.
+    // Requests are coalesced: only the latest target waits while a solve is running, older ones are dropped.
+    // Every solve starts from the previous result, so successive drag solves are warm started.
+    // All functions should be called from the main thread. A finished solve is not followed by the next one
+    // until its result is fetched and Continue is called, so the main thread could render the model in between.
+    class DeformSession
+    {
+    public:
+        DeformSession();
+        ~DeformSession();
+
+        // deformMesh or deformPointList should be initialized already. triMesh is used to update normal after solve.
+        // If deformProxy is given, deformMesh works on its proxy mesh and the displacement is transferred to triMesh.
+        void Setup(GPP::DeformMesh* deformMesh, GPP::DeformPointList* deformPointList, GPP::TriMesh* triMesh,
+            DeformProxy* deformProxy = NULL);
+        // Fix flags of DeformPointList are built here once for the control set, not for every solve
+        void SetControlFlags(const std::vector<int>& controlFlags);
+
+        void RequestDeform(const std::vector<GPP::Int>& targetIds, const std::vector<GPP::Vector3>& targetCoords, bool isAccurate);
+        // Return true if a solve has finished since last fetch, res is its result
+        bool FetchResult(GPP::ErrorCode* res);
+        // Start the pending request. Call it after the fetched result is rendered.
+        void Continue(void);
+
+        bool IsSolving(void) const;
+        bool IsBusy(void) const;
+        // Block until the running solve is finished, pending request is dropped
+        void Wait(void);
+        void Reset(void);
+
+    private:
+        DeformSolveTask* mpSolveTask;
+        MagicCore::TaskGroup mSolveGroup;
+        bool mIsSolving;
+        bool mHasResult;
+        bool mHasPending;
+        std::vector<GPP::Int> mPendingIds;
+        std::vector<GPP::Vector3> mPendingCoords;
+        bool mPendingAccurate;
+        std::vector<bool> mControlFixFlags;
+    };
+}
@@ -6,10 +6,17 @@
 #include "../Common/ToolKit.h"
 #include "../Common/RenderSystem.h"
 #include "../Common/ViewTool.h"
+#include "../Common/DepthStreamReader.h"
 #include "AppManager.h"
 
 namespace MagicApp
 {
+    // A producer like a sensor driver writes frames into this pipe
+    static const char* gLiveDepthStreamName = "\\\\.\\pipe\\MagicDepth";
+    static const int gStreamQueueCapacity = 8;
+    static const int gStreamGroupSize = 25;
+    static const int gMinStreamPointCount = 10000;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         DepthVideoApp* app = (DepthVideoApp*)arg;
@@ -24,6 +31,7 @@ namespace MagicApp
     DepthVideoApp::DepthVideoApp() :
         mpUI(NULL),
         mpViewTool(NULL),
+        mpDepthStreamReader(NULL),
         mCommandType(CT_NONE),
         mPointCloudList(),
         mObjCenterCoord(),
@@ -41,6 +49,7 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpDepthStreamReader);
     }
 
     bool DepthVideoApp::Enter(void)
@@ -133,6 +142,18 @@ namespace MagicApp
 
     bool DepthVideoApp::KeyPressed( const OIS::KeyEvent &arg )
     {
+        if (arg.key == OIS::KC_R && mIsCommandInProgress == false)
+        {
+            AlignDepthStream(false);
+        }
+        else if (arg.key == OIS::KC_L && mIsCommandInProgress == false)
+        {
+            AlignDepthStream(true);
+        }
+        else if (arg.key == OIS::KC_S)
+        {
+            StopDepthStream();
+        }
         return true;
     }
 
@@ -197,6 +218,12 @@ namespace MagicApp
             case MagicApp::DepthVideoApp::CT_ALIGN_POINTCLOUD:
                 AlignPointCloudList(mGroupSize, false);
                 break;
+            case MagicApp::DepthVideoApp::CT_ALIGN_RECORDED_STREAM:
+                AlignDepthStream(false, false);
+                break;
+            case MagicApp::DepthVideoApp::CT_ALIGN_LIVE_STREAM:
+                AlignDepthStream(true, false);
+                break;
             default:
                 break;
             }
@@ -245,6 +272,119 @@ namespace MagicApp
         }
     }
 
+    bool DepthVideoApp::AlignToLastPointCloud(const GPP::PointCloud* lastPointCloud, GPP::PointCloud* curPointCloud, 
+        GPP::Matrix4x4& transformAcc, int frameId)
+    {
+        int curPointCount = curPointCloud->GetPointCount();
+        for (int pid = 0; pid < curPointCount; pid++)
+        {
+            curPointCloud->SetPointCoord(pid, transformAcc.TransformPoint(curPointCloud->GetPointCoord(pid)));
+            curPointCloud->SetPointNormal(pid, transformAcc.RotateVector(curPointCloud->GetPointNormal(pid)));
+        }
+
+        GPP::Matrix4x4 transformLocal;
+        transformLocal.InitIdentityTransform();
+        GPP::ErrorCode res = GPP::RegistratePointCloud::AlignPointCloud(lastPointCloud, curPointCloud, &transformLocal, 
+            1000);
+        if (res != GPP_NO_ERROR)
+        {
+            InfoLog << "Point Cloud " << frameId << " AlignPointCloud failed" << std::endl;
+            return false;
+        }
+        for (int pid = 0; pid < curPointCount; pid++)
+        {
+            curPointCloud->SetPointCoord(pid, transformLocal.TransformPoint(curPointCloud->GetPointCoord(pid)));
+            curPointCloud->SetPointNormal(pid, transformLocal.RotateVector(curPointCloud->GetPointNormal(pid)));
+        }
+        GPP::Matrix4x4 icpLocal;
+        icpLocal.InitIdentityTransform();
+        res = GPP::RegistratePointCloud::ICPRegistrate(lastPointCloud, NULL, curPointCloud, NULL, 
+            &icpLocal, NULL, true);
+        if (res != GPP_NO_ERROR)
+        {
+            InfoLog << "Point Cloud " << frameId << " ICPRegistrate failed" << std::endl;
+            return false;
+        }
+        for (int pid = 0; pid < curPointCount; pid++)
+        {
+            curPointCloud->SetPointCoord(pid, icpLocal.TransformPoint(curPointCloud->GetPointCoord(pid)));
+            curPointCloud->SetPointNormal(pid, icpLocal.RotateVector(curPointCloud->GetPointNormal(pid)));
+        }
+        transformLocal = icpLocal * transformLocal;
+        transformAcc = transformLocal * transformAcc;
+        return true;
+    }
+
+    bool DepthVideoApp::FusePointCloudList(const std::vector<GPP::Matrix4x4>& initTransformList, int groupId)
+    {
+        // Global registrate
+        std::vector<GPP::IPointCloud*> pointCloudList;
+        for (std::vector<GPP::PointCloud*>::iterator itr = mPointCloudList.begin(); itr != mPointCloudList.end(); ++itr)
+        {
+            pointCloudList.push_back(*itr);
+        }
+        std::vector<GPP::Matrix4x4> resultTransform;
+        GPP::ErrorCode res = GPP::RegistratePointCloud::GlobalRegistrate(&pointCloudList, 10, &resultTransform, 
+            &initTransformList, true, 0);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
+            return false;
+        }
+
+        int cloudCount = mPointCloudList.size();   
+        // Fuse point cloud
+        GPP::Vector3 bboxMin, bboxMax;
+        res = GPP::CalculatePointCloudListBoundingBox(pointCloudList, &resultTransform, bboxMin, bboxMax);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
+            return false;
+        }
+        GPP::Vector3 deltaVec(0.1, 0.1, 0.1);
+        bboxMin -= deltaVec;
+        bboxMax += deltaVec;
+        GPP::PointCloudPointList pointList(pointCloudList.at(0));
+        double epsilon = 0;
+        res = GPP::CalculatePointListDensity(&pointList, 4, epsilon);
+        int resolutionX = int((bboxMax[0] - bboxMin[0]) / epsilon) + 1;
+        int resolutionY = int((bboxMax[1] - bboxMin[1]) / epsilon) + 1;
+        int resolutionZ = int((bboxMax[2] - bboxMin[2]) / epsilon) + 1;
+        InfoLog << "epsilon=" << epsilon << " resX=" << resolutionX << " resY=" << resolutionY << " resZ=" << resolutionZ << std::endl;
+        GPP::SignedDistanceFunction sdf(resolutionX, resolutionY, resolutionZ, bboxMin, bboxMax);
+        for (int cid = 0; cid < cloudCount; cid++)
+        {
+            //mProgressValue = int(cid * 100.0 / cloudCount);
+            res = sdf.UpdateFunction(pointCloudList.at(cid), &(resultTransform.at(cid)));
+            if (res != GPP_NO_ERROR)
+            {
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                return false;
+            }
+        }
+        GPP::PointCloud* fusedPointCloud = new GPP::PointCloud;
+        res = sdf.ExtractPointCloud(fusedPointCloud);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "点云萃取失败", "温馨提示", MB_OK);
+            return false;
+        }
+        mPointCloudList.push_back(fusedPointCloud);
+        mUpdateUIScrollBar = true;
+        mUpdatePointCloudListRendering = true;
+        // save result
+        std::stringstream outputStream;
+        outputStream << "fuse_res_" << groupId << ".asc";
+        std::string outputModelName;
+        outputStream >> outputModelName;
+        res = GPP::Parser::ExportPointCloud(outputModelName, fusedPointCloud);
+        if (res != GPP_NO_ERROR)
+        {
+            MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
+        }
+        return true;
+    }
+
     void DepthVideoApp::ImportPointCloud(bool isSubThread)
     {
         if (IsCommandAvaliable() == false)
@@ -350,56 +490,12 @@ namespace MagicApp
                         }
                         GPP::PointCloud* originPointCloud = GPP::CopyPointCloud(curPointCloud); 
                         // Align point cloud
-                        if (lastPointCloud != NULL)
+                        if (lastPointCloud != NULL && AlignToLastPointCloud(lastPointCloud, curPointCloud, transformAcc, depthId) == false)
                         {
-                            int curPointCount = curPointCloud->GetPointCount();
-                            for (int pid = 0; pid < curPointCount; pid++)
-                            {
-                                curPointCloud->SetPointCoord(pid, transformAcc.TransformPoint(curPointCloud->GetPointCoord(pid)));
-                                curPointCloud->SetPointNormal(pid, transformAcc.RotateVector(curPointCloud->GetPointNormal(pid)));
-                            }
-
-                            GPP::Matrix4x4 transformLocal;
-                            transformLocal.InitIdentityTransform();
-                            GPP::ErrorCode res = GPP::RegistratePointCloud::AlignPointCloud(lastPointCloud, curPointCloud, &transformLocal, 
-                                1000);
-                            if (res != GPP_NO_ERROR)
-                            {
-                                InfoLog << "Point Cloud " << depthId << " AlignPointCloud failed" << std::endl;
-                                GPPFREEPOINTER(curPointCloud);
-                                GPPFREEPOINTER(originPointCloud);
-                                continue;
-                            }
-                            else
-                            {
-                                for (int pid = 0; pid < curPointCount; pid++)
-                                {
-                                    curPointCloud->SetPointCoord(pid, transformLocal.TransformPoint(curPointCloud->GetPointCoord(pid)));
-                                    curPointCloud->SetPointNormal(pid, transformLocal.RotateVector(curPointCloud->GetPointNormal(pid)));
-                                }
-                                GPP::Matrix4x4 icpLocal;
-                                icpLocal.InitIdentityTransform();
-                                res = GPP::RegistratePointCloud::ICPRegistrate(lastPointCloud, NULL, curPointCloud, NULL, 
-                                    &icpLocal, NULL, true);
-                                if (res == GPP_NO_ERROR)
-                                {
-                                    for (int pid = 0; pid < curPointCount; pid++)
-                                    {
-                                        curPointCloud->SetPointCoord(pid, icpLocal.TransformPoint(curPointCloud->GetPointCoord(pid)));
-                                        curPointCloud->SetPointNormal(pid, icpLocal.RotateVector(curPointCloud->GetPointNormal(pid)));
-                                    }
-                                    transformLocal = icpLocal * transformLocal;
-                                }
-                                else
-                                {
-                                    InfoLog << "Point Cloud " << depthId << " ICPRegistrate failed" << std::endl;
-                                    GPPFREEPOINTER(curPointCloud);
-                                    GPPFREEPOINTER(originPointCloud);
-                                    continue;
-                                }
-                                transformAcc = transformLocal * transformAcc;
-                            }
-                        }  
+                            GPPFREEPOINTER(curPointCloud);
+                            GPPFREEPOINTER(originPointCloud);
+                            continue;
+                        }
                         GPPFREEPOINTER(lastPointCloud);
                         lastPointCloud = curPointCloud;
 
@@ -421,81 +517,137 @@ namespace MagicApp
                     GPPFREEPOINTER(lastPointCloud);
                     if (mPointCloudList.size() < 2)
                     {
-                        MessageBox(NULL, "ʼƴʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "初始拼接失败", "温馨提示", MB_OK);
                         return;
                     }
                     //mProgressValue = -1;
-                    // Global registrate
-                    std::vector<GPP::IPointCloud*> pointCloudList;
-                    for (std::vector<GPP::PointCloud*>::iterator itr = mPointCloudList.begin(); itr != mPointCloudList.end(); ++itr)
-                    {
-                        pointCloudList.push_back(*itr);
-                    }
-                    std::vector<GPP::Matrix4x4> resultTransform;
-                    GPP::ErrorCode res = GPP::RegistratePointCloud::GlobalRegistrate(&pointCloudList, 10, &resultTransform, 
-                        &initTransformList, true, 0);
-                    if (res != GPP_NO_ERROR)
+                    if (FusePointCloudList(initTransformList, groupId) == false)
                     {
-                        MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
                         return;
                     }
+                }
+            }
+            else
+            {
+                InfoLog << "Open file failed" << std::endl;
+            }
+        }
+    }
 
-                    int cloudCount = mPointCloudList.size();   
-                    // Fuse point cloud
-                    GPP::Vector3 bboxMin, bboxMax;
-                    res = GPP::CalculatePointCloudListBoundingBox(pointCloudList, &resultTransform, bboxMin, bboxMax);
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
-                        return;
-                    }
-                    GPP::Vector3 deltaVec(0.1, 0.1, 0.1);
-                    bboxMin -= deltaVec;
-                    bboxMax += deltaVec;
-                    GPP::PointCloudPointList pointList(pointCloudList.at(0));
-                    double epsilon = 0;
-                    res = GPP::CalculatePointListDensity(&pointList, 4, epsilon);
-                    int resolutionX = int((bboxMax[0] - bboxMin[0]) / epsilon) + 1;
-		            int resolutionY = int((bboxMax[1] - bboxMin[1]) / epsilon) + 1;
-		            int resolutionZ = int((bboxMax[2] - bboxMin[2]) / epsilon) + 1;
-                    InfoLog << "epsilon=" << epsilon << " resX=" << resolutionX << " resY=" << resolutionY << " resZ=" << resolutionZ << std::endl;
-                    GPP::SignedDistanceFunction sdf(resolutionX, resolutionY, resolutionZ, bboxMin, bboxMax);
-                    for (int cid = 0; cid < cloudCount; cid++)
-                    {
-                        //mProgressValue = int(cid * 100.0 / cloudCount);
-                        res = sdf.UpdateFunction(pointCloudList.at(cid), &(resultTransform.at(cid)));
-                        if (res != GPP_NO_ERROR)
-                        {
-                            MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
-                            return;
-                        }
-                    }
-                    GPP::PointCloud* fusedPointCloud = new GPP::PointCloud;
-                    res = sdf.ExtractPointCloud(fusedPointCloud);
-                    if (res != GPP_NO_ERROR)
+    void DepthVideoApp::AlignDepthStream(bool isLiveStream, bool isSubThread)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        if (isSubThread)
+        {
+            mCommandType = isLiveStream ? CT_ALIGN_LIVE_STREAM : CT_ALIGN_RECORDED_STREAM;
+            DoCommand(true);
+        }
+        else
+        {
+            std::string streamName;
+            if (isLiveStream)
+            {
+                streamName = gLiveDepthStreamName;
+            }
+            else
+            {
+                char filterName[] = "Depth Stream(*.mds)\0*.mds\0";
+                if (MagicCore::ToolKit::FileOpenDlg(streamName, filterName) == false)
+                {
+                    InfoLog << "Open file failed" << std::endl;
+                    return;
+                }
+            }
+            if (mpDepthStreamReader == NULL)
+            {
+                mpDepthStreamReader = new MagicCore::DepthStreamReader;
+            }
+            if (mpDepthStreamReader->Open(streamName, gStreamQueueCapacity) != GPP_NO_ERROR)
+            {
+                MessageBox(NULL, "深度流打开失败", "温馨提示", MB_OK);
+                return;
+            }
+            mIsCommandInProgress = true;
+            // Frames are aligned in groups like AlignPointCloudList, a group is fused once it is full
+            std::vector<GPP::Matrix4x4> initTransformList;
+            initTransformList.reserve(gStreamGroupSize);
+            GPP::PointCloud* lastPointCloud = NULL;
+            GPP::Matrix4x4 transformAcc;
+            transformAcc.InitIdentityTransform();
+            int groupId = 0;
+            int frameIndex = 0;
+            bool isFuseFailed = false;
+            GPP::PointCloud* curPointCloud = NULL;
+            while ((curPointCloud = mpDepthStreamReader->PopFrame(&frameIndex)) != NULL)
+            {
+                if (curPointCloud->GetPointCount() < gMinStreamPointCount)
+                {
+                    InfoLog << "Depth frame " << frameIndex << " has too few points" << std::endl;
+                    GPPFREEPOINTER(curPointCloud);
+                    continue;
+                }
+                if (initTransformList.empty())
+                {
+                    // The last fused group is shown until the next group starts
+                    ClearPointCloudList();
+                    mSelectCloudIndex = 0;
+                }
+                GPP::PointCloud* originPointCloud = GPP::CopyPointCloud(curPointCloud);
+                if (lastPointCloud != NULL && AlignToLastPointCloud(lastPointCloud, curPointCloud, transformAcc, frameIndex) == false)
+                {
+                    GPPFREEPOINTER(curPointCloud);
+                    GPPFREEPOINTER(originPointCloud);
+                    continue;
+                }
+                GPPFREEPOINTER(lastPointCloud);
+                lastPointCloud = curPointCloud;
+                mPointCloudList.push_back(originPointCloud);
+                initTransformList.push_back(transformAcc);
+                mSelectCloudIndex = mPointCloudList.size() - 1;
+                mProgressValue = int(initTransformList.size() * 100.0 / gStreamGroupSize);
+                mUpdateUIScrollBar = true;
+                mUpdatePointCloudListRendering = true;
+                if (initTransformList.size() >= gStreamGroupSize)
+                {
+                    // A live stream drops frames while the group is fused
+                    if (FusePointCloudList(initTransformList, groupId) == false)
                     {
-                        MessageBox(NULL, "ȡʧ", "ܰʾ", MB_OK);
-                        return;
+                        isFuseFailed = true;
+                        break;
                     }
-                    mPointCloudList.push_back(fusedPointCloud);
-                    mUpdateUIScrollBar = true;
+                    mSelectCloudIndex = mPointCloudList.size() - 1;
                     mUpdatePointCloudListRendering = true;
-                    // save result
-                    std::stringstream outputStream;
-                    outputStream << "fuse_res_" << groupId << ".asc";
-                    std::string outputModelName;
-                    outputStream >> outputModelName;
-                    res = GPP::Parser::ExportPointCloud(outputModelName, fusedPointCloud);
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
-                    }
+                    groupId++;
+                    initTransformList.clear();
+                    GPPFREEPOINTER(lastPointCloud);
+                    transformAcc.InitIdentityTransform();
                 }
             }
-            else
+            GPPFREEPOINTER(lastPointCloud);
+            InfoLog << "AlignDepthStream: groupCount=" << groupId << " readCount=" << mpDepthStreamReader->GetReadCount() 
+                << " droppedCount=" << mpDepthStreamReader->GetDroppedCount() << " decimatedCount=" 
+                << mpDepthStreamReader->GetDecimatedCount() << std::endl;
+            mpDepthStreamReader->Close();
+            if (isFuseFailed == false && initTransformList.size() >= 2)
             {
-                InfoLog << "Open file failed" << std::endl;
+                if (FusePointCloudList(initTransformList, groupId))
+                {
+                    mSelectCloudIndex = mPointCloudList.size() - 1;
+                    mUpdatePointCloudListRendering = true;
+                }
             }
+            mIsCommandInProgress = false;
+        }
+    }
+
+    void DepthVideoApp::StopDepthStream()
+    {
+        if (mpDepthStreamReader != NULL)
+        {
+            mpDepthStreamReader->Stop();
         }
     }
 
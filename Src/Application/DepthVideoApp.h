@@ -5,6 +5,7 @@
 namespace MagicCore
 {
     class ViewTool;
+    class DepthStreamReader;
 }
 
 namespace MagicApp
@@ -16,7 +17,9 @@ namespace MagicApp
         {
             CT_NONE = 0,
             CT_IMPORT_POINTCLOUD,
-            CT_ALIGN_POINTCLOUD
+            CT_ALIGN_POINTCLOUD,
+            CT_ALIGN_RECORDED_STREAM,
+            CT_ALIGN_LIVE_STREAM
         };
 
     public:
@@ -36,6 +39,9 @@ namespace MagicApp
 
         void ImportPointCloud(bool isSubThread = true);
         void AlignPointCloudList(int groupSize, bool isSubThread = true);
+        // Align frames of a recorded depth stream file or of the live pipe stream as they arrive
+        void AlignDepthStream(bool isLiveStream, bool isSubThread = true);
+        void StopDepthStream(void);
 
         void SetPointCloudIndex(int index);
         bool IsCommandInProgress(void);
@@ -45,6 +51,11 @@ namespace MagicApp
         bool IsCommandAvaliable(void);
         void ClearPointCloudList(void);
         void UpdatePointCloudListRendering(void);
+        // curPointCloud is transformed by transformAcc and aligned to lastPointCloud, transformAcc is updated if it succeeds
+        bool AlignToLastPointCloud(const GPP::PointCloud* lastPointCloud, GPP::PointCloud* curPointCloud, 
+            GPP::Matrix4x4& transformAcc, int frameId);
+        // Global registrate and fuse mPointCloudList, the fused point cloud is appended and exported
+        bool FusePointCloudList(const std::vector<GPP::Matrix4x4>& initTransformList, int groupId);
 
     private:
         void SetupScene(void);
@@ -54,6 +65,7 @@ namespace MagicApp
     private:
         DepthVideoAppUI* mpUI;
         MagicCore::ViewTool* mpViewTool;
+        MagicCore::DepthStreamReader* mpDepthStreamReader;
         CommandType mCommandType;
         std::vector<GPP::PointCloud*> mPointCloudList;
         GPP::Vector3 mObjCenterCoord;
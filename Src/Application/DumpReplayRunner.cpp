@@ -0,0 +1,584 @@
+#include "stdafx.h"
+#include "DumpReplayRunner.h"
+#if DEBUGDUMPFILE
+#include "DumpBase.h"
+#include "../Common/LogSystem.h"
+#include "../Common/ToolKit.h"
+#include "../Common/LicenseSystem.h"
+#include <windows.h>
+#include <psapi.h>
+#include <process.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#pragma comment(lib, "psapi.lib")
+
+namespace MagicApp
+{
+    static const int gDefaultRepeatCount = 5;
+    // Median time above baseline * gRegressionRatio is a regression, if it is also slower by gRegressionMinTime seconds
+    static const double gRegressionRatio = 1.1;
+    static const double gRegressionMinTime = 0.01;
+    static const double gChecksumPrecision = 1.0e-5;
+    static const DWORD gMemorySampleInterval = 2;
+    static const double gMegaByte = 1024.0 * 1024.0;
+
+    static SIZE_T GetWorkingSet(void)
+    {
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+        {
+            return 0;
+        }
+        return counters.WorkingSetSize;
+    }
+
+    static SIZE_T GetPeakWorkingSet(void)
+    {
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+        {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+    }
+
+    // User and kernel time of all threads of the process, in seconds
+    static double GetProcessCpuTime(void)
+    {
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) == FALSE)
+        {
+            return 0;
+        }
+        ULARGE_INTEGER kernelTicks, userTicks;
+        kernelTicks.LowPart = kernelTime.dwLowDateTime;
+        kernelTicks.HighPart = kernelTime.dwHighDateTime;
+        userTicks.LowPart = userTime.dwLowDateTime;
+        userTicks.HighPart = userTime.dwHighDateTime;
+        return double(kernelTicks.QuadPart + userTicks.QuadPart) * 1.0e-7;
+    }
+
+    static int GetProcessorCount(void)
+    {
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        return systemInfo.dwNumberOfProcessors > 0 ? int(systemInfo.dwNumberOfProcessors) : 1;
+    }
+
+    // The process peak working set only grows, so a thread samples the working set while a dump runs
+    class MemorySampler
+    {
+    public:
+        MemorySampler() :
+            mIsSampling(0),
+            mPeakWorkingSet(0),
+            mThread(NULL)
+        {
+        }
+
+        void Start(void)
+        {
+            mPeakWorkingSet = GetWorkingSet();
+            mIsSampling = 1;
+            mThread = (HANDLE)_beginthreadex(NULL, 0, RunSampler, (void *)this, 0, NULL);
+        }
+
+        SIZE_T Stop(void)
+        {
+            InterlockedExchange(&mIsSampling, 0);
+            if (mThread != NULL)
+            {
+                WaitForSingleObject(mThread, INFINITE);
+                CloseHandle(mThread);
+                mThread = NULL;
+            }
+            Sample();
+            return mPeakWorkingSet;
+        }
+
+    private:
+        static unsigned __stdcall RunSampler(void *arg)
+        {
+            MemorySampler* sampler = (MemorySampler*)arg;
+            while (sampler->mIsSampling)
+            {
+                sampler->Sample();
+                Sleep(gMemorySampleInterval);
+            }
+            return 1;
+        }
+
+        void Sample(void)
+        {
+            SIZE_T workingSet = GetWorkingSet();
+            if (workingSet > mPeakWorkingSet)
+            {
+                mPeakWorkingSet = workingSet;
+            }
+        }
+
+    private:
+        volatile LONG mIsSampling;
+        SIZE_T mPeakWorkingSet;
+        HANDLE mThread;
+    };
+
+    // FNV-1a
+    static void HashBytes(unsigned int& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t byteId = 0; byteId < size; byteId++)
+        {
+            hash ^= bytes[byteId];
+            hash *= 16777619u;
+        }
+    }
+
+    static void HashCoord(unsigned int& hash, const GPP::Vector3& coord)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            __int64 rounded = __int64(floor(coord[axis] / gChecksumPrecision + 0.5));
+            HashBytes(hash, &rounded, sizeof(rounded));
+        }
+    }
+
+    static unsigned int ComputeChecksum(GPP::DumpBase* dumpInfo, GPP::ErrorCode res)
+    {
+        unsigned int hash = 2166136261u;
+        HashBytes(hash, &res, sizeof(res));
+        const GPP::IPointCloud* pointCloud = dumpInfo->GetPointCloud(0);
+        if (pointCloud != NULL)
+        {
+            GPP::Int pointCount = pointCloud->GetPointCount();
+            HashBytes(hash, &pointCount, sizeof(pointCount));
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                HashCoord(hash, pointCloud->GetPointCoord(pid));
+            }
+        }
+        const GPP::ITriMesh* triMesh = dumpInfo->GetTriMesh(0);
+        if (triMesh != NULL)
+        {
+            GPP::Int vertexCount = triMesh->GetVertexCount();
+            HashBytes(hash, &vertexCount, sizeof(vertexCount));
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                HashCoord(hash, triMesh->GetVertexCoord(vid));
+            }
+            GPP::Int faceCount = triMesh->GetTriangleCount();
+            HashBytes(hash, &faceCount, sizeof(faceCount));
+            GPP::Int vertexIds[3];
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                triMesh->GetTriangleVertexIds(fid, vertexIds);
+                HashBytes(hash, vertexIds, sizeof(vertexIds));
+            }
+        }
+        return hash;
+    }
+
+    static int ReadDumpApiName(const std::string& filePath)
+    {
+        std::ifstream fin(filePath.c_str());
+        int dumpApiName = -1;
+        fin >> dumpApiName;
+        fin.close();
+        return dumpApiName;
+    }
+
+    static std::string GetFileName(const std::string& filePath)
+    {
+        size_t pos = filePath.find_last_of("\\/");
+        return pos == std::string::npos ? filePath : filePath.substr(pos + 1);
+    }
+
+    static std::string AppendSeparator(const std::string& directory)
+    {
+        if (directory.empty() || directory[directory.size() - 1] == '\\' || directory[directory.size() - 1] == '/')
+        {
+            return directory;
+        }
+        return directory + "\\";
+    }
+
+    static std::string FormatMilliSecond(double seconds)
+    {
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(1) << seconds * 1000.0;
+        return stream.str();
+    }
+
+    DumpReplayRunner::DumpReplayRunner() :
+        mRecords(),
+        mBaselineRecords()
+    {
+    }
+
+    DumpReplayRunner::~DumpReplayRunner()
+    {
+    }
+
+    int DumpReplayRunner::RunDirectory(const std::string& dumpDir, int repeatCount)
+    {
+        std::string directory = AppendSeparator(dumpDir);
+        std::vector<std::string> fileNames;
+        WIN32_FIND_DATA findData;
+        HANDLE findHandle = FindFirstFile((directory + "*.dump").c_str(), &findData);
+        if (findHandle != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+                {
+                    fileNames.push_back(directory + findData.cFileName);
+                }
+            } while (FindNextFile(findHandle, &findData));
+            FindClose(findHandle);
+        }
+        std::sort(fileNames.begin(), fileNames.end());
+        return RunFiles(fileNames, repeatCount);
+    }
+
+    int DumpReplayRunner::RunFiles(const std::vector<std::string>& fileNames, int repeatCount)
+    {
+        if (repeatCount < 1)
+        {
+            repeatCount = 1;
+        }
+        mRecords.clear();
+        for (std::vector<std::string>::const_iterator itr = fileNames.begin(); itr != fileNames.end(); ++itr)
+        {
+            DumpReplayRecord record;
+            if (ReplayDump(*itr, repeatCount, record))
+            {
+                mRecords.push_back(record);
+            }
+        }
+        InfoLog << "DumpReplayRunner::RunFiles " << mRecords.size() << "/" << fileNames.size() << " dumps, repeat "
+            << repeatCount << std::endl;
+        return int(mRecords.size());
+    }
+
+    bool DumpReplayRunner::ReplayDump(const std::string& filePath, int repeatCount, DumpReplayRecord& record) const
+    {
+        record.fileName = GetFileName(filePath);
+        record.apiName = ReadDumpApiName(filePath);
+        record.runCount = 0;
+        record.failedCount = 0;
+        record.minTime = 0;
+        record.medianTime = 0;
+        record.meanTime = 0;
+        record.threadUtilization = 0;
+        record.peakMemory = 0;
+        record.checksum = 0;
+        record.isStable = true;
+        int processorCount = GetProcessorCount();
+        std::vector<double> runTimes;
+        runTimes.reserve(repeatCount);
+        double cpuTime = 0;
+        SIZE_T peakMemory = 0;
+        for (int runId = 0; runId < repeatCount; runId++)
+        {
+            GPP::DumpBase* dumpInfo = GPP::DumpManager::Get()->GetDumpInstance(record.apiName);
+            if (dumpInfo == NULL)
+            {
+                ErrorLog << "DumpReplayRunner: no dump instance for " << filePath << " api " << record.apiName << std::endl;
+                return false;
+            }
+            dumpInfo->LoadDumpFile(filePath);
+
+            SIZE_T workingSetBefore = GetWorkingSet();
+            SIZE_T processPeakBefore = GetPeakWorkingSet();
+            MemorySampler sampler;
+            sampler.Start();
+            double cpuTimeBefore = GetProcessCpuTime();
+            double timeBefore = MagicCore::ToolKit::GetTime();
+            GPP::ErrorCode res = dumpInfo->Run();
+            double runTime = MagicCore::ToolKit::GetTime() - timeBefore;
+            cpuTime += GetProcessCpuTime() - cpuTimeBefore;
+            SIZE_T runPeak = sampler.Stop();
+            // The sampler could miss a short spike, but a spike above the process peak is recorded by the system
+            SIZE_T processPeakAfter = GetPeakWorkingSet();
+            if (processPeakAfter > processPeakBefore && processPeakAfter > runPeak)
+            {
+                runPeak = processPeakAfter;
+            }
+            if (runPeak > workingSetBefore && runPeak - workingSetBefore > peakMemory)
+            {
+                peakMemory = runPeak - workingSetBefore;
+            }
+
+            runTimes.push_back(runTime);
+            if (res != GPP_NO_ERROR)
+            {
+                record.failedCount++;
+            }
+            unsigned int checksum = ComputeChecksum(dumpInfo, res);
+            if (runId == 0)
+            {
+                record.checksum = checksum;
+            }
+            else if (checksum != record.checksum)
+            {
+                record.isStable = false;
+            }
+            GPPFREEPOINTER(dumpInfo);
+        }
+        record.runCount = int(runTimes.size());
+        double totalTime = 0;
+        for (std::vector<double>::const_iterator itr = runTimes.begin(); itr != runTimes.end(); ++itr)
+        {
+            totalTime += *itr;
+        }
+        std::sort(runTimes.begin(), runTimes.end());
+        record.minTime = runTimes.front();
+        record.medianTime = runTimes.at(runTimes.size() / 2);
+        record.meanTime = totalTime / record.runCount;
+        record.threadUtilization = totalTime > 0 ? cpuTime / (totalTime * processorCount) : 0;
+        record.peakMemory = double(peakMemory) / gMegaByte;
+        InfoLog << "DumpReplayRunner: " << record.fileName << " api=" << record.apiName << " median="
+            << record.medianTime << " utilization=" << record.threadUtilization << " peak=" << record.peakMemory
+            << "MB checksum=" << record.checksum << " failed=" << record.failedCount << std::endl;
+        return true;
+    }
+
+    bool DumpReplayRunner::SaveRecords(const std::string& fileName) const
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+        {
+            return false;
+        }
+        fout << "fileName,apiName,runCount,failedCount,minTime,medianTime,meanTime,threadUtilization,peakMemory,checksum,isStable\n";
+        fout << std::setprecision(9);
+        for (std::vector<DumpReplayRecord>::const_iterator itr = mRecords.begin(); itr != mRecords.end(); ++itr)
+        {
+            fout << itr->fileName << "," << itr->apiName << "," << itr->runCount << "," << itr->failedCount << ","
+                << itr->minTime << "," << itr->medianTime << "," << itr->meanTime << "," << itr->threadUtilization << ","
+                << itr->peakMemory << "," << itr->checksum << "," << (itr->isStable ? 1 : 0) << "\n";
+        }
+        fout.close();
+        return true;
+    }
+
+    bool DumpReplayRunner::LoadBaseline(const std::string& fileName)
+    {
+        mBaselineRecords.clear();
+        std::ifstream fin(fileName.c_str());
+        if (!fin)
+        {
+            return false;
+        }
+        std::string line;
+        std::getline(fin, line); // header
+        while (std::getline(fin, line))
+        {
+            std::vector<std::string> fields;
+            std::istringstream lineStream(line);
+            std::string field;
+            while (std::getline(lineStream, field, ','))
+            {
+                fields.push_back(field);
+            }
+            if (fields.size() != 11)
+            {
+                continue;
+            }
+            DumpReplayRecord record;
+            record.fileName = fields.at(0);
+            record.apiName = atoi(fields.at(1).c_str());
+            record.runCount = atoi(fields.at(2).c_str());
+            record.failedCount = atoi(fields.at(3).c_str());
+            record.minTime = atof(fields.at(4).c_str());
+            record.medianTime = atof(fields.at(5).c_str());
+            record.meanTime = atof(fields.at(6).c_str());
+            record.threadUtilization = atof(fields.at(7).c_str());
+            record.peakMemory = atof(fields.at(8).c_str());
+            record.checksum = (unsigned int)strtoul(fields.at(9).c_str(), NULL, 10);
+            record.isStable = atoi(fields.at(10).c_str()) != 0;
+            mBaselineRecords.push_back(record);
+        }
+        fin.close();
+        return !mBaselineRecords.empty();
+    }
+
+    const DumpReplayRecord* DumpReplayRunner::FindBaseline(const std::string& fileName) const
+    {
+        for (std::vector<DumpReplayRecord>::const_iterator itr = mBaselineRecords.begin(); itr != mBaselineRecords.end(); ++itr)
+        {
+            if (itr->fileName == fileName)
+            {
+                return &(*itr);
+            }
+        }
+        return NULL;
+    }
+
+    bool DumpReplayRunner::IsRegression(const DumpReplayRecord& record, const DumpReplayRecord* baseline) const
+    {
+        if (baseline == NULL)
+        {
+            return false;
+        }
+        if (record.failedCount > baseline->failedCount)
+        {
+            return true;
+        }
+        // An unstable result, such as a randomized algorithm, has no reliable checksum
+        if (record.isStable && baseline->isStable && record.checksum != baseline->checksum)
+        {
+            return true;
+        }
+        return record.medianTime > baseline->medianTime * gRegressionRatio &&
+            record.medianTime - baseline->medianTime > gRegressionMinTime;
+    }
+
+    int DumpReplayRunner::GetRegressionCount() const
+    {
+        int regressionCount = 0;
+        for (std::vector<DumpReplayRecord>::const_iterator itr = mRecords.begin(); itr != mRecords.end(); ++itr)
+        {
+            if (IsRegression(*itr, FindBaseline(itr->fileName)))
+            {
+                regressionCount++;
+            }
+        }
+        return regressionCount;
+    }
+
+    bool DumpReplayRunner::SaveComparison(const std::string& fileName) const
+    {
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+        {
+            return false;
+        }
+        fout << "processors: " << GetProcessorCount() << "  regression: median time > baseline * " << gRegressionRatio
+            << ", more failures or changed checksum\n\n";
+        fout << std::left << std::setw(40) << "file" << std::right << std::setw(8) << "api" << std::setw(12) << "median(ms)"
+            << std::setw(12) << "base(ms)" << std::setw(8) << "ratio" << std::setw(8) << "util" << std::setw(8) << "base"
+            << std::setw(10) << "peak(MB)" << std::setw(10) << "base(MB)" << std::setw(10) << "checksum" << std::setw(8) << "failed"
+            << "  " << "status" << "\n";
+        // api name -> current and baseline median time summed over the files which are in both runs
+        std::map<int, std::pair<double, double> > apiTimes;
+        std::map<int, int> apiFileCounts;
+        for (std::vector<DumpReplayRecord>::const_iterator itr = mRecords.begin(); itr != mRecords.end(); ++itr)
+        {
+            const DumpReplayRecord* baseline = FindBaseline(itr->fileName);
+            std::string checksumState = itr->isStable ? "same" : "unstable";
+            std::string status = "new";
+            if (baseline != NULL)
+            {
+                if (itr->isStable && baseline->isStable && itr->checksum != baseline->checksum)
+                {
+                    checksumState = "changed";
+                }
+                status = IsRegression(*itr, baseline) ? "REGRESSION" : "ok";
+                apiTimes[itr->apiName].first += itr->medianTime;
+                apiTimes[itr->apiName].second += baseline->medianTime;
+                apiFileCounts[itr->apiName]++;
+            }
+            else
+            {
+                checksumState = itr->isStable ? "-" : "unstable";
+            }
+            fout << std::left << std::setw(40) << itr->fileName << std::right << std::setw(8) << itr->apiName
+                << std::setw(12) << FormatMilliSecond(itr->medianTime);
+            if (baseline != NULL)
+            {
+                fout << std::setw(12) << FormatMilliSecond(baseline->medianTime) << std::setw(8) << std::fixed << std::setprecision(2)
+                    << (baseline->medianTime > 0 ? itr->medianTime / baseline->medianTime : 0) << std::setw(8)
+                    << itr->threadUtilization << std::setw(8) << baseline->threadUtilization << std::setw(10) << std::setprecision(1)
+                    << itr->peakMemory << std::setw(10) << baseline->peakMemory;
+            }
+            else
+            {
+                fout << std::setw(12) << "-" << std::setw(8) << "-" << std::setw(8) << std::fixed << std::setprecision(2)
+                    << itr->threadUtilization << std::setw(8) << "-" << std::setw(10) << std::setprecision(1) << itr->peakMemory
+                    << std::setw(10) << "-";
+            }
+            fout << std::setw(10) << checksumState << std::setw(8) << itr->failedCount << "  " << status << "\n";
+        }
+        for (std::vector<DumpReplayRecord>::const_iterator itr = mBaselineRecords.begin(); itr != mBaselineRecords.end(); ++itr)
+        {
+            bool isReplayed = false;
+            for (std::vector<DumpReplayRecord>::const_iterator recordItr = mRecords.begin(); recordItr != mRecords.end(); ++recordItr)
+            {
+                if (recordItr->fileName == itr->fileName)
+                {
+                    isReplayed = true;
+                    break;
+                }
+            }
+            if (!isReplayed)
+            {
+                fout << std::left << std::setw(40) << itr->fileName << std::right << std::setw(8) << itr->apiName << "  missing\n";
+            }
+        }
+        if (!apiTimes.empty())
+        {
+            fout << "\n" << std::left << std::setw(12) << "api" << std::right << std::setw(8) << "files" << std::setw(12)
+                << "time(ms)" << std::setw(12) << "base(ms)" << std::setw(8) << "ratio" << "\n";
+            for (std::map<int, std::pair<double, double> >::const_iterator itr = apiTimes.begin(); itr != apiTimes.end(); ++itr)
+            {
+                fout << std::left << std::setw(12) << itr->first << std::right << std::setw(8) << apiFileCounts[itr->first]
+                    << std::setw(12) << FormatMilliSecond(itr->second.first) << std::setw(12) << FormatMilliSecond(itr->second.second)
+                    << std::setw(8) << std::fixed << std::setprecision(2)
+                    << (itr->second.second > 0 ? itr->second.first / itr->second.second : 0) << "\n";
+            }
+        }
+        fout << "\nregressions: " << GetRegressionCount() << "\n";
+        fout.close();
+        return true;
+    }
+
+    const std::vector<DumpReplayRecord>& DumpReplayRunner::GetRecords() const
+    {
+        return mRecords;
+    }
+
+    void DumpReplayRunner::Clear()
+    {
+        mRecords.clear();
+        mBaselineRecords.clear();
+    }
+
+    bool DumpReplayRunner::IsReplayCommand(int argc, char* argv[])
+    {
+        return argc >= 3 && std::string(argv[1]) == "-replay";
+    }
+
+    int DumpReplayRunner::RunCommand(int argc, char* argv[])
+    {
+        if (!IsReplayCommand(argc, argv))
+        {
+            return -1;
+        }
+        // The replay returns before MagicFramework::Init, so it sets up what GPP needs without Ogre and MyGUI
+        MagicCore::LicenseSystem::Init(true);
+        GPP::RegisterDumpInfo();
+        std::string dumpDir = argv[2];
+        int repeatCount = argc >= 4 ? atoi(argv[3]) : gDefaultRepeatCount;
+        DumpReplayRunner runner;
+        if (argc >= 5 && !runner.LoadBaseline(argv[4]))
+        {
+            ErrorLog << "DumpReplayRunner: failed to load baseline " << argv[4] << std::endl;
+        }
+        if (runner.RunDirectory(dumpDir, repeatCount) == 0)
+        {
+            ErrorLog << "DumpReplayRunner: no dump is replayed in " << dumpDir << std::endl;
+            return -1;
+        }
+        std::string directory = AppendSeparator(dumpDir);
+        runner.SaveRecords(directory + "replay.csv");
+        runner.SaveComparison(directory + "replay_compare.txt");
+        return runner.GetRegressionCount();
+    }
+}
+#endif
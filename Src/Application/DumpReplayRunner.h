@@ -0,0 +1,70 @@
+#pragma once
+#include "AppBase.h"
+#if DEBUGDUMPFILE
+#include <string>
+#include <vector>
+
+namespace MagicApp
+{
+    // Performance of one dump file over all of its replays
+    struct DumpReplayRecord
+    {
+        // File name without directory, a baseline record is matched by it
+        std::string fileName;
+        int apiName;
+        int runCount;
+        int failedCount;
+        // Wall time of Run in seconds
+        double minTime;
+        double medianTime;
+        double meanTime;
+        // Process cpu time / (wall time * processor count)
+        double threadUtilization;
+        // Peak working set during Run above the working set before it, in MB
+        double peakMemory;
+        unsigned int checksum;
+        // Whether all replays produce the same checksum
+        bool isStable;
+    };
+
+    // Headless replay of dump files for performance regression tests.
+    // Every replay loads the dump into a new DumpBase instance, so an api which edits its input in place always starts
+    // from the recorded data, and only DumpBase::Run is timed. The checksum hashes the error code and the output
+    // point cloud / mesh with coordinates rounded to gChecksumPrecision.
+    class DumpReplayRunner
+    {
+    public:
+        DumpReplayRunner();
+        ~DumpReplayRunner();
+
+        // Replay every *.dump file in dumpDir repeatCount times. Return the number of replayed files.
+        int RunDirectory(const std::string& dumpDir, int repeatCount);
+        int RunFiles(const std::vector<std::string>& fileNames, int repeatCount);
+
+        bool SaveRecords(const std::string& fileName) const;
+        // A baseline is a file written by SaveRecords
+        bool LoadBaseline(const std::string& fileName);
+        // Table of records against the baseline, and the time of each api summed over its files
+        bool SaveComparison(const std::string& fileName) const;
+        // Files whose median time exceeds the baseline by gRegressionRatio, or whose checksum changes
+        int GetRegressionCount(void) const;
+
+        const std::vector<DumpReplayRecord>& GetRecords(void) const;
+        void Clear(void);
+
+        // Magic3D.exe -replay dumpDir [repeatCount] [baselineFile]
+        // It writes replay.csv and replay_compare.txt into dumpDir, and returns the regression count as exit code.
+        static bool IsReplayCommand(int argc, char* argv[]);
+        static int RunCommand(int argc, char* argv[]);
+
+    private:
+        bool ReplayDump(const std::string& filePath, int repeatCount, DumpReplayRecord& record) const;
+        const DumpReplayRecord* FindBaseline(const std::string& fileName) const;
+        bool IsRegression(const DumpReplayRecord& record, const DumpReplayRecord* baseline) const;
+
+    private:
+        std::vector<DumpReplayRecord> mRecords;
+        std::vector<DumpReplayRecord> mBaselineRecords;
+    };
+}
+#endif
@@ -0,0 +1,560 @@
+#include "FilterPreview.h"
+#include "../Common/LogSystem.h"
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+namespace MagicApp
+{
+    static const int gCellAxisBits = 21;
+    static const GPP::ULongInt gCellHashFactor = 11400714819323198485ULL;
+
+    // Open addressing map from grid cell keys to cell ids, ids are given in insertion order
+    class GridCellTable
+    {
+    public:
+        explicit GridCellTable(GPP::Int expectedCellCount) :
+            mKeys(),
+            mCellIds(),
+            mCellCount(0),
+            mShift(64)
+        {
+            size_t capacity = 2;
+            while (capacity < size_t(expectedCellCount) * 2)
+            {
+                capacity *= 2;
+            }
+            Resize(capacity);
+        }
+
+        GPP::Int Insert(GPP::ULongInt key)
+        {
+            if (size_t(mCellCount) * 2 >= mKeys.size())
+            {
+                Rehash();
+            }
+            size_t mask = mKeys.size() - 1;
+            size_t slot = size_t((key * gCellHashFactor) >> mShift) & mask;
+            while (mCellIds.at(slot) >= 0)
+            {
+                if (mKeys.at(slot) == key)
+                {
+                    return mCellIds.at(slot);
+                }
+                slot = (slot + 1) & mask;
+            }
+            mKeys.at(slot) = key;
+            mCellIds.at(slot) = mCellCount;
+            return mCellCount++;
+        }
+
+        GPP::Int GetCellCount(void) const
+        {
+            return mCellCount;
+        }
+
+    private:
+        void Resize(size_t capacity)
+        {
+            mShift = 64;
+            for (size_t size = 1; size < capacity; size *= 2)
+            {
+                mShift--;
+            }
+            mKeys.assign(capacity, 0);
+            mCellIds.assign(capacity, -1);
+        }
+
+        void Rehash(void)
+        {
+            std::vector<GPP::ULongInt> keys;
+            std::vector<GPP::Int> cellIds;
+            keys.swap(mKeys);
+            cellIds.swap(mCellIds);
+            Resize(keys.size() * 2);
+            size_t mask = mKeys.size() - 1;
+            for (size_t index = 0; index < keys.size(); index++)
+            {
+                if (cellIds.at(index) < 0)
+                {
+                    continue;
+                }
+                size_t slot = size_t((keys.at(index) * gCellHashFactor) >> mShift) & mask;
+                while (mCellIds.at(slot) >= 0)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                mKeys.at(slot) = keys.at(index);
+                mCellIds.at(slot) = cellIds.at(index);
+            }
+        }
+
+    private:
+        std::vector<GPP::ULongInt> mKeys;
+        std::vector<GPP::Int> mCellIds;
+        GPP::Int mCellCount;
+        int mShift;
+    };
+
+    static GPP::ULongInt GetCellKey(const GPP::Vector3& coord, const GPP::Vector3& bboxMin, GPP::Real cellSize)
+    {
+        static const GPP::ULongInt maxIndex = (GPP::ULongInt(1) << gCellAxisBits) - 1;
+        GPP::ULongInt key = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real index = floor((coord[axis] - bboxMin[axis]) / cellSize);
+            GPP::ULongInt cellIndex = index <= 0 ? 0 : GPP::ULongInt(index);
+            key = (key << gCellAxisBits) | (cellIndex > maxIndex ? maxIndex : cellIndex);
+        }
+        return key;
+    }
+
+    static void UpdateBBox(const GPP::Vector3& coord, GPP::Vector3& bboxMin, GPP::Vector3& bboxMax)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bboxMin[axis] = coord[axis] < bboxMin[axis] ? coord[axis] : bboxMin[axis];
+            bboxMax[axis] = coord[axis] > bboxMax[axis] ? coord[axis] : bboxMax[axis];
+        }
+    }
+
+    struct ClusterTriangle
+    {
+        GPP::Int vertexIds[3];
+        GPP::Int sortedIds[3];
+    };
+
+    static bool CompareClusterTriangle(const ClusterTriangle& triangle0, const ClusterTriangle& triangle1)
+    {
+        return std::lexicographical_compare(triangle0.sortedIds, triangle0.sortedIds + 3,
+            triangle1.sortedIds, triangle1.sortedIds + 3);
+    }
+
+    static bool IsSameClusterTriangle(const ClusterTriangle& triangle0, const ClusterTriangle& triangle1)
+    {
+        return std::equal(triangle0.sortedIds, triangle0.sortedIds + 3, triangle1.sortedIds);
+    }
+
+    // Kept here to keep windows.h out of the header
+    struct FilterPreviewLock
+    {
+        CRITICAL_SECTION lock;
+    };
+
+    FilterRequest::FilterRequest() :
+        commandType(0)
+    {
+        values[0] = 0;
+        values[1] = 0;
+    }
+
+    FilterPreview::FilterPreview() :
+        mpPointCloud(NULL),
+        mpTriMesh(NULL),
+        mSampleRatio(1),
+        mRefineState(REFINE_IDLE),
+        mRefineRequest(),
+        mPendingRequest(),
+        mPreviewState(REFINE_IDLE),
+        mPreviewRequest(),
+        mpPreviewPointCloud(NULL),
+        mpPreviewTriMesh(NULL),
+        mpLock(new FilterPreviewLock)
+    {
+        InitializeCriticalSection(&mpLock->lock);
+    }
+
+    FilterPreview::~FilterPreview()
+    {
+        Clear();
+        DeleteCriticalSection(&mpLock->lock);
+        GPPFREEPOINTER(mpLock);
+    }
+
+    bool FilterPreview::SamplePointCloud(const GPP::PointCloud* pointCloud, GPP::Int targetPointCount)
+    {
+        Clear();
+        if (pointCloud == NULL || pointCloud->GetPointCount() == 0 || targetPointCount <= 0)
+        {
+            return false;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        GPP::Vector3 bboxMin(GPP::REAL_LARGE, GPP::REAL_LARGE, GPP::REAL_LARGE);
+        GPP::Vector3 bboxMax(-GPP::REAL_LARGE, -GPP::REAL_LARGE, -GPP::REAL_LARGE);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            UpdateBBox(pointCloud->GetPointCoord(pid), bboxMin, bboxMax);
+        }
+        // Scanned points lie on a surface, so the occupied cell count grows with the square of the grid resolution
+        GPP::Real cellSize = (bboxMax - bboxMin).Length() / sqrt(GPP::Real(targetPointCount));
+        if (cellSize < GPP::REAL_TOL)
+        {
+            return false;
+        }
+        bool hasNormal = pointCloud->HasNormal();
+        bool hasColor = pointCloud->HasColor();
+        mpPointCloud = new GPP::PointCloud(hasNormal, hasColor);
+        mpPointCloud->ReservePoint(targetPointCount);
+        GridCellTable cellTable(targetPointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
+            GPP::Int cellCount = cellTable.GetCellCount();
+            if (cellTable.Insert(GetCellKey(coord, bboxMin, cellSize)) < cellCount)
+            {
+                continue;
+            }
+            GPP::Int sampleId = hasNormal ? mpPointCloud->InsertPoint(coord, pointCloud->GetPointNormal(pid)) :
+                mpPointCloud->InsertPoint(coord);
+            if (hasColor)
+            {
+                mpPointCloud->SetPointColor(sampleId, pointCloud->GetPointColor(pid));
+            }
+        }
+        mSampleRatio = GPP::Real(mpPointCloud->GetPointCount()) / GPP::Real(pointCount);
+        DebugLog << "FilterPreview::SamplePointCloud: " << mpPointCloud->GetPointCount() << " samples" << std::endl;
+        return true;
+    }
+
+    bool FilterPreview::ClusterTriMesh(const GPP::TriMesh* triMesh, GPP::Int targetVertexCount)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetTriangleCount() == 0 || targetVertexCount <= 0)
+        {
+            return false;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        GPP::Vector3 bboxMin(GPP::REAL_LARGE, GPP::REAL_LARGE, GPP::REAL_LARGE);
+        GPP::Vector3 bboxMax(-GPP::REAL_LARGE, -GPP::REAL_LARGE, -GPP::REAL_LARGE);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            UpdateBBox(triMesh->GetVertexCoord(vid), bboxMin, bboxMax);
+        }
+        GPP::Real area = 0;
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 coord0 = triMesh->GetVertexCoord(vertexIds[0]);
+            area += (triMesh->GetVertexCoord(vertexIds[1]) - coord0).CrossProduct(triMesh->GetVertexCoord(vertexIds[2]) - coord0).Length();
+        }
+        area /= 2.0;
+        GPP::Real cellSize = sqrt(area / GPP::Real(targetVertexCount));
+        if (cellSize < GPP::REAL_TOL)
+        {
+            return false;
+        }
+
+        // Average vertex of each cell
+        bool hasColor = triMesh->HasVertexColor();
+        GridCellTable cellTable(targetVertexCount);
+        std::vector<GPP::Int> clusterIds(vertexCount);
+        std::vector<GPP::Vector3> clusterCoords;
+        std::vector<GPP::Vector3> clusterColors;
+        std::vector<GPP::Int> clusterSizes;
+        clusterCoords.reserve(targetVertexCount);
+        clusterSizes.reserve(targetVertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
+            GPP::Int clusterId = cellTable.Insert(GetCellKey(coord, bboxMin, cellSize));
+            if (clusterId == GPP::Int(clusterSizes.size()))
+            {
+                clusterCoords.push_back(GPP::Vector3(0, 0, 0));
+                clusterSizes.push_back(0);
+                if (hasColor)
+                {
+                    clusterColors.push_back(GPP::Vector3(0, 0, 0));
+                }
+            }
+            clusterIds.at(vid) = clusterId;
+            clusterCoords.at(clusterId) += coord;
+            clusterSizes.at(clusterId)++;
+            if (hasColor)
+            {
+                clusterColors.at(clusterId) += triMesh->GetVertexColor(vid);
+            }
+        }
+
+        // Triangles whose corners fall into three cells, each cell triple is kept once
+        std::vector<ClusterTriangle> clusterTriangles;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            ClusterTriangle triangle;
+            for (int cornerId = 0; cornerId < 3; cornerId++)
+            {
+                triangle.vertexIds[cornerId] = clusterIds.at(vertexIds[cornerId]);
+                triangle.sortedIds[cornerId] = triangle.vertexIds[cornerId];
+            }
+            if (triangle.vertexIds[0] == triangle.vertexIds[1] || triangle.vertexIds[1] == triangle.vertexIds[2] ||
+                triangle.vertexIds[2] == triangle.vertexIds[0])
+            {
+                continue;
+            }
+            std::sort(triangle.sortedIds, triangle.sortedIds + 3);
+            clusterTriangles.push_back(triangle);
+        }
+        std::stable_sort(clusterTriangles.begin(), clusterTriangles.end(), CompareClusterTriangle);
+        clusterTriangles.erase(std::unique(clusterTriangles.begin(), clusterTriangles.end(), IsSameClusterTriangle),
+            clusterTriangles.end());
+        if (clusterTriangles.empty())
+        {
+            return false;
+        }
+
+        // Cells without triangles are dropped
+        std::vector<GPP::Int> previewVertexIds(clusterSizes.size(), -1);
+        mpTriMesh = new GPP::TriMesh(hasColor, false, false);
+        for (std::vector<ClusterTriangle>::const_iterator triangleItr = clusterTriangles.begin();
+            triangleItr != clusterTriangles.end(); ++triangleItr)
+        {
+            for (int cornerId = 0; cornerId < 3; cornerId++)
+            {
+                GPP::Int clusterId = triangleItr->vertexIds[cornerId];
+                if (previewVertexIds.at(clusterId) >= 0)
+                {
+                    continue;
+                }
+                GPP::Real clusterSize = GPP::Real(clusterSizes.at(clusterId));
+                previewVertexIds.at(clusterId) = mpTriMesh->InsertVertex(clusterCoords.at(clusterId) / clusterSize);
+                if (hasColor)
+                {
+                    mpTriMesh->SetVertexColor(previewVertexIds.at(clusterId), clusterColors.at(clusterId) / clusterSize);
+                }
+            }
+            mpTriMesh->InsertTriangle(previewVertexIds.at(triangleItr->vertexIds[0]),
+                previewVertexIds.at(triangleItr->vertexIds[1]), previewVertexIds.at(triangleItr->vertexIds[2]));
+        }
+        // Merged cells could pinch the surface
+        GPP::ErrorCode res = GPP::ConsolidateMesh::MakeTriMeshManifold(mpTriMesh);
+        if (res != GPP_NO_ERROR || GPP::ConsolidateMesh::_IsTriMeshManifold(mpTriMesh) == false)
+        {
+            DebugLog << "FilterPreview::ClusterTriMesh: preview mesh is not manifold" << std::endl;
+            Clear();
+            return false;
+        }
+        mpTriMesh->UpdateNormal();
+        mSampleRatio = GPP::Real(mpTriMesh->GetVertexCount()) / GPP::Real(vertexCount);
+        DebugLog << "FilterPreview::ClusterTriMesh: " << mpTriMesh->GetVertexCount() << " vertices" << std::endl;
+        return true;
+    }
+
+    GPP::PointCloud* FilterPreview::CreatePointCloud() const
+    {
+        if (mpPointCloud == NULL)
+        {
+            return NULL;
+        }
+        bool hasNormal = mpPointCloud->HasNormal();
+        bool hasColor = mpPointCloud->HasColor();
+        GPP::Int pointCount = mpPointCloud->GetPointCount();
+        GPP::PointCloud* pointCloud = new GPP::PointCloud(hasNormal, hasColor);
+        pointCloud->ReservePoint(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            if (hasNormal)
+            {
+                pointCloud->InsertPoint(mpPointCloud->GetPointCoord(pid), mpPointCloud->GetPointNormal(pid));
+            }
+            else
+            {
+                pointCloud->InsertPoint(mpPointCloud->GetPointCoord(pid));
+            }
+            if (hasColor)
+            {
+                pointCloud->SetPointColor(pid, mpPointCloud->GetPointColor(pid));
+            }
+        }
+        return pointCloud;
+    }
+
+    GPP::TriMesh* FilterPreview::CreateTriMesh() const
+    {
+        if (mpTriMesh == NULL)
+        {
+            return NULL;
+        }
+        bool hasColor = mpTriMesh->HasVertexColor();
+        GPP::TriMesh* triMesh = new GPP::TriMesh(hasColor, false, false);
+        GPP::Int vertexCount = mpTriMesh->GetVertexCount();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(mpTriMesh->GetVertexCoord(vid), mpTriMesh->GetVertexNormal(vid));
+            if (hasColor)
+            {
+                triMesh->SetVertexColor(vid, mpTriMesh->GetVertexColor(vid));
+            }
+        }
+        GPP::Int triangleCount = mpTriMesh->GetTriangleCount();
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+            triMesh->InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+        }
+        triMesh->UpdateNormal();
+        return triMesh;
+    }
+
+    GPP::Real FilterPreview::GetSampleRatio() const
+    {
+        return mSampleRatio;
+    }
+
+    void FilterPreview::Clear()
+    {
+        // The preview thread reads the preview model
+        while (mPreviewState != REFINE_IDLE)
+        {
+            Sleep(1);
+        }
+        ClearPreviewResult();
+        GPPFREEPOINTER(mpPointCloud);
+        GPPFREEPOINTER(mpTriMesh);
+        mSampleRatio = 1;
+    }
+
+    void FilterPreview::StartRefine(const FilterRequest& request)
+    {
+        EnterCriticalSection(&mpLock->lock);
+        mRefineRequest = request;
+        InterlockedExchange(&mRefineState, REFINE_RUNNING);
+        LeaveCriticalSection(&mpLock->lock);
+    }
+
+    bool FilterPreview::QueueRefine(const FilterRequest& request)
+    {
+        EnterCriticalSection(&mpLock->lock);
+        bool isQueued = mRefineState != REFINE_IDLE;
+        if (isQueued)
+        {
+            mPendingRequest = request;
+            InterlockedExchange(&mRefineState, REFINE_PENDING);
+        }
+        LeaveCriticalSection(&mpLock->lock);
+        return isQueued;
+    }
+
+    bool FilterPreview::IsRefining() const
+    {
+        return mRefineState != REFINE_IDLE;
+    }
+
+    bool FilterPreview::RequestPreview(const FilterRequest& request)
+    {
+        EnterCriticalSection(&mpLock->lock);
+        mPreviewRequest = request;
+        bool needStart = mPreviewState == REFINE_IDLE;
+        InterlockedExchange(&mPreviewState, needStart ? REFINE_RUNNING : REFINE_PENDING);
+        LeaveCriticalSection(&mpLock->lock);
+        return needStart;
+    }
+
+    GPP::PointCloud* FilterPreview::TakePreviewPointCloud()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        GPP::PointCloud* pointCloud = mpPreviewPointCloud;
+        mpPreviewPointCloud = NULL;
+        LeaveCriticalSection(&mpLock->lock);
+        if (IsRefining() == false)
+        {
+            // The full model is rendered
+            GPPFREEPOINTER(pointCloud);
+        }
+        return pointCloud;
+    }
+
+    GPP::TriMesh* FilterPreview::TakePreviewTriMesh()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        GPP::TriMesh* triMesh = mpPreviewTriMesh;
+        mpPreviewTriMesh = NULL;
+        LeaveCriticalSection(&mpLock->lock);
+        if (IsRefining() == false)
+        {
+            GPPFREEPOINTER(triMesh);
+        }
+        return triMesh;
+    }
+
+    FilterRequest FilterPreview::GetRefineRequest() const
+    {
+        EnterCriticalSection(&mpLock->lock);
+        FilterRequest request = mRefineRequest;
+        LeaveCriticalSection(&mpLock->lock);
+        return request;
+    }
+
+    bool FilterPreview::BeginCommit()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        if (mRefineState == REFINE_PENDING)
+        {
+            LeaveCriticalSection(&mpLock->lock);
+            return false;
+        }
+        return true;
+    }
+
+    void FilterPreview::EndCommit()
+    {
+        LeaveCriticalSection(&mpLock->lock);
+    }
+
+    bool FilterPreview::FinishRefine()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        bool hasRequest = mRefineState == REFINE_PENDING;
+        if (hasRequest)
+        {
+            mRefineRequest = mPendingRequest;
+        }
+        InterlockedExchange(&mRefineState, hasRequest ? REFINE_RUNNING : REFINE_IDLE);
+        LeaveCriticalSection(&mpLock->lock);
+        return hasRequest;
+    }
+
+    FilterRequest FilterPreview::GetPreviewRequest() const
+    {
+        EnterCriticalSection(&mpLock->lock);
+        FilterRequest request = mPreviewRequest;
+        LeaveCriticalSection(&mpLock->lock);
+        return request;
+    }
+
+    void FilterPreview::SetPreviewResult(GPP::PointCloud* pointCloud)
+    {
+        EnterCriticalSection(&mpLock->lock);
+        GPPFREEPOINTER(mpPreviewPointCloud);
+        mpPreviewPointCloud = pointCloud;
+        LeaveCriticalSection(&mpLock->lock);
+    }
+
+    void FilterPreview::SetPreviewResult(GPP::TriMesh* triMesh)
+    {
+        EnterCriticalSection(&mpLock->lock);
+        GPPFREEPOINTER(mpPreviewTriMesh);
+        mpPreviewTriMesh = triMesh;
+        LeaveCriticalSection(&mpLock->lock);
+    }
+
+    bool FilterPreview::FinishPreview()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        bool hasRequest = mPreviewState == REFINE_PENDING;
+        InterlockedExchange(&mPreviewState, hasRequest ? REFINE_RUNNING : REFINE_IDLE);
+        LeaveCriticalSection(&mpLock->lock);
+        return hasRequest;
+    }
+
+    void FilterPreview::ClearPreviewResult()
+    {
+        EnterCriticalSection(&mpLock->lock);
+        GPPFREEPOINTER(mpPreviewPointCloud);
+        GPPFREEPOINTER(mpPreviewTriMesh);
+        LeaveCriticalSection(&mpLock->lock);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "GPP.h"
+
+namespace MagicApp
+{
+    struct FilterPreviewLock;
+
+    // Command type and parameters of a filter, their meaning is given by the app
+    struct FilterRequest
+    {
+        FilterRequest();
+
+        int commandType;
+        GPP::Real values[2];
+    };
+
+    // Small stand-in of a large model. A long-running filter runs on it first to show its result at once,
+    // then the full model is refined on the command thread.
+    // The refine state is shared by the UI thread and the command thread. GPP filters could not be aborted, so a
+    // request which comes during the refinement replaces the parameters, and the command thread drops the stale
+    // result and runs again. The command thread reads the parameters by GetRefineRequest only, and commits its result
+    // between BeginCommit and EndCommit, so a request either replaces the run or comes after its commit.
+    // The preview model is filtered on a preview thread of the app, the UI thread takes the result when it is ready.
+    class FilterPreview
+    {
+    public:
+        enum RefineState
+        {
+            REFINE_IDLE = 0,
+            REFINE_RUNNING,
+            REFINE_PENDING
+        };
+
+        FilterPreview();
+        ~FilterPreview();
+
+        // One point of each occupied grid cell, the cell size is estimated from targetPointCount
+        bool SamplePointCloud(const GPP::PointCloud* pointCloud, GPP::Int targetPointCount);
+        // Vertices of each occupied grid cell are merged. Return false if the merged mesh is not manifold.
+        bool ClusterTriMesh(const GPP::TriMesh* triMesh, GPP::Int targetVertexCount);
+        // New copy of the preview model owned by the caller, NULL if there is none
+        GPP::PointCloud* CreatePointCloud(void) const;
+        GPP::TriMesh* CreateTriMesh(void) const;
+        // Element count of the preview model divided by that of the full model
+        GPP::Real GetSampleRatio(void) const;
+        // Wait for the preview thread
+        void Clear(void);
+
+        // Called by the UI thread
+        void StartRefine(const FilterRequest& request);
+        // Return false if there is no refinement, the request should start a new one
+        bool QueueRefine(const FilterRequest& request);
+        bool IsRefining(void) const;
+        // Return true if the caller should start the preview thread, otherwise the running one filters it next
+        bool RequestPreview(const FilterRequest& request);
+        // Filtered preview model owned by the caller, NULL if there is none or the refinement has finished
+        GPP::PointCloud* TakePreviewPointCloud(void);
+        GPP::TriMesh* TakePreviewTriMesh(void);
+
+        // Called by the command thread
+        FilterRequest GetRefineRequest(void) const;
+        // Return false if a new request came, the result should be dropped. Otherwise the caller commits
+        // its result and calls EndCommit, QueueRefine waits until then.
+        bool BeginCommit(void);
+        void EndCommit(void);
+        // Return true if a new request came, the command should run again
+        bool FinishRefine(void);
+
+        // Called by the preview thread
+        FilterRequest GetPreviewRequest(void) const;
+        // The result is owned by FilterPreview
+        void SetPreviewResult(GPP::PointCloud* pointCloud);
+        void SetPreviewResult(GPP::TriMesh* triMesh);
+        // Return true if a new request came, the preview should run again
+        bool FinishPreview(void);
+
+    private:
+        void ClearPreviewResult(void);
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        GPP::TriMesh* mpTriMesh;
+        GPP::Real mSampleRatio;
+        volatile long mRefineState;
+        FilterRequest mRefineRequest;
+        FilterRequest mPendingRequest;
+        volatile long mPreviewState;
+        FilterRequest mPreviewRequest;
+        GPP::PointCloud* mpPreviewPointCloud;
+        GPP::TriMesh* mpPreviewTriMesh;
+        // Guards the requests, the preview results and the commit
+        FilterPreviewLock* mpLock;
+    };
+}
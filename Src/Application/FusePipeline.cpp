@@ -0,0 +1,410 @@
+#include "FusePipeline.h"
+#include "SparseFusePointCloud.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/LogSystem.h"
+
+namespace MagicApp
+{
+    // Color of clouds without colors when they are fused with colored clouds, it is the default point cloud color
+    static const GPP::Vector3 gFuseDefaultColor(0.09, 0.48627, 0.69);
+
+    class FieldPackTask : public MagicCore::ParallelTask
+    {
+    public:
+        FieldPackTask(const GPP::PointCloud* pointCloud, const std::vector<int>* colorIds, GPP::Real* pointFields) :
+            mpPointCloud(pointCloud),
+            mpColorIds(colorIds),
+            mpPointFields(pointFields)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            const int* colorIds = (mpColorIds && !mpColorIds->empty()) ? &((*mpColorIds)[0]) : NULL;
+            bool hasColor = mpPointCloud->HasColor();
+            GPP::Real* fields = mpPointFields + startId * FusePipeline::FIELD_DIM;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Vector3 color = hasColor ? mpPointCloud->GetPointColor(pid) : gFuseDefaultColor;
+                fields[0] = color[0];
+                fields[1] = color[1];
+                fields[2] = color[2];
+                fields[3] = colorIds ? GPP::Real(colorIds[pid]) : 0;
+                fields[4] = GPP::Real(pid);
+                fields += FusePipeline::FIELD_DIM;
+            }
+        }
+
+    private:
+        const GPP::PointCloud* mpPointCloud;
+        const std::vector<int>* mpColorIds;
+        GPP::Real* mpPointFields;
+    };
+
+    class FieldUnpackTask : public MagicCore::ParallelTask
+    {
+    public:
+        FieldUnpackTask(const GPP::Real* pointFields, GPP::PointCloud* pointCloud, int* colorIds, int* pointIds) :
+            mpPointFields(pointFields),
+            mpPointCloud(pointCloud),
+            mpColorIds(colorIds),
+            mpPointIds(pointIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            const GPP::Real* fields = mpPointFields + startId * FusePipeline::FIELD_DIM;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                mpPointCloud->SetPointColor(pid, GPP::Vector3(fields[0], fields[1], fields[2]));
+                if (mpColorIds)
+                {
+                    mpColorIds[pid] = int(fields[3]);
+                }
+                if (mpPointIds)
+                {
+                    mpPointIds[pid] = int(fields[4]);
+                }
+                fields += FusePipeline::FIELD_DIM;
+            }
+        }
+
+    private:
+        const GPP::Real* mpPointFields;
+        GPP::PointCloud* mpPointCloud;
+        int* mpColorIds;
+        int* mpPointIds;
+    };
+
+    class FieldPrepareTask : public MagicCore::ThreadTask
+    {
+    public:
+        FieldPrepareTask() :
+            mGroup(),
+            mpPointCloud(NULL),
+            mpColorIds(NULL),
+            mpPointFields(NULL)
+        {
+        }
+
+        void Setup(const GPP::PointCloud* pointCloud, const std::vector<int>* colorIds, std::vector<GPP::Real>* pointFields)
+        {
+            mpPointCloud = pointCloud;
+            mpColorIds = colorIds;
+            mpPointFields = pointFields;
+        }
+
+        virtual void Run(void)
+        {
+            if (mpPointCloud == NULL || mpPointFields == NULL || mpPointFields->empty())
+            {
+                return;
+            }
+            FieldPackTask packTask(mpPointCloud, mpColorIds, &(mpPointFields->at(0)));
+            MagicCore::ThreadPool::Get()->ParallelFor(mpPointCloud->GetPointCount(), &packTask, 4096);
+        }
+
+        MagicCore::TaskGroup mGroup;
+        const GPP::PointCloud* mpPointCloud;
+        const std::vector<int>* mpColorIds;
+        std::vector<GPP::Real>* mpPointFields;
+    };
+
+    // Adapts the accumulating backend, so the prefetching pipeline is shared by dense and sparse fusion
+    class FuseTarget
+    {
+    public:
+        FuseTarget()
+        {
+        }
+
+        virtual GPP::ErrorCode Update(const GPP::PointCloud* pointCloud, const std::vector<GPP::Real>* pointFields) = 0;
+
+        virtual ~FuseTarget()
+        {
+        }
+    };
+
+    class SumFuseTarget : public FuseTarget
+    {
+    public:
+        SumFuseTarget(GPP::SumPointCloud* sumPointCloud) :
+            mpSumPointCloud(sumPointCloud)
+        {
+        }
+
+        virtual GPP::ErrorCode Update(const GPP::PointCloud* pointCloud, const std::vector<GPP::Real>* pointFields)
+        {
+            return mpSumPointCloud->UpdateSumFunction(pointCloud, NULL, pointFields);
+        }
+
+    private:
+        GPP::SumPointCloud* mpSumPointCloud;
+    };
+
+    class SparseFuseTarget : public FuseTarget
+    {
+    public:
+        SparseFuseTarget(SparseFusePointCloud* sparsePointCloud) :
+            mpSparsePointCloud(sparsePointCloud)
+        {
+        }
+
+        virtual GPP::ErrorCode Update(const GPP::PointCloud* pointCloud, const std::vector<GPP::Real>* pointFields)
+        {
+            return mpSparsePointCloud->UpdateFuseFunction(pointCloud, NULL, pointFields);
+        }
+
+    private:
+        SparseFusePointCloud* mpSparsePointCloud;
+    };
+
+    FieldBufferPool::FieldBufferPool() :
+        mFreeBuffers(),
+        mAllBuffers()
+    {
+    }
+
+    FieldBufferPool::~FieldBufferPool()
+    {
+        Clear();
+    }
+
+    std::vector<GPP::Real>* FieldBufferPool::Acquire(GPP::Int size)
+    {
+        std::vector<GPP::Real>* buffer = NULL;
+        if (mFreeBuffers.empty())
+        {
+            buffer = new std::vector<GPP::Real>;
+            mAllBuffers.push_back(buffer);
+        }
+        else
+        {
+            // Prefer the buffer which has enough capacity already
+            int bestIndex = int(mFreeBuffers.size()) - 1;
+            for (int bid = 0; bid < int(mFreeBuffers.size()); bid++)
+            {
+                if (mFreeBuffers.at(bid)->capacity() >= size)
+                {
+                    bestIndex = bid;
+                    break;
+                }
+            }
+            buffer = mFreeBuffers.at(bestIndex);
+            mFreeBuffers.at(bestIndex) = mFreeBuffers.back();
+            mFreeBuffers.pop_back();
+        }
+        buffer->resize(size);
+        return buffer;
+    }
+
+    void FieldBufferPool::Release(std::vector<GPP::Real>* buffer)
+    {
+        if (buffer)
+        {
+            mFreeBuffers.push_back(buffer);
+        }
+    }
+
+    void FieldBufferPool::Clear()
+    {
+        for (std::vector<std::vector<GPP::Real>* >::iterator itr = mAllBuffers.begin(); itr != mAllBuffers.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mAllBuffers.clear();
+        mFreeBuffers.clear();
+    }
+
+    FusePipeline::FusePipeline() :
+        mBufferPool(),
+        mPrepareTasks(),
+        mPrefetchCount(2),
+        mHasFields(false),
+        mIsCancelled(false),
+        mProgress(0)
+    {
+    }
+
+    FusePipeline::~FusePipeline()
+    {
+        WaitPrepares();
+        for (std::vector<FieldPrepareTask*>::iterator itr = mPrepareTasks.begin(); itr != mPrepareTasks.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mPrepareTasks.clear();
+    }
+
+    void FusePipeline::SetPrefetchCount(int prefetchCount)
+    {
+        mPrefetchCount = prefetchCount < 1 ? 1 : prefetchCount;
+    }
+
+    GPP::ErrorCode FusePipeline::Run(GPP::SumPointCloud* sumPointCloud, const std::vector<GPP::PointCloud*>& pointCloudList,
+        const std::vector<std::vector<int> >* colorList, bool* hasColorInfo)
+    {
+        if (sumPointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        SumFuseTarget fuseTarget(sumPointCloud);
+        return RunTarget(&fuseTarget, pointCloudList, colorList, hasColorInfo);
+    }
+
+    GPP::ErrorCode FusePipeline::Run(SparseFusePointCloud* sparsePointCloud, const std::vector<GPP::PointCloud*>& pointCloudList,
+        const std::vector<std::vector<int> >* colorList, bool* hasColorInfo)
+    {
+        if (sparsePointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        SparseFuseTarget fuseTarget(sparsePointCloud);
+        return RunTarget(&fuseTarget, pointCloudList, colorList, hasColorInfo);
+    }
+
+    GPP::ErrorCode FusePipeline::RunTarget(FuseTarget* fuseTarget, const std::vector<GPP::PointCloud*>& pointCloudList,
+        const std::vector<std::vector<int> >* colorList, bool* hasColorInfo)
+    {
+        if (colorList && colorList->size() != pointCloudList.size())
+        {
+            colorList = NULL;
+        }
+        mIsCancelled = false;
+        mProgress = 0;
+        // Field dimension should be the same for all clouds, so all clouds have fields if any cloud has colors
+        mHasFields = false;
+        for (std::vector<GPP::PointCloud*>::const_iterator itr = pointCloudList.begin(); itr != pointCloudList.end(); ++itr)
+        {
+            if ((*itr)->HasColor())
+            {
+                mHasFields = true;
+                break;
+            }
+        }
+        if (hasColorInfo)
+        {
+            *hasColorInfo = mHasFields;
+        }
+        while (int(mPrepareTasks.size()) < mPrefetchCount)
+        {
+            mPrepareTasks.push_back(new FieldPrepareTask);
+        }
+        int pointCloudCount = pointCloudList.size();
+        for (int cid = 0; cid < mPrefetchCount; cid++)
+        {
+            StartPrepare(cid, pointCloudList, colorList);
+        }
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        for (int cid = 0; cid < pointCloudCount; cid++)
+        {
+            if (mIsCancelled)
+            {
+                InfoLog << "FusePipeline is cancelled at cloud " << cid << std::endl;
+                break;
+            }
+            FieldPrepareTask* prepareTask = mPrepareTasks.at(cid % mPrefetchCount);
+            MagicCore::ThreadPool::Get()->Wait(&(prepareTask->mGroup));
+            std::vector<GPP::Real>* pointFields = prepareTask->mpPointFields;
+            res = fuseTarget->Update(pointCloudList.at(cid), pointFields);
+            mBufferPool.Release(pointFields);
+            prepareTask->Setup(NULL, NULL, NULL);
+            if (res != GPP_NO_ERROR)
+            {
+                break;
+            }
+            StartPrepare(cid + mPrefetchCount, pointCloudList, colorList);
+            mProgress = double(cid + 1) / double(pointCloudCount);
+        }
+        WaitPrepares();
+        mBufferPool.Clear();
+        return res;
+    }
+
+    void FusePipeline::Cancel()
+    {
+        mIsCancelled = true;
+    }
+
+    bool FusePipeline::IsCancelled() const
+    {
+        return mIsCancelled;
+    }
+
+    double FusePipeline::GetProgress() const
+    {
+        return mProgress;
+    }
+
+    void FusePipeline::UnpackFields(const std::vector<GPP::Real>& pointFields, GPP::PointCloud* pointCloud,
+        std::vector<int>* colorIds, std::vector<int>* pointIds)
+    {
+        if (pointCloud == NULL)
+        {
+            return;
+        }
+        pointCloud->SetHasColor(true);
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        if (pointCount == 0 || pointFields.size() < pointCount * FIELD_DIM)
+        {
+            return;
+        }
+        int* colorIdData = NULL;
+        if (colorIds)
+        {
+            colorIds->resize(pointCount);
+            colorIdData = colorIds->empty() ? NULL : &((*colorIds)[0]);
+        }
+        int* pointIdData = NULL;
+        if (pointIds)
+        {
+            pointIds->resize(pointCount);
+            pointIdData = pointIds->empty() ? NULL : &((*pointIds)[0]);
+        }
+        FieldUnpackTask unpackTask(&(pointFields.at(0)), pointCloud, colorIdData, pointIdData);
+        MagicCore::ThreadPool::Get()->ParallelFor(pointCount, &unpackTask, 4096);
+    }
+
+    void FusePipeline::StartPrepare(int cloudId, const std::vector<GPP::PointCloud*>& pointCloudList,
+        const std::vector<std::vector<int> >* colorList)
+    {
+        if (cloudId >= int(pointCloudList.size()))
+        {
+            return;
+        }
+        FieldPrepareTask* prepareTask = mPrepareTasks.at(cloudId % mPrefetchCount);
+        const GPP::PointCloud* pointCloud = pointCloudList.at(cloudId);
+        if (mHasFields == false)
+        {
+            prepareTask->Setup(pointCloud, NULL, NULL);
+            return;
+        }
+        // Color ids are used only if there is one for every point
+        const std::vector<int>* colorIds = NULL;
+        if (colorList && cloudId < int(colorList->size()) && !colorList->at(cloudId).empty())
+        {
+            if (int(colorList->at(cloudId).size()) == pointCloud->GetPointCount())
+            {
+                colorIds = &(colorList->at(cloudId));
+            }
+            else
+            {
+                WarnLog << "FusePipeline: color id count of cloud " << cloudId << " does not match its point count" << std::endl;
+            }
+        }
+        std::vector<GPP::Real>* pointFields = mBufferPool.Acquire(pointCloud->GetPointCount() * FIELD_DIM);
+        prepareTask->Setup(pointCloud, colorIds, pointFields);
+        MagicCore::ThreadPool::Get()->Submit(prepareTask, &(prepareTask->mGroup));
+    }
+
+    void FusePipeline::WaitPrepares()
+    {
+        for (std::vector<FieldPrepareTask*>::iterator itr = mPrepareTasks.begin(); itr != mPrepareTasks.end(); ++itr)
+        {
+            MagicCore::ThreadPool::Get()->Wait(&((*itr)->mGroup));
+            mBufferPool.Release((*itr)->mpPointFields);
+            (*itr)->Setup(NULL, NULL, NULL);
+        }
+    }
+}
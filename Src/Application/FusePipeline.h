@@ -0,0 +1,80 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Field buffers are reused between point clouds instead of being reallocated for every cloud.
+    // It is only accessed by the thread which drives the pipeline.
+    class FieldBufferPool
+    {
+    public:
+        FieldBufferPool();
+        ~FieldBufferPool();
+
+        // Returned buffer is resized to size, its content is undefined
+        std::vector<GPP::Real>* Acquire(GPP::Int size);
+        void Release(std::vector<GPP::Real>* buffer);
+        void Clear(void);
+
+    private:
+        std::vector<std::vector<GPP::Real>* > mFreeBuffers;
+        std::vector<std::vector<GPP::Real>* > mAllBuffers;
+    };
+
+    class FieldPrepareTask;
+    class FuseTarget;
+    class SparseFusePointCloud;
+
+    // Streams a point cloud list into SumPointCloud or SparseFusePointCloud. Field buffers of the next clouds are packed on
+    // worker threads while the current cloud is accumulated.
+    // Field layout per point: color[0], color[1], color[2], colorId, pointId
+    class FusePipeline
+    {
+    public:
+        enum
+        {
+            FIELD_DIM = 5
+        };
+
+        FusePipeline();
+        ~FusePipeline();
+
+        // How many clouds are prepared ahead of the accumulating one, default is 2
+        void SetPrefetchCount(int prefetchCount);
+
+        // colorList could be NULL, or colorList->size() == pointCloudList.size()
+        // hasColorInfo: whether any cloud has colors, then every cloud is fused with fields and
+        // clouds without colors take the default color
+        // If it is cancelled, return GPP_NO_ERROR and IsCancelled() == true
+        GPP::ErrorCode Run(GPP::SumPointCloud* sumPointCloud, const std::vector<GPP::PointCloud*>& pointCloudList,
+            const std::vector<std::vector<int> >* colorList, bool* hasColorInfo);
+        GPP::ErrorCode Run(SparseFusePointCloud* sparsePointCloud, const std::vector<GPP::PointCloud*>& pointCloudList,
+            const std::vector<std::vector<int> >* colorList, bool* hasColorInfo);
+
+        // Could be called from any thread
+        void Cancel(void);
+        bool IsCancelled(void) const;
+        // progress value range: [0, 1]
+        double GetProgress(void) const;
+
+        // Unpack fused fields: colors are set into pointCloud, colorIds and pointIds could be NULL
+        static void UnpackFields(const std::vector<GPP::Real>& pointFields, GPP::PointCloud* pointCloud,
+            std::vector<int>* colorIds, std::vector<int>* pointIds);
+
+    private:
+        GPP::ErrorCode RunTarget(FuseTarget* fuseTarget, const std::vector<GPP::PointCloud*>& pointCloudList,
+            const std::vector<std::vector<int> >* colorList, bool* hasColorInfo);
+        void StartPrepare(int cloudId, const std::vector<GPP::PointCloud*>& pointCloudList,
+            const std::vector<std::vector<int> >* colorList);
+        void WaitPrepares(void);
+
+    private:
+        FieldBufferPool mBufferPool;
+        std::vector<FieldPrepareTask*> mPrepareTasks;
+        int mPrefetchCount;
+        bool mHasFields;
+        volatile bool mIsCancelled;
+        double mProgress;
+    };
+}
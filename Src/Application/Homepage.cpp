@@ -9,6 +9,7 @@
 #include "MeasureApp.h"
 #include "ReliefApp.h"
 #include "DepthVideoApp.h"
+#include "DumpReplayRunner.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -16,6 +17,10 @@
 
 namespace MagicApp
 {
+#if DEBUGDUMPFILE
+    static const int gReplayRepeatCount = 5;
+#endif
+
     Homepage::Homepage() :
         mpUI(NULL),
         mpViewTool(NULL),
@@ -120,6 +125,12 @@ namespace MagicApp
         {
 #if DEBUGDUMPFILE
             RunDumpInfo();
+#endif
+        }
+        else if (arg.key == OIS::KC_P)
+        {
+#if DEBUGDUMPFILE
+            ReplayDumpFiles();
 #endif
         }
         else if (arg.key == OIS::KC_V)
@@ -156,7 +167,7 @@ namespace MagicApp
             mpDumpInfo = GPP::DumpManager::Get()->GetDumpInstance(dumpApiName);
             if (mpDumpInfo == NULL)
             {
-                MessageBox(NULL, "dumpļʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "dump文件打开失败", "温馨提示", MB_OK);
                 return;
             }
             mpDumpInfo->LoadDumpFile(fileName);
@@ -214,22 +225,62 @@ namespace MagicApp
         }
     }
 
+    void Homepage::ReplayDumpFiles()
+    {
+        std::vector<std::string> fileNames;
+        char filterName[] = "Dump Files(*.dump)\0*.dump\0";
+        if (!MagicCore::ToolKit::MultiFileOpenDlg(fileNames, filterName) || fileNames.empty())
+        {
+            return;
+        }
+        DumpReplayRunner runner;
+        if (MessageBox(NULL, "是否选择基准文件对比性能？", "温馨提示", MB_YESNO) == IDYES)
+        {
+            std::string baselineName;
+            char baselineFilterName[] = "Replay Files(*.csv)\0*.csv\0";
+            if (MagicCore::ToolKit::FileOpenDlg(baselineName, baselineFilterName) && !runner.LoadBaseline(baselineName))
+            {
+                MessageBox(NULL, "基准文件读取失败", "温馨提示", MB_OK);
+            }
+        }
+        if (runner.RunFiles(fileNames, gReplayRepeatCount) == 0)
+        {
+            MessageBox(NULL, "dump文件执行失败", "温馨提示", MB_OK);
+            return;
+        }
+        std::string fileName;
+        char saveFilterName[] = "Replay Files(*.csv)\0*.csv\0";
+        if (MagicCore::ToolKit::FileSaveDlg(fileName, saveFilterName))
+        {
+            std::string noSuffixName = MagicCore::ToolKit::GetNoSuffixName(fileName);
+            if (noSuffixName.empty())
+            {
+                noSuffixName = fileName;
+            }
+            runner.SaveRecords(noSuffixName + ".csv");
+            runner.SaveComparison(noSuffixName + "_compare.txt");
+        }
+        std::stringstream ss;
+        ss << "回放" << runner.GetRecords().size() << "个dump文件，性能退化" << runner.GetRegressionCount() << "个";
+        MessageBox(NULL, ss.str().c_str(), "温馨提示", MB_OK);
+    }
+
     void Homepage::RunDumpInfo()
     {
         if (mpDumpInfo == NULL)
         {
-            MessageBox(NULL, "ȵdumpļ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入dump文件", "温馨提示", MB_OK);
             return;
         }
         GPP::ErrorCode res = mpDumpInfo->Run();
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "dumpļִʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行失败", "温馨提示", MB_OK);
             //return;
         }
         else
         {
-            MessageBox(NULL, "dumpļִгɹ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行成功", "温馨提示", MB_OK);
         }
 
         if (mpDumpInfo->GetPointCloud(0) != NULL)
@@ -250,7 +301,7 @@ namespace MagicApp
             UpdateModelRendering();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(copiedTriMesh) == false)
             {
-                MessageBox(NULL, "зνṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格有非流形结构", "温馨提示", MB_OK);
             }
         }
     }
@@ -299,7 +350,7 @@ namespace MagicApp
             ModelManager::Get()->ClearMesh();
             if (ModelManager::Get()->ImportPointCloud(fileName) == false)
             {
-                MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpUI->SetModelInfo(ModelManager::Get()->GetPointCloud()->GetPointCount(), 0);
@@ -316,7 +367,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -337,7 +388,7 @@ namespace MagicApp
                 size_t dotPos = fileName.rfind('.');
                 if (dotPos == std::string::npos)
                 {
-                    MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::ErrorCode res = GPP_NO_ERROR;
@@ -348,6 +399,8 @@ namespace MagicApp
                     triMesh->UnifyCoords(1.0 / scaleValue, objCenterCoord * (-scaleValue));
                     res = GPP::Parser::ExportTriMesh(fileName, triMesh);
                     triMesh->UnifyCoords(scaleValue, objCenterCoord);
+                    // The round trip could change the last bits of the coordinates
+                    ModelManager::Get()->IncreaseMeshGeneration(triMesh);
                 }
                 else
                 {
@@ -355,7 +408,7 @@ namespace MagicApp
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "񵼳ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格导出失败", "温馨提示", MB_OK);
                 }
             }
         }
@@ -371,7 +424,7 @@ namespace MagicApp
                     size_t dotPos = fileName.rfind('.');
                     if (dotPos == std::string::npos)
                     {
-                        MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                         return;
                     }
                     GPP::ErrorCode res = GPP_NO_ERROR;
@@ -389,7 +442,7 @@ namespace MagicApp
                     }
                     if (res != GPP_NO_ERROR)
                     {
-                        MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
                     }
                 }
             }
@@ -42,6 +42,8 @@ namespace MagicApp
 #if DEBUGDUMPFILE
         void LoadDumpFile(void);
         void RunDumpInfo(void);
+        // Replay the selected dumps headless and save their timing, compared with a baseline replay
+        void ReplayDumpFiles(void);
 #endif
 
     private:
@@ -9,15 +9,27 @@
 #include "../Common/ViewTool.h"
 #include "../Common/PickTool.h"
 #include "../Common/RenderSystem.h"
+#include "../Common/MeshQueryEngine.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/HeatGeodesics.h"
+#include "../Common/MeshCurvature.h"
+#include "../Common/MeshSlicer.h"
+#include "../Common/MeshThickness.h"
 #if DEBUGDUMPFILE
 #include "DumpMeasureMesh.h"
 #include "DumpSplitMesh.h"
 #include "DumpOptimiseCurve.h"
 #endif
 #include <numeric>
+#include <cfloat>
 
 namespace MagicApp
 {
+    static const int gBatchSectionCount = 200;
+    // Thickness is traced on a sampled subset of the vertices and interpolated to the others
+    static const GPP::Int gThicknessPreviewSampleCount = 4096;
+    static const GPP::Int gThicknessMaxSampleCount = 262144;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         MeasureApp* app = (MeasureApp*)arg;
@@ -29,6 +41,59 @@ namespace MagicApp
         return 1;
     }
 
+#if DEVELOPSTATE
+    // Log how far the cached curvature is from the GPP reference: the share of vertices whose sign agrees, and the
+    // least squares scale that maps the cached values onto the reference. Both should stay near 1.
+    static void CompareCurvature(const char* name, const std::vector<GPP::Real>& values, const std::vector<GPP::Real>& reference)
+    {
+        if (values.size() != reference.size() || values.empty())
+        {
+            WarnLog << "CompareCurvature " << name << ": size " << values.size() << " != " << reference.size() << std::endl;
+            return;
+        }
+        GPP::Int signCount = 0;
+        GPP::Int agreeCount = 0;
+        GPP::Real crossSum = 0;
+        GPP::Real squaredSum = 0;
+        for (std::vector<GPP::Real>::size_type vid = 0; vid < values.size(); vid++)
+        {
+            crossSum += values.at(vid) * reference.at(vid);
+            squaredSum += values.at(vid) * values.at(vid);
+            if (fabs(values.at(vid)) > GPP::REAL_TOL && fabs(reference.at(vid)) > GPP::REAL_TOL)
+            {
+                signCount++;
+                if ((values.at(vid) > 0) == (reference.at(vid) > 0))
+                {
+                    agreeCount++;
+                }
+            }
+        }
+        DebugLog << "CompareCurvature " << name << ": sign agreement " << (signCount > 0 ? GPP::Real(agreeCount) / signCount : 1.0)
+            << " scale " << (squaredSum > 0 ? crossSum / squaredSum : 1.0) << std::endl;
+    }
+
+    static void CompareMeshCurvature(const GPP::ITriMesh* triMesh, const MagicCore::MeshCurvature* meshCurvature)
+    {
+        std::vector<GPP::Real> meanCurvature;
+        if (GPP::MeasureMesh::ComputeMeanCurvature(triMesh, meanCurvature) == GPP_NO_ERROR)
+        {
+            CompareCurvature("mean", meshCurvature->GetMeanCurvature(), meanCurvature);
+        }
+        std::vector<GPP::Real> gaussCurvature;
+        if (GPP::MeasureMesh::ComputeGaussCurvature(triMesh, gaussCurvature) == GPP_NO_ERROR)
+        {
+            CompareCurvature("gauss", meshCurvature->GetGaussCurvature(), gaussCurvature);
+        }
+        std::vector<GPP::Real> minCurvature, maxCurvature;
+        std::vector<GPP::Vector3> minDirs, maxDirs;
+        if (GPP::MeasureMesh::ComputePrincipalCurvature(triMesh, minCurvature, maxCurvature, minDirs, maxDirs) == GPP_NO_ERROR)
+        {
+            CompareCurvature("min", meshCurvature->GetMinCurvature(), minCurvature);
+            CompareCurvature("max", meshCurvature->GetMaxCurvature(), maxCurvature);
+        }
+    }
+#endif
+
     MeasureApp::MeasureApp() :
         mpUI(NULL),
         mpViewTool(NULL),
@@ -49,6 +114,8 @@ namespace MagicApp
         mIsFlatRenderingMode(true),
         mpRefTriMesh(NULL),
         mUpdateRefModelRendering(false),
+        mThicknessColors(),
+        mUpdateThicknessColors(false),
         mMinCurvature(),
         mMaxCurvature(),
         mMinCurvatureDirs(),
@@ -56,7 +123,9 @@ namespace MagicApp
         mCurvatureFlags(),
         mDisplayPrincipalCurvature(0),
         mCurvatureWeight(0),
-        mIsGeodesicsClose(false)
+        mIsGeodesicsClose(false),
+        mCurveSegmentCache(),
+        mSectionFileName()
     {
         mDetectOptions[0] = true;
         mDetectOptions[1] = true;
@@ -69,6 +138,7 @@ namespace MagicApp
         GPPFREEPOINTER(mpUI);        
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        ModelManager::Get()->ReleaseMeshQueryEngine(mpRefTriMesh);
         GPPFREEPOINTER(mpRefTriMesh);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
@@ -100,6 +170,20 @@ namespace MagicApp
             UpdateMarkRendering();
             mUpdateMarkRendering = false;
         }
+        if (mUpdateThicknessColors)
+        {
+            GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+            if (triMesh != NULL && triMesh->GetVertexCount() == mThicknessColors.size())
+            {
+                triMesh->SetHasVertexColor(true);
+                for (GPP::Int vid = 0; vid < triMesh->GetVertexCount(); ++vid)
+                {
+                    triMesh->SetVertexColor(vid, mThicknessColors.at(vid));
+                }
+                mUpdateModelRendering = true;
+            }
+            mUpdateThicknessColors = false;
+        }
         if (mUpdateModelRendering)
         {
             UpdateModelRendering();
@@ -169,6 +253,7 @@ namespace MagicApp
         {
             if (mpPickTool)
             {
+                mpPickTool->SetMeshQueryEngine(ModelManager::Get()->GetMeshQueryEngine(ModelManager::Get()->GetMesh()));
                 mpPickTool->MouseReleased(arg.state.X.abs, arg.state.Y.abs);
                 GPP::Int pickedId = -1;
                 pickedId = mpPickTool->GetPickVertexId();
@@ -208,12 +293,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (faceId < 0)
         {
-            MessageBox(NULL, "invalid faceId", "ܰʾ", MB_OK);
+            MessageBox(NULL, "invalid faceId", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::DetectShape::PrimitiveType> typeOptions;
@@ -241,7 +326,7 @@ namespace MagicApp
         typeRes = GPP::DetectShape::PRIMITIVE_TYPE_PLANE;*/
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "SelectPrimitive Failed", "ܰʾ", MB_OK);
+            MessageBox(NULL, "SelectPrimitive Failed", "温馨提示", MB_OK);
             return;
         }
         triMesh->SetHasTriangleColor(true);
@@ -278,7 +363,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -312,7 +397,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::DetectShape::DetectPrimitives(triMesh, &typeOptions, &types, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "DetectPrimitives failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "DetectPrimitives failed", "温馨提示", MB_OK);
                 return;
             }
             triMesh->SetHasTriangleColor(true);
@@ -717,12 +802,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, topCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "topCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "topCurve Smooth Failed", "温馨提示", MB_OK);
             }
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, downCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "downCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "downCurve Smooth Failed", "温馨提示", MB_OK);
             }
             for (int vid = 0; vid < stringSize; vid++)
             {
@@ -868,12 +953,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, topCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "topCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "topCurve Smooth Failed", "温馨提示", MB_OK);
             }
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, downCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "downCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "downCurve Smooth Failed", "温馨提示", MB_OK);
             }
             for (int vid = 0; vid < stringSize; vid++)
             {
@@ -896,7 +981,7 @@ namespace MagicApp
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, leftCurves, GPP::ONE_RADIAN * 60, 0.2, 10);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "leftCurves Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "leftCurves Smooth Failed", "温馨提示", MB_OK);
             }
             sectionVertexIds.clear();
             sectionVertexIds.push_back(topCurve.at(stringSize - 1));
@@ -910,7 +995,7 @@ namespace MagicApp
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, rightCurves, GPP::ONE_RADIAN * 60, 0.2, 10);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "rightCurves Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "rightCurves Smooth Failed", "温馨提示", MB_OK);
             }
             std::vector<bool> vertexMark(originVertexCount, 0);
             for (std::vector<int>::const_iterator itr = topCurve.begin(); itr != topCurve.end(); ++itr)
@@ -1090,12 +1175,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, topCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "topCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "topCurve Smooth Failed", "温馨提示", MB_OK);
             }
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, downCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "downCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "downCurve Smooth Failed", "温馨提示", MB_OK);
             }
 
             std::vector<bool> vertexMark(originVertexCount, 0);
@@ -1234,12 +1319,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, topCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "topCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "topCurve Smooth Failed", "温馨提示", MB_OK);
             }
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, downCurve, GPP::ONE_RADIAN * 60, controlSmoothWeight, controlSmoothCount);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "downCurve Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "downCurve Smooth Failed", "温馨提示", MB_OK);
             }
 
             std::vector<int> sectionVertexIds;
@@ -1255,7 +1340,7 @@ namespace MagicApp
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, leftCurves, GPP::ONE_RADIAN * 60, 0.2, 10);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "leftCurves Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "leftCurves Smooth Failed", "温馨提示", MB_OK);
             }
             sectionVertexIds.clear();
             sectionVertexIds.push_back(topCurve.at(stringSize - 1));
@@ -1269,7 +1354,7 @@ namespace MagicApp
             res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, rightCurves, GPP::ONE_RADIAN * 60, 0.2, 10);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "rightCurves Smooth Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "rightCurves Smooth Failed", "温馨提示", MB_OK);
             }
             std::vector<bool> vertexMark(originVertexCount, 0);
             for (std::vector<int>::const_iterator itr = topCurve.begin(); itr != topCurve.end(); ++itr)
@@ -1610,11 +1695,11 @@ namespace MagicApp
 
                 if (isIntersected)
                 {
-                    MessageBox(NULL, "Խ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "曲线有自交", "温馨提示", MB_OK);
                 }
                 else
                 {
-                    MessageBox(NULL, "Խ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "曲线无自交", "温馨提示", MB_OK);
                 }
             }
         }
@@ -1622,6 +1707,14 @@ namespace MagicApp
         {
             SetSelectPrimitiveMode();
         }
+        else if (arg.key == OIS::KC_D)
+        {
+            ComputeHeatGeodesics();
+        }
+        else if (arg.key == OIS::KC_B)
+        {
+            ExportBatchSections();
+        }
 
         return true;
     }
@@ -1673,11 +1766,13 @@ namespace MagicApp
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        ModelManager::Get()->ReleaseMeshQueryEngine(mpRefTriMesh);
         GPPFREEPOINTER(mpRefTriMesh);
         ModelManager::Get()->SetMeshInfo(NULL);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
+        mCurveSegmentCache.Clear();
         ClearSelectionData();
         mMinCurvature.clear();
         mMaxCurvature.clear();
@@ -1685,6 +1780,8 @@ namespace MagicApp
         mMaxCurvatureDirs.clear();
         mCurvatureFlags.clear();
         mDisplayPrincipalCurvature = 0;
+        // A running thickness command does not wait for the colors any more
+        mUpdateThicknessColors = false;
     }
 
     void MeasureApp::ClearSelectionData()
@@ -1744,6 +1841,12 @@ namespace MagicApp
             case MagicApp::MeasureApp::DETECT_PRIMITIVE:
                 DetectPrimitive(false);
                 break;
+            case MagicApp::MeasureApp::GEODESICS_HEAT:
+                ComputeHeatGeodesics(false);
+                break;
+            case MagicApp::MeasureApp::BATCH_SECTION:
+                ExportBatchSections(false);
+                break;
             default:
                 break;
             }
@@ -1755,7 +1858,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -1930,14 +2033,14 @@ namespace MagicApp
         {
             mRightMouseType = SELECT_VERTEX;
             mpPickTool->SetPickParameter(MagicCore::PM_POINT, true, NULL, triMesh, "ModelNode");
-            MessageBox(NULL, "Ŀǰѡ񶥵", "ܰʾ", MB_OK);
+            MessageBox(NULL, "目前仅能选择网格顶点", "温馨提示", MB_OK);
             
         }
         else
         {
             mRightMouseType = SELECT_FACEPOINT;
             mpPickTool->SetPickParameter(MagicCore::PM_FACEPOINT, true, NULL, triMesh, "ModelNode");
-            MessageBox(NULL, "Ŀǰѡ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "目前仅能选择网格面点", "温馨提示", MB_OK);
         }
         ClearSelectionData();
         mUpdateMarkRendering = true;
@@ -1957,7 +2060,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -1978,6 +2081,7 @@ namespace MagicApp
             GPPFREEPOINTER(mpPickTool);
             mpPickTool = new MagicCore::PickTool;
             mpPickTool->SetPickParameter(mRightMouseType == SELECT_VERTEX ? MagicCore::PM_POINT : MagicCore::PM_FACEPOINT, true, NULL, triMesh, "ModelNode");
+            ModelManager::Get()->ReleaseMeshQueryEngine(mpRefTriMesh);
             GPPFREEPOINTER(mpRefTriMesh);
             UpdateRefModelRendering();
             return true;
@@ -1993,7 +2097,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -2002,11 +2106,12 @@ namespace MagicApp
         {
             mpUI->SetGeodesicsInfo(0);
             ModelManager::Get()->ClearPointCloud();
+            ModelManager::Get()->ReleaseMeshQueryEngine(mpRefTriMesh);
             GPPFREEPOINTER(mpRefTriMesh);
             mpRefTriMesh = GPP::Parser::ImportTriMesh(fileName);
             if (mpRefTriMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             mpRefTriMesh->UnifyCoords(ModelManager::Get()->GetScaleValue(), ModelManager::Get()->GetObjCenterCoord());
@@ -2093,132 +2198,328 @@ namespace MagicApp
         }
     }
 
-    void MeasureApp::ComputeSectionCurve(bool isSubThread)
+    // The piece is a list of PointOnEdge which is converted to face points on the command thread
+    static bool IsEdgePathCurve(int curveType, bool isVertexMark)
     {
-        if (IsCommandAvaliable() == false)
+        if (curveType == CURVE_FACE_POINT)
         {
-            return;
+            return false;
         }
-        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-        GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
-        if (triMesh == NULL)
+        else if (curveType == CURVE_FAST_EXACT_GEODESICS)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
-            return;
+            return isVertexMark;
         }
-        else if (mMarkIds.size() < 2 && mMarkFacePoints.size() < 2)
+        return true;
+    }
+
+    class CurveSegmentTask : public MagicCore::ParallelTask
+    {
+    public:
+        CurveSegmentTask(int curveType, GPP::Real parameter, const GPP::TriMesh* triMesh, GPP::TriMeshInfo* meshInfo,
+            const std::vector<GPP::Int>* markIds, const std::vector<GPP::PointOnFace>* markPofs, GPP::Real averageEdgeLength,
+            const std::vector<int>* segmentIds, std::vector<std::vector<GPP::PointOnEdge> >* edgePaths,
+            std::vector<CurveSegment>* segments, std::vector<GPP::ErrorCode>* results) :
+            mCurveType(curveType),
+            mParameter(parameter),
+            mpTriMesh(triMesh),
+            mpMeshInfo(meshInfo),
+            mpMarkIds(markIds),
+            mpMarkPofs(markPofs),
+            mAverageEdgeLength(averageEdgeLength),
+            mpSegmentIds(segmentIds),
+            mpEdgePaths(edgePaths),
+            mpSegments(segments),
+            mpResults(results)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
-            return;
         }
 
-        if (isSubThread)
+        virtual void Run(int startId, int endId)
         {
-            mCommandType = SECTION_CURVE;
-            DoCommand(true);
+            for (int iid = startId; iid < endId; iid++)
+            {
+                mpResults->at(iid) = SolveSegment(mpSegmentIds->at(iid), mpEdgePaths->at(iid), mpSegments->at(iid));
+            }
         }
-        else
+
+    private:
+        GPP::ErrorCode SolveSegment(int segmentId, std::vector<GPP::PointOnEdge>& edgePath, CurveSegment& segment) const
         {
-            mMarkPoints.clear();
-            mGeodesicsOnPofs.clear();
-            if (!mMarkIds.empty())
+            int markCount = mpMarkPofs->size();
+            int nextId = (segmentId + 1) % markCount;
+            bool isVertexMark = !mpMarkIds->empty();
+            std::vector<GPP::Int> sectionIds;
+            std::vector<GPP::PointOnFace> sectionPofs;
+            if (isVertexMark)
+            {
+                sectionIds.push_back(mpMarkIds->at(segmentId));
+                sectionIds.push_back(mpMarkIds->at(nextId));
+            }
+            sectionPofs.push_back(mpMarkPofs->at(segmentId));
+            sectionPofs.push_back(mpMarkPofs->at(nextId));
+            std::vector<GPP::Vector3> pathPoints;
+            GPP::Real distance = 0;
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            switch (mCurveType)
             {
-                GPP::Vector3 coords[3];
-                int markSize = mMarkIds.size();
-                static bool useOldMethod = false;
-                useOldMethod = !useOldMethod;
-                for (int mid = 1; mid <= markSize; mid++)
+            case CURVE_SECTION:
+                if (isVertexMark)
                 {
-                    if (!mIsGeodesicsClose && mid == markSize)
-                    {
-                        break;
-                    }
-                    int curMarkId = mMarkIds.at(mid % markSize);
-                    int preMarkId = mMarkIds.at(mid - 1);
-                    std::vector<GPP::PointOnEdge> pathPointInfos;
-                    coords[0] = triMesh->GetVertexCoord(preMarkId);
-                    coords[1] = triMesh->GetVertexCoord(curMarkId);
+                    GPP::Vector3 coords[3];
+                    coords[0] = mpTriMesh->GetVertexCoord(sectionIds.at(0));
+                    coords[1] = mpTriMesh->GetVertexCoord(sectionIds.at(1));
                     double normalDistance = (coords[0] - coords[1]).Length();
-                    coords[2] = (coords[0] + triMesh->GetVertexNormal(preMarkId) * normalDistance + 
-                        coords[1] + triMesh->GetVertexNormal(curMarkId) * normalDistance) / 2.0;
+                    coords[2] = (coords[0] + mpTriMesh->GetVertexNormal(sectionIds.at(0)) * normalDistance + 
+                        coords[1] + mpTriMesh->GetVertexNormal(sectionIds.at(1)) * normalDistance) / 2.0;
                     GPP::Plane3 cuttingPlane(coords[0], coords[1], coords[2]);
-                    GPP::ErrorCode res = GPP::OptimiseCurve::ConnectVertexByCuttingPlane(triMesh, preMarkId, curMarkId,
-                        cuttingPlane, pathPointInfos);//, useOldMethod);
-                    mIsCommandInProgress = false;
-                    if (res != GPP_NO_ERROR)
+                    res = GPP::OptimiseCurve::ConnectVertexByCuttingPlane(mpTriMesh, sectionIds.at(0), sectionIds.at(1),
+                        cuttingPlane, edgePath);
+                }
+                else
+                {
+                    const GPP::PointOnFace& prePof = sectionPofs.at(0);
+                    const GPP::PointOnFace& curPof = sectionPofs.at(1);
+                    GPP::Vector3 coords[3];
+                    coords[0] = GetCoord(curPof, mpTriMesh);
+                    coords[1] = GetCoord(prePof, mpTriMesh);
+                    double normalDistance = (coords[0] - coords[1]).Length();
+                    coords[2] = (coords[0] + GetNormal(prePof, mpTriMesh) * normalDistance + 
+                        coords[1] + GetCoord(curPof, mpTriMesh) * normalDistance) / 2.0;
+                    GPP::Plane3 cuttingPlane(coords[0], coords[1], coords[2]);
+                    res = GPP::OptimiseCurve::_ConnectFacePointsByCuttingPlane(mpTriMesh, mpMeshInfo, prePof, curPof, cuttingPlane, edgePath);
+                }
+                break;
+            case CURVE_FACE_POINT:
+                res = GPP::OptimiseCurve::ConnectFacePointsOnMesh(mpTriMesh, sectionPofs, false, mAverageEdgeLength, segment.mPathPofs);
+                break;
+            case CURVE_APPROXIMATE_GEODESICS:
+                {
+                    std::vector<GPP::Int> pathIds;
+                    if (isVertexMark)
                     {
-                        MessageBox(NULL, "߼ʧ", "ܰʾ", MB_OK);
-                        return;
+                        res = GPP::MeasureMesh::ComputeApproximateGeodesics(mpTriMesh, sectionIds, false, pathIds, distance);
                     }
-                    for (int pid = 0; pid < pathPointInfos.size(); pid++)
+                    else
                     {
-                        GPP::PointOnEdge curPoint = pathPointInfos.at(pid);
-                        mGeodesicsOnPofs.push_back(CreatePofOnEdge(curPoint, triMesh, meshInfo));
-                        if (curPoint.mVertexIdEnd == -1)
-                        {
-                            mMarkPoints.push_back(triMesh->GetVertexCoord(curPoint.mVertexIdStart));
-                        }
-                        else
-                        {
-                            mMarkPoints.push_back(triMesh->GetVertexCoord(curPoint.mVertexIdStart) * curPoint.mWeight + 
-                                triMesh->GetVertexCoord(curPoint.mVertexIdEnd) * (1.0 - curPoint.mWeight));
-                        }
+                        res = GPP::MeasureMesh::_ComputeApproximateGeodesics(mpTriMesh, mpMeshInfo, sectionPofs.at(0), sectionPofs.at(1), pathIds, distance);
+                    }
+                    for (int pid = 0; pid < pathIds.size(); pid++)
+                    {
+                        edgePath.push_back(GPP::PointOnEdge(pathIds.at(pid), -1, 1.0));
                     }
                 }
+                break;
+            case CURVE_FAST_EXACT_GEODESICS:
+                if (isVertexMark)
+                {
+                    res = GPP::MeasureMesh::FastComputeExactGeodesics(mpTriMesh, sectionIds, false, pathPoints, distance, &edgePath, mParameter);
+                }
+                else
+                {
+                    res = GPP::MeasureMesh::FastComputeExactGeodesics(mpTriMesh, sectionPofs, false, pathPoints, distance, &(segment.mPathPofs), mParameter);
+                }
+                break;
+            case CURVE_EXACT_GEODESICS:
+                res = GPP::MeasureMesh::ComputeExactGeodesics(mpTriMesh, sectionIds, false, pathPoints, distance, &edgePath);
+                break;
+            default:
+                res = GPP_INVALID_INPUT;
+                break;
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
             }
-            else if (!mMarkFacePoints.empty())
+            for (int pid = 0; pid < segment.mPathPofs.size(); pid++)
             {
-                GPP::Vector3 coords[3];
-                int markSize = mMarkFacePoints.size();
-                GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
-                for (int mid = 1; mid <= markSize; mid++)
+                segment.mPathCoords.push_back(GetCoord(segment.mPathPofs.at(pid), mpTriMesh));
+            }
+            return GPP_NO_ERROR;
+        }
+
+    private:
+        int mCurveType;
+        GPP::Real mParameter;
+        const GPP::TriMesh* mpTriMesh;
+        GPP::TriMeshInfo* mpMeshInfo;
+        const std::vector<GPP::Int>* mpMarkIds;
+        const std::vector<GPP::PointOnFace>* mpMarkPofs;
+        GPP::Real mAverageEdgeLength;
+        const std::vector<int>* mpSegmentIds;
+        std::vector<std::vector<GPP::PointOnEdge> >* mpEdgePaths;
+        std::vector<CurveSegment>* mpSegments;
+        std::vector<GPP::ErrorCode>* mpResults;
+    };
+
+    GPP::ErrorCode MeasureApp::ComputeCurveBySegments(int curveType, GPP::Real parameter, CurveSegment& curve)
+    {
+        curve = CurveSegment();
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
+        // TriMeshInfo caches its data at the first query, so fill it before the workers share it
+        GPP::ErrorCode res = meshInfo->CacheDataForEdgeInfos(triMesh, true);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        res = meshInfo->CacheDataForVertexNbrFaceMaps(triMesh);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        bool isVertexMark = !mMarkIds.empty();
+        std::vector<GPP::PointOnFace> markPofs;
+        if (isVertexMark)
+        {
+            markPofs.resize(mMarkIds.size());
+            for (int mid = 0; mid < mMarkIds.size(); mid++)
+            {
+                markPofs.at(mid) = CreatePofOnVertex(mMarkIds.at(mid), triMesh, meshInfo);
+            }
+        }
+        else
+        {
+            markPofs = mMarkFacePoints;
+        }
+        int markCount = markPofs.size();
+        int segmentCount = mIsGeodesicsClose ? markCount : markCount - 1;
+        GPP::Real averageEdgeLength = 0;
+        if (curveType == CURVE_FACE_POINT)
+        {
+            res = GPP::CalculateAverageEdgeLength(triMesh, averageEdgeLength);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+        }
+
+        mCurveSegmentCache.SetMesh(triMesh, ModelManager::Get()->GetMeshGeneration(triMesh));
+        std::vector<CurveSegmentKey> segmentKeys(segmentCount);
+        std::vector<const CurveSegment*> segments(segmentCount, NULL);
+        std::vector<int> missingIds;
+        for (int sid = 0; sid < segmentCount; sid++)
+        {
+            int nextId = (sid + 1) % markCount;
+            if (isVertexMark)
+            {
+                segmentKeys.at(sid) = CurveSegmentKey(curveType, parameter, mMarkIds.at(sid), mMarkIds.at(nextId));
+            }
+            else
+            {
+                segmentKeys.at(sid) = CurveSegmentKey(curveType, parameter, markPofs.at(sid), markPofs.at(nextId));
+            }
+            segments.at(sid) = mCurveSegmentCache.Find(segmentKeys.at(sid));
+            if (segments.at(sid) == NULL)
+            {
+                missingIds.push_back(sid);
+            }
+        }
+
+        int missingCount = missingIds.size();
+        std::vector<CurveSegment> solvedSegments(missingCount);
+        if (missingCount > 0)
+        {
+            std::vector<std::vector<GPP::PointOnEdge> > edgePaths(missingCount);
+            std::vector<GPP::ErrorCode> results(missingCount, GPP_NO_ERROR);
+            CurveSegmentTask segmentTask(curveType, parameter, triMesh, meshInfo, &mMarkIds, &markPofs, averageEdgeLength,
+                &missingIds, &edgePaths, &solvedSegments, &results);
+            MagicCore::ThreadPool::Get()->ParallelFor(missingCount, &segmentTask, 1);
+            bool isEdgePath = IsEdgePathCurve(curveType, isVertexMark);
+            for (int mid = 0; mid < missingCount; mid++)
+            {
+                if (results.at(mid) != GPP_NO_ERROR)
                 {
-                    if (!mIsGeodesicsClose && mid == markSize)
+                    return results.at(mid);
+                }
+                CurveSegment& segment = solvedSegments.at(mid);
+                if (isEdgePath)
+                {
+                    int sid = missingIds.at(mid);
+                    if (!isVertexMark)
                     {
-                        break;
+                        segment.mPathPofs.push_back(markPofs.at(sid));
+                        segment.mPathCoords.push_back(GetCoord(markPofs.at(sid), triMesh));
                     }
-                    const GPP::PointOnFace& curPof = mMarkFacePoints.at(mid % markSize);
-                    const GPP::PointOnFace& prePof = mMarkFacePoints.at(mid - 1);
-                    std::vector<GPP::PointOnEdge> pathPointInfos;
-                    coords[0] = GetCoord(curPof, triMesh);
-                    coords[1] = GetCoord(prePof, triMesh);
-                    double normalDistance = (coords[0] - coords[1]).Length();
-                    coords[2] = (coords[0] + GetNormal(prePof, triMesh) * normalDistance + 
-                        coords[1] + GetCoord(curPof, triMesh) * normalDistance) / 2.0;
-                    GPP::Plane3 cuttingPlane(coords[0], coords[1], coords[2]);
-                    GPP::ErrorCode res = GPP::OptimiseCurve::_ConnectFacePointsByCuttingPlane(triMesh, meshInfo, prePof, curPof, cuttingPlane, pathPointInfos);
-                    mIsCommandInProgress = false;
-                    if (res != GPP_NO_ERROR)
+                    const std::vector<GPP::PointOnEdge>& edgePath = edgePaths.at(mid);
+                    for (int pid = 0; pid < edgePath.size(); pid++)
                     {
-                        MessageBox(NULL, "߼ʧ", "ܰʾ", MB_OK);
-                        return;
+                        const GPP::PointOnEdge& edgePoint = edgePath.at(pid);
+                        segment.mPathPofs.push_back(CreatePofOnEdge(edgePoint, triMesh, meshInfo));
+                        segment.mPathCoords.push_back(GetCoord(edgePoint, triMesh));
+                        if (isVertexMark && curveType == CURVE_APPROXIMATE_GEODESICS)
+                        {
+                            segment.mPathVertexIds.push_back(edgePoint.mVertexIdStart);
+                        }
                     }
-                    mMarkPoints.push_back(GetCoord(prePof, triMesh));
-                    mGeodesicsOnPofs.push_back(prePof);
-                    for (int pid = 0; pid < pathPointInfos.size(); pid++)
+                    if (!isVertexMark)
                     {
-                        const GPP::PointOnEdge& curPoint = pathPointInfos.at(pid);
-                        mMarkPoints.push_back(GetCoord(curPoint, triMesh));
-                        mGeodesicsOnPofs.push_back(CreatePofOnEdge(curPoint, triMesh, meshInfo));
+                        int nextId = (sid + 1) % markCount;
+                        segment.mPathPofs.push_back(markPofs.at(nextId));
+                        segment.mPathCoords.push_back(GetCoord(markPofs.at(nextId), triMesh));
                     }
                 }
-                if (!mIsGeodesicsClose)
-                {
-                    mMarkPoints.push_back(GetCoord(mMarkFacePoints.back(), triMesh));
-                    mGeodesicsOnPofs.push_back(mMarkFacePoints.back());
-                }
-                else
-                {
-                    mMarkPoints.push_back(mMarkPoints.front());
-                    mGeodesicsOnPofs.push_back(mMarkFacePoints.front());
-                }
+                segments.at(missingIds.at(mid)) = &segment;
             }
-            double distance = 0.0;
-            for (int mid = 1; mid < mMarkPoints.size(); mid++)
+        }
+        for (int sid = 0; sid < segmentCount; sid++)
+        {
+            CurveSegmentCache::JoinSegment(*(segments.at(sid)), curve);
+        }
+        // Insert may drop cached pieces, so it is done after they are joined
+        for (int mid = 0; mid < missingCount; mid++)
+        {
+            mCurveSegmentCache.Insert(segmentKeys.at(missingIds.at(mid)), solvedSegments.at(mid));
+        }
+        DebugLog << "ComputeCurveBySegments: " << segmentCount << " segments, " << missingCount << " solved" << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    static GPP::Real CalculatePolylineLength(const std::vector<GPP::Vector3>& polyline)
+    {
+        GPP::Real length = 0.0;
+        for (int pid = 1; pid < polyline.size(); pid++)
+        {
+            length += (polyline.at(pid) - polyline.at(pid - 1)).Length();
+        }
+        return length;
+    }
+
+    void MeasureApp::ComputeSectionCurve(bool isSubThread)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL)
+        {
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
+            return;
+        }
+        else if (mMarkIds.size() < 2 && mMarkFacePoints.size() < 2)
+        {
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
+            return;
+        }
+
+        if (isSubThread)
+        {
+            mCommandType = SECTION_CURVE;
+            DoCommand(true);
+        }
+        else
+        {
+            mMarkPoints.clear();
+            mGeodesicsOnPofs.clear();
+            CurveSegment curve;
+            GPP::ErrorCode res = ComputeCurveBySegments(CURVE_SECTION, 0, curve);
+            if (res != GPP_NO_ERROR)
             {
-                distance += (mMarkPoints.at(mid) - mMarkPoints.at(mid - 1)).Length();
+                MessageBox(NULL, "截面线计算失败", "温馨提示", MB_OK);
+                return;
             }
-            mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
+            mGeodesicsOnPofs.swap(curve.mPathPofs);
+            mMarkPoints.swap(curve.mPathCoords);
+            mpUI->SetGeodesicsInfo(CalculatePolylineLength(mMarkPoints) / ModelManager::Get()->GetScaleValue());
             mUpdateMarkRendering = true;
         }
     }
@@ -2232,12 +2533,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkFacePoints.size() < 2 && mMarkIds.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
 
@@ -2250,63 +2551,19 @@ namespace MagicApp
         {
             mMarkPoints.clear();
             mGeodesicsOnPofs.clear();
-            if (!mMarkFacePoints.empty())
-            {
-                GPP::Real averageEdgeLength;
-                GPP::ErrorCode res = GPP::CalculateAverageEdgeLength(triMesh, averageEdgeLength);
 #if MAKEDUMPFILE
-                GPP::DumpOnce();
-#endif
-                res = GPP::OptimiseCurve::ConnectFacePointsOnMesh(triMesh, mMarkFacePoints, mIsGeodesicsClose, averageEdgeLength, mGeodesicsOnPofs);
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "߼ʧ", "ܰʾ", MB_OK);
-                    return;
-                }
-                for (int pid = 0; pid < mGeodesicsOnPofs.size(); ++pid)
-                {
-                    mMarkPoints.push_back(GetCoord(mGeodesicsOnPofs.at(pid), triMesh));
-                }
-            }
-            else if (!mMarkIds.empty())
-            {
-                //GPP::TriMeshInfo meshInfo;
-                //GPP::ErrorCode res = meshInfo.CacheData(triMesh, GPP::TriMeshInfo::TOPOLOGY_EDGEINFOS_TWOWAYS);
-                //if (res != GPP_NO_ERROR)
-                //{
-                //    MessageBox(NULL, "߼ʧ", "ܰʾ", MB_OK);
-                //    return;
-                //}
-                GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
-                GPP::Real averageEdgeLength;
-                GPP::ErrorCode res = GPP::CalculateAverageEdgeLength(triMesh, averageEdgeLength);
-                res = meshInfo->CacheDataForVertexNbrFaceMaps(triMesh);
-                std::vector<GPP::PointOnFace> onVertexPofs(mMarkIds.size());
-                for (int pid = 0; pid < mMarkIds.size(); ++pid)
-                {
-                    onVertexPofs.at(pid) = CreatePofOnVertex(mMarkIds.at(pid), triMesh, meshInfo);
-                }
-#if MAKEDUMPFILE
-                GPP::DumpOnce();
+            GPP::DumpOnce();
 #endif
-                res = GPP::OptimiseCurve::ConnectFacePointsOnMesh(triMesh, onVertexPofs, mIsGeodesicsClose, averageEdgeLength, mGeodesicsOnPofs);
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "߼ʧ", "ܰʾ", MB_OK);
-                    return;
-                }
-                for (int pid = 0; pid < mGeodesicsOnPofs.size(); ++pid)
-                {
-                    mMarkPoints.push_back(GetCoord(mGeodesicsOnPofs.at(pid), triMesh));
-                }
-            }
-        
-            double distance = 0.0;
-            for (int mid = 1; mid < mMarkPoints.size(); mid++)
+            CurveSegment curve;
+            GPP::ErrorCode res = ComputeCurveBySegments(CURVE_FACE_POINT, 0, curve);
+            if (res != GPP_NO_ERROR)
             {
-                distance += (mMarkPoints.at(mid) - mMarkPoints.at(mid - 1)).Length();
+                MessageBox(NULL, "网格曲线计算失败", "温馨提示", MB_OK);
+                return;
             }
-            mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
+            mGeodesicsOnPofs.swap(curve.mPathPofs);
+            mMarkPoints.swap(curve.mPathCoords);
+            mpUI->SetGeodesicsInfo(CalculatePolylineLength(mMarkPoints) / ModelManager::Get()->GetScaleValue());
             mUpdateMarkRendering = true;
         }
     }
@@ -2320,12 +2577,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mGeodesicsOnVertices.empty())
         {
-            MessageBox(NULL, "ڲѡ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择中心曲线", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::vector<GPP::PointOnFace> > topCurve, downCurve;
@@ -2336,7 +2593,7 @@ namespace MagicApp
             offsetSize, topCurve, downCurve);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Ⱦ߼ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "等距曲线计算失败", "温馨提示", MB_OK);
             return;
         }
         for (std::vector<std::vector<GPP::PointOnFace> >::iterator citr = topCurve.begin(); citr != topCurve.end(); ++citr)
@@ -2386,12 +2643,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ༭", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要编辑的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mGeodesicsOnPofs.empty() && mCurvesOnMesh.empty() && mGeodesicsOnVertices.empty())
         {
-            MessageBox(NULL, "Ҫе", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先生成需要剪切的曲线", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2438,7 +2695,7 @@ namespace MagicApp
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "иʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "切割网格失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -2459,7 +2716,7 @@ namespace MagicApp
             res = GPP::SplitMesh::SplitByLines(triMesh, splitLines);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "иʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "生成切割后的网格失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
@@ -2474,6 +2731,7 @@ namespace MagicApp
             std::vector<GPP::Vector3> markPointBackup;
             AssignVertexColorBySegmentIds(triMesh, vertexSegIds);
             ModelManager::Get()->SetMeshInfo(NULL);
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
 
             ClearSelectionData();
             mUpdateMarkRendering = true;
@@ -2490,12 +2748,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2 && mMarkFacePoints.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2507,89 +2765,264 @@ namespace MagicApp
         {
             mGeodesicsOnVertices.clear();
             mGeodesicsOnPofs.clear();
-            GPP::Real distance = 0;
+            mMarkPoints.clear();
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
             mIsCommandInProgress = true;
-            GPP::ErrorCode res = GPP_NO_ERROR;
+            CurveSegment curve;
+            GPP::ErrorCode res = ComputeCurveBySegments(CURVE_APPROXIMATE_GEODESICS, 0, curve);
+            mIsCommandInProgress = false;
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
+                return;
+            }
             if (!mMarkIds.empty())
             {
-                res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, mGeodesicsOnVertices, distance);
-                mMarkPoints.clear();
-                if (res == GPP_NO_ERROR)
+                mGeodesicsOnVertices.swap(curve.mPathVertexIds);
+            }
+            else
+            {
+                mGeodesicsOnPofs.swap(curve.mPathPofs);
+            }
+            mMarkPoints.swap(curve.mPathCoords);
+            mpUI->SetGeodesicsInfo(CalculatePolylineLength(mMarkPoints) / ModelManager::Get()->GetScaleValue());
+            mUpdateMarkRendering = true;
+        }
+    }
+
+    // Isolines of heat distance fields are drawn at this count of levels
+    static const int gHeatIsolineCount = 20;
+
+    static void ColorByHeatDistance(GPP::TriMesh* triMesh, const std::vector<std::vector<GPP::Real> >& distances)
+    {
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        std::vector<GPP::Real> nearestDistances(vertexCount, GPP::REAL_LARGE);
+        GPP::Real maxDistance = 0;
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            for (int fieldId = 0; fieldId < distances.size(); fieldId++)
+            {
+                nearestDistances.at(vid) = std::min(nearestDistances.at(vid), distances.at(fieldId).at(vid));
+            }
+            if (nearestDistances.at(vid) < GPP::REAL_LARGE && nearestDistances.at(vid) > maxDistance)
+            {
+                maxDistance = nearestDistances.at(vid);
+            }
+        }
+        if (maxDistance < GPP::REAL_TOL)
+        {
+            maxDistance = 1.0;
+        }
+        GPP::Real isolineSpace = maxDistance / gHeatIsolineCount;
+        triMesh->SetHasVertexColor(true);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            GPP::Real dist = nearestDistances.at(vid);
+            if (dist >= GPP::REAL_LARGE)
+            {
+                triMesh->SetVertexColor(vid, GPP::Vector3(0.5, 0.5, 0.5));
+                continue;
+            }
+            GPP::Vector3 color = MagicCore::ToolKit::ColorCoding(0.2 + 0.8 * dist / maxDistance);
+            GPP::Real levelPosition = dist / isolineSpace;
+            if (levelPosition - floor(levelPosition) < 0.1)
+            {
+                color = color * 0.3;
+            }
+            triMesh->SetVertexColor(vid, color);
+        }
+    }
+
+    void MeasureApp::ComputeHeatGeodesics(bool isSubThread)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL)
+        {
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
+            return;
+        }
+        else if (mMarkIds.empty() && mMarkFacePoints.empty())
+        {
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
+            return;
+        }
+        if (isSubThread)
+        {
+            mCommandType = GEODESICS_HEAT;
+            DoCommand(true);
+        }
+        else
+        {
+            mGeodesicsOnVertices.clear();
+            mGeodesicsOnPofs.clear();
+            mMarkPoints.clear();
+            mIsCommandInProgress = true;
+            // Face marks start from their nearest face vertex
+            std::vector<GPP::Int> sourceIds = mMarkIds;
+            if (sourceIds.empty())
+            {
+                for (std::vector<GPP::PointOnFace>::iterator itr = mMarkFacePoints.begin(); itr != mMarkFacePoints.end(); ++itr)
                 {
-                    for (std::vector<GPP::Int>::iterator pathItr = mGeodesicsOnVertices.begin(); pathItr != mGeodesicsOnVertices.end(); ++pathItr)
-                    {
-                        mMarkPoints.push_back(triMesh->GetVertexCoord(*pathItr));
-                    }
-                    if (mIsGeodesicsClose)
+                    GPP::Int faceVertexIds[3];
+                    triMesh->GetTriangleVertexIds(itr->mFaceId, faceVertexIds);
+                    int maxId = 0;
+                    for (int fvid = 1; fvid < 3; fvid++)
                     {
-                        mMarkPoints.push_back(mMarkPoints.front());
-                        mGeodesicsOnVertices.push_back(mGeodesicsOnVertices.front());
+                        if (itr->mCoord[fvid] > itr->mCoord[maxId])
+                        {
+                            maxId = fvid;
+                        }
                     }
+                    sourceIds.push_back(faceVertexIds[maxId]);
                 }
             }
-            else if (!mMarkFacePoints.empty())
+            int markCount = sourceIds.size();
+            std::vector<std::vector<GPP::Int> > sourceSets(markCount);
+            for (int mid = 0; mid < markCount; mid++)
             {
-                GPP::Real totalDistance = 0.0;
-                int sections = mMarkFacePoints.size();
-                if (!mIsGeodesicsClose)
-                {
-                    sections--;
-                }
-                mMarkPoints.clear();
-                mGeodesicsOnPofs.clear();
-                GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
-                for (int sid = 0; sid < sections; ++sid)
+                sourceSets.at(mid).push_back(sourceIds.at(mid));
+            }
+            std::vector<std::vector<GPP::Real> > distances;
+            GPP::ErrorCode res = GPP_INVALID_RESULT;
+            MagicCore::HeatGeodesics* heatGeodesics = ModelManager::Get()->GetHeatGeodesics(triMesh);
+            if (heatGeodesics != NULL)
+            {
+                res = heatGeodesics->ComputeDistances(sourceSets, distances);
+            }
+            // Mark i goes down the distance field of mark i + 1
+            GPP::Real geodesicsDistance = 0;
+            int segmentCount = markCount < 2 ? 0 : (mIsGeodesicsClose ? markCount : markCount - 1);
+            for (int sid = 0; sid < segmentCount && res == GPP_NO_ERROR; sid++)
+            {
+                int endMarkId = (sid + 1) % markCount;
+                const std::vector<GPP::Real>& endDistances = distances.at(endMarkId);
+                if (endDistances.at(sourceIds.at(sid)) >= GPP::REAL_LARGE)
                 {
-                    int nextId = sid + 1;
-                    if (mIsGeodesicsClose && sid == sections - 1)
-                    {
-                        nextId = 0;
-                    }
-                    const GPP::PointOnFace& startPof = mMarkFacePoints.at(sid);
-                    const GPP::PointOnFace& endPof = mMarkFacePoints.at(nextId);
-                    std::vector<GPP::Int> internalPathIds;
-                    res = GPP::MeasureMesh::_ComputeApproximateGeodesics(triMesh, meshInfo, startPof, endPof, internalPathIds, distance);
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
-                        return;
-                    }
-                    mMarkPoints.push_back(GetCoord(startPof, triMesh));
-                    mGeodesicsOnPofs.push_back(startPof);
-                    for (int pid = 0; pid < internalPathIds.size(); ++pid)
-                    {
-                        GPP::Int vertexId = internalPathIds.at(pid);
-                        mMarkPoints.push_back(triMesh->GetVertexCoord(vertexId));
-                        mGeodesicsOnPofs.push_back(CreatePofOnVertex(vertexId, triMesh, meshInfo));
-                    }
+                    res = GPP_INVALID_INPUT;
+                    break;
                 }
-                if (mIsGeodesicsClose)
+                geodesicsDistance += endDistances.at(sourceIds.at(sid));
+                std::vector<GPP::Int> pathVertexIds;
+                res = heatGeodesics->TracePath(endDistances, sourceIds.at(sid), pathVertexIds);
+                if (res != GPP_NO_ERROR)
                 {
-                    mMarkPoints.push_back(GetCoord(mMarkFacePoints.front(), triMesh));
-                    mGeodesicsOnPofs.push_back(mMarkFacePoints.front());
+                    break;
                 }
-                else
+                // The descent could stop at a local minimum of a coarse distance field
+                if (pathVertexIds.empty() || pathVertexIds.back() != sourceIds.at(endMarkId))
                 {
-                    mMarkPoints.push_back(GetCoord(mMarkFacePoints.back(), triMesh));
-                    mGeodesicsOnPofs.push_back(mMarkFacePoints.back());
+                    WarnLog << "MeasureApp::ComputeHeatGeodesics: path " << sid << " stops before its end mark" << std::endl;
+                    res = GPP_INVALID_RESULT;
+                    break;
                 }
+                int startId = mGeodesicsOnVertices.empty() ? 0 : 1;
+                mGeodesicsOnVertices.insert(mGeodesicsOnVertices.end(), pathVertexIds.begin() + startId, pathVertexIds.end());
             }
-            mIsCommandInProgress = false;
-            if (res == GPP_API_IS_NOT_AVAILABLE)
+            if (res == GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                MagicCore::ToolKit::Get()->SetAppRunning(false);
+                ColorByHeatDistance(triMesh, distances);
             }
+            mIsCommandInProgress = false;
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                mGeodesicsOnVertices.clear();
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
-            mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
+            for (std::vector<GPP::Int>::iterator itr = mGeodesicsOnVertices.begin(); itr != mGeodesicsOnVertices.end(); ++itr)
+            {
+                mMarkPoints.push_back(triMesh->GetVertexCoord(*itr));
+            }
+            if (mMarkIds.empty())
+            {
+                mGeodesicsOnVertices.clear();
+            }
+            // The distance fields are closer to the true geodesics than the traced edge path
+            mpUI->SetGeodesicsInfo(geodesicsDistance / ModelManager::Get()->GetScaleValue());
             mUpdateMarkRendering = true;
+            mUpdateModelRendering = true;
+        }
+    }
+
+    void MeasureApp::ExportBatchSections(bool isSubThread)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh == NULL)
+        {
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
+            return;
+        }
+        if (isSubThread)
+        {
+            std::string fileName;
+            char filterName[] = "Section Files(*.txt)\0*.txt\0";
+            if (MagicCore::ToolKit::FileSaveDlg(fileName, filterName) == false)
+            {
+                return;
+            }
+            mSectionFileName = fileName;
+            mCommandType = BATCH_SECTION;
+            DoCommand(true);
+        }
+        else
+        {
+            // Sections are perpendicular to the line from the first mark to the second one, or to the z axis
+            std::vector<GPP::Vector3> markCoords;
+            for (std::vector<GPP::Int>::iterator itr = mMarkIds.begin(); itr != mMarkIds.end(); ++itr)
+            {
+                markCoords.push_back(triMesh->GetVertexCoord(*itr));
+            }
+            for (std::vector<GPP::PointOnFace>::iterator itr = mMarkFacePoints.begin(); itr != mMarkFacePoints.end(); ++itr)
+            {
+                markCoords.push_back(GetCoord(*itr, triMesh));
+            }
+            GPP::Vector3 sweepDirection(0, 0, 1);
+            if (markCoords.size() >= 2 && (markCoords.at(1) - markCoords.at(0)).Length() > GPP::REAL_TOL)
+            {
+                sweepDirection = markCoords.at(1) - markCoords.at(0);
+            }
+            mIsCommandInProgress = true;
+            MagicCore::MeshSlicer slicer;
+            GPP::ErrorCode res = slicer.Init(triMesh, sweepDirection);
+            std::vector<MagicCore::SliceStatistics> statistics;
+            if (res == GPP_NO_ERROR)
+            {
+                std::vector<GPP::Real> heights;
+                slicer.GetUniformHeights(gBatchSectionCount, heights);
+                // Sections are written in the coordinates of the imported model
+                GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
+                res = slicer.SliceToFile(heights, mSectionFileName, 1.0 / scaleValue, ModelManager::Get()->GetObjCenterCoord(),
+                    &statistics);
+            }
+            mIsCommandInProgress = false;
+            if (res != GPP_NO_ERROR)
+            {
+                MessageBox(NULL, "截面导出失败", "温馨提示", MB_OK);
+                return;
+            }
+            GPP::Real maxArea = 0;
+            for (std::vector<MagicCore::SliceStatistics>::iterator itr = statistics.begin(); itr != statistics.end(); ++itr)
+            {
+                maxArea = std::max(maxArea, itr->area);
+            }
+            std::stringstream ss;
+            ss << "已导出" << statistics.size() << "个截面，最大截面积" << maxArea;
+            MessageBox(NULL, ss.str().c_str(), "温馨提示", MB_OK);
         }
     }
 
@@ -2603,19 +3036,19 @@ namespace MagicApp
         int vertexCount = triMesh->GetVertexCount();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {
             if (mMarkFacePoints.size() > 0)
             {
-                MessageBox(NULL, "֧񶥵㣬ѡģʽ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "该命令仅支持网格顶点，请调整选择模式", "温馨提示", MB_OK);
                 return;
             }
             else
             {
-                MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             }
             return;
         }
@@ -2633,13 +3066,14 @@ namespace MagicApp
             mIsCommandInProgress = true;
             GPP::TriangleList triangleList(triMesh);
             int vertexCount = triMesh->GetVertexCount();
-            if (mCurvatureFlags.empty())
+            if (mCurvatureFlags.size() != vertexCount && !LoadPrincipalCurvature(triMesh))
             {
-                mMaxCurvature.resize(vertexCount, 0);
-                mMinCurvature.resize(vertexCount, 0);
-                mMaxCurvatureDirs.resize(vertexCount);
-                mMinCurvatureDirs.resize(vertexCount);
-                mCurvatureFlags.resize(vertexCount, 0);
+                // Let the distance compute the curvature of the visited vertices
+                mMaxCurvature.assign(vertexCount, 0);
+                mMinCurvature.assign(vertexCount, 0);
+                mMaxCurvatureDirs.assign(vertexCount, GPP::Vector3());
+                mMinCurvatureDirs.assign(vertexCount, GPP::Vector3());
+                mCurvatureFlags.assign(vertexCount, 0);
             }
             GPP::PrincipalCurvatureDistance dirDistance(&triangleList, &mMinCurvature, &mMaxCurvature, 
                 &mMinCurvatureDirs, &mMaxCurvatureDirs, &mCurvatureFlags, false, curvatureWeight);
@@ -2649,12 +3083,12 @@ namespace MagicApp
                 maxGeodesics, maxDistance, &dirDistance);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -2666,12 +3100,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -2711,7 +3145,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -2722,12 +3156,12 @@ namespace MagicApp
             GPP::ONE_RADIAN * 60, 0.2, 10, true, &optimizedCurve);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ϵĲŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "顶点上的测地线优化失败", "温馨提示", MB_OK);
             return;
         }
         mGeodesicsOnVertices.swap(optimizedCurve);
@@ -2763,7 +3197,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -2773,7 +3207,7 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OptimiseCurve::ExtractSimpleCurve(mGeodesicsOnVertices, simpleCurve);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ϵĲŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "顶点上的测地线优化失败", "温馨提示", MB_OK);
             return;
         }
         mGeodesicsOnVertices.swap(simpleCurve);
@@ -2786,12 +3220,12 @@ namespace MagicApp
         res = GPP::OptimiseCurve::SmoothCurveCrossMesh(triMesh, curve, 0.75, 20, smoothCurve);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ϵĲŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "顶点上的测地线优化失败", "温馨提示", MB_OK);
             return;
         }
         mMarkPoints.clear();
@@ -2837,15 +3271,14 @@ namespace MagicApp
             return;
         }
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-        GPP::TriMeshInfo* meshInfo = ModelManager::Get()->GetMeshInfo();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2 && mMarkFacePoints.size() < 2)
         {
-            MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2856,57 +3289,28 @@ namespace MagicApp
         }
         else
         {
-            std::vector<GPP::Vector3> pathPoints;
-            std::vector<GPP::PointOnEdge> pathInfos;
             mGeodesicsOnPofs.clear();
-            GPP::Real distance = 0;
-            GPP::ErrorCode res = GPP_NO_ERROR;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
             mIsCommandInProgress = true;
-            if (!mMarkIds.empty())
-            {
-                res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, 
-                    pathPoints, distance, &pathInfos, accuracy);
-                if (res == GPP_NO_ERROR)
-                {
-                    for (int pid = 0; pid < pathInfos.size(); ++pid)
-                    {
-                        mGeodesicsOnPofs.push_back(CreatePofOnEdge(pathInfos.at(pid), triMesh, meshInfo));
-                    }
-                }
-            }
-            else if (!mMarkFacePoints.empty())
-            {
-                //res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, mMarkFacePoints, mIsGeodesicsClose,
-                //    pathPoints, distance, NULL, accuracy);
-                res = GPP::MeasureMesh::FastComputeExactGeodesics(triMesh, mMarkFacePoints, 
-                    mIsGeodesicsClose, pathPoints, distance, &mGeodesicsOnPofs, accuracy);
-                if (res == GPP_NO_ERROR)
-                {
-                    std::vector<GPP::Vector3> pathPts(mGeodesicsOnPofs.size());
-                    for (int pid = 0; pid < mGeodesicsOnPofs.size(); ++pid)
-                    {
-                        pathPts.at(pid) = GetCoord(mGeodesicsOnPofs.at(pid), triMesh);
-                    }
-                    pathPoints.swap(pathPts);
-                }
-            }
+            CurveSegment curve;
+            GPP::ErrorCode res = ComputeCurveBySegments(CURVE_FAST_EXACT_GEODESICS, accuracy, curve);
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
-            mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
+            mGeodesicsOnPofs.swap(curve.mPathPofs);
             mMarkPoints.clear();
-            mMarkPoints.swap(pathPoints);
+            mMarkPoints.swap(curve.mPathCoords);
+            mpUI->SetGeodesicsInfo(CalculatePolylineLength(mMarkPoints) / ModelManager::Get()->GetScaleValue());
             mUpdateMarkRendering = true;
         }
     }
@@ -2920,25 +3324,25 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         else if (mMarkIds.size() < 2)
         {            
             if (mMarkFacePoints.size() > 0)
             {
-                MessageBox(NULL, "֧񶥵㣬ѡģʽ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "该命令仅支持网格顶点，请调整选择模式", "温馨提示", MB_OK);
                 return;
             }
             else
             {
-                MessageBox(NULL, "ڲѡǵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请在测量的网格上选择标记点", "温馨提示", MB_OK);
                 return;
             }
         }
         else if (triMesh->GetVertexCount() > 200000 && isSubThread)
         {
-            if (MessageBox(NULL, "񶥵200kʱȽϳǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+            if (MessageBox(NULL, "测量网格顶点大于200k，测量时间会比较长，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
             {
                 return;
             }
@@ -2950,28 +3354,26 @@ namespace MagicApp
         }
         else
         {
-            std::vector<GPP::Vector3> pathPoints;
-            std::vector<GPP::PointOnEdge> pathInfos;
-            GPP::Real distance = 0;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
             mIsCommandInProgress = true;
-            GPP::ErrorCode res = GPP::MeasureMesh::ComputeExactGeodesics(triMesh, mMarkIds, mIsGeodesicsClose, pathPoints, distance, &pathInfos);
+            CurveSegment curve;
+            GPP::ErrorCode res = ComputeCurveBySegments(CURVE_EXACT_GEODESICS, 0, curve);
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
-            mpUI->SetGeodesicsInfo(distance / ModelManager::Get()->GetScaleValue());
             mMarkPoints.clear();
-            mMarkPoints.swap(pathPoints);
+            mMarkPoints.swap(curve.mPathCoords);
+            mpUI->SetGeodesicsInfo(CalculatePolylineLength(mMarkPoints) / ModelManager::Get()->GetScaleValue());
             mUpdateMarkRendering = true;
         }
     }
@@ -2985,14 +3387,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         GPP::Real area = 0;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeArea(triMesh, area);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -3011,14 +3413,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         GPP::Real volume = 0;
         GPP::ErrorCode res = GPP::MeasureMesh::ComputeVolume(triMesh, volume);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -3037,24 +3439,25 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
-        std::vector<GPP::Real> curvature;
-        GPP::ErrorCode res = GPP::MeasureMesh::ComputeMeanCurvature(triMesh, curvature);
-        if (res == GPP_API_IS_NOT_AVAILABLE)
-        {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-            MagicCore::ToolKit::Get()->SetAppRunning(false);
-        }
-        if (res != GPP_NO_ERROR)
+        // Cached until the mesh is edited, switching the display mode does not compute it again
+        MagicCore::MeshCurvature* meshCurvature = ModelManager::Get()->GetMeshCurvature(triMesh);
+        if (meshCurvature == NULL)
         {
+            MessageBox(NULL, "曲率计算失败", "温馨提示", MB_OK);
             return;
         }
+        const std::vector<GPP::Real>& curvature = meshCurvature->GetMeanCurvature();
+#if DEVELOPSTATE
+        CompareMeshCurvature(triMesh, meshCurvature);
+#endif
         GPP::Int vertexCount = triMesh->GetVertexCount();
         triMesh->SetHasVertexColor(true);
         for (GPP::Int vid = 0; vid < vertexCount; vid++)
         {
+            // H = (k1 + k2) / 2 in units of the unified mesh, a sphere filling the unit box has H = 1 and shows 0.7
             triMesh->SetVertexColor(vid, MagicCore::ToolKit::ColorCoding(0.6 + curvature.at(vid) / 10.0));
         }
         mDisplayPrincipalCurvature = 0;
@@ -3071,20 +3474,17 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
-        std::vector<GPP::Real> curvature;
-        GPP::ErrorCode res = GPP::MeasureMesh::ComputeGaussCurvature(triMesh, curvature);
-        if (res == GPP_API_IS_NOT_AVAILABLE)
-        {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-            MagicCore::ToolKit::Get()->SetAppRunning(false);
-        }
-        if (res != GPP_NO_ERROR)
+        MagicCore::MeshCurvature* meshCurvature = ModelManager::Get()->GetMeshCurvature(triMesh);
+        if (meshCurvature == NULL)
         {
+            MessageBox(NULL, "曲率计算失败", "温馨提示", MB_OK);
             return;
         }
+        // Only the sign of the angle deficit matters here, the values are scaled by their median below
+        const std::vector<GPP::Real>& curvature = meshCurvature->GetGaussCurvature();
 
         std::vector<GPP::Real> curvatureCopy = curvature;
         for (std::vector<GPP::Real>::iterator citr = curvatureCopy.begin(); citr != curvatureCopy.end(); ++citr)
@@ -3121,7 +3521,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼Ҫ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -3137,29 +3537,32 @@ namespace MagicApp
             }
             else
             {
-#if MAKEDUMPFILE
-                GPP::DumpOnce();
-#endif
-                GPP::ErrorCode res = GPP::MeasureMesh::ComputePrincipalCurvature(triMesh, mMinCurvature, mMaxCurvature, 
-                    mMinCurvatureDirs, mMaxCurvatureDirs);
-                if (res == GPP_API_IS_NOT_AVAILABLE)
+                if (!LoadPrincipalCurvature(triMesh))
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "ʼʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "主曲率计算失败", "温馨提示", MB_OK);
                     return;
                 }
-                mCurvatureFlags.clear();
-                mCurvatureFlags.resize(triMesh->GetVertexCount(), 1);
                 mDisplayPrincipalCurvature = 1;
             }
             mUpdateMarkRendering = true;
         }
     }
 
+    bool MeasureApp::LoadPrincipalCurvature(GPP::TriMesh* triMesh)
+    {
+        MagicCore::MeshCurvature* meshCurvature = ModelManager::Get()->GetMeshCurvature(triMesh);
+        if (meshCurvature == NULL)
+        {
+            return false;
+        }
+        mMinCurvature = meshCurvature->GetMinCurvature();
+        mMaxCurvature = meshCurvature->GetMaxCurvature();
+        mMinCurvatureDirs = meshCurvature->GetMinCurvatureDirs();
+        mMaxCurvatureDirs = meshCurvature->GetMaxCurvatureDirs();
+        mCurvatureFlags.assign(triMesh->GetVertexCount(), true);
+        return true;
+    }
+
     void MeasureApp::MeasureThickness(bool isSubThread)
     {
         if (IsCommandAvaliable() == false)
@@ -3168,7 +3571,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
 
@@ -3180,38 +3583,60 @@ namespace MagicApp
         else
         {
             GPP::TriMesh* measureMesh = ModelManager::Get()->GetMesh();
-            std::vector<GPP::Real> thickness;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::MeasureMesh::ComputeThickness(measureMesh, thickness);
-            if (res != GPP_NO_ERROR)
+            MagicCore::MeshQueryEngine* queryEngine = ModelManager::Get()->GetMeshQueryEngine(measureMesh);
+            if (queryEngine == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "计算厚度失败", "温馨提示", MB_OK);
                 return ;
             }
-
-            measureMesh->SetHasVertexColor(true);
-            GPP::Real maxValue = *std::max_element(thickness.begin(), thickness.end());
-            GPP::Real minValue = *std::min_element(thickness.begin(), thickness.end());
-            GPP::Real unChangedMaxValue = maxValue;
-            if (maxValue < GPP::REAL_TOL)
+            mIsCommandInProgress = true;
+            MagicCore::MeshThickness meshThickness;
+            GPP::ErrorCode res = meshThickness.Init(measureMesh, queryEngine, GPP::ONE_RADIAN * 120);
+            // A sparse preview is shown first, then every level traces four times more samples
+            for (GPP::Int sampleCount = gThicknessPreviewSampleCount; res == GPP_NO_ERROR; sampleCount *= 4)
             {
-                maxValue = 1.0;
+                res = meshThickness.Refine(sampleCount);
+                if (res != GPP_NO_ERROR)
+                {
+                    break;
+                }
+                std::vector<GPP::Real> thickness = meshThickness.GetThickness();
+                // The mesh is rendered on the UI thread meanwhile, so the colors go to a separate buffer
+                std::vector<GPP::Vector3> colors(thickness.size());
+                for (GPP::Int vid = 0; vid < thickness.size(); ++vid)
+                {
+                    colors.at(vid) = MagicCore::ToolKit::ColorCoding(thickness.at(vid) + 0.2);
+                }
+                bool isLastLevel = meshThickness.IsComplete() || sampleCount >= gThicknessMaxSampleCount;
+                // A level is skipped if the previous one is not applied yet, the last one waits for it
+                while (isLastLevel && mUpdateThicknessColors)
+                {
+                    Sleep(1);
+                }
+                if (!mUpdateThicknessColors)
+                {
+                    mThicknessColors.swap(colors);
+                    mUpdateThicknessColors = true;
+                }
+                GPP::Int halfVId = thickness.size() / 2;
+                std::nth_element(thickness.begin(), thickness.begin() + halfVId, thickness.end());
+                GPP::Real midValue = thickness.at(halfVId);
+                InfoLog << "Median thickness is: " << midValue << " sampleCount=" << meshThickness.GetSampleCount() << std::endl;
+                mpUI->SetThicknessInfo(true, midValue / ModelManager::Get()->GetScaleValue());
+                if (isLastLevel)
+                {
+                    break;
+                }
             }
-            for (GPP::Int vid = 0; vid < measureMesh->GetVertexCount(); ++vid)
+            mIsCommandInProgress = false;
+            if (res != GPP_NO_ERROR)
             {
-                GPP::Real dist = thickness.at(vid);
-                GPP::Vector3 color = MagicCore::ToolKit::ColorCoding(dist + 0.2);
-                measureMesh->SetVertexColor(vid, color);
+                MessageBox(NULL, "计算厚度失败", "温馨提示", MB_OK);
+                return;
             }
-            GPP::Int halfVId = thickness.size() / 2;
-            std::nth_element(thickness.begin(), thickness.begin() + halfVId, thickness.end());
-            GPP::Real midValue = thickness.at(halfVId);
-            InfoLog << "Median thickness is: " << midValue << std::endl;
-            mpUI->SetThicknessInfo(true, midValue / ModelManager::Get()->GetScaleValue());
-
-            mUpdateModelRendering = true;
         }
     }
 
@@ -3223,12 +3648,12 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵҪ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要测量的网格", "温馨提示", MB_OK);
             return;
         }
         if (mpRefTriMesh == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考网格", "温馨提示", MB_OK);
             return;
         }
 
@@ -3246,22 +3671,17 @@ namespace MagicApp
                 points.at(pid) = measureMesh->GetVertexCoord(pid);
             }
             std::vector<GPP::Real> distances;
-            GPP::MeshQueryTool queryTool;
-            GPP::ErrorCode res = queryTool.Init(mpRefTriMesh);
-            if (res != GPP_NO_ERROR)
+            // Query engine of the reference mesh is cached, so only the first run builds it
+            MagicCore::MeshQueryEngine* queryEngine = ModelManager::Get()->GetMeshQueryEngine(mpRefTriMesh);
+            if (queryEngine == NULL)
             {
-                MessageBox(NULL, "빤߳ʼʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格距离工具初始化失败", "温馨提示", MB_OK);
                 return;
             }
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            res = queryTool.QueryNearestTriangles(points, NULL, &distances);
-            if (res != GPP_NO_ERROR)
-            {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
-                return;
-            }
+            queryEngine->QueryNearestTriangles(points, DBL_MAX, NULL, &distances, NULL);
             measureMesh->SetHasVertexColor(true);
             GPP::Real maxValue = *std::max_element(distances.begin(), distances.end());
             GPP::Real minValue = *std::min_element(distances.begin(), distances.end());
@@ -3369,6 +3789,7 @@ namespace MagicApp
                 triMesh->SetHasVertexColor(true);
                 for (int vid = 0; vid < vertexCount; vid++)
                 {
+                    // Principal values share the 1 / length unit of the unified mesh, 0.8 is the flat color
                     GPP::Real minCurvature = mMinCurvature.at(vid);
                     triMesh->SetVertexColor(vid, MagicCore::ToolKit::ColorCoding(0.8 + minCurvature));
                     if (fabs(minCurvature) > GPP::REAL_TOL)
@@ -3452,13 +3873,13 @@ namespace MagicApp
         {
             mRightMouseType = SELECT_PRIMITIVE;
             mpPickTool->SetPickParameter(MagicCore::PM_FACEPOINT, true, NULL, triMesh, "ModelNode");
-            MessageBox(NULL, "Select Primitive Mode", "ܰʾ", MB_OK);
+            MessageBox(NULL, "Select Primitive Mode", "温馨提示", MB_OK);
         }
         else
         {
             mRightMouseType = SELECT_VERTEX;
             mpPickTool->SetPickParameter(MagicCore::PM_POINT, true, NULL, triMesh, "ModelNode");
-            MessageBox(NULL, "Ŀǰѡ񶥵", "ܰʾ", MB_OK);
+            MessageBox(NULL, "目前仅能选择网格顶点", "温馨提示", MB_OK);
         }
         ClearSelectionData();
         mUpdateMarkRendering = true;
@@ -2,6 +2,7 @@
 #include "AppBase.h"
 #include <vector>
 #include "GPP.h"
+#include "CurveSegmentCache.h"
 
 namespace GPP
 {
@@ -32,7 +33,9 @@ namespace MagicApp
             SECTION_CURVE,
             FACE_POINT_CURVE,
             SPLIT_MESH,
-            DETECT_PRIMITIVE
+            DETECT_PRIMITIVE,
+            GEODESICS_HEAT,
+            BATCH_SECTION
         };
 
         enum RightMouseType
@@ -66,12 +69,16 @@ namespace MagicApp
         void FastComputeExactGeodesics(double accuracy, bool isSubThread = true);
         void ComputeExactGeodesics(bool isSubThread = true);
         void ComputeCurvatureGeodesics(double curvatureWeight, bool isSubThread = true);
+        // Distance fields of marks by the heat method, the factorization is reused until the mesh is edited
+        void ComputeHeatGeodesics(bool isSubThread = true);
         void SmoothGeodesicsOnVertex(void);
         void SmoothGeodesicsCrossVertex(void);
 
         void ComputeSectionCurve(bool isSubThread = true);
         void ComputeFacePointCurve(bool isSubThread = true);
         void SplitMesh(bool isSubThread = true);
+        // Evenly spaced parallel sections of the whole mesh with their area and perimeter, streamed to a text file
+        void ExportBatchSections(bool isSubThread = true);
 
         void ComputeOffsetCurve(double offsetSize);
         
@@ -116,6 +123,11 @@ namespace MagicApp
 
         void SelectPrimitive(int faceId);
 
+        // The curve between each two adjacent marks is taken from mCurveSegmentCache or solved on ThreadPool
+        GPP::ErrorCode ComputeCurveBySegments(int curveType, GPP::Real parameter, CurveSegment& curve);
+        // Copy principal curvature of the cached MeshCurvature to the members, return false if it could not be computed
+        bool LoadPrincipalCurvature(GPP::TriMesh* triMesh);
+
     private:
         MeasureAppUI* mpUI;
         MagicCore::ViewTool* mpViewTool;
@@ -140,6 +152,10 @@ namespace MagicApp
         bool mIsFlatRenderingMode;
         GPP::TriMesh* mpRefTriMesh;
         bool mUpdateRefModelRendering;
+        // Colors of the latest thickness level, filled by the command thread and applied to the mesh by Update
+        std::vector<GPP::Vector3> mThicknessColors;
+        // Set by the command thread after it fills mThicknessColors, cleared by Update after applying them
+        volatile bool mUpdateThicknessColors;
         std::vector<GPP::Real> mMinCurvature;
         std::vector<GPP::Real> mMaxCurvature;
         std::vector<GPP::Vector3> mMinCurvatureDirs;
@@ -149,5 +165,7 @@ namespace MagicApp
         GPP::Real mCurvatureWeight;
         bool mIsGeodesicsClose;
         bool mDetectOptions[4];
+        CurveSegmentCache mCurveSegmentCache;
+        std::string mSectionFileName;
     };
 }
@@ -8,9 +8,14 @@
 #include "MeasureApp.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "UndoJournal.h"
+#include "AttributeChannels.h"
+#include "PartitionSimplifier.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
+#include "../Common/InputSystem.h"
 #include "../Common/ViewTool.h"
+#include "../Common/SelectionEngine.h"
 #include "../Common/ScriptSystem.h"
 #include "MagicMesh.h"
 #if DEBUGDUMPFILE
@@ -19,6 +24,10 @@
 
 namespace MagicApp
 {
+    // Filters of larger meshes show a preview first
+    static const GPP::Int gPreviewMinVertexCount = 500000;
+    static const GPP::Int gPreviewVertexCount = 50000;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         MeshShopApp* app = (MeshShopApp*)arg;
@@ -30,9 +39,21 @@ namespace MagicApp
         return 1;
     }
 
+    static unsigned __stdcall RunPreviewThread(void *arg)
+    {
+        MeshShopApp* app = (MeshShopApp*)arg;
+        if (app == NULL)
+        {
+            return 0;
+        }
+        app->RunFilterPreview();
+        return 1;
+    }
+
     MeshShopApp::MeshShopApp() :
         mpUI(NULL),
         mpViewTool(NULL),
+        mpSelectionEngine(NULL),
         mDisplayMode(0),
 #if DEBUGDUMPFILE
         mpDumpInfo(NULL),
@@ -45,14 +66,15 @@ namespace MagicApp
         mUpdateMeshRendering(false),
         mUpdateHoleRendering(false),
         mIsCommandInProgress(false),
-        mVertexSelectFlag(),
+        mVertexSelection(),
         mRightMouseType(MOVE),
         mMousePressdCoord(),
         mIgnoreBack(true),
         mFilterPositionWeight(1.0),
         mIsFlatRenderingMode(true),
         mSharpAngle(0),
-        mEnhanceIntensity(0)
+        mEnhanceIntensity(0),
+        mFilterPreview()
     {
     }
 
@@ -60,6 +82,7 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpSelectionEngine);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
@@ -93,6 +116,13 @@ namespace MagicApp
             int progressValue = int(GPP::GetApiProgress() * 100.0);
             mpUI->SetProgressbar(progressValue);
         }
+        GPP::TriMesh* previewMesh = mFilterPreview.TakePreviewTriMesh();
+        if (previewMesh != NULL)
+        {
+            MagicCore::RenderSystem::Get()->RenderMesh("Mesh_MeshShop", "CookTorrance", previewMesh, 
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, NULL, NULL, mIsFlatRenderingMode);
+            GPPFREEPOINTER(previewMesh);
+        }
         if (mUpdateMeshRendering)
         {
             UpdateMeshRendering();
@@ -240,7 +270,11 @@ namespace MagicApp
 
     bool MeshShopApp::KeyPressed( const OIS::KeyEvent &arg )
     {
-        if (arg.key == OIS::KC_D)
+        if ((arg.key == OIS::KC_Z || arg.key == OIS::KC_Y) && MagicCore::InputSystem::Get()->IsModifierDown(OIS::Keyboard::Ctrl))
+        {
+            UndoCommand(arg.key == OIS::KC_Z);
+        }
+        else if (arg.key == OIS::KC_D)
         {
 #if DEBUGDUMPFILE
             RunDumpInfo();
@@ -276,57 +310,70 @@ namespace MagicApp
         }
         else
         {
-            switch (mCommandType)
+            bool isRefining = mFilterPreview.IsRefining();
+            do
             {
-            case MagicApp::MeshShopApp::NONE:
-                break;
-            case MagicApp::MeshShopApp::CONSOLIDATETOPOLOGY:
-                ConsolidateTopology(false);
-                break;
-            case MagicApp::MeshShopApp::CONSOLIDATEGEOMETRY:
-                ConsolidateGeometry(false);
-                break;
-            case MagicApp::MeshShopApp::REMOVEISOLATEPART:
-                RemoveMeshIsolatePart(false);
-                break;
-            case MagicApp::MeshShopApp::CDTOPTIMIZATION:
-                CDTOptimization(mSharpAngle, false);
-                break;
-            case MagicApp::MeshShopApp::CVTOPTIMIZATION:
-                CVTOptimization(mSharpAngle, false);
-                break;
-            case MagicApp::MeshShopApp::REMOVEMESHNOISE:
-                RemoveMeshNoise(mFilterPositionWeight, false);
-                break;
-            case MagicApp::MeshShopApp::SMOOTHMESH:
-                SmoothMesh(mFilterPositionWeight, false);
-                break;
-            case MagicApp::MeshShopApp::ENHANCEDETAIL:
-                EnhanceMeshDetail(mEnhanceIntensity, false);
-                break;
-            case MagicApp::MeshShopApp::LOOPSUBDIVIDE:
-                LoopSubdivide(false);
-                break;
-            case MagicApp::MeshShopApp::REFINE:
-                RefineMesh(mTargetVertexCount, false);
-                break;
-            case MagicApp::MeshShopApp::SIMPLIFY:
-                SimplifyMesh(mTargetVertexCount, false);
-                break;
-            case MagicApp::MeshShopApp::SIMPLIFYSELECTVERTEX:
-                SimplifySelectedVertices(false);
-                break;
-            case MagicApp::MeshShopApp::UNIFORMREMESH:
-                UniformRemesh(mTargetVertexCount, mSharpAngle, false);
-                break;
-            case MagicApp::MeshShopApp::FILLHOLE:
-                FillHole(mFillHoleType, false);
-                break;
-            case MagicApp::MeshShopApp::RUNSCRIPT:
-                RunScript(false);
-                break;
-            default:
-                break;
+                if (isRefining)
+                {
+                    SetFilterRequest(mFilterPreview.GetRefineRequest());
+                }
+                switch (mCommandType)
+                {
+                case MagicApp::MeshShopApp::NONE:
+                    break;
+                case MagicApp::MeshShopApp::CONSOLIDATETOPOLOGY:
+                    ConsolidateTopology(false);
+                    break;
+                case MagicApp::MeshShopApp::CONSOLIDATEGEOMETRY:
+                    ConsolidateGeometry(false);
+                    break;
+                case MagicApp::MeshShopApp::REMOVEISOLATEPART:
+                    RemoveMeshIsolatePart(false);
+                    break;
+                case MagicApp::MeshShopApp::CDTOPTIMIZATION:
+                    CDTOptimization(mSharpAngle, false);
+                    break;
+                case MagicApp::MeshShopApp::CVTOPTIMIZATION:
+                    CVTOptimization(mSharpAngle, false);
+                    break;
+                case MagicApp::MeshShopApp::REMOVEMESHNOISE:
+                    RemoveMeshNoise(mFilterPositionWeight, false);
+                    break;
+                case MagicApp::MeshShopApp::SMOOTHMESH:
+                    SmoothMesh(mFilterPositionWeight, false);
+                    break;
+                case MagicApp::MeshShopApp::ENHANCEDETAIL:
+                    EnhanceMeshDetail(mEnhanceIntensity, false);
+                    break;
+                case MagicApp::MeshShopApp::LOOPSUBDIVIDE:
+                    LoopSubdivide(false);
+                    break;
+                case MagicApp::MeshShopApp::REFINE:
+                    RefineMesh(mTargetVertexCount, false);
+                    break;
+                case MagicApp::MeshShopApp::SIMPLIFY:
+                    SimplifyMesh(mTargetVertexCount, false);
+                    break;
+                case MagicApp::MeshShopApp::SIMPLIFYSELECTVERTEX:
+                    SimplifySelectedVertices(false);
+                    break;
+                case MagicApp::MeshShopApp::UNIFORMREMESH:
+                    UniformRemesh(mTargetVertexCount, mSharpAngle, false);
+                    break;
+                case MagicApp::MeshShopApp::FILLHOLE:
+                    FillHole(mFillHoleType, false);
+                    break;
+                case MagicApp::MeshShopApp::RUNSCRIPT:
+                    RunScript(false);
+                    break;
+                default:
+                    break;
+                }
+            } while (mFilterPreview.FinishRefine());
+            if (isRefining)
+            {
+                // Replace the preview, the last run may fail
+                mUpdateMeshRendering = true;
             }
             if (!MagicCore::ScriptSystem::Get()->IsOnRunningScript())
             {
@@ -369,112 +416,231 @@ namespace MagicApp
     {
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
+        GPPFREEPOINTER(mpSelectionEngine);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
         mShowHoleLoopIds.clear();
-        mVertexSelectFlag.clear();
+        mVertexSelection.Clear();
         mRightMouseType = MOVE;
+        mFilterPreview.Clear();
     }
 
     bool MeshShopApp::IsCommandAvaliable()
     {
         if (ModelManager::Get()->GetMesh() == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return false;
         }
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
+        {
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
+            return false;
+        }
+        return true;
+    }
+
+    void MeshShopApp::StartFilterPreview()
+    {
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (MagicCore::ScriptSystem::Get()->IsOnRunningScript() || triMesh->GetVertexCount() < gPreviewMinVertexCount ||
+            mVertexSelection.IsEmpty() == false)
+        {
+            return;
+        }
+        if (mFilterPreview.ClusterTriMesh(triMesh, gPreviewVertexCount) == false)
+        {
+            return;
+        }
+        FilterRequest request = GetFilterRequest();
+        mFilterPreview.StartRefine(request);
+        RenderFilterPreview(request);
+    }
+
+    bool MeshShopApp::QueueFilter(const FilterRequest& request)
+    {
+        if (mFilterPreview.QueueRefine(request) == false)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
             return false;
         }
+        RenderFilterPreview(request);
         return true;
     }
 
+    void MeshShopApp::RenderFilterPreview(const FilterRequest& request)
+    {
+        if (mFilterPreview.RequestPreview(request))
+        {
+            _beginthreadex(NULL, 0, RunPreviewThread, (void *)this, 0, NULL);
+        }
+    }
+
+    void MeshShopApp::RunFilterPreview()
+    {
+        do
+        {
+            FilterRequest request = mFilterPreview.GetPreviewRequest();
+            GPP::TriMesh* previewMesh = mFilterPreview.CreateTriMesh();
+            if (previewMesh == NULL)
+            {
+                continue;
+            }
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            switch (request.commandType)
+            {
+            case MagicApp::MeshShopApp::REMOVEMESHNOISE:
+                res = GPP::ConsolidateMesh::RemoveGeometryNoise(previewMesh, 70.0 * GPP::ONE_RADIAN, request.values[0]);
+                break;
+            case MagicApp::MeshShopApp::SMOOTHMESH:
+                res = GPP::FilterMesh::LaplaceSmooth(previewMesh, true, request.values[0]);
+                break;
+            case MagicApp::MeshShopApp::ENHANCEDETAIL:
+                res = GPP::FilterMesh::EnhanceDetail(previewMesh, request.values[0]);
+                break;
+            case MagicApp::MeshShopApp::UNIFORMREMESH:
+                {
+                    // Keep the same edge length on the preview mesh
+                    GPP::Int previewVertexCount = GPP::Int(request.values[0] * mFilterPreview.GetSampleRatio());
+                    res = GPP::Remesh::UniformRemesh(previewMesh, previewVertexCount > 4 ? previewVertexCount : 4, 
+                        request.values[1] * GPP::ONE_RADIAN, 2, NULL, NULL);
+                }
+                break;
+            default:
+                break;
+            }
+            if (res == GPP_NO_ERROR)
+            {
+                previewMesh->UpdateNormal();
+                mFilterPreview.SetPreviewResult(previewMesh);
+            }
+            else
+            {
+                GPPFREEPOINTER(previewMesh);
+            }
+        } while (mFilterPreview.FinishPreview());
+    }
+
+    FilterRequest MeshShopApp::GetFilterRequest() const
+    {
+        FilterRequest request;
+        request.commandType = mCommandType;
+        switch (mCommandType)
+        {
+        case MagicApp::MeshShopApp::REMOVEMESHNOISE:
+        case MagicApp::MeshShopApp::SMOOTHMESH:
+            request.values[0] = mFilterPositionWeight;
+            break;
+        case MagicApp::MeshShopApp::ENHANCEDETAIL:
+            request.values[0] = mEnhanceIntensity;
+            break;
+        case MagicApp::MeshShopApp::UNIFORMREMESH:
+            request.values[0] = GPP::Real(mTargetVertexCount);
+            request.values[1] = mSharpAngle;
+            break;
+        default:
+            break;
+        }
+        return request;
+    }
+
+    void MeshShopApp::SetFilterRequest(const FilterRequest& request)
+    {
+        mCommandType = CommandType(request.commandType);
+        switch (mCommandType)
+        {
+        case MagicApp::MeshShopApp::REMOVEMESHNOISE:
+        case MagicApp::MeshShopApp::SMOOTHMESH:
+            mFilterPositionWeight = request.values[0];
+            break;
+        case MagicApp::MeshShopApp::ENHANCEDETAIL:
+            mEnhanceIntensity = request.values[0];
+            break;
+        case MagicApp::MeshShopApp::UNIFORMREMESH:
+            mTargetVertexCount = GPP::Int(request.values[0]);
+            mSharpAngle = request.values[1];
+            break;
+        default:
+            break;
+        }
+    }
+
+    void MeshShopApp::UndoCommand(bool isUndo)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        UndoJournal* undoJournal = ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH);
+        bool isApplied = isUndo ? undoJournal->Undo() : undoJournal->Redo();
+        if (isApplied == false)
+        {
+            return;
+        }
+        ResetSelection();
+        UpdateMeshRendering();
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        if (triMesh)
+        {
+            mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
+            mpUI->ResetFillHole();
+            FindHole(false);
+        }
+    }
+
     void MeshShopApp::ResetSelection()
     {
         if (ModelManager::Get()->GetMesh())
         {
-            mVertexSelectFlag = std::vector<bool>(ModelManager::Get()->GetMesh()->GetVertexCount(), 0);
+            mVertexSelection.Resize(ModelManager::Get()->GetMesh()->GetVertexCount());
         }
         else
         {
-            mVertexSelectFlag.clear();
+            mVertexSelection.Clear();
         }
     }
 
     void MeshShopApp::SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
     {
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
-        GPP::Vector2 pos0(startCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
-                    1.0 - startCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
-        GPP::Vector2 pos1(endCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
-                    1.0 - endCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
-        double minX = (pos0[0] < pos1[0]) ? pos0[0] : pos1[0];
-        double maxX = (pos0[0] > pos1[0]) ? pos0[0] : pos1[0];
-        double minY = (pos0[1] < pos1[1]) ? pos0[1] : pos1[1];
-        double maxY = (pos0[1] > pos1[1]) ? pos0[1] : pos1[1];
+        if (mpSelectionEngine == NULL)
+        {
+            mpSelectionEngine = new MagicCore::SelectionEngine;
+        }
         Ogre::Matrix4 worldM = MagicCore::RenderSystem::Get()->GetSceneManager()->getSceneNode("ModelNode")->_getFullTransform();
         Ogre::Matrix4 viewM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getViewMatrix();
         Ogre::Matrix4 projM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getProjectionMatrix();
-        Ogre::Matrix4 wvpM   = projM * viewM * worldM;
-        GPP::Int vertexCount = triMesh->GetVertexCount();
-        GPP::Vector3 coord;
-        GPP::Vector3 normal;
-        bool ignoreBack = mIgnoreBack;
-        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        Ogre::Matrix4 worldViewM = viewM * worldM;
+        GPP::Real worldViewMatrix[16], projMatrix[16];
+        for (int row = 0; row < 4; row++)
         {
-            if (mRightMouseType == SELECT_ADD && mVertexSelectFlag.at(vid))
+            for (int col = 0; col < 4; col++)
             {
-                continue;
+                worldViewMatrix[row * 4 + col] = worldViewM[row][col];
+                projMatrix[row * 4 + col] = projM[row][col];
             }
-            else if (mRightMouseType == SELECT_DELETE && mVertexSelectFlag.at(vid) == 0)
+        }
+        mpSelectionEngine->SetView(worldViewMatrix, projMatrix, MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth(),
+            MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
+        // Vertices hidden behind the visible surface are not selected
+        mpSelectionEngine->BuildDepthBuffer(triMesh);
+        mpSelectionEngine->SetRectangle(startCoordX, startCoordY, endCoordX, endCoordY);
+        GPP::TriMeshPointList pointList(triMesh);
+        std::vector<GPP::Int> selectedIds;
+        mpSelectionEngine->Select(&pointList, mIgnoreBack, selectedIds);
+        for (std::vector<GPP::Int>::iterator itr = selectedIds.begin(); itr != selectedIds.end(); ++itr)
+        {
+            if (mRightMouseType == SELECT_BRIDGE)
             {
-                continue;
+                mVertexBridgeFlag.at(*itr) = 1;
             }
-            GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
-            Ogre::Vector3 ogreCoord(coord[0], coord[1], coord[2]);
-            ogreCoord = wvpM * ogreCoord;
-            if (ogreCoord.x > minX && ogreCoord.x < maxX && ogreCoord.y > minY && ogreCoord.y < maxY)
+            else if (mRightMouseType == SELECT_ADD)
             {
-                if (ignoreBack)
-                {
-                    normal = triMesh->GetVertexNormal(vid);
-                    Ogre::Vector4 ogreNormal(normal[0], normal[1], normal[2], 0);
-                    ogreNormal = worldM * ogreNormal;
-                    if (ogreNormal.z > 0)
-                    {
-                        if (mRightMouseType == SELECT_BRIDGE)
-                        {
-                            mVertexBridgeFlag.at(vid) = 1;
-                        }
-                        else if (mRightMouseType == SELECT_ADD)
-                        {
-                            mVertexSelectFlag.at(vid) = 1;
-                            //InfoLog << vid << std::endl;
-                        }
-                        else
-                        {
-                            mVertexSelectFlag.at(vid) = 0;
-                        }
-                    }
-                }
-                else
-                {
-                    if (mRightMouseType == SELECT_BRIDGE)
-                    {
-                        mVertexBridgeFlag.at(vid) = 1;
-                    }
-                    else if (mRightMouseType == SELECT_ADD)
-                    {
-                        mVertexSelectFlag.at(vid) = 1;
-                    }
-                    else
-                    {
-                        mVertexSelectFlag.at(vid) = 0;
-                    }
-                }
+                mVertexSelection.Select(*itr);
+            }
+            else
+            {
+                mVertexSelection.Unselect(*itr);
             }
         }
     }
@@ -573,9 +739,9 @@ namespace MagicApp
 
     bool MeshShopApp::ImportMesh()
     {
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -585,7 +751,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return false;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -667,21 +833,21 @@ namespace MagicApp
             int invalidVertexId = -1;
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh, &invalidVertexId) == false)
             {
-                MessageBox(NULL, "зνṹ", "ܰʾ", MB_OK);
-                if (mVertexSelectFlag.size() == triMesh->GetVertexCount() && invalidVertexId != -1)
+                MessageBox(NULL, "网格有非流形结构", "温馨提示", MB_OK);
+                if (mVertexSelection.GetSize() == triMesh->GetVertexCount() && invalidVertexId != -1)
                 {
-                    mVertexSelectFlag.at(invalidVertexId) = 1;
+                    mVertexSelection.Select(invalidVertexId);
                     UpdateMeshRendering();
                 }
             }
             else
             {
-                MessageBox(NULL, "νṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格是流形结构", "温馨提示", MB_OK);
             }
         }
         else
         {
-            MessageBox(NULL, "뵼", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入网格", "温馨提示", MB_OK);
         }
     }
 
@@ -703,28 +869,33 @@ namespace MagicApp
             MagicMesh magicMesh(triMesh);
             ConstructMagicMeshInfo(&magicMesh);
             mIsCommandInProgress = true;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
             std::map<int, int> insertVertexIdMap;
             GPP::ErrorCode res = GPP::ConsolidateMesh::MakeTriMeshManifold(&magicMesh, &insertVertexIdMap);
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "拓扑修复失败", "温馨提示", MB_OK);
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             UpdateAddedVertexInfo(insertVertexIdMap);
             ResetSelection();
             bool isManifold = GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh);
             if (!isManifold)
             {
-                MessageBox(NULL, "޸ȻǷνṹ", "ܰʾ", MB_OK);
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "拓扑修复后，网格仍然是非流形结构", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
@@ -732,6 +903,7 @@ namespace MagicApp
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
+            mIsCommandInProgress = false;
         }
     }
 
@@ -750,6 +922,7 @@ namespace MagicApp
             triMesh->SetTriangleVertexIds(fid, vertexIds[1], vertexIds[0], vertexIds[2]);
         }
         triMesh->UpdateNormal();
+        ModelManager::Get()->IncreaseMeshGeneration(triMesh);
         UpdateMeshRendering();
     }
 
@@ -770,21 +943,21 @@ namespace MagicApp
             GPP::Int vertexCount = triMesh->GetVertexCount();
             if (vertexCount < 1)
             {
-                MessageBox(NULL, "񶥵С1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格顶点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> isolation;
             mIsCommandInProgress = true;
             GPP::ErrorCode res = GPP::ConsolidateMesh::CalculateIsolation(triMesh, &isolation);
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.10;
@@ -797,20 +970,26 @@ namespace MagicApp
                 }
             }
             DebugLog << "MeshShopApp::RemoveOutlier deleteIndex size=" << deleteIndex.size() << std::endl;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
             MagicMesh magicMesh(triMesh);
             ConstructMagicMeshInfo(&magicMesh);
             //res = GPP::DeleteTriMeshVertices(triMesh, deleteIndex);
             res = GPP::DeleteTriMeshVertices(&magicMesh, deleteIndex);
             if (res != GPP_NO_ERROR)
             {
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
+            mIsCommandInProgress = false;
         }
     }
 
@@ -837,15 +1016,16 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "几何修复失败", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
         }
@@ -868,7 +1048,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -885,12 +1065,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -909,16 +1089,17 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                     return;
                 }
             }        
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
         }
     }
@@ -940,7 +1121,7 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -953,22 +1134,33 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格优化失败", "温馨提示", MB_OK);
                 return;
             }       
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
         }
     }
 
     void MeshShopApp::RemoveMeshNoise(double positionWeight, bool isSubThread)
     {
-        if (IsCommandAvaliable() == false)
+        if (isSubThread && mFilterPreview.IsRefining())
+        {
+            FilterRequest request;
+            request.commandType = REMOVEMESHNOISE;
+            request.values[0] = positionWeight;
+            if (QueueFilter(request))
+            {
+                return;
+            }
+        }
+        if (mFilterPreview.IsRefining() == false && IsCommandAvaliable() == false)
         {
             return;
         }
@@ -976,53 +1168,74 @@ namespace MagicApp
         {
             mCommandType = REMOVEMESHNOISE;
             mFilterPositionWeight = positionWeight;
+            StartFilterPreview();
             DoCommand(true);
         }
         else
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             mIsCommandInProgress = true;
-            bool isVertexSelected = false;
-            for (std::vector<bool>::iterator itr = mVertexSelectFlag.begin(); itr != mVertexSelectFlag.end(); ++itr)
-            {
-                if (*itr)
-                {
-                    isVertexSelected = true;
-                    break;
-                }
-            }
+            std::vector<GPP::Int> selectedVertexIds;
+            mVertexSelection.GetSelectedIds(selectedVertexIds);
+            // Filters of a selection only move the selected vertices
+            GPP::Int rangeStartId = selectedVertexIds.empty() ? 0 : selectedVertexIds.front();
+            GPP::Int rangeEndId = selectedVertexIds.empty() ? triMesh->GetVertexCount() : selectedVertexIds.back() + 1;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(
+                new VertexRangeRecord(UNDO_TRIMESH, UNDO_COORD | UNDO_NORMAL, rangeStartId, rangeEndId));
             GPP::ErrorCode res = GPP_NO_ERROR;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            if (isVertexSelected)
+            if (!selectedVertexIds.empty())
             {
-                GPP::SubTriMesh subTriMesh(triMesh, mVertexSelectFlag, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
+                GPP::SubTriMesh subTriMesh(triMesh, selectedVertexIds, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
                 res = GPP::ConsolidateMesh::RemoveGeometryNoise(&subTriMesh, 70.0 * GPP::ONE_RADIAN, positionWeight);
             }
             else
             {
                 res = GPP::ConsolidateMesh::RemoveGeometryNoise(triMesh, 70.0 * GPP::ONE_RADIAN, positionWeight);
             }
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
+                return;
+            }
+            if (mFilterPreview.BeginCommit() == false)
+            {
+                // Parameters changed during the refinement, the next run starts from the mesh before this one
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Revert();
+                mIsCommandInProgress = false;
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            mFilterPreview.EndCommit();
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
+            mIsCommandInProgress = false;
         }
     }
 
     void MeshShopApp::SmoothMesh(double positionWeight, bool isSubThread)
     {
-        if (IsCommandAvaliable() == false)
+        if (isSubThread && mFilterPreview.IsRefining())
+        {
+            FilterRequest request;
+            request.commandType = SMOOTHMESH;
+            request.values[0] = positionWeight;
+            if (QueueFilter(request))
+            {
+                return;
+            }
+        }
+        if (mFilterPreview.IsRefining() == false && IsCommandAvaliable() == false)
         {
             return;
         }
@@ -1030,53 +1243,74 @@ namespace MagicApp
         {
             mCommandType = SMOOTHMESH;
             mFilterPositionWeight = positionWeight;
+            StartFilterPreview();
             DoCommand(true);
         }
         else
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             mIsCommandInProgress = true;
-            bool isVertexSelected = false;
-            for (std::vector<bool>::iterator itr = mVertexSelectFlag.begin(); itr != mVertexSelectFlag.end(); ++itr)
-            {
-                if (*itr)
-                {
-                    isVertexSelected = true;
-                    break;
-                }
-            }
+            std::vector<GPP::Int> selectedVertexIds;
+            mVertexSelection.GetSelectedIds(selectedVertexIds);
+            // Filters of a selection only move the selected vertices
+            GPP::Int rangeStartId = selectedVertexIds.empty() ? 0 : selectedVertexIds.front();
+            GPP::Int rangeEndId = selectedVertexIds.empty() ? triMesh->GetVertexCount() : selectedVertexIds.back() + 1;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(
+                new VertexRangeRecord(UNDO_TRIMESH, UNDO_COORD | UNDO_NORMAL, rangeStartId, rangeEndId));
             GPP::ErrorCode res = GPP_NO_ERROR;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            if (isVertexSelected)
+            if (!selectedVertexIds.empty())
             {
-                GPP::SubTriMesh subTriMesh(triMesh, mVertexSelectFlag, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
+                GPP::SubTriMesh subTriMesh(triMesh, selectedVertexIds, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
                 res = GPP::FilterMesh::LaplaceSmooth(&subTriMesh, true, positionWeight);
             }
             else
             {
                 res = GPP::FilterMesh::LaplaceSmooth(triMesh, true, positionWeight);
             }
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "˳ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "网格光顺失败", "温馨提示", MB_OK);
                 return;
             }
+            if (mFilterPreview.BeginCommit() == false)
+            {
+                // Parameters changed during the refinement, the next run starts from the mesh before this one
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Revert();
+                mIsCommandInProgress = false;
+                return;
+            }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            mFilterPreview.EndCommit();
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
+            mIsCommandInProgress = false;
         }
     }
 
     void MeshShopApp::EnhanceMeshDetail(double intensity, bool isSubThread)
     {
-        if (IsCommandAvaliable() == false)
+        if (isSubThread && mFilterPreview.IsRefining())
+        {
+            FilterRequest request;
+            request.commandType = ENHANCEDETAIL;
+            request.values[0] = intensity;
+            if (QueueFilter(request))
+            {
+                return;
+            }
+        }
+        if (mFilterPreview.IsRefining() == false && IsCommandAvaliable() == false)
         {
             return;
         }
@@ -1084,47 +1318,58 @@ namespace MagicApp
         {
             mCommandType = ENHANCEDETAIL;
             mEnhanceIntensity = intensity;
+            StartFilterPreview();
             DoCommand(true);
         }
         else
         {
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             mIsCommandInProgress = true;
-            bool isVertexSelected = false;
-            for (std::vector<bool>::iterator itr = mVertexSelectFlag.begin(); itr != mVertexSelectFlag.end(); ++itr)
-            {
-                if (*itr)
-                {
-                    isVertexSelected = true;
-                    break;
-                }
-            }
+            std::vector<GPP::Int> selectedVertexIds;
+            mVertexSelection.GetSelectedIds(selectedVertexIds);
+            // Filters of a selection only move the selected vertices
+            GPP::Int rangeStartId = selectedVertexIds.empty() ? 0 : selectedVertexIds.front();
+            GPP::Int rangeEndId = selectedVertexIds.empty() ? triMesh->GetVertexCount() : selectedVertexIds.back() + 1;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(
+                new VertexRangeRecord(UNDO_TRIMESH, UNDO_COORD | UNDO_NORMAL, rangeStartId, rangeEndId));
             GPP::ErrorCode res = GPP_NO_ERROR;
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            if (isVertexSelected)
+            if (!selectedVertexIds.empty())
             {
-                GPP::SubTriMesh subTriMesh(triMesh, mVertexSelectFlag, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
+                GPP::SubTriMesh subTriMesh(triMesh, selectedVertexIds, GPP::SubTriMesh::BUILD_SUBTRIMESH_TYPE_BY_VERTICES);
                 res = GPP::FilterMesh::EnhanceDetail(&subTriMesh, intensity);
             }
             else
             {
                 res = GPP::FilterMesh::EnhanceDetail(triMesh, intensity);
             }
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ϸǿʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "几何细节增强失败", "温馨提示", MB_OK);
+                return;
+            }
+            if (mFilterPreview.BeginCommit() == false)
+            {
+                // Parameters changed during the refinement, the next run starts from the mesh before this one
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Revert();
+                mIsCommandInProgress = false;
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            mFilterPreview.EndCommit();
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1145,7 +1390,7 @@ namespace MagicApp
             GPP::Int vertexCount = triMesh->GetVertexCount();
             if (vertexCount >= 250000)
             {
-                if (MessageBox(NULL, "ϸֺ񶥵ܻ1MǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "细分后网格顶点数量可能会大于1M，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1170,12 +1415,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Loopϸʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Loop细分失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int insertedVertexCount = triMesh->GetVertexCount() - vertexCount;
@@ -1195,16 +1440,17 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Loopϸʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Loop细分失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -1228,12 +1474,12 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh->GetVertexCount() >= targetVertexCount)
             {
-                MessageBox(NULL, "棺Ŀ궥", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：目标顶点数必须大于网格点数", "温馨提示", MB_OK);
                 return;
             }
             if (targetVertexCount > 1000000)
             {
-                if (MessageBox(NULL, "ܺ񶥵1MǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "加密后网格顶点数量会大于1M，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1259,12 +1505,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格加密失败", "温馨提示", MB_OK);
                     return;
                 }
                 GPP::Int insertedVertexCount = triMesh->GetVertexCount() - vertexCount;
@@ -1284,16 +1530,17 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格加密失败", "温馨提示", MB_OK);
                     return;
                 }
             }
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -1317,36 +1564,55 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             if (triMesh->GetVertexCount() <= targetVertexCount)
             {
-                MessageBox(NULL, "棺Ŀ궥С", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：目标顶点数必须小于网格点数", "温馨提示", MB_OK);
                 return;
             }
-            if (triMesh->HasVertexColor())
+            mIsCommandInProgress = true;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
+            // Side arrays which could not be interpolated take the values of the nearest input vertex
+            AttributeChannelRegistry channels(triMesh->GetVertexCount());
+            channels.AddVector(ModelManager::Get()->GetImageColorIdsPointer());
+            channels.AddVector(ModelManager::Get()->GetColorIdsPointer());
+            channels.AddVector(ModelManager::Get()->GetImageColorIdFlagsPointer());
+            std::vector<GPP::Int> sourceVertexIds;
+            bool hasVertexColor = triMesh->HasVertexColor();
+            std::vector<GPP::Real> vertexFields;
+            std::vector<GPP::Real> simplifiedVertexFields;
+            if (hasVertexColor)
             {
-                std::vector<GPP::Real> vertexFields;
                 CollectTriMeshVerticesColorFields(triMesh, &vertexFields);
-                std::vector<GPP::Real> simplifiedVertexFields;
-                //GPP::DumpOnce();
-                mIsCommandInProgress = true;
+            }
+            // Big meshes are simplified in partitions on all threads
+            GPP::Int partitionCount = PartitionSimplifier::SuggestPartitionCount(triMesh);
 #if MAKEDUMPFILE
+            if (partitionCount == 1)
+            {
                 GPP::DumpOnce();
+            }
 #endif
-                GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, &vertexFields, &simplifiedVertexFields);
+            PartitionSimplifier simplifier;
+            GPP::ErrorCode res = simplifier.Simplify(triMesh, targetVertexCount, partitionCount,
+                hasVertexColor ? &vertexFields : NULL, hasVertexColor ? &simplifiedVertexFields : NULL,
+                channels.GetChannelCount() > 0 ? &sourceVertexIds : NULL);
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
                 mIsCommandInProgress = false;
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
-                    return;
-                }               
+                MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
+                return;
+            }
+            if (hasVertexColor)
+            {
                 GPP::Int vertexCount = triMesh->GetVertexCount();
                 for (GPP::Int vid = 0; vid < vertexCount; vid++)
                 {
@@ -1354,30 +1620,18 @@ namespace MagicApp
                     triMesh->SetVertexColor(vid, GPP::Vector3(simplifiedVertexFields.at(baseIndex), simplifiedVertexFields.at(baseIndex + 1), simplifiedVertexFields.at(baseIndex + 2)));
                 }
             }
-            else
+            if (channels.GetChannelCount() > 0)
             {
-                mIsCommandInProgress = true;
-#if MAKEDUMPFILE
-                GPP::DumpOnce();
-#endif
-                GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, NULL, NULL);
-                mIsCommandInProgress = false;
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
-                    return;
-                }
+                channels.Gather(sourceVertexIds);
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1397,18 +1651,11 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Int> removingVertices;
-            GPP::Int originVertexCount = triMesh->GetVertexCount();
-            for (GPP::Int vid = 0; vid < originVertexCount; vid++)
-            {
-                if (mVertexSelectFlag.at(vid))
-                {
-                    removingVertices.push_back(vid);
-                }
-            }
+            mVertexSelection.GetSelectedIds(removingVertices);
             if (removingVertices.empty())
             {
                 return;
@@ -1430,12 +1677,12 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1454,15 +1701,16 @@ namespace MagicApp
                 mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格简化失败", "温馨提示", MB_OK);
                     return;
                 }          
             }
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -1473,7 +1721,18 @@ namespace MagicApp
 
     void MeshShopApp::UniformRemesh(int targetVertexCount, double sharpAngle, bool isSubThread)
     {
-        if (IsCommandAvaliable() == false)
+        if (isSubThread && mFilterPreview.IsRefining())
+        {
+            FilterRequest request;
+            request.commandType = UNIFORMREMESH;
+            request.values[0] = targetVertexCount;
+            request.values[1] = sharpAngle;
+            if (QueueFilter(request))
+            {
+                return;
+            }
+        }
+        if (mFilterPreview.IsRefining() == false && IsCommandAvaliable() == false)
         {
             return;
         }
@@ -1482,6 +1741,7 @@ namespace MagicApp
             mTargetVertexCount = targetVertexCount;
             mSharpAngle = sharpAngle;
             mCommandType = UNIFORMREMESH;
+            StartFilterPreview();
             DoCommand(true);
         }
         else
@@ -1489,9 +1749,11 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "棺зνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "警告：网格有非流形结构，请先拓扑修复，否则程序会出错", "温馨提示", MB_OK);
                 return;
             }
+            mIsCommandInProgress = true;
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
             sharpAngle *= GPP::ONE_RADIAN;
             if (triMesh->HasVertexColor())
             {
@@ -1501,17 +1763,17 @@ namespace MagicApp
 #if MAKEDUMPFILE
         GPP::DumpOnce();
 #endif
-                mIsCommandInProgress = true;
                 GPP::ErrorCode res = GPP::Remesh::UniformRemesh(triMesh, targetVertexCount, sharpAngle, 2, &vertexFields, &remeshVertexFields);
-                mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Remeshʧ", "ܰʾ", MB_OK);
+                    ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                    mIsCommandInProgress = false;
+                    MessageBox(NULL, "Remesh失败", "温馨提示", MB_OK);
                     return;
                 }               
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1526,26 +1788,37 @@ namespace MagicApp
 #if MAKEDUMPFILE
                 GPP::DumpOnce();
 #endif
-                mIsCommandInProgress = true;
                 GPP::ErrorCode res = GPP::Remesh::UniformRemesh(triMesh, targetVertexCount, sharpAngle, 2, NULL, NULL);
-                mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Remeshʧ", "ܰʾ", MB_OK);
+                    ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                    mIsCommandInProgress = false;
+                    MessageBox(NULL, "Remesh失败", "温馨提示", MB_OK);
                     return;
                 }
             }
+            if (mFilterPreview.BeginCommit() == false)
+            {
+                // Parameters changed during the refinement, the next run starts from the mesh before this one
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Revert();
+                mIsCommandInProgress = false;
+                return;
+            }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
+            mFilterPreview.EndCommit();
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             ResetSelection();
             mUpdateMeshRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
             FindHole(false);
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1566,12 +1839,12 @@ namespace MagicApp
             pointsOnFace, pointsOnEdge, pointsOnVertex, false); 
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "采样失败", "温馨提示", MB_OK);
             return;
         }
 
@@ -1624,9 +1897,9 @@ namespace MagicApp
 
     void MeshShopApp::EnterReliefApp()
     {
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new ReliefApp, "ReliefApp");
@@ -1634,9 +1907,9 @@ namespace MagicApp
 
     void MeshShopApp::EnterTextureApp()
     {
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new TextureApp, "TextureApp");
@@ -1644,9 +1917,9 @@ namespace MagicApp
 
     void MeshShopApp::EnterMeasureApp()
     {
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return;
         }
         AppManager::Get()->EnterApp(new MeasureApp, "MeasureApp");
@@ -1688,7 +1961,7 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(ModelManager::Get()->GetMesh(), &holeIds);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
@@ -1725,7 +1998,7 @@ namespace MagicApp
                 bool needFill = true;
                 for (std::vector<GPP::Int>::iterator loopItr = mShowHoleLoopIds.at(vLoop).begin(); loopItr != mShowHoleLoopIds.at(vLoop).end(); ++loopItr)
                 {
-                    if (mVertexSelectFlag.at(*loopItr))
+                    if (mVertexSelection.IsSelected(*loopItr))
                     {
                         needFill = false;
                         break;
@@ -1739,6 +2012,7 @@ namespace MagicApp
             
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             int originVertexCount = triMesh->GetVertexCount();
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
@@ -1758,17 +2032,19 @@ namespace MagicApp
             {
                 res = GPP::FillMeshHole::FillHoles(triMesh, &holeSeeds, GPP::FillMeshHoleType(mFillHoleType), NULL, NULL);
             }
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "񲹶ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "网格补洞失败", "温馨提示", MB_OK);
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
             std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
             if (imageColorIds && imageColorIds->size() == originVertexCount)
             {
@@ -1792,10 +2068,12 @@ namespace MagicApp
             SetToShowHoleLoopVrtIds(std::vector<std::vector<GPP::Int> >());
             SetBoundarySeedIds(std::vector<GPP::Int>());
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
             mUpdateHoleRendering = true;
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mpUI->ResetFillHole();
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1947,12 +2225,12 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::FillMeshHole::BridgeEdges(triMesh, edgeVertex1, edgeVertex2, &vertexScaleFields, &outputScaleFields);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格搭桥失败", "温馨提示", MB_OK);
                 }
                 UpdateTriMeshVertexColors(triMesh, oldTriMeshVertexSize, outputScaleFields);
             }
@@ -1964,17 +2242,18 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::FillMeshHole::BridgeEdges(triMesh, edgeVertex1, edgeVertex2, NULL, NULL);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格搭桥失败", "温馨提示", MB_OK);
                 }
             }          
             ResetSelection();
             FindHole(false);
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mUpdateMeshRendering = true;
             mUpdateHoleRendering = true;
             mUpdateBridgeRendering = true;
@@ -1994,11 +2273,11 @@ namespace MagicApp
         ResetBridgeTags();
         if (mBridgeEdgeVertices.empty())
         {
-            MessageBox(NULL, "ģʽ: ʹҼοѡҪдŵԱ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "进入搭桥模式: 请使用鼠标右键依次框选需要进行搭桥的两对边", "温馨提示", MB_OK);
         }
         else
         {
-            MessageBox(NULL, "ģʽ: ʹҼѡһ߽д", "ܰʾ", MB_OK);
+            MessageBox(NULL, "搭桥模式: 请使用鼠标右键再选择一条边进行搭桥", "温馨提示", MB_OK);
         }
     }
 
@@ -2015,14 +2294,15 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OffsetMesh::UniformApproximate(triMesh, offsetValue);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "网格抽壳失败", "温馨提示", MB_OK);
             return;
         }
+        ModelManager::Get()->IncreaseMeshGeneration(triMesh);
         ResetSelection();
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         UpdateMeshRendering();
@@ -2052,37 +2332,33 @@ namespace MagicApp
             return;
         }
         std::vector<GPP::Int> deleteIndex;
-        GPP::Int vertexCount = triMesh->GetVertexCount();
-        for (GPP::Int vid = 0; vid < vertexCount; vid++)
-        {
-            if (mVertexSelectFlag.at(vid))
-            {
-                deleteIndex.push_back(vid);
-            }
-        }
+        mVertexSelection.GetSelectedIds(deleteIndex);
+        ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Prepare(new ModelSnapshotRecord(UNDO_TRIMESH));
         MagicMesh magicMesh(triMesh);
         ConstructMagicMeshInfo(&magicMesh);
         //res = GPP::DeleteTriMeshVertices(triMesh, deleteIndex);
         GPP::ErrorCode res = GPP::DeleteTriMeshVertices(&magicMesh, deleteIndex);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+            ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Cancel();
+            MessageBox(NULL, "删点失败", "温馨提示", MB_OK);
             return;
         }
+        ModelManager::Get()->GetUndoJournal(UNDO_TRIMESH)->Commit();
         if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
         {
-            if (MessageBox(NULL, "棺ɾƬзνṹǷҪ޸", "ܰʾ", MB_OKCANCEL) == IDOK)
+            if (MessageBox(NULL, "警告：删除面片后的网格有非流形结构，是否需要修复？", "温馨提示", MB_OKCANCEL) == IDOK)
             {
                 std::map<int, int> insertVertexIdMap;
                 GPP::ErrorCode res = GPP::ConsolidateMesh::MakeTriMeshManifold(&magicMesh, &insertVertexIdMap);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "޸ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "拓扑修复失败", "温馨提示", MB_OK);
                     return;
                 }
                 UpdateAddedVertexInfo(insertVertexIdMap);
@@ -2090,6 +2366,7 @@ namespace MagicApp
         }
         ResetSelection();
         triMesh->UpdateNormal();
+        ModelManager::Get()->IncreaseMeshGeneration(triMesh);
         mUpdateMeshRendering = true;
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         mpUI->ResetFillHole();
@@ -2171,12 +2448,12 @@ namespace MagicApp
         }
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "SplitByPlane failed", "ܰʾ", MB_OK);
+            MessageBox(NULL, "SplitByPlane failed", "温馨提示", MB_OK);
             return;
         }
         std::vector<int> deleteIndex;
@@ -2191,16 +2468,17 @@ namespace MagicApp
         res = GPP::DeleteTriMeshTriangles(triMesh, deleteIndex, true);
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "DeleteTriMeshTriangles failed", "ܰʾ", MB_OK);
+            MessageBox(NULL, "DeleteTriMeshTriangles failed", "温馨提示", MB_OK);
             return;
         }
         triMesh->UpdateNormal();
+        ModelManager::Get()->IncreaseMeshGeneration(triMesh);
         mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
         ResetSelection();
         UpdateMeshRendering();
         if (triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
         {
-            MessageBox(NULL, "ѿ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "网格已空", "温馨提示", MB_OK);
             return;
         }
     }
@@ -2230,7 +2508,7 @@ namespace MagicApp
         }
         GPP::Vector3 selectColor(1, 0, 0);
         MagicCore::RenderSystem::Get()->RenderMesh("Mesh_MeshShop", "CookTorrance", ModelManager::Get()->GetMesh(), 
-            MagicCore::RenderSystem::MODEL_NODE_CENTER, &mVertexSelectFlag, &selectColor, mIsFlatRenderingMode);
+            MagicCore::RenderSystem::MODEL_NODE_CENTER, &mVertexSelection, &selectColor, mIsFlatRenderingMode);
     }
 
     void MeshShopApp::UpdateHoleRendering()
@@ -2333,7 +2611,7 @@ namespace MagicApp
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
             int imageIdCount = 0;
@@ -2374,7 +2652,7 @@ namespace MagicApp
     {
         if (MagicCore::ScriptSystem::Get()->IsOnRunningScript())
         {
-            MessageBox(NULL, "ȴǰһűִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待前一脚本执行完毕", "温馨提示", MB_OK);
             return;
         }
         if (IsCommandInProgress())
@@ -2411,7 +2689,7 @@ namespace MagicApp
                     mUpdateBridgeRendering = true;
                     mUpdateHoleRendering = true;
                     mUpdateMeshRendering = true;
-                    MessageBox(NULL, "űִ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "脚本执行完毕", "温馨提示", MB_OK);
                 }
             }
         }
@@ -2422,19 +2700,19 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "mpTriMesh == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpTriMesh == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
         if (imageColorIds.size() != triMesh->GetVertexCount())
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -2445,7 +2723,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
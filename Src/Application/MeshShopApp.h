@@ -1,6 +1,8 @@
 #pragma once
 #include "AppBase.h"
 #include "../Common/RenderSystem.h"
+#include "../Common/SelectionSet.h"
+#include "FilterPreview.h"
 #include <vector>
 #include "Gpp.h"
 #if DEBUGDUMPFILE
@@ -10,6 +12,7 @@
 namespace MagicCore
 {
     class ViewTool;
+    class SelectionEngine;
 }
 
 namespace MagicApp
@@ -105,6 +108,8 @@ namespace MagicApp
 
         int GetMeshVertexCount(void);
         bool IsCommandInProgress(void);
+        // Called by the preview thread
+        void RunFilterPreview(void);
 #if DEBUGDUMPFILE
         void SetDumpInfo(GPP::DumpBase* dumpInfo);
         void RunDumpInfo(void);
@@ -115,7 +120,18 @@ namespace MagicApp
         void ShutdownScene(void);
         void ClearData(void);
         bool IsCommandAvaliable(void);
+        // Filter the preview mesh of a large mesh by mCommandType and start the refinement
+        void StartFilterPreview(void);
+        // The request replaces the running refinement, return false if the refinement has finished
+        bool QueueFilter(const FilterRequest& request);
+        // The preview is filtered on the preview thread and rendered by Update
+        void RenderFilterPreview(const FilterRequest& request);
+        // Parameters of mCommandType, SetFilterRequest is called by the command thread during the refinement
+        FilterRequest GetFilterRequest(void) const;
+        void SetFilterRequest(const FilterRequest& request);
         void ResetSelection(void);
+        // isUndo == false: redo
+        void UndoCommand(bool isUndo);
         void SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void ClearRectangleRendering(void);
@@ -139,6 +155,7 @@ namespace MagicApp
     private:
         MeshShopAppUI* mpUI;
         MagicCore::ViewTool* mpViewTool;
+        MagicCore::SelectionEngine* mpSelectionEngine;
         int mDisplayMode;
 #if DEBUGDUMPFILE
         GPP::DumpBase* mpDumpInfo;
@@ -152,7 +169,7 @@ namespace MagicApp
         bool mUpdateHoleRendering;
         bool mUpdateBridgeRendering;
         bool mIsCommandInProgress;
-        std::vector<bool> mVertexSelectFlag;
+        MagicCore::SelectionSet mVertexSelection;
         RightMouseType mRightMouseType;
         GPP::Vector2 mMousePressdCoord;
         bool mIgnoreBack;
@@ -162,5 +179,6 @@ namespace MagicApp
         bool mIsFlatRenderingMode;
         double mSharpAngle;
         double mEnhanceIntensity;
+        FilterPreview mFilterPreview;
     };
 }
@@ -1,4 +1,9 @@
 #include "ModelManager.h"
+#include "../Common/MeshQueryEngine.h"
+#include "../Common/PointNeighborGraph.h"
+#include "../Common/HeatGeodesics.h"
+#include "../Common/MeshCurvature.h"
+#include "UndoJournal.h"
 
 namespace MagicApp
 {
@@ -12,7 +17,16 @@ namespace MagicApp
         mImageColorIds(),
         mTextureImageFiles(),
         mCloudIds(),
-        mImageColorIdFlags()
+        mImageColorIdFlags(),
+        mMeshQueryEngines(),
+        mPointNeighborGraphs(),
+        mPointCloudGenerations(),
+        mMeshGenerations(),
+        mMeshGenerationCount(0),
+        mHeatGeodesics(),
+        mMeshCurvatures(),
+        mpPointCloudUndoJournal(NULL),
+        mpMeshUndoJournal(NULL)
     {
     }
 
@@ -29,10 +43,41 @@ namespace MagicApp
     {
         ClearPointCloud();
         ClearMesh();
+        for (std::map<const GPP::ITriMesh*, MagicCore::MeshQueryEngine*>::iterator itr = mMeshQueryEngines.begin();
+            itr != mMeshQueryEngines.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second);
+        }
+        mMeshQueryEngines.clear();
+        for (std::map<const GPP::ITriMesh*, std::pair<MagicCore::HeatGeodesics*, GPP::Int> >::iterator itr = mHeatGeodesics.begin();
+            itr != mHeatGeodesics.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second.first);
+        }
+        mHeatGeodesics.clear();
+        for (std::map<const GPP::ITriMesh*, std::pair<MagicCore::MeshCurvature*, GPP::Int> >::iterator itr = mMeshCurvatures.begin();
+            itr != mMeshCurvatures.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second.first);
+        }
+        mMeshCurvatures.clear();
+        for (std::map<const GPP::IPointCloud*, MagicCore::PointNeighborGraph*>::iterator itr = mPointNeighborGraphs.begin();
+            itr != mPointNeighborGraphs.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second);
+        }
+        mPointNeighborGraphs.clear();
+        GPPFREEPOINTER(mpPointCloudUndoJournal);
+        GPPFREEPOINTER(mpMeshUndoJournal);
     }
 
     bool ModelManager::ImportPointCloud(std::string fileName)
     {
+        if (mpPointCloudUndoJournal)
+        {
+            mpPointCloudUndoJournal->Clear();
+        }
+        ReleasePointNeighborGraph(mpPointCloud);
         GPPFREEPOINTER(mpPointCloud);
         mpPointCloud = GPP::Parser::ImportPointCloud(fileName);
         if (mpPointCloud == NULL)
@@ -45,6 +90,19 @@ namespace MagicApp
 
     void ModelManager::SetPointCloud(GPP::PointCloud* pointCloud)
     {
+        if (mpPointCloudUndoJournal)
+        {
+            mpPointCloudUndoJournal->Clear();
+        }
+        ReplacePointCloud(pointCloud);
+    }
+
+    void ModelManager::ReplacePointCloud(GPP::PointCloud* pointCloud)
+    {
+        if (pointCloud != mpPointCloud)
+        {
+            ReleasePointNeighborGraph(mpPointCloud);
+        }
         GPPFREEPOINTER(mpPointCloud);
         mpPointCloud = pointCloud;
     }
@@ -56,6 +114,11 @@ namespace MagicApp
 
     void ModelManager::ClearPointCloud()
     {
+        if (mpPointCloudUndoJournal)
+        {
+            mpPointCloudUndoJournal->Clear();
+        }
+        ReleasePointNeighborGraph(mpPointCloud);
         GPPFREEPOINTER(mpPointCloud);
     }
 
@@ -179,6 +242,11 @@ namespace MagicApp
 
     bool ModelManager::ImportMesh(std::string fileName)
     {
+        if (mpMeshUndoJournal)
+        {
+            mpMeshUndoJournal->Clear();
+        }
+        ReleaseMeshQueryEngine(mpTriMesh);
         GPPFREEPOINTER(mpTriMesh);
         mpTriMesh = GPP::Parser::ImportTriMesh(fileName);
         if (mpTriMesh == NULL)
@@ -196,6 +264,19 @@ namespace MagicApp
 
     void ModelManager::SetMesh(GPP::TriMesh* triMesh)
     {
+        if (mpMeshUndoJournal)
+        {
+            mpMeshUndoJournal->Clear();
+        }
+        ReplaceMesh(triMesh);
+    }
+
+    void ModelManager::ReplaceMesh(GPP::TriMesh* triMesh)
+    {
+        if (triMesh != mpTriMesh)
+        {
+            ReleaseMeshQueryEngine(mpTriMesh);
+        }
         GPPFREEPOINTER(mpTriMesh);
         mpTriMesh = triMesh;
     }
@@ -207,9 +288,233 @@ namespace MagicApp
 
     void ModelManager::ClearMesh()
     {
+        if (mpMeshUndoJournal)
+        {
+            mpMeshUndoJournal->Clear();
+        }
+        ReleaseMeshQueryEngine(mpTriMesh);
         GPPFREEPOINTER(mpTriMesh);
     }
 
+    MagicCore::MeshQueryEngine* ModelManager::GetMeshQueryEngine(const GPP::ITriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return NULL;
+        }
+        GPP::Int generation = GetMeshGeneration(triMesh);
+        MagicCore::MeshQueryEngine* queryEngine = NULL;
+        std::map<const GPP::ITriMesh*, MagicCore::MeshQueryEngine*>::iterator itr = mMeshQueryEngines.find(triMesh);
+        if (itr != mMeshQueryEngines.end())
+        {
+            queryEngine = itr->second;
+            if (queryEngine->GetGeneration() == generation && queryEngine->IsValid(triMesh))
+            {
+                return queryEngine;
+            }
+            // The mesh is edited in place: Refit rebuilds it if the topology is changed
+            if (queryEngine->GetMesh() == triMesh && queryEngine->Refit(generation) == GPP_NO_ERROR)
+            {
+                return queryEngine;
+            }
+        }
+        else
+        {
+            queryEngine = new MagicCore::MeshQueryEngine;
+            mMeshQueryEngines[triMesh] = queryEngine;
+        }
+        // Topology is changed or it is the first query: build it
+        if (queryEngine->Init(triMesh, generation) != GPP_NO_ERROR)
+        {
+            ReleaseMeshQueryEngine(triMesh);
+            return NULL;
+        }
+        return queryEngine;
+    }
+
+    void ModelManager::ReleaseMeshQueryEngine(const GPP::ITriMesh* triMesh)
+    {
+        std::map<const GPP::ITriMesh*, MagicCore::MeshQueryEngine*>::iterator itr = mMeshQueryEngines.find(triMesh);
+        if (itr != mMeshQueryEngines.end())
+        {
+            GPPFREEPOINTER(itr->second);
+            mMeshQueryEngines.erase(itr);
+        }
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::HeatGeodesics*, GPP::Int> >::iterator heatItr = mHeatGeodesics.find(triMesh);
+        if (heatItr != mHeatGeodesics.end())
+        {
+            GPPFREEPOINTER(heatItr->second.first);
+            mHeatGeodesics.erase(heatItr);
+        }
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::MeshCurvature*, GPP::Int> >::iterator curvatureItr = mMeshCurvatures.find(triMesh);
+        if (curvatureItr != mMeshCurvatures.end())
+        {
+            GPPFREEPOINTER(curvatureItr->second.first);
+            mMeshCurvatures.erase(curvatureItr);
+        }
+        mMeshGenerations.erase(triMesh);
+    }
+
+    GPP::Int ModelManager::GetMeshGeneration(const GPP::ITriMesh* triMesh)
+    {
+        std::map<const GPP::ITriMesh*, GPP::Int>::iterator itr = mMeshGenerations.find(triMesh);
+        if (itr != mMeshGenerations.end())
+        {
+            return itr->second;
+        }
+        mMeshGenerationCount++;
+        mMeshGenerations[triMesh] = mMeshGenerationCount;
+        return mMeshGenerationCount;
+    }
+
+    void ModelManager::IncreaseMeshGeneration(const GPP::ITriMesh* triMesh)
+    {
+        mMeshGenerationCount++;
+        mMeshGenerations[triMesh] = mMeshGenerationCount;
+    }
+
+    MagicCore::HeatGeodesics* ModelManager::GetHeatGeodesics(const GPP::ITriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return NULL;
+        }
+        GPP::Int generation = GetMeshGeneration(triMesh);
+        MagicCore::HeatGeodesics* heatGeodesics = NULL;
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::HeatGeodesics*, GPP::Int> >::iterator itr = mHeatGeodesics.find(triMesh);
+        if (itr != mHeatGeodesics.end())
+        {
+            heatGeodesics = itr->second.first;
+            if (itr->second.second == generation && heatGeodesics->IsValid(triMesh))
+            {
+                return heatGeodesics;
+            }
+        }
+        else
+        {
+            heatGeodesics = new MagicCore::HeatGeodesics;
+            mHeatGeodesics[triMesh] = std::make_pair(heatGeodesics, GPP::Int(-1));
+        }
+        // The mesh is edited or it is the first query: factorize it again
+        if (heatGeodesics->Init(triMesh) != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(heatGeodesics);
+            mHeatGeodesics.erase(triMesh);
+            return NULL;
+        }
+        mHeatGeodesics[triMesh].second = generation;
+        return heatGeodesics;
+    }
+
+    MagicCore::MeshCurvature* ModelManager::GetMeshCurvature(const GPP::ITriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return NULL;
+        }
+        GPP::Int generation = GetMeshGeneration(triMesh);
+        MagicCore::MeshCurvature* meshCurvature = NULL;
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::MeshCurvature*, GPP::Int> >::iterator itr = mMeshCurvatures.find(triMesh);
+        if (itr != mMeshCurvatures.end())
+        {
+            meshCurvature = itr->second.first;
+            if (itr->second.second == generation && meshCurvature->IsValid(triMesh))
+            {
+                return meshCurvature;
+            }
+        }
+        else
+        {
+            meshCurvature = new MagicCore::MeshCurvature;
+            mMeshCurvatures[triMesh] = std::make_pair(meshCurvature, GPP::Int(-1));
+        }
+        if (meshCurvature->Init(triMesh) != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(meshCurvature);
+            mMeshCurvatures.erase(triMesh);
+            return NULL;
+        }
+        mMeshCurvatures[triMesh].second = generation;
+        return meshCurvature;
+    }
+
+    MagicCore::PointNeighborGraph* ModelManager::GetPointNeighborGraph(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount)
+    {
+        if (pointCloud == NULL)
+        {
+            return NULL;
+        }
+        GPP::Int generation = mPointCloudGenerations[pointCloud];
+        MagicCore::PointNeighborGraph* neighborGraph = NULL;
+        std::map<const GPP::IPointCloud*, MagicCore::PointNeighborGraph*>::iterator itr = mPointNeighborGraphs.find(pointCloud);
+        if (itr != mPointNeighborGraphs.end())
+        {
+            neighborGraph = itr->second;
+            if (neighborGraph->IsValid(pointCloud, neighborCount, generation))
+            {
+                return neighborGraph;
+            }
+        }
+        else
+        {
+            neighborGraph = new MagicCore::PointNeighborGraph;
+            mPointNeighborGraphs[pointCloud] = neighborGraph;
+        }
+        // Points are edited, more neighbors are needed or it is the first query: build it
+        if (neighborGraph->Init(pointCloud, neighborCount, generation) != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(neighborGraph);
+            mPointNeighborGraphs.erase(pointCloud);
+            return NULL;
+        }
+        return neighborGraph;
+    }
+
+    GPP::Int ModelManager::GetPointCloudGeneration(const GPP::IPointCloud* pointCloud)
+    {
+        return mPointCloudGenerations[pointCloud];
+    }
+
+    void ModelManager::IncreasePointCloudGeneration(const GPP::IPointCloud* pointCloud)
+    {
+        mPointCloudGenerations[pointCloud]++;
+    }
+
+    void ModelManager::RefreshPointNeighborGraph(const GPP::IPointCloud* pointCloud)
+    {
+        std::map<const GPP::IPointCloud*, MagicCore::PointNeighborGraph*>::iterator itr = mPointNeighborGraphs.find(pointCloud);
+        if (itr != mPointNeighborGraphs.end())
+        {
+            if (itr->second->GetGeneration() != mPointCloudGenerations[pointCloud] || itr->second->Refresh() != GPP_NO_ERROR)
+            {
+                ReleasePointNeighborGraph(pointCloud);
+            }
+        }
+    }
+
+    void ModelManager::ReleasePointNeighborGraph(const GPP::IPointCloud* pointCloud)
+    {
+        std::map<const GPP::IPointCloud*, MagicCore::PointNeighborGraph*>::iterator itr = mPointNeighborGraphs.find(pointCloud);
+        if (itr != mPointNeighborGraphs.end())
+        {
+            GPPFREEPOINTER(itr->second);
+            mPointNeighborGraphs.erase(itr);
+        }
+        mPointCloudGenerations.erase(pointCloud);
+    }
+
+    UndoJournal* ModelManager::GetUndoJournal(UndoModel model)
+    {
+        UndoJournal*& undoJournal = (model == UNDO_POINTCLOUD) ? mpPointCloudUndoJournal : mpMeshUndoJournal;
+        if (undoJournal == NULL)
+        {
+            undoJournal = new UndoJournal;
+            // Both journals share the default budget
+            undoJournal->SetMemoryBudget(undoJournal->GetMemoryBudget() / 2);
+        }
+        return undoJournal;
+    }
+
     void ModelManager::DumpInfo(std::ofstream& dumpOut) const
     {
         dumpOut << mImageColorIds.size() << std::endl;
@@ -1,6 +1,16 @@
 #pragma once
 #include "GPP.h"
+#include "UndoJournal.h"
 #include <string>
+#include <map>
+
+namespace MagicCore
+{
+    class MeshQueryEngine;
+    class PointNeighborGraph;
+    class HeatGeodesics;
+    class MeshCurvature;
+}
 
 namespace MagicApp
 {
@@ -13,7 +23,10 @@ namespace MagicApp
         static ModelManager* Get(void);
 
         bool ImportPointCloud(std::string fileName);
+        // Set and Clear drop the undo journal of the point cloud, records could not be applied on another model
         void SetPointCloud(GPP::PointCloud* pointCloud);
+        // SetPointCloud which keeps the undo journal, for commands which record the replacement themselves
+        void ReplacePointCloud(GPP::PointCloud* pointCloud);
         GPP::PointCloud* GetPointCloud(void);
         void ClearPointCloud(void);
 
@@ -43,10 +56,41 @@ namespace MagicApp
         std::vector<int>* GetImageColorIdFlagsPointer(void);
 
         bool ImportMesh(std::string fileName);
+        // Set and Clear drop the undo journal of the mesh
         void SetMesh(GPP::TriMesh* triMesh);
+        // SetMesh which keeps the undo journal, for commands which record the replacement themselves
+        void ReplaceMesh(GPP::TriMesh* triMesh);
         GPP::TriMesh* GetMesh(void);
         void ClearMesh(void);
 
+        // Query engine of triMesh is built at the first call and refitted after the edit generation of triMesh changes
+        MagicCore::MeshQueryEngine* GetMeshQueryEngine(const GPP::ITriMesh* triMesh);
+        // Call it before triMesh is deleted, the heat geodesics and curvature of triMesh are released too
+        void ReleaseMeshQueryEngine(const GPP::ITriMesh* triMesh);
+        // Edit generation of triMesh, a released or new mesh never reuses an old generation
+        GPP::Int GetMeshGeneration(const GPP::ITriMesh* triMesh);
+        // Call it after triMesh is edited in place, the caches of triMesh are not checked against its content
+        void IncreaseMeshGeneration(const GPP::ITriMesh* triMesh);
+        // Heat geodesics of triMesh are factorized at the first call and rebuilt after the edit generation of triMesh changes
+        MagicCore::HeatGeodesics* GetHeatGeodesics(const GPP::ITriMesh* triMesh);
+        // Curvature of triMesh is computed at the first call and recomputed after the edit generation of triMesh changes
+        MagicCore::MeshCurvature* GetMeshCurvature(const GPP::ITriMesh* triMesh);
+
+        // Neighbor graph of pointCloud is built at the first call and reused while the edit generation of pointCloud
+        // is unchanged and the graph has at least neighborCount neighbors per point
+        MagicCore::PointNeighborGraph* GetPointNeighborGraph(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount);
+        GPP::Int GetPointCloudGeneration(const GPP::IPointCloud* pointCloud);
+        // Call it after points of pointCloud are inserted, deleted or reordered
+        void IncreasePointCloudGeneration(const GPP::IPointCloud* pointCloud);
+        // Call it after point coordinates of pointCloud are changed slightly. A graph of an old generation is released
+        // instead, it is rebuilt by the next GetPointNeighborGraph anyway.
+        void RefreshPointNeighborGraph(const GPP::IPointCloud* pointCloud);
+        // Call it before pointCloud is deleted
+        void ReleasePointNeighborGraph(const GPP::IPointCloud* pointCloud);
+
+        // Point cloud and mesh have their own undo journal, it is cleared whenever the model is imported, set or cleared
+        UndoJournal* GetUndoJournal(UndoModel model);
+
         void DumpInfo(std::ofstream& dumpOut) const;
         void LoadInfo(std::ifstream& loadIn);
 
@@ -62,5 +106,14 @@ namespace MagicApp
         std::vector<int> mCloudIds;
         std::vector<int> mColorIds;
         std::vector<int> mImageColorIdFlags;
+        std::map<const GPP::ITriMesh*, MagicCore::MeshQueryEngine*> mMeshQueryEngines;
+        std::map<const GPP::IPointCloud*, MagicCore::PointNeighborGraph*> mPointNeighborGraphs;
+        std::map<const GPP::IPointCloud*, GPP::Int> mPointCloudGenerations;
+        std::map<const GPP::ITriMesh*, GPP::Int> mMeshGenerations;
+        GPP::Int mMeshGenerationCount;
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::HeatGeodesics*, GPP::Int> > mHeatGeodesics;
+        std::map<const GPP::ITriMesh*, std::pair<MagicCore::MeshCurvature*, GPP::Int> > mMeshCurvatures;
+        UndoJournal* mpPointCloudUndoJournal;
+        UndoJournal* mpMeshUndoJournal;
     };
 }
@@ -0,0 +1,483 @@
+#include "PartitionSimplifier.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/PointQueryEngine.h"
+#include "../Common/LogSystem.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace MagicApp
+{
+    static const GPP::Int gMinPartitionTriangleCount = 200000;
+
+    class CentroidLess
+    {
+    public:
+        CentroidLess(const std::vector<float>* centroids, GPP::Int axis) :
+            mpCentroids(centroids),
+            mAxis(axis)
+        {
+        }
+
+        bool operator()(GPP::Int fid0, GPP::Int fid1) const
+        {
+            return (*mpCentroids)[fid0 * 3 + mAxis] < (*mpCentroids)[fid1 * 3 + mAxis];
+        }
+
+    private:
+        const std::vector<float>* mpCentroids;
+        GPP::Int mAxis;
+    };
+
+    // Triangle range [startId, endId) which is split into leafCount partitions
+    struct PartitionRange
+    {
+        GPP::Int startId;
+        GPP::Int endId;
+        GPP::Int leafCount;
+    };
+
+    struct SeamCoord
+    {
+        GPP::Real coord[3];
+        GPP::Int vertexId;
+
+        bool operator<(const SeamCoord& other) const
+        {
+            if (coord[0] != other.coord[0])
+            {
+                return coord[0] < other.coord[0];
+            }
+            if (coord[1] != other.coord[1])
+            {
+                return coord[1] < other.coord[1];
+            }
+            return coord[2] < other.coord[2];
+        }
+    };
+
+    class PartitionSimplifyTask : public MagicCore::ParallelTask
+    {
+    public:
+        PartitionSimplifyTask(PartitionSimplifier* simplifier, const GPP::ITriMesh* triMesh, GPP::Real vertexRatio,
+            const std::vector<GPP::Real>* vertexFields) :
+            mpSimplifier(simplifier),
+            mpTriMesh(triMesh),
+            mVertexRatio(vertexRatio),
+            mpVertexFields(vertexFields)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                mpSimplifier->mPartitionResults[pid] = mpSimplifier->SimplifyPartition(mpTriMesh, pid, mVertexRatio, mpVertexFields);
+            }
+        }
+
+    private:
+        PartitionSimplifier* mpSimplifier;
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Real mVertexRatio;
+        const std::vector<GPP::Real>* mpVertexFields;
+    };
+
+    PartitionSimplifier::PartitionSimplifier() :
+        mFieldDim(0),
+        mSeamVertexCount(0),
+        mTriangleIds(),
+        mPartitionStarts(),
+        mVertexOwners(),
+        mPartitions(),
+        mPartitionResults()
+    {
+    }
+
+    PartitionSimplifier::~PartitionSimplifier()
+    {
+    }
+
+    GPP::ErrorCode PartitionSimplifier::Simplify(GPP::TriMesh* triMesh, GPP::Int targetVertexCount, GPP::Int partitionCount,
+        const std::vector<GPP::Real>* vertexFields, std::vector<GPP::Real>* simplifiedVertexFields,
+        std::vector<GPP::Int>* sourceVertexIds)
+    {
+        Clear();
+        if (triMesh == NULL || targetVertexCount < 4)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        if (vertexCount <= targetVertexCount)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (vertexFields != NULL)
+        {
+            if (simplifiedVertexFields == NULL || vertexFields->size() % vertexCount != 0)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            mFieldDim = vertexFields->size() / vertexCount;
+        }
+        // Input coordinates are gone after simplification
+        MagicCore::PointQueryEngine sourceEngine;
+        if (sourceVertexIds != NULL)
+        {
+            GPP::TriMeshPointList pointList(triMesh);
+            GPP::ErrorCode res = sourceEngine.Init(&pointList);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+        }
+
+        bool needSerial = true;
+        std::vector<GPP::Real> mergedVertexFields;
+        if (partitionCount > 1)
+        {
+            PartitionTriangles(triMesh, partitionCount);
+            partitionCount = mPartitionStarts.size() - 1;
+            mPartitions.resize(partitionCount);
+            mPartitionResults.resize(partitionCount, GPP_NO_ERROR);
+            GPP::Real vertexRatio = GPP::Real(targetVertexCount) / vertexCount;
+            PartitionSimplifyTask task(this, triMesh, vertexRatio, vertexFields);
+            MagicCore::ThreadPool::Get()->ParallelFor(partitionCount, &task, 1);
+            needSerial = false;
+            for (GPP::Int pid = 0; pid < partitionCount; pid++)
+            {
+                if (mPartitionResults.at(pid) == GPP_API_IS_NOT_AVAILABLE)
+                {
+                    Clear();
+                    return GPP_API_IS_NOT_AVAILABLE;
+                }
+                if (mPartitionResults.at(pid) != GPP_NO_ERROR)
+                {
+                    InfoLog << "PartitionSimplifier: partition " << pid << " failed, simplify the whole mesh" << std::endl;
+                    needSerial = true;
+                    break;
+                }
+            }
+            if (!needSerial)
+            {
+                MergePartitions(triMesh, vertexFields, mergedVertexFields);
+                vertexFields = mFieldDim > 0 ? &mergedVertexFields : NULL;
+                InfoLog << "PartitionSimplifier: " << partitionCount << " partitions, " << mSeamVertexCount
+                    << " seam vertices, " << triMesh->GetVertexCount() << " vertices before the seam pass" << std::endl;
+            }
+            std::vector<SimplifiedPartition>().swap(mPartitions);
+            std::vector<GPP::Int>().swap(mTriangleIds);
+            std::vector<GPP::Int>().swap(mVertexOwners);
+        }
+
+        GPP::ErrorCode res = GPP_NO_ERROR;
+        if (triMesh->GetVertexCount() > targetVertexCount)
+        {
+            // Serial mode, or the seam pass which also simplifies the input boundary left by the partition pass
+            res = GPP::SimplifyMesh::QuadricSimplify(triMesh, targetVertexCount, false, vertexFields, simplifiedVertexFields);
+        }
+        else if (vertexFields != NULL)
+        {
+            *simplifiedVertexFields = *vertexFields;
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+
+        if (sourceVertexIds != NULL)
+        {
+            GPP::Int simplifiedVertexCount = triMesh->GetVertexCount();
+            std::vector<GPP::Vector3> simplifiedCoords(simplifiedVertexCount);
+            for (GPP::Int vid = 0; vid < simplifiedVertexCount; vid++)
+            {
+                simplifiedCoords.at(vid) = triMesh->GetVertexCoord(vid);
+            }
+            sourceEngine.QueryNearestPoints(simplifiedCoords, 1, 0, sourceVertexIds, NULL);
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int PartitionSimplifier::SuggestPartitionCount(const GPP::ITriMesh* triMesh)
+    {
+        if (triMesh == NULL)
+        {
+            return 1;
+        }
+        GPP::Int partitionCount = std::min(triMesh->GetTriangleCount() / gMinPartitionTriangleCount,
+            GPP::Int(MagicCore::ThreadPool::Get()->GetThreadCount()) * 2);
+        return partitionCount > 1 ? partitionCount : 1;
+    }
+
+    GPP::Int PartitionSimplifier::GetPartitionCount() const
+    {
+        return mPartitionStarts.empty() ? 1 : mPartitionStarts.size() - 1;
+    }
+
+    GPP::Int PartitionSimplifier::GetSeamVertexCount() const
+    {
+        return mSeamVertexCount;
+    }
+
+    void PartitionSimplifier::PartitionTriangles(const GPP::ITriMesh* triMesh, GPP::Int partitionCount)
+    {
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        GPP::Int faceCount = triMesh->GetTriangleCount();
+        std::vector<float> centroids(faceCount * 3);
+        mTriangleIds.resize(faceCount);
+        GPP::Int vertexIds[3];
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            GPP::Vector3 centroid = (triMesh->GetVertexCoord(vertexIds[0]) + triMesh->GetVertexCoord(vertexIds[1]) +
+                triMesh->GetVertexCoord(vertexIds[2])) / 3.0;
+            centroids[fid * 3] = float(centroid[0]);
+            centroids[fid * 3 + 1] = float(centroid[1]);
+            centroids[fid * 3 + 2] = float(centroid[2]);
+            mTriangleIds[fid] = fid;
+        }
+
+        // Median splits along the longest side, partition sizes are proportional to their leaf counts
+        std::vector<PartitionRange> rangeStack;
+        PartitionRange rootRange = {0, faceCount, partitionCount};
+        rangeStack.push_back(rootRange);
+        mPartitionStarts.clear();
+        while (!rangeStack.empty())
+        {
+            PartitionRange range = rangeStack.back();
+            rangeStack.pop_back();
+            if (range.leafCount == 1 || range.endId - range.startId < 2)
+            {
+                mPartitionStarts.push_back(range.startId);
+                continue;
+            }
+            float bboxMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+            float bboxMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            for (GPP::Int tid = range.startId; tid < range.endId; tid++)
+            {
+                const float* centroid = &centroids[mTriangleIds[tid] * 3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    bboxMin[axis] = std::min(bboxMin[axis], centroid[axis]);
+                    bboxMax[axis] = std::max(bboxMax[axis], centroid[axis]);
+                }
+            }
+            GPP::Int splitAxis = 0;
+            for (int axis = 1; axis < 3; axis++)
+            {
+                if (bboxMax[axis] - bboxMin[axis] > bboxMax[splitAxis] - bboxMin[splitAxis])
+                {
+                    splitAxis = axis;
+                }
+            }
+            GPP::Int lowLeafCount = range.leafCount / 2;
+            GPP::Int midId = range.startId + GPP::Int(GPP::ULongInt(range.endId - range.startId) * lowLeafCount / range.leafCount);
+            std::nth_element(mTriangleIds.begin() + range.startId, mTriangleIds.begin() + midId,
+                mTriangleIds.begin() + range.endId, CentroidLess(&centroids, splitAxis));
+            PartitionRange lowRange = {range.startId, midId, lowLeafCount};
+            PartitionRange highRange = {midId, range.endId, range.leafCount - lowLeafCount};
+            rangeStack.push_back(lowRange);
+            rangeStack.push_back(highRange);
+        }
+        std::sort(mPartitionStarts.begin(), mPartitionStarts.end());
+        mPartitionStarts.push_back(faceCount);
+
+        mVertexOwners.assign(vertexCount, -1);
+        GPP::Int partitionCountRes = mPartitionStarts.size() - 1;
+        for (GPP::Int pid = 0; pid < partitionCountRes; pid++)
+        {
+            for (GPP::Int tid = mPartitionStarts.at(pid); tid < mPartitionStarts.at(pid + 1); tid++)
+            {
+                triMesh->GetTriangleVertexIds(mTriangleIds[tid], vertexIds);
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    GPP::Int& owner = mVertexOwners[vertexIds[localId]];
+                    if (owner == -1)
+                    {
+                        owner = pid;
+                    }
+                    else if (owner != pid)
+                    {
+                        owner = -2;
+                    }
+                }
+            }
+        }
+        mSeamVertexCount = std::count(mVertexOwners.begin(), mVertexOwners.end(), -2);
+    }
+
+    GPP::ErrorCode PartitionSimplifier::SimplifyPartition(const GPP::ITriMesh* triMesh, GPP::Int partitionId,
+        GPP::Real vertexRatio, const std::vector<GPP::Real>* vertexFields)
+    {
+        GPP::Int startId = mPartitionStarts[partitionId];
+        GPP::Int endId = mPartitionStarts[partitionId + 1];
+        std::vector<GPP::Int> localVertexIds;
+        localVertexIds.reserve((endId - startId) * 3);
+        GPP::Int vertexIds[3];
+        for (GPP::Int tid = startId; tid < endId; tid++)
+        {
+            triMesh->GetTriangleVertexIds(mTriangleIds[tid], vertexIds);
+            localVertexIds.insert(localVertexIds.end(), vertexIds, vertexIds + 3);
+        }
+        std::sort(localVertexIds.begin(), localVertexIds.end());
+        localVertexIds.erase(std::unique(localVertexIds.begin(), localVertexIds.end()), localVertexIds.end());
+
+        GPP::Int localVertexCount = localVertexIds.size();
+        GPP::TriMesh localMesh;
+        std::vector<GPP::Real> localFields(localVertexCount * mFieldDim);
+        std::vector<SeamCoord> seamCoords;
+        for (GPP::Int lid = 0; lid < localVertexCount; lid++)
+        {
+            GPP::Int vid = localVertexIds[lid];
+            GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
+            localMesh.InsertVertex(coord);
+            for (GPP::Int did = 0; did < mFieldDim; did++)
+            {
+                localFields[lid * mFieldDim + did] = (*vertexFields)[vid * mFieldDim + did];
+            }
+            if (mVertexOwners[vid] == -2)
+            {
+                SeamCoord seamCoord = {{coord[0], coord[1], coord[2]}, vid};
+                seamCoords.push_back(seamCoord);
+            }
+        }
+        for (GPP::Int tid = startId; tid < endId; tid++)
+        {
+            triMesh->GetTriangleVertexIds(mTriangleIds[tid], vertexIds);
+            for (int localId = 0; localId < 3; localId++)
+            {
+                vertexIds[localId] = std::lower_bound(localVertexIds.begin(), localVertexIds.end(), vertexIds[localId]) - localVertexIds.begin();
+            }
+            localMesh.InsertTriangle(vertexIds[0], vertexIds[1], vertexIds[2]);
+        }
+        std::vector<GPP::Int>().swap(localVertexIds);
+        std::sort(seamCoords.begin(), seamCoords.end());
+
+        // Seam vertices are on the partition boundary, keepBoundary locks them
+        GPP::Int seamCount = seamCoords.size();
+        GPP::Int targetVertexCount = seamCount + GPP::Int((localVertexCount - seamCount) * vertexRatio + 0.5);
+        SimplifiedPartition& partition = mPartitions[partitionId];
+        if (targetVertexCount < localVertexCount && targetVertexCount >= 4)
+        {
+            std::vector<GPP::Real> simplifiedFields;
+            GPP::ErrorCode res = GPP::SimplifyMesh::QuadricSimplify(&localMesh, targetVertexCount, true,
+                mFieldDim > 0 ? &localFields : NULL, mFieldDim > 0 ? &simplifiedFields : NULL);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            localFields.swap(simplifiedFields);
+        }
+
+        localVertexCount = localMesh.GetVertexCount();
+        partition.vertexCoords.resize(localVertexCount);
+        partition.seamVertexIds.resize(localVertexCount);
+        GPP::Int matchCount = 0;
+        for (GPP::Int lid = 0; lid < localVertexCount; lid++)
+        {
+            GPP::Vector3 coord = localMesh.GetVertexCoord(lid);
+            partition.vertexCoords[lid] = coord;
+            partition.seamVertexIds[lid] = -1;
+            SeamCoord seamCoord = {{coord[0], coord[1], coord[2]}, -1};
+            std::vector<SeamCoord>::iterator seamItr = std::lower_bound(seamCoords.begin(), seamCoords.end(), seamCoord);
+            if (seamItr != seamCoords.end() && !(seamCoord < *seamItr) && seamItr->vertexId >= 0)
+            {
+                partition.seamVertexIds[lid] = seamItr->vertexId;
+                seamItr->vertexId = -1;
+                matchCount++;
+            }
+        }
+        if (matchCount != seamCount)
+        {
+            // A seam vertex is moved or removed, the partitions could not be welded
+            return GPP_INVALID_RESULT;
+        }
+        partition.vertexFields.swap(localFields);
+        GPP::Int localFaceCount = localMesh.GetTriangleCount();
+        partition.triangleVertexIds.resize(localFaceCount * 3);
+        for (GPP::Int fid = 0; fid < localFaceCount; fid++)
+        {
+            localMesh.GetTriangleVertexIds(fid, &partition.triangleVertexIds[fid * 3]);
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void PartitionSimplifier::MergePartitions(GPP::TriMesh* triMesh, const std::vector<GPP::Real>* vertexFields,
+        std::vector<GPP::Real>& mergedVertexFields)
+    {
+        // Seam vertices come first, mVertexOwners is reused as their merged ids
+        std::vector<GPP::Vector3> mergedCoords;
+        mergedCoords.reserve(mSeamVertexCount);
+        mergedVertexFields.clear();
+        GPP::Int vertexCount = mVertexOwners.size();
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            if (mVertexOwners[vid] != -2)
+            {
+                mVertexOwners[vid] = -1;
+                continue;
+            }
+            mVertexOwners[vid] = mergedCoords.size();
+            mergedCoords.push_back(triMesh->GetVertexCoord(vid));
+            for (GPP::Int did = 0; did < mFieldDim; did++)
+            {
+                mergedVertexFields.push_back((*vertexFields)[vid * mFieldDim + did]);
+            }
+        }
+
+        std::vector<GPP::Int> mergedTriangleIds;
+        std::vector<GPP::Int> localToMerged;
+        GPP::Int partitionCount = mPartitions.size();
+        for (GPP::Int pid = 0; pid < partitionCount; pid++)
+        {
+            SimplifiedPartition& partition = mPartitions.at(pid);
+            GPP::Int localVertexCount = partition.vertexCoords.size();
+            localToMerged.resize(localVertexCount);
+            for (GPP::Int lid = 0; lid < localVertexCount; lid++)
+            {
+                GPP::Int seamVertexId = partition.seamVertexIds[lid];
+                if (seamVertexId >= 0)
+                {
+                    localToMerged[lid] = mVertexOwners[seamVertexId];
+                    continue;
+                }
+                localToMerged[lid] = mergedCoords.size();
+                mergedCoords.push_back(partition.vertexCoords[lid]);
+                mergedVertexFields.insert(mergedVertexFields.end(), partition.vertexFields.begin() + lid * mFieldDim,
+                    partition.vertexFields.begin() + (lid + 1) * mFieldDim);
+            }
+            for (std::vector<GPP::Int>::iterator itr = partition.triangleVertexIds.begin(); itr != partition.triangleVertexIds.end(); ++itr)
+            {
+                mergedTriangleIds.push_back(localToMerged[*itr]);
+            }
+            std::vector<GPP::Vector3>().swap(partition.vertexCoords);
+            std::vector<GPP::Real>().swap(partition.vertexFields);
+            std::vector<GPP::Int>().swap(partition.seamVertexIds);
+            std::vector<GPP::Int>().swap(partition.triangleVertexIds);
+        }
+
+        bool hasVertexColor = triMesh->HasVertexColor();
+        triMesh->Clear();
+        GPP::Int mergedVertexCount = mergedCoords.size();
+        for (GPP::Int vid = 0; vid < mergedVertexCount; vid++)
+        {
+            triMesh->InsertVertex(mergedCoords[vid]);
+        }
+        GPP::Int mergedFaceCount = mergedTriangleIds.size() / 3;
+        for (GPP::Int fid = 0; fid < mergedFaceCount; fid++)
+        {
+            triMesh->InsertTriangle(mergedTriangleIds[fid * 3], mergedTriangleIds[fid * 3 + 1], mergedTriangleIds[fid * 3 + 2]);
+        }
+        triMesh->SetHasVertexColor(hasVertexColor);
+    }
+
+    void PartitionSimplifier::Clear()
+    {
+        mFieldDim = 0;
+        mSeamVertexCount = 0;
+        mTriangleIds.clear();
+        mPartitionStarts.clear();
+        mVertexOwners.clear();
+        mPartitions.clear();
+        mPartitionResults.clear();
+    }
+}
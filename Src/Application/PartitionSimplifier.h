@@ -0,0 +1,61 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+
+namespace MagicApp
+{
+    // Simplified triangles of a partition. Vertices which are locked on the seams keep the input vertex id in
+    // seamVertexIds, other vertices are -1.
+    struct SimplifiedPartition
+    {
+        std::vector<GPP::Vector3> vertexCoords;
+        std::vector<GPP::Real> vertexFields;
+        std::vector<GPP::Int> seamVertexIds;
+        std::vector<GPP::Int> triangleVertexIds;
+    };
+
+    // Quadric simplification of a big mesh on all threads.
+    // Triangles are split into spatial partitions by a kd tree of their centroids. Every partition is copied to its
+    // own mesh and simplified concurrently with its boundary locked, so neighboring partitions still share the seam
+    // vertices. A last serial pass on the merged mesh collapses the seam bands to the exact target vertex count.
+    class PartitionSimplifier
+    {
+    public:
+        PartitionSimplifier();
+        ~PartitionSimplifier();
+
+        // vertexFields: the same number of values per vertex, such as colors. They are interpolated like QuadricSimplify.
+        // sourceVertexIds: the nearest input vertex of each simplified vertex, it carries attributes which could not be
+        // interpolated, such as ImageColorIds. It could be NULL.
+        // partitionCount <= 1: the whole mesh is simplified by QuadricSimplify directly
+        GPP::ErrorCode Simplify(GPP::TriMesh* triMesh, GPP::Int targetVertexCount, GPP::Int partitionCount,
+            const std::vector<GPP::Real>* vertexFields, std::vector<GPP::Real>* simplifiedVertexFields,
+            std::vector<GPP::Int>* sourceVertexIds);
+
+        // Enough partitions to keep all threads busy, but not smaller than gMinPartitionTriangleCount triangles
+        static GPP::Int SuggestPartitionCount(const GPP::ITriMesh* triMesh);
+
+        GPP::Int GetPartitionCount(void) const;
+        GPP::Int GetSeamVertexCount(void) const;
+
+    private:
+        friend class PartitionSimplifyTask;
+        void PartitionTriangles(const GPP::ITriMesh* triMesh, GPP::Int partitionCount);
+        GPP::ErrorCode SimplifyPartition(const GPP::ITriMesh* triMesh, GPP::Int partitionId, GPP::Real vertexRatio,
+            const std::vector<GPP::Real>* vertexFields);
+        void MergePartitions(GPP::TriMesh* triMesh, const std::vector<GPP::Real>* vertexFields,
+            std::vector<GPP::Real>& mergedVertexFields);
+        void Clear(void);
+
+    private:
+        GPP::Int mFieldDim;
+        GPP::Int mSeamVertexCount;
+        // Triangles of partition pid are mTriangleIds[mPartitionStarts[pid], mPartitionStarts[pid + 1])
+        std::vector<GPP::Int> mTriangleIds;
+        std::vector<GPP::Int> mPartitionStarts;
+        // Partition id of each input vertex, -2 if it is shared by several partitions
+        std::vector<GPP::Int> mVertexOwners;
+        std::vector<SimplifiedPartition> mPartitions;
+        std::vector<GPP::ErrorCode> mPartitionResults;
+    };
+}
@@ -5,18 +5,31 @@
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/RenderSystem.h"
+#include "../Common/InputSystem.h"
 #include "../Common/ViewTool.h"
 #include "../Common/PickTool.h"
+#include "../Common/SelectionEngine.h"
 #include "opencv2/opencv.hpp"
 #include "ToolAnn.h"
 #include "AppManager.h"
 #include "MeshShopApp.h"
 #include "ModelManager.h"
-#include "MagicPointCloud.h"
+#include "AttributeChannels.h"
+#include "UndoJournal.h"
+#include "../Common/PointNeighborGraph.h"
+#include "../Common/PointQueryEngine.h"
+#include "../Common/BlockReconstruction.h"
 #include <algorithm>
 
 namespace MagicApp
 {
+    // Filters of larger point clouds show a preview first
+    static const GPP::Int gPreviewMinPointCount = 500000;
+    static const GPP::Int gPreviewPointCount = 100000;
+    // Smoothing uses GPP's filters. The neighbor graph filters of GraphConsolidation are faster on repeated runs
+    // but give different results, so they are only used when this is switched on
+    static const bool gUseGraphConsolidation = false;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         PointShopApp* app = (PointShopApp*)arg;
@@ -28,10 +41,34 @@ namespace MagicApp
         return 1;
     }
 
+    static unsigned __stdcall RunPreviewThread(void *arg)
+    {
+        PointShopApp* app = (PointShopApp*)arg;
+        if (app == NULL)
+        {
+            return 0;
+        }
+        app->RunFilterPreview();
+        return 1;
+    }
+
+    // The preview and the full point cloud are smoothed by the same filter: the neighbor graph filter if it is
+    // switched on, the points have normals and the graph could be built, otherwise GPP's
+    static GPP::ErrorCode SmoothGeometry(GPP::PointCloud* pointCloud, const MagicCore::PointNeighborGraph* neighborGraph,
+        GPP::Int generation, int smoothCount)
+    {
+        if (neighborGraph != NULL)
+        {
+            return MagicCore::GraphConsolidation::SmoothGeometry(pointCloud, neighborGraph, generation, 25, smoothCount);
+        }
+        return GPP::ConsolidatePointCloud::SmoothGeometry(pointCloud, 25, smoothCount);
+    }
+
     PointShopApp::PointShopApp() :
         mpUI(NULL),
         mpViewTool(NULL),
         mpPickTool(NULL),
+        mpSelectionEngine(NULL),
 #if DEBUGDUMPFILE
         mpDumpInfo(NULL),
 #endif
@@ -40,18 +77,20 @@ namespace MagicApp
         mIsCommandInProgress(false),
         mIsDepthImage(0),
         mReconstructionQuality(4),
-        mPointSelectFlag(),
+        mPointSelection(),
         mRightMouseType(MOVE),
         mMousePressdCoord(),
         mIgnoreBack(true),
         mNeedFillHole(false),
+        mOutOfCoreFileName(),
         mResolution(0),
         mEnterMeshShop(0),
         mSmoothCount(0),
         mNeighborCount(0),
         mColorNeighborCount(0),
         mIsolateValue(0),
-        mSharpDiff()
+        mSharpDiff(),
+        mFilterPreview()
     {
     }
 
@@ -60,6 +99,7 @@ namespace MagicApp
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        GPPFREEPOINTER(mpSelectionEngine);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
@@ -87,6 +127,13 @@ namespace MagicApp
             int progressValue = int(GPP::GetApiProgress() * 100.0);
             mpUI->SetProgressbar(progressValue);
         }
+        GPP::PointCloud* previewPointCloud = mFilterPreview.TakePreviewPointCloud();
+        if (previewPointCloud != NULL)
+        {
+            MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_PointShop", 
+                previewPointCloud->HasNormal() ? "CookTorrancePoint" : "SimplePoint", previewPointCloud);
+            GPPFREEPOINTER(previewPointCloud);
+        }
         if (mUpdatePointCloudRendering)
         {
             UpdatePointCloudRendering();
@@ -115,67 +162,33 @@ namespace MagicApp
     void PointShopApp::SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
     {
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
-        GPP::Vector2 pos0(startCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
-                    1.0 - startCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
-        GPP::Vector2 pos1(endCoordX * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth() - 1.0, 
-                    1.0 - endCoordY * 2.0 / MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
-        double minX = (pos0[0] < pos1[0]) ? pos0[0] : pos1[0];
-        double maxX = (pos0[0] > pos1[0]) ? pos0[0] : pos1[0];
-        double minY = (pos0[1] < pos1[1]) ? pos0[1] : pos1[1];
-        double maxY = (pos0[1] > pos1[1]) ? pos0[1] : pos1[1];
+        if (mpSelectionEngine == NULL)
+        {
+            mpSelectionEngine = new MagicCore::SelectionEngine;
+        }
         Ogre::Matrix4 worldM = MagicCore::RenderSystem::Get()->GetSceneManager()->getSceneNode("ModelNode")->_getFullTransform();
         Ogre::Matrix4 viewM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getViewMatrix();
         Ogre::Matrix4 projM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getProjectionMatrix();
-        Ogre::Matrix4 wvpM   = projM * viewM * worldM;
-        GPP::Int pointCount = pointCloud->GetPointCount();
-        GPP::Vector3 coord;
-        GPP::Vector3 normal;
-        bool ignoreBack = pointCloud->HasNormal() && mIgnoreBack;
-        for (GPP::Int pid = 0; pid < pointCount; pid++)
-        {
-            if (mRightMouseType == SELECT_ADD && mPointSelectFlag.at(pid))
-            {
-                continue;
-            }
-            else if (mRightMouseType == SELECT_DELETE && mPointSelectFlag.at(pid) == 0)
-            {
-                continue;
-            }
-            GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
-            Ogre::Vector3 ogreCoord(coord[0], coord[1], coord[2]);
-            ogreCoord = wvpM * ogreCoord;
-            if (ogreCoord.x > minX && ogreCoord.x < maxX && ogreCoord.y > minY && ogreCoord.y < maxY)
-            {
-                if (ignoreBack)
-                {
-                    normal = pointCloud->GetPointNormal(pid);
-                    Ogre::Vector4 ogreNormal(normal[0], normal[1], normal[2], 0);
-                    ogreNormal = worldM * ogreNormal;
-                    if (ogreNormal.z > 0)
-                    {
-                        if (mRightMouseType == SELECT_ADD)
-                        {
-                            mPointSelectFlag.at(pid) = 1;
-                        }
-                        else
-                        {
-                            mPointSelectFlag.at(pid) = 0;
-                        }
-                    }
-                }
-                else
-                {
-                    if (mRightMouseType == SELECT_ADD)
-                    {
-                        mPointSelectFlag.at(pid) = 1;
-                    }
-                    else
-                    {
-                        mPointSelectFlag.at(pid) = 0;
-                    }
-                }
-            }
-        }
+        Ogre::Matrix4 worldViewM = viewM * worldM;
+        GPP::Real worldViewMatrix[16], projMatrix[16];
+        for (int row = 0; row < 4; row++)
+        {
+            for (int col = 0; col < 4; col++)
+            {
+                worldViewMatrix[row * 4 + col] = worldViewM[row][col];
+                projMatrix[row * 4 + col] = projM[row][col];
+            }
+        }
+        mpSelectionEngine->SetView(worldViewMatrix, projMatrix, MagicCore::RenderSystem::Get()->GetRenderWindow()->getWidth(),
+            MagicCore::RenderSystem::Get()->GetRenderWindow()->getHeight());
+        GPP::PointCloudPointList pointList(pointCloud);
+        // Points hidden behind the visible surface are not selected
+        mpSelectionEngine->BuildDepthBuffer(&pointList, 1);
+        mpSelectionEngine->SetRectangle(startCoordX, startCoordY, endCoordX, endCoordY);
+        std::vector<GPP::Int> selectedIds;
+        mpSelectionEngine->Select(&pointList, pointCloud->HasNormal() && mIgnoreBack, selectedIds);
+        bool selectFlag = (mRightMouseType == SELECT_ADD);
+        mPointSelection.SetIds(selectedIds, selectFlag);
     }
 
     void PointShopApp::UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY)
@@ -225,23 +238,13 @@ namespace MagicApp
         MagicCore::RenderSystem::Get()->HideRenderingObject("PickRectangleObj");
     }
 
-    void PointShopApp::SetupMagicPointCloud(MagicPointCloud& magicPointCloud)
+    void PointShopApp::SetupAttributeChannels(AttributeChannelRegistry& channels)
     {
-        std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-        if (imageColorIds && imageColorIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetImageColorIds(imageColorIds);
-        }
-        std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-        if (colorIds && colorIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetColorIds(colorIds);
-        }
-        std::vector<int>* cloudIds = ModelManager::Get()->GetCloudIdsPointer();
-        if (cloudIds && cloudIds->size() == magicPointCloud.GetPointCount())
-        {
-            magicPointCloud.SetCloudIds(cloudIds);
-        }
+        // Side arrays of other sizes are stale and left untouched
+        channels.AddChannel(new PointCloudChannel(ModelManager::Get()->GetPointCloud()));
+        channels.AddVector(ModelManager::Get()->GetImageColorIdsPointer());
+        channels.AddVector(ModelManager::Get()->GetColorIdsPointer());
+        channels.AddVector(ModelManager::Get()->GetCloudIdsPointer());
     }
 
     void PointShopApp::SaveImageColorInfo()
@@ -265,13 +268,13 @@ namespace MagicApp
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
             ModelManager::Get()->LoadInfo(fin);
             fin.close();
 
-            MessageBox(NULL, "뵼ͼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入图像", "温馨提示", MB_OK);
             std::vector<std::string> fileNames;
             char filterName[] = "JPG Files(*.jpg)\0*.jpg\0PNG Files(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
             if (MagicCore::ToolKit::MultiFileOpenDlg(fileNames, filterName))
@@ -287,19 +290,19 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud == NULL)
         {
-            MessageBox(NULL, "mpPointCloud == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpPointCloud == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
         if (imageColorIds.size() != pointCloud->GetPointCount())
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpPointCloud->GetPointCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpPointCloud->GetPointCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -310,7 +313,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
@@ -344,7 +347,7 @@ namespace MagicApp
                 triMesh, meshColorIds, 1.0, false);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "TransferMappingToMesh Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "TransferMappingToMesh Failed", "温馨提示", MB_OK);
                 return;
             }
             std::vector<int> imageColorIdFlags(triMesh->GetVertexCount(), 1);
@@ -354,30 +357,25 @@ namespace MagicApp
         if (colorIds.size() > 0 && colorIds.size() == pointCloud->GetPointCount())
         {
             GPP::PointCloudPointList pointList(pointCloud);
-            GPP::Ann ann;
-            GPP::ErrorCode res = ann.Init(&pointList);
+            MagicCore::PointQueryEngine queryEngine;
+            GPP::ErrorCode res = queryEngine.Init(&pointList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
+            std::vector<GPP::Vector3> vertexCoords(vertexCount);
+            for (int vid = 0; vid < vertexCount; vid++)
+            {
+                vertexCoords.at(vid) = triMesh->GetVertexCoord(vid);
+            }
+            std::vector<GPP::Int> indexRes;
+            queryEngine.QueryNearestPoints(vertexCoords, 1, 0, &indexRes, NULL);
             std::vector<GPP::Int> meshColorIds(vertexCount);
-            double searchData[3] = {-1};
-            int indexRes[1] = {-1};
             for (int vid = 0; vid < vertexCount; vid++)
             {
-                GPP::Vector3 coord = triMesh->GetVertexCoord(vid);
-                searchData[0] = coord[0];
-                searchData[1] = coord[1];
-                searchData[2] = coord[2];
-                res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, NULL);
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
-                    return;
-                }
-                meshColorIds.at(vid) = colorIds.at(indexRes[0]);
+                meshColorIds.at(vid) = colorIds.at(indexRes.at(vid));
             }
             ModelManager::Get()->SetColorIds(meshColorIds);
         }
@@ -393,7 +391,7 @@ namespace MagicApp
             GPP::ErrorCode res = ann.Init(&pointList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
@@ -409,7 +407,7 @@ namespace MagicApp
                 res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, NULL);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "温馨提示", MB_OK);
                     return;
                 }
                 meshColorIds.at(vid) = colorIds.at(indexRes[0]);
@@ -424,7 +422,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::CalculatePointListDensity(&pointList, 5, pointDensity);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "CalculatePointListDensity Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "CalculatePointListDensity Failed", "温馨提示", MB_OK);
                 return;
             }
             pointDensity *= pointDensity;
@@ -434,7 +432,7 @@ namespace MagicApp
             res = ann.Init(&triMeshList);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ann Init Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Ann Init Failed", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
@@ -453,7 +451,7 @@ namespace MagicApp
                 res = ann.FindNearestNeighbors(searchData, 1, 1, indexRes, distanceRes);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "Ann FindNearestNeighbors Failed", "温馨提示", MB_OK);
                     return;
                 }
                 vertex2PointMap.at(indexRes[0]).push_back(pid);
@@ -601,12 +599,12 @@ namespace MagicApp
                 GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(ModelManager::Get()->GetPointCloud(), pickedId, mNeighborCount);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                     return true;
                 }
                 UpdatePointCloudRendering();
@@ -624,7 +622,11 @@ namespace MagicApp
 
     bool PointShopApp::KeyPressed( const OIS::KeyEvent &arg )
     {
-        if (arg.key == OIS::KC_D)
+        if ((arg.key == OIS::KC_Z || arg.key == OIS::KC_Y) && MagicCore::InputSystem::Get()->IsModifierDown(OIS::Keyboard::Ctrl))
+        {
+            UndoCommand(arg.key == OIS::KC_Z);
+        }
+        else if (arg.key == OIS::KC_D)
         {
 #if DEBUGDUMPFILE
             RunDumpInfo();
@@ -835,22 +837,24 @@ namespace MagicApp
         GPPFREEPOINTER(mpUI);
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        GPPFREEPOINTER(mpSelectionEngine);
 #if DEBUGDUMPFILE
         GPPFREEPOINTER(mpDumpInfo);
 #endif
-        mPointSelectFlag.clear();
+        mPointSelection.Clear();
         mRightMouseType = MOVE;
+        mFilterPreview.Clear();
     }
 
     void PointShopApp::ResetSelection()
     {
         if (ModelManager::Get()->GetPointCloud())
         {
-            mPointSelectFlag = std::vector<bool>(ModelManager::Get()->GetPointCloud()->GetPointCount(), 0);
+            mPointSelection.Resize(ModelManager::Get()->GetPointCloud()->GetPointCount());
         }
         else
         {
-            mPointSelectFlag.clear();
+            mPointSelection.Clear();
         }
         MagicCore::RenderSystem::Get()->HideRenderingObject("Primitive_PointShop");
     }
@@ -865,43 +869,60 @@ namespace MagicApp
         }
         else
         {
-            switch (mCommandType)
-            {
-            case MagicApp::PointShopApp::NONE:
-                break;
-            case MagicApp::PointShopApp::EXPORT:
-                ExportPointCloud(false);
-                break;
-            case MagicApp::PointShopApp::NORMALCALCULATION:
-                CalculatePointCloudNormal(mIsDepthImage, mNeighborCount, false);
-                break;
-            case MagicApp::PointShopApp::NORMALSMOOTH:
-                SmoothPointCloudNormal(mNeighborCount, false);
-                break;
-            case MagicApp::PointShopApp::NORMALUPDATE:
-                UpdatePointCloudNormal(mNeighborCount, false);
-                break;
-            case MagicApp::PointShopApp::OUTLIER:
-                RemovePointCloudOutlier(false);
-                break;
-            case MagicApp::PointShopApp::ISOLATE:
-                RemoveIsolatePart(mIsolateValue, false);
-                break;
-            case MagicApp::PointShopApp::GEOMETRYSMOOTH:
-                SmoothPointCloudGeoemtry(mSmoothCount, false);
-                break;
-            case MagicApp::PointShopApp::FUSECOLOR:
-                FusePointCloudColor(mColorNeighborCount, mSharpDiff[0], mSharpDiff[1], mSharpDiff[2], false);
-                break;
-            case MagicApp::PointShopApp::FUSETEXTURE:
-                FuseTextureImage(false);
-                break;
-            case MagicApp::PointShopApp::RECONSTRUCTION:
-                ReconstructMesh(mNeedFillHole, mReconstructionQuality, false);
-                return;
-                break;
-            default:
-                break;
+            bool isRefining = mFilterPreview.IsRefining();
+            do
+            {
+                if (isRefining)
+                {
+                    SetFilterRequest(mFilterPreview.GetRefineRequest());
+                }
+                switch (mCommandType)
+                {
+                case MagicApp::PointShopApp::NONE:
+                    break;
+                case MagicApp::PointShopApp::EXPORT:
+                    ExportPointCloud(false);
+                    break;
+                case MagicApp::PointShopApp::NORMALCALCULATION:
+                    CalculatePointCloudNormal(mIsDepthImage, mNeighborCount, false);
+                    break;
+                case MagicApp::PointShopApp::NORMALSMOOTH:
+                    SmoothPointCloudNormal(mNeighborCount, false);
+                    break;
+                case MagicApp::PointShopApp::NORMALUPDATE:
+                    UpdatePointCloudNormal(mNeighborCount, false);
+                    break;
+                case MagicApp::PointShopApp::OUTLIER:
+                    RemovePointCloudOutlier(false);
+                    break;
+                case MagicApp::PointShopApp::ISOLATE:
+                    RemoveIsolatePart(mIsolateValue, false);
+                    break;
+                case MagicApp::PointShopApp::GEOMETRYSMOOTH:
+                    SmoothPointCloudGeoemtry(mSmoothCount, false);
+                    break;
+                case MagicApp::PointShopApp::FUSECOLOR:
+                    FusePointCloudColor(mColorNeighborCount, mSharpDiff[0], mSharpDiff[1], mSharpDiff[2], false);
+                    break;
+                case MagicApp::PointShopApp::FUSETEXTURE:
+                    FuseTextureImage(false);
+                    break;
+                case MagicApp::PointShopApp::RECONSTRUCTION:
+                    ReconstructMesh(mNeedFillHole, mReconstructionQuality, false);
+                    return;
+                    break;
+                case MagicApp::PointShopApp::RECONSTRUCTION_OUTOFCORE:
+                    ReconstructMeshOutOfCore(mNeedFillHole, mReconstructionQuality, false);
+                    return;
+                    break;
+                default:
+                    break;
+                }
+            } while (mFilterPreview.FinishRefine());
+            if (isRefining)
+            {
+                // Replace the preview, the last run may fail
+                mUpdatePointCloudRendering = true;
             }
             mpUI->StopProgressbar();
         }
@@ -909,9 +930,9 @@ namespace MagicApp
 
     bool PointShopApp::ImportPointCloud()
     {
-        if (mIsCommandInProgress)
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -921,7 +942,7 @@ namespace MagicApp
             ModelManager::Get()->ClearMesh();
             if (ModelManager::Get()->ImportPointCloud(fileName) == false)
             {
-                MessageBox(NULL, "Ƶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败", "温馨提示", MB_OK);
                 return false;
             }
             mpUI->SetPointCloudInfo(ModelManager::Get()->GetPointCloud()->GetPointCount());
@@ -953,7 +974,7 @@ namespace MagicApp
             size_t dotPos = fileName.rfind('.');
             if (dotPos == std::string::npos)
             {
-                MessageBox(NULL, "ļ׺", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请输入文件后缀名", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real scaleValue = ModelManager::Get()->GetScaleValue();
@@ -963,7 +984,7 @@ namespace MagicApp
             pointCloud->UnifyCoords(scaleValue, objCenterCoord);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "导出点云失败", "温馨提示", MB_OK);
             }
         }
     }
@@ -977,7 +998,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -992,19 +1013,40 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::ConsolidatePointCloud::SmoothNormal(pointCloud, 0.250, neighborCount);
-            mIsCommandInProgress = false;
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(
+                new VertexRangeRecord(UNDO_POINTCLOUD, UNDO_NORMAL, 0, pointCloud->GetPointCount()));
+            MagicCore::PointNeighborGraph* neighborGraph = NULL;
+            if (gUseGraphConsolidation)
+            {
+                neighborGraph = ModelManager::Get()->GetPointNeighborGraph(pointCloud, neighborCount);
+            }
+            if (neighborGraph != NULL)
+            {
+                // Graph filter is not GPP's, see GraphConsolidation
+                InfoLog << "SmoothPointCloudNormal on the shared neighbor graph" << std::endl;
+                res = MagicCore::GraphConsolidation::SmoothNormal(pointCloud, neighborGraph,
+                    ModelManager::Get()->GetPointCloudGeneration(pointCloud), 0.250, neighborCount);
+            }
+            else
+            {
+                res = GPP::ConsolidatePointCloud::SmoothNormal(pointCloud, 0.250, neighborCount);
+            }
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߹⻬ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云法线光滑失败", "温馨提示", MB_OK);
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1017,7 +1059,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1029,25 +1071,40 @@ namespace MagicApp
         else
         {
             mIsCommandInProgress = true;
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(
+                new VertexRangeRecord(UNDO_POINTCLOUD, UNDO_NORMAL, 0, pointCloud->GetPointCount()));
             GPP::ErrorCode res = GPP::UpdatePointCloudNormal(pointCloud, neighborCount);
-            mIsCommandInProgress = false;
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߸ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云法线更新失败", "温馨提示", MB_OK);
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            mIsCommandInProgress = false;
         }
     }
 
     void PointShopApp::SmoothPointCloudGeoemtry(int smoothCount, bool isSubThread)
     {
-        if (IsCommandAvaliable() == false)
+        if (isSubThread && mFilterPreview.IsRefining())
+        {
+            FilterRequest request;
+            request.commandType = GEOMETRYSMOOTH;
+            request.values[0] = smoothCount;
+            if (QueueFilter(request))
+            {
+                return;
+            }
+        }
+        if (mFilterPreview.IsRefining() == false && IsCommandAvaliable() == false)
         {
             return;
         }
@@ -1055,6 +1112,7 @@ namespace MagicApp
         {
             mCommandType = GEOMETRYSMOOTH;
             mSmoothCount = smoothCount;
+            StartFilterPreview();
             DoCommand(true);
         }
         else
@@ -1064,19 +1122,46 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::ConsolidatePointCloud::SmoothGeometry(pointCloud, 25, smoothCount);
-            mIsCommandInProgress = false;
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(
+                new VertexRangeRecord(UNDO_POINTCLOUD, UNDO_COORD, 0, pointCloud->GetPointCount()));
+            MagicCore::PointNeighborGraph* neighborGraph = NULL;
+            if (gUseGraphConsolidation && pointCloud->HasNormal())
+            {
+                neighborGraph = ModelManager::Get()->GetPointNeighborGraph(pointCloud, 25);
+            }
+            if (neighborGraph != NULL)
+            {
+                // Graph filter is not GPP's, see GraphConsolidation
+                InfoLog << "SmoothPointCloudGeoemtry on the shared neighbor graph" << std::endl;
+            }
+            res = SmoothGeometry(pointCloud, neighborGraph, ModelManager::Get()->GetPointCloudGeneration(pointCloud),
+                smoothCount);
+            // Rows are re-sorted once for all iterations
+            ModelManager::Get()->RefreshPointNeighborGraph(pointCloud);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ƹ⻬ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云光滑失败", "温馨提示", MB_OK);
                 return;
             }
+            if (mFilterPreview.BeginCommit() == false)
+            {
+                // Parameters changed during the refinement, the next run starts from the points before this one
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Revert();
+                mIsCommandInProgress = false;
+                return;
+            }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            mFilterPreview.EndCommit();
             mUpdatePointCloudRendering = true;
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1100,12 +1185,12 @@ namespace MagicApp
             std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
             if (pointCloud->HasColor() == false)
             {
-                MessageBox(NULL, "ûɫϢ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云没有颜色信息", "温馨提示", MB_OK);
                 return;
             }
             if (pointCloud->GetPointCount() != colorIds.size())
             {
-                MessageBox(NULL, "ɫںҪIDϢ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云颜色融合需要点云ID信息", "温馨提示", MB_OK);
                 return;
             }
             mIsCommandInProgress = true;
@@ -1121,15 +1206,15 @@ namespace MagicApp
 #endif
             GPP::ErrorCode res = GPP::IntrinsicColor::TuneColorFromMultiFrame(pointCloud, neighborCount, 
                 colorIds, pointColors, GPP::Vector3(sharpDiff_H, sharpDiff_S, sharpDiff_V));
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫںʧ", "ܰʾ", MB_OK);
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云颜色融合失败", "温馨提示", MB_OK);
                 return;
             }
             for (int pid = 0; pid < pointCount; pid++)
@@ -1137,6 +1222,7 @@ namespace MagicApp
                 pointCloud->SetPointColor(pid, pointColors.at(pid));
             }
             mUpdatePointCloudRendering = true;
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1156,13 +1242,13 @@ namespace MagicApp
             GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
             if (pointCloud->HasColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入点云需要有颜色", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
             if (imageColorIds.size() != pointCloud->GetPointCount())
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
@@ -1190,7 +1276,7 @@ namespace MagicApp
                 cv::Mat image = cv::imread(textureImageFiles.at(iid));
                 if (image.data == NULL)
                 {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                     return;
                 }
                 int imageWidth = image.cols;
@@ -1208,7 +1294,7 @@ namespace MagicApp
                     imageWidth, imageHeight, imageData); 
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ͼŻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "纹理图优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 for (int y = 0; y < imageHeight; ++y)
@@ -1248,22 +1334,18 @@ namespace MagicApp
             return;
         }
         std::vector<GPP::Int> deleteIndex;
-        GPP::Int pointCount = pointCloud->GetPointCount();
-        for (GPP::Int pid = 0; pid < pointCount; pid++)
-        {
-            if (mPointSelectFlag.at(pid))
-            {
-                deleteIndex.push_back(pid);
-            }
-        }
-        MagicPointCloud magicPointCloud(pointCloud);
-        SetupMagicPointCloud(magicPointCloud);
-        GPP::ErrorCode res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
-        if (res != GPP_NO_ERROR)
-        {
-            MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+        mPointSelection.GetSelectedIds(deleteIndex);
+        ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(new PointDeleteRecord(deleteIndex));
+        AttributeChannelRegistry channels(pointCloud->GetPointCount());
+        SetupAttributeChannels(channels);
+        if (channels.Delete(deleteIndex) != GPP_NO_ERROR)
+        {
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+            MessageBox(NULL, "删点失败", "温馨提示", MB_OK);
             return;
         }
+        ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+        ModelManager::Get()->IncreasePointCloudGeneration(pointCloud);
         ResetSelection();
         mUpdatePointCloudRendering = true;
         mpUI->SetPointCloudInfo(pointCloud->GetPointCount());
@@ -1296,7 +1378,7 @@ namespace MagicApp
             GPP::Int pointCount = pointCloud->GetPointCount();
             if (pointCount < 1)
             {
-                MessageBox(NULL, "ƵĵС1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云的点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> outlierValue;
@@ -1305,15 +1387,15 @@ namespace MagicApp
             GPP::DumpOnce();
 #endif
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateOutlier(pointCloud, &outlierValue);
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             /*GPP::Real cutValue = 0.8;
@@ -1338,16 +1420,21 @@ namespace MagicApp
                     deleteIndex.push_back(pid);
                 }
             }
-            MagicPointCloud magicPointCloud(pointCloud);
-            SetupMagicPointCloud(magicPointCloud);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
-            if (res != GPP_NO_ERROR)
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(new PointDeleteRecord(deleteIndex));
+            AttributeChannelRegistry channels(pointCount);
+            SetupAttributeChannels(channels);
+            if (channels.Delete(deleteIndex) != GPP_NO_ERROR)
             {
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            ModelManager::Get()->IncreasePointCloudGeneration(pointCloud);
             ResetSelection();
             mUpdatePointCloudRendering = true;
             mpUI->SetPointCloudInfo(pointCloud->GetPointCount());
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1360,7 +1447,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1374,7 +1461,7 @@ namespace MagicApp
             GPP::Int pointCount = pointCloud->GetPointCount();
             if (pointCount < 1)
             {
-                MessageBox(NULL, "ƵĵС1ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云的点个数小于1，操作失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Real> isolation;
@@ -1383,15 +1470,15 @@ namespace MagicApp
             GPP::DumpOnce();
 #endif
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateIsolation(pointCloud, &isolation, 20, NULL);
-            mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥʧ", "ܰʾ", MB_OK);
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云去除孤立项失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -1403,50 +1490,21 @@ namespace MagicApp
                     deleteIndex.push_back(pid);
                 }
             }
-            MagicPointCloud magicPointCloud(pointCloud);
-            SetupMagicPointCloud(magicPointCloud);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
-            if (res != GPP_NO_ERROR)
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(new PointDeleteRecord(deleteIndex));
+            AttributeChannelRegistry channels(pointCount);
+            SetupAttributeChannels(channels);
+            if (channels.Delete(deleteIndex) != GPP_NO_ERROR)
             {
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            ModelManager::Get()->IncreasePointCloudGeneration(pointCloud);
             ResetSelection();
             mUpdatePointCloudRendering = true;
             mpUI->SetPointCloudInfo(pointCloud->GetPointCount());
-        }
-    }
-
-    static void SampleModelData(GPP::Int* sampleIndex, int sampleCount, int pointCount)
-    {
-        std::vector<GPP::ImageColorId>* imageColorIds = ModelManager::Get()->GetImageColorIdsPointer();
-        if (imageColorIds && imageColorIds->size() == pointCount)
-        {
-            std::vector<GPP::ImageColorId> sampleImageColorIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleImageColorIds.at(sid) = imageColorIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetImageColorIds(sampleImageColorIds);
-        }
-        std::vector<int>* colorIds = ModelManager::Get()->GetColorIdsPointer();
-        if (colorIds && colorIds->size() == pointCount)
-        {
-            std::vector<GPP::Int> sampleColorIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleColorIds.at(sid) = colorIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetColorIds(sampleColorIds);
-        }
-        std::vector<int>* cloudIds = ModelManager::Get()->GetCloudIdsPointer();
-        if (cloudIds && cloudIds->size() == pointCount)
-        {
-            std::vector<GPP::Int> sampleCloudIds(sampleCount);
-            for (int sid = 0; sid < sampleCount; sid++)
-            {
-                sampleCloudIds.at(sid) = cloudIds->at(sampleIndex[sid]);
-            }
-            ModelManager::Get()->SetCloudIds(sampleCloudIds);
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1465,44 +1523,21 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::SamplePointCloud::UniformSample(pointCloud, targetPointCount, sampleIndex, 0);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Ʋʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云采样失败", "温馨提示", MB_OK);
             GPPFREEARRAY(sampleIndex);
             return;
         }
 
-        bool hasNormal = pointCloud->HasNormal();
-        bool hasColor = pointCloud->HasColor();
-        GPP::PointCloud* samplePointCloud = new GPP::PointCloud(hasNormal, hasColor);
-        if (hasNormal)
-        {
-            for (GPP::Int sid = 0; sid < targetPointCount; sid++)
-            {
-                samplePointCloud->InsertPoint(pointCloud->GetPointCoord(sampleIndex[sid]), 
-                    pointCloud->GetPointNormal(sampleIndex[sid]));
-                if (hasColor)
-                {
-                    samplePointCloud->SetPointColor(sid, pointCloud->GetPointColor(sampleIndex[sid]));
-                }
-            }
-        }
-        else
-        {
-            for (GPP::Int sid = 0; sid < targetPointCount; sid++)
-            {
-                samplePointCloud->InsertPoint(pointCloud->GetPointCoord(sampleIndex[sid]));
-                if (hasColor)
-                {
-                    samplePointCloud->SetPointColor(sid, pointCloud->GetPointColor(sampleIndex[sid]));
-                }
-            }
-        }
-        SampleModelData(sampleIndex, targetPointCount, originPointCount);
-        ModelManager::Get()->SetPointCloud(samplePointCloud);
+        ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Push(new ModelSnapshotRecord(UNDO_POINTCLOUD));
+        AttributeChannelRegistry channels(originPointCount);
+        SetupAttributeChannels(channels);
+        channels.Gather(std::vector<GPP::Int>(sampleIndex, sampleIndex + targetPointCount));
+        ModelManager::Get()->IncreasePointCloudGeneration(pointCloud);
         ResetSelection();
         mUpdatePointCloudRendering = true;
         GPPFREEARRAY(sampleIndex);
@@ -1519,7 +1554,7 @@ namespace MagicApp
         GPP::Int originPointCount = pointCloud->GetPointCount();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "Ҫȼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云需要先计算法线", "温馨提示", MB_OK);
             return;
         }
         GPP::Int* sampleIndex = new GPP::Int[targetPointCount];
@@ -1530,12 +1565,12 @@ namespace MagicApp
             GPP::SAMPLE_QUALITY_HIGH);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Ʋʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云采样失败", "温馨提示", MB_OK);
             GPPFREEARRAY(sampleIndex);
             return;
         }
@@ -1555,34 +1590,11 @@ namespace MagicApp
         //}
         //mpPointCloud->SetHasColor(true);
 
-        bool hasNormal = pointCloud->HasNormal();
-        bool hasColor = pointCloud->HasColor();
-        GPP::PointCloud* samplePointCloud = new GPP::PointCloud(hasNormal, hasColor);
-        if (hasNormal)
-        {
-            for (GPP::Int sid = 0; sid < targetPointCount; sid++)
-            {
-                samplePointCloud->InsertPoint(pointCloud->GetPointCoord(sampleIndex[sid]), 
-                    pointCloud->GetPointNormal(sampleIndex[sid]));
-                if (hasColor)
-                {
-                    samplePointCloud->SetPointColor(sid, pointCloud->GetPointColor(sampleIndex[sid]));
-                }
-            }
-        }
-        else
-        {
-            for (GPP::Int sid = 0; sid < targetPointCount; sid++)
-            {
-                samplePointCloud->InsertPoint(pointCloud->GetPointCoord(sampleIndex[sid]));
-                if (hasColor)
-                {
-                    samplePointCloud->SetPointColor(sid, pointCloud->GetPointColor(sampleIndex[sid]));
-                }
-            }
-        }
-        SampleModelData(sampleIndex, targetPointCount, originPointCount);
-        ModelManager::Get()->SetPointCloud(samplePointCloud);
+        ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Push(new ModelSnapshotRecord(UNDO_POINTCLOUD));
+        AttributeChannelRegistry channels(originPointCount);
+        SetupAttributeChannels(channels);
+        channels.Gather(std::vector<GPP::Int>(sampleIndex, sampleIndex + targetPointCount));
+        ModelManager::Get()->IncreasePointCloudGeneration(pointCloud);
         ResetSelection();
 
         /*for (int sid = 0; sid < targetPointCount; sid++)
@@ -1603,7 +1615,7 @@ namespace MagicApp
         }
         if (resolution > 10000 || resolution < 1)
         {
-            MessageBox(NULL, "ֱΪ[1, 10000]", "ܰʾ", MB_OK);
+            MessageBox(NULL, "采样分辨率区间为[1, 10000]", "温馨提示", MB_OK);
             return;
         }
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
@@ -1627,12 +1639,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::SamplePointCloud::Simplify(pointCloud, resolution, simplifiedCloud, &fields, &simplifiedFields);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƽʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云简化失败", "温馨提示", MB_OK);
                 GPPFREEPOINTER(simplifiedCloud);
                 return;
             }
@@ -1649,17 +1661,18 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::SamplePointCloud::Simplify(pointCloud, resolution, simplifiedCloud, NULL, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƽʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云简化失败", "温馨提示", MB_OK);
                 GPPFREEPOINTER(simplifiedCloud);
                 return;
             }
         }
-        ModelManager::Get()->SetPointCloud(simplifiedCloud);
+        ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Push(new ModelSnapshotRecord(UNDO_POINTCLOUD));
+        ModelManager::Get()->ReplacePointCloud(simplifiedCloud);
         ResetSelection();
         UpdatePickTool();
         UpdatePointCloudRendering();
@@ -1686,19 +1699,24 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Prepare(
+                new VertexRangeRecord(UNDO_POINTCLOUD, UNDO_NORMAL, 0, pointCloud->GetPointCount()));
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculatePointCloudNormal(pointCloud, isDepthImage, neighborCount);
-            mIsCommandInProgress = false;
             mUpdatePointCloudRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Cancel();
+                mIsCommandInProgress = false;
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
+            ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD)->Commit();
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1711,7 +1729,7 @@ namespace MagicApp
         GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = pointCloud->GetPointCount();
@@ -1730,7 +1748,7 @@ namespace MagicApp
         }
         if (ModelManager::Get()->GetPointCloud()->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         if (mRightMouseType == REVERSE_NORMAL)
@@ -1744,25 +1762,33 @@ namespace MagicApp
         }
         if (mRightMouseType == REVERSE_NORMAL)
         {
-            MessageBox(NULL, "ҼƷתģʽٴεťƽģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云反转法线模式，再次点击本按钮返回平移模式", "温馨提示", MB_OK);
         }
     }
 
     void PointShopApp::ReconstructMesh(bool needFillHole,int quality, bool isSubThread)
     {
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        if (pointCloud == NULL)
+        {
+            if (isSubThread && MessageBox(NULL, "没有导入点云，是否从文件分块三角化超大点云？", "温馨提示", MB_OKCANCEL) == IDOK)
+            {
+                ReconstructMeshOutOfCore(needFillHole, quality);
+            }
+            return;
+        }
         if (IsCommandAvaliable() == false)
         {
             return;
         }
-        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
         if (pointCloud->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         else if (quality < 0 || quality > 6)
         {
-            MessageBox(NULL, "ǻΧ[0, 6]ԽԽãٶԽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "三角化质量参数范围[0, 6]，数字越大，质量越好，速度越慢", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1795,20 +1821,21 @@ namespace MagicApp
 #endif
                 GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(pointCloud, triMesh, quality, needFillHole, 
                     &pointColorFields, &vertexColorField, maxHoleAreaRatio);
-                mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                     GPPFREEPOINTER(triMesh);
+                    mIsCommandInProgress = false;
                     return;
                 }
                 if (!triMesh)
                 {
+                    mIsCommandInProgress = false;
                     return;
                 }
                 GPP::Int vertexCount = triMesh->GetVertexCount();
@@ -1832,20 +1859,21 @@ namespace MagicApp
 #endif
                 GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(pointCloud, triMesh, quality, needFillHole, 
                     NULL, NULL, maxHoleAreaRatio);
-                mIsCommandInProgress = false;
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                     GPPFREEPOINTER(triMesh);
+                    mIsCommandInProgress = false;
                     return;
                 }
                 if (!triMesh)
                 {
+                    mIsCommandInProgress = false;
                     return;
                 }
                 ConstructImageColorIdForMesh(triMesh, pointCloud);
@@ -1853,6 +1881,66 @@ namespace MagicApp
                 ModelManager::Get()->ClearPointCloud();
             }
             mEnterMeshShop = true;
+            mIsCommandInProgress = false;
+        }
+    }
+
+    void PointShopApp::ReconstructMeshOutOfCore(bool needFillHole, int quality, bool isSubThread)
+    {
+        if (isSubThread)
+        {
+            if (mIsCommandInProgress || mFilterPreview.IsRefining())
+            {
+                MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
+                return;
+            }
+            if (quality < 0 || quality > 6)
+            {
+                MessageBox(NULL, "三角化质量参数范围[0, 6]，数字越大，质量越好，速度越慢", "温馨提示", MB_OK);
+                return;
+            }
+            std::string fileName;
+            char filterName[] = "ASC Files(*.asc)\0*.asc\0XYZ Files(*.xyz)\0*.xyz\0";
+            if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName) == false)
+            {
+                return;
+            }
+            mOutOfCoreFileName = fileName;
+            mCommandType = RECONSTRUCTION_OUTOFCORE;
+            mReconstructionQuality = quality;
+            mNeedFillHole = needFillHole;
+            DoCommand(true);
+        }
+        else
+        {
+            GPP::TriMesh* triMesh = new GPP::TriMesh;
+            mIsCommandInProgress = true;
+            MagicCore::BlockReconstruction blockReconstruction;
+            GPP::ErrorCode res = blockReconstruction.Reconstruct(mOutOfCoreFileName, triMesh, quality, needFillHole);
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
+                GPPFREEPOINTER(triMesh);
+                mIsCommandInProgress = false;
+                return;
+            }
+            InfoLog << "ReconstructMeshOutOfCore: " << blockReconstruction.GetPointCount() << " points in "
+                << blockReconstruction.GetBlockCount() << " blocks, " << triMesh->GetVertexCount() << " vertices" << std::endl;
+            // Same coordinate system as an imported model
+            GPP::Real scaleValue = 1.0;
+            GPP::Vector3 objCenterCoord;
+            triMesh->UnifyCoords(2.0, &scaleValue, &objCenterCoord);
+            triMesh->UpdateNormal();
+            ModelManager::Get()->SetMesh(triMesh);
+            ModelManager::Get()->SetScaleValue(scaleValue);
+            ModelManager::Get()->SetObjCenterCoord(objCenterCoord);
+            mEnterMeshShop = true;
+            mIsCommandInProgress = false;
         }
     }
 
@@ -1896,13 +1984,13 @@ namespace MagicApp
         if (pointCloud->HasNormal())
         {
             MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_PointShop", "CookTorrancePoint", pointCloud, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER, &mPointSelectFlag, &selectColor);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, &mPointSelection, &selectColor);
         }
         else
         {
             InfoLog << " no color " << std::endl;
             MagicCore::RenderSystem::Get()->RenderPointCloud("PointCloud_PointShop", "SimplePoint", pointCloud, 
-                MagicCore::RenderSystem::MODEL_NODE_CENTER, &mPointSelectFlag, &selectColor);
+                MagicCore::RenderSystem::MODEL_NODE_CENTER, &mPointSelection, &selectColor);
         }
         //InfoLog << " done" << std::endl;
     }
@@ -1911,17 +1999,120 @@ namespace MagicApp
     {
         if (ModelManager::Get()->GetPointCloud() == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入点云", "温馨提示", MB_OK);
+            return false;
+        }
+        if (mIsCommandInProgress || mFilterPreview.IsRefining())
+        {
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
-        if (mIsCommandInProgress)
+        return true;
+    }
+
+    void PointShopApp::StartFilterPreview()
+    {
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        if (pointCloud->GetPointCount() < gPreviewMinPointCount)
+        {
+            return;
+        }
+        if (mFilterPreview.SamplePointCloud(pointCloud, gPreviewPointCount) == false)
+        {
+            return;
+        }
+        FilterRequest request = GetFilterRequest();
+        mFilterPreview.StartRefine(request);
+        RenderFilterPreview(request);
+    }
+
+    bool PointShopApp::QueueFilter(const FilterRequest& request)
+    {
+        if (mFilterPreview.QueueRefine(request) == false)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
             return false;
         }
+        RenderFilterPreview(request);
         return true;
     }
 
+    void PointShopApp::RenderFilterPreview(const FilterRequest& request)
+    {
+        if (mFilterPreview.RequestPreview(request))
+        {
+            _beginthreadex(NULL, 0, RunPreviewThread, (void *)this, 0, NULL);
+        }
+    }
+
+    void PointShopApp::RunFilterPreview()
+    {
+        do
+        {
+            FilterRequest request = mFilterPreview.GetPreviewRequest();
+            GPP::PointCloud* previewPointCloud = mFilterPreview.CreatePointCloud();
+            if (previewPointCloud == NULL)
+            {
+                continue;
+            }
+            GPP::ErrorCode res = GPP_NO_ERROR;
+            if (request.commandType == GEOMETRYSMOOTH)
+            {
+                MagicCore::PointNeighborGraph neighborGraph;
+                bool hasGraph = gUseGraphConsolidation && previewPointCloud->HasNormal() && neighborGraph.Init(previewPointCloud, 25, 0) == GPP_NO_ERROR;
+                res = SmoothGeometry(previewPointCloud, hasGraph ? &neighborGraph : NULL, 0, int(request.values[0]));
+            }
+            if (res == GPP_NO_ERROR)
+            {
+                mFilterPreview.SetPreviewResult(previewPointCloud);
+            }
+            else
+            {
+                GPPFREEPOINTER(previewPointCloud);
+            }
+        } while (mFilterPreview.FinishPreview());
+    }
+
+    FilterRequest PointShopApp::GetFilterRequest() const
+    {
+        FilterRequest request;
+        request.commandType = mCommandType;
+        if (mCommandType == GEOMETRYSMOOTH)
+        {
+            request.values[0] = mSmoothCount;
+        }
+        return request;
+    }
+
+    void PointShopApp::SetFilterRequest(const FilterRequest& request)
+    {
+        mCommandType = CommandType(request.commandType);
+        if (mCommandType == GEOMETRYSMOOTH)
+        {
+            mSmoothCount = int(request.values[0]);
+        }
+    }
+
+    void PointShopApp::UndoCommand(bool isUndo)
+    {
+        if (IsCommandAvaliable() == false)
+        {
+            return;
+        }
+        UndoJournal* undoJournal = ModelManager::Get()->GetUndoJournal(UNDO_POINTCLOUD);
+        bool isApplied = isUndo ? undoJournal->Undo() : undoJournal->Redo();
+        if (isApplied == false)
+        {
+            return;
+        }
+        ResetSelection();
+        UpdatePickTool();
+        UpdatePointCloudRendering();
+        if (ModelManager::Get()->GetPointCloud())
+        {
+            mpUI->SetPointCloudInfo(ModelManager::Get()->GetPointCloud()->GetPointCount());
+        }
+    }
+
     void PointShopApp::InitViewTool()
     {
         if (mpViewTool == NULL)
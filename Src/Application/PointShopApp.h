@@ -1,6 +1,7 @@
 #pragma once
 #include "AppBase.h"
-#include "MagicPointCloud.h"
+#include "../Common/SelectionSet.h"
+#include "FilterPreview.h"
 #include "Gpp.h"
 #if DEBUGDUMPFILE
 #include "DumpBase.h"
@@ -10,11 +11,13 @@ namespace MagicCore
 {
     class ViewTool;
     class PickTool;
+    class SelectionEngine;
 }
 
 namespace MagicApp
 {
     class PointShopAppUI;
+    class AttributeChannelRegistry;
     class PointShopApp : public AppBase
     {
         enum CommandType
@@ -28,6 +31,7 @@ namespace MagicApp
             ISOLATE,
             GEOMETRYSMOOTH,
             RECONSTRUCTION,
+            RECONSTRUCTION_OUTOFCORE,
             FUSECOLOR,
             FUSETEXTURE
         };
@@ -70,6 +74,8 @@ namespace MagicApp
         void FlipPointCloudNormal(void);
         void ReversePatchNormal(int neighborCount);
         void ReconstructMesh(bool needFillHole, int quality, bool isSubThread = true);
+        // Reconstruct a point file which is too large to import, block by block
+        void ReconstructMeshOutOfCore(bool needFillHole, int quality, bool isSubThread = true);
 
         void RemovePointCloudOutlier(bool isSubThread = true);
         void RemoveIsolatePart(double isolateValue, bool isSubThread = true);
@@ -93,16 +99,29 @@ namespace MagicApp
         void RunDumpInfo(void);
 #endif
         bool IsCommandInProgress(void);
+        // Called by the preview thread
+        void RunFilterPreview(void);
 
     private:
         void InitViewTool(void);
         void UpdatePickTool(void);
         void UpdatePointCloudRendering(void);
         bool IsCommandAvaliable(void);
+        // Filter the sampled points of a large point cloud by mCommandType and start the refinement
+        void StartFilterPreview(void);
+        // The request replaces the running refinement, return false if the refinement has finished
+        bool QueueFilter(const FilterRequest& request);
+        // The preview is filtered on the preview thread and rendered by Update
+        void RenderFilterPreview(const FilterRequest& request);
+        // Parameters of mCommandType, SetFilterRequest is called by the command thread during the refinement
+        FilterRequest GetFilterRequest(void) const;
+        void SetFilterRequest(const FilterRequest& request);
         void SelectControlPointByRectangle(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void UpdateRectangleRendering(int startCoordX, int startCoordY, int endCoordX, int endCoordY);
         void ClearRectangleRendering(void);
-        void SetupMagicPointCloud(MagicPointCloud& magicPointCloud);
+        void SetupAttributeChannels(AttributeChannelRegistry& channels);
+        // isUndo == false: redo
+        void UndoCommand(bool isUndo);
         
         void PickPointCloudColorFromImages(void);
         void ConstructImageColorIdForMesh(GPP::TriMesh* triMesh, const GPP::IPointCloud* pointCloud);
@@ -117,6 +136,7 @@ namespace MagicApp
         PointShopAppUI* mpUI;
         MagicCore::ViewTool* mpViewTool;
         MagicCore::PickTool* mpPickTool;
+        MagicCore::SelectionEngine* mpSelectionEngine;
 #if DEBUGDUMPFILE
         GPP::DumpBase* mpDumpInfo;
 #endif
@@ -125,11 +145,12 @@ namespace MagicApp
         bool mIsCommandInProgress;
         bool mIsDepthImage;
         int mReconstructionQuality;
-        std::vector<bool> mPointSelectFlag;
+        MagicCore::SelectionSet mPointSelection;
         RightMouseType mRightMouseType;
         GPP::Vector2 mMousePressdCoord;
         bool mIgnoreBack;
         bool mNeedFillHole;
+        std::string mOutOfCoreFileName;
         int mResolution;
         bool mEnterMeshShop;
         int mSmoothCount;
@@ -137,5 +158,6 @@ namespace MagicApp
         int mColorNeighborCount;
         double mIsolateValue;
         GPP::Vector3 mSharpDiff;
+        FilterPreview mFilterPreview;
     };
 }
@@ -12,6 +12,10 @@
 #include "opencv2/opencv.hpp"
 #include "ToolAnn.h"
 #include "ModelManager.h"
+#include "FusePipeline.h"
+#include "SparseFusePointCloud.h"
+#include "AttributeChannels.h"
+#include "../Common/ThreadPool.h"
 #if DEBUGDUMPFILE
 #include "DumpRegistratePointCloud.h"
 #endif
@@ -31,6 +35,91 @@ namespace MagicApp
         return 1;
     }
 
+    // Copy point colors between point cloud and color array
+    class PointColorCopyTask : public MagicCore::ParallelTask
+    {
+    public:
+        PointColorCopyTask(GPP::PointCloud* pointCloud, std::vector<GPP::Vector3>* colors, bool toPointCloud) :
+            mpPointCloud(pointCloud),
+            mpColors(colors),
+            mToPointCloud(toPointCloud)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            if (mToPointCloud)
+            {
+                for (int pid = startId; pid < endId; pid++)
+                {
+                    mpPointCloud->SetPointColor(pid, (*mpColors)[pid]);
+                }
+            }
+            else
+            {
+                for (int pid = startId; pid < endId; pid++)
+                {
+                    (*mpColors)[pid] = mpPointCloud->GetPointColor(pid);
+                }
+            }
+        }
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        std::vector<GPP::Vector3>* mpColors;
+        bool mToPointCloud;
+    };
+
+    // Dense SumPointCloud allocates the whole bounding volume, larger volumes are fused by SparseFusePointCloud
+    static const double gDenseFuseCellLimit = 512.0 * 512.0 * 512.0;
+    static const int gSparseExtractBatchSize = 1 << 18;
+
+    // Collect batches of SparseFusePointCloud streaming extraction
+    class SparseExtractListener : public SparseFuseListener
+    {
+    public:
+        SparseExtractListener(GPP::PointCloud* pointCloud, std::vector<GPP::Real>* pointFields, std::vector<int>* cloudIds) :
+            mpPointCloud(pointCloud),
+            mpPointFields(pointFields),
+            mpCloudIds(cloudIds)
+        {
+        }
+
+        virtual bool ExtractPoints(const GPP::PointCloud* pointCloud, const std::vector<GPP::Real>* pointFields,
+            const std::vector<GPP::Int>* cloudIds)
+        {
+            GPP::Int pointCount = pointCloud->GetPointCount();
+            bool hasNormal = pointCloud->HasNormal();
+            mpPointCloud->SetHasNormal(hasNormal);
+            mpPointCloud->ReservePoint(mpPointCloud->GetPointCount() + pointCount);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                if (hasNormal)
+                {
+                    mpPointCloud->InsertPoint(pointCloud->GetPointCoord(pid), pointCloud->GetPointNormal(pid));
+                }
+                else
+                {
+                    mpPointCloud->InsertPoint(pointCloud->GetPointCoord(pid));
+                }
+            }
+            if (mpPointFields && pointFields)
+            {
+                mpPointFields->insert(mpPointFields->end(), pointFields->begin(), pointFields->end());
+            }
+            if (mpCloudIds && cloudIds)
+            {
+                mpCloudIds->insert(mpCloudIds->end(), cloudIds->begin(), cloudIds->end());
+            }
+            return true;
+        }
+
+    private:
+        GPP::PointCloud* mpPointCloud;
+        std::vector<GPP::Real>* mpPointFields;
+        std::vector<int>* mpCloudIds;
+    };
+
     RegistrationApp::RegistrationApp() :
         mpUI(NULL),
         mpViewTool(NULL),
@@ -43,6 +132,7 @@ namespace MagicApp
         mpPointCloudRef(NULL),
         mpPointCloudFrom(NULL),
         mpSumPointCloud(NULL),
+        mpFusePipeline(NULL),
         mObjCenterCoord(),
         mScaleValue(0),
         mRefMarks(),
@@ -89,6 +179,7 @@ namespace MagicApp
 #endif
         GPPFREEPOINTER(mpPointCloudRef);
         GPPFREEPOINTER(mpPointCloudFrom);
+        GPPFREEPOINTER(mpFusePipeline);
         for (std::vector<GPP::PointCloud*>::iterator itr = mPointCloudList.begin(); itr != mPointCloudList.end(); ++itr)
         {
             GPPFREEPOINTER(*itr);
@@ -112,7 +203,12 @@ namespace MagicApp
     {
         if (mpUI && mpUI->IsProgressbarVisible())
         {
-            if (mGlobalRegistrateProgress < 0)
+            if (mCommandType == GLOBAL_FUSE && mpFusePipeline)
+            {
+                int progressValue = int(mpFusePipeline->GetProgress() * 100.0);
+                mpUI->SetProgressbar(progressValue);
+            }
+            else if (mGlobalRegistrateProgress < 0)
             {
                 int progressValue = int(GPP::GetApiProgress() * 100.0);
                 mpUI->SetProgressbar(progressValue);
@@ -257,12 +353,12 @@ namespace MagicApp
                         GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(mpPointCloudRef, pickedIdRef);
                         if (res == GPP_API_IS_NOT_AVAILABLE)
                         {
-                            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                             MagicCore::ToolKit::Get()->SetAppRunning(false);
                         }
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                             return true;
                         }
                         UpdatePointCloudRefRendering();
@@ -286,12 +382,12 @@ namespace MagicApp
                         GPP::ErrorCode res = GPP::ConsolidatePointCloud::ReversePatchNormal(mpPointCloudFrom, pickedIdFrom);
                         if (res == GPP_API_IS_NOT_AVAILABLE)
                         {
-                            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                             MagicCore::ToolKit::Get()->SetAppRunning(false);
                         }
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "Ʒ߷޸ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "点云法线方向修复失败", "温馨提示", MB_OK);
                             return true;
                         }
                         UpdatePointCloudFromRendering();
@@ -336,7 +432,7 @@ namespace MagicApp
                     NULL, true, 0, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 return;
             }
             int pointListCount = pointCloudList.size();
@@ -359,7 +455,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::CalculatePointCloudListBoundingBox(pointCloudList, NULL, bboxMin, bboxMax);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloudPointList pointList(pointCloudList.at(0));
@@ -367,7 +463,7 @@ namespace MagicApp
             res = GPP::CalculatePointListDensity(&pointList, 5, density);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ܶȼʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云密度计算失败", "温馨提示", MB_OK);
                 return;
             }
             density *= intervalCount;
@@ -387,7 +483,7 @@ namespace MagicApp
                 res = sum.UpdateSumFunction(curPointCloud, NULL, &pointFields);
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                     return;
                 }
             }
@@ -396,7 +492,7 @@ namespace MagicApp
             res = sum.ExtractPointCloud(&fusedPointCloud, &pointFieldsFused, &cloudIds);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云抽取失败", "温馨提示", MB_OK);
                 return;
             }
             int fieldDim = 1;
@@ -419,7 +515,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateIsolation(&fusedPointCloud, &isolation, 20, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȥʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除孤立项失败", "温馨提示", MB_OK);
                 return;
             }
             int fusedPointCount = fusedPointCloud.GetPointCount();
@@ -432,12 +528,12 @@ namespace MagicApp
                     deleteIndex.push_back(pid);
                 }
             }
-            MagicPointCloud magicPointCloud(&fusedPointCloud);
-            magicPointCloud.SetImageColorIds(&imageColorIds_point);
-            res = GPP::DeletePointCloudElements(&magicPointCloud, deleteIndex);
-            if (res != GPP_NO_ERROR)
+            AttributeChannelRegistry channels(fusedPointCount);
+            channels.AddChannel(new PointCloudChannel(&fusedPointCloud));
+            channels.AddVector(&imageColorIds_point);
+            if (channels.Delete(deleteIndex) != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɾʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云删点失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -450,14 +546,14 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(&fusedPointCloud, &triMesh, quality, false, NULL, NULL);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ǻʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云三角化失败", "温馨提示", MB_OK);
                 return;
             }
             res = GPP::OptimiseMapping::TransferMappingToMesh(&fusedPointCloud, imageColorIds_point,
                 &triMesh, imageColorIds_mesh, 1.5, true);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "TransferMappingToMesh Failed", "ܰʾ", MB_OK);
+                MessageBox(NULL, "TransferMappingToMesh Failed", "温馨提示", MB_OK);
                 return;
             }
             fusedPointCloud.Clear();
@@ -472,7 +568,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(&triMesh, initChartCount, &texCoords, &faceTexIds, true, true, true);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "UV Atlas 生成失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -539,7 +635,7 @@ namespace MagicApp
                     cv::Mat image = cv::imread(textureImageFiles.at(iid));
                     if (image.data == NULL)
                     {
-                        MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                        MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                         return;
                     }
                     std::vector<GPP::Color4> oneImageData(width * height);
@@ -572,7 +668,7 @@ namespace MagicApp
                 imageListData, imageInfos, textureSize, textureSize, imageData, &textureImageMasks);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ͼʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理图生成失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -670,6 +766,10 @@ namespace MagicApp
         {
             mSaveGlobalRegistrateResult = true;
         }
+        else if (arg.key == OIS::KC_C)
+        {
+            CancelGlobalFuse();
+        }
         else if (arg.key == OIS::KC_T)
         {
             std::vector<GPP::IPointCloud*> pointCloudList;
@@ -678,7 +778,7 @@ namespace MagicApp
                 pointCloudList.push_back(*itr);
                 if ((*itr)->HasNormal() == false)
                 {
-                    MessageBox(NULL, "ҪϢ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云需要法线信息", "温馨提示", MB_OK);
                     return true;
                 }
             }
@@ -842,10 +942,10 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
-        MessageBox(NULL, "ȵͼ", "ܰʾ", MB_OK);
+        MessageBox(NULL, "请先导入图像", "温馨提示", MB_OK);
         char imageFilterName[] = "JPG Image(*.jpg)\0*.jpg\0PNG Image(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
         if (MagicCore::ToolKit::MultiFileOpenDlg(mTextureImageFiles, imageFilterName))
         {
@@ -858,14 +958,14 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ٵӦļ", "ܰʾ", MB_OK);
+        MessageBox(NULL, "再导入点像对应文件", "温馨提示", MB_OK);
         std::vector<std::string> mapFileNames;
         char mapFilterName[] = "SingleImage MAP Files(*.map)\0*.map\0MultiImage MAP Files(*.mmap)\0*.mmap\0";
         if (MagicCore::ToolKit::MultiFileOpenDlg(mapFileNames, mapFilterName))
         {
             if (mapFileNames.size() != mPointCloudList.size())
             {
-                MessageBox(NULL, "ӦļҪ͵һһӦ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点像对应文件需要和点云一一对应", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -880,7 +980,7 @@ namespace MagicApp
         size_t dotPos = mapFileNames.at(0).rfind('.');
         if (dotPos == std::string::npos)
         {
-            MessageBox(NULL, "ļʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "文件名解析失败", "温馨提示", MB_OK);
             return;
         }
         std::string extName = mapFileNames.at(0).substr(dotPos + 1);
@@ -893,7 +993,7 @@ namespace MagicApp
                 std::ifstream fin(mapFileNames.at(cloudId));
                 if (!fin)
                 {
-                    MessageBox(NULL, "Ӧļʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点像对应文件打开失败", "温馨提示", MB_OK);
                     return;
                 }
                 int curPointCount = mPointCloudList.at(cloudId)->GetPointCount();
@@ -920,7 +1020,7 @@ namespace MagicApp
                 std::ifstream fin(mapFileNames.at(cloudId));
                 if (!fin)
                 {
-                    MessageBox(NULL, "Ӧļʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点像对应文件打开失败", "温馨提示", MB_OK);
                     return;
                 }
                 int pointCount = 0;
@@ -949,7 +1049,7 @@ namespace MagicApp
             imageList.at(imageId) = cv::imread(mTextureImageFiles.at(imageId));
             if (imageList.at(imageId).data == NULL)
             {
-                MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
                 return;
             }
             imageHeightList.at(imageId) = imageList.at(imageId).rows;
@@ -1014,7 +1114,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "Ƶʧ, Ŀǰֵ֧ʽascobj", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败, 目前支持导入格式：asc，obj", "温馨提示", MB_OK);
             }
         }
         return false;
@@ -1028,7 +1128,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1050,12 +1150,12 @@ namespace MagicApp
             mUpdatePointRefRendering = true;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -1069,12 +1169,12 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = mpPointCloudRef->GetPointCount();
@@ -1093,13 +1193,13 @@ namespace MagicApp
         }
         else if (mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         mReversePatchNormalRef = !mReversePatchNormalRef;
         if (mReversePatchNormalRef)
         {
-            MessageBox(NULL, "ҼƷ޸ģʽƷת߷ٴεťʰȡģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云法线修复模式，点击点云反转法线方向，再次点击本按钮返回拾取模式", "温馨提示", MB_OK);
         }
     }
 
@@ -1111,7 +1211,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1127,13 +1227,13 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateOutlier(mpPointCloudRef, &uniformity);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 mIsCommandInProgress = false;
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.8;
@@ -1175,7 +1275,7 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ƱǵʽΪ\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "ܰʾ", MB_OK);
+        MessageBox(NULL, "点云标记点格式为：\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "温馨提示", MB_OK);
         std::string fileName;
         char filterName[] = "Ref Files(*.ref)\0*.ref\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
@@ -1208,7 +1308,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL || mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
 
@@ -1248,7 +1348,7 @@ namespace MagicApp
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
@@ -1278,12 +1378,12 @@ namespace MagicApp
             res = mpSumPointCloud->UpdateSumFunction(mpPointCloudFrom, NULL, &pointColorFieldsFrom);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
@@ -1294,13 +1394,13 @@ namespace MagicApp
             res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, &pointColorFieldsFused);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 GPPFREEPOINTER(extractPointCloud);
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             extractPointCloud->SetHasColor(true);
@@ -1321,12 +1421,12 @@ namespace MagicApp
             res = mpSumPointCloud->UpdateSumFunction(mpPointCloudFrom, NULL, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
@@ -1336,13 +1436,13 @@ namespace MagicApp
             res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, NULL);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 GPPFREEPOINTER(extractPointCloud);
-                MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
                 return;
             }
             GPPFREEPOINTER(mpPointCloudRef);
@@ -1405,7 +1505,7 @@ namespace MagicApp
             {
                 ClearPairwiseRegistrationData();
                 mMarkList.clear();
-                if (MessageBox(NULL, "ǷҪǵ", "ܰʾ", MB_YESNO) == IDYES)
+                if (MessageBox(NULL, "是否需要导入标记点", "温馨提示", MB_YESNO) == IDYES)
                 {
                     ImportMarkList();
                 }
@@ -1449,7 +1549,7 @@ namespace MagicApp
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 mIsCommandInProgress = false;
                 return;
             }
@@ -1485,7 +1585,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1526,12 +1626,12 @@ namespace MagicApp
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ȫעʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "全局注册失败", "温馨提示", MB_OK);
                 mIsCommandInProgress = false;
                 return;
             }
@@ -1583,7 +1683,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1622,7 +1722,7 @@ namespace MagicApp
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Χмʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "包围盒计算失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Vector3 deltaVector(0.25, 0.25, 0.25);
@@ -1636,70 +1736,58 @@ namespace MagicApp
             InfoLog << " pointlist density = " << density << std::endl;
             density *= intervalCount;
             InfoLog << " intervalCount = " << intervalCount << std::endl;
-            mpSumPointCloud = new GPP::SumPointCloud(density, bboxMin, bboxMax, hasNormalInfo, 25, 2);
+            double denseCellCount = 1;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                denseCellCount *= (bboxMax[axis] - bboxMin[axis]) / density + 1;
+            }
+            SparseFusePointCloud* sparsePointCloud = NULL;
+            if (denseCellCount > gDenseFuseCellLimit)
+            {
+                InfoLog << "Global fuse app: dense cell count " << denseCellCount << " is too large, use sparse fusion" << std::endl;
+                sparsePointCloud = new SparseFusePointCloud(density, hasNormalInfo);
+                // Blend colors like the dense SumPointCloud, color ids and point ids are index fields
+                sparsePointCloud->SetBlend(25, 2, 3);
+            }
+            else
+            {
+                mpSumPointCloud = new GPP::SumPointCloud(density, bboxMin, bboxMax, hasNormalInfo, 25, 2);
+            }
 
             int pointCloudCount = mPointCloudList.size();
             bool hasColorInfo = false;
-            for (int cid = 0; cid < pointCloudCount; cid++)
+            if (mpFusePipeline == NULL)
             {
-                mGlobalRegistrateProgress = double(cid) / double(pointCloudCount);
-                GPP::PointCloud* pointCloudFrom = mPointCloudList.at(cid);
-                GPP::Int pointCountFrom = pointCloudFrom->GetPointCount();
- 
-                if (pointCloudFrom->HasColor())
-                {
-                    hasColorInfo = true;
-                    int fieldDim = 5;
-                    std::vector<GPP::Real> pointColorFieldsFrom(pointCountFrom * fieldDim, 0);
-                    for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
-                    {
-                        GPP::Vector3 color = pointCloudFrom->GetPointColor(pid);
-                        GPP::Int baseId = pid * fieldDim;
-                        pointColorFieldsFrom.at(baseId) = color[0];
-                        pointColorFieldsFrom.at(baseId + 1) = color[1];
-                        pointColorFieldsFrom.at(baseId + 2) = color[2];
-                    }
-                    if (mColorList.size() == pointCloudCount)
-                    {
-                        for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
-                        {
-                            pointColorFieldsFrom.at(pid * fieldDim + 3) = mColorList.at(cid).at(pid);
-                        }
-                    }
-                    for (GPP::Int pid = 0; pid < pointCountFrom; pid++)
-                    {
-                        pointColorFieldsFrom.at(pid * fieldDim + 4) = pid;
-                    }
-                    res = mpSumPointCloud->UpdateSumFunction(pointCloudFrom, NULL, &pointColorFieldsFrom);
-                    if (res == GPP_API_IS_NOT_AVAILABLE)
-                    {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                        MagicCore::ToolKit::Get()->SetAppRunning(false);
-                    }
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
-                        mGlobalRegistrateProgress = -1;
-                        mIsCommandInProgress = false;
-                        return;
-                    }
-                }
-                else
-                {
-                    res = mpSumPointCloud->UpdateSumFunction(pointCloudFrom, NULL, NULL);
-                    if (res == GPP_API_IS_NOT_AVAILABLE)
-                    {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                        MagicCore::ToolKit::Get()->SetAppRunning(false);
-                    }
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "ںʧ", "ܰʾ", MB_OK);
-                        mGlobalRegistrateProgress = -1;
-                        mIsCommandInProgress = false;
-                        return;
-                    }
-                }
+                mpFusePipeline = new FusePipeline;
+            }
+            if (sparsePointCloud)
+            {
+                res = mpFusePipeline->Run(sparsePointCloud, mPointCloudList, &mColorList, &hasColorInfo);
+            }
+            else
+            {
+                res = mpFusePipeline->Run(mpSumPointCloud, mPointCloudList, &mColorList, &hasColorInfo);
+            }
+            if (res == GPP_API_IS_NOT_AVAILABLE)
+            {
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
+            }
+            if (res != GPP_NO_ERROR)
+            {
+                GPPFREEPOINTER(sparsePointCloud);
+                MessageBox(NULL, "点云融合失败", "温馨提示", MB_OK);
+                mGlobalRegistrateProgress = -1;
+                mIsCommandInProgress = false;
+                return;
+            }
+            if (mpFusePipeline->IsCancelled())
+            {
+                GPPFREEPOINTER(sparsePointCloud);
+                GPPFREEPOINTER(mpSumPointCloud);
+                mGlobalRegistrateProgress = -1;
+                mIsCommandInProgress = false;
+                return;
             }
             mCloudIds.clear();
             mColorIds.clear();
@@ -1708,59 +1796,40 @@ namespace MagicApp
             {
                 GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
                 std::vector<GPP::Real> pointColorFieldsFused;
-                res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, &pointColorFieldsFused, &mCloudIds);
+                res = ExtractGlobalFusePointCloud(sparsePointCloud, extractPointCloud, &pointColorFieldsFused);
+                GPPFREEPOINTER(sparsePointCloud);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
                     GPPFREEPOINTER(extractPointCloud);
-                    MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云抽取失败", "温馨提示", MB_OK);
                     mGlobalRegistrateProgress = -1;
                     mIsCommandInProgress = false;
                     return;
                 }
-                int fieldDim = 5;
-                extractPointCloud->SetHasColor(true);
-                GPP::Int pointCountFused = extractPointCloud->GetPointCount();
-                for (GPP::Int pid = 0; pid < pointCountFused; pid++)
-                {
-                    GPP::Int baseIndex = pid * fieldDim;
-                    extractPointCloud->SetPointColor(pid, GPP::Vector3(pointColorFieldsFused.at(baseIndex), 
-                        pointColorFieldsFused.at(baseIndex + 1), pointColorFieldsFused.at(baseIndex + 2)));
-                }
-                if (mColorList.size() == pointCloudCount)
-                {
-                    mColorIds.clear();
-                    mColorIds.resize(pointCountFused);
-                    for (int pid = 0; pid < pointCountFused; pid++)
-                    {
-                        mColorIds.at(pid) = int(pointColorFieldsFused.at(pid * fieldDim + 3));
-                    }
-                }
-                pointIds.resize(pointCountFused);
-                for (int pid = 0; pid < pointCountFused; pid++)
-                {
-                    pointIds.at(pid) = int(pointColorFieldsFused.at(pid * fieldDim + 4));
-                }
+                FusePipeline::UnpackFields(pointColorFieldsFused, extractPointCloud, 
+                    mColorList.size() == pointCloudCount ? &mColorIds : NULL, &pointIds);
                 GPPFREEPOINTER(mpPointCloudRef);
                 mpPointCloudRef = extractPointCloud;
             }
             else
             {
                 GPP::PointCloud* extractPointCloud = new GPP::PointCloud;
-                res = mpSumPointCloud->ExtractPointCloud(extractPointCloud, NULL, &mCloudIds);
+                res = ExtractGlobalFusePointCloud(sparsePointCloud, extractPointCloud, NULL);
+                GPPFREEPOINTER(sparsePointCloud);
                 if (res == GPP_API_IS_NOT_AVAILABLE)
                 {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                     MagicCore::ToolKit::Get()->SetAppRunning(false);
                 }
                 if (res != GPP_NO_ERROR)
                 {
                     GPPFREEPOINTER(extractPointCloud);
-                    MessageBox(NULL, "Ƴȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "点云抽取失败", "温馨提示", MB_OK);
                     mGlobalRegistrateProgress = -1;
                     mIsCommandInProgress = false;
                     return;
@@ -1788,6 +1857,27 @@ namespace MagicApp
         }
     }
 
+    GPP::ErrorCode RegistrationApp::ExtractGlobalFusePointCloud(SparseFusePointCloud* sparsePointCloud, GPP::PointCloud* extractPointCloud,
+        std::vector<GPP::Real>* pointFields)
+    {
+        if (sparsePointCloud == NULL)
+        {
+            return mpSumPointCloud->ExtractPointCloud(extractPointCloud, pointFields, &mCloudIds);
+        }
+        // Blocks are released once they are extracted, so the fused volume and the result do not peak together
+        SparseExtractListener listener(extractPointCloud, pointFields, &mCloudIds);
+        return sparsePointCloud->ExtractPointCloud(&listener, gSparseExtractBatchSize, true);
+    }
+
+    void RegistrationApp::CancelGlobalFuse()
+    {
+        if (mIsCommandInProgress && mCommandType == GLOBAL_FUSE && mpFusePipeline)
+        {
+            InfoLog << "Cancel global fuse" << std::endl;
+            mpFusePipeline->Cancel();
+        }
+    }
+
     bool RegistrationApp::ImportPointCloudFrom()
     {
         if (IsCommandAvaliable() == false)
@@ -1796,7 +1886,7 @@ namespace MagicApp
         }
         if (mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return false;
         }
         std::string fileName;
@@ -1837,7 +1927,7 @@ namespace MagicApp
             }
             else
             {
-                MessageBox(NULL, "Ƶʧ, Ŀǰֵ֧ʽascobj", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云导入失败, 目前支持导入格式：asc，obj", "温馨提示", MB_OK);
             }
         }
         return false;
@@ -1851,7 +1941,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1872,12 +1962,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "Ʒ߼ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云法线计算失败", "温馨提示", MB_OK);
                 return;
             }
             mUpdatePointFromRendering = true;
@@ -1892,12 +1982,12 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         GPP::Int pointCount = mpPointCloudFrom->GetPointCount();
@@ -1916,13 +2006,13 @@ namespace MagicApp
         }
         else if (mpPointCloudFrom->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给点云计算法向量", "温馨提示", MB_OK);
             return;
         }
         mReversePatchNormalFrom = !mReversePatchNormalFrom;
         if (mReversePatchNormalFrom)
         {
-            MessageBox(NULL, "ҼƷ޸ģʽƷת߷ٴεťʰȡģʽ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "鼠标右键进入点云法线修复模式，点击点云反转法线方向，再次点击本按钮返回拾取模式", "温馨提示", MB_OK);
         }
     }
 
@@ -1934,7 +2024,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL)
         {
-            MessageBox(NULL, "ȵο", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1950,13 +2040,13 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::ConsolidatePointCloud::CalculateOutlier(mpPointCloudFrom, &uniformity);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
                 mIsCommandInProgress = false;
-                MessageBox(NULL, "ȥɵʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云去除飞点失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::Real cutValue = 0.8;
@@ -2045,7 +2135,7 @@ namespace MagicApp
         {
             return;
         }
-        MessageBox(NULL, "ƱǵʽΪ\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "ܰʾ", MB_OK);
+        MessageBox(NULL, "点云标记点格式为：\nMark0_X Mark0_Y Mark0_Z\nMark1_X Mark1_Y Mark1_Z\n... ... ...", "温馨提示", MB_OK);
         std::string fileName;
         char filterName[] = "Ref Files(*.ref)\0*.ref\0";
         if (MagicCore::ToolKit::FileOpenDlg(fileName, filterName))
@@ -2078,17 +2168,17 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false || mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸοƺҪĵƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给参考点云和需要对齐的点云计算法线", "温馨提示", MB_OK);
             return;
         }
         if (mRefMarks.size() < 3 || mFromMarks.size() < 3)
         {
-            MessageBox(NULL, "ǵƴҪ3ϵıǵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "带标记的拼接需要3个及以上的标记点", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2117,12 +2207,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ٶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "快速对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2153,12 +2243,12 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         else if (mpPointCloudFrom->HasNormal() == false || mpPointCloudRef->HasNormal() == false)
         {
-            MessageBox(NULL, "ȸοƺҪĵƼ㷨", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给参考点云和需要对齐的点云计算法线", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2179,12 +2269,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ޱǶʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "无标记对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2215,7 +2305,7 @@ namespace MagicApp
         }
         if (mpPointCloudFrom == NULL || mpPointCloudRef == NULL)
         {
-            MessageBox(NULL, "ȵοƺҪĵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入参考点云和需要对齐的点云", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -2227,7 +2317,7 @@ namespace MagicApp
         {
             if (mRefMarks.size() > 0 || mFromMarks.size() > 0)
             {
-                if (MessageBox(NULL, "Ҫɾбǵ", "ܰʾ", MB_YESNO) == IDYES)
+                if (MessageBox(NULL, "需要删除所有标记点吗", "温馨提示", MB_YESNO) == IDYES)
                 {
                     mRefMarks.clear();
                     mFromMarks.clear();
@@ -2260,12 +2350,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ICPʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ICP对齐失败", "温馨提示", MB_OK);
                 return;
             }
             //Update mpPointCloudFrom
@@ -2298,7 +2388,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -2395,10 +2485,10 @@ namespace MagicApp
         {
             if (mPointCloudList.size() < 2)
             {
-                MessageBox(NULL, "Ƹ2", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云个数少于2", "温馨提示", MB_OK);
                 return;
             }
-            if (MessageBox(NULL, "ԴɫǷ", "ܰʾ", MB_OKCANCEL) != IDOK)
+            if (MessageBox(NULL, "单光源点云颜色修正，是否继续", "温馨提示", MB_OKCANCEL) != IDOK)
             {
                 return;
             }
@@ -2413,14 +2503,9 @@ namespace MagicApp
             for (int cloudId = 0; cloudId < cloudCount; cloudId++)
             {
                 GPP::PointCloud* curPointCloud = mPointCloudList.at(cloudId);
-                int pointCount = curPointCloud->GetPointCount();
-                std::vector<GPP::Vector3> curColors;
-                curColors.reserve(pointCount);
-                for (int pid = 0; pid < pointCount; pid++)
-                {
-                    curColors.push_back(curPointCloud->GetPointColor(pid));
-                }
-                colorList.at(cloudId) = curColors;
+                colorList.at(cloudId).resize(curPointCloud->GetPointCount());
+                PointColorCopyTask copyTask(curPointCloud, &(colorList.at(cloudId)), false);
+                MagicCore::ThreadPool::Get()->ParallelFor(curPointCloud->GetPointCount(), &copyTask, 4096);
             }
             GPP::PointCloudPointList pointList(pointCloudList.at(0));
             double density = 0;
@@ -2445,18 +2530,15 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "点云颜色矫正失败", "温馨提示", MB_OK);
                 mColorList.clear();
                 return;
             }
             for (int cloudId = 0; cloudId < cloudCount; cloudId++)
             {
                 GPP::PointCloud* curPointCloud = mPointCloudList.at(cloudId);
-                int pointCount = curPointCloud->GetPointCount();
-                for (int pid = 0; pid < pointCount; pid++)
-                {
-                    curPointCloud->SetPointColor(pid, colorList.at(cloudId).at(pid));
-                }
+                PointColorCopyTask copyTask(curPointCloud, &(colorList.at(cloudId)), true);
+                MagicCore::ThreadPool::Get()->ParallelFor(curPointCloud->GetPointCount(), &copyTask, 4096);
             }
             mUpdatePointCloudListRendering = true;
         }
@@ -2470,7 +2552,7 @@ namespace MagicApp
         }
         if (mPointCloudList.empty())
         {
-            MessageBox(NULL, "Ϊ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点云序列为空", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> fileNames;
@@ -2544,18 +2626,18 @@ namespace MagicApp
     {
         if (mpDumpInfo == NULL)
         {
-            MessageBox(NULL, "ȵdumpļ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入dump文件", "温馨提示", MB_OK);
             return;
         }
         GPP::ErrorCode res = mpDumpInfo->Run();
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "dumpִʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump执行失败", "温馨提示", MB_OK);
             return;
         }
         else
         {
-            MessageBox(NULL, "dumpļִгɹ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "dump文件执行成功", "温馨提示", MB_OK);
         }
 
         ResetGlobalRegistrationData();
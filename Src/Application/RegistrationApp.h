@@ -15,6 +15,8 @@ namespace MagicCore
 namespace MagicApp
 {
     class RegistrationAppUI;
+    class FusePipeline;
+    class SparseFusePointCloud;
     class RegistrationApp : public AppBase
     {
         enum CommandType
@@ -84,6 +86,7 @@ namespace MagicApp
         void ImportImageInfo(void);
 
         void FusePointCloudColor(double intervalCount, bool needBlend, bool isSubThread = true);
+        void CancelGlobalFuse(void);
 
 #if DEBUGDUMPFILE
         void SetDumpInfo(GPP::DumpBase* dumpInfo);
@@ -112,6 +115,8 @@ namespace MagicApp
         void ResetGlobalRegistrationData(void);
         void ClearPairwiseRegistrationData(void);
         void ClearAuxiliaryData(void);
+        GPP::ErrorCode ExtractGlobalFusePointCloud(SparseFusePointCloud* sparsePointCloud, GPP::PointCloud* extractPointCloud,
+            std::vector<GPP::Real>* pointFields);
 
     private:
         RegistrationAppUI* mpUI;
@@ -125,6 +130,7 @@ namespace MagicApp
         GPP::PointCloud* mpPointCloudRef;
         GPP::PointCloud* mpPointCloudFrom;
         GPP::SumPointCloud* mpSumPointCloud;
+        FusePipeline* mpFusePipeline;
         GPP::Vector3 mObjCenterCoord;
         GPP::Real mScaleValue;
         std::vector<GPP::Vector3> mRefMarks;
@@ -0,0 +1,858 @@
+#include "SparseFusePointCloud.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/LogSystem.h"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+namespace MagicApp
+{
+    static const int gStripeCount = 64;
+    static const GPP::LongInt gBlockCoordOffset = 1 << 20;
+    static const GPP::LongInt gBlockCoordMask = (1 << 21) - 1;
+
+    struct SparseFuseBlock
+    {
+        GPP::LongInt blockKey;
+        std::vector<float> weights;
+        std::vector<float> representDistances;
+        std::vector<GPP::Int> cloudIds;
+        std::vector<GPP::Real> coordSums;
+        std::vector<GPP::Real> normalSums;
+        std::vector<GPP::Real> fields;
+        // Blended fields of an iteration, they are only allocated while blending
+        std::vector<GPP::Real> blendFields;
+    };
+
+    static SparseFuseBlock* CreateFuseBlock(GPP::LongInt blockKey, GPP::Int blockResolution, bool hasNormal, GPP::Int fieldDim)
+    {
+        int voxelCount = blockResolution * blockResolution * blockResolution;
+        SparseFuseBlock* block = new SparseFuseBlock;
+        block->blockKey = blockKey;
+        block->weights.resize(voxelCount, 0);
+        block->representDistances.resize(voxelCount, FLT_MAX);
+        block->cloudIds.resize(voxelCount, -1);
+        block->coordSums.resize(voxelCount * 3, 0);
+        if (hasNormal)
+        {
+            block->normalSums.resize(voxelCount * 3, 0);
+        }
+        if (fieldDim > 0)
+        {
+            block->fields.resize(voxelCount * fieldDim, 0);
+        }
+        return block;
+    }
+
+    static inline GPP::LongInt FloorDivide(GPP::LongInt value, GPP::LongInt divisor)
+    {
+        return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+    }
+
+    static inline int StripeIndex(GPP::LongInt blockKey)
+    {
+        return int(((GPP::ULongInt)blockKey * 0x9E3779B97F4A7C15ULL) >> 58) % gStripeCount;
+    }
+
+    static inline GPP::LongInt PackBlockKey(const GPP::LongInt blockCoord[3])
+    {
+        GPP::LongInt blockKey = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            blockKey = (blockKey << 21) | (blockCoord[axis] + gBlockCoordOffset);
+        }
+        return blockKey;
+    }
+
+    static inline void UnpackBlockKey(GPP::LongInt blockKey, GPP::LongInt blockCoord[3])
+    {
+        blockCoord[0] = ((blockKey >> 42) & gBlockCoordMask) - gBlockCoordOffset;
+        blockCoord[1] = ((blockKey >> 21) & gBlockCoordMask) - gBlockCoordOffset;
+        blockCoord[2] = (blockKey & gBlockCoordMask) - gBlockCoordOffset;
+    }
+
+    // Transform points and compute their block key and voxel index in the block
+    class PointVoxelTask : public MagicCore::ParallelTask
+    {
+    public:
+        PointVoxelTask(const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform, bool hasNormal, GPP::Real interval,
+            GPP::Int blockResolution, std::vector<GPP::Vector3>* coords, std::vector<GPP::Vector3>* normals,
+            std::vector<GPP::LongInt>* blockKeys, std::vector<int>* voxelIds) :
+            mpPointCloud(pointCloud),
+            mpTransform(transform),
+            mHasNormal(hasNormal),
+            mInterval(interval),
+            mBlockResolution(blockResolution),
+            mpCoords(coords),
+            mpNormals(normals),
+            mpBlockKeys(blockKeys),
+            mpVoxelIds(voxelIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::LongInt resolution = mBlockResolution;
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(pid);
+                if (mpTransform)
+                {
+                    coord = mpTransform->TransformPoint(coord);
+                }
+                (*mpCoords)[pid] = coord;
+                if (mHasNormal)
+                {
+                    GPP::Vector3 normal = mpPointCloud->GetPointNormal(pid);
+                    if (mpTransform)
+                    {
+                        normal = mpTransform->RotateVector(normal);
+                    }
+                    (*mpNormals)[pid] = normal;
+                }
+                GPP::LongInt blockKey = 0;
+                int voxelId = 0;
+                int voxelStride = 1;
+                bool isValid = true;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    GPP::LongInt voxelCoord = (GPP::LongInt)floor(coord[axis] / mInterval);
+                    GPP::LongInt blockCoord = FloorDivide(voxelCoord, resolution);
+                    if (blockCoord <= -gBlockCoordOffset || blockCoord >= gBlockCoordOffset)
+                    {
+                        isValid = false;
+                        break;
+                    }
+                    blockKey = (blockKey << 21) | (blockCoord + gBlockCoordOffset);
+                    voxelId += int(voxelCoord - blockCoord * resolution) * voxelStride;
+                    voxelStride *= mBlockResolution;
+                }
+                (*mpBlockKeys)[pid] = isValid ? blockKey : -1;
+                (*mpVoxelIds)[pid] = voxelId;
+            }
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        const GPP::Matrix4x4* mpTransform;
+        bool mHasNormal;
+        GPP::Real mInterval;
+        GPP::Int mBlockResolution;
+        std::vector<GPP::Vector3>* mpCoords;
+        std::vector<GPP::Vector3>* mpNormals;
+        std::vector<GPP::LongInt>* mpBlockKeys;
+        std::vector<int>* mpVoxelIds;
+    };
+
+    // Every stripe owns its blocks, so stripes are accumulated in parallel without lock
+    class StripeAccumulateTask : public MagicCore::ParallelTask
+    {
+    public:
+        StripeAccumulateTask() :
+            mpStripes(NULL),
+            mpStripeOffsets(NULL),
+            mpSortedIds(NULL),
+            mpCoords(NULL),
+            mpNormals(NULL),
+            mpBlockKeys(NULL),
+            mpVoxelIds(NULL),
+            mpPointFields(NULL),
+            mFieldDim(0),
+            mCloudId(0),
+            mHasNormal(false),
+            mInterval(1),
+            mBlockResolution(1)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int stripeId = startId; stripeId < endId; stripeId++)
+            {
+                std::unordered_map<GPP::LongInt, SparseFuseBlock*>& blockMap = (*mpStripes)[stripeId];
+                SparseFuseBlock* block = NULL;
+                for (int sortId = (*mpStripeOffsets)[stripeId]; sortId < (*mpStripeOffsets)[stripeId + 1]; sortId++)
+                {
+                    int pid = (*mpSortedIds)[sortId];
+                    GPP::LongInt blockKey = (*mpBlockKeys)[pid];
+                    if (block == NULL || block->blockKey != blockKey)
+                    {
+                        std::unordered_map<GPP::LongInt, SparseFuseBlock*>::iterator itr = blockMap.find(blockKey);
+                        if (itr == blockMap.end())
+                        {
+                            block = CreateFuseBlock(blockKey, mBlockResolution, mHasNormal, mFieldDim);
+                            blockMap[blockKey] = block;
+                        }
+                        else
+                        {
+                            block = itr->second;
+                        }
+                    }
+                    int voxelId = (*mpVoxelIds)[pid];
+                    const GPP::Vector3& coord = (*mpCoords)[pid];
+                    block->weights[voxelId] += 1.0f;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        block->coordSums[voxelId * 3 + axis] += coord[axis];
+                    }
+                    if (!block->normalSums.empty())
+                    {
+                        const GPP::Vector3& normal = (*mpNormals)[pid];
+                        for (int axis = 0; axis < 3; axis++)
+                        {
+                            block->normalSums[voxelId * 3 + axis] += normal[axis];
+                        }
+                    }
+                    float representDistance = float(VoxelCenter(blockKey, voxelId).DistanceSquared(coord));
+                    if (representDistance < block->representDistances[voxelId])
+                    {
+                        block->representDistances[voxelId] = representDistance;
+                        block->cloudIds[voxelId] = mCloudId;
+                        if (mFieldDim > 0)
+                        {
+                            GPP::Real* voxelFields = &(block->fields[voxelId * mFieldDim]);
+                            for (int fid = 0; fid < mFieldDim; fid++)
+                            {
+                                voxelFields[fid] = mpPointFields ? (*mpPointFields)[pid * mFieldDim + fid] : 0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        GPP::Vector3 VoxelCenter(GPP::LongInt blockKey, int voxelId) const
+        {
+            GPP::LongInt blockCoord[3];
+            UnpackBlockKey(blockKey, blockCoord);
+            GPP::Vector3 center;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int localCoord = voxelId % mBlockResolution;
+                voxelId /= mBlockResolution;
+                center[axis] = (GPP::Real(blockCoord[axis] * mBlockResolution + localCoord) + 0.5) * mInterval;
+            }
+            return center;
+        }
+
+        std::vector<std::unordered_map<GPP::LongInt, SparseFuseBlock*> >* mpStripes;
+        const std::vector<int>* mpStripeOffsets;
+        const std::vector<int>* mpSortedIds;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<GPP::Vector3>* mpNormals;
+        const std::vector<GPP::LongInt>* mpBlockKeys;
+        const std::vector<int>* mpVoxelIds;
+        const std::vector<GPP::Real>* mpPointFields;
+        GPP::Int mFieldDim;
+        GPP::Int mCloudId;
+        bool mHasNormal;
+        GPP::Real mInterval;
+        GPP::Int mBlockResolution;
+    };
+
+    // Blend fields of a voxel with its neighbor voxels if any of them is represented by another cloud,
+    // so seams between overlapped clouds are smoothed and fields inside a single cloud are kept
+    class FieldBlendTask : public MagicCore::ParallelTask
+    {
+    public:
+        FieldBlendTask(const std::vector<std::unordered_map<GPP::LongInt, SparseFuseBlock*> >* stripes,
+            const std::vector<SparseFuseBlock*>* blocks, GPP::Int blockResolution, GPP::Int fieldDim, GPP::Int blendFieldDim,
+            int blendRadius) :
+            mpStripes(stripes),
+            mpBlocks(blocks),
+            mBlockResolution(blockResolution),
+            mFieldDim(fieldDim),
+            mBlendFieldDim(blendFieldDim),
+            mBlendRadius(blendRadius)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::LongInt resolution = mBlockResolution;
+            std::vector<GPP::Real> fieldSums(mBlendFieldDim);
+            for (int bid = startId; bid < endId; bid++)
+            {
+                SparseFuseBlock* block = (*mpBlocks)[bid];
+                GPP::LongInt blockCoord[3];
+                UnpackBlockKey(block->blockKey, blockCoord);
+                int voxelCount = block->weights.size();
+                block->blendFields.resize(voxelCount * mBlendFieldDim);
+                const SparseFuseBlock* cachedBlock = block;
+                for (int voxelId = 0; voxelId < voxelCount; voxelId++)
+                {
+                    GPP::Real* blendFields = &(block->blendFields[voxelId * mBlendFieldDim]);
+                    const GPP::Real* voxelFields = &(block->fields[voxelId * mFieldDim]);
+                    for (int fid = 0; fid < mBlendFieldDim; fid++)
+                    {
+                        blendFields[fid] = voxelFields[fid];
+                    }
+                    if (block->weights[voxelId] <= 0)
+                    {
+                        continue;
+                    }
+                    GPP::LongInt voxelCoord[3];
+                    int localId = voxelId;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        voxelCoord[axis] = blockCoord[axis] * resolution + localId % mBlockResolution;
+                        localId /= mBlockResolution;
+                    }
+                    GPP::Int cloudId = block->cloudIds[voxelId];
+                    bool isOverlap = false;
+                    GPP::Real weightSum = 0;
+                    std::fill(fieldSums.begin(), fieldSums.end(), 0);
+                    for (int offsetZ = -mBlendRadius; offsetZ <= mBlendRadius; offsetZ++)
+                    {
+                        for (int offsetY = -mBlendRadius; offsetY <= mBlendRadius; offsetY++)
+                        {
+                            for (int offsetX = -mBlendRadius; offsetX <= mBlendRadius; offsetX++)
+                            {
+                                GPP::LongInt neighborCoord[3] = {voxelCoord[0] + offsetX, voxelCoord[1] + offsetY, voxelCoord[2] + offsetZ};
+                                GPP::LongInt neighborBlockCoord[3];
+                                int neighborVoxelId = 0;
+                                int voxelStride = 1;
+                                for (int axis = 0; axis < 3; axis++)
+                                {
+                                    neighborBlockCoord[axis] = FloorDivide(neighborCoord[axis], resolution);
+                                    neighborVoxelId += int(neighborCoord[axis] - neighborBlockCoord[axis] * resolution) * voxelStride;
+                                    voxelStride *= mBlockResolution;
+                                }
+                                GPP::LongInt neighborKey = PackBlockKey(neighborBlockCoord);
+                                if (cachedBlock == NULL || cachedBlock->blockKey != neighborKey)
+                                {
+                                    cachedBlock = FindBlock(neighborKey);
+                                    if (cachedBlock == NULL)
+                                    {
+                                        continue;
+                                    }
+                                }
+                                float weight = cachedBlock->weights[neighborVoxelId];
+                                if (weight <= 0)
+                                {
+                                    continue;
+                                }
+                                if (cachedBlock->cloudIds[neighborVoxelId] != cloudId)
+                                {
+                                    isOverlap = true;
+                                }
+                                const GPP::Real* neighborFields = &(cachedBlock->fields[neighborVoxelId * mFieldDim]);
+                                for (int fid = 0; fid < mBlendFieldDim; fid++)
+                                {
+                                    fieldSums[fid] += neighborFields[fid] * weight;
+                                }
+                                weightSum += weight;
+                            }
+                        }
+                    }
+                    if (isOverlap && weightSum > 0)
+                    {
+                        for (int fid = 0; fid < mBlendFieldDim; fid++)
+                        {
+                            blendFields[fid] = fieldSums[fid] / weightSum;
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        const SparseFuseBlock* FindBlock(GPP::LongInt blockKey) const
+        {
+            const std::unordered_map<GPP::LongInt, SparseFuseBlock*>& blockMap = (*mpStripes)[StripeIndex(blockKey)];
+            std::unordered_map<GPP::LongInt, SparseFuseBlock*>::const_iterator itr = blockMap.find(blockKey);
+            return itr == blockMap.end() ? NULL : itr->second;
+        }
+
+    private:
+        const std::vector<std::unordered_map<GPP::LongInt, SparseFuseBlock*> >* mpStripes;
+        const std::vector<SparseFuseBlock*>* mpBlocks;
+        GPP::Int mBlockResolution;
+        GPP::Int mFieldDim;
+        GPP::Int mBlendFieldDim;
+        int mBlendRadius;
+    };
+
+    class FieldBlendApplyTask : public MagicCore::ParallelTask
+    {
+    public:
+        FieldBlendApplyTask(const std::vector<SparseFuseBlock*>* blocks, GPP::Int fieldDim, GPP::Int blendFieldDim, bool isLastIteration) :
+            mpBlocks(blocks),
+            mFieldDim(fieldDim),
+            mBlendFieldDim(blendFieldDim),
+            mIsLastIteration(isLastIteration)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int bid = startId; bid < endId; bid++)
+            {
+                SparseFuseBlock* block = (*mpBlocks)[bid];
+                int voxelCount = block->weights.size();
+                for (int voxelId = 0; voxelId < voxelCount; voxelId++)
+                {
+                    for (int fid = 0; fid < mBlendFieldDim; fid++)
+                    {
+                        block->fields[voxelId * mFieldDim + fid] = block->blendFields[voxelId * mBlendFieldDim + fid];
+                    }
+                }
+                if (mIsLastIteration)
+                {
+                    std::vector<GPP::Real>().swap(block->blendFields);
+                }
+            }
+        }
+
+    private:
+        const std::vector<SparseFuseBlock*>* mpBlocks;
+        GPP::Int mFieldDim;
+        GPP::Int mBlendFieldDim;
+        bool mIsLastIteration;
+    };
+
+    class BlockCountTask : public MagicCore::ParallelTask
+    {
+    public:
+        BlockCountTask(const std::vector<SparseFuseBlock*>* blocks, std::vector<int>* counts) :
+            mpBlocks(blocks),
+            mpCounts(counts)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int bid = startId; bid < endId; bid++)
+            {
+                const std::vector<float>& weights = (*mpBlocks)[bid]->weights;
+                int count = 0;
+                for (std::vector<float>::const_iterator itr = weights.begin(); itr != weights.end(); ++itr)
+                {
+                    if (*itr > 0)
+                    {
+                        count++;
+                    }
+                }
+                (*mpCounts)[bid] = count;
+            }
+        }
+
+    private:
+        const std::vector<SparseFuseBlock*>* mpBlocks;
+        std::vector<int>* mpCounts;
+    };
+
+    class BlockExtractTask : public MagicCore::ParallelTask
+    {
+    public:
+        BlockExtractTask(const std::vector<SparseFuseBlock*>* blocks, const std::vector<int>* offsets, int baseBlockId,
+            GPP::Int fieldDim, std::vector<GPP::Vector3>* coords, std::vector<GPP::Vector3>* normals,
+            std::vector<GPP::Real>* fields, std::vector<GPP::Int>* cloudIds) :
+            mpBlocks(blocks),
+            mpOffsets(offsets),
+            mBaseBlockId(baseBlockId),
+            mFieldDim(fieldDim),
+            mpCoords(coords),
+            mpNormals(normals),
+            mpFields(fields),
+            mpCloudIds(cloudIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int bid = startId + mBaseBlockId; bid < endId + mBaseBlockId; bid++)
+            {
+                const SparseFuseBlock* block = (*mpBlocks)[bid];
+                int pointId = (*mpOffsets)[bid] - (*mpOffsets)[mBaseBlockId];
+                int voxelCount = block->weights.size();
+                for (int voxelId = 0; voxelId < voxelCount; voxelId++)
+                {
+                    float weight = block->weights[voxelId];
+                    if (weight <= 0)
+                    {
+                        continue;
+                    }
+                    const GPP::Real* coordSum = &(block->coordSums[voxelId * 3]);
+                    (*mpCoords)[pointId] = GPP::Vector3(coordSum[0], coordSum[1], coordSum[2]) / weight;
+                    if (mpNormals && !block->normalSums.empty())
+                    {
+                        const GPP::Real* normalSum = &(block->normalSums[voxelId * 3]);
+                        GPP::Vector3 normal(normalSum[0], normalSum[1], normalSum[2]);
+                        normal.Normalise();
+                        (*mpNormals)[pointId] = normal;
+                    }
+                    if (mpFields && mFieldDim > 0)
+                    {
+                        for (int fid = 0; fid < mFieldDim; fid++)
+                        {
+                            (*mpFields)[pointId * mFieldDim + fid] = block->fields[voxelId * mFieldDim + fid];
+                        }
+                    }
+                    if (mpCloudIds)
+                    {
+                        (*mpCloudIds)[pointId] = block->cloudIds[voxelId];
+                    }
+                    pointId++;
+                }
+            }
+        }
+
+    private:
+        const std::vector<SparseFuseBlock*>* mpBlocks;
+        const std::vector<int>* mpOffsets;
+        int mBaseBlockId;
+        GPP::Int mFieldDim;
+        std::vector<GPP::Vector3>* mpCoords;
+        std::vector<GPP::Vector3>* mpNormals;
+        std::vector<GPP::Real>* mpFields;
+        std::vector<GPP::Int>* mpCloudIds;
+    };
+
+    SparseFuseListener::SparseFuseListener()
+    {
+    }
+
+    SparseFuseListener::~SparseFuseListener()
+    {
+    }
+
+    SparseFusePointCloud::SparseFusePointCloud() :
+        mStripes(gStripeCount),
+        mInterval(1),
+        mBlockResolution(8),
+        mHasNormalInfo(false),
+        mFieldDim(0),
+        mCloudId(0),
+        mBlendNeighborCount(0),
+        mBlendIterationCount(0),
+        mBlendFieldDim(0)
+    {
+    }
+
+    SparseFusePointCloud::SparseFusePointCloud(GPP::Real interval, bool hasNormalInfo, GPP::Int blockResolution) :
+        mStripes(gStripeCount),
+        mInterval(1),
+        mBlockResolution(8),
+        mHasNormalInfo(false),
+        mFieldDim(0),
+        mCloudId(0),
+        mBlendNeighborCount(0),
+        mBlendIterationCount(0),
+        mBlendFieldDim(0)
+    {
+        Init(interval, hasNormalInfo, blockResolution);
+    }
+
+    SparseFusePointCloud::~SparseFusePointCloud()
+    {
+        Clear();
+    }
+
+    void SparseFusePointCloud::Init(GPP::Real interval, bool hasNormalInfo, GPP::Int blockResolution)
+    {
+        Clear();
+        mInterval = interval > GPP::REAL_TOL ? interval : GPP::REAL_TOL;
+        mHasNormalInfo = hasNormalInfo;
+        mBlockResolution = blockResolution < 1 ? 1 : blockResolution;
+    }
+
+    void SparseFusePointCloud::SetBlend(GPP::Int blendNeighborCount, GPP::Int blendIterationCount, GPP::Int blendFieldDim)
+    {
+        mBlendNeighborCount = blendNeighborCount;
+        mBlendIterationCount = blendIterationCount;
+        mBlendFieldDim = blendFieldDim;
+    }
+
+    GPP::ErrorCode SparseFusePointCloud::UpdateFuseFunction(const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform,
+        const std::vector<GPP::Real>* pointFields)
+    {
+        if (pointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        if (pointCount == 0)
+        {
+            mCloudId++;
+            return GPP_NO_ERROR;
+        }
+        if (mHasNormalInfo && pointCloud->HasNormal() == false)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (pointFields)
+        {
+            if (pointFields->size() % pointCount != 0)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            GPP::Int fieldDim = pointFields->size() / pointCount;
+            if (mFieldDim == 0 && GetBlockCount() == 0)
+            {
+                mFieldDim = fieldDim;
+            }
+            else if (mFieldDim != fieldDim)
+            {
+                return GPP_INVALID_INPUT;
+            }
+        }
+
+        std::vector<GPP::Vector3> coords(pointCount);
+        std::vector<GPP::Vector3> normals(mHasNormalInfo ? pointCount : 0);
+        std::vector<GPP::LongInt> blockKeys(pointCount);
+        std::vector<int> voxelIds(pointCount);
+        PointVoxelTask voxelTask(pointCloud, transform, mHasNormalInfo, mInterval, mBlockResolution, &coords, &normals, &blockKeys, &voxelIds);
+        MagicCore::ThreadPool::Get()->ParallelFor(pointCount, &voxelTask, 4096);
+
+        // Counting sort points by stripe, points of the same block are consecutive in a stripe mostly
+        std::vector<int> stripeOffsets(gStripeCount + 1, 0);
+        std::vector<int> stripeIds(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            if (blockKeys[pid] < 0)
+            {
+                stripeIds[pid] = -1;
+                continue;
+            }
+            stripeIds[pid] = StripeIndex(blockKeys[pid]);
+            stripeOffsets[stripeIds[pid] + 1]++;
+        }
+        for (int stripeId = 0; stripeId < gStripeCount; stripeId++)
+        {
+            stripeOffsets[stripeId + 1] += stripeOffsets[stripeId];
+        }
+        std::vector<int> sortedIds(stripeOffsets[gStripeCount]);
+        std::vector<int> fillOffsets(stripeOffsets.begin(), stripeOffsets.end() - 1);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            if (stripeIds[pid] >= 0)
+            {
+                sortedIds[fillOffsets[stripeIds[pid]]++] = pid;
+            }
+        }
+        if (sortedIds.size() < pointCount)
+        {
+            WarnLog << "SparseFusePointCloud: " << pointCount - sortedIds.size() << " points are out of range" << std::endl;
+        }
+
+        StripeAccumulateTask accumulateTask;
+        accumulateTask.mpStripes = &mStripes;
+        accumulateTask.mpStripeOffsets = &stripeOffsets;
+        accumulateTask.mpSortedIds = &sortedIds;
+        accumulateTask.mpCoords = &coords;
+        accumulateTask.mpNormals = &normals;
+        accumulateTask.mpBlockKeys = &blockKeys;
+        accumulateTask.mpVoxelIds = &voxelIds;
+        accumulateTask.mpPointFields = pointFields;
+        accumulateTask.mFieldDim = mFieldDim;
+        accumulateTask.mCloudId = mCloudId;
+        accumulateTask.mHasNormal = mHasNormalInfo;
+        accumulateTask.mInterval = mInterval;
+        accumulateTask.mBlockResolution = mBlockResolution;
+        MagicCore::ThreadPool::Get()->ParallelFor(gStripeCount, &accumulateTask, 1);
+        mCloudId++;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode SparseFusePointCloud::ExtractPointCloud(GPP::IPointCloud* pointCloud, std::vector<GPP::Real>* pointFields,
+        std::vector<GPP::Int>* cloudIds)
+    {
+        if (pointCloud == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<SparseFuseBlock*> blocks;
+        CollectBlocks(blocks);
+        if (blocks.empty())
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        BlendFields(blocks);
+        std::vector<int> offsets(blocks.size() + 1, 0);
+        BlockCountTask countTask(&blocks, &offsets);
+        MagicCore::ThreadPool::Get()->ParallelFor(blocks.size(), &countTask, 64);
+        int offset = 0;
+        for (int bid = 0; bid <= int(blocks.size()); bid++)
+        {
+            int count = offsets[bid];
+            offsets[bid] = offset;
+            offset += count;
+        }
+        int extractCount = offsets.back();
+        std::vector<GPP::Vector3> coords(extractCount);
+        std::vector<GPP::Vector3> normals(mHasNormalInfo ? extractCount : 0);
+        if (pointFields)
+        {
+            pointFields->clear();
+            pointFields->resize(extractCount * mFieldDim);
+        }
+        if (cloudIds)
+        {
+            cloudIds->clear();
+            cloudIds->resize(extractCount);
+        }
+        BlockExtractTask extractTask(&blocks, &offsets, 0, mFieldDim, &coords, mHasNormalInfo ? &normals : NULL, pointFields, cloudIds);
+        MagicCore::ThreadPool::Get()->ParallelFor(blocks.size(), &extractTask, 64);
+
+        pointCloud->SetHasNormal(mHasNormalInfo);
+        for (int pid = 0; pid < extractCount; pid++)
+        {
+            if (mHasNormalInfo)
+            {
+                pointCloud->InsertPoint(coords[pid], normals[pid]);
+            }
+            else
+            {
+                pointCloud->InsertPoint(coords[pid]);
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode SparseFusePointCloud::ExtractPointCloud(SparseFuseListener* listener, GPP::Int batchPointCount, bool releaseBlocks)
+    {
+        if (listener == NULL || batchPointCount <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<SparseFuseBlock*> blocks;
+        CollectBlocks(blocks);
+        if (blocks.empty())
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        BlendFields(blocks);
+        std::vector<int> offsets(blocks.size() + 1, 0);
+        BlockCountTask countTask(&blocks, &offsets);
+        MagicCore::ThreadPool::Get()->ParallelFor(blocks.size(), &countTask, 64);
+        int offset = 0;
+        for (int bid = 0; bid <= int(blocks.size()); bid++)
+        {
+            int count = offsets[bid];
+            offsets[bid] = offset;
+            offset += count;
+        }
+
+        int blockCount = blocks.size();
+        int startBlockId = 0;
+        bool isStopped = false;
+        std::vector<GPP::Vector3> coords;
+        std::vector<GPP::Vector3> normals;
+        std::vector<GPP::Real> fields;
+        std::vector<GPP::Int> batchCloudIds;
+        while (startBlockId < blockCount && !isStopped)
+        {
+            int endBlockId = startBlockId + 1;
+            while (endBlockId < blockCount && offsets[endBlockId + 1] - offsets[startBlockId] <= batchPointCount)
+            {
+                endBlockId++;
+            }
+            int extractCount = offsets[endBlockId] - offsets[startBlockId];
+            coords.resize(extractCount);
+            normals.resize(mHasNormalInfo ? extractCount : 0);
+            fields.resize(extractCount * mFieldDim);
+            batchCloudIds.resize(extractCount);
+            BlockExtractTask extractTask(&blocks, &offsets, startBlockId, mFieldDim, &coords, mHasNormalInfo ? &normals : NULL,
+                &fields, &batchCloudIds);
+            MagicCore::ThreadPool::Get()->ParallelFor(endBlockId - startBlockId, &extractTask, 16);
+
+            GPP::PointCloud batchPointCloud(mHasNormalInfo, false);
+            batchPointCloud.ReservePoint(extractCount);
+            for (int pid = 0; pid < extractCount; pid++)
+            {
+                if (mHasNormalInfo)
+                {
+                    batchPointCloud.InsertPoint(coords[pid], normals[pid]);
+                }
+                else
+                {
+                    batchPointCloud.InsertPoint(coords[pid]);
+                }
+            }
+            isStopped = !listener->ExtractPoints(&batchPointCloud, mFieldDim > 0 ? &fields : NULL, &batchCloudIds);
+            if (releaseBlocks)
+            {
+                for (int bid = startBlockId; bid < endBlockId; bid++)
+                {
+                    mStripes[StripeIndex(blocks[bid]->blockKey)].erase(blocks[bid]->blockKey);
+                    GPPFREEPOINTER(blocks[bid]);
+                }
+            }
+            startBlockId = endBlockId;
+        }
+        if (releaseBlocks)
+        {
+            Clear();
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::Int SparseFusePointCloud::GetBlockCount() const
+    {
+        GPP::Int blockCount = 0;
+        for (std::vector<BlockMap>::const_iterator itr = mStripes.begin(); itr != mStripes.end(); ++itr)
+        {
+            blockCount += itr->size();
+        }
+        return blockCount;
+    }
+
+    GPP::Int SparseFusePointCloud::GetFieldDim() const
+    {
+        return mFieldDim;
+    }
+
+    GPP::LongInt SparseFusePointCloud::GetMemorySize() const
+    {
+        GPP::LongInt voxelCount = mBlockResolution * mBlockResolution * mBlockResolution;
+        GPP::LongInt voxelSize = sizeof(float) * 2 + sizeof(GPP::Int) + sizeof(GPP::Real) * (3 + (mHasNormalInfo ? 3 : 0) + mFieldDim);
+        return GetBlockCount() * (voxelCount * voxelSize + sizeof(SparseFuseBlock));
+    }
+
+    void SparseFusePointCloud::Clear()
+    {
+        for (std::vector<BlockMap>::iterator stripeItr = mStripes.begin(); stripeItr != mStripes.end(); ++stripeItr)
+        {
+            for (BlockMap::iterator itr = stripeItr->begin(); itr != stripeItr->end(); ++itr)
+            {
+                GPPFREEPOINTER(itr->second);
+            }
+            stripeItr->clear();
+        }
+        mFieldDim = 0;
+        mCloudId = 0;
+    }
+
+    void SparseFusePointCloud::BlendFields(const std::vector<SparseFuseBlock*>& blocks)
+    {
+        GPP::Int blendFieldDim = mBlendFieldDim < mFieldDim ? mBlendFieldDim : mFieldDim;
+        if (mBlendNeighborCount <= 0 || mBlendIterationCount <= 0 || blendFieldDim <= 0)
+        {
+            return;
+        }
+        // Neighbors are voxels in a cube whose voxel count is about blendNeighborCount
+        int cubeSize = int(pow(double(mBlendNeighborCount), 1.0 / 3.0) + 0.5);
+        int blendRadius = cubeSize / 2 > 1 ? cubeSize / 2 : 1;
+        for (GPP::Int iterationId = 0; iterationId < mBlendIterationCount; iterationId++)
+        {
+            FieldBlendTask blendTask(&mStripes, &blocks, mBlockResolution, mFieldDim, blendFieldDim, blendRadius);
+            MagicCore::ThreadPool::Get()->ParallelFor(blocks.size(), &blendTask, 16);
+            FieldBlendApplyTask applyTask(&blocks, mFieldDim, blendFieldDim, iterationId + 1 == mBlendIterationCount);
+            MagicCore::ThreadPool::Get()->ParallelFor(blocks.size(), &applyTask, 64);
+        }
+    }
+
+    void SparseFusePointCloud::CollectBlocks(std::vector<SparseFuseBlock*>& blocks) const
+    {
+        blocks.clear();
+        blocks.reserve(GetBlockCount());
+        for (std::vector<BlockMap>::const_iterator stripeItr = mStripes.begin(); stripeItr != mStripes.end(); ++stripeItr)
+        {
+            for (BlockMap::const_iterator itr = stripeItr->begin(); itr != stripeItr->end(); ++itr)
+            {
+                blocks.push_back(itr->second);
+            }
+        }
+    }
+}
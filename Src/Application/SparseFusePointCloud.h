@@ -0,0 +1,77 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+#include <unordered_map>
+
+namespace MagicApp
+{
+    // Receive extracted points batch by batch, return false to stop extraction
+    class SparseFuseListener
+    {
+    public:
+        SparseFuseListener();
+        virtual bool ExtractPoints(const GPP::PointCloud* pointCloud, const std::vector<GPP::Real>* pointFields,
+            const std::vector<GPP::Int>* cloudIds) = 0;
+        virtual ~SparseFuseListener();
+    };
+
+    struct SparseFuseBlock;
+
+    // Sparse version of FusePointCloud/SumPointCloud: space is hashed into voxel blocks and a block is
+    // allocated only when a point falls into it, so memory scales with the scanned surface instead of
+    // the bounding volume. There is no bounding box.
+    // Coordinates and normals are averaged in each voxel. Fields and cloud id are taken from the point
+    // nearest to the voxel center, so index fields (like color ids or point ids) stay valid.
+    // Like the blend of SumPointCloud, leading fields could be blended where clouds overlap before extraction.
+    class SparseFusePointCloud
+    {
+    public:
+        SparseFusePointCloud();
+        // interval: voxel size; blockResolution: voxel count of a block along each axis
+        explicit SparseFusePointCloud(GPP::Real interval, bool hasNormalInfo, GPP::Int blockResolution = 8);
+        ~SparseFusePointCloud();
+
+        void Init(GPP::Real interval, bool hasNormalInfo, GPP::Int blockResolution = 8);
+
+        // blendNeighborCount == 0: no blend of overlap. Only the first blendFieldDim fields are blended,
+        // the following ones are index fields and kept. Default is no blend.
+        void SetBlend(GPP::Int blendNeighborCount, GPP::Int blendIterationCount, GPP::Int blendFieldDim);
+
+        // transform == NULL if transform is identity
+        // pointFields: pointFields->size() = pointCount * fieldDim, fieldDim should be the same for all updates
+        GPP::ErrorCode UpdateFuseFunction(const GPP::IPointCloud* pointCloud, const GPP::Matrix4x4* transform,
+            const std::vector<GPP::Real>* pointFields = NULL);
+
+        // pointCloud should allocate memory first and be blank
+        GPP::ErrorCode ExtractPointCloud(GPP::IPointCloud* pointCloud, std::vector<GPP::Real>* pointFields = NULL,
+            std::vector<GPP::Int>* cloudIds = NULL);
+
+        // Streaming extraction: points are sent to listener in batches of about batchPointCount.
+        // If releaseBlocks is true, blocks are freed after they are sent, and SparseFusePointCloud is blank after that.
+        GPP::ErrorCode ExtractPointCloud(SparseFuseListener* listener, GPP::Int batchPointCount, bool releaseBlocks);
+
+        GPP::Int GetBlockCount(void) const;
+        GPP::Int GetFieldDim(void) const;
+        // Approximate memory of allocated blocks in bytes
+        GPP::LongInt GetMemorySize(void) const;
+
+        void Clear(void);
+
+    private:
+        typedef std::unordered_map<GPP::LongInt, SparseFuseBlock*> BlockMap;
+
+        void CollectBlocks(std::vector<SparseFuseBlock*>& blocks) const;
+        void BlendFields(const std::vector<SparseFuseBlock*>& blocks);
+
+    private:
+        std::vector<BlockMap> mStripes;
+        GPP::Real mInterval;
+        GPP::Int mBlockResolution;
+        bool mHasNormalInfo;
+        GPP::Int mFieldDim;
+        GPP::Int mCloudId;
+        GPP::Int mBlendNeighborCount;
+        GPP::Int mBlendIterationCount;
+        GPP::Int mBlendFieldDim;
+    };
+}
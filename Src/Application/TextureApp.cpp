@@ -4,6 +4,7 @@
 #include "TextureAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "TextureBaker.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
@@ -13,6 +14,9 @@
 
 namespace MagicApp
 {
+    // Larger images are shrunk for display, baking and export use the image files
+    static const int gMaxDisplayImageSize = 4096;
+
     static unsigned __stdcall RunThread(void *arg)
     {
         TextureApp* app = (TextureApp*)arg;
@@ -36,10 +40,10 @@ namespace MagicApp
         mIsCommandInProgress(false),
         mUpdateDisplay(false),
         mTextureImageNames(),
+        mBakedTextureImageNames(),
         mCurrentTextureImageId(0),
         mTextureType(TT_NONE),
         mTextureImageName("../../Media/TextureApp/texture.png"),
-        mTextureImageMasks(),
         mSharpDiff()
     {
     }
@@ -64,14 +68,13 @@ namespace MagicApp
         mDisplayMode = TRIMESH_SOLID;
         mDistortionImage.release();
         mTextureType = TT_NONE;
-        mTextureImageMasks.clear();
     }
 
     bool TextureApp::IsCommandAvaliable()
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -216,7 +219,7 @@ namespace MagicApp
             mpImageFrameMesh = GPP::Parser::ImportTriMesh("../../Media/TextureApp/ImageMesh.obj");
             if (mpImageFrameMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpImageFrameMesh->UpdateNormal();
@@ -231,11 +234,7 @@ namespace MagicApp
         {
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mTextureType = TT_NONE;
-            std::vector<std::string>::iterator itr = std::find(mTextureImageNames.begin(), mTextureImageNames.end(), mTextureImageName);
-            if (itr != mTextureImageNames.end())
-            {
-                mTextureImageNames.erase(itr);
-            }
+            RemoveBakedTextureImages();
             mCurrentTextureImageId = 0;
             UpdatetextureImage();
         }
@@ -270,7 +269,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -278,11 +277,7 @@ namespace MagicApp
             UpdateDisplay();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             mTextureType = TT_NONE;
-            std::vector<std::string>::iterator itr = std::find(mTextureImageNames.begin(), mTextureImageNames.end(), mTextureImageName);
-            if (itr != mTextureImageNames.end())
-            {
-                mTextureImageNames.erase(itr);
-            }
+            RemoveBakedTextureImages();
             mCurrentTextureImageId = 0;
             UpdatetextureImage();
         }
@@ -355,32 +350,55 @@ namespace MagicApp
     void TextureApp::SwitchTextureImage()
     {
         mCurrentTextureImageId = (mCurrentTextureImageId + 1) % mTextureImageNames.size();
-        mDistortionImage.release();
-        mDistortionImage = cv::imread(mTextureImageNames.at(mCurrentTextureImageId));
-        if (mDistortionImage.data != NULL)
-        {
-            mTextureImageSize = mDistortionImage.rows;
-        }
-        else
+        if (LoadDistortionImage(mTextureImageNames.at(mCurrentTextureImageId)) == false)
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
         }
         UpdateDisplay();
     }
 
     void TextureApp::UpdatetextureImage()
+    {
+        if (LoadDistortionImage(mTextureImageNames.at(mCurrentTextureImageId)) == false)
+        {
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
+        }
+        mUpdateDisplay = true;
+    }
+
+    bool TextureApp::LoadDistortionImage(const std::string& fileName)
     {
         mDistortionImage.release();
-        mDistortionImage = cv::imread(mTextureImageNames.at(mCurrentTextureImageId));
-        if (mDistortionImage.data != NULL)
+        cv::Mat image = cv::imread(fileName);
+        if (image.data == NULL)
+        {
+            return false;
+        }
+        // Texture images are baked in the size of the current image
+        mTextureImageSize = image.rows;
+        if (image.rows > gMaxDisplayImageSize || image.cols > gMaxDisplayImageSize)
         {
-            mTextureImageSize = mDistortionImage.rows;
+            double scale = double(gMaxDisplayImageSize) / double(image.rows > image.cols ? image.rows : image.cols);
+            cv::resize(image, mDistortionImage, cv::Size(), scale, scale, cv::INTER_AREA);
         }
         else
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            mDistortionImage = image;
         }
-        mUpdateDisplay = true;
+        return true;
+    }
+
+    void TextureApp::RemoveBakedTextureImages()
+    {
+        for (std::vector<std::string>::iterator nameItr = mBakedTextureImageNames.begin(); nameItr != mBakedTextureImageNames.end(); ++nameItr)
+        {
+            std::vector<std::string>::iterator itr = std::find(mTextureImageNames.begin(), mTextureImageNames.end(), *nameItr);
+            if (itr != mTextureImageNames.end())
+            {
+                mTextureImageNames.erase(itr);
+            }
+        }
+        mBakedTextureImageNames.clear();
     }
 
     void TextureApp::InitViewTool()
@@ -463,18 +481,22 @@ namespace MagicApp
             // Get the pixel buffer  
             Ogre::HardwarePixelBufferSharedPtr pixelBuffer = mpTriMeshTexture->getBuffer();  
             cv::Mat textureImage = mDistortionImage;;
+            // The texture is created once, the image is stretched over it
+            int textureSize = int(mpTriMeshTexture->getWidth());
             // Lock the pixel buffer and get a pixel box  
             unsigned char* buffer = static_cast<unsigned char*>(  
-                pixelBuffer->lock(0, mTextureImageSize * mTextureImageSize * 4, Ogre::HardwareBuffer::HBL_DISCARD) ); 
+                pixelBuffer->lock(0, textureSize * textureSize * 4, Ogre::HardwareBuffer::HBL_DISCARD) ); 
             int imgW = textureImage.cols;
             int imgH = textureImage.rows;
-            for(int y = 0; y < mTextureImageSize; ++y)  
+            for(int y = 0; y < textureSize; ++y)  
             {  
-                for(int x = 0; x < mTextureImageSize; ++x)  
+                for(int x = 0; x < textureSize; ++x)  
                 {
-                    if (x < imgW && y < imgH)
+                    int imgX = int(GPP::LongInt(x) * imgW / textureSize);
+                    int imgY = int(GPP::LongInt(y) * imgH / textureSize);
+                    if (imgX < imgW && imgY < imgH)
                     {
-                        const unsigned char* pixel = textureImage.ptr(imgH - y - 1, x);
+                        const unsigned char* pixel = textureImage.ptr(imgH - imgY - 1, imgX);
                         *buffer++ = pixel[0];
                         *buffer++ = pixel[1];
                         *buffer++ = pixel[2];
@@ -555,12 +577,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         if (triMesh->HasTriangleTexCoord() == false)
         {
-            MessageBox(NULL, "ȼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先计算纹理坐标", "温馨提示", MB_OK);
             return;
         }
         std::string fileName;
@@ -579,7 +601,7 @@ namespace MagicApp
                 dotPos = fileName.rfind('/');
                 if (dotPos == std::string::npos)
                 {
-                    MessageBox(NULL, "ļЧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "文件名字无效", "温馨提示", MB_OK);
                     return;
                 }
             }
@@ -621,10 +643,13 @@ namespace MagicApp
             
             // export texture image
             std::string imageName = fileName + ".png";
-            cv::imwrite(imageName, mDistortionImage);
+            // mDistortionImage could be shrunk for display
+            cv::Mat textureImage = cv::imread(mTextureImageNames.at(mCurrentTextureImageId));
+            cv::imwrite(imageName, textureImage.data != NULL ? textureImage : mDistortionImage);
             //
 
             triMesh->UnifyCoords(scaleValue, objCenterCoord);
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
         }
     }
 
@@ -637,12 +662,12 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         if (triMesh->HasTriangleTexCoord() == false)
         {
-            MessageBox(NULL, "ȸ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先给网格计算纹理坐标", "温馨提示", MB_OK);
             return;
         }
 
@@ -651,7 +676,7 @@ namespace MagicApp
         {
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入需要带颜色的网格", "温馨提示", MB_OK);
                 return;
             }
         }
@@ -659,14 +684,13 @@ namespace MagicApp
         {
             if (originImageColorIds.size() != triMesh->GetVertexCount())
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
         }
 
         GPP::Int faceCount = triMesh->GetTriangleCount();
         std::vector<GPP::Real> textureCoords(faceCount * 3 * 2);
-        std::vector<GPP::Int> textureIds(faceCount *  3);
         for (GPP::Int fid = 0; fid < faceCount; ++fid)
         {
             for (int fvid = 0; fvid < 3; ++fvid)
@@ -675,17 +699,15 @@ namespace MagicApp
                 GPP::Int baseIndex = fid * 3 + fvid;
                 textureCoords.at(baseIndex * 2) = texCoord[0];
                 textureCoords.at(baseIndex * 2 + 1) = texCoord[1];
-                textureIds.at(baseIndex) = baseIndex;
             }
         }
         
-        //std::vector<GPP::Vector3> imageData;
-        std::vector<GPP::Color4> imageData;
-        mTextureImageMasks.clear();
+        TextureBaker textureBaker;
+        textureBaker.SetImageSize(mTextureImageSize);
+        textureBaker.SetPreviewSize(gMaxDisplayImageSize);
         GPP::ErrorCode res = GPP_NO_ERROR;
         if (isByVertexColor)
         {
-            //std::vector<GPP::Vector3> vertexColors(faceCount * 3);
             std::vector<GPP::Color4> vertexColors(faceCount * 3);
             GPP::Int vertexIds[3] = {-1};
             for (GPP::Int fid = 0; fid < faceCount; ++fid)
@@ -697,8 +719,7 @@ namespace MagicApp
                     vertexColors.at(fid * 3 + fvid) = GPP::Color4::Vector3ToColor4(vColor);
                 }
             }
-            res = GPP::TextureImage::CreateTextureImageByVertexColors(textureCoords, textureIds, 
-                vertexColors, mTextureImageSize, mTextureImageSize, imageData, &mTextureImageMasks);
+            res = textureBaker.BakeCornerColors(textureCoords, vertexColors, mTextureImageName, "../../Media/TextureApp/Overlapped.png");
         }
         else
         {
@@ -712,102 +733,42 @@ namespace MagicApp
                     imageColorIds.at(fid * 3 + fvid) = originImageColorIds.at(vertexIds[fvid]);
                 }
             }
+            // Reference images are read by the baker when a block needs them
             std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
-            int imageCount = textureImageFiles.size();
-            std::vector<std::vector<GPP::Color4> > imageListData;
-            imageListData.reserve(imageCount);
-            std::vector<GPP::Int> imageInfos;
-            imageInfos.reserve(imageCount * 2);
-            for (int iid = 0; iid < imageCount; ++iid)
-            {
-                cv::Mat image = cv::imread(textureImageFiles.at(iid));
-                if (image.data == NULL)
-                {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
-                    return;
-                }
-                int width = image.cols;
-                int height = image.rows;
-
-                std::vector<GPP::Color4> oneImageData(width * height);
-                for (int y = 0; y < height; ++y)
-                {
-                    for (int x = 0; x < width; ++x)
-                    {
-                        const unsigned char* pixel = image.ptr(height - 1 - y, x);
-                        //GPP::Vector3 color(pixel[2] / 255.0, pixel[1] / 255.0, pixel[0] / 255.0);
-                        GPP::Color4 color(pixel[2], pixel[1], pixel[0]);
-                        oneImageData.at(x + y * width) = color;
-                    }
-                }
-                imageListData.push_back(oneImageData);
-                imageInfos.push_back(width);
-                imageInfos.push_back(height);
-            }
-            res = GPP::TextureImage::CreateTextureImageByRefImages(textureCoords, textureIds, imageColorIds, 
-                imageListData, imageInfos, mTextureImageSize, mTextureImageSize, imageData, &mTextureImageMasks);
+            res = textureBaker.BakeRefImages(textureCoords, imageColorIds, textureImageFiles, mTextureImageName, 
+                "../../Media/TextureApp/Overlapped.png");
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ͼʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "纹理图生成失败", "温馨提示", MB_OK);
             return;
         }
-        
-        cv::Mat textureImage(mTextureImageSize, mTextureImageSize, CV_8UC4);
-        cv::Mat alphaImage(mTextureImageSize, mTextureImageSize, CV_8UC4);
-        GPP::Int maxAlpha = *std::max_element(mTextureImageMasks.begin(), mTextureImageMasks.end());
-        if (maxAlpha == 0)
-        {
-            maxAlpha = 1;
-        }
-        for (int y = 0; y < mTextureImageSize; ++y)
+        // Texture coordinates out of [0, 1] are baked to one image per UDIM tile
+        const std::vector<std::string>& textureFiles = textureBaker.GetTextureFiles();
+        for (std::vector<std::string>::const_iterator fileItr = textureFiles.begin(); fileItr != textureFiles.end(); ++fileItr)
         {
-            for (int x = 0; x < mTextureImageSize; ++x)
+            if (std::find(mTextureImageNames.begin(), mTextureImageNames.end(), *fileItr) == mTextureImageNames.end())
             {
-                cv::Vec4b& col = textureImage.at<cv::Vec4b>(mTextureImageSize - 1 - y, x);
-                //GPP::Vector3 vCol = imageData.at(x + y * mTextureImageSize);
-                GPP::Color4 cColor = imageData.at(x + y * mTextureImageSize);
-                col[0] = cColor[2];
-                col[1] = cColor[1];
-                col[2] = cColor[0];
-                col[3] = 255;
-
-                cv::Vec4b& alpha = alphaImage.at<cv::Vec4b>(mTextureImageSize - 1 - y, x);
-                int mask = mTextureImageMasks.at(x + y * mTextureImageSize);
-                if (mask < 3)
-                {
-                    alpha[0] = 0;
-                    alpha[1] = 0;
-                    alpha[2] = 0;
-                    alpha[3] = 255;
-                    alpha[mask] = 255;
-                }
-                else
-                {
-                    alpha[0] = mask * 255 / maxAlpha;
-                    alpha[1] = mask * 255 / maxAlpha;
-                    alpha[2] = mask * 255 / maxAlpha;
-                    alpha[3] = 255;
-                }
+                mTextureImageNames.push_back(*fileItr);
+            }
+            if (std::find(mBakedTextureImageNames.begin(), mBakedTextureImageNames.end(), *fileItr) == mBakedTextureImageNames.end())
+            {
+                mBakedTextureImageNames.push_back(*fileItr);
             }
         }
-        cv::imwrite(mTextureImageName, textureImage);
-        std::vector<std::string>::iterator itr = std::find(mTextureImageNames.begin(), mTextureImageNames.end(), mTextureImageName);
-        if (itr == mTextureImageNames.end())
-        {
-            mTextureImageNames.push_back(mTextureImageName);
-        }
-        cv::imwrite("../../Media/TextureApp/Overlapped.png", alphaImage);
+        mCurrentTextureImageId = std::find(mTextureImageNames.begin(), mTextureImageNames.end(), textureFiles.front()) - mTextureImageNames.begin();
 
+        // The baker keeps a shrunk copy of the first tile, the tile itself is not decoded
+        GPP::Int previewSize = textureBaker.GetPreviewImageSize();
         mDistortionImage.release();
-        mDistortionImage = cv::imread(mTextureImageName);
-        if (mDistortionImage.data != NULL)
+        if (previewSize > 0)
         {
-            mTextureImageSize = mDistortionImage.rows;
+            mDistortionImage = cv::Mat(previewSize, previewSize, CV_8UC3, 
+                const_cast<unsigned char*>(&(textureBaker.GetPreviewPixels().at(0)))).clone();
         }
         else
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "图片打开失败", "温馨提示", MB_OK);
         }
         mDisplayMode = TRIMESH_TEXTURE;
         UpdateDisplay();
@@ -829,18 +790,18 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "输入需要带颜色的网格", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
             if (imageColorIds.size() != triMesh->GetVertexCount())
             {
-                MessageBox(NULL, "ͼƬӦļд", "ܰʾ", MB_OK);
+                MessageBox(NULL, "顶点与图片对应文件有错", "温馨提示", MB_OK);
                 return;
             }
             std::vector<int> vertexFlags = ModelManager::Get()->GetImageColorIdFlags();
@@ -903,7 +864,7 @@ namespace MagicApp
                 cv::Mat image = cv::imread(textureImageFiles.at(iid));
                 if (image.data == NULL)
                 {
-                    MessageBox(NULL, "ͼƬȡʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "图片读取失败", "温馨提示", MB_OK);
                     return;
                 }
                 int imageWidth = image.cols;
@@ -921,7 +882,7 @@ namespace MagicApp
                     faceVertexIds, imageWidth, imageHeight, imageData); 
                 if (res != GPP_NO_ERROR)
                 {
-                    MessageBox(NULL, "ͼŻʧ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "纹理图优化失败", "温馨提示", MB_OK);
                     return;
                 }
                 for (int y = 0; y < imageHeight; ++y)
@@ -1013,14 +974,14 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
             std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
             if (imageColorIds.empty())
             {
-                MessageBox(NULL, "ImageColorId is empty", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ImageColorId is empty", "温馨提示", MB_OK);
                 return;
             }
             std::vector<int> fixFlag = ModelManager::Get()->GetImageColorIdFlags();
@@ -1035,12 +996,12 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::OptimiseMapping::InterpolateImageColorIdsOnMesh(triMesh, fixFlag, imageColorIds);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ͼӦŻʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "图像对应优化失败", "温馨提示", MB_OK);
                 return;
             }
             ModelManager::Get()->SetImageColorIds(imageColorIds);
@@ -1057,14 +1018,14 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
             return;
         }
         int vertexCount = triMesh->GetVertexCount();
         std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
         if (imageColorIds.size() != vertexCount)
         {
-            MessageBox(NULL, "ImageColorId size != vertexCount", "ܰʾ", MB_OK);
+            MessageBox(NULL, "ImageColorId size != vertexCount", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -1074,12 +1035,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OptimiseMapping::OptimiseIsolateImageColorIdsOnMesh(triMesh, imageColorIds, isolateValue);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "ӦŻʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "点像对应孤立点优化失败", "温馨提示", MB_OK);
             return;
         }
         ModelManager::Get()->SetImageColorIds(imageColorIds);
@@ -1106,13 +1067,13 @@ namespace MagicApp
             std::ifstream fin(fileName);
             if (!fin)
             {
-                MessageBox(NULL, "GIIʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "GII导入失败", "温馨提示", MB_OK);
                 return;
             }
             ModelManager::Get()->LoadInfo(fin);
             fin.close();
 
-            MessageBox(NULL, "뵼ͼ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入图像", "温馨提示", MB_OK);
             std::vector<std::string> fileNames;
             char filterName[] = "JPG Files(*.jpg)\0*.jpg\0PNG Files(*.png)\0*.png\0BMP Image(*.bmp)\0*.bmp\0";
             if (MagicCore::ToolKit::MultiFileOpenDlg(fileNames, filterName))
@@ -1128,19 +1089,19 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "mpTriMesh == NULL", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mpTriMesh == NULL", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::string> textureImageFiles = ModelManager::Get()->GetTextureImageFiles();
         if (textureImageFiles.empty())
         {
-            MessageBox(NULL, "mTextureImageFiles is empty", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mTextureImageFiles is empty", "温馨提示", MB_OK);
             return;
         }
         std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
         if (imageColorIds.size() != triMesh->GetVertexCount())
         {
-            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "ܰʾ", MB_OK);
+            MessageBox(NULL, "mImageColorIds.size() != mpTriMesh->GetVertexCount()", "温馨提示", MB_OK);
             return;
         }
         int imageCount = textureImageFiles.size();
@@ -1151,7 +1112,7 @@ namespace MagicApp
             imageList.at(fid) = cv::imread(textureImageFiles.at(fid));
             if (imageList.at(fid).data == NULL)
             {
-                MessageBox(NULL, "Imageʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "Image导入失败", "温馨提示", MB_OK);
                 return;
             }
             imageHList.at(fid) = imageList.at(fid).rows;
@@ -1191,20 +1152,20 @@ namespace MagicApp
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
             if (triMesh == NULL)
             {
-                MessageBox(NULL, "ȵ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "请先导入网格", "温馨提示", MB_OK);
                 return;
             }
             int vertexCount = triMesh->GetVertexCount();
             std::vector<GPP::Int> colorIds = ModelManager::Get()->GetColorIds();
             if (colorIds.empty())
             {
-                MessageBox(NULL, "ColorIds is empty", "ܰʾ", MB_OK);
+                MessageBox(NULL, "ColorIds is empty", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::Vector3> vertexColors(vertexCount);
             if (triMesh->HasVertexColor() == false)
             {
-                MessageBox(NULL, "Ҫɫ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格需要颜色", "温馨提示", MB_OK);
                 return;
             }
             for (int vid = 0; vid < vertexCount; vid++)
@@ -1220,12 +1181,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ɫںʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格颜色融合失败", "温馨提示", MB_OK);
                 return;
             }
             for (int vid = 0; vid < vertexCount; vid++)
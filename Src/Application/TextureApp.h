@@ -98,6 +98,10 @@ namespace MagicApp
         void ClearData(void);
         bool IsCommandAvaliable(void);
         void ClearMeshData(void);
+        // Return false if the file could not be read, the image is shrunk for display
+        bool LoadDistortionImage(const std::string& fileName);
+        // Tiles of the last bake are not images of the current mesh
+        void RemoveBakedTextureImages(void);
 
     private:
         TextureAppUI* mpUI;
@@ -111,10 +115,11 @@ namespace MagicApp
         bool mIsCommandInProgress;
         bool mUpdateDisplay;
         std::vector<std::string> mTextureImageNames;
+        // Every tile of the last bake, each UDIM tile has its own file
+        std::vector<std::string> mBakedTextureImageNames;
         int mCurrentTextureImageId;
         TextureType mTextureType;
         std::string mTextureImageName;
-        std::vector<GPP::Int> mTextureImageMasks;
         GPP::Vector3 mSharpDiff;
     };
 }
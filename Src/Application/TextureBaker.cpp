@@ -0,0 +1,845 @@
+#include "TextureBaker.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/LogSystem.h"
+#include "opencv2/opencv.hpp"
+#include <windows.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+namespace MagicApp
+{
+    static const GPP::Int gBakeBlockSize = 256;
+    // Empty pixels within this distance of a triangle are filled by their neighbors, so mipmaps do not bleed
+    static const GPP::Int gBakeGutter = 4;
+    // Larger tiles are streamed to ppm, encoders of other formats need the whole image
+    static const GPP::Int gMaxEncodedImageSize = 8192;
+    static const GPP::ULongInt gRefImageCacheSize = GPP::ULongInt(1024) * 1024 * 1024;
+    static const GPP::Int gUdimColumnCount = 10;
+    static const GPP::Int gDefaultPreviewSize = 2048;
+    static const GPP::Real gInsideTolerance = 1.0e-6;
+
+    // Reference images read on demand, the least recently used ones are released when the cache is full.
+    // Released images stay valid for the blocks which still use them, because cv::Mat counts references.
+    class RefImageCache
+    {
+    public:
+        RefImageCache(const std::vector<std::string>* imageFiles, GPP::ULongInt cacheSize) :
+            mpImageFiles(imageFiles),
+            mImages(imageFiles->size()),
+            mRecentIds(),
+            mCacheSize(cacheSize),
+            mMemorySize(0)
+        {
+            InitializeCriticalSection(&mLock);
+        }
+
+        ~RefImageCache()
+        {
+            DeleteCriticalSection(&mLock);
+        }
+
+        GPP::Int GetImageCount(void) const
+        {
+            return mImages.size();
+        }
+
+        // Empty image if the file could not be read
+        cv::Mat Acquire(GPP::Int imageId)
+        {
+            EnterCriticalSection(&mLock);
+            cv::Mat image = mImages.at(imageId);
+            if (image.data != NULL)
+            {
+                mRecentIds.remove(imageId);
+                mRecentIds.push_front(imageId);
+            }
+            LeaveCriticalSection(&mLock);
+            if (image.data != NULL)
+            {
+                return image;
+            }
+            // Decode outside of the lock, other blocks keep sampling their images
+            image = cv::imread(mpImageFiles->at(imageId));
+            if (image.data == NULL)
+            {
+                ErrorLog << "RefImageCache::Acquire: failed to read " << mpImageFiles->at(imageId) << std::endl;
+                return image;
+            }
+            EnterCriticalSection(&mLock);
+            if (mImages.at(imageId).data == NULL)
+            {
+                mImages.at(imageId) = image;
+                mRecentIds.push_front(imageId);
+                mMemorySize += GPP::ULongInt(image.total() * image.elemSize());
+                Evict();
+            }
+            else
+            {
+                image = mImages.at(imageId);
+            }
+            LeaveCriticalSection(&mLock);
+            return image;
+        }
+
+    private:
+        void Evict(void)
+        {
+            while (mMemorySize > mCacheSize && mRecentIds.size() > 1)
+            {
+                GPP::Int imageId = mRecentIds.back();
+                mRecentIds.pop_back();
+                cv::Mat& image = mImages.at(imageId);
+                mMemorySize -= GPP::ULongInt(image.total() * image.elemSize());
+                image.release();
+            }
+        }
+
+    private:
+        const std::vector<std::string>* mpImageFiles;
+        std::vector<cv::Mat> mImages;
+        // Most recently used first
+        std::list<GPP::Int> mRecentIds;
+        GPP::ULongInt mCacheSize;
+        GPP::ULongInt mMemorySize;
+        CRITICAL_SECTION mLock;
+    };
+
+    // Receives an image from top to bottom. A ppm file is written row by row, other formats are encoded by OpenCV
+    // when the image is closed.
+    class BandImageWriter
+    {
+    public:
+        BandImageWriter() :
+            mFileName(),
+            mWidth(0),
+            mpFile(NULL),
+            mImage(),
+            mWrittenRowCount(0)
+        {
+        }
+
+        ~BandImageWriter()
+        {
+            if (mpFile != NULL)
+            {
+                fclose(mpFile);
+            }
+        }
+
+        bool Open(const std::string& fileName, GPP::Int width, GPP::Int height, bool isStreamed)
+        {
+            mFileName = fileName;
+            mWidth = width;
+            mWrittenRowCount = 0;
+            if (isStreamed)
+            {
+                mpFile = fopen(fileName.c_str(), "wb");
+                if (mpFile == NULL)
+                {
+                    return false;
+                }
+                fprintf(mpFile, "P6\n%d %d\n255\n", int(width), int(height));
+            }
+            else
+            {
+                mImage.create(height, width, CV_8UC3);
+            }
+            return true;
+        }
+
+        // Three channels in bgr order
+        bool WriteRows(const std::vector<unsigned char>& rows, GPP::Int rowCount)
+        {
+            size_t rowSize = size_t(mWidth) * 3;
+            if (mpFile == NULL)
+            {
+                for (GPP::Int rowId = 0; rowId < rowCount; rowId++)
+                {
+                    memcpy(mImage.ptr(mWrittenRowCount + rowId), &rows.at(rowSize * rowId), rowSize);
+                }
+                mWrittenRowCount += rowCount;
+                return true;
+            }
+            std::vector<unsigned char> rgbRow(rowSize);
+            for (GPP::Int rowId = 0; rowId < rowCount; rowId++)
+            {
+                const unsigned char* bgrRow = &rows.at(rowSize * rowId);
+                for (size_t pixelId = 0; pixelId < rowSize; pixelId += 3)
+                {
+                    rgbRow.at(pixelId) = bgrRow[pixelId + 2];
+                    rgbRow.at(pixelId + 1) = bgrRow[pixelId + 1];
+                    rgbRow.at(pixelId + 2) = bgrRow[pixelId];
+                }
+                if (fwrite(&rgbRow.at(0), 1, rowSize, mpFile) != rowSize)
+                {
+                    return false;
+                }
+            }
+            mWrittenRowCount += rowCount;
+            return true;
+        }
+
+        bool Close(void)
+        {
+            if (mpFile != NULL)
+            {
+                bool isSucceeded = (fclose(mpFile) == 0);
+                mpFile = NULL;
+                return isSucceeded;
+            }
+            bool isSucceeded = cv::imwrite(mFileName, mImage);
+            mImage.release();
+            return isSucceeded;
+        }
+
+    private:
+        std::string mFileName;
+        GPP::Int mWidth;
+        FILE* mpFile;
+        cv::Mat mImage;
+        GPP::Int mWrittenRowCount;
+    };
+
+    // Box filtered copy of an image which is received from top to bottom, every factor x factor pixels are averaged
+    class BandImageShrinker
+    {
+    public:
+        BandImageShrinker(GPP::Int imageSize, GPP::Int maxSize) :
+            mImageSize(imageSize),
+            mFactor(1),
+            mShrunkSize(0),
+            mReceivedRowCount(0),
+            mRowSums(),
+            mRowCounts(),
+            mPixels()
+        {
+            if (maxSize > 0 && imageSize > maxSize)
+            {
+                mFactor = (imageSize + maxSize - 1) / maxSize;
+            }
+            mShrunkSize = (imageSize + mFactor - 1) / mFactor;
+            mRowSums.assign(size_t(mShrunkSize) * 3, 0);
+            mRowCounts.assign(mShrunkSize, 0);
+            mPixels.assign(size_t(mShrunkSize) * mShrunkSize * 3, 0);
+        }
+
+        // Three channels in bgr order
+        void AddRows(const std::vector<unsigned char>& rows, GPP::Int rowCount)
+        {
+            size_t rowSize = size_t(mImageSize) * 3;
+            for (GPP::Int rowId = 0; rowId < rowCount; rowId++)
+            {
+                const unsigned char* row = &rows.at(rowSize * rowId);
+                for (GPP::Int x = 0; x < mImageSize; x++)
+                {
+                    GPP::Int shrunkX = x / mFactor;
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        mRowSums.at(shrunkX * 3 + channel) += row[x * 3 + channel];
+                    }
+                    mRowCounts.at(shrunkX)++;
+                }
+                mReceivedRowCount++;
+                if (mReceivedRowCount % mFactor == 0 || mReceivedRowCount == mImageSize)
+                {
+                    FlushRow((mReceivedRowCount - 1) / mFactor);
+                }
+            }
+        }
+
+        GPP::Int GetShrunkSize(void) const
+        {
+            return mShrunkSize;
+        }
+
+        void SwapPixels(std::vector<unsigned char>& pixels)
+        {
+            pixels.swap(mPixels);
+        }
+
+    private:
+        void FlushRow(GPP::Int shrunkY)
+        {
+            unsigned char* pixel = &mPixels.at(size_t(shrunkY) * mShrunkSize * 3);
+            for (GPP::Int shrunkX = 0; shrunkX < mShrunkSize; shrunkX++)
+            {
+                GPP::ULongInt count = mRowCounts.at(shrunkX);
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    GPP::ULongInt& sum = mRowSums.at(shrunkX * 3 + channel);
+                    *pixel++ = (unsigned char)(count == 0 ? 0 : (sum + count / 2) / count);
+                    sum = 0;
+                }
+                mRowCounts.at(shrunkX) = 0;
+            }
+        }
+
+    private:
+        GPP::Int mImageSize;
+        GPP::Int mFactor;
+        GPP::Int mShrunkSize;
+        GPP::Int mReceivedRowCount;
+        std::vector<GPP::ULongInt> mRowSums;
+        std::vector<GPP::ULongInt> mRowCounts;
+        std::vector<unsigned char> mPixels;
+    };
+
+    // Bilinear sample, y is counted from the bottom like GPP image data
+    static void SampleImage(const cv::Mat& image, GPP::Real x, GPP::Real y, GPP::Real bgr[3])
+    {
+        GPP::Real maxX = GPP::Real(image.cols - 1);
+        GPP::Real maxY = GPP::Real(image.rows - 1);
+        x = x < 0 ? 0 : (x > maxX ? maxX : x);
+        y = y < 0 ? 0 : (y > maxY ? maxY : y);
+        int x0 = int(x);
+        int y0 = int(y);
+        int x1 = x0 < image.cols - 1 ? x0 + 1 : x0;
+        int y1 = y0 < image.rows - 1 ? y0 + 1 : y0;
+        GPP::Real wx = x - x0;
+        GPP::Real wy = y - y0;
+        const unsigned char* pixel00 = image.ptr(image.rows - 1 - y0, x0);
+        const unsigned char* pixel10 = image.ptr(image.rows - 1 - y0, x1);
+        const unsigned char* pixel01 = image.ptr(image.rows - 1 - y1, x0);
+        const unsigned char* pixel11 = image.ptr(image.rows - 1 - y1, x1);
+        for (int channel = 0; channel < 3; channel++)
+        {
+            bgr[channel] = (pixel00[channel] * (1.0 - wx) + pixel10[channel] * wx) * (1.0 - wy) +
+                (pixel01[channel] * (1.0 - wx) + pixel11[channel] * wx) * wy;
+        }
+    }
+
+    static unsigned char ToColorValue(GPP::Real value)
+    {
+        return value <= 0 ? 0 : (value >= 255 ? 255 : (unsigned char)(value + 0.5));
+    }
+
+    static std::string GetTileFileName(const std::string& fileName, GPP::Int udim, bool isMultiTile, bool isStreamed)
+    {
+        size_t dotPos = fileName.find_last_of('.');
+        size_t slashPos = fileName.find_last_of("/\\");
+        if (dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos))
+        {
+            dotPos = fileName.size();
+        }
+        std::stringstream tileName;
+        tileName << fileName.substr(0, dotPos);
+        if (isMultiTile)
+        {
+            tileName << "." << udim;
+        }
+        tileName << (isStreamed ? std::string(".ppm") : fileName.substr(dotPos));
+        return tileName.str();
+    }
+
+    // Bakes the blocks of one band of a tile, and copies them into the band rows
+    class BakeBlockTask : public MagicCore::ParallelTask
+    {
+    public:
+        BakeBlockTask(const std::vector<GPP::Real>* texCoords, const std::vector<GPP::Color4>* cornerColors,
+            const std::vector<GPP::ImageColorId>* cornerColorIds, RefImageCache* imageCache, GPP::Int imageCount,
+            const std::vector<std::vector<GPP::Int> >* blockTriangles, GPP::Int tileU, GPP::Int tileV, GPP::Int imageSize,
+            GPP::Int blockSize, GPP::Int bandStartY, GPP::Int bandEndY, std::vector<unsigned char>* textureRows,
+            std::vector<unsigned char>* maskRows) :
+            mpTexCoords(texCoords),
+            mpCornerColors(cornerColors),
+            mpCornerColorIds(cornerColorIds),
+            mpImageCache(imageCache),
+            mImageCount(imageCount),
+            mpBlockTriangles(blockTriangles),
+            mTileU(tileU),
+            mTileV(tileV),
+            mImageSize(imageSize),
+            mBlockSize(blockSize),
+            mBandStartY(bandStartY),
+            mBandEndY(bandEndY),
+            mpTextureRows(textureRows),
+            mpMaskRows(maskRows),
+            mIsImageMissing(false)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                BakeBlock(blockId);
+            }
+        }
+
+        bool IsImageMissing(void) const
+        {
+            return mIsImageMissing;
+        }
+
+    private:
+        void BakeBlock(GPP::Int blockId)
+        {
+            // The block is baked with a gutter wide margin, so the expanded pixels near its border match those
+            // of the neighbor blocks
+            GPP::Int coreStartX = blockId * mBlockSize;
+            GPP::Int coreEndX = std::min(mImageSize, coreStartX + mBlockSize);
+            GPP::Int startX = std::max(GPP::Int(0), coreStartX - gBakeGutter);
+            GPP::Int endX = std::min(mImageSize, coreEndX + gBakeGutter);
+            GPP::Int startY = std::max(GPP::Int(0), mBandStartY - gBakeGutter);
+            GPP::Int endY = std::min(mImageSize, mBandEndY + gBakeGutter);
+            GPP::Int width = endX - startX;
+            GPP::Int height = endY - startY;
+            std::vector<GPP::Real> colors(width * height * 3, 0);
+            std::vector<GPP::Int> pixelTypes(width * height, 0);
+            std::vector<cv::Mat> images(mImageCount);
+
+            const std::vector<GPP::Int>& triangleIds = mpBlockTriangles->at(blockId);
+            for (std::vector<GPP::Int>::const_iterator triangleItr = triangleIds.begin(); triangleItr != triangleIds.end(); ++triangleItr)
+            {
+                GPP::Int fid = *triangleItr;
+                GPP::Real pixelX[3], pixelY[3];
+                for (int cornerId = 0; cornerId < 3; cornerId++)
+                {
+                    GPP::Int baseIndex = (fid * 3 + cornerId) * 2;
+                    pixelX[cornerId] = (mpTexCoords->at(baseIndex) - mTileU) * mImageSize - 0.5;
+                    pixelY[cornerId] = (mpTexCoords->at(baseIndex + 1) - mTileV) * mImageSize - 0.5;
+                }
+                GPP::Real area = (pixelX[1] - pixelX[0]) * (pixelY[2] - pixelY[0]) - (pixelX[2] - pixelX[0]) * (pixelY[1] - pixelY[0]);
+                if (fabs(area) < GPP::REAL_TOL)
+                {
+                    continue;
+                }
+                GPP::Int minX = std::max(startX, GPP::Int(ceil(std::min(pixelX[0], std::min(pixelX[1], pixelX[2])))));
+                GPP::Int maxX = std::min(endX - 1, GPP::Int(floor(std::max(pixelX[0], std::max(pixelX[1], pixelX[2])))));
+                GPP::Int minY = std::max(startY, GPP::Int(ceil(std::min(pixelY[0], std::min(pixelY[1], pixelY[2])))));
+                GPP::Int maxY = std::min(endY - 1, GPP::Int(floor(std::max(pixelY[0], std::max(pixelY[1], pixelY[2])))));
+                for (GPP::Int y = minY; y <= maxY; y++)
+                {
+                    for (GPP::Int x = minX; x <= maxX; x++)
+                    {
+                        GPP::Int pixelId = (y - startY) * width + (x - startX);
+                        if (pixelTypes.at(pixelId) != 0)
+                        {
+                            continue;
+                        }
+                        GPP::Real weights[3];
+                        for (int cornerId = 0; cornerId < 3; cornerId++)
+                        {
+                            int nextId = (cornerId + 1) % 3;
+                            int lastId = (cornerId + 2) % 3;
+                            weights[cornerId] = ((pixelX[nextId] - x) * (pixelY[lastId] - y) -
+                                (pixelX[lastId] - x) * (pixelY[nextId] - y)) / area;
+                        }
+                        if (weights[0] < -gInsideTolerance || weights[1] < -gInsideTolerance || weights[2] < -gInsideTolerance)
+                        {
+                            continue;
+                        }
+                        pixelTypes.at(pixelId) = ShadePixel(fid, weights, images, &colors.at(pixelId * 3));
+                    }
+                }
+            }
+            ExpandPixels(width, height, colors, pixelTypes);
+
+            GPP::Int maxPixelType = mpCornerColorIds == NULL ? 2 : mImageCount + 2;
+            for (GPP::Int y = mBandStartY; y < mBandEndY; y++)
+            {
+                // Rows of the band are from top to bottom
+                size_t rowOffset = size_t(mBandEndY - 1 - y) * mImageSize * 3;
+                for (GPP::Int x = coreStartX; x < coreEndX; x++)
+                {
+                    GPP::Int pixelId = (y - startY) * width + (x - startX);
+                    size_t offset = rowOffset + x * 3;
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        mpTextureRows->at(offset + channel) = ToColorValue(colors.at(pixelId * 3 + channel));
+                    }
+                    GPP::Int pixelType = pixelTypes.at(pixelId);
+                    if (mpMaskRows == NULL)
+                    {
+                        continue;
+                    }
+                    if (pixelType < 3)
+                    {
+                        mpMaskRows->at(offset) = 0;
+                        mpMaskRows->at(offset + 1) = 0;
+                        mpMaskRows->at(offset + 2) = 0;
+                        mpMaskRows->at(offset + pixelType) = 255;
+                    }
+                    else
+                    {
+                        unsigned char gray = (unsigned char)(pixelType * 255 / maxPixelType);
+                        mpMaskRows->at(offset) = gray;
+                        mpMaskRows->at(offset + 1) = gray;
+                        mpMaskRows->at(offset + 2) = gray;
+                    }
+                }
+            }
+        }
+
+        // Return the pixel type
+        GPP::Int ShadePixel(GPP::Int fid, const GPP::Real weights[3], std::vector<cv::Mat>& images, GPP::Real* bgr)
+        {
+            GPP::Int cornerBaseId = fid * 3;
+            if (mpCornerColorIds == NULL)
+            {
+                for (int cornerId = 0; cornerId < 3; cornerId++)
+                {
+                    const GPP::Color4& color = mpCornerColors->at(cornerBaseId + cornerId);
+                    bgr[0] += color[2] * weights[cornerId];
+                    bgr[1] += color[1] * weights[cornerId];
+                    bgr[2] += color[0] * weights[cornerId];
+                }
+                return 2;
+            }
+            const GPP::ImageColorId* colorIds = &mpCornerColorIds->at(cornerBaseId);
+            for (int cornerId = 0; cornerId < 3; cornerId++)
+            {
+                GPP::Int imageId = colorIds[cornerId].GetImageIndex();
+                if (images.at(imageId).data == NULL)
+                {
+                    images.at(imageId) = mpImageCache->Acquire(imageId);
+                    if (images.at(imageId).data == NULL)
+                    {
+                        mIsImageMissing = true;
+                        return 0;
+                    }
+                }
+            }
+            GPP::Int imageId = colorIds[0].GetImageIndex();
+            if (colorIds[1].GetImageIndex() == imageId && colorIds[2].GetImageIndex() == imageId)
+            {
+                GPP::Real x = 0;
+                GPP::Real y = 0;
+                for (int cornerId = 0; cornerId < 3; cornerId++)
+                {
+                    x += colorIds[cornerId].GetLocalX() * weights[cornerId];
+                    y += colorIds[cornerId].GetLocalY() * weights[cornerId];
+                }
+                SampleImage(images.at(imageId), x, y, bgr);
+                return imageId + 3;
+            }
+            // Corners from different images: blend their colors
+            for (int cornerId = 0; cornerId < 3; cornerId++)
+            {
+                GPP::Real cornerBgr[3];
+                SampleImage(images.at(colorIds[cornerId].GetImageIndex()), colorIds[cornerId].GetLocalX(),
+                    colorIds[cornerId].GetLocalY(), cornerBgr);
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    bgr[channel] += cornerBgr[channel] * weights[cornerId];
+                }
+            }
+            return 2;
+        }
+
+        // Every pass fills the empty pixels next to filled ones by the average of their filled neighbors
+        void ExpandPixels(GPP::Int width, GPP::Int height, std::vector<GPP::Real>& colors, std::vector<GPP::Int>& pixelTypes) const
+        {
+            std::vector<GPP::Int> expandIds;
+            std::vector<GPP::Real> expandColors;
+            for (GPP::Int passId = 0; passId < gBakeGutter; passId++)
+            {
+                expandIds.clear();
+                expandColors.clear();
+                for (GPP::Int y = 0; y < height; y++)
+                {
+                    for (GPP::Int x = 0; x < width; x++)
+                    {
+                        if (pixelTypes.at(y * width + x) != 0)
+                        {
+                            continue;
+                        }
+                        GPP::Real bgr[3] = {0, 0, 0};
+                        int neighborCount = 0;
+                        for (GPP::Int neighborY = std::max(GPP::Int(0), y - 1); neighborY <= std::min(height - 1, y + 1); neighborY++)
+                        {
+                            for (GPP::Int neighborX = std::max(GPP::Int(0), x - 1); neighborX <= std::min(width - 1, x + 1); neighborX++)
+                            {
+                                GPP::Int neighborId = neighborY * width + neighborX;
+                                if (pixelTypes.at(neighborId) == 0)
+                                {
+                                    continue;
+                                }
+                                for (int channel = 0; channel < 3; channel++)
+                                {
+                                    bgr[channel] += colors.at(neighborId * 3 + channel);
+                                }
+                                neighborCount++;
+                            }
+                        }
+                        if (neighborCount == 0)
+                        {
+                            continue;
+                        }
+                        expandIds.push_back(y * width + x);
+                        for (int channel = 0; channel < 3; channel++)
+                        {
+                            expandColors.push_back(bgr[channel] / neighborCount);
+                        }
+                    }
+                }
+                if (expandIds.empty())
+                {
+                    break;
+                }
+                for (size_t expandId = 0; expandId < expandIds.size(); expandId++)
+                {
+                    GPP::Int pixelId = expandIds.at(expandId);
+                    pixelTypes.at(pixelId) = 1;
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        colors.at(pixelId * 3 + channel) = expandColors.at(expandId * 3 + channel);
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpTexCoords;
+        const std::vector<GPP::Color4>* mpCornerColors;
+        const std::vector<GPP::ImageColorId>* mpCornerColorIds;
+        RefImageCache* mpImageCache;
+        GPP::Int mImageCount;
+        const std::vector<std::vector<GPP::Int> >* mpBlockTriangles;
+        GPP::Int mTileU;
+        GPP::Int mTileV;
+        GPP::Int mImageSize;
+        GPP::Int mBlockSize;
+        GPP::Int mBandStartY;
+        GPP::Int mBandEndY;
+        std::vector<unsigned char>* mpTextureRows;
+        std::vector<unsigned char>* mpMaskRows;
+        volatile bool mIsImageMissing;
+    };
+
+    TextureBaker::TextureBaker() :
+        mImageSize(4096),
+        mBlockSize(gBakeBlockSize),
+        mImageCacheSize(gRefImageCacheSize),
+        mpCornerColors(NULL),
+        mpCornerColorIds(NULL),
+        mpImageCache(NULL),
+        mTextureFiles(),
+        mPreviewSize(gDefaultPreviewSize),
+        mPreviewImageSize(0),
+        mPreviewPixels()
+    {
+    }
+
+    TextureBaker::~TextureBaker()
+    {
+        GPPFREEPOINTER(mpImageCache);
+    }
+
+    void TextureBaker::SetImageSize(GPP::Int imageSize)
+    {
+        mImageSize = imageSize;
+    }
+
+    GPP::Int TextureBaker::GetImageSize() const
+    {
+        return mImageSize;
+    }
+
+    void TextureBaker::SetBlockSize(GPP::Int blockSize)
+    {
+        mBlockSize = blockSize;
+    }
+
+    void TextureBaker::SetImageCacheSize(GPP::ULongInt cacheSize)
+    {
+        mImageCacheSize = cacheSize;
+    }
+
+    void TextureBaker::SetPreviewSize(GPP::Int previewSize)
+    {
+        mPreviewSize = previewSize;
+    }
+
+    GPP::ErrorCode TextureBaker::BakeCornerColors(const std::vector<GPP::Real>& texCoords, const std::vector<GPP::Color4>& cornerColors,
+        const std::string& textureFile, const std::string& maskFile)
+    {
+        if (cornerColors.size() * 2 != texCoords.size())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mpCornerColors = &cornerColors;
+        GPP::ErrorCode res = Bake(texCoords, textureFile, maskFile);
+        mpCornerColors = NULL;
+        return res;
+    }
+
+    GPP::ErrorCode TextureBaker::BakeRefImages(const std::vector<GPP::Real>& texCoords, const std::vector<GPP::ImageColorId>& cornerColorIds,
+        const std::vector<std::string>& refImageFiles, const std::string& textureFile, const std::string& maskFile)
+    {
+        if (cornerColorIds.size() * 2 != texCoords.size() || refImageFiles.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int imageCount = refImageFiles.size();
+        for (std::vector<GPP::ImageColorId>::const_iterator colorIdItr = cornerColorIds.begin(); colorIdItr != cornerColorIds.end(); ++colorIdItr)
+        {
+            if (colorIdItr->GetImageIndex() < 0 || colorIdItr->GetImageIndex() >= imageCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+        }
+        mpCornerColorIds = &cornerColorIds;
+        mpImageCache = new RefImageCache(&refImageFiles, mImageCacheSize);
+        GPP::ErrorCode res = Bake(texCoords, textureFile, maskFile);
+        GPPFREEPOINTER(mpImageCache);
+        mpCornerColorIds = NULL;
+        return res;
+    }
+
+    const std::vector<std::string>& TextureBaker::GetTextureFiles() const
+    {
+        return mTextureFiles;
+    }
+
+    const std::vector<unsigned char>& TextureBaker::GetPreviewPixels() const
+    {
+        return mPreviewPixels;
+    }
+
+    GPP::Int TextureBaker::GetPreviewImageSize() const
+    {
+        return mPreviewImageSize;
+    }
+
+    GPP::ErrorCode TextureBaker::Bake(const std::vector<GPP::Real>& texCoords, const std::string& textureFile, const std::string& maskFile)
+    {
+        mTextureFiles.clear();
+        mPreviewImageSize = 0;
+        std::vector<unsigned char>().swap(mPreviewPixels);
+        GPP::Int triangleCount = texCoords.size() / 6;
+        if (triangleCount == 0 || texCoords.size() % 6 != 0 || mImageSize <= 0 || mBlockSize <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+
+        // A triangle belongs to the tile of its center
+        std::map<GPP::Int, std::vector<GPP::Int> > tileTriangles;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            GPP::Real centerU = (texCoords.at(fid * 6) + texCoords.at(fid * 6 + 2) + texCoords.at(fid * 6 + 4)) / 3.0;
+            GPP::Real centerV = (texCoords.at(fid * 6 + 1) + texCoords.at(fid * 6 + 3) + texCoords.at(fid * 6 + 5)) / 3.0;
+            GPP::Int tileU = std::min(gUdimColumnCount - 1, std::max(GPP::Int(0), GPP::Int(floor(centerU))));
+            GPP::Int tileV = std::max(GPP::Int(0), GPP::Int(floor(centerV)));
+            tileTriangles[1001 + tileU + tileV * gUdimColumnCount].push_back(fid);
+        }
+        bool isMultiTile = tileTriangles.size() > 1 || tileTriangles.begin()->first != 1001;
+        bool isStreamed = mImageSize > gMaxEncodedImageSize;
+        GPP::Int imageCount = mpImageCache == NULL ? 0 : mpImageCache->GetImageCount();
+        GPP::Int blockCount = (mImageSize + mBlockSize - 1) / mBlockSize;
+        GPP::Real pixelMargin = gBakeGutter + 1;
+
+        for (std::map<GPP::Int, std::vector<GPP::Int> >::iterator tileItr = tileTriangles.begin(); tileItr != tileTriangles.end(); ++tileItr)
+        {
+            GPP::Int udim = tileItr->first;
+            GPP::Int tileU = (udim - 1001) % gUdimColumnCount;
+            GPP::Int tileV = (udim - 1001) / gUdimColumnCount;
+
+            // Triangles of each block, in triangle order so the result does not depend on the thread count
+            std::vector<std::vector<std::vector<GPP::Int> > > blockTriangles(blockCount, std::vector<std::vector<GPP::Int> >(blockCount));
+            const std::vector<GPP::Int>& triangleIds = tileItr->second;
+            for (std::vector<GPP::Int>::const_iterator triangleItr = triangleIds.begin(); triangleItr != triangleIds.end(); ++triangleItr)
+            {
+                GPP::Int fid = *triangleItr;
+                GPP::Real minX = GPP::REAL_LARGE, maxX = -GPP::REAL_LARGE, minY = GPP::REAL_LARGE, maxY = -GPP::REAL_LARGE;
+                for (int cornerId = 0; cornerId < 3; cornerId++)
+                {
+                    GPP::Real pixelX = (texCoords.at(fid * 6 + cornerId * 2) - tileU) * mImageSize - 0.5;
+                    GPP::Real pixelY = (texCoords.at(fid * 6 + cornerId * 2 + 1) - tileV) * mImageSize - 0.5;
+                    minX = std::min(minX, pixelX);
+                    maxX = std::max(maxX, pixelX);
+                    minY = std::min(minY, pixelY);
+                    maxY = std::max(maxY, pixelY);
+                }
+                if (maxX < -pixelMargin || maxY < -pixelMargin || minX > mImageSize + pixelMargin || minY > mImageSize + pixelMargin)
+                {
+                    continue;
+                }
+                GPP::Int startBlockX = std::max(GPP::Int(0), GPP::Int(floor((minX - pixelMargin) / mBlockSize)));
+                GPP::Int endBlockX = std::min(blockCount - 1, GPP::Int(floor((maxX + pixelMargin) / mBlockSize)));
+                GPP::Int startBlockY = std::max(GPP::Int(0), GPP::Int(floor((minY - pixelMargin) / mBlockSize)));
+                GPP::Int endBlockY = std::min(blockCount - 1, GPP::Int(floor((maxY + pixelMargin) / mBlockSize)));
+                for (GPP::Int blockY = startBlockY; blockY <= endBlockY; blockY++)
+                {
+                    for (GPP::Int blockX = startBlockX; blockX <= endBlockX; blockX++)
+                    {
+                        blockTriangles.at(blockY).at(blockX).push_back(fid);
+                    }
+                }
+            }
+
+            std::string tileTextureFile = GetTileFileName(textureFile, udim, isMultiTile, isStreamed);
+            BandImageWriter textureWriter;
+            BandImageWriter maskWriter;
+            if (textureWriter.Open(tileTextureFile, mImageSize, mImageSize, isStreamed) == false)
+            {
+                ErrorLog << "TextureBaker::Bake: failed to open " << tileTextureFile << std::endl;
+                return GPP_INVALID_INPUT;
+            }
+            if (!maskFile.empty() && maskWriter.Open(GetTileFileName(maskFile, udim, isMultiTile, isStreamed), mImageSize, mImageSize, isStreamed) == false)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            std::vector<unsigned char> textureRows;
+            std::vector<unsigned char> maskRows;
+            // Only the first tile is previewed
+            BandImageShrinker* previewShrinker = NULL;
+            if (mTextureFiles.empty())
+            {
+                previewShrinker = new BandImageShrinker(mImageSize, mPreviewSize);
+            }
+            // Bands from the top of the image, which is the largest v
+            for (GPP::Int blockY = blockCount - 1; blockY >= 0; blockY--)
+            {
+                GPP::Int bandStartY = blockY * mBlockSize;
+                GPP::Int bandEndY = std::min(mImageSize, bandStartY + mBlockSize);
+                textureRows.resize(size_t(bandEndY - bandStartY) * mImageSize * 3);
+                if (!maskFile.empty())
+                {
+                    maskRows.resize(textureRows.size());
+                }
+                BakeBlockTask bakeTask(&texCoords, mpCornerColors, mpCornerColorIds, mpImageCache, imageCount, &(blockTriangles.at(blockY)),
+                    tileU, tileV, mImageSize, mBlockSize, bandStartY, bandEndY, &textureRows, maskFile.empty() ? NULL : &maskRows);
+                MagicCore::ThreadPool::Get()->ParallelFor(blockCount, &bakeTask, 1);
+                if (bakeTask.IsImageMissing())
+                {
+                    GPPFREEPOINTER(previewShrinker);
+                    return GPP_INVALID_INPUT;
+                }
+                if (textureWriter.WriteRows(textureRows, bandEndY - bandStartY) == false ||
+                    (!maskFile.empty() && maskWriter.WriteRows(maskRows, bandEndY - bandStartY) == false))
+                {
+                    ErrorLog << "TextureBaker::Bake: failed to write " << tileTextureFile << std::endl;
+                    GPPFREEPOINTER(previewShrinker);
+                    return GPP_INVALID_INPUT;
+                }
+                if (previewShrinker != NULL)
+                {
+                    previewShrinker->AddRows(textureRows, bandEndY - bandStartY);
+                }
+                // Triangles of the finished band are not needed any more
+                std::vector<std::vector<GPP::Int> >().swap(blockTriangles.at(blockY));
+            }
+            if (textureWriter.Close() == false || (!maskFile.empty() && maskWriter.Close() == false))
+            {
+                ErrorLog << "TextureBaker::Bake: failed to save " << tileTextureFile << std::endl;
+                GPPFREEPOINTER(previewShrinker);
+                return GPP_INVALID_INPUT;
+            }
+            if (previewShrinker != NULL)
+            {
+                mPreviewImageSize = previewShrinker->GetShrunkSize();
+                previewShrinker->SwapPixels(mPreviewPixels);
+                GPPFREEPOINTER(previewShrinker);
+            }
+            mTextureFiles.push_back(tileTextureFile);
+            InfoLog << "TextureBaker::Bake: " << tileTextureFile << " " << mImageSize << "x" << mImageSize << std::endl;
+        }
+        return GPP_NO_ERROR;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+#include <string>
+
+namespace MagicApp
+{
+    class RefImageCache;
+
+    // Bakes the texture image of triangle corner colors block by block on the workers of ThreadPool.
+    // Texture coordinates in [k, k + 1) x [l, l + 1) belong to the UDIM tile 1001 + k + 10 * l, and each tile is
+    // written to its own file. The image is written band by band, so tiles larger than gMaxEncodedImageSize are
+    // streamed to a ppm file and never held in memory.
+    // A box filtered preview of the first tile is kept in memory, so the caller could show it without decoding the tile.
+    // Pixel types of the mask image follow GPP::TextureImage: 0 -- unfilled, 1 -- expanded, 2 -- interpolated by
+    // corner colors, >= 3 -- sampled from the reference image (type - 3).
+    class TextureBaker
+    {
+    public:
+        TextureBaker();
+        ~TextureBaker();
+
+        // Width and height of each tile
+        void SetImageSize(GPP::Int imageSize);
+        GPP::Int GetImageSize(void) const;
+        // Pixels of a work block
+        void SetBlockSize(GPP::Int blockSize);
+        // Decoded reference images kept in memory
+        void SetImageCacheSize(GPP::ULongInt cacheSize);
+        // The preview is shrunk by an integer factor to at most previewSize
+        void SetPreviewSize(GPP::Int previewSize);
+
+        // texCoords: two values per triangle corner, cornerColors: one color per triangle corner
+        // maskFile could be empty
+        GPP::ErrorCode BakeCornerColors(const std::vector<GPP::Real>& texCoords, const std::vector<GPP::Color4>& cornerColors,
+            const std::string& textureFile, const std::string& maskFile);
+        // cornerColorIds: one per triangle corner, the same meaning as GPP::TextureImage::CreateTextureImageByRefImages
+        GPP::ErrorCode BakeRefImages(const std::vector<GPP::Real>& texCoords, const std::vector<GPP::ImageColorId>& cornerColorIds,
+            const std::vector<std::string>& refImageFiles, const std::string& textureFile, const std::string& maskFile);
+
+        // Files written by the last bake, tile 1001 first if it is used
+        const std::vector<std::string>& GetTextureFiles(void) const;
+        // Preview of the first tile of the last bake, three channels in bgr order from the top row
+        const std::vector<unsigned char>& GetPreviewPixels(void) const;
+        // Width and height of the preview, 0 if there is none
+        GPP::Int GetPreviewImageSize(void) const;
+
+    private:
+        GPP::ErrorCode Bake(const std::vector<GPP::Real>& texCoords, const std::string& textureFile, const std::string& maskFile);
+
+    private:
+        GPP::Int mImageSize;
+        GPP::Int mBlockSize;
+        GPP::ULongInt mImageCacheSize;
+        const std::vector<GPP::Color4>* mpCornerColors;
+        const std::vector<GPP::ImageColorId>* mpCornerColorIds;
+        RefImageCache* mpImageCache;
+        std::vector<std::string> mTextureFiles;
+        GPP::Int mPreviewSize;
+        GPP::Int mPreviewImageSize;
+        std::vector<unsigned char> mPreviewPixels;
+    };
+}
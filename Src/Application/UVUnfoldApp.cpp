@@ -4,11 +4,13 @@
 #include "UVUnfoldAppUI.h"
 #include "AppManager.h"
 #include "ModelManager.h"
+#include "ChartUnfolder.h"
 #include "../Common/LogSystem.h"
 #include "../Common/ToolKit.h"
 #include "../Common/ViewTool.h"
 #include "../Common/PickTool.h"
 #include "../Common/RenderSystem.h"
+#include "../Common/ThreadPool.h"
 #include "GPP.h"
 
 namespace MagicApp
@@ -24,6 +26,42 @@ namespace MagicApp
         return 1;
     }
 
+    class TriangleTexcoordTask : public MagicCore::ParallelTask
+    {
+    public:
+        TriangleTexcoordTask(GPP::TriMesh* triMesh, const std::vector<GPP::Real>* texCoords, const std::vector<GPP::Int>* faceTexIds) :
+            mpTriMesh(triMesh),
+            mpTexCoords(texCoords),
+            mpFaceTexIds(faceTexIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int fid = startId; fid < endId; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    GPP::Int tid = mpFaceTexIds->at(fid * 3 + localId);
+                    mpTriMesh->SetTriangleTexcoord(fid, localId, GPP::Vector3(mpTexCoords->at(tid * 2), mpTexCoords->at(tid * 2 + 1), 0));
+                }
+            }
+        }
+
+    private:
+        GPP::TriMesh* mpTriMesh;
+        const std::vector<GPP::Real>* mpTexCoords;
+        const std::vector<GPP::Int>* mpFaceTexIds;
+    };
+
+    // Every triangle writes its own corners, so triangles are independent
+    static void SetTriangleTexcoords(GPP::TriMesh* triMesh, const std::vector<GPP::Real>& texCoords, const std::vector<GPP::Int>& faceTexIds)
+    {
+        triMesh->SetHasTriangleTexCoord(true);
+        TriangleTexcoordTask texcoordTask(triMesh, &texCoords, &faceTexIds);
+        MagicCore::ThreadPool::Get()->ParallelFor(faceTexIds.size() / 3, &texcoordTask, 4096);
+    }
+
     UVUnfoldApp::UVUnfoldApp() :
         mpUI(NULL),
         mpImageFrameMesh(NULL),
@@ -44,7 +82,8 @@ namespace MagicApp
         mInitChartCount(1),
         mSnapIds(),
         mTargetVertexCount(0),
-        mIsCutLineAccurate(false)
+        mIsCutLineAccurate(false),
+        mpChartUnfolder(NULL)
     {
     }
 
@@ -54,6 +93,7 @@ namespace MagicApp
         GPPFREEPOINTER(mpImageFrameMesh);
         GPPFREEPOINTER(mpViewTool);
         GPPFREEPOINTER(mpPickTool);
+        GPPFREEPOINTER(mpChartUnfolder);
     }
 
     void UVUnfoldApp::ClearData()
@@ -65,6 +105,7 @@ namespace MagicApp
         mDisplayMode = TRIMESH_SOLID;
         mDistortionImage.release();
         ClearSplitData();
+        GPPFREEPOINTER(mpChartUnfolder);
     }
 
     void UVUnfoldApp::ClearSplitData()
@@ -82,7 +123,7 @@ namespace MagicApp
     {
         if (mIsCommandInProgress)
         {
-            MessageBox(NULL, "ȴǰִ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请等待当前命令执行完", "温馨提示", MB_OK);
             return false;
         }
         return true;
@@ -105,6 +146,10 @@ namespace MagicApp
         {
             mpUI = new UVUnfoldAppUI;
         }
+        if (mpChartUnfolder == NULL)
+        {
+            mpChartUnfolder = new ChartUnfolder;
+        }
         mpUI->Setup();
         SetupScene();
         UpdateDisplay();
@@ -203,7 +248,7 @@ namespace MagicApp
                             sectionVertexIds, false, pathCoords, distance, &pathInfos, 0.5);
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                             return true;
                         }
                         int startId = 1;
@@ -229,7 +274,7 @@ namespace MagicApp
                             pathVertexIds, distance);
                         if (res != GPP_NO_ERROR)
                         {
-                            MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                            MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                             return true;
                         }
                         int startId = 1;
@@ -274,7 +319,7 @@ namespace MagicApp
             mpImageFrameMesh = GPP::Parser::ImportTriMesh("../../Media/UVUnfoldApp/ImageMesh.obj");
             if (mpImageFrameMesh == NULL)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "纹理网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             mpImageFrameMesh->UpdateNormal();
@@ -284,7 +329,7 @@ namespace MagicApp
         mDistortionImage = cv::imread("../../Media/UVUnfoldApp/grid.png");
         if (mDistortionImage.data == NULL)
         {
-            MessageBox(NULL, "ͼƬʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "纹理图片打开失败", "温馨提示", MB_OK);
         }
         InitTriMeshTexture();
 
@@ -332,7 +377,7 @@ namespace MagicApp
             ModelManager::Get()->ClearPointCloud();
             if (ModelManager::Get()->ImportMesh(fileName) == false)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格导入失败", "温馨提示", MB_OK);
                 return;
             }
             GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
@@ -344,6 +389,10 @@ namespace MagicApp
             mpPickTool->SetPickParameter(MagicCore::PM_POINT, true, NULL, triMesh, "ModelNode");
             // Clear data
             ClearSplitData();
+            if (mpChartUnfolder)
+            {
+                mpChartUnfolder->Clear();
+            }
             InsertHolesToSnapIds();
             UpdateMarkDisplay();
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
@@ -354,7 +403,7 @@ namespace MagicApp
     {
         if (mCurPointsOnVertex.size() > 0 && mCurPointsOnEdge.size() > 0)
         {
-            MessageBox(NULL, "Ϣд", "ܰʾ", MB_OK);
+            MessageBox(NULL, "割线信息有错", "温馨提示", MB_OK);
             return;
         }
         if (mCurPointsOnEdge.size() > 0)
@@ -367,10 +416,11 @@ namespace MagicApp
             mCurPointsOnEdge.clear();
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߲Խ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "割线不能自交", "温馨提示", MB_OK);
                 return;
             }
             triMesh->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(triMesh);
             mCutLineList.push_back(newSplitLineIds);
             mpUI->SetMeshInfo(triMesh->GetVertexCount(), triMesh->GetTriangleCount());
             if (mSnapIds.empty())
@@ -430,7 +480,7 @@ namespace MagicApp
                 pathCoords, distance, &pathInfos, 0.5);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -465,7 +515,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -522,7 +572,7 @@ namespace MagicApp
                 pathCoords, distance, &pathInfos, 0.5);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -545,7 +595,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             int startId = 1;
@@ -614,7 +664,7 @@ namespace MagicApp
                 pathCoords, distance, &pathInfos, 0.5);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             std::vector<GPP::PointOnEdge> newPonitsOnEdge;
@@ -645,7 +695,7 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::MeasureMesh::ComputeApproximateGeodesics(triMesh, sectionVertexIds, false, pathVertexIds, distance);
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "测量失败", "温馨提示", MB_OK);
                 return;
             }
             for (int pvid = 0; pvid < pathVertexIds.size(); pvid++)
@@ -737,7 +787,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
 #if MAKEDUMPFILE
@@ -746,12 +796,12 @@ namespace MagicApp
         GPP::ErrorCode res = GPP::OptimiseCurve::SmoothCurveOnMesh(triMesh, mCurPointsOnVertex, false, GPP::ONE_RADIAN * 60, 0.2, 10);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Żʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "割线优化失败", "温馨提示", MB_OK);
             return;
         }
         mCurMarkCoords.clear();
@@ -773,19 +823,19 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         std::vector<std::vector<GPP::Int> > splitLines;
         GPP::ErrorCode res = GPP::SplitMesh::GenerateAtlasSplitLines(triMesh, splitChartCount, splitLines);
         if (res == GPP_API_IS_NOT_AVAILABLE)
         {
-            MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+            MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
             MagicCore::ToolKit::Get()->SetAppRunning(false);
         }
         if (res != GPP_NO_ERROR)
         {
-            MessageBox(NULL, "Զʧ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "自动割线失败", "温馨提示", MB_OK);
             return;
         }
         ClearSplitData();
@@ -840,7 +890,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -852,142 +902,65 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
             }
             GenerateSplitMesh();
-            bool isMultiPatchCase = false;
-            // Generate fixed vertex
-            std::vector<std::vector<GPP::Int> > holeIds;
-            GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
-            if (res == GPP_API_IS_NOT_AVAILABLE)
+            // Charts which are not touched by the new cut lines keep their last solution, and charts cut from
+            // a previous chart are warm started from its texture coordinates
+            std::vector<GPP::Real> texCoords;
+            std::vector<GPP::Int> faceTexIds;
+            mIsCommandInProgress = true;
+#if MAKEDUMPFILE
+            GPP::DumpOnce();
+#endif
+            GPP::ErrorCode res = mpChartUnfolder->Init(triMesh);
+            if (res == GPP_NO_ERROR)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                MagicCore::ToolKit::Get()->SetAppRunning(false);
+                res = mpChartUnfolder->UnfoldCharts(10);
             }
-            if (res != GPP_NO_ERROR)
+            if (res == GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߽ʧ", "ܰʾ", MB_OK);
-                return;
+                res = mpChartUnfolder->PackCharts(texCoords, faceTexIds);
             }
-            if (holeIds.empty())
+            mIsCommandInProgress = false;
+            if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                isMultiPatchCase = true;
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
+                MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
-            if (!isMultiPatchCase)
+            if (res != GPP_NO_ERROR)
             {
-                // Is single connected region
-                std::vector<GPP::Real> isolation;
-                GPP::Int uvVertexCount = triMesh->GetVertexCount();
-                res = GPP::ConsolidateMesh::CalculateIsolation(triMesh, &isolation);
-                for (GPP::Int vid = 0; vid < uvVertexCount; vid++)
-                {
-                    if (isolation.at(vid) < 1)
-                    {
-                        isMultiPatchCase = true;
-                        break;
-                    }
-                }
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "չʧܣͨʧ", "ܰʾ", MB_OK);
-                    return;
-                }
-                if (!isMultiPatchCase)
-                {
-                    std::vector<GPP::Int> fixedVertexIndices(2);
-                    std::vector<GPP::Real> fixedVertexCoords(4);
-                    fixedVertexIndices.at(0) = holeIds.at(0).at(0);
-                    fixedVertexIndices.at(1) = holeIds.at(0).at(holeIds.at(0).size() / 2);
-                    fixedVertexCoords.at(0) = -1.0;
-                    fixedVertexCoords.at(1) = -1.0;
-                    fixedVertexCoords.at(2) = 1.0;
-                    fixedVertexCoords.at(3) = 1.0;
-                    std::vector<GPP::Real> texCoords;
-                    mIsCommandInProgress = true;
-#if MAKEDUMPFILE
-                    GPP::DumpOnce();
-#endif
-                    res = GPP::UnfoldMesh::ConformalMap(triMesh, &fixedVertexIndices, &fixedVertexCoords, &texCoords);
-                    if (res == GPP_NO_ERROR)
-                    {
-#if MAKEDUMPFILE
-                        GPP::DumpOnce();
-#endif
-                        res = GPP::UnfoldMesh::OptimizeIsometric(triMesh, &texCoords, 10, NULL);
-                    }
-                    mIsCommandInProgress = false;
-                    if (res == GPP_API_IS_NOT_AVAILABLE)
-                    {
-                        MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                        MagicCore::ToolKit::Get()->SetAppRunning(false);
-                    }
-                    if (res != GPP_NO_ERROR)
-                    {
-                        MessageBox(NULL, "չʧ", "ܰʾ", MB_OK);
-                        return;
-                    }
-                    UnifyTextureCoords(texCoords, 0.9);
-                    triMesh->SetHasVertexTexCoord(true);
-                    GPP::Int vertexCount = triMesh->GetVertexCount();
-                    for (GPP::Int vid = 0; vid < vertexCount; vid++)
-                    {
-                        triMesh->SetVertexTexcoord(vid, GPP::Vector3(texCoords.at(vid * 2), texCoords.at(vid * 2 + 1), 0));
-                    }
-                    triMesh->SetHasTriangleTexCoord(true);
-                    GPP::Int faceCount = triMesh->GetTriangleCount();
-                    int vertexIds[3] = {-1};
-                    for (int fid = 0; fid < faceCount; fid++)
-                    {
-                        triMesh->GetTriangleVertexIds(fid, vertexIds);
-                        for (int lid = 0; lid < 3; lid++)
-                        {
-                            triMesh->SetTriangleTexcoord(fid, lid, triMesh->GetVertexTexcoord(vertexIds[lid]));
-                        }
-                    }
-                }
+                mpChartUnfolder->Clear();
+                MessageBox(NULL, "网格展开失败", "温馨提示", MB_OK);
+                return;
             }
-            if (isMultiPatchCase)
+            UnifyTextureCoords(texCoords, 0.9);
+            GPP::Int vertexCount = triMesh->GetVertexCount();
+            if (texCoords.size() == vertexCount * 2)
             {
-                std::vector<GPP::Real> texCoords;
-                std::vector<GPP::Int> faceTexIds;
-                mIsCommandInProgress = true;
-                GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, 1, &texCoords, &faceTexIds, false, false, false);
-                mIsCommandInProgress = false;
-                if (res == GPP_API_IS_NOT_AVAILABLE)
-                {
-                    MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
-                    MagicCore::ToolKit::Get()->SetAppRunning(false);
-                }
-                if (res != GPP_NO_ERROR)
-                {
-                    MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
-                    return;
-                }
-                UnifyTextureCoords(texCoords, 0.9);
-                triMesh->SetHasTriangleTexCoord(true);
-                int uvFaceCount = faceTexIds.size() / 3;
-                for (int fid = 0; fid < uvFaceCount; fid++)
+                // A single disk chart: every vertex has one texture coordinate
+                triMesh->SetHasVertexTexCoord(true);
+                GPP::Int faceCount = triMesh->GetTriangleCount();
+                GPP::Int vertexIds[3] = {-1};
+                for (GPP::Int fid = 0; fid < faceCount; fid++)
                 {
+                    triMesh->GetTriangleVertexIds(fid, vertexIds);
                     for (int localId = 0; localId < 3; localId++)
                     {
                         GPP::Int tid = faceTexIds.at(fid * 3 + localId);
-                        triMesh->SetTriangleTexcoord(fid, localId, GPP::Vector3(texCoords.at(tid * 2), texCoords.at(tid * 2 + 1), 0));
+                        triMesh->SetVertexTexcoord(vertexIds[localId], GPP::Vector3(texCoords.at(tid * 2), texCoords.at(tid * 2 + 1), 0));
                     }
                 }
             }
+            SetTriangleTexcoords(triMesh, texCoords, faceTexIds);
             
             mDisplayMode = UVMESH_WIREFRAME;
             mUpdateDisplay = true;
@@ -1004,7 +977,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1016,12 +989,12 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1033,17 +1006,17 @@ namespace MagicApp
             GPP::ErrorCode res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "߽ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "找网格边界失败", "温馨提示", MB_OK);
                 return;
             }
             if (holeIds.empty())
             {
-                MessageBox(NULL, "Ϊͨԭ˽ṹ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格必须为单连通原盘拓扑结构", "温馨提示", MB_OK);
                 return;
             }
 
@@ -1055,18 +1028,18 @@ namespace MagicApp
             {
                 if (isolation.at(vid) < 1)
                 {
-                    MessageBox(NULL, "Ϊͨṹ", "ܰʾ", MB_OK);
+                    MessageBox(NULL, "网格必须为单连通结构", "温馨提示", MB_OK);
                     return;
                 }
             }
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "չʧܣͨʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格连通区域检测失败", "温馨提示", MB_OK);
                 return;
             }
 
@@ -1104,12 +1077,12 @@ namespace MagicApp
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "չʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败", "温馨提示", MB_OK);
                 return;
             }
             UnifyTextureCoords(texCoords, 0.9);
@@ -1146,7 +1119,7 @@ namespace MagicApp
         GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
         if (triMesh == NULL)
         {
-            MessageBox(NULL, "뵼ҪUVչ", "ܰʾ", MB_OK);
+            MessageBox(NULL, "请导入需要UV展开的网格", "温馨提示", MB_OK);
             return;
         }
         if (isSubThread)
@@ -1159,12 +1132,12 @@ namespace MagicApp
         {
             if (GPP::ConsolidateMesh::_IsTriMeshManifold(triMesh) == false)
             {
-                MessageBox(NULL, "չʧܣзνṹ޸", "ܰʾ", MB_OK);
+                MessageBox(NULL, "网格展开失败：网格有非流形结构，请先拓扑修复", "温馨提示", MB_OK);
                 return;
             }
             if (GPP::ConsolidateMesh::_IsGeometryDegenerate(triMesh) == false)
             {
-                if (MessageBox(NULL, "棺˻ΣܵõЧȼ޸Ƿ", "ܰʾ", MB_OKCANCEL) != IDOK)
+                if (MessageBox(NULL, "警告：网格有退化几何，继续计算可能得到无效结果，可以先几何修复，是否继续？", "温馨提示", MB_OKCANCEL) != IDOK)
                 {
                     return;
                 }
@@ -1176,29 +1149,30 @@ namespace MagicApp
 #if MAKEDUMPFILE
             GPP::DumpOnce();
 #endif
-            GPP::ErrorCode res = GPP::UnfoldMesh::GenerateUVAtlas(triMesh, initChartCount, &texCoords, &faceTexIds, true, true, true);
+            // Charts separated by cut lines are unfolded on their own workers
+            ChartUnfolder chartUnfolder;
+            GPP::ErrorCode res = chartUnfolder.Init(triMesh);
+            if (res == GPP_NO_ERROR)
+            {
+                res = chartUnfolder.GenerateChartAtlas(initChartCount, true, true);
+            }
+            if (res == GPP_NO_ERROR)
+            {
+                res = chartUnfolder.PackCharts(texCoords, faceTexIds);
+            }
             mIsCommandInProgress = false;
             if (res == GPP_API_IS_NOT_AVAILABLE)
             {
-                MessageBox(NULL, "ʱ޵ˣӭ򼤻", "ܰʾ", MB_OK);
+                MessageBox(NULL, "软件试用时限到了，欢迎购买激活码", "温馨提示", MB_OK);
                 MagicCore::ToolKit::Get()->SetAppRunning(false);
             }
             if (res != GPP_NO_ERROR)
             {
-                MessageBox(NULL, "UV Atlas ʧ", "ܰʾ", MB_OK);
+                MessageBox(NULL, "UV Atlas 生成失败", "温馨提示", MB_OK);
                 return;
             }
             UnifyTextureCoords(texCoords, 0.9);
-            triMesh->SetHasTriangleTexCoord(true);
-            int uvFaceCount = faceTexIds.size() / 3;
-            for (int fid = 0; fid < uvFaceCount; fid++)
-            {
-                for (int localId = 0; localId < 3; localId++)
-                {
-                    GPP::Int tid = faceTexIds.at(fid * 3 + localId);
-                    triMesh->SetTriangleTexcoord(fid, localId, GPP::Vector3(texCoords.at(tid * 2), texCoords.at(tid * 2 + 1), 0));
-                }
-            }
+            SetTriangleTexcoords(triMesh, texCoords, faceTexIds);
 
             mDisplayMode = UVMESH_WIREFRAME;
             mUpdateDisplay = true;
@@ -1442,6 +1416,7 @@ namespace MagicApp
         {
             GPP::SplitMesh::SplitByLines(ModelManager::Get()->GetMesh(), mCutLineList);
             ModelManager::Get()->GetMesh()->UpdateNormal();
+            ModelManager::Get()->IncreaseMeshGeneration(ModelManager::Get()->GetMesh());
             ClearSplitData();
             InsertHolesToSnapIds();
         }
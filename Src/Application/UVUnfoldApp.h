@@ -21,6 +21,7 @@ namespace MagicCore
 namespace MagicApp
 {
     class UVUnfoldAppUI;
+    class ChartUnfolder;
     class UVUnfoldApp : public AppBase
     {
     public:
@@ -119,5 +120,7 @@ namespace MagicApp
         std::vector<int> mSnapIds;
         int mTargetVertexCount;
         bool mIsCutLineAccurate;
+        // Unfolding session, it keeps the last solution for the next unfolding after cut lines are edited
+        ChartUnfolder* mpChartUnfolder;
     };
 }
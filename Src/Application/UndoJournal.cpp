@@ -0,0 +1,1321 @@
+#include "UndoJournal.h"
+#include "ModelManager.h"
+#include "AttributeChannels.h"
+#include "../Common/LogSystem.h"
+#include <windows.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+namespace MagicApp
+{
+    static const GPP::ULongInt gUndoMemoryBudget = 512 * 1024 * 1024;
+    static const int gUndoMaxRecordCount = 64;
+    static const int gShuffleElementSize = 8;
+    // Shared by the journals of point cloud and mesh, so their spill files never collide
+    static GPP::Int gSpillFileId = 0;
+
+    class PayloadWriter
+    {
+    public:
+        explicit PayloadWriter(std::vector<char>* payload) :
+            mpPayload(payload)
+        {
+        }
+
+        // T should be a scalar like int, char or Real
+        template<class T>
+        void Write(const T& value)
+        {
+            const char* data = reinterpret_cast<const char*>(&value);
+            mpPayload->insert(mpPayload->end(), data, data + sizeof(T));
+        }
+
+        // Classes are written by their coordinates, their memory layout is not ours to assume
+        void Write(const GPP::Vector3& value)
+        {
+            Write(value[0]);
+            Write(value[1]);
+            Write(value[2]);
+        }
+
+        void Write(const GPP::ImageColorId& value)
+        {
+            Write(value.GetImageIndex());
+            Write(value.GetLocalX());
+            Write(value.GetLocalY());
+        }
+
+        template<class T>
+        void WriteArray(const std::vector<T>& values)
+        {
+            Write(GPP::Int(values.size()));
+            for (typename std::vector<T>::const_iterator itr = values.begin(); itr != values.end(); ++itr)
+            {
+                Write(*itr);
+            }
+        }
+
+    private:
+        std::vector<char>* mpPayload;
+    };
+
+    class PayloadReader
+    {
+    public:
+        explicit PayloadReader(const std::vector<char>* payload) :
+            mpPayload(payload),
+            mOffset(0)
+        {
+        }
+
+        template<class T>
+        void Read(T& value)
+        {
+            memcpy(&value, &mpPayload->at(mOffset), sizeof(T));
+            mOffset += sizeof(T);
+        }
+
+        void Read(GPP::Vector3& value)
+        {
+            GPP::Real x, y, z;
+            Read(x);
+            Read(y);
+            Read(z);
+            value = GPP::Vector3(x, y, z);
+        }
+
+        void Read(GPP::ImageColorId& value)
+        {
+            GPP::Int imageIndex, localX, localY;
+            Read(imageIndex);
+            Read(localX);
+            Read(localY);
+            value.Set(imageIndex, localX, localY);
+        }
+
+        template<class T>
+        void ReadArray(std::vector<T>& values)
+        {
+            GPP::Int count = 0;
+            Read(count);
+            values.resize(count);
+            for (GPP::Int vid = 0; vid < count; vid++)
+            {
+                Read(values.at(vid));
+            }
+        }
+
+    private:
+        const std::vector<char>* mpPayload;
+        size_t mOffset;
+    };
+
+    static void SaveSideIds(PayloadWriter& writer)
+    {
+        ModelManager* modelManager = ModelManager::Get();
+        writer.WriteArray(modelManager->GetImageColorIds());
+        writer.WriteArray(modelManager->GetColorIds());
+        writer.WriteArray(modelManager->GetCloudIds());
+        writer.WriteArray(modelManager->GetImageColorIdFlags());
+    }
+
+    static void LoadSideIds(PayloadReader& reader)
+    {
+        ModelManager* modelManager = ModelManager::Get();
+        std::vector<GPP::ImageColorId> imageColorIds;
+        reader.ReadArray(imageColorIds);
+        modelManager->SetImageColorIds(imageColorIds);
+        std::vector<int> ids;
+        reader.ReadArray(ids);
+        modelManager->SetColorIds(ids);
+        reader.ReadArray(ids);
+        modelManager->SetCloudIds(ids);
+        reader.ReadArray(ids);
+        modelManager->SetImageColorIdFlag(ids);
+    }
+
+    static void SavePointCloud(const GPP::PointCloud* pointCloud, PayloadWriter& writer)
+    {
+        GPP::Int pointCount = pointCloud == NULL ? -1 : pointCloud->GetPointCount();
+        writer.Write(pointCount);
+        if (pointCloud == NULL)
+        {
+            return;
+        }
+        char hasNormal = pointCloud->HasNormal() ? 1 : 0;
+        char hasColor = pointCloud->HasColor() ? 1 : 0;
+        writer.Write(hasNormal);
+        writer.Write(hasColor);
+        std::vector<GPP::Vector3> values(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            values[pid] = pointCloud->GetPointCoord(pid);
+        }
+        writer.WriteArray(values);
+        if (hasNormal)
+        {
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                values[pid] = pointCloud->GetPointNormal(pid);
+            }
+            writer.WriteArray(values);
+        }
+        if (hasColor)
+        {
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                values[pid] = pointCloud->GetPointColor(pid);
+            }
+            writer.WriteArray(values);
+        }
+    }
+
+    static GPP::PointCloud* LoadPointCloud(PayloadReader& reader)
+    {
+        GPP::Int pointCount = 0;
+        reader.Read(pointCount);
+        if (pointCount < 0)
+        {
+            return NULL;
+        }
+        char hasNormal = 0;
+        char hasColor = 0;
+        reader.Read(hasNormal);
+        reader.Read(hasColor);
+        GPP::PointCloud* pointCloud = new GPP::PointCloud;
+        std::vector<GPP::Vector3> values;
+        reader.ReadArray(values);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            pointCloud->InsertPoint(values[pid]);
+        }
+        pointCloud->SetHasNormal(hasNormal != 0);
+        if (hasNormal)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCloud->SetPointNormal(pid, values[pid]);
+            }
+        }
+        pointCloud->SetHasColor(hasColor != 0);
+        if (hasColor)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                pointCloud->SetPointColor(pid, values[pid]);
+            }
+        }
+        return pointCloud;
+    }
+
+    static void SaveTriMesh(const GPP::TriMesh* triMesh, PayloadWriter& writer)
+    {
+        GPP::Int vertexCount = triMesh == NULL ? -1 : triMesh->GetVertexCount();
+        writer.Write(vertexCount);
+        if (triMesh == NULL)
+        {
+            return;
+        }
+        GPP::Int triangleCount = triMesh->GetTriangleCount();
+        char hasVertexColor = triMesh->HasVertexColor() ? 1 : 0;
+        char hasVertexTexCoord = triMesh->HasVertexTexCoord() ? 1 : 0;
+        char hasTriangleColor = triMesh->HasTriangleColor() ? 1 : 0;
+        char hasTriangleTexCoord = triMesh->HasTriangleTexCoord() ? 1 : 0;
+        writer.Write(hasVertexColor);
+        writer.Write(hasVertexTexCoord);
+        writer.Write(hasTriangleColor);
+        writer.Write(hasTriangleTexCoord);
+        std::vector<GPP::Vector3> values(vertexCount);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            values[vid] = triMesh->GetVertexCoord(vid);
+        }
+        writer.WriteArray(values);
+        if (hasVertexColor)
+        {
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                values[vid] = triMesh->GetVertexColor(vid);
+            }
+            writer.WriteArray(values);
+        }
+        if (hasVertexTexCoord)
+        {
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                values[vid] = triMesh->GetVertexTexcoord(vid);
+            }
+            writer.WriteArray(values);
+        }
+        std::vector<GPP::Int> triangleVertexIds(triangleCount * 3);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, &triangleVertexIds[fid * 3]);
+        }
+        writer.WriteArray(triangleVertexIds);
+        values.resize(triangleCount * 3);
+        if (hasTriangleColor)
+        {
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    values[fid * 3 + localId] = triMesh->GetTriangleColor(fid, localId);
+                }
+            }
+            writer.WriteArray(values);
+        }
+        if (hasTriangleTexCoord)
+        {
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    values[fid * 3 + localId] = triMesh->GetTriangleTexcoord(fid, localId);
+                }
+            }
+            writer.WriteArray(values);
+        }
+    }
+
+    static GPP::TriMesh* LoadTriMesh(PayloadReader& reader)
+    {
+        GPP::Int vertexCount = 0;
+        reader.Read(vertexCount);
+        if (vertexCount < 0)
+        {
+            return NULL;
+        }
+        char hasVertexColor = 0;
+        char hasVertexTexCoord = 0;
+        char hasTriangleColor = 0;
+        char hasTriangleTexCoord = 0;
+        reader.Read(hasVertexColor);
+        reader.Read(hasVertexTexCoord);
+        reader.Read(hasTriangleColor);
+        reader.Read(hasTriangleTexCoord);
+        GPP::TriMesh* triMesh = new GPP::TriMesh(hasVertexColor != 0, hasVertexTexCoord != 0, hasTriangleTexCoord != 0);
+        triMesh->SetHasTriangleColor(hasTriangleColor != 0);
+        std::vector<GPP::Vector3> values;
+        reader.ReadArray(values);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(values[vid]);
+        }
+        if (hasVertexColor)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                triMesh->SetVertexColor(vid, values[vid]);
+            }
+        }
+        if (hasVertexTexCoord)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                triMesh->SetVertexTexcoord(vid, values[vid]);
+            }
+        }
+        std::vector<GPP::Int> triangleVertexIds;
+        reader.ReadArray(triangleVertexIds);
+        GPP::Int triangleCount = triangleVertexIds.size() / 3;
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            triMesh->InsertTriangle(triangleVertexIds[fid * 3], triangleVertexIds[fid * 3 + 1], triangleVertexIds[fid * 3 + 2]);
+        }
+        if (hasTriangleColor)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    triMesh->SetTriangleColor(fid, localId, values[fid * 3 + localId]);
+                }
+            }
+        }
+        if (hasTriangleTexCoord)
+        {
+            reader.ReadArray(values);
+            for (GPP::Int fid = 0; fid < triangleCount; fid++)
+            {
+                for (int localId = 0; localId < 3; localId++)
+                {
+                    triMesh->SetTriangleTexcoord(fid, localId, values[fid * 3 + localId]);
+                }
+            }
+        }
+        triMesh->UpdateNormal();
+        return triMesh;
+    }
+
+    UndoRecord::UndoRecord() :
+        mPayload()
+    {
+    }
+
+    UndoRecord::~UndoRecord()
+    {
+    }
+
+    void UndoRecord::Finish()
+    {
+    }
+
+    std::vector<char>& UndoRecord::GetPayload()
+    {
+        return mPayload;
+    }
+
+    ModelSnapshotRecord::ModelSnapshotRecord(UndoModel model) :
+        mModel(model)
+    {
+        PayloadWriter writer(&mPayload);
+        if (mModel == UNDO_POINTCLOUD)
+        {
+            SavePointCloud(ModelManager::Get()->GetPointCloud(), writer);
+        }
+        else
+        {
+            SaveTriMesh(ModelManager::Get()->GetMesh(), writer);
+        }
+        SaveSideIds(writer);
+    }
+
+    ModelSnapshotRecord::~ModelSnapshotRecord()
+    {
+    }
+
+    void ModelSnapshotRecord::Apply()
+    {
+        std::vector<char> currentPayload;
+        PayloadWriter writer(&currentPayload);
+        PayloadReader reader(&mPayload);
+        if (mModel == UNDO_POINTCLOUD)
+        {
+            SavePointCloud(ModelManager::Get()->GetPointCloud(), writer);
+            // The journal applying this record is kept
+            ModelManager::Get()->ReplacePointCloud(LoadPointCloud(reader));
+        }
+        else
+        {
+            SaveTriMesh(ModelManager::Get()->GetMesh(), writer);
+            ModelManager::Get()->ReplaceMesh(LoadTriMesh(reader));
+        }
+        SaveSideIds(writer);
+        LoadSideIds(reader);
+        mPayload.swap(currentPayload);
+    }
+
+    static GPP::Int GetElementCount(UndoModel model)
+    {
+        if (model == UNDO_POINTCLOUD)
+        {
+            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+            return pointCloud == NULL ? 0 : pointCloud->GetPointCount();
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        return triMesh == NULL ? 0 : triMesh->GetVertexCount();
+    }
+
+    static bool HasAttribute(UndoModel model, int attribute)
+    {
+        if (attribute == UNDO_COORD)
+        {
+            return true;
+        }
+        if (model == UNDO_POINTCLOUD)
+        {
+            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+            return attribute == UNDO_NORMAL ? pointCloud->HasNormal() : pointCloud->HasColor();
+        }
+        GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+        return attribute == UNDO_NORMAL ? true : triMesh->HasVertexColor();
+    }
+
+    static void SetHasAttribute(UndoModel model, int attribute, bool has)
+    {
+        if (model == UNDO_POINTCLOUD)
+        {
+            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+            if (attribute == UNDO_NORMAL)
+            {
+                pointCloud->SetHasNormal(has);
+            }
+            else if (attribute == UNDO_COLOR)
+            {
+                pointCloud->SetHasColor(has);
+            }
+        }
+        else if (attribute == UNDO_COLOR)
+        {
+            ModelManager::Get()->GetMesh()->SetHasVertexColor(has);
+        }
+    }
+
+    static void GetAttributeValues(UndoModel model, int attribute, GPP::Int startId, GPP::Int endId,
+        std::vector<GPP::Vector3>& values)
+    {
+        values.resize(endId - startId);
+        if (model == UNDO_POINTCLOUD)
+        {
+            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+            for (GPP::Int pid = startId; pid < endId; pid++)
+            {
+                values[pid - startId] = attribute == UNDO_COORD ? pointCloud->GetPointCoord(pid) :
+                    (attribute == UNDO_NORMAL ? pointCloud->GetPointNormal(pid) : pointCloud->GetPointColor(pid));
+            }
+        }
+        else
+        {
+            GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+            for (GPP::Int vid = startId; vid < endId; vid++)
+            {
+                values[vid - startId] = attribute == UNDO_COORD ? triMesh->GetVertexCoord(vid) :
+                    (attribute == UNDO_NORMAL ? triMesh->GetVertexNormal(vid) : triMesh->GetVertexColor(vid));
+            }
+        }
+    }
+
+    static void SetAttributeValues(UndoModel model, int attribute, GPP::Int startId, const std::vector<GPP::Vector3>& values)
+    {
+        GPP::Int endId = startId + values.size();
+        if (model == UNDO_POINTCLOUD)
+        {
+            GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+            for (GPP::Int pid = startId; pid < endId; pid++)
+            {
+                if (attribute == UNDO_COORD)
+                {
+                    pointCloud->SetPointCoord(pid, values[pid - startId]);
+                }
+                else if (attribute == UNDO_NORMAL)
+                {
+                    pointCloud->SetPointNormal(pid, values[pid - startId]);
+                }
+                else
+                {
+                    pointCloud->SetPointColor(pid, values[pid - startId]);
+                }
+            }
+        }
+        else
+        {
+            GPP::TriMesh* triMesh = ModelManager::Get()->GetMesh();
+            for (GPP::Int vid = startId; vid < endId; vid++)
+            {
+                if (attribute == UNDO_COORD)
+                {
+                    triMesh->SetVertexCoord(vid, values[vid - startId]);
+                }
+                else if (attribute == UNDO_NORMAL)
+                {
+                    triMesh->SetVertexNormal(vid, values[vid - startId]);
+                }
+                else
+                {
+                    triMesh->SetVertexColor(vid, values[vid - startId]);
+                }
+            }
+        }
+    }
+
+    static void SaveVertexRange(UndoModel model, int attributes, GPP::Int startId, GPP::Int endId, PayloadWriter& writer)
+    {
+        writer.Write(startId);
+        writer.Write(endId);
+        std::vector<GPP::Vector3> values;
+        for (int attribute = UNDO_COORD; attribute <= UNDO_COLOR; attribute <<= 1)
+        {
+            if ((attributes & attribute) == 0)
+            {
+                continue;
+            }
+            char hasAttribute = HasAttribute(model, attribute) ? 1 : 0;
+            writer.Write(hasAttribute);
+            if (hasAttribute)
+            {
+                GetAttributeValues(model, attribute, startId, endId, values);
+                writer.WriteArray(values);
+            }
+        }
+    }
+
+    VertexRangeRecord::VertexRangeRecord(UndoModel model, int attributes, GPP::Int startId, GPP::Int endId) :
+        mModel(model),
+        mAttributes(attributes)
+    {
+        GPP::Int elementCount = GetElementCount(model);
+        startId = startId < 0 ? 0 : startId;
+        endId = endId > elementCount ? elementCount : endId;
+        endId = endId < startId ? startId : endId;
+        PayloadWriter writer(&mPayload);
+        SaveVertexRange(mModel, mAttributes, startId, endId, writer);
+    }
+
+    VertexRangeRecord::~VertexRangeRecord()
+    {
+    }
+
+    void VertexRangeRecord::Apply()
+    {
+        PayloadReader reader(&mPayload);
+        GPP::Int startId = 0;
+        GPP::Int endId = 0;
+        reader.Read(startId);
+        reader.Read(endId);
+        if (endId > GetElementCount(mModel))
+        {
+            WarnLog << "VertexRangeRecord::Apply: element count is changed" << std::endl;
+            return;
+        }
+        std::vector<char> currentPayload;
+        PayloadWriter writer(&currentPayload);
+        SaveVertexRange(mModel, mAttributes, startId, endId, writer);
+        std::vector<GPP::Vector3> values;
+        for (int attribute = UNDO_COORD; attribute <= UNDO_COLOR; attribute <<= 1)
+        {
+            if ((mAttributes & attribute) == 0)
+            {
+                continue;
+            }
+            char hasAttribute = 0;
+            reader.Read(hasAttribute);
+            SetHasAttribute(mModel, attribute, hasAttribute != 0);
+            if (hasAttribute)
+            {
+                reader.ReadArray(values);
+                SetAttributeValues(mModel, attribute, startId, values);
+            }
+        }
+        mPayload.swap(currentPayload);
+        if (mAttributes & UNDO_COORD)
+        {
+            if (mModel == UNDO_POINTCLOUD)
+            {
+                ModelManager::Get()->RefreshPointNeighborGraph(ModelManager::Get()->GetPointCloud());
+            }
+            else
+            {
+                ModelManager::Get()->IncreaseMeshGeneration(ModelManager::Get()->GetMesh());
+            }
+        }
+    }
+
+    static inline bool IsSameValue(const GPP::Vector3& value0, const GPP::Vector3& value1)
+    {
+        return value0[0] == value1[0] && value0[1] == value1[1] && value0[2] == value1[2];
+    }
+
+    void VertexRangeRecord::Finish()
+    {
+        PayloadReader reader(&mPayload);
+        GPP::Int startId = 0;
+        GPP::Int endId = 0;
+        reader.Read(startId);
+        reader.Read(endId);
+        if (endId > GetElementCount(mModel))
+        {
+            return;
+        }
+        std::vector<char> hasAttributes;
+        std::vector<std::vector<GPP::Vector3> > savedValues;
+        std::vector<GPP::Vector3> values;
+        GPP::Int changedStartId = endId;
+        GPP::Int changedEndId = startId;
+        for (int attribute = UNDO_COORD; attribute <= UNDO_COLOR; attribute <<= 1)
+        {
+            if ((mAttributes & attribute) == 0)
+            {
+                continue;
+            }
+            char hasAttribute = 0;
+            reader.Read(hasAttribute);
+            if ((hasAttribute != 0) != HasAttribute(mModel, attribute))
+            {
+                // The attribute is added or removed, every element is changed
+                return;
+            }
+            hasAttributes.push_back(hasAttribute);
+            savedValues.push_back(std::vector<GPP::Vector3>());
+            if (!hasAttribute)
+            {
+                continue;
+            }
+            reader.ReadArray(savedValues.back());
+            GetAttributeValues(mModel, attribute, startId, endId, values);
+            for (GPP::Int eid = startId; eid < changedStartId; eid++)
+            {
+                if (!IsSameValue(values[eid - startId], savedValues.back()[eid - startId]))
+                {
+                    changedStartId = eid;
+                    break;
+                }
+            }
+            for (GPP::Int eid = endId - 1; eid >= changedEndId; eid--)
+            {
+                if (!IsSameValue(values[eid - startId], savedValues.back()[eid - startId]))
+                {
+                    changedEndId = eid + 1;
+                    break;
+                }
+            }
+        }
+        if (changedStartId >= changedEndId)
+        {
+            changedStartId = startId;
+            changedEndId = startId;
+        }
+        if (changedStartId == startId && changedEndId == endId)
+        {
+            return;
+        }
+        std::vector<char> trimmedPayload;
+        PayloadWriter writer(&trimmedPayload);
+        writer.Write(changedStartId);
+        writer.Write(changedEndId);
+        GPP::Int attributeCount = hasAttributes.size();
+        for (GPP::Int aid = 0; aid < attributeCount; aid++)
+        {
+            writer.Write(hasAttributes[aid]);
+            if (hasAttributes[aid])
+            {
+                const std::vector<GPP::Vector3>& saved = savedValues[aid];
+                writer.WriteArray(std::vector<GPP::Vector3>(saved.begin() + (changedStartId - startId),
+                    saved.begin() + (changedEndId - startId)));
+            }
+        }
+        mPayload.swap(trimmedPayload);
+    }
+
+    template<class T>
+    static void CaptureDeletedValues(const std::vector<T>& values, const std::vector<GPP::Int>& deleteIds, PayloadWriter& writer)
+    {
+        std::vector<T> deletedValues;
+        deletedValues.reserve(deleteIds.size());
+        for (std::vector<GPP::Int>::const_iterator itr = deleteIds.begin(); itr != deleteIds.end(); ++itr)
+        {
+            deletedValues.push_back(values.at(*itr));
+        }
+        writer.WriteArray(deletedValues);
+    }
+
+    // deleteIds are increasing, they are the ids in the merged vector
+    template<class T>
+    static void MergeDeletedValues(std::vector<T>& values, const std::vector<GPP::Int>& deleteIds, const std::vector<T>& deletedValues)
+    {
+        GPP::Int totalCount = values.size() + deleteIds.size();
+        std::vector<T> mergedValues;
+        mergedValues.reserve(totalCount);
+        GPP::Int keepId = 0;
+        GPP::Int deleteId = 0;
+        GPP::Int deleteCount = deleteIds.size();
+        for (GPP::Int mergeId = 0; mergeId < totalCount; mergeId++)
+        {
+            if (deleteId < deleteCount && deleteIds[deleteId] == mergeId)
+            {
+                mergedValues.push_back(deletedValues[deleteId++]);
+            }
+            else
+            {
+                mergedValues.push_back(values[keepId++]);
+            }
+        }
+        values.swap(mergedValues);
+    }
+
+    PointDeleteRecord::PointDeleteRecord(const std::vector<GPP::Int>& deleteIds) :
+        mIsDeleted(true)
+    {
+        std::vector<GPP::Int> sortedIds = deleteIds;
+        std::sort(sortedIds.begin(), sortedIds.end());
+        sortedIds.erase(std::unique(sortedIds.begin(), sortedIds.end()), sortedIds.end());
+        CapturePoints(sortedIds);
+    }
+
+    PointDeleteRecord::~PointDeleteRecord()
+    {
+    }
+
+    void PointDeleteRecord::Apply()
+    {
+        bool isApplied = mIsDeleted ? InsertPoints() : DeletePoints();
+        if (!isApplied)
+        {
+            WarnLog << "PointDeleteRecord::Apply: point cloud does not match the record" << std::endl;
+            return;
+        }
+        ModelManager::Get()->IncreasePointCloudGeneration(ModelManager::Get()->GetPointCloud());
+        mIsDeleted = !mIsDeleted;
+    }
+
+    // Payload: deleteIds, then if the points are deleted, their attributes and ids
+    void PointDeleteRecord::CapturePoints(const std::vector<GPP::Int>& deleteIds)
+    {
+        mPayload.clear();
+        PayloadWriter writer(&mPayload);
+        writer.WriteArray(deleteIds);
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        GPP::Int pointCount = pointCloud == NULL ? 0 : pointCloud->GetPointCount();
+        if (pointCloud == NULL || (!deleteIds.empty() && deleteIds.back() >= pointCount))
+        {
+            mPayload.clear();
+            PayloadWriter emptyWriter(&mPayload);
+            emptyWriter.WriteArray(std::vector<GPP::Int>());
+            return;
+        }
+        char hasNormal = pointCloud->HasNormal() ? 1 : 0;
+        char hasColor = pointCloud->HasColor() ? 1 : 0;
+        writer.Write(hasNormal);
+        writer.Write(hasColor);
+        GPP::Int deleteCount = deleteIds.size();
+        std::vector<GPP::Vector3> values(deleteCount);
+        for (GPP::Int did = 0; did < deleteCount; did++)
+        {
+            values[did] = pointCloud->GetPointCoord(deleteIds[did]);
+        }
+        writer.WriteArray(values);
+        if (hasNormal)
+        {
+            for (GPP::Int did = 0; did < deleteCount; did++)
+            {
+                values[did] = pointCloud->GetPointNormal(deleteIds[did]);
+            }
+            writer.WriteArray(values);
+        }
+        if (hasColor)
+        {
+            for (GPP::Int did = 0; did < deleteCount; did++)
+            {
+                values[did] = pointCloud->GetPointColor(deleteIds[did]);
+            }
+            writer.WriteArray(values);
+        }
+        // Ids which do not match the point count are not moved by deletion either
+        std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
+        char hasImageColorIds = imageColorIds.size() == pointCount ? 1 : 0;
+        writer.Write(hasImageColorIds);
+        if (hasImageColorIds)
+        {
+            CaptureDeletedValues(imageColorIds, deleteIds, writer);
+        }
+        std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
+        char hasColorIds = colorIds.size() == pointCount ? 1 : 0;
+        writer.Write(hasColorIds);
+        if (hasColorIds)
+        {
+            CaptureDeletedValues(colorIds, deleteIds, writer);
+        }
+        std::vector<int> cloudIds = ModelManager::Get()->GetCloudIds();
+        char hasCloudIds = cloudIds.size() == pointCount ? 1 : 0;
+        writer.Write(hasCloudIds);
+        if (hasCloudIds)
+        {
+            CaptureDeletedValues(cloudIds, deleteIds, writer);
+        }
+    }
+
+    bool PointDeleteRecord::InsertPoints()
+    {
+        PayloadReader reader(&mPayload);
+        std::vector<GPP::Int> deleteIds;
+        reader.ReadArray(deleteIds);
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        if (deleteIds.empty() || pointCloud == NULL)
+        {
+            return false;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        GPP::Int totalCount = pointCount + deleteIds.size();
+        if (deleteIds.back() >= totalCount)
+        {
+            return false;
+        }
+        char hasNormal = 0;
+        char hasColor = 0;
+        reader.Read(hasNormal);
+        reader.Read(hasColor);
+        std::vector<GPP::Vector3> deletedValues;
+        std::vector<GPP::Vector3> values(pointCount);
+        reader.ReadArray(deletedValues);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            values[pid] = pointCloud->GetPointCoord(pid);
+        }
+        MergeDeletedValues(values, deleteIds, deletedValues);
+        for (GPP::Int pid = pointCount; pid < totalCount; pid++)
+        {
+            pointCloud->InsertPoint(values[pid]);
+        }
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            pointCloud->SetPointCoord(pid, values[pid]);
+        }
+        if (hasNormal)
+        {
+            reader.ReadArray(deletedValues);
+            values.resize(pointCount);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                values[pid] = pointCloud->GetPointNormal(pid);
+            }
+            MergeDeletedValues(values, deleteIds, deletedValues);
+            pointCloud->SetHasNormal(true);
+            for (GPP::Int pid = 0; pid < totalCount; pid++)
+            {
+                pointCloud->SetPointNormal(pid, values[pid]);
+            }
+        }
+        if (hasColor)
+        {
+            reader.ReadArray(deletedValues);
+            values.resize(pointCount);
+            for (GPP::Int pid = 0; pid < pointCount; pid++)
+            {
+                values[pid] = pointCloud->GetPointColor(pid);
+            }
+            MergeDeletedValues(values, deleteIds, deletedValues);
+            pointCloud->SetHasColor(true);
+            for (GPP::Int pid = 0; pid < totalCount; pid++)
+            {
+                pointCloud->SetPointColor(pid, values[pid]);
+            }
+        }
+        char hasIds = 0;
+        reader.Read(hasIds);
+        if (hasIds)
+        {
+            std::vector<GPP::ImageColorId> deletedImageColorIds;
+            reader.ReadArray(deletedImageColorIds);
+            std::vector<GPP::ImageColorId> imageColorIds = ModelManager::Get()->GetImageColorIds();
+            if (imageColorIds.size() == pointCount)
+            {
+                MergeDeletedValues(imageColorIds, deleteIds, deletedImageColorIds);
+                ModelManager::Get()->SetImageColorIds(imageColorIds);
+            }
+        }
+        reader.Read(hasIds);
+        if (hasIds)
+        {
+            std::vector<int> deletedColorIds;
+            reader.ReadArray(deletedColorIds);
+            std::vector<int> colorIds = ModelManager::Get()->GetColorIds();
+            if (colorIds.size() == pointCount)
+            {
+                MergeDeletedValues(colorIds, deleteIds, deletedColorIds);
+                ModelManager::Get()->SetColorIds(colorIds);
+            }
+        }
+        reader.Read(hasIds);
+        if (hasIds)
+        {
+            std::vector<int> deletedCloudIds;
+            reader.ReadArray(deletedCloudIds);
+            std::vector<int> cloudIds = ModelManager::Get()->GetCloudIds();
+            if (cloudIds.size() == pointCount)
+            {
+                MergeDeletedValues(cloudIds, deleteIds, deletedCloudIds);
+                ModelManager::Get()->SetCloudIds(cloudIds);
+            }
+        }
+        // Only ids are needed to delete them again
+        mPayload.clear();
+        PayloadWriter writer(&mPayload);
+        writer.WriteArray(deleteIds);
+        return true;
+    }
+
+    bool PointDeleteRecord::DeletePoints()
+    {
+        std::vector<GPP::Int> deleteIds;
+        PayloadReader reader(&mPayload);
+        reader.ReadArray(deleteIds);
+        GPP::PointCloud* pointCloud = ModelManager::Get()->GetPointCloud();
+        // deleteIds are sorted, the payload is only replaced if they could be deleted
+        if (deleteIds.empty() || pointCloud == NULL || deleteIds.back() >= pointCloud->GetPointCount())
+        {
+            return false;
+        }
+        CapturePoints(deleteIds);
+        AttributeChannelRegistry channels(pointCloud->GetPointCount());
+        channels.AddChannel(new PointCloudChannel(pointCloud));
+        channels.AddVector(ModelManager::Get()->GetImageColorIdsPointer());
+        channels.AddVector(ModelManager::Get()->GetColorIdsPointer());
+        channels.AddVector(ModelManager::Get()->GetCloudIdsPointer());
+        if (channels.Delete(deleteIds) != GPP_NO_ERROR)
+        {
+            ErrorLog << "PointDeleteRecord::DeletePoints invalid delete ids" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Bytes of the same significance are grouped, so the slowly changing high bytes of coordinates form long runs.
+    // Runs are coded as PackBits: control c < 128 is followed by c + 1 literal bytes, c >= 128 repeats the next byte c - 125 times.
+    static void CompressPayload(const std::vector<char>& payload, std::vector<char>& compressed)
+    {
+        size_t payloadSize = payload.size();
+        size_t elementCount = payloadSize / gShuffleElementSize;
+        std::vector<char> shuffled(payloadSize);
+        for (size_t eid = 0; eid < elementCount; eid++)
+        {
+            for (int byteId = 0; byteId < gShuffleElementSize; byteId++)
+            {
+                shuffled[byteId * elementCount + eid] = payload[eid * gShuffleElementSize + byteId];
+            }
+        }
+        for (size_t byteId = elementCount * gShuffleElementSize; byteId < payloadSize; byteId++)
+        {
+            shuffled[byteId] = payload[byteId];
+        }
+        compressed.clear();
+        compressed.reserve(payloadSize / 2 + 16);
+        size_t readId = 0;
+        while (readId < payloadSize)
+        {
+            size_t runEnd = readId + 1;
+            while (runEnd < payloadSize && runEnd - readId < 130 && shuffled[runEnd] == shuffled[readId])
+            {
+                runEnd++;
+            }
+            if (runEnd - readId >= 3)
+            {
+                compressed.push_back(char(runEnd - readId + 125));
+                compressed.push_back(shuffled[readId]);
+                readId = runEnd;
+                continue;
+            }
+            size_t literalEnd = readId + 1;
+            while (literalEnd < payloadSize && literalEnd - readId < 128)
+            {
+                if (literalEnd + 2 < payloadSize && shuffled[literalEnd] == shuffled[literalEnd + 1] &&
+                    shuffled[literalEnd] == shuffled[literalEnd + 2])
+                {
+                    break;
+                }
+                literalEnd++;
+            }
+            compressed.push_back(char(literalEnd - readId - 1));
+            compressed.insert(compressed.end(), shuffled.begin() + readId, shuffled.begin() + literalEnd);
+            readId = literalEnd;
+        }
+    }
+
+    static bool DecompressPayload(const std::vector<char>& compressed, size_t payloadSize, std::vector<char>& payload)
+    {
+        std::vector<char> shuffled;
+        shuffled.reserve(payloadSize);
+        size_t readId = 0;
+        size_t compressedSize = compressed.size();
+        while (readId < compressedSize)
+        {
+            unsigned char control = (unsigned char)(compressed[readId++]);
+            if (control < 128)
+            {
+                size_t literalCount = size_t(control) + 1;
+                if (readId + literalCount > compressedSize)
+                {
+                    return false;
+                }
+                shuffled.insert(shuffled.end(), compressed.begin() + readId, compressed.begin() + readId + literalCount);
+                readId += literalCount;
+            }
+            else
+            {
+                if (readId >= compressedSize)
+                {
+                    return false;
+                }
+                shuffled.insert(shuffled.end(), size_t(control) - 125, compressed[readId++]);
+            }
+        }
+        if (shuffled.size() != payloadSize)
+        {
+            return false;
+        }
+        size_t elementCount = payloadSize / gShuffleElementSize;
+        payload.resize(payloadSize);
+        for (size_t eid = 0; eid < elementCount; eid++)
+        {
+            for (int byteId = 0; byteId < gShuffleElementSize; byteId++)
+            {
+                payload[eid * gShuffleElementSize + byteId] = shuffled[byteId * elementCount + eid];
+            }
+        }
+        for (size_t byteId = elementCount * gShuffleElementSize; byteId < payloadSize; byteId++)
+        {
+            payload[byteId] = shuffled[byteId];
+        }
+        return true;
+    }
+
+    UndoJournal::UndoJournal() :
+        mEntries(),
+        mAppliedCount(0),
+        mpPendingRecord(NULL),
+        mMemoryBudget(gUndoMemoryBudget),
+        mMaxRecordCount(gUndoMaxRecordCount),
+        mSpillDirectory()
+    {
+        char tempPath[MAX_PATH];
+        DWORD pathLength = GetTempPathA(MAX_PATH, tempPath);
+        if (pathLength > 0 && pathLength < MAX_PATH)
+        {
+            mSpillDirectory = tempPath;
+        }
+    }
+
+    UndoJournal::~UndoJournal()
+    {
+        Clear();
+    }
+
+    void UndoJournal::SetMemoryBudget(GPP::ULongInt memoryBudget)
+    {
+        mMemoryBudget = memoryBudget;
+        EnforceBudget();
+    }
+
+    GPP::ULongInt UndoJournal::GetMemoryBudget() const
+    {
+        return mMemoryBudget;
+    }
+
+    void UndoJournal::SetMaxRecordCount(GPP::Int maxRecordCount)
+    {
+        mMaxRecordCount = maxRecordCount > 1 ? maxRecordCount : 1;
+    }
+
+    void UndoJournal::SetSpillDirectory(const std::string& spillDirectory)
+    {
+        mSpillDirectory = spillDirectory;
+        if (!mSpillDirectory.empty() && mSpillDirectory[mSpillDirectory.size() - 1] != '\\' &&
+            mSpillDirectory[mSpillDirectory.size() - 1] != '/')
+        {
+            mSpillDirectory += "\\";
+        }
+    }
+
+    void UndoJournal::Push(UndoRecord* record)
+    {
+        if (record == NULL)
+        {
+            return;
+        }
+        for (GPP::Int entryId = mAppliedCount; entryId < GPP::Int(mEntries.size()); entryId++)
+        {
+            ReleaseEntry(mEntries.at(entryId));
+        }
+        mEntries.resize(mAppliedCount);
+        record->Finish();
+        JournalEntry entry;
+        entry.record = record;
+        mEntries.push_back(entry);
+        while (GPP::Int(mEntries.size()) > mMaxRecordCount)
+        {
+            ReleaseEntry(mEntries.at(0));
+            mEntries.erase(mEntries.begin());
+        }
+        mAppliedCount = mEntries.size();
+        EnforceBudget();
+    }
+
+    void UndoJournal::Prepare(UndoRecord* record)
+    {
+        GPPFREEPOINTER(mpPendingRecord);
+        mpPendingRecord = record;
+    }
+
+    void UndoJournal::Commit()
+    {
+        UndoRecord* record = mpPendingRecord;
+        mpPendingRecord = NULL;
+        Push(record);
+    }
+
+    void UndoJournal::Cancel()
+    {
+        GPPFREEPOINTER(mpPendingRecord);
+    }
+
+    void UndoJournal::Revert()
+    {
+        if (mpPendingRecord != NULL)
+        {
+            mpPendingRecord->Apply();
+        }
+        GPPFREEPOINTER(mpPendingRecord);
+    }
+
+    bool UndoJournal::CanUndo() const
+    {
+        return mAppliedCount > 0;
+    }
+
+    bool UndoJournal::CanRedo() const
+    {
+        return mAppliedCount < GPP::Int(mEntries.size());
+    }
+
+    bool UndoJournal::Undo()
+    {
+        if (!CanUndo())
+        {
+            return false;
+        }
+        JournalEntry& entry = mEntries.at(mAppliedCount - 1);
+        if (!LoadEntry(entry))
+        {
+            return false;
+        }
+        entry.record->Apply();
+        mAppliedCount--;
+        EnforceBudget();
+        return true;
+    }
+
+    bool UndoJournal::Redo()
+    {
+        if (!CanRedo())
+        {
+            return false;
+        }
+        JournalEntry& entry = mEntries.at(mAppliedCount);
+        if (!LoadEntry(entry))
+        {
+            return false;
+        }
+        entry.record->Apply();
+        mAppliedCount++;
+        EnforceBudget();
+        return true;
+    }
+
+    void UndoJournal::Clear()
+    {
+        for (std::vector<JournalEntry>::iterator itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+        {
+            ReleaseEntry(*itr);
+        }
+        mEntries.clear();
+        mAppliedCount = 0;
+        GPPFREEPOINTER(mpPendingRecord);
+    }
+
+    GPP::ULongInt UndoJournal::GetMemorySize() const
+    {
+        GPP::ULongInt memorySize = 0;
+        for (std::vector<JournalEntry>::const_iterator itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+        {
+            memorySize += itr->record->GetPayload().size();
+        }
+        return memorySize;
+    }
+
+    bool UndoJournal::LoadEntry(JournalEntry& entry)
+    {
+        if (entry.spillFile.empty())
+        {
+            return true;
+        }
+        std::ifstream spillIn(entry.spillFile.c_str(), std::ios::binary);
+        if (!spillIn)
+        {
+            ErrorLog << "UndoJournal::LoadEntry: failed to open " << entry.spillFile << std::endl;
+            return false;
+        }
+        GPP::ULongInt payloadSize = 0;
+        GPP::ULongInt compressedSize = 0;
+        spillIn.read(reinterpret_cast<char*>(&payloadSize), sizeof(payloadSize));
+        spillIn.read(reinterpret_cast<char*>(&compressedSize), sizeof(compressedSize));
+        std::vector<char> compressed(compressedSize);
+        if (compressedSize > 0)
+        {
+            spillIn.read(&compressed[0], compressedSize);
+        }
+        if (!spillIn || !DecompressPayload(compressed, payloadSize, entry.record->GetPayload()))
+        {
+            ErrorLog << "UndoJournal::LoadEntry: " << entry.spillFile << " is corrupt" << std::endl;
+            return false;
+        }
+        spillIn.close();
+        std::remove(entry.spillFile.c_str());
+        entry.spillFile.clear();
+        return true;
+    }
+
+    bool UndoJournal::SpillEntry(JournalEntry& entry)
+    {
+        if (!entry.spillFile.empty() || entry.record->GetPayload().empty())
+        {
+            return true;
+        }
+        std::stringstream fileName;
+        fileName << mSpillDirectory << "Magic3D_undo_" << GetCurrentProcessId() << "_" << gSpillFileId++ << ".bin";
+        std::vector<char>& payload = entry.record->GetPayload();
+        std::vector<char> compressed;
+        CompressPayload(payload, compressed);
+        std::ofstream spillOut(fileName.str().c_str(), std::ios::binary);
+        if (!spillOut)
+        {
+            return false;
+        }
+        GPP::ULongInt payloadSize = payload.size();
+        GPP::ULongInt compressedSize = compressed.size();
+        spillOut.write(reinterpret_cast<const char*>(&payloadSize), sizeof(payloadSize));
+        spillOut.write(reinterpret_cast<const char*>(&compressedSize), sizeof(compressedSize));
+        if (compressedSize > 0)
+        {
+            spillOut.write(&compressed[0], compressedSize);
+        }
+        spillOut.close();
+        if (!spillOut)
+        {
+            std::remove(fileName.str().c_str());
+            return false;
+        }
+        InfoLog << "UndoJournal spill " << payloadSize << " bytes to " << compressedSize << std::endl;
+        std::vector<char>().swap(payload);
+        entry.spillFile = fileName.str();
+        return true;
+    }
+
+    void UndoJournal::ReleaseEntry(JournalEntry& entry)
+    {
+        if (!entry.spillFile.empty())
+        {
+            std::remove(entry.spillFile.c_str());
+            entry.spillFile.clear();
+        }
+        GPPFREEPOINTER(entry.record);
+    }
+
+    void UndoJournal::EnforceBudget()
+    {
+        GPP::ULongInt memorySize = GetMemorySize();
+        if (memorySize <= mMemoryBudget)
+        {
+            return;
+        }
+        // Spill the records farthest from the current step first: the oldest undo and the last redo
+        GPP::Int lowId = 0;
+        GPP::Int highId = GPP::Int(mEntries.size()) - 1;
+        while (memorySize > mMemoryBudget && lowId <= highId)
+        {
+            GPP::Int entryId = (mAppliedCount - lowId >= highId + 1 - mAppliedCount) ? lowId++ : highId--;
+            JournalEntry& entry = mEntries.at(entryId);
+            GPP::ULongInt payloadSize = entry.record->GetPayload().size();
+            if (SpillEntry(entry) && entry.record->GetPayload().empty())
+            {
+                memorySize -= payloadSize;
+            }
+        }
+    }
+}
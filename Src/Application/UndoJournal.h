@@ -0,0 +1,143 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+#include <string>
+
+namespace MagicApp
+{
+    enum UndoModel
+    {
+        UNDO_POINTCLOUD = 0,
+        UNDO_TRIMESH
+    };
+
+    enum UndoAttribute
+    {
+        UNDO_COORD = 1,
+        UNDO_NORMAL = 2,
+        UNDO_COLOR = 4
+    };
+
+    // One step of the journal. Records work on the current models of ModelManager.
+    // Apply switches the model between the states before and after the command, and the payload keeps the other
+    // state, so the same record undoes the command at the first call and redoes it at the next call.
+    class UndoRecord
+    {
+    public:
+        UndoRecord();
+        virtual ~UndoRecord();
+
+        virtual void Apply(void) = 0;
+        // Called when the record is pushed, the command is done and the record could drop what it did not change
+        virtual void Finish(void);
+        // Every state of the record is in the payload, so UndoJournal could move it to disk and back
+        std::vector<char>& GetPayload(void);
+
+    protected:
+        std::vector<char> mPayload;
+    };
+
+    // Full copy of a model and its per element ids, used by commands which rewrite the whole model
+    class ModelSnapshotRecord : public UndoRecord
+    {
+    public:
+        explicit ModelSnapshotRecord(UndoModel model);
+        virtual ~ModelSnapshotRecord();
+
+        virtual void Apply(void);
+
+    private:
+        UndoModel mModel;
+    };
+
+    // Attributes of elements [startId, endId) of a model, point/vertex count should be unchanged by the command.
+    // Finish shrinks the range to the elements which are really changed.
+    class VertexRangeRecord : public UndoRecord
+    {
+    public:
+        // attributes: combination of UndoAttribute
+        VertexRangeRecord(UndoModel model, int attributes, GPP::Int startId, GPP::Int endId);
+        virtual ~VertexRangeRecord();
+
+        virtual void Apply(void);
+        virtual void Finish(void);
+
+    private:
+        UndoModel mModel;
+        int mAttributes;
+    };
+
+    // Deleted points of the point cloud with their attributes and ids.
+    // Construct it before the points are deleted.
+    class PointDeleteRecord : public UndoRecord
+    {
+    public:
+        explicit PointDeleteRecord(const std::vector<GPP::Int>& deleteIds);
+        virtual ~PointDeleteRecord();
+
+        virtual void Apply(void);
+
+    private:
+        void CapturePoints(const std::vector<GPP::Int>& deleteIds);
+        // false if the model does not match the record, nothing is changed then
+        bool InsertPoints(void);
+        bool DeletePoints(void);
+
+    private:
+        bool mIsDeleted;
+    };
+
+    // Undo/redo stack of records with a memory budget. When payloads in memory exceed the budget, the records
+    // farthest from the current step are compressed and spilled to disk. They are loaded back when applied.
+    class UndoJournal
+    {
+    public:
+        UndoJournal();
+        ~UndoJournal();
+
+        void SetMemoryBudget(GPP::ULongInt memoryBudget);
+        GPP::ULongInt GetMemoryBudget(void) const;
+        // The oldest records are deleted if there are more
+        void SetMaxRecordCount(GPP::Int maxRecordCount);
+        void SetSpillDirectory(const std::string& spillDirectory);
+
+        // Take the ownership, redo records are discarded. Finish of the record is called.
+        void Push(UndoRecord* record);
+        // Take the ownership. Commit pushes it, it is deleted by the next Prepare, Cancel or Clear.
+        // It is used when the command may fail after the state is recorded.
+        void Prepare(UndoRecord* record);
+        void Commit(void);
+        void Cancel(void);
+        // Restore the state of the prepared record and delete it, the result of the command is dropped
+        void Revert(void);
+
+        bool CanUndo(void) const;
+        bool CanRedo(void) const;
+        bool Undo(void);
+        bool Redo(void);
+        void Clear(void);
+
+        // Bytes of payloads in memory
+        GPP::ULongInt GetMemorySize(void) const;
+
+    private:
+        struct JournalEntry
+        {
+            UndoRecord* record;
+            std::string spillFile;
+        };
+        bool LoadEntry(JournalEntry& entry);
+        bool SpillEntry(JournalEntry& entry);
+        void ReleaseEntry(JournalEntry& entry);
+        void EnforceBudget(void);
+
+    private:
+        std::vector<JournalEntry> mEntries;
+        // Records [0, mAppliedCount) could be undone, the others could be redone
+        GPP::Int mAppliedCount;
+        UndoRecord* mpPendingRecord;
+        GPP::ULongInt mMemoryBudget;
+        GPP::Int mMaxRecordCount;
+        std::string mSpillDirectory;
+    };
+}
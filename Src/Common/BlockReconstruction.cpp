@@ -0,0 +1,1074 @@
+#include "BlockReconstruction.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include "PointCloud.h"
+#include "ReconstructMesh.h"
+#include "FillMeshHole.h"
+#include "ConsolidateMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace MagicCore
+{
+    // Points of a block file are read and written in chunks of this count
+    static const GPP::Int gRecordChunkSize = 65536;
+    static const int gMaxLineLength = 1024;
+    // Overlap size relative to the expected block size
+    static const GPP::Real gBlockOverlapRatio = 0.08;
+    // Blocks with fewer points have no reliable surface
+    static const GPP::Int gMinBlockPointCount = 64;
+    // Boundary vertices of the two sides of a seam are matched in this ratio of the average edge length
+    static const GPP::Real gSeamSearchRatio = 2.0;
+    // Hole loops with at least this ratio of seam vertices are gaps of seams
+    static const GPP::Real gSeamHoleRatio = 0.5;
+    static const GPP::Real gMaxHoleAreaRatio = 0.1;
+
+    class BlockFileWriter
+    {
+    public:
+        BlockFileWriter(const std::string& fileName, int recordSize) :
+            mpFile(fopen(fileName.c_str(), "wb")),
+            mRecordSize(recordSize),
+            mBuffer(),
+            mRecordCount(0),
+            mIsValid(mpFile != NULL)
+        {
+            mBuffer.reserve(gRecordChunkSize * recordSize);
+        }
+
+        ~BlockFileWriter()
+        {
+            Close();
+        }
+
+        void Write(const double* record)
+        {
+            mBuffer.insert(mBuffer.end(), record, record + mRecordSize);
+            mRecordCount++;
+            if (GPP::Int(mBuffer.size()) >= gRecordChunkSize * mRecordSize)
+            {
+                Flush();
+            }
+        }
+
+        bool Close(void)
+        {
+            if (mpFile != NULL)
+            {
+                Flush();
+                fclose(mpFile);
+                mpFile = NULL;
+            }
+            return mIsValid;
+        }
+
+        GPP::Int GetRecordCount(void) const
+        {
+            return mRecordCount;
+        }
+
+    private:
+        void Flush(void)
+        {
+            if (mpFile != NULL && !mBuffer.empty())
+            {
+                if (fwrite(&mBuffer[0], sizeof(double), mBuffer.size(), mpFile) != mBuffer.size())
+                {
+                    mIsValid = false;
+                }
+            }
+            mBuffer.clear();
+        }
+
+    private:
+        FILE* mpFile;
+        int mRecordSize;
+        std::vector<double> mBuffer;
+        GPP::Int mRecordCount;
+        bool mIsValid;
+    };
+
+    // Read at most gRecordChunkSize records, it returns the count of records read
+    static GPP::Int ReadRecordChunk(FILE* blockFile, int recordSize, std::vector<double>& records)
+    {
+        records.resize(gRecordChunkSize * recordSize);
+        size_t readCount = fread(&records[0], sizeof(double), records.size(), blockFile);
+        return GPP::Int(readCount / recordSize);
+    }
+
+    static bool IsInBox(const double* coord, const GPP::Vector3& boxMin, const GPP::Vector3& boxMax, GPP::Real margin)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (coord[axis] < boxMin[axis] - margin || coord[axis] >= boxMax[axis] + margin)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static GPP::ULongInt EdgeKey(GPP::Int vertexId0, GPP::Int vertexId1)
+    {
+        if (vertexId0 > vertexId1)
+        {
+            std::swap(vertexId0, vertexId1);
+        }
+        return (GPP::ULongInt(vertexId0) << 32) | GPP::ULongInt(vertexId1);
+    }
+
+    // Cells out of 21 bits share keys with other cells, which only costs more distance tests
+    static GPP::ULongInt CellKey(GPP::Int cellX, GPP::Int cellY, GPP::Int cellZ)
+    {
+        const GPP::ULongInt cellMask = 0x1FFFFF;
+        return ((GPP::ULongInt(cellX) & cellMask) << 42) | ((GPP::ULongInt(cellY) & cellMask) << 21) | (GPP::ULongInt(cellZ) & cellMask);
+    }
+
+    // Keep the part of the mesh where direction * (coord[axis] - planeValue) <= 0. Vertices inserted on an edge
+    // are shared by its two triangles, and they are exactly on the plane.
+    static void ClipMeshByPlane(int axis, GPP::Real planeValue, GPP::Real direction, std::vector<GPP::Vector3>& vertexCoords,
+        std::vector<GPP::Vector3>& vertexColors, std::vector<GPP::Int>& triangleVertexIds)
+    {
+        bool hasColor = !vertexColors.empty();
+        std::vector<GPP::Int> clippedVertexIds;
+        clippedVertexIds.reserve(triangleVertexIds.size());
+        std::map<GPP::ULongInt, GPP::Int> edgeVertexIds;
+        for (GPP::Int kid = 0; kid < GPP::Int(triangleVertexIds.size()); kid += 3)
+        {
+            GPP::Real distances[3];
+            int outsideCount = 0;
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                distances[fvid] = direction * (vertexCoords[triangleVertexIds[kid + fvid]][axis] - planeValue);
+                if (distances[fvid] > 0)
+                {
+                    outsideCount++;
+                }
+            }
+            if (outsideCount == 0)
+            {
+                clippedVertexIds.insert(clippedVertexIds.end(), triangleVertexIds.begin() + kid, triangleVertexIds.begin() + kid + 3);
+                continue;
+            }
+            else if (outsideCount == 3)
+            {
+                continue;
+            }
+            GPP::Int polygonIds[4];
+            int polygonSize = 0;
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                int nextId = (fvid + 1) % 3;
+                GPP::Int vid = triangleVertexIds[kid + fvid];
+                GPP::Int nextVid = triangleVertexIds[kid + nextId];
+                if (distances[fvid] <= 0)
+                {
+                    polygonIds[polygonSize++] = vid;
+                }
+                if ((distances[fvid] <= 0) == (distances[nextId] <= 0) || distances[fvid] == 0 || distances[nextId] == 0)
+                {
+                    continue;
+                }
+                GPP::ULongInt edgeKey = EdgeKey(vid, nextVid);
+                std::map<GPP::ULongInt, GPP::Int>::iterator itr = edgeVertexIds.find(edgeKey);
+                if (itr == edgeVertexIds.end())
+                {
+                    GPP::Real weight = distances[fvid] / (distances[fvid] - distances[nextId]);
+                    GPP::Vector3 coord = vertexCoords[vid] + (vertexCoords[nextVid] - vertexCoords[vid]) * weight;
+                    coord[axis] = planeValue;
+                    vertexCoords.push_back(coord);
+                    if (hasColor)
+                    {
+                        vertexColors.push_back(vertexColors[vid] + (vertexColors[nextVid] - vertexColors[vid]) * weight);
+                    }
+                    itr = edgeVertexIds.insert(std::make_pair(edgeKey, GPP::Int(vertexCoords.size()) - 1)).first;
+                }
+                polygonIds[polygonSize++] = itr->second;
+            }
+            for (int pid = 1; pid + 1 < polygonSize; pid++)
+            {
+                clippedVertexIds.push_back(polygonIds[0]);
+                clippedVertexIds.push_back(polygonIds[pid]);
+                clippedVertexIds.push_back(polygonIds[pid + 1]);
+            }
+        }
+        triangleVertexIds.swap(clippedVertexIds);
+    }
+
+    // Boundary edges of the two sides of a seam plane, low side blocks are below the plane
+    struct SeamPlane
+    {
+        std::vector<std::pair<GPP::Int, GPP::Int> > lowEdges;
+        std::vector<std::pair<GPP::Int, GPP::Int> > highEdges;
+    };
+
+    struct SeamChain
+    {
+        std::vector<GPP::Int> vertexIds;
+        bool isClosed;
+    };
+
+    // Chains follow the edge directions, or the reverse directions if isReversed
+    static void BuildSeamChains(const std::vector<std::pair<GPP::Int, GPP::Int> >& directedEdges, bool isReversed,
+        std::vector<SeamChain>& chains)
+    {
+        std::map<GPP::Int, GPP::Int> nextVertexIds;
+        std::map<GPP::Int, GPP::Int> inDegrees;
+        for (std::vector<std::pair<GPP::Int, GPP::Int> >::const_iterator itr = directedEdges.begin(); itr != directedEdges.end(); ++itr)
+        {
+            GPP::Int fromId = isReversed ? itr->second : itr->first;
+            GPP::Int toId = isReversed ? itr->first : itr->second;
+            // A pinched vertex keeps one of its outgoing edges, the others are left to hole filling
+            if (nextVertexIds.insert(std::make_pair(fromId, toId)).second)
+            {
+                inDegrees[toId]++;
+                inDegrees[fromId];
+            }
+        }
+        std::set<GPP::Int> visitedIds;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            // Open chains start from vertices without incoming edges, then the rest are loops
+            for (std::map<GPP::Int, GPP::Int>::iterator itr = nextVertexIds.begin(); itr != nextVertexIds.end(); ++itr)
+            {
+                if (visitedIds.count(itr->first) > 0 || (pass == 0 && inDegrees[itr->first] > 0))
+                {
+                    continue;
+                }
+                SeamChain chain;
+                chain.isClosed = false;
+                GPP::Int vid = itr->first;
+                while (true)
+                {
+                    chain.vertexIds.push_back(vid);
+                    visitedIds.insert(vid);
+                    std::map<GPP::Int, GPP::Int>::iterator nextItr = nextVertexIds.find(vid);
+                    if (nextItr == nextVertexIds.end())
+                    {
+                        break;
+                    }
+                    vid = nextItr->second;
+                    if (vid == chain.vertexIds.front())
+                    {
+                        chain.isClosed = true;
+                        break;
+                    }
+                    if (visitedIds.count(vid) > 0)
+                    {
+                        break;
+                    }
+                }
+                chains.push_back(chain);
+            }
+        }
+    }
+
+    // Triangulate the strip between two chains which run in the same direction, lowIds is on the left
+    static void ZipChains(const std::vector<GPP::Vector3>& vertexCoords, const std::vector<GPP::Int>& lowIds,
+        const std::vector<GPP::Int>& highIds, std::vector<GPP::Int>& triangleVertexIds)
+    {
+        GPP::Int lowLast = GPP::Int(lowIds.size()) - 1;
+        GPP::Int highLast = GPP::Int(highIds.size()) - 1;
+        GPP::Int lowId = 0;
+        GPP::Int highId = 0;
+        while (lowId < lowLast || highId < highLast)
+        {
+            bool isLowStep = (highId == highLast);
+            if (lowId < lowLast && highId < highLast)
+            {
+                isLowStep = (vertexCoords[lowIds[lowId + 1]] - vertexCoords[highIds[highId]]).Length() <=
+                    (vertexCoords[lowIds[lowId]] - vertexCoords[highIds[highId + 1]]).Length();
+            }
+            if (isLowStep)
+            {
+                triangleVertexIds.push_back(lowIds[lowId + 1]);
+                triangleVertexIds.push_back(lowIds[lowId]);
+                triangleVertexIds.push_back(highIds[highId]);
+                lowId++;
+            }
+            else
+            {
+                triangleVertexIds.push_back(highIds[highId]);
+                triangleVertexIds.push_back(highIds[highId + 1]);
+                triangleVertexIds.push_back(lowIds[lowId]);
+                highId++;
+            }
+        }
+    }
+
+    // Each low side chain is split into runs whose nearest high side vertices go forward along one high side chain,
+    // and every run is zipped with that part of the high side chain
+    static void ZipSeamPlane(const SeamPlane& seamPlane, const std::vector<GPP::Vector3>& vertexCoords, GPP::Real searchRadius,
+        std::vector<GPP::Int>& triangleVertexIds)
+    {
+        std::vector<SeamChain> lowChains, highChains;
+        BuildSeamChains(seamPlane.lowEdges, false, lowChains);
+        // Both sides are oriented consistently, so high side boundaries run in the opposite direction
+        BuildSeamChains(seamPlane.highEdges, true, highChains);
+        if (lowChains.empty() || highChains.empty())
+        {
+            return;
+        }
+        std::vector<std::pair<GPP::ULongInt, std::pair<GPP::Int, GPP::Int> > > highCells;
+        std::vector<std::vector<bool> > usedHighEdges(highChains.size());
+        for (GPP::Int cid = 0; cid < GPP::Int(highChains.size()); cid++)
+        {
+            const std::vector<GPP::Int>& chainIds = highChains[cid].vertexIds;
+            for (GPP::Int pid = 0; pid < GPP::Int(chainIds.size()); pid++)
+            {
+                const GPP::Vector3& coord = vertexCoords[chainIds[pid]];
+                highCells.push_back(std::make_pair(CellKey(GPP::Int(floor(coord[0] / searchRadius)), GPP::Int(floor(coord[1] / searchRadius)),
+                    GPP::Int(floor(coord[2] / searchRadius))), std::make_pair(cid, pid)));
+            }
+            usedHighEdges[cid].resize(chainIds.size(), false);
+        }
+        std::sort(highCells.begin(), highCells.end());
+
+        for (std::vector<SeamChain>::iterator chainItr = lowChains.begin(); chainItr != lowChains.end(); ++chainItr)
+        {
+            const std::vector<GPP::Int>& lowChainIds = chainItr->vertexIds;
+            GPP::Int lowCount = lowChainIds.size();
+            // Nearest high side vertex of each low side vertex: (chain, position)
+            std::vector<std::pair<GPP::Int, GPP::Int> > nearestIds(lowCount, std::make_pair(GPP::Int(-1), GPP::Int(-1)));
+            for (GPP::Int pid = 0; pid < lowCount; pid++)
+            {
+                const GPP::Vector3& coord = vertexCoords[lowChainIds[pid]];
+                GPP::Int cellIndex[3] = {GPP::Int(floor(coord[0] / searchRadius)), GPP::Int(floor(coord[1] / searchRadius)),
+                    GPP::Int(floor(coord[2] / searchRadius))};
+                GPP::Real nearestDistance = searchRadius;
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        for (int dz = -1; dz <= 1; dz++)
+                        {
+                            GPP::ULongInt cellKey = CellKey(cellIndex[0] + dx, cellIndex[1] + dy, cellIndex[2] + dz);
+                            std::vector<std::pair<GPP::ULongInt, std::pair<GPP::Int, GPP::Int> > >::iterator itr = std::lower_bound(highCells.begin(),
+                                highCells.end(), std::make_pair(cellKey, std::make_pair(GPP::Int(-1), GPP::Int(-1))));
+                            for (; itr != highCells.end() && itr->first == cellKey; ++itr)
+                            {
+                                GPP::Real distance = (vertexCoords[highChains[itr->second.first].vertexIds[itr->second.second]] - coord).Length();
+                                if (distance < nearestDistance)
+                                {
+                                    nearestDistance = distance;
+                                    nearestIds[pid] = itr->second;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            // A loop starts where its nearest chain changes, so that no run is cut by the start
+            GPP::Int startId = 0;
+            if (chainItr->isClosed)
+            {
+                for (GPP::Int pid = 1; pid < lowCount; pid++)
+                {
+                    if (nearestIds[pid].first != nearestIds[pid - 1].first)
+                    {
+                        startId = pid;
+                        break;
+                    }
+                }
+            }
+            bool isWholeLoop = chainItr->isClosed && startId == 0 && nearestIds[0].first != -1 &&
+                highChains[nearestIds[0].first].isClosed;
+            GPP::Int visitCount = isWholeLoop ? lowCount + 1 : lowCount;
+            GPP::Int runStart = 0;
+            for (GPP::Int rid = 1; rid <= visitCount; rid++)
+            {
+                const std::pair<GPP::Int, GPP::Int>& runNearest = nearestIds[(startId + runStart) % lowCount];
+                bool isRunEnd = (rid == visitCount);
+                if (!isRunEnd)
+                {
+                    const std::pair<GPP::Int, GPP::Int>& prevNearest = nearestIds[(startId + rid - 1) % lowCount];
+                    const std::pair<GPP::Int, GPP::Int>& curNearest = nearestIds[(startId + rid) % lowCount];
+                    GPP::Int highCount = curNearest.first == -1 ? 0 : highChains[curNearest.first].vertexIds.size();
+                    GPP::Int step = curNearest.second - prevNearest.second;
+                    if (curNearest.first != -1 && highChains[curNearest.first].isClosed && step < 0)
+                    {
+                        step += highCount;
+                    }
+                    isRunEnd = (curNearest.first != runNearest.first || step < 0 || step * 2 > highCount);
+                }
+                if (!isRunEnd)
+                {
+                    continue;
+                }
+                if (runNearest.first != -1)
+                {
+                    const SeamChain& highChain = highChains[runNearest.first];
+                    GPP::Int highCount = highChain.vertexIds.size();
+                    std::vector<GPP::Int> lowIds, highIds;
+                    for (GPP::Int pid = runStart; pid < rid; pid++)
+                    {
+                        lowIds.push_back(lowChainIds[(startId + pid) % lowCount]);
+                    }
+                    GPP::Int highStart = runNearest.second;
+                    GPP::Int highEnd = nearestIds[(startId + rid - 1) % lowCount].second;
+                    GPP::Int highLength = highEnd - highStart;
+                    if (isWholeLoop && runStart == 0 && rid == visitCount)
+                    {
+                        highLength = highCount;
+                    }
+                    else if (highLength < 0 && highChain.isClosed)
+                    {
+                        highLength += highCount;
+                    }
+                    bool isUsed = false;
+                    for (GPP::Int pid = 0; pid < highLength && !isUsed; pid++)
+                    {
+                        isUsed = usedHighEdges[runNearest.first][(highStart + pid) % highCount];
+                    }
+                    if (!isUsed && highLength >= 0 && lowIds.size() + highLength > 1)
+                    {
+                        for (GPP::Int pid = 0; pid <= highLength; pid++)
+                        {
+                            highIds.push_back(highChain.vertexIds[(highStart + pid) % highCount]);
+                        }
+                        for (GPP::Int pid = 0; pid < highLength; pid++)
+                        {
+                            usedHighEdges[runNearest.first][(highStart + pid) % highCount] = true;
+                        }
+                        ZipChains(vertexCoords, lowIds, highIds, triangleVertexIds);
+                    }
+                }
+                runStart = rid;
+            }
+        }
+    }
+
+    class BlockReconstructionTask : public ParallelTask
+    {
+    public:
+        BlockReconstructionTask(BlockReconstruction* reconstruction, GPP::Int quality, bool needFillHole,
+            std::vector<GPP::ErrorCode>* blockResults) :
+            mpReconstruction(reconstruction),
+            mQuality(quality),
+            mNeedFillHole(needFillHole),
+            mpBlockResults(blockResults)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                mpBlockResults->at(blockId) = mpReconstruction->ReconstructBlock(blockId, mQuality, mNeedFillHole);
+            }
+        }
+
+    private:
+        BlockReconstruction* mpReconstruction;
+        GPP::Int mQuality;
+        bool mNeedFillHole;
+        std::vector<GPP::ErrorCode>* mpBlockResults;
+    };
+
+    BlockReconstruction::BlockReconstruction() :
+        mPointFileName(),
+        mPointCount(0),
+        mHasColor(false),
+        mIsByteColor(false),
+        mRecordSize(6),
+        mRootMin(),
+        mRootMax(),
+        mOverlapSize(0),
+        mBlockCount(0),
+        mBlockFileCount(0),
+        mBlocks(),
+        mPatches()
+    {
+    }
+
+    BlockReconstruction::~BlockReconstruction()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode BlockReconstruction::Reconstruct(const std::string& pointFileName, GPP::TriMesh* triMesh, GPP::Int quality,
+        bool needFillHole, GPP::Int blockPointBudget)
+    {
+        if (triMesh == NULL || blockPointBudget < gMinBlockPointCount)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        Clear();
+        mPointFileName = pointFileName;
+        mPointCount = 0;
+        mHasColor = false;
+        mIsByteColor = false;
+        mBlockCount = 0;
+        mBlockFileCount = 0;
+        PointBlock rootBlock;
+        GPP::ErrorCode res = StreamPointFile(pointFileName, rootBlock);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+            return res;
+        }
+        res = PartitionBlocks(rootBlock, blockPointBudget);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+            return res;
+        }
+        GPP::Int blockCount = mBlocks.size();
+        mBlockCount = blockCount;
+        InfoLog << "BlockReconstruction: " << mPointCount << " points in " << blockCount << " blocks" << std::endl;
+
+        mPatches.clear();
+        mPatches.resize(blockCount);
+        std::vector<GPP::ErrorCode> blockResults(blockCount, GPP_NO_ERROR);
+        BlockReconstructionTask task(this, quality, needFillHole, &blockResults);
+        ThreadPool::Get()->ParallelFor(blockCount, &task, 1);
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            if (blockResults[blockId] != GPP_NO_ERROR)
+            {
+                ErrorLog << "BlockReconstruction: block " << blockId << " failed" << std::endl;
+                Clear();
+                return blockResults[blockId];
+            }
+        }
+
+        res = StitchPatches(triMesh);
+        Clear();
+        return res;
+    }
+
+    GPP::Int BlockReconstruction::GetPointCount() const
+    {
+        return mPointCount;
+    }
+
+    GPP::Int BlockReconstruction::GetBlockCount() const
+    {
+        return mBlockCount;
+    }
+
+    bool BlockReconstruction::HasColor() const
+    {
+        return mHasColor;
+    }
+
+    GPP::ErrorCode BlockReconstruction::StreamPointFile(const std::string& pointFileName, PointBlock& rootBlock)
+    {
+        FILE* pointFile = fopen(pointFileName.c_str(), "r");
+        if (pointFile == NULL)
+        {
+            ErrorLog << "BlockReconstruction: can not open " << pointFileName << std::endl;
+            return GPP_INVALID_INPUT;
+        }
+        // The field count of the first valid line decides the record layout
+        char line[gMaxLineLength];
+        double record[9];
+        int fieldCount = 0;
+        while (fieldCount == 0 && fgets(line, gMaxLineLength, pointFile) != NULL)
+        {
+            std::replace(line, line + strlen(line), ',', ' ');
+            int readCount = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", record, record + 1, record + 2,
+                record + 3, record + 4, record + 5, record + 6, record + 7, record + 8);
+            if (readCount >= 3)
+            {
+                fieldCount = readCount;
+            }
+        }
+        if (fieldCount < 6)
+        {
+            ErrorLog << "BlockReconstruction: points need normals, field count " << fieldCount << std::endl;
+            fclose(pointFile);
+            return GPP_INVALID_INPUT;
+        }
+        mHasColor = (fieldCount >= 9);
+        mRecordSize = mHasColor ? 9 : 6;
+
+        rootBlock.fileName = CreateBlockFileName();
+        BlockFileWriter writer(rootBlock.fileName, mRecordSize);
+        GPP::Vector3 bboxMin(GPP::REAL_LARGE, GPP::REAL_LARGE, GPP::REAL_LARGE);
+        GPP::Vector3 bboxMax(-GPP::REAL_LARGE, -GPP::REAL_LARGE, -GPP::REAL_LARGE);
+        do
+        {
+            std::replace(line, line + strlen(line), ',', ' ');
+            int readCount = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", record, record + 1, record + 2,
+                record + 3, record + 4, record + 5, record + 6, record + 7, record + 8);
+            if (readCount < mRecordSize)
+            {
+                continue;
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = std::min(bboxMin[axis], record[axis]);
+                bboxMax[axis] = std::max(bboxMax[axis], record[axis]);
+            }
+            if (mHasColor && (record[6] > 1 || record[7] > 1 || record[8] > 1))
+            {
+                mIsByteColor = true;
+            }
+            writer.Write(record);
+        } while (fgets(line, gMaxLineLength, pointFile) != NULL);
+        fclose(pointFile);
+        rootBlock.pointCount = writer.GetRecordCount();
+        if (!writer.Close())
+        {
+            ErrorLog << "BlockReconstruction: write block file failed " << rootBlock.fileName << std::endl;
+            remove(rootBlock.fileName.c_str());
+            return GPP_INVALID_RESULT;
+        }
+        mPointCount = rootBlock.pointCount;
+        if (mPointCount < gMinBlockPointCount)
+        {
+            remove(rootBlock.fileName.c_str());
+            return GPP_INVALID_INPUT;
+        }
+
+        // Max sides are open in IsInBox, so the root box is a little larger than the bounding box
+        GPP::Real bboxSize = (bboxMax - bboxMin).Length();
+        GPP::Vector3 bboxPadding(bboxSize, bboxSize, bboxSize);
+        bboxPadding *= 1.0e-6;
+        rootBlock.coreMin = bboxMin - bboxPadding;
+        rootBlock.coreMax = bboxMax + bboxPadding;
+        mRootMin = rootBlock.coreMin;
+        mRootMax = rootBlock.coreMax;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BlockReconstruction::PartitionBlocks(PointBlock& rootBlock, GPP::Int blockPointBudget)
+    {
+        // One overlap size for all blocks, so a child block always reads all its points from its parent.
+        // Points lie on a surface, so the block count grows with the square of the block count per side.
+        GPP::Real expectedBlockCount = std::max(1.0, GPP::Real(mPointCount) / blockPointBudget);
+        GPP::Real expectedBlockSize = (rootBlock.coreMax - rootBlock.coreMin).Length() / sqrt(expectedBlockCount);
+        mOverlapSize = expectedBlockSize * gBlockOverlapRatio;
+
+        std::vector<PointBlock> pendingBlocks(1, rootBlock);
+        while (!pendingBlocks.empty())
+        {
+            PointBlock block = pendingBlocks.back();
+            pendingBlocks.pop_back();
+            GPP::Vector3 coreSize = block.coreMax - block.coreMin;
+            GPP::Real maxCoreSize = std::max(coreSize[0], std::max(coreSize[1], coreSize[2]));
+            if (block.pointCount <= blockPointBudget || maxCoreSize < mOverlapSize * 4)
+            {
+                if (block.pointCount > blockPointBudget)
+                {
+                    InfoLog << "BlockReconstruction: dense block of " << block.pointCount << " points is not split" << std::endl;
+                }
+                mBlocks.push_back(block);
+                continue;
+            }
+            PointBlock lowBlock, highBlock;
+            GPP::ErrorCode res = SplitBlock(block, lowBlock, highBlock);
+            remove(block.fileName.c_str());
+            if (res != GPP_NO_ERROR)
+            {
+                remove(lowBlock.fileName.c_str());
+                remove(highBlock.fileName.c_str());
+                for (std::vector<PointBlock>::iterator itr = pendingBlocks.begin(); itr != pendingBlocks.end(); ++itr)
+                {
+                    remove(itr->fileName.c_str());
+                }
+                return res;
+            }
+            if (lowBlock.pointCount > 0)
+            {
+                pendingBlocks.push_back(lowBlock);
+            }
+            else
+            {
+                remove(lowBlock.fileName.c_str());
+            }
+            if (highBlock.pointCount > 0)
+            {
+                pendingBlocks.push_back(highBlock);
+            }
+            else
+            {
+                remove(highBlock.fileName.c_str());
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BlockReconstruction::SplitBlock(const PointBlock& block, PointBlock& lowBlock, PointBlock& highBlock)
+    {
+        GPP::Vector3 coreSize = block.coreMax - block.coreMin;
+        int splitAxis = 0;
+        for (int axis = 1; axis < 3; axis++)
+        {
+            if (coreSize[axis] > coreSize[splitAxis])
+            {
+                splitAxis = axis;
+            }
+        }
+        GPP::Real splitValue = (block.coreMin[splitAxis] + block.coreMax[splitAxis]) / 2.0;
+        lowBlock.coreMin = block.coreMin;
+        lowBlock.coreMax = block.coreMax;
+        lowBlock.coreMax[splitAxis] = splitValue;
+        highBlock.coreMin = block.coreMin;
+        highBlock.coreMax = block.coreMax;
+        highBlock.coreMin[splitAxis] = splitValue;
+        lowBlock.fileName = CreateBlockFileName();
+        highBlock.fileName = CreateBlockFileName();
+        lowBlock.pointCount = 0;
+        highBlock.pointCount = 0;
+
+        FILE* blockFile = fopen(block.fileName.c_str(), "rb");
+        if (blockFile == NULL)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        BlockFileWriter lowWriter(lowBlock.fileName, mRecordSize);
+        BlockFileWriter highWriter(highBlock.fileName, mRecordSize);
+        std::vector<double> records;
+        GPP::Int readCount = 0;
+        while ((readCount = ReadRecordChunk(blockFile, mRecordSize, records)) > 0)
+        {
+            for (GPP::Int rid = 0; rid < readCount; rid++)
+            {
+                const double* record = &records[rid * mRecordSize];
+                if (IsInBox(record, lowBlock.coreMin, lowBlock.coreMax, mOverlapSize))
+                {
+                    lowWriter.Write(record);
+                }
+                if (IsInBox(record, highBlock.coreMin, highBlock.coreMax, mOverlapSize))
+                {
+                    highWriter.Write(record);
+                }
+            }
+        }
+        fclose(blockFile);
+        lowBlock.pointCount = lowWriter.GetRecordCount();
+        highBlock.pointCount = highWriter.GetRecordCount();
+        bool isLowValid = lowWriter.Close();
+        bool isHighValid = highWriter.Close();
+        if (!isLowValid || !isHighValid)
+        {
+            ErrorLog << "BlockReconstruction: write block file failed" << std::endl;
+            return GPP_INVALID_RESULT;
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BlockReconstruction::ReconstructBlock(GPP::Int blockId, GPP::Int quality, bool needFillHole)
+    {
+        const PointBlock& block = mBlocks[blockId];
+        BlockPatch& patch = mPatches[blockId];
+        if (block.pointCount < gMinBlockPointCount)
+        {
+            return GPP_NO_ERROR;
+        }
+        FILE* blockFile = fopen(block.fileName.c_str(), "rb");
+        if (blockFile == NULL)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        // Block points are moved to a unified box, like a point cloud imported in memory
+        GPP::Vector3 blockCenter = (block.coreMin + block.coreMax) / 2.0;
+        GPP::Vector3 blockSize = block.coreMax - block.coreMin;
+        GPP::Real blockScale = 2.0 / (std::max(blockSize[0], std::max(blockSize[1], blockSize[2])) + mOverlapSize * 2);
+        GPP::Real colorScale = mIsByteColor ? 1.0 / 255.0 : 1.0;
+        GPP::PointCloud* pointCloud = new GPP::PointCloud(true, mHasColor);
+        pointCloud->ReservePoint(block.pointCount);
+        std::vector<GPP::Real> pointColorFields;
+        std::vector<double> records;
+        GPP::Int readCount = 0;
+        while ((readCount = ReadRecordChunk(blockFile, mRecordSize, records)) > 0)
+        {
+            for (GPP::Int rid = 0; rid < readCount; rid++)
+            {
+                const double* record = &records[rid * mRecordSize];
+                GPP::Vector3 coord(record[0], record[1], record[2]);
+                GPP::Int pointId = pointCloud->InsertPoint((coord - blockCenter) * blockScale, GPP::Vector3(record[3], record[4], record[5]));
+                if (mHasColor)
+                {
+                    GPP::Vector3 color(record[6] * colorScale, record[7] * colorScale, record[8] * colorScale);
+                    pointCloud->SetPointColor(pointId, color);
+                    pointColorFields.push_back(color[0]);
+                    pointColorFields.push_back(color[1]);
+                    pointColorFields.push_back(color[2]);
+                }
+            }
+        }
+        fclose(blockFile);
+
+        GPP::TriMesh* blockMesh = new GPP::TriMesh;
+        std::vector<GPP::Real> vertexColorFields;
+        GPP::ErrorCode res = GPP::ReconstructMesh::Reconstruct(pointCloud, blockMesh, quality, needFillHole,
+            mHasColor ? &pointColorFields : NULL, mHasColor ? &vertexColorFields : NULL, gMaxHoleAreaRatio);
+        GPPFREEPOINTER(pointCloud);
+        if (res != GPP_NO_ERROR)
+        {
+            GPPFREEPOINTER(blockMesh);
+            return res;
+        }
+
+        // Clip the block mesh by the core faces shared with other blocks, so both sides of a seam end on the same plane
+        GPP::Int vertexCount = blockMesh->GetVertexCount();
+        GPP::Int triangleCount = blockMesh->GetTriangleCount();
+        std::vector<GPP::Vector3> vertexCoords(vertexCount);
+        std::vector<GPP::Vector3> vertexColors(mHasColor ? vertexCount : 0);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            vertexCoords[vid] = blockMesh->GetVertexCoord(vid) / blockScale + blockCenter;
+            if (mHasColor)
+            {
+                vertexColors[vid] = GPP::Vector3(vertexColorFields[vid * 3], vertexColorFields[vid * 3 + 1], vertexColorFields[vid * 3 + 2]);
+            }
+        }
+        std::vector<GPP::Int> triangleVertexIds(triangleCount * 3);
+        for (GPP::Int fid = 0; fid < triangleCount; fid++)
+        {
+            blockMesh->GetTriangleVertexIds(fid, &triangleVertexIds[fid * 3]);
+        }
+        GPPFREEPOINTER(blockMesh);
+        std::vector<std::pair<int, GPP::Real> > seamPlanes;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (block.coreMin[axis] != mRootMin[axis])
+            {
+                ClipMeshByPlane(axis, block.coreMin[axis], -1.0, vertexCoords, vertexColors, triangleVertexIds);
+                seamPlanes.push_back(std::make_pair(axis, block.coreMin[axis]));
+            }
+            if (block.coreMax[axis] != mRootMax[axis])
+            {
+                ClipMeshByPlane(axis, block.coreMax[axis], 1.0, vertexCoords, vertexColors, triangleVertexIds);
+                seamPlanes.push_back(std::make_pair(axis, block.coreMax[axis]));
+            }
+        }
+
+        std::vector<GPP::Int> patchVertexIds(vertexCoords.size(), -1);
+        patch.edgeLengthSum = 0;
+        patch.edgeCount = 0;
+        for (GPP::Int kid = 0; kid < GPP::Int(triangleVertexIds.size()); kid += 3)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vid = triangleVertexIds[kid + fvid];
+                if (patchVertexIds[vid] == -1)
+                {
+                    patchVertexIds[vid] = patch.vertexCoords.size();
+                    patch.vertexCoords.push_back(vertexCoords[vid]);
+                    // Clipped vertices are exactly on their planes
+                    bool isSeam = false;
+                    for (std::vector<std::pair<int, GPP::Real> >::iterator itr = seamPlanes.begin(); itr != seamPlanes.end() && !isSeam; ++itr)
+                    {
+                        isSeam = (vertexCoords[vid][itr->first] == itr->second);
+                    }
+                    patch.seamFlags.push_back(isSeam);
+                    if (mHasColor)
+                    {
+                        patch.vertexColors.push_back(vertexColors[vid]);
+                    }
+                }
+                patch.triangleVertexIds.push_back(patchVertexIds[vid]);
+                patch.edgeLengthSum += (vertexCoords[vid] - vertexCoords[triangleVertexIds[kid + (fvid + 1) % 3]]).Length();
+                patch.edgeCount++;
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode BlockReconstruction::StitchPatches(GPP::TriMesh* triMesh)
+    {
+        GPP::Int blockCount = mPatches.size();
+        GPP::Int vertexCount = 0;
+        GPP::Real edgeLengthSum = 0;
+        GPP::Int edgeCount = 0;
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            vertexCount += mPatches[blockId].vertexCoords.size();
+            edgeLengthSum += mPatches[blockId].edgeLengthSum;
+            edgeCount += mPatches[blockId].edgeCount;
+        }
+        if (vertexCount == 0 || edgeCount == 0)
+        {
+            return GPP_INVALID_RESULT;
+        }
+        GPP::Real searchRadius = edgeLengthSum / edgeCount * gSeamSearchRatio;
+
+        // Merge patches, and collect their boundary edges on seam planes
+        std::vector<GPP::Vector3> vertexCoords;
+        std::vector<GPP::Vector3> vertexColors;
+        std::vector<bool> seamFlags;
+        std::vector<GPP::Int> triangleVertexIds;
+        vertexCoords.reserve(vertexCount);
+        std::map<std::pair<int, GPP::Real>, SeamPlane> seamPlanes;
+        for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+        {
+            BlockPatch& patch = mPatches[blockId];
+            const PointBlock& block = mBlocks[blockId];
+            GPP::Int vertexOffset = vertexCoords.size();
+            vertexCoords.insert(vertexCoords.end(), patch.vertexCoords.begin(), patch.vertexCoords.end());
+            vertexColors.insert(vertexColors.end(), patch.vertexColors.begin(), patch.vertexColors.end());
+            seamFlags.insert(seamFlags.end(), patch.seamFlags.begin(), patch.seamFlags.end());
+            std::vector<std::pair<GPP::ULongInt, std::pair<GPP::Int, GPP::Int> > > patchEdges;
+            patchEdges.reserve(patch.triangleVertexIds.size());
+            for (GPP::Int kid = 0; kid < GPP::Int(patch.triangleVertexIds.size()); kid += 3)
+            {
+                for (int fvid = 0; fvid < 3; fvid++)
+                {
+                    GPP::Int vid0 = vertexOffset + patch.triangleVertexIds[kid + fvid];
+                    GPP::Int vid1 = vertexOffset + patch.triangleVertexIds[kid + (fvid + 1) % 3];
+                    triangleVertexIds.push_back(vid0);
+                    if (seamFlags[vid0] && seamFlags[vid1])
+                    {
+                        patchEdges.push_back(std::make_pair(EdgeKey(vid0, vid1), std::make_pair(vid0, vid1)));
+                    }
+                }
+            }
+            std::vector<GPP::Vector3>().swap(patch.vertexCoords);
+            std::vector<GPP::Vector3>().swap(patch.vertexColors);
+            std::vector<GPP::Int>().swap(patch.triangleVertexIds);
+            std::sort(patchEdges.begin(), patchEdges.end());
+            for (GPP::Int eid = 0; eid < GPP::Int(patchEdges.size()); eid++)
+            {
+                if ((eid > 0 && patchEdges[eid - 1].first == patchEdges[eid].first) ||
+                    (eid + 1 < GPP::Int(patchEdges.size()) && patchEdges[eid + 1].first == patchEdges[eid].first))
+                {
+                    continue;
+                }
+                const GPP::Vector3& coord0 = vertexCoords[patchEdges[eid].second.first];
+                const GPP::Vector3& coord1 = vertexCoords[patchEdges[eid].second.second];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (block.coreMax[axis] != mRootMax[axis] && coord0[axis] == block.coreMax[axis] && coord1[axis] == block.coreMax[axis])
+                    {
+                        seamPlanes[std::make_pair(axis, block.coreMax[axis])].lowEdges.push_back(patchEdges[eid].second);
+                        break;
+                    }
+                    if (block.coreMin[axis] != mRootMin[axis] && coord0[axis] == block.coreMin[axis] && coord1[axis] == block.coreMin[axis])
+                    {
+                        seamPlanes[std::make_pair(axis, block.coreMin[axis])].highEdges.push_back(patchEdges[eid].second);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Zip the boundaries of the two sides of every seam plane
+        GPP::Int originalTriangleCount = triangleVertexIds.size() / 3;
+        for (std::map<std::pair<int, GPP::Real>, SeamPlane>::iterator itr = seamPlanes.begin(); itr != seamPlanes.end(); ++itr)
+        {
+            ZipSeamPlane(itr->second, vertexCoords, searchRadius, triangleVertexIds);
+        }
+        InfoLog << "BlockReconstruction: " << seamPlanes.size() << " seam planes, " << triangleVertexIds.size() / 3 - originalTriangleCount
+            << " zip triangles" << std::endl;
+        std::map<std::pair<int, GPP::Real>, SeamPlane>().swap(seamPlanes);
+
+        triMesh->Clear();
+        triMesh->SetHasVertexColor(mHasColor);
+        for (GPP::Int vid = 0; vid < vertexCount; vid++)
+        {
+            triMesh->InsertVertex(vertexCoords[vid]);
+            if (mHasColor)
+            {
+                triMesh->SetVertexColor(vid, vertexColors[vid]);
+            }
+        }
+        std::vector<GPP::Vector3>().swap(vertexCoords);
+        std::vector<GPP::Vector3>().swap(vertexColors);
+        for (GPP::Int kid = 0; kid < GPP::Int(triangleVertexIds.size()); kid += 3)
+        {
+            triMesh->InsertTriangle(triangleVertexIds[kid], triangleVertexIds[kid + 1], triangleVertexIds[kid + 2]);
+        }
+        std::vector<GPP::Int>().swap(triangleVertexIds);
+
+        std::map<GPP::Int, GPP::Int> insertVertexIdMap;
+        GPP::ErrorCode res = GPP::ConsolidateMesh::MakeTriMeshManifold(triMesh, &insertVertexIdMap);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        seamFlags.resize(triMesh->GetVertexCount(), false);
+        for (std::map<GPP::Int, GPP::Int>::iterator itr = insertVertexIdMap.begin(); itr != insertVertexIdMap.end(); ++itr)
+        {
+            seamFlags[itr->first] = seamFlags[itr->second];
+            if (mHasColor)
+            {
+                triMesh->SetVertexColor(itr->first, triMesh->GetVertexColor(itr->second));
+            }
+        }
+
+        // Fill the small gaps left at seam junctions, but not the holes of the surface itself
+        std::vector<std::vector<GPP::Int> > holeIds;
+        res = GPP::FillMeshHole::FindHoles(triMesh, &holeIds);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        std::vector<GPP::Int> seamSeedIds;
+        for (std::vector<std::vector<GPP::Int> >::iterator holeItr = holeIds.begin(); holeItr != holeIds.end(); ++holeItr)
+        {
+            GPP::Int seamCount = 0;
+            for (std::vector<GPP::Int>::iterator itr = holeItr->begin(); itr != holeItr->end(); ++itr)
+            {
+                if (seamFlags[*itr])
+                {
+                    seamCount++;
+                }
+            }
+            if (!holeItr->empty() && seamCount >= gSeamHoleRatio * holeItr->size())
+            {
+                seamSeedIds.push_back(holeItr->front());
+            }
+        }
+        // FillHoles fills all holes if seeds are empty
+        if (!seamSeedIds.empty())
+        {
+            GPP::Int oldVertexCount = triMesh->GetVertexCount();
+            std::vector<GPP::Real> vertexColorFields;
+            std::vector<GPP::Real> insertedColorFields;
+            if (mHasColor)
+            {
+                vertexColorFields.resize(oldVertexCount * 3);
+                for (GPP::Int vid = 0; vid < oldVertexCount; vid++)
+                {
+                    GPP::Vector3 color = triMesh->GetVertexColor(vid);
+                    vertexColorFields[vid * 3] = color[0];
+                    vertexColorFields[vid * 3 + 1] = color[1];
+                    vertexColorFields[vid * 3 + 2] = color[2];
+                }
+            }
+            res = GPP::FillMeshHole::FillHoles(triMesh, &seamSeedIds, GPP::FILL_MESH_HOLE_FLAT,
+                mHasColor ? &vertexColorFields : NULL, mHasColor ? &insertedColorFields : NULL);
+            if (res != GPP_NO_ERROR)
+            {
+                return res;
+            }
+            if (mHasColor)
+            {
+                GPP::Int insertedCount = std::min(triMesh->GetVertexCount() - oldVertexCount, GPP::Int(insertedColorFields.size() / 3));
+                for (GPP::Int iid = 0; iid < insertedCount; iid++)
+                {
+                    triMesh->SetVertexColor(oldVertexCount + iid, GPP::Vector3(insertedColorFields[iid * 3],
+                        insertedColorFields[iid * 3 + 1], insertedColorFields[iid * 3 + 2]));
+                }
+            }
+            InfoLog << "BlockReconstruction: " << seamSeedIds.size() << " seam gaps are filled" << std::endl;
+        }
+        triMesh->UpdateNormal();
+        return GPP_NO_ERROR;
+    }
+
+    std::string BlockReconstruction::CreateBlockFileName()
+    {
+        char postfix[32];
+        sprintf(postfix, ".block%d.tmp", mBlockFileCount++);
+        return mPointFileName + postfix;
+    }
+
+    void BlockReconstruction::Clear()
+    {
+        for (std::vector<PointBlock>::iterator itr = mBlocks.begin(); itr != mBlocks.end(); ++itr)
+        {
+            remove(itr->fileName.c_str());
+        }
+        mBlocks.clear();
+        mPatches.clear();
+    }
+}
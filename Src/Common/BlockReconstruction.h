@@ -0,0 +1,76 @@
+#pragma once
+#include "TriMesh.h"
+#include <string>
+#include <vector>
+
+namespace MagicCore
+{
+    // Points of a block are kept in a file on disk. Points in its core box belong to it, and points in the
+    // overlap around the core are only used as context of the reconstruction.
+    struct PointBlock
+    {
+        GPP::Vector3 coreMin;
+        GPP::Vector3 coreMax;
+        std::string fileName;
+        GPP::Int pointCount;
+    };
+
+    // Reconstructed triangles of a block clipped by its core box
+    struct BlockPatch
+    {
+        std::vector<GPP::Vector3> vertexCoords;
+        std::vector<GPP::Vector3> vertexColors;
+        std::vector<GPP::Int> triangleVertexIds;
+        // Vertices on the core faces which are shared with other blocks
+        std::vector<bool> seamFlags;
+        GPP::Real edgeLengthSum;
+        GPP::Int edgeCount;
+    };
+
+    // Surface reconstruction of point clouds which do not fit in memory.
+    // Points are streamed from a text file, one "x y z nx ny nz [r g b]" per line, into block files. A block with more
+    // points than the budget is split at the middle of its longest side. Blocks are reconstructed independently on
+    // ThreadPool and clipped by their cores, the two sides of each seam plane are zipped together, and the small gaps
+    // left where seams meet are filled.
+    // Peak memory is about thread count * block budget points plus the result mesh.
+    class BlockReconstruction
+    {
+    public:
+        BlockReconstruction();
+        ~BlockReconstruction();
+
+        // triMesh should be allocated memory first, its coordinates are the same as the point file
+        GPP::ErrorCode Reconstruct(const std::string& pointFileName, GPP::TriMesh* triMesh, GPP::Int quality,
+            bool needFillHole, GPP::Int blockPointBudget = 2000000);
+
+        GPP::Int GetPointCount(void) const;
+        GPP::Int GetBlockCount(void) const;
+        bool HasColor(void) const;
+
+    private:
+        friend class BlockReconstructionTask;
+        GPP::ErrorCode StreamPointFile(const std::string& pointFileName, PointBlock& rootBlock);
+        GPP::ErrorCode PartitionBlocks(PointBlock& rootBlock, GPP::Int blockPointBudget);
+        GPP::ErrorCode SplitBlock(const PointBlock& block, PointBlock& lowBlock, PointBlock& highBlock);
+        GPP::ErrorCode ReconstructBlock(GPP::Int blockId, GPP::Int quality, bool needFillHole);
+        GPP::ErrorCode StitchPatches(GPP::TriMesh* triMesh);
+        std::string CreateBlockFileName(void);
+        void Clear(void);
+
+    private:
+        std::string mPointFileName;
+        GPP::Int mPointCount;
+        bool mHasColor;
+        // Colors of the point file are in [0, 255]
+        bool mIsByteColor;
+        int mRecordSize;
+        // Core faces on the root box are not seams
+        GPP::Vector3 mRootMin;
+        GPP::Vector3 mRootMax;
+        GPP::Real mOverlapSize;
+        GPP::Int mBlockCount;
+        GPP::Int mBlockFileCount;
+        std::vector<PointBlock> mBlocks;
+        std::vector<BlockPatch> mPatches;
+    };
+}
@@ -0,0 +1,449 @@
+#include "DepthStreamReader.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <windows.h>
+#include <process.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <deque>
+
+namespace MagicCore
+{
+    static const int gMaxStreamImageSize = 8192;
+    // A live stream keeps one pixel of every gDecimateStride x gDecimateStride block when the queue is half full
+    static const int gDecimateStride = 2;
+    // Neighbors whose depth differs more than this ratio are on another surface, they are not used for normals
+    static const GPP::Real gMaxDepthJumpRatio = 0.05;
+    // Milliseconds
+    static const int gStopCheckInterval = 100;
+
+    struct DepthStreamFrame
+    {
+        GPP::PointCloud* pointCloud;
+        int frameIndex;
+    };
+
+    // Synchronization objects are kept here to keep windows.h out of the header
+    struct DepthStreamContext
+    {
+        CRITICAL_SECTION queueLock;
+        CONDITION_VARIABLE frameQueued;
+        CONDITION_VARIABLE framePopped;
+        std::deque<DepthStreamFrame> frames;
+        HANDLE readThread;
+        FILE* streamFile;
+        bool isFinished;
+    };
+
+    static unsigned __stdcall RunReadThread(void *arg)
+    {
+        DepthStreamReader* reader = (DepthStreamReader*)arg;
+        if (reader == NULL)
+        {
+            return 0;
+        }
+        reader->ReadFrames();
+        return 1;
+    }
+
+    class DepthProjectTask : public ParallelTask
+    {
+    public:
+        DepthProjectTask(const DepthStreamReader* reader, const std::vector<unsigned short>* depths, int stride, int gridWidth,
+            std::vector<GPP::Vector3>* coords, std::vector<int>* validFlags) :
+            mpReader(reader),
+            mpDepths(depths),
+            mStride(stride),
+            mGridWidth(gridWidth),
+            mpCoords(coords),
+            mpValidFlags(validFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int row = startId; row < endId; row++)
+            {
+                mpReader->ProjectRow(*mpDepths, mStride, mGridWidth, row, *mpCoords, *mpValidFlags);
+            }
+        }
+
+    private:
+        const DepthStreamReader* mpReader;
+        const std::vector<unsigned short>* mpDepths;
+        int mStride;
+        int mGridWidth;
+        std::vector<GPP::Vector3>* mpCoords;
+        std::vector<int>* mpValidFlags;
+    };
+
+    class DepthNormalTask : public ParallelTask
+    {
+    public:
+        DepthNormalTask(const DepthStreamReader* reader, const std::vector<GPP::Vector3>* coords, const std::vector<int>* validFlags,
+            int gridWidth, int gridHeight, std::vector<GPP::Vector3>* normals, std::vector<int>* normalFlags) :
+            mpReader(reader),
+            mpCoords(coords),
+            mpValidFlags(validFlags),
+            mGridWidth(gridWidth),
+            mGridHeight(gridHeight),
+            mpNormals(normals),
+            mpNormalFlags(normalFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int row = startId; row < endId; row++)
+            {
+                mpReader->ComputeRowNormals(*mpCoords, *mpValidFlags, mGridWidth, mGridHeight, row, *mpNormals, *mpNormalFlags);
+            }
+        }
+
+    private:
+        const DepthStreamReader* mpReader;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<int>* mpValidFlags;
+        int mGridWidth;
+        int mGridHeight;
+        std::vector<GPP::Vector3>* mpNormals;
+        std::vector<int>* mpNormalFlags;
+    };
+
+    DepthStreamReader::DepthStreamReader() :
+        mpContext(NULL),
+        mInfo(),
+        mIsLive(false),
+        mQueueCapacity(0),
+        mIsStopping(false),
+        mRayX(),
+        mRayY(),
+        mReadCount(0),
+        mDroppedCount(0),
+        mDecimatedCount(0)
+    {
+    }
+
+    DepthStreamReader::~DepthStreamReader()
+    {
+        Close();
+    }
+
+    GPP::ErrorCode DepthStreamReader::Open(const std::string& streamName, int queueCapacity)
+    {
+        Close();
+        FILE* streamFile = fopen(streamName.c_str(), "rb");
+        if (streamFile == NULL)
+        {
+            ErrorLog << "DepthStreamReader: open " << streamName << " failed" << std::endl;
+            return GPP_INVALID_INPUT;
+        }
+        mpContext = new DepthStreamContext;
+        mpContext->streamFile = streamFile;
+        mpContext->readThread = NULL;
+        mpContext->isFinished = false;
+        InitializeCriticalSection(&mpContext->queueLock);
+        InitializeConditionVariable(&mpContext->frameQueued);
+        InitializeConditionVariable(&mpContext->framePopped);
+        if (ReadHeader() == false)
+        {
+            ErrorLog << "DepthStreamReader: invalid header of " << streamName << std::endl;
+            Close();
+            return GPP_INVALID_INPUT;
+        }
+        mIsLive = streamName.compare(0, 9, "\\\\.\\pipe\\") == 0;
+        mQueueCapacity = queueCapacity > 1 ? queueCapacity : 1;
+        mIsStopping = false;
+        mReadCount = 0;
+        mDroppedCount = 0;
+        mDecimatedCount = 0;
+        mRayX.resize(mInfo.width);
+        for (int column = 0; column < mInfo.width; column++)
+        {
+            mRayX[column] = (column - mInfo.centerX) / mInfo.focalX;
+        }
+        mRayY.resize(mInfo.height);
+        for (int row = 0; row < mInfo.height; row++)
+        {
+            mRayY[row] = (row - mInfo.centerY) / mInfo.focalY;
+        }
+        mpContext->readThread = (HANDLE)_beginthreadex(NULL, 0, RunReadThread, (void *)this, 0, NULL);
+        if (mpContext->readThread == NULL)
+        {
+            Close();
+            return GPP_INVALID_RESULT;
+        }
+        InfoLog << "DepthStreamReader::Open " << streamName << " " << mInfo.width << "x" << mInfo.height << " isLive=" << mIsLive << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    void DepthStreamReader::Close()
+    {
+        if (mpContext == NULL)
+        {
+            return;
+        }
+        if (mpContext->readThread != NULL)
+        {
+            EnterCriticalSection(&mpContext->queueLock);
+            mIsStopping = true;
+            WakeAllConditionVariable(&mpContext->framePopped);
+            LeaveCriticalSection(&mpContext->queueLock);
+            // A pipe read blocks until the producer writes, so it is cancelled until the thread exits
+            while (WaitForSingleObject(mpContext->readThread, gStopCheckInterval) == WAIT_TIMEOUT)
+            {
+                CancelSynchronousIo(mpContext->readThread);
+            }
+            CloseHandle(mpContext->readThread);
+        }
+        if (mpContext->streamFile != NULL)
+        {
+            fclose(mpContext->streamFile);
+        }
+        for (std::deque<DepthStreamFrame>::iterator itr = mpContext->frames.begin(); itr != mpContext->frames.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->pointCloud);
+        }
+        DeleteCriticalSection(&mpContext->queueLock);
+        GPPFREEPOINTER(mpContext);
+        InfoLog << "DepthStreamReader::Close readCount=" << mReadCount << " droppedCount=" << mDroppedCount
+            << " decimatedCount=" << mDecimatedCount << std::endl;
+    }
+
+    GPP::PointCloud* DepthStreamReader::PopFrame(int* frameIndex)
+    {
+        if (mpContext == NULL)
+        {
+            return NULL;
+        }
+        EnterCriticalSection(&mpContext->queueLock);
+        // Stop does not signal, so the wait is sliced to see it
+        while (mpContext->frames.empty() && !mpContext->isFinished && !mIsStopping)
+        {
+            SleepConditionVariableCS(&mpContext->frameQueued, &mpContext->queueLock, gStopCheckInterval);
+        }
+        GPP::PointCloud* pointCloud = NULL;
+        if (!mpContext->frames.empty() && !mIsStopping)
+        {
+            pointCloud = mpContext->frames.front().pointCloud;
+            if (frameIndex)
+            {
+                *frameIndex = mpContext->frames.front().frameIndex;
+            }
+            mpContext->frames.pop_front();
+            WakeConditionVariable(&mpContext->framePopped);
+        }
+        LeaveCriticalSection(&mpContext->queueLock);
+        return pointCloud;
+    }
+
+    void DepthStreamReader::Stop()
+    {
+        mIsStopping = true;
+    }
+
+    bool DepthStreamReader::IsLive() const
+    {
+        return mIsLive;
+    }
+
+    const DepthStreamInfo& DepthStreamReader::GetInfo() const
+    {
+        return mInfo;
+    }
+
+    int DepthStreamReader::GetReadCount() const
+    {
+        return mReadCount;
+    }
+
+    int DepthStreamReader::GetDroppedCount() const
+    {
+        return mDroppedCount;
+    }
+
+    int DepthStreamReader::GetDecimatedCount() const
+    {
+        return mDecimatedCount;
+    }
+
+    void DepthStreamReader::ReadFrames()
+    {
+        std::vector<unsigned short> depths(mInfo.width * mInfo.height);
+        unsigned int frameIndex = 0;
+        while (!mIsStopping && ReadFrame(depths, frameIndex))
+        {
+            int stride = 1;
+            bool isDropped = false;
+            EnterCriticalSection(&mpContext->queueLock);
+            while (!mIsLive && !mIsStopping && int(mpContext->frames.size()) >= mQueueCapacity)
+            {
+                SleepConditionVariableCS(&mpContext->framePopped, &mpContext->queueLock, INFINITE);
+            }
+            int queueSize = mpContext->frames.size();
+            mReadCount++;
+            if (queueSize >= mQueueCapacity)
+            {
+                isDropped = true;
+                mDroppedCount++;
+            }
+            else if (mIsLive && queueSize * 2 >= mQueueCapacity)
+            {
+                stride = gDecimateStride;
+                mDecimatedCount++;
+            }
+            LeaveCriticalSection(&mpContext->queueLock);
+            if (isDropped || mIsStopping)
+            {
+                continue;
+            }
+            DepthStreamFrame frame;
+            frame.pointCloud = BackProject(depths, stride);
+            frame.frameIndex = int(frameIndex);
+            EnterCriticalSection(&mpContext->queueLock);
+            mpContext->frames.push_back(frame);
+            WakeConditionVariable(&mpContext->frameQueued);
+            LeaveCriticalSection(&mpContext->queueLock);
+        }
+        EnterCriticalSection(&mpContext->queueLock);
+        mpContext->isFinished = true;
+        WakeAllConditionVariable(&mpContext->frameQueued);
+        LeaveCriticalSection(&mpContext->queueLock);
+    }
+
+    bool DepthStreamReader::ReadHeader()
+    {
+        char magic[4];
+        int imageSize[2];
+        float parameters[5];
+        if (fread(magic, sizeof(char), 4, mpContext->streamFile) != 4 || memcmp(magic, "MDS1", 4) != 0 ||
+            fread(imageSize, sizeof(int), 2, mpContext->streamFile) != 2 ||
+            fread(parameters, sizeof(float), 5, mpContext->streamFile) != 5)
+        {
+            return false;
+        }
+        if (imageSize[0] <= 0 || imageSize[0] > gMaxStreamImageSize || imageSize[1] <= 0 || imageSize[1] > gMaxStreamImageSize ||
+            parameters[0] <= 0 || parameters[1] <= 0 || parameters[4] <= 0)
+        {
+            return false;
+        }
+        mInfo.width = imageSize[0];
+        mInfo.height = imageSize[1];
+        mInfo.focalX = parameters[0];
+        mInfo.focalY = parameters[1];
+        mInfo.centerX = parameters[2];
+        mInfo.centerY = parameters[3];
+        mInfo.depthScale = parameters[4];
+        return true;
+    }
+
+    bool DepthStreamReader::ReadFrame(std::vector<unsigned short>& depths, unsigned int& frameIndex)
+    {
+        if (fread(&frameIndex, sizeof(unsigned int), 1, mpContext->streamFile) != 1)
+        {
+            return false;
+        }
+        return fread(&depths[0], sizeof(unsigned short), depths.size(), mpContext->streamFile) == depths.size();
+    }
+
+    GPP::PointCloud* DepthStreamReader::BackProject(const std::vector<unsigned short>& depths, int stride) const
+    {
+        int gridWidth = (mInfo.width + stride - 1) / stride;
+        int gridHeight = (mInfo.height + stride - 1) / stride;
+        std::vector<GPP::Vector3> coords(gridWidth * gridHeight);
+        std::vector<int> validFlags(gridWidth * gridHeight);
+        DepthProjectTask projectTask(this, &depths, stride, gridWidth, &coords, &validFlags);
+        ThreadPool::Get()->ParallelFor(gridHeight, &projectTask, 16);
+        std::vector<GPP::Vector3> normals(gridWidth * gridHeight);
+        std::vector<int> normalFlags(gridWidth * gridHeight);
+        DepthNormalTask normalTask(this, &coords, &validFlags, gridWidth, gridHeight, &normals, &normalFlags);
+        ThreadPool::Get()->ParallelFor(gridHeight, &normalTask, 16);
+
+        GPP::Int pointCount = 0;
+        for (int gridId = 0; gridId < gridWidth * gridHeight; gridId++)
+        {
+            pointCount += normalFlags[gridId];
+        }
+        GPP::PointCloud* pointCloud = new GPP::PointCloud(true, false);
+        pointCloud->ReservePoint(pointCount);
+        for (int gridId = 0; gridId < gridWidth * gridHeight; gridId++)
+        {
+            if (normalFlags[gridId])
+            {
+                pointCloud->InsertPoint(coords[gridId], normals[gridId]);
+            }
+        }
+        return pointCloud;
+    }
+
+    void DepthStreamReader::ProjectRow(const std::vector<unsigned short>& depths, int stride, int gridWidth, int row,
+        std::vector<GPP::Vector3>& coords, std::vector<int>& validFlags) const
+    {
+        // No division or branch per pixel: the rays are tabulated, so the loop is a few multiplications
+        int imageRow = row * stride;
+        const unsigned short* depthRow = &depths[imageRow * mInfo.width];
+        GPP::Real rayY = mRayY[imageRow];
+        for (int column = 0; column < gridWidth; column++)
+        {
+            int imageColumn = column * stride;
+            GPP::Real depth = depthRow[imageColumn] * mInfo.depthScale;
+            coords[row * gridWidth + column] = GPP::Vector3(mRayX[imageColumn] * depth, rayY * depth, depth);
+            validFlags[row * gridWidth + column] = depthRow[imageColumn] > 0;
+        }
+    }
+
+    void DepthStreamReader::ComputeRowNormals(const std::vector<GPP::Vector3>& coords, const std::vector<int>& validFlags,
+        int gridWidth, int gridHeight, int row, std::vector<GPP::Vector3>& normals, std::vector<int>& normalFlags) const
+    {
+        // Normal is the cross product of the horizontal and vertical differences, the backward one is used at borders
+        // and depth jumps. It faces the camera at the origin.
+        for (int column = 0; column < gridWidth; column++)
+        {
+            int gridId = row * gridWidth + column;
+            normalFlags[gridId] = 0;
+            if (!validFlags[gridId])
+            {
+                continue;
+            }
+            const GPP::Vector3& coord = coords[gridId];
+            GPP::Real maxJump = coord[2] * gMaxDepthJumpRatio;
+            GPP::Vector3 deltaX, deltaY;
+            if (column + 1 < gridWidth && validFlags[gridId + 1] && fabs(coords[gridId + 1][2] - coord[2]) < maxJump)
+            {
+                deltaX = coords[gridId + 1] - coord;
+            }
+            else if (column > 0 && validFlags[gridId - 1] && fabs(coords[gridId - 1][2] - coord[2]) < maxJump)
+            {
+                deltaX = coord - coords[gridId - 1];
+            }
+            else
+            {
+                continue;
+            }
+            if (row + 1 < gridHeight && validFlags[gridId + gridWidth] && fabs(coords[gridId + gridWidth][2] - coord[2]) < maxJump)
+            {
+                deltaY = coords[gridId + gridWidth] - coord;
+            }
+            else if (row > 0 && validFlags[gridId - gridWidth] && fabs(coords[gridId - gridWidth][2] - coord[2]) < maxJump)
+            {
+                deltaY = coord - coords[gridId - gridWidth];
+            }
+            else
+            {
+                continue;
+            }
+            GPP::Vector3 normal = deltaX.CrossProduct(deltaY);
+            if (normal.Normalise() < GPP::REAL_TOL)
+            {
+                continue;
+            }
+            if (normal * coord > 0)
+            {
+                normal = normal * -1.0;
+            }
+            normals[gridId] = normal;
+            normalFlags[gridId] = 1;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "GPP.h"
+#include <vector>
+#include <string>
+
+namespace MagicCore
+{
+    struct DepthStreamContext;
+
+    struct DepthStreamInfo
+    {
+        int width;
+        int height;
+        GPP::Real focalX;
+        GPP::Real focalY;
+        GPP::Real centerX;
+        GPP::Real centerY;
+        // Point coordinate unit per depth value
+        GPP::Real depthScale;
+    };
+
+    // Ingest of a depth stream, a recorded frame log or a producer writing into a named pipe like \\.\pipe\MagicDepth.
+    // Stream layout, little endian without padding:
+    //   header: char magic[4] = "MDS1", int width, int height, float focalX, focalY, centerX, centerY, depthScale
+    //   frame:  unsigned int frameIndex, unsigned short depth[width * height] in row major order, 0 is no depth
+    // A reader thread converts frames to point clouds with normals in camera coordinates and keeps them in a bounded
+    // queue. A recorded stream waits when the queue is full. A pipe stream can not wait for the consumer: frames are
+    // decimated when the queue is half full and dropped when it is full.
+    class DepthStreamReader
+    {
+    public:
+        DepthStreamReader();
+        // It closes the stream
+        ~DepthStreamReader();
+
+        // The header is read before it returns, then frames are read on the reader thread
+        GPP::ErrorCode Open(const std::string& streamName, int queueCapacity);
+        // Stop reading and free the queued frames
+        void Close(void);
+
+        // Block until a frame is queued. Return NULL if the stream is finished and the queue is empty.
+        // The caller owns the point cloud.
+        GPP::PointCloud* PopFrame(int* frameIndex = NULL);
+        // Make PopFrame return NULL soon, it can be called from any thread while the stream is open
+        void Stop(void);
+
+        bool IsLive(void) const;
+        const DepthStreamInfo& GetInfo(void) const;
+        int GetReadCount(void) const;
+        int GetDroppedCount(void) const;
+        int GetDecimatedCount(void) const;
+
+        // Used by the reader thread only
+        void ReadFrames(void);
+
+    private:
+        friend class DepthProjectTask;
+        friend class DepthNormalTask;
+        bool ReadHeader(void);
+        bool ReadFrame(std::vector<unsigned short>& depths, unsigned int& frameIndex);
+        // Keep one pixel of every stride x stride block
+        GPP::PointCloud* BackProject(const std::vector<unsigned short>& depths, int stride) const;
+        void ProjectRow(const std::vector<unsigned short>& depths, int stride, int gridWidth, int row,
+            std::vector<GPP::Vector3>& coords, std::vector<int>& validFlags) const;
+        void ComputeRowNormals(const std::vector<GPP::Vector3>& coords, const std::vector<int>& validFlags, int gridWidth,
+            int gridHeight, int row, std::vector<GPP::Vector3>& normals, std::vector<int>& normalFlags) const;
+
+    private:
+        DepthStreamContext* mpContext;
+        DepthStreamInfo mInfo;
+        bool mIsLive;
+        int mQueueCapacity;
+        volatile bool mIsStopping;
+        // Pixel rays on the plane of depth 1: x = mRayX[column] * depth, y = mRayY[row] * depth
+        std::vector<GPP::Real> mRayX;
+        std::vector<GPP::Real> mRayY;
+        // Counters are changed under the queue lock
+        int mReadCount;
+        int mDroppedCount;
+        int mDecimatedCount;
+    };
+}
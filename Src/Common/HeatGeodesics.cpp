@@ -0,0 +1,615 @@
+#include "HeatGeodesics.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MagicCore
+{
+    // Vertex count of the leaves of the nested dissection
+    static const GPP::Int gDissectionLeafSize = 64;
+    // Shift of the Poisson matrix relative to its average diagonal, it removes the constant null space of L
+    static const GPP::Real gPoissonShift = 1.0e-8;
+    // Heat decays about exp(-d / sqrt(t)), the diffusion time is raised on large meshes so that the heat
+    // does not underflow across the bounding box diagonal
+    static const GPP::Real gMaxHeatDecay = 200.0;
+    // Cotangent of degenerated corners is clamped to it
+    static const GPP::Real gMaxCornerCot = 1.0e5;
+
+    class CoordAxisLess
+    {
+    public:
+        CoordAxisLess(const std::vector<GPP::Vector3>* coords, int axis) :
+            mpCoords(coords),
+            mAxis(axis)
+        {
+        }
+
+        bool operator () (GPP::Int vid0, GPP::Int vid1) const
+        {
+            return (*mpCoords)[vid0][mAxis] < (*mpCoords)[vid1][mAxis];
+        }
+
+    private:
+        const std::vector<GPP::Vector3>* mpCoords;
+        int mAxis;
+    };
+
+    // Geometric nested dissection: vertices are split at the median of the longest axis, and the vertices of
+    // the left half which touch the right half form the separator, which is eliminated after both halves.
+    static void DissectVertices(const std::vector<GPP::Vector3>& coords, const std::vector<GPP::Int>& neighborStarts,
+        const std::vector<GPP::Int>& neighborIds, std::vector<GPP::Int>& vertexIds, GPP::Int startId, GPP::Int endId,
+        std::vector<GPP::Int>& stamps, GPP::Int& stamp, std::vector<GPP::Int>& ordering)
+    {
+        GPP::Int count = endId - startId;
+        if (count <= gDissectionLeafSize)
+        {
+            ordering.insert(ordering.end(), vertexIds.begin() + startId, vertexIds.begin() + endId);
+            return;
+        }
+        GPP::Vector3 bboxMin = coords[vertexIds[startId]];
+        GPP::Vector3 bboxMax = bboxMin;
+        for (GPP::Int iid = startId + 1; iid < endId; iid++)
+        {
+            const GPP::Vector3& coord = coords[vertexIds[iid]];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = coord[axis] < bboxMin[axis] ? coord[axis] : bboxMin[axis];
+                bboxMax[axis] = coord[axis] > bboxMax[axis] ? coord[axis] : bboxMax[axis];
+            }
+        }
+        GPP::Vector3 extent = bboxMax - bboxMin;
+        int splitAxis = 0;
+        if (extent[1] > extent[splitAxis])
+        {
+            splitAxis = 1;
+        }
+        if (extent[2] > extent[splitAxis])
+        {
+            splitAxis = 2;
+        }
+        GPP::Int midId = startId + count / 2;
+        std::nth_element(vertexIds.begin() + startId, vertexIds.begin() + midId, vertexIds.begin() + endId,
+            CoordAxisLess(&coords, splitAxis));
+        stamp++;
+        GPP::Int rightStamp = stamp;
+        for (GPP::Int iid = midId; iid < endId; iid++)
+        {
+            stamps[vertexIds[iid]] = rightStamp;
+        }
+        GPP::Int separatorId = midId;
+        for (GPP::Int iid = startId; iid < separatorId;)
+        {
+            GPP::Int vid = vertexIds[iid];
+            bool isSeparator = false;
+            for (GPP::Int nid = neighborStarts[vid]; nid < neighborStarts[vid + 1]; nid++)
+            {
+                if (stamps[neighborIds[nid]] == rightStamp)
+                {
+                    isSeparator = true;
+                    break;
+                }
+            }
+            if (isSeparator)
+            {
+                separatorId--;
+                std::swap(vertexIds[iid], vertexIds[separatorId]);
+            }
+            else
+            {
+                iid++;
+            }
+        }
+        DissectVertices(coords, neighborStarts, neighborIds, vertexIds, startId, separatorId, stamps, stamp, ordering);
+        DissectVertices(coords, neighborStarts, neighborIds, vertexIds, midId, endId, stamps, stamp, ordering);
+        ordering.insert(ordering.end(), vertexIds.begin() + separatorId, vertexIds.begin() + midId);
+    }
+
+    static GPP::Int FindComponentRoot(std::vector<GPP::Int>& parents, GPP::Int vid)
+    {
+        while (parents[vid] != vid)
+        {
+            parents[vid] = parents[parents[vid]];
+            vid = parents[vid];
+        }
+        return vid;
+    }
+
+    class HeatDistanceTask : public ParallelTask
+    {
+    public:
+        HeatDistanceTask(const HeatGeodesics* geodesics, const std::vector<std::vector<GPP::Int> >* sourceSets,
+            std::vector<std::vector<GPP::Real> >* distances, std::vector<GPP::ErrorCode>* results) :
+            mpGeodesics(geodesics),
+            mpSourceSets(sourceSets),
+            mpDistances(distances),
+            mpResults(results)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            std::vector<GPP::Real> heat;
+            std::vector<GPP::Real> workSpace;
+            for (int sid = startId; sid < endId; sid++)
+            {
+                mpResults->at(sid) = mpGeodesics->ComputeDistance(mpSourceSets->at(sid), mpDistances->at(sid), heat, workSpace);
+            }
+        }
+
+    private:
+        const HeatGeodesics* mpGeodesics;
+        const std::vector<std::vector<GPP::Int> >* mpSourceSets;
+        std::vector<std::vector<GPP::Real> >* mpDistances;
+        std::vector<GPP::ErrorCode>* mpResults;
+    };
+
+    HeatGeodesics::HeatGeodesics() :
+        mpTriMesh(NULL),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mVertexCoords(),
+        mTriangleVertexIds(),
+        mCornerCots(),
+        mNeighborStarts(),
+        mNeighborIds(),
+        mComponentIds(),
+        mComponentCount(0),
+        mHeatSolver(),
+        mPoissonSolver()
+    {
+    }
+
+    HeatGeodesics::~HeatGeodesics()
+    {
+    }
+
+    GPP::ErrorCode HeatGeodesics::Init(const GPP::ITriMesh* triMesh, GPP::Real timeScale)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1 || timeScale <= 0)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mVertexCount = triMesh->GetVertexCount();
+        mTriangleCount = triMesh->GetTriangleCount();
+        mVertexCoords.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = triMesh->GetVertexCoord(vid);
+        }
+        mTriangleVertexIds.resize(mTriangleCount * 3);
+        GPP::Int vertexIds[3] = {-1, -1, -1};
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (vertexIds[fvid] < 0 || vertexIds[fvid] >= mVertexCount)
+                {
+                    Clear();
+                    return GPP_INVALID_INPUT;
+                }
+                mTriangleVertexIds[fid * 3 + fvid] = vertexIds[fvid];
+            }
+        }
+
+        // Corner cotangents
+        mCornerCots.resize(mTriangleCount * 3);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                const GPP::Vector3& coord = mVertexCoords[mTriangleVertexIds[fid * 3 + fvid]];
+                GPP::Vector3 edge0 = mVertexCoords[mTriangleVertexIds[fid * 3 + (fvid + 1) % 3]] - coord;
+                GPP::Vector3 edge1 = mVertexCoords[mTriangleVertexIds[fid * 3 + (fvid + 2) % 3]] - coord;
+                GPP::Real sinValue = edge0.CrossProduct(edge1).Length();
+                GPP::Real cosValue = edge0 * edge1;
+                GPP::Real cotValue = 0;
+                if (sinValue * gMaxCornerCot > fabs(cosValue))
+                {
+                    cotValue = cosValue / sinValue;
+                }
+                else if (sinValue > 0 || cosValue != 0)
+                {
+                    cotValue = cosValue > 0 ? gMaxCornerCot : -gMaxCornerCot;
+                }
+                mCornerCots[fid * 3 + fvid] = cotValue;
+            }
+        }
+
+        // Vertex neighbors: every corner adds at most two neighbors
+        std::vector<GPP::Int> neighborCounts(mVertexCount, 0);
+        mNeighborStarts.assign(mVertexCount + 1, 0);
+        for (GPP::Int cid = 0; cid < mTriangleCount * 3; cid++)
+        {
+            mNeighborStarts[mTriangleVertexIds[cid] + 1] += 2;
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mNeighborStarts[vid + 1] += mNeighborStarts[vid];
+        }
+        mNeighborIds.resize(mNeighborStarts[mVertexCount]);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vid = mTriangleVertexIds[fid * 3 + fvid];
+                for (int nvid = 1; nvid < 3; nvid++)
+                {
+                    GPP::Int neighborId = mTriangleVertexIds[fid * 3 + (fvid + nvid) % 3];
+                    GPP::Int* neighborBegin = &mNeighborIds[mNeighborStarts[vid]];
+                    GPP::Int* neighborEnd = neighborBegin + neighborCounts[vid];
+                    if (neighborId != vid && std::find(neighborBegin, neighborEnd, neighborId) == neighborEnd)
+                    {
+                        *neighborEnd = neighborId;
+                        neighborCounts[vid]++;
+                    }
+                }
+            }
+        }
+        GPP::Int neighborId = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Int neighborStart = mNeighborStarts[vid];
+            mNeighborStarts[vid] = neighborId;
+            for (GPP::Int nid = 0; nid < neighborCounts[vid]; nid++)
+            {
+                mNeighborIds[neighborId++] = mNeighborIds[neighborStart + nid];
+            }
+        }
+        mNeighborStarts[mVertexCount] = neighborId;
+        mNeighborIds.resize(neighborId);
+
+        // Connected components
+        std::vector<GPP::Int> parents(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            parents[vid] = vid;
+        }
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            GPP::Int root0 = FindComponentRoot(parents, mTriangleVertexIds[fid * 3]);
+            for (int fvid = 1; fvid < 3; fvid++)
+            {
+                GPP::Int root = FindComponentRoot(parents, mTriangleVertexIds[fid * 3 + fvid]);
+                if (root != root0)
+                {
+                    parents[root] = root0;
+                }
+            }
+        }
+        mComponentIds.assign(mVertexCount, -1);
+        mComponentCount = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Int root = FindComponentRoot(parents, vid);
+            if (mComponentIds[root] == -1)
+            {
+                mComponentIds[root] = mComponentCount++;
+            }
+            mComponentIds[vid] = mComponentIds[root];
+        }
+
+        SparseSymMatrix heatMatrix;
+        SparseSymMatrix poissonMatrix;
+        GPP::ErrorCode res = BuildMatrices(timeScale, heatMatrix, poissonMatrix);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+            return res;
+        }
+        std::vector<GPP::Int> dissectIds(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            dissectIds[vid] = vid;
+        }
+        std::vector<GPP::Int> stamps(mVertexCount, -1);
+        GPP::Int stamp = 0;
+        std::vector<GPP::Int> ordering;
+        ordering.reserve(mVertexCount);
+        DissectVertices(mVertexCoords, mNeighborStarts, mNeighborIds, dissectIds, 0, mVertexCount, stamps, stamp, ordering);
+        res = mHeatSolver.Factorize(heatMatrix, ordering);
+        if (res == GPP_NO_ERROR)
+        {
+            res = mPoissonSolver.Factorize(poissonMatrix, ordering);
+        }
+        if (res != GPP_NO_ERROR)
+        {
+            ErrorLog << "HeatGeodesics::Init: factorization failed" << std::endl;
+            Clear();
+            return res;
+        }
+        InfoLog << "HeatGeodesics::Init: " << mVertexCount << " vertices, factor non zeros " << mHeatSolver.GetFactorNonZeroCount() << std::endl;
+        mpTriMesh = triMesh;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode HeatGeodesics::BuildMatrices(GPP::Real timeScale, SparseSymMatrix& heatMatrix, SparseSymMatrix& poissonMatrix)
+    {
+        // Lumped mass and the diffusion time
+        std::vector<GPP::Real> masses(mVertexCount, 0);
+        GPP::Real edgeLengthSum = 0;
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            const GPP::Vector3& coord0 = mVertexCoords[mTriangleVertexIds[fid * 3]];
+            const GPP::Vector3& coord1 = mVertexCoords[mTriangleVertexIds[fid * 3 + 1]];
+            const GPP::Vector3& coord2 = mVertexCoords[mTriangleVertexIds[fid * 3 + 2]];
+            GPP::Real area = (coord1 - coord0).CrossProduct(coord2 - coord0).Length() / 2.0;
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                masses[mTriangleVertexIds[fid * 3 + fvid]] += area / 3.0;
+            }
+            edgeLengthSum += (coord1 - coord0).Length() + (coord2 - coord1).Length() + (coord0 - coord2).Length();
+        }
+        GPP::Real averageEdgeLength = edgeLengthSum / (mTriangleCount * 3);
+        if (averageEdgeLength < GPP::REAL_TOL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Real diffuseTime = timeScale * averageEdgeLength * averageEdgeLength;
+        GPP::Vector3 bboxMin = mVertexCoords[0];
+        GPP::Vector3 bboxMax = bboxMin;
+        for (GPP::Int vid = 1; vid < mVertexCount; vid++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = mVertexCoords[vid][axis] < bboxMin[axis] ? mVertexCoords[vid][axis] : bboxMin[axis];
+                bboxMax[axis] = mVertexCoords[vid][axis] > bboxMax[axis] ? mVertexCoords[vid][axis] : bboxMax[axis];
+            }
+        }
+        GPP::Real minDiffuseTime = (bboxMax - bboxMin).Length() / gMaxHeatDecay;
+        minDiffuseTime *= minDiffuseTime;
+        if (diffuseTime < minDiffuseTime)
+        {
+            InfoLog << "HeatGeodesics: diffusion time is raised from " << diffuseTime << " to " << minDiffuseTime << std::endl;
+            diffuseTime = minDiffuseTime;
+        }
+        GPP::Real averageMass = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            averageMass += masses[vid];
+        }
+        averageMass /= mVertexCount;
+        if (averageMass < GPP::REAL_TOL * GPP::REAL_TOL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        // Isolated vertices get a mass, so that both matrices are positive definite
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            if (masses[vid] < averageMass * GPP::REAL_TOL)
+            {
+                masses[vid] = averageMass;
+            }
+        }
+
+        // Cotangent Laplacian on the pattern of vertex neighbors plus the diagonal
+        SparseSymMatrix laplaceMatrix;
+        laplaceMatrix.dimension = mVertexCount;
+        laplaceMatrix.colStarts.resize(mVertexCount + 1);
+        laplaceMatrix.rowIds.resize(mNeighborIds.size() + mVertexCount);
+        laplaceMatrix.values.assign(mNeighborIds.size() + mVertexCount, 0);
+        for (GPP::Int vid = 0; vid <= mVertexCount; vid++)
+        {
+            laplaceMatrix.colStarts[vid] = mNeighborStarts[vid] + vid;
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Int colStart = laplaceMatrix.colStarts[vid];
+            laplaceMatrix.rowIds[colStart] = vid;
+            for (GPP::Int nid = mNeighborStarts[vid]; nid < mNeighborStarts[vid + 1]; nid++)
+            {
+                laplaceMatrix.rowIds[colStart + 1 + nid - mNeighborStarts[vid]] = mNeighborIds[nid];
+            }
+        }
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Real weight = mCornerCots[fid * 3 + fvid] / 2.0;
+                GPP::Int vid0 = mTriangleVertexIds[fid * 3 + (fvid + 1) % 3];
+                GPP::Int vid1 = mTriangleVertexIds[fid * 3 + (fvid + 2) % 3];
+                for (int side = 0; side < 2; side++)
+                {
+                    GPP::Int colStart = laplaceMatrix.colStarts[vid0];
+                    GPP::Int colEnd = laplaceMatrix.colStarts[vid0 + 1];
+                    for (GPP::Int pid = colStart + 1; pid < colEnd; pid++)
+                    {
+                        if (laplaceMatrix.rowIds[pid] == vid1)
+                        {
+                            laplaceMatrix.values[pid] -= weight;
+                            break;
+                        }
+                    }
+                    laplaceMatrix.values[colStart] += weight;
+                    std::swap(vid0, vid1);
+                }
+            }
+        }
+        GPP::Real averageDiagonal = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            averageDiagonal += fabs(laplaceMatrix.values[laplaceMatrix.colStarts[vid]]);
+        }
+        averageDiagonal /= mVertexCount;
+        GPP::Real poissonShift = gPoissonShift * (averageDiagonal > GPP::REAL_TOL ? averageDiagonal : 1.0) / averageMass;
+
+        heatMatrix = laplaceMatrix;
+        poissonMatrix = laplaceMatrix;
+        for (size_t pid = 0; pid < laplaceMatrix.values.size(); pid++)
+        {
+            heatMatrix.values[pid] *= diffuseTime;
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Int diagonalId = laplaceMatrix.colStarts[vid];
+            heatMatrix.values[diagonalId] += masses[vid];
+            poissonMatrix.values[diagonalId] += poissonShift * masses[vid];
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void HeatGeodesics::Clear()
+    {
+        mpTriMesh = NULL;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mVertexCoords.clear();
+        mTriangleVertexIds.clear();
+        mCornerCots.clear();
+        mNeighborStarts.clear();
+        mNeighborIds.clear();
+        mComponentIds.clear();
+        mComponentCount = 0;
+        mHeatSolver.Clear();
+        mPoissonSolver.Clear();
+    }
+
+    const GPP::ITriMesh* HeatGeodesics::GetMesh() const
+    {
+        return mpTriMesh;
+    }
+
+    bool HeatGeodesics::IsValid(const GPP::ITriMesh* triMesh) const
+    {
+        return triMesh != NULL && triMesh == mpTriMesh && triMesh->GetVertexCount() == mVertexCount &&
+            triMesh->GetTriangleCount() == mTriangleCount;
+    }
+
+    GPP::ErrorCode HeatGeodesics::ComputeDistances(const std::vector<std::vector<GPP::Int> >& sourceSets,
+        std::vector<std::vector<GPP::Real> >& distances) const
+    {
+        if (mpTriMesh == NULL)
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        int setCount = sourceSets.size();
+        distances.clear();
+        distances.resize(setCount);
+        std::vector<GPP::ErrorCode> results(setCount, GPP_NO_ERROR);
+        HeatDistanceTask distanceTask(this, &sourceSets, &distances, &results);
+        ThreadPool::Get()->ParallelFor(setCount, &distanceTask, 1);
+        for (int sid = 0; sid < setCount; sid++)
+        {
+            if (results.at(sid) != GPP_NO_ERROR)
+            {
+                distances.clear();
+                return results.at(sid);
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode HeatGeodesics::ComputeDistance(const std::vector<GPP::Int>& sources, std::vector<GPP::Real>& distance,
+        std::vector<GPP::Real>& heat, std::vector<GPP::Real>& workSpace) const
+    {
+        if (sources.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        // Heat flow: (M + tL) u = delta
+        heat.assign(mVertexCount, 0);
+        for (size_t sid = 0; sid < sources.size(); sid++)
+        {
+            if (sources[sid] < 0 || sources[sid] >= mVertexCount)
+            {
+                return GPP_INVALID_INPUT;
+            }
+            heat[sources[sid]] = 1.0;
+        }
+        mHeatSolver.Solve(heat, heat, workSpace);
+
+        // Divergence of the normalized field X = -grad(u) / |grad(u)|, negated as the right hand side of L phi = -div(X)
+        distance.assign(mVertexCount, 0);
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            const GPP::Int* vertexIds = &mTriangleVertexIds[fid * 3];
+            const GPP::Vector3& coord0 = mVertexCoords[vertexIds[0]];
+            const GPP::Vector3& coord1 = mVertexCoords[vertexIds[1]];
+            const GPP::Vector3& coord2 = mVertexCoords[vertexIds[2]];
+            GPP::Vector3 normal = (coord1 - coord0).CrossProduct(coord2 - coord0);
+            GPP::Real doubleArea = normal.Length();
+            if (doubleArea < GPP::REAL_TOL * GPP::REAL_TOL)
+            {
+                continue;
+            }
+            normal /= doubleArea;
+            GPP::Vector3 gradient = normal.CrossProduct(coord2 - coord1) * heat[vertexIds[0]] +
+                normal.CrossProduct(coord0 - coord2) * heat[vertexIds[1]] +
+                normal.CrossProduct(coord1 - coord0) * heat[vertexIds[2]];
+            GPP::Real gradientLength = gradient.Length();
+            if (!(gradientLength > 0))
+            {
+                continue;
+            }
+            GPP::Vector3 field = gradient / (-gradientLength);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int nextId = (fvid + 1) % 3;
+                GPP::Int prevId = (fvid + 2) % 3;
+                const GPP::Vector3& coord = mVertexCoords[vertexIds[fvid]];
+                GPP::Vector3 nextEdge = mVertexCoords[vertexIds[nextId]] - coord;
+                GPP::Vector3 prevEdge = mVertexCoords[vertexIds[prevId]] - coord;
+                distance[vertexIds[fvid]] -= (mCornerCots[fid * 3 + prevId] * (nextEdge * field) +
+                    mCornerCots[fid * 3 + nextId] * (prevEdge * field)) / 2.0;
+            }
+        }
+        mPoissonSolver.Solve(distance, distance, workSpace);
+
+        // Each component is shifted to make its nearest source 0
+        std::vector<GPP::Real> componentShifts(mComponentCount, GPP::REAL_LARGE);
+        for (size_t sid = 0; sid < sources.size(); sid++)
+        {
+            GPP::Int componentId = mComponentIds[sources[sid]];
+            if (distance[sources[sid]] < componentShifts[componentId])
+            {
+                componentShifts[componentId] = distance[sources[sid]];
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Real shift = componentShifts[mComponentIds[vid]];
+            if (shift == GPP::REAL_LARGE)
+            {
+                distance[vid] = GPP::REAL_LARGE;
+            }
+            else
+            {
+                distance[vid] = distance[vid] > shift ? distance[vid] - shift : 0;
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode HeatGeodesics::TracePath(const std::vector<GPP::Real>& distances, GPP::Int startVertexId,
+        std::vector<GPP::Int>& pathVertexIds) const
+    {
+        pathVertexIds.clear();
+        if (GPP::Int(distances.size()) != mVertexCount || startVertexId < 0 || startVertexId >= mVertexCount ||
+            distances.at(startVertexId) == GPP::REAL_LARGE)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int currentId = startVertexId;
+        pathVertexIds.push_back(currentId);
+        for (GPP::Int step = 0; step < mVertexCount; step++)
+        {
+            GPP::Int nextId = currentId;
+            for (GPP::Int nid = mNeighborStarts[currentId]; nid < mNeighborStarts[currentId + 1]; nid++)
+            {
+                if (distances[mNeighborIds[nid]] < distances[nextId])
+                {
+                    nextId = mNeighborIds[nid];
+                }
+            }
+            if (nextId == currentId)
+            {
+                break;
+            }
+            currentId = nextId;
+            pathVertexIds.push_back(currentId);
+        }
+        return GPP_NO_ERROR;
+    }
+}
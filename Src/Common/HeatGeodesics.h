@@ -0,0 +1,54 @@
+#pragma once
+#include "ITriMesh.h"
+#include "SparseCholesky.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // Geodesic distance fields by the heat method: heat flows from the sources for a short time, and the
+    // normalized heat gradient is integrated back by a Poisson equation.
+    // The heat operator M + tL and the Laplacian L are factorized once in Init, so a new source set costs
+    // two back substitutions. Source sets of one call are solved in parallel on ThreadPool.
+    class HeatGeodesics
+    {
+    public:
+        HeatGeodesics();
+        ~HeatGeodesics();
+
+        // The diffusion time is timeScale * (average edge length)^2
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, GPP::Real timeScale = 1.0);
+        void Clear(void);
+
+        const GPP::ITriMesh* GetMesh(void) const;
+        // Whether the engine is built on triMesh and its vertex/triangle counts are unchanged
+        bool IsValid(const GPP::ITriMesh* triMesh) const;
+
+        // One distance field per source set. Vertices of components without any source get GPP::REAL_LARGE.
+        GPP::ErrorCode ComputeDistances(const std::vector<std::vector<GPP::Int> >& sourceSets,
+            std::vector<std::vector<GPP::Real> >& distances) const;
+        // Steepest descent of distances over the vertex neighbors, from startVertexId to a local minimum
+        GPP::ErrorCode TracePath(const std::vector<GPP::Real>& distances, GPP::Int startVertexId,
+            std::vector<GPP::Int>& pathVertexIds) const;
+
+    private:
+        friend class HeatDistanceTask;
+        GPP::ErrorCode ComputeDistance(const std::vector<GPP::Int>& sources, std::vector<GPP::Real>& distance,
+            std::vector<GPP::Real>& heat, std::vector<GPP::Real>& workSpace) const;
+        GPP::ErrorCode BuildMatrices(GPP::Real timeScale, SparseSymMatrix& heatMatrix, SparseSymMatrix& poissonMatrix);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        // Cotangent of each triangle corner
+        std::vector<GPP::Real> mCornerCots;
+        std::vector<GPP::Int> mNeighborStarts;
+        std::vector<GPP::Int> mNeighborIds;
+        std::vector<GPP::Int> mComponentIds;
+        GPP::Int mComponentCount;
+        SparseCholesky mHeatSolver;
+        SparseCholesky mPoissonSolver;
+    };
+}
@@ -75,6 +75,11 @@ namespace MagicCore
         mpMouse->getMouseState().height = h;
     }
 
+    bool InputSystem::IsModifierDown(OIS::Keyboard::Modifier modifier) const
+    {
+        return mpKeyboard != NULL && mpKeyboard->isModifierDown(modifier);
+    }
+
     InputSystem::~InputSystem(void)
     {
     }
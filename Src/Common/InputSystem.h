@@ -18,6 +18,7 @@ namespace MagicCore
         void    Init(Ogre::RenderWindow* window);
         void    Update();
         void    UpdateMouseState(int w, int h);
+        bool    IsModifierDown(OIS::Keyboard::Modifier modifier) const;
         virtual ~InputSystem(void);
     private:
         OIS::InputManager* mpInputManager;
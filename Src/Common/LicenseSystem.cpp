@@ -14,7 +14,7 @@ namespace MagicCore
     {
     }
 
-    bool LicenseSystem::Init(void)
+    bool LicenseSystem::Init(bool isSilent)
     {
         // Verify Activation Key
         bool res = false;
@@ -26,9 +26,13 @@ namespace MagicCore
             res = GPP::SetActivationKey(keyStr);
         }
         fin.close();
-        if (!res)
+        if (!res && isSilent)
         {
-            MessageBox(NULL, "ð棺ÿʹʱ30", "ܰʾ", MB_OK);
+            WarnLog << "LicenseSystem: no valid activation key, running as trial" << std::endl;
+        }
+        else if (!res)
+        {
+            MessageBox(NULL, "软件试用版：每次使用时限30分钟", "温馨提示", MB_OK);
         }
         return res;
     }
@@ -8,7 +8,8 @@ namespace MagicCore
         LicenseSystem();
         ~LicenseSystem();
 
-    static bool Init(void);
+    // isSilent: log the trial notice instead of showing a message box, for headless runs
+    static bool Init(bool isSilent = false);
 
     };
 }
@@ -0,0 +1,476 @@
+#include "MeshCurvature.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <cmath>
+
+namespace MagicCore
+{
+    // Cotangent of degenerated corners is clamped to it
+    static const GPP::Real gMaxCornerCot = 1.0e5;
+    static const GPP::Real gPi = 3.14159265358979323846;
+
+    class CornerGeometryTask : public ParallelTask
+    {
+    public:
+        explicit CornerGeometryTask(MeshCurvature* curvature) :
+            mpCurvature(curvature)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int fid = startId; fid < endId; fid++)
+            {
+                mpCurvature->ComputeCorners(fid);
+            }
+        }
+
+    private:
+        MeshCurvature* mpCurvature;
+    };
+
+    class VertexCurvatureTask : public ParallelTask
+    {
+    public:
+        explicit VertexCurvatureTask(MeshCurvature* curvature) :
+            mpCurvature(curvature)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                mpCurvature->ComputeVertex(vid);
+            }
+        }
+
+    private:
+        MeshCurvature* mpCurvature;
+    };
+
+    class BoundaryCurvatureTask : public ParallelTask
+    {
+    public:
+        explicit BoundaryCurvatureTask(MeshCurvature* curvature) :
+            mpCurvature(curvature)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                if (mpCurvature->mBoundaryFlags[vid])
+                {
+                    mpCurvature->ComputeBoundaryVertex(vid);
+                }
+            }
+        }
+
+    private:
+        MeshCurvature* mpCurvature;
+    };
+
+    MeshCurvature::MeshCurvature() :
+        mpTriMesh(NULL),
+        mVertexCount(0),
+        mTriangleCount(0),
+        mVertexCoords(),
+        mTriangleVertexIds(),
+        mVertexCornerStarts(),
+        mVertexCornerIds(),
+        mCornerCots(),
+        mCornerAngles(),
+        mCornerAreas(),
+        mTriangleNormals(),
+        mBoundaryFlags(),
+        mMixedAreas(),
+        mVertexNormals(),
+        mMeanCurvature(),
+        mGaussCurvature(),
+        mMinCurvature(),
+        mMaxCurvature(),
+        mMinCurvatureDirs(),
+        mMaxCurvatureDirs()
+    {
+    }
+
+    MeshCurvature::~MeshCurvature()
+    {
+    }
+
+    GPP::ErrorCode MeshCurvature::Init(const GPP::ITriMesh* triMesh)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mVertexCount = triMesh->GetVertexCount();
+        mTriangleCount = triMesh->GetTriangleCount();
+        mVertexCoords.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = triMesh->GetVertexCoord(vid);
+        }
+        mTriangleVertexIds.resize(mTriangleCount * 3);
+        mVertexCornerStarts.assign(mVertexCount + 1, 0);
+        GPP::Int vertexIds[3] = {-1, -1, -1};
+        for (GPP::Int fid = 0; fid < mTriangleCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (vertexIds[fvid] < 0 || vertexIds[fvid] >= mVertexCount)
+                {
+                    Clear();
+                    return GPP_INVALID_INPUT;
+                }
+                mTriangleVertexIds[fid * 3 + fvid] = vertexIds[fvid];
+                mVertexCornerStarts[vertexIds[fvid] + 1]++;
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCornerStarts[vid + 1] += mVertexCornerStarts[vid];
+        }
+        mVertexCornerIds.resize(mTriangleCount * 3);
+        std::vector<GPP::Int> cornerCounts(mVertexCount, 0);
+        for (GPP::Int cid = 0; cid < mTriangleCount * 3; cid++)
+        {
+            GPP::Int vid = mTriangleVertexIds[cid];
+            mVertexCornerIds[mVertexCornerStarts[vid] + cornerCounts[vid]] = cid;
+            cornerCounts[vid]++;
+        }
+
+        mCornerCots.resize(mTriangleCount * 3);
+        mCornerAngles.resize(mTriangleCount * 3);
+        mCornerAreas.resize(mTriangleCount * 3);
+        mTriangleNormals.resize(mTriangleCount);
+        CornerGeometryTask cornerTask(this);
+        ThreadPool::Get()->ParallelFor(mTriangleCount, &cornerTask);
+
+        mBoundaryFlags.assign(mVertexCount, 0);
+        mMixedAreas.assign(mVertexCount, 0);
+        mVertexNormals.resize(mVertexCount);
+        mMeanCurvature.assign(mVertexCount, 0);
+        mGaussCurvature.assign(mVertexCount, 0);
+        mMinCurvature.assign(mVertexCount, 0);
+        mMaxCurvature.assign(mVertexCount, 0);
+        mMinCurvatureDirs.resize(mVertexCount);
+        mMaxCurvatureDirs.resize(mVertexCount);
+        VertexCurvatureTask vertexTask(this);
+        ThreadPool::Get()->ParallelFor(mVertexCount, &vertexTask);
+        BoundaryCurvatureTask boundaryTask(this);
+        ThreadPool::Get()->ParallelFor(mVertexCount, &boundaryTask);
+
+        InfoLog << "MeshCurvature::Init: " << mVertexCount << " vertices, " << mTriangleCount << " triangles" << std::endl;
+        mpTriMesh = triMesh;
+        return GPP_NO_ERROR;
+    }
+
+    void MeshCurvature::Clear()
+    {
+        mpTriMesh = NULL;
+        mVertexCount = 0;
+        mTriangleCount = 0;
+        mVertexCoords.clear();
+        mTriangleVertexIds.clear();
+        mVertexCornerStarts.clear();
+        mVertexCornerIds.clear();
+        mCornerCots.clear();
+        mCornerAngles.clear();
+        mCornerAreas.clear();
+        mTriangleNormals.clear();
+        mBoundaryFlags.clear();
+        mMixedAreas.clear();
+        mVertexNormals.clear();
+        mMeanCurvature.clear();
+        mGaussCurvature.clear();
+        mMinCurvature.clear();
+        mMaxCurvature.clear();
+        mMinCurvatureDirs.clear();
+        mMaxCurvatureDirs.clear();
+    }
+
+    const GPP::ITriMesh* MeshCurvature::GetMesh() const
+    {
+        return mpTriMesh;
+    }
+
+    bool MeshCurvature::IsValid(const GPP::ITriMesh* triMesh) const
+    {
+        return triMesh != NULL && triMesh == mpTriMesh && triMesh->GetVertexCount() == mVertexCount &&
+            triMesh->GetTriangleCount() == mTriangleCount;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetCornerCots() const
+    {
+        return mCornerCots;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetMixedAreas() const
+    {
+        return mMixedAreas;
+    }
+
+    const std::vector<GPP::Vector3>& MeshCurvature::GetVertexNormals() const
+    {
+        return mVertexNormals;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetMeanCurvature() const
+    {
+        return mMeanCurvature;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetGaussCurvature() const
+    {
+        return mGaussCurvature;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetMinCurvature() const
+    {
+        return mMinCurvature;
+    }
+
+    const std::vector<GPP::Real>& MeshCurvature::GetMaxCurvature() const
+    {
+        return mMaxCurvature;
+    }
+
+    const std::vector<GPP::Vector3>& MeshCurvature::GetMinCurvatureDirs() const
+    {
+        return mMinCurvatureDirs;
+    }
+
+    const std::vector<GPP::Vector3>& MeshCurvature::GetMaxCurvatureDirs() const
+    {
+        return mMaxCurvatureDirs;
+    }
+
+    void MeshCurvature::ComputeCorners(GPP::Int fid)
+    {
+        const GPP::Int* vertexIds = &mTriangleVertexIds[fid * 3];
+        GPP::Real squaredLengths[3];
+        bool isObtuse = false;
+        for (int fvid = 0; fvid < 3; fvid++)
+        {
+            const GPP::Vector3& coord = mVertexCoords[vertexIds[fvid]];
+            GPP::Vector3 edge0 = mVertexCoords[vertexIds[(fvid + 1) % 3]] - coord;
+            GPP::Vector3 edge1 = mVertexCoords[vertexIds[(fvid + 2) % 3]] - coord;
+            GPP::Real sinValue = edge0.CrossProduct(edge1).Length();
+            GPP::Real cosValue = edge0 * edge1;
+            GPP::Real cotValue = 0;
+            if (sinValue * gMaxCornerCot > fabs(cosValue))
+            {
+                cotValue = cosValue / sinValue;
+            }
+            else if (sinValue > 0 || cosValue != 0)
+            {
+                cotValue = cosValue > 0 ? gMaxCornerCot : -gMaxCornerCot;
+            }
+            mCornerCots[fid * 3 + fvid] = cotValue;
+            mCornerAngles[fid * 3 + fvid] = atan2(sinValue, cosValue);
+            isObtuse = isObtuse || cosValue < 0;
+            // Length of the opposite edge
+            squaredLengths[fvid] = (edge1 - edge0) * (edge1 - edge0);
+        }
+        GPP::Vector3 areaNormal = (mVertexCoords[vertexIds[1]] - mVertexCoords[vertexIds[0]]).CrossProduct(
+            mVertexCoords[vertexIds[2]] - mVertexCoords[vertexIds[0]]) * 0.5;
+        mTriangleNormals[fid] = areaNormal;
+        GPP::Real area = areaNormal.Length();
+        for (int fvid = 0; fvid < 3; fvid++)
+        {
+            GPP::Int cid = fid * 3 + fvid;
+            if (isObtuse)
+            {
+                // Voronoi region leaves the triangle, split the area instead
+                mCornerAreas[cid] = mCornerAngles[cid] * 2.0 > gPi ? area * 0.5 : area * 0.25;
+            }
+            else
+            {
+                mCornerAreas[cid] = (squaredLengths[(fvid + 1) % 3] * mCornerCots[fid * 3 + (fvid + 1) % 3] +
+                    squaredLengths[(fvid + 2) % 3] * mCornerCots[fid * 3 + (fvid + 2) % 3]) / 8.0;
+            }
+        }
+    }
+
+    void MeshCurvature::ComputeVertex(GPP::Int vid)
+    {
+        GPP::Int cornerStart = mVertexCornerStarts[vid];
+        GPP::Int cornerEnd = mVertexCornerStarts[vid + 1];
+        const GPP::Vector3& coord = mVertexCoords[vid];
+        GPP::Real area = 0;
+        GPP::Real angleSum = 0;
+        GPP::Vector3 normal(0, 0, 0);
+        GPP::Vector3 laplacian(0, 0, 0);
+        bool isBoundary = cornerStart == cornerEnd;
+        for (GPP::Int iid = cornerStart; iid < cornerEnd; iid++)
+        {
+            GPP::Int cid = mVertexCornerIds[iid];
+            GPP::Int fid = cid / 3;
+            GPP::Int nextCid = fid * 3 + (cid + 1) % 3;
+            GPP::Int prevCid = fid * 3 + (cid + 2) % 3;
+            area += mCornerAreas[cid];
+            angleSum += mCornerAngles[cid];
+            normal += mTriangleNormals[fid];
+            // Edge to the next vertex is opposite to the previous corner, and vice versa
+            laplacian += (mVertexCoords[mTriangleVertexIds[nextCid]] - coord) * mCornerCots[prevCid] +
+                (mVertexCoords[mTriangleVertexIds[prevCid]] - coord) * mCornerCots[nextCid];
+            // An edge of an interior vertex is the next edge of one corner and the previous edge of another
+            if (!isBoundary)
+            {
+                GPP::Int nextVid = mTriangleVertexIds[nextCid];
+                bool isMatched = false;
+                for (GPP::Int jid = cornerStart; jid < cornerEnd; jid++)
+                {
+                    GPP::Int otherCid = mVertexCornerIds[jid];
+                    if (mTriangleVertexIds[otherCid / 3 * 3 + (otherCid + 2) % 3] == nextVid)
+                    {
+                        isMatched = true;
+                        break;
+                    }
+                }
+                isBoundary = !isMatched;
+            }
+        }
+        mMixedAreas[vid] = area;
+        if (normal.Normalise() < GPP::REAL_TOL)
+        {
+            normal = GPP::Vector3(0, 0, 1);
+        }
+        mVertexNormals[vid] = normal;
+        mBoundaryFlags[vid] = isBoundary ? 1 : 0;
+
+        // Tangent frame
+        GPP::Vector3 tangent0 = fabs(normal[0]) < 0.9 ? GPP::Vector3(1, 0, 0) : GPP::Vector3(0, 1, 0);
+        tangent0 = tangent0 - normal * (tangent0 * normal);
+        tangent0.Normalise();
+        GPP::Vector3 tangent1 = normal.CrossProduct(tangent0);
+        mMaxCurvatureDirs[vid] = tangent0;
+        mMinCurvatureDirs[vid] = tangent1;
+        if (isBoundary || area <= 0)
+        {
+            return;
+        }
+        GPP::Real meanCurvature = -(laplacian * normal) / (4.0 * area);
+        GPP::Real gaussCurvature = (2.0 * gPi - angleSum) / area;
+        mMeanCurvature[vid] = meanCurvature;
+        mGaussCurvature[vid] = gaussCurvature;
+        GPP::Real discriminant = meanCurvature * meanCurvature - gaussCurvature;
+        discriminant = discriminant > 0 ? sqrt(discriminant) : 0;
+        mMaxCurvature[vid] = meanCurvature + discriminant;
+        mMinCurvature[vid] = meanCurvature - discriminant;
+
+        // Shape operator [a b; b c] fitted to the normal curvatures of the edges, weighted by their cotangent areas
+        GPP::Real normalMatrix[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+        GPP::Real normalRhs[3] = {0, 0, 0};
+        for (GPP::Int iid = cornerStart; iid < cornerEnd; iid++)
+        {
+            GPP::Int cid = mVertexCornerIds[iid];
+            GPP::Int fid = cid / 3;
+            for (int side = 1; side < 3; side++)
+            {
+                GPP::Vector3 edge = mVertexCoords[mTriangleVertexIds[fid * 3 + (cid + side) % 3]] - coord;
+                GPP::Real squaredLength = edge * edge;
+                GPP::Real cotValue = mCornerCots[fid * 3 + (cid + 3 - side) % 3];
+                GPP::Vector3 tangentEdge = edge - normal * (edge * normal);
+                GPP::Real tangentLength = tangentEdge.Length();
+                if (squaredLength < GPP::REAL_TOL * GPP::REAL_TOL || tangentLength < GPP::REAL_TOL)
+                {
+                    continue;
+                }
+                GPP::Real weight = (cotValue > 0 ? cotValue : 0) * squaredLength + GPP::REAL_TOL;
+                GPP::Real normalCurvature = -2.0 * (edge * normal) / squaredLength;
+                GPP::Real u = (tangentEdge * tangent0) / tangentLength;
+                GPP::Real v = (tangentEdge * tangent1) / tangentLength;
+                GPP::Real basis[3] = {u * u, 2.0 * u * v, v * v};
+                for (int row = 0; row < 3; row++)
+                {
+                    for (int col = 0; col < 3; col++)
+                    {
+                        normalMatrix[row][col] += weight * basis[row] * basis[col];
+                    }
+                    normalRhs[row] += weight * basis[row] * normalCurvature;
+                }
+            }
+        }
+        GPP::Real det = normalMatrix[0][0] * (normalMatrix[1][1] * normalMatrix[2][2] - normalMatrix[1][2] * normalMatrix[2][1]) -
+            normalMatrix[0][1] * (normalMatrix[1][0] * normalMatrix[2][2] - normalMatrix[1][2] * normalMatrix[2][0]) +
+            normalMatrix[0][2] * (normalMatrix[1][0] * normalMatrix[2][1] - normalMatrix[1][1] * normalMatrix[2][0]);
+        GPP::Real scale = normalMatrix[0][0] + normalMatrix[1][1] + normalMatrix[2][2];
+        if (fabs(det) <= GPP::REAL_TOL * scale * scale * scale)
+        {
+            return;
+        }
+        // Cramer's rule
+        GPP::Real shape[3];
+        for (int cid = 0; cid < 3; cid++)
+        {
+            GPP::Real matrix[3][3];
+            for (int row = 0; row < 3; row++)
+            {
+                for (int col = 0; col < 3; col++)
+                {
+                    matrix[row][col] = col == cid ? normalRhs[row] : normalMatrix[row][col];
+                }
+            }
+            shape[cid] = (matrix[0][0] * (matrix[1][1] * matrix[2][2] - matrix[1][2] * matrix[2][1]) -
+                matrix[0][1] * (matrix[1][0] * matrix[2][2] - matrix[1][2] * matrix[2][0]) +
+                matrix[0][2] * (matrix[1][0] * matrix[2][1] - matrix[1][1] * matrix[2][0])) / det;
+        }
+        // Eigen vector of the larger eigen value
+        GPP::Real angle = 0.5 * atan2(2.0 * shape[1], shape[0] - shape[2]);
+        GPP::Vector3 maxDir = tangent0 * cos(angle) + tangent1 * sin(angle);
+        mMaxCurvatureDirs[vid] = maxDir;
+        mMinCurvatureDirs[vid] = normal.CrossProduct(maxDir);
+    }
+
+    void MeshCurvature::ComputeBoundaryVertex(GPP::Int vid)
+    {
+        GPP::Real meanCurvature = 0;
+        GPP::Real gaussCurvature = 0;
+        GPP::Real minCurvature = 0;
+        GPP::Real maxCurvature = 0;
+        GPP::Vector3 maxDir(0, 0, 0);
+        GPP::Int interiorCount = 0;
+        const GPP::Vector3& normal = mVertexNormals[vid];
+        for (GPP::Int iid = mVertexCornerStarts[vid]; iid < mVertexCornerStarts[vid + 1]; iid++)
+        {
+            GPP::Int cid = mVertexCornerIds[iid];
+            for (int side = 1; side < 3; side++)
+            {
+                // Interior neighbors are visited once or twice, both count
+                GPP::Int neighborId = mTriangleVertexIds[cid / 3 * 3 + (cid + side) % 3];
+                if (mBoundaryFlags[neighborId])
+                {
+                    continue;
+                }
+                meanCurvature += mMeanCurvature[neighborId];
+                gaussCurvature += mGaussCurvature[neighborId];
+                minCurvature += mMinCurvature[neighborId];
+                maxCurvature += mMaxCurvature[neighborId];
+                // Directions have no sign
+                GPP::Vector3 neighborDir = mMaxCurvatureDirs[neighborId];
+                neighborDir = neighborDir - normal * (neighborDir * normal);
+                maxDir += (neighborDir * maxDir < 0) ? neighborDir * -1.0 : neighborDir;
+                interiorCount++;
+            }
+        }
+        if (interiorCount == 0)
+        {
+            return;
+        }
+        mMeanCurvature[vid] = meanCurvature / interiorCount;
+        mGaussCurvature[vid] = gaussCurvature / interiorCount;
+        mMinCurvature[vid] = minCurvature / interiorCount;
+        mMaxCurvature[vid] = maxCurvature / interiorCount;
+        if (maxDir.Normalise() > GPP::REAL_TOL)
+        {
+            mMaxCurvatureDirs[vid] = maxDir;
+            mMinCurvatureDirs[vid] = normal.CrossProduct(maxDir);
+        }
+    }
+}
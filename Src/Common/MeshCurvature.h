@@ -0,0 +1,75 @@
+#pragma once
+#include "ITriMesh.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // Discrete differential geometry of a triangle mesh, computed in one parallel pass and shared by all curvature
+    // quantities: corner cotangents and mixed Voronoi areas, the cotangent Laplacian for the mean curvature, the angle
+    // deficit for the Gaussian curvature, and a least squares shape operator in the tangent plane for the principal
+    // directions (Meyer et al. 2003). Principal values are H +- sqrt(H^2 - K), so the four quantities agree.
+    // Curvature is positive where the surface bends away from the vertex normal, such as on a sphere, and its unit
+    // is 1 / length like GPP::MeasureMesh: scaling the mesh by s divides it by s. The mean curvature is
+    // H = (k1 + k2) / 2, so a sphere of radius r has H = 1 / r. MeasureApp's color offsets and the
+    // PrincipalCurvatureDistance weights assume these values, DEVELOPSTATE logs their deviation from GPP.
+    // Boundary vertices have no complete one ring, they take the average of their interior neighbors.
+    class MeshCurvature
+    {
+    public:
+        MeshCurvature();
+        ~MeshCurvature();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh);
+        void Clear(void);
+
+        const GPP::ITriMesh* GetMesh(void) const;
+        // Whether the engine is built on triMesh and its vertex/triangle counts are unchanged
+        bool IsValid(const GPP::ITriMesh* triMesh) const;
+
+        // Cotangent of each triangle corner, in the order of the triangle vertices
+        const std::vector<GPP::Real>& GetCornerCots(void) const;
+        const std::vector<GPP::Real>& GetMixedAreas(void) const;
+        // Area weighted triangle normals
+        const std::vector<GPP::Vector3>& GetVertexNormals(void) const;
+        const std::vector<GPP::Real>& GetMeanCurvature(void) const;
+        const std::vector<GPP::Real>& GetGaussCurvature(void) const;
+        const std::vector<GPP::Real>& GetMinCurvature(void) const;
+        const std::vector<GPP::Real>& GetMaxCurvature(void) const;
+        const std::vector<GPP::Vector3>& GetMinCurvatureDirs(void) const;
+        const std::vector<GPP::Vector3>& GetMaxCurvatureDirs(void) const;
+
+    private:
+        friend class CornerGeometryTask;
+        friend class VertexCurvatureTask;
+        friend class BoundaryCurvatureTask;
+        // Cotangents, angles and mixed areas of the corners of triangle fid, and its area weighted normal
+        void ComputeCorners(GPP::Int fid);
+        void ComputeVertex(GPP::Int vid);
+        void ComputeBoundaryVertex(GPP::Int vid);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mVertexCount;
+        GPP::Int mTriangleCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        // Corners of vertex vid are mVertexCornerIds[mVertexCornerStarts[vid], mVertexCornerStarts[vid + 1]),
+        // corner id is fid * 3 + local vertex id
+        std::vector<GPP::Int> mVertexCornerStarts;
+        std::vector<GPP::Int> mVertexCornerIds;
+        std::vector<GPP::Real> mCornerCots;
+        std::vector<GPP::Real> mCornerAngles;
+        std::vector<GPP::Real> mCornerAreas;
+        std::vector<GPP::Vector3> mTriangleNormals;
+        // Written by the parallel vertex pass, so it is not a vector<bool>
+        std::vector<int> mBoundaryFlags;
+        std::vector<GPP::Real> mMixedAreas;
+        std::vector<GPP::Vector3> mVertexNormals;
+        std::vector<GPP::Real> mMeanCurvature;
+        std::vector<GPP::Real> mGaussCurvature;
+        std::vector<GPP::Real> mMinCurvature;
+        std::vector<GPP::Real> mMaxCurvature;
+        std::vector<GPP::Vector3> mMinCurvatureDirs;
+        std::vector<GPP::Vector3> mMaxCurvatureDirs;
+    };
+}
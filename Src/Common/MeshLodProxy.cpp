@@ -0,0 +1,240 @@
+#include "MeshLodProxy.h"
+#include "SelectionSet.h"
+#include "LogSystem.h"
+#include "SimplifyMesh.h"
+
+namespace MagicCore
+{
+    // Vertex count of the proxy, it is drawn in a few milliseconds by any graphics card
+    static const GPP::Int gProxyVertexCount = 100000;
+
+    class ProxyBuildTask : public ThreadTask
+    {
+    public:
+        ProxyBuildTask() :
+            mVertexCoords(),
+            mVertexColors(),
+            mTriangleVertexIds(),
+            mVertexNormals(),
+            mGeneration(-1),
+            mResult(GPP_NO_ERROR)
+        {
+        }
+
+        // Snapshot of the mesh as it is rendered
+        void Setup(const GPP::TriMesh* mesh, const SelectionSet* selection, const GPP::Vector3* selectColor, GPP::Int generation)
+        {
+            mGeneration = generation;
+            GPP::Int vertexCount = mesh->GetVertexCount();
+            mVertexCoords.resize(vertexCount * 3);
+            mVertexColors.resize(vertexCount * 3);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                GPP::Vector3 coord = mesh->GetVertexCoord(vid);
+                GPP::Vector3 color = (selection && selectColor && selection->IsSelected(vid)) ? *selectColor : mesh->GetVertexColor(vid);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    mVertexCoords[vid * 3 + axis] = float(coord[axis]);
+                    mVertexColors[vid * 3 + axis] = float(color[axis]);
+                }
+            }
+            GPP::Int faceCount = mesh->GetTriangleCount();
+            mTriangleVertexIds.resize(faceCount * 3);
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                mesh->GetTriangleVertexIds(fid, &mTriangleVertexIds[fid * 3]);
+            }
+            std::vector<float>().swap(mVertexNormals);
+            mResult = GPP_NO_ERROR;
+        }
+
+        virtual void Run(void)
+        {
+            GPP::TriMesh triMesh;
+            GPP::Int vertexCount = mVertexCoords.size() / 3;
+            std::vector<GPP::Real> vertexFields(vertexCount * 3);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                triMesh.InsertVertex(GPP::Vector3(mVertexCoords[vid * 3], mVertexCoords[vid * 3 + 1], mVertexCoords[vid * 3 + 2]));
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    vertexFields[vid * 3 + axis] = mVertexColors[vid * 3 + axis];
+                }
+            }
+            std::vector<float>().swap(mVertexCoords);
+            std::vector<float>().swap(mVertexColors);
+            GPP::Int faceCount = mTriangleVertexIds.size() / 3;
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                triMesh.InsertTriangle(mTriangleVertexIds[fid * 3], mTriangleVertexIds[fid * 3 + 1], mTriangleVertexIds[fid * 3 + 2]);
+            }
+            std::vector<GPP::Int>().swap(mTriangleVertexIds);
+
+            std::vector<GPP::Real> simplifiedFields;
+            mResult = GPP::SimplifyMesh::QuadricSimplify(&triMesh, gProxyVertexCount, false, &vertexFields, &simplifiedFields);
+            if (mResult != GPP_NO_ERROR)
+            {
+                return;
+            }
+            std::vector<GPP::Real>().swap(vertexFields);
+            triMesh.UpdateNormal();
+
+            vertexCount = triMesh.GetVertexCount();
+            mVertexCoords.resize(vertexCount * 3);
+            mVertexNormals.resize(vertexCount * 3);
+            mVertexColors.resize(vertexCount * 3);
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                GPP::Vector3 coord = triMesh.GetVertexCoord(vid);
+                GPP::Vector3 normal = triMesh.GetVertexNormal(vid);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    mVertexCoords[vid * 3 + axis] = float(coord[axis]);
+                    mVertexNormals[vid * 3 + axis] = float(normal[axis]);
+                    mVertexColors[vid * 3 + axis] = float(simplifiedFields[vid * 3 + axis]);
+                }
+            }
+            faceCount = triMesh.GetTriangleCount();
+            mTriangleVertexIds.resize(faceCount * 3);
+            for (GPP::Int fid = 0; fid < faceCount; fid++)
+            {
+                triMesh.GetTriangleVertexIds(fid, &mTriangleVertexIds[fid * 3]);
+            }
+        }
+
+        void Clear(void)
+        {
+            std::vector<float>().swap(mVertexCoords);
+            std::vector<float>().swap(mVertexColors);
+            std::vector<GPP::Int>().swap(mTriangleVertexIds);
+            std::vector<float>().swap(mVertexNormals);
+        }
+
+        // Snapshot before Run, proxy geometry after it
+        std::vector<float> mVertexCoords;
+        std::vector<float> mVertexColors;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<float> mVertexNormals;
+        GPP::Int mGeneration;
+        GPP::ErrorCode mResult;
+    };
+
+    MeshLodProxy::MeshLodProxy() :
+        mpBuildTask(new ProxyBuildTask),
+        mpPendingTask(new ProxyBuildTask),
+        mBuildGroup(),
+        mIsBuilding(false),
+        mHasPending(false),
+        mGeneration(0),
+        mResultGeneration(-1),
+        mVertexCoords(),
+        mVertexNormals(),
+        mVertexColors(),
+        mTriangleVertexIds()
+    {
+    }
+
+    MeshLodProxy::~MeshLodProxy()
+    {
+        if (mIsBuilding)
+        {
+            ThreadPool::Get()->Wait(&mBuildGroup);
+            mIsBuilding = false;
+        }
+        GPPFREEPOINTER(mpBuildTask);
+        GPPFREEPOINTER(mpPendingTask);
+    }
+
+    void MeshLodProxy::Update(const GPP::TriMesh* mesh, const SelectionSet* selection, const GPP::Vector3* selectColor)
+    {
+        mGeneration++;
+        mpPendingTask->Setup(mesh, selection, selectColor, mGeneration);
+        mHasPending = true;
+        if (!mIsBuilding)
+        {
+            StartBuild();
+        }
+    }
+
+    void MeshLodProxy::Invalidate()
+    {
+        mGeneration++;
+        if (mHasPending)
+        {
+            mpPendingTask->Clear();
+            mHasPending = false;
+        }
+    }
+
+    bool MeshLodProxy::FetchResult()
+    {
+        if (!mIsBuilding || !mBuildGroup.IsFinished())
+        {
+            return false;
+        }
+        mIsBuilding = false;
+        mResultGeneration = mpBuildTask->mGeneration;
+        if (mpBuildTask->mResult == GPP_NO_ERROR)
+        {
+            mVertexCoords.swap(mpBuildTask->mVertexCoords);
+            mVertexNormals.swap(mpBuildTask->mVertexNormals);
+            mVertexColors.swap(mpBuildTask->mVertexColors);
+            mTriangleVertexIds.swap(mpBuildTask->mTriangleVertexIds);
+        }
+        else
+        {
+            InfoLog << "MeshLodProxy: QuadricSimplify failed " << mpBuildTask->mResult << std::endl;
+            std::vector<float>().swap(mVertexCoords);
+            std::vector<float>().swap(mVertexNormals);
+            std::vector<float>().swap(mVertexColors);
+            std::vector<GPP::Int>().swap(mTriangleVertexIds);
+        }
+        mpBuildTask->Clear();
+        if (mHasPending)
+        {
+            StartBuild();
+        }
+        return true;
+    }
+
+    bool MeshLodProxy::IsBuilding() const
+    {
+        return mIsBuilding && !mBuildGroup.IsFinished();
+    }
+
+    bool MeshLodProxy::IsUpToDate() const
+    {
+        return !mIsBuilding && !mHasPending && mResultGeneration == mGeneration;
+    }
+
+    const std::vector<float>& MeshLodProxy::GetVertexCoords() const
+    {
+        return mVertexCoords;
+    }
+
+    const std::vector<float>& MeshLodProxy::GetVertexNormals() const
+    {
+        return mVertexNormals;
+    }
+
+    const std::vector<float>& MeshLodProxy::GetVertexColors() const
+    {
+        return mVertexColors;
+    }
+
+    const std::vector<GPP::Int>& MeshLodProxy::GetTriangleVertexIds() const
+    {
+        return mTriangleVertexIds;
+    }
+
+    void MeshLodProxy::StartBuild()
+    {
+        // The finished task takes the next snapshot
+        ProxyBuildTask* buildTask = mpPendingTask;
+        mpPendingTask = mpBuildTask;
+        mpBuildTask = buildTask;
+        mHasPending = false;
+        mIsBuilding = true;
+        ThreadPool::Get()->Submit(mpBuildTask, &mBuildGroup);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "GPP.h"
+#include "ThreadPool.h"
+#include <vector>
+
+namespace MagicCore
+{
+    class SelectionSet;
+    class ProxyBuildTask;
+
+    // Decimated copy of a big mesh for interactive rendering.
+    // Update takes a snapshot of the mesh as it is rendered, with the selection color baked into the vertex colors,
+    // so the mesh could be edited or deleted while the proxy is built. The snapshot is simplified by QuadricSimplify
+    // on the ThreadPool. Only one build runs at a time: a snapshot taken during a build waits for it, and a newer
+    // snapshot replaces a waiting one. Every Update and Invalidate starts a new generation, a build result is only
+    // up to date if it is built from the snapshot of the current generation.
+    class MeshLodProxy
+    {
+    public:
+        MeshLodProxy();
+        // It waits for the running build
+        ~MeshLodProxy();
+
+        void Update(const GPP::TriMesh* mesh, const SelectionSet* selection, const GPP::Vector3* selectColor);
+        // The mesh is changed without a snapshot, the proxy is out of date until the next Update
+        void Invalidate(void);
+        // Start the waiting snapshot if the last build is finished.
+        // Return true if the last build is finished since the previous call, then the proxy geometry is changed.
+        bool FetchResult(void);
+        // Whether a build is running on the ThreadPool, the proxy could be deleted without waiting if it is false
+        bool IsBuilding(void) const;
+        // Whether the proxy geometry is built from the snapshot of the current generation
+        bool IsUpToDate(void) const;
+
+        // Proxy geometry, 3 values per vertex. They are empty if the build failed.
+        const std::vector<float>& GetVertexCoords(void) const;
+        const std::vector<float>& GetVertexNormals(void) const;
+        const std::vector<float>& GetVertexColors(void) const;
+        const std::vector<GPP::Int>& GetTriangleVertexIds(void) const;
+
+    private:
+        void StartBuild(void);
+
+    private:
+        ProxyBuildTask* mpBuildTask;
+        ProxyBuildTask* mpPendingTask;
+        TaskGroup mBuildGroup;
+        bool mIsBuilding;
+        bool mHasPending;
+        GPP::Int mGeneration;
+        GPP::Int mResultGeneration;
+        std::vector<float> mVertexCoords;
+        std::vector<float> mVertexNormals;
+        std::vector<float> mVertexColors;
+        std::vector<GPP::Int> mTriangleVertexIds;
+    };
+}
@@ -0,0 +1,1284 @@
+#include "MeshQueryEngine.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace MagicCore
+{
+    static const int gBvhLeafSize = 4;
+    static const int gBvhMaxLeafSize = 16;
+    static const int gBvhBinCount = 16;
+    static const int gBvhStackSize = 128;
+    static const int gMeshHashChunkSize = 65536;
+    // Active rays of a packet are the bits of an unsigned int
+    static const int gRayPacketSize = 32;
+
+    // Float boxes are rounded outward, so they always contain the double precision triangles
+    static inline float FloorFloat(GPP::Real value)
+    {
+        float result = float(value);
+        if (result > value)
+        {
+            result -= (fabs(result) + FLT_MIN) * FLT_EPSILON;
+        }
+        return result;
+    }
+
+    static inline float CeilFloat(GPP::Real value)
+    {
+        float result = float(value);
+        if (result < value)
+        {
+            result += (fabs(result) + FLT_MIN) * FLT_EPSILON;
+        }
+        return result;
+    }
+
+    // Traversal stack on the call stack, deeper entries move to the heap so a degenerate hierarchy is still fully traversed
+    template<typename T>
+    class TraversalStack
+    {
+    public:
+        TraversalStack() :
+            mSize(0),
+            mHeapItems()
+        {
+        }
+
+        void Push(const T& item)
+        {
+            if (mSize < gBvhStackSize)
+            {
+                mItems[mSize] = item;
+            }
+            else
+            {
+                mHeapItems.push_back(item);
+            }
+            mSize++;
+        }
+
+        T Pop(void)
+        {
+            mSize--;
+            if (mSize < gBvhStackSize)
+            {
+                return mItems[mSize];
+            }
+            T item = mHeapItems.back();
+            mHeapItems.pop_back();
+            return item;
+        }
+
+        bool IsEmpty(void) const
+        {
+            return mSize == 0;
+        }
+
+    private:
+        T mItems[gBvhStackSize];
+        int mSize;
+        std::vector<T> mHeapItems;
+    };
+
+    struct PacketStackItem
+    {
+        GPP::Int nodeId;
+        unsigned int rayMask;
+    };
+
+    static inline GPP::ULongInt HashWord(GPP::ULongInt hash, GPP::ULongInt word)
+    {
+        return (hash ^ word) * 1099511628211ULL;
+    }
+
+    static inline GPP::ULongInt HashReal(GPP::ULongInt hash, GPP::Real value)
+    {
+        GPP::ULongInt word = 0;
+        memcpy(&word, &value, sizeof(GPP::Real) < sizeof(word) ? sizeof(GPP::Real) : sizeof(word));
+        return HashWord(hash, word);
+    }
+
+    // Chunks are hashed in parallel and combined in order, so the hash does not depend on the thread count
+    class MeshHashTask : public ParallelTask
+    {
+    public:
+        MeshHashTask(const GPP::ITriMesh* triMesh, std::vector<GPP::ULongInt>* coordHashes, std::vector<GPP::ULongInt>* topologyHashes) :
+            mpTriMesh(triMesh),
+            mpCoordHashes(coordHashes),
+            mpTopologyHashes(topologyHashes)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int vertexCount = mpTriMesh->GetVertexCount();
+            GPP::Int faceCount = mpTriMesh->GetTriangleCount();
+            for (int chunkId = startId; chunkId < endId; chunkId++)
+            {
+                GPP::ULongInt coordHash = 14695981039346656037ULL;
+                GPP::Int startVertexId = GPP::Int(chunkId) * gMeshHashChunkSize;
+                GPP::Int endVertexId = startVertexId + gMeshHashChunkSize < vertexCount ? startVertexId + gMeshHashChunkSize : vertexCount;
+                for (GPP::Int vid = startVertexId; vid < endVertexId; vid++)
+                {
+                    GPP::Vector3 coord = mpTriMesh->GetVertexCoord(vid);
+                    coordHash = HashReal(HashReal(HashReal(coordHash, coord[0]), coord[1]), coord[2]);
+                }
+                (*mpCoordHashes)[chunkId] = coordHash;
+                GPP::ULongInt topologyHash = 14695981039346656037ULL;
+                GPP::Int startFaceId = GPP::Int(chunkId) * gMeshHashChunkSize;
+                GPP::Int endFaceId = startFaceId + gMeshHashChunkSize < faceCount ? startFaceId + gMeshHashChunkSize : faceCount;
+                GPP::Int vertexIds[3];
+                for (GPP::Int fid = startFaceId; fid < endFaceId; fid++)
+                {
+                    mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                    topologyHash = HashWord(HashWord(HashWord(topologyHash, vertexIds[0]), vertexIds[1]), vertexIds[2]);
+                }
+                (*mpTopologyHashes)[chunkId] = topologyHash;
+            }
+        }
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        std::vector<GPP::ULongInt>* mpCoordHashes;
+        std::vector<GPP::ULongInt>* mpTopologyHashes;
+    };
+
+    static inline void ResetBox(float bboxMin[3], float bboxMax[3])
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bboxMin[axis] = FLT_MAX;
+            bboxMax[axis] = -FLT_MAX;
+        }
+    }
+
+    static inline void UnionBox(float bboxMin[3], float bboxMax[3], const float otherMin[3], const float otherMax[3])
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bboxMin[axis] = otherMin[axis] < bboxMin[axis] ? otherMin[axis] : bboxMin[axis];
+            bboxMax[axis] = otherMax[axis] > bboxMax[axis] ? otherMax[axis] : bboxMax[axis];
+        }
+    }
+
+    static inline float BoxArea(const float bboxMin[3], const float bboxMax[3])
+    {
+        float dx = bboxMax[0] - bboxMin[0];
+        float dy = bboxMax[1] - bboxMin[1];
+        float dz = bboxMax[2] - bboxMin[2];
+        if (dx < 0 || dy < 0 || dz < 0)
+        {
+            return 0;
+        }
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    static inline GPP::Real BoxDistanceSquared(const BvhNode& node, const GPP::Vector3& coord)
+    {
+        GPP::Real distanceSquared = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real delta = 0;
+            if (coord[axis] < node.bboxMin[axis])
+            {
+                delta = node.bboxMin[axis] - coord[axis];
+            }
+            else if (coord[axis] > node.bboxMax[axis])
+            {
+                delta = coord[axis] - node.bboxMax[axis];
+            }
+            distanceSquared += delta * delta;
+        }
+        return distanceSquared;
+    }
+
+    // Slab test, return the entry distance or -1 if the ray misses the box within maxDistance
+    static inline GPP::Real RayBoxEntry(const BvhNode& node, const GPP::Vector3& rayOrigin, const GPP::Real invDirection[3],
+        GPP::Real maxDistance)
+    {
+        GPP::Real tNear = 0;
+        GPP::Real tFar = maxDistance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real t0 = (node.bboxMin[axis] - rayOrigin[axis]) * invDirection[axis];
+            GPP::Real t1 = (node.bboxMax[axis] - rayOrigin[axis]) * invDirection[axis];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+            tNear = t0 > tNear ? t0 : tNear;
+            tFar = t1 < tFar ? t1 : tFar;
+            if (tNear > tFar)
+            {
+                return -1;
+            }
+        }
+        return tNear;
+    }
+
+    // Moller-Trumbore, return hit distance or -1
+    static inline GPP::Real RayTriangle(const GPP::Vector3& rayOrigin, const GPP::Vector3& rayDirection,
+        const GPP::Vector3& v0, const GPP::Vector3& v1, const GPP::Vector3& v2)
+    {
+        GPP::Vector3 edge1 = v1 - v0;
+        GPP::Vector3 edge2 = v2 - v0;
+        GPP::Vector3 pVec = rayDirection.CrossProduct(edge2);
+        GPP::Real det = edge1 * pVec;
+        if (fabs(det) < 1.0e-20)
+        {
+            return -1;
+        }
+        GPP::Real invDet = 1.0 / det;
+        GPP::Vector3 tVec = rayOrigin - v0;
+        GPP::Real u = (tVec * pVec) * invDet;
+        if (u < 0 || u > 1)
+        {
+            return -1;
+        }
+        GPP::Vector3 qVec = tVec.CrossProduct(edge1);
+        GPP::Real v = (rayDirection * qVec) * invDet;
+        if (v < 0 || u + v > 1)
+        {
+            return -1;
+        }
+        GPP::Real t = (edge2 * qVec) * invDet;
+        return t > 0 ? t : -1;
+    }
+
+    // Real-Time Collision Detection, 5.1.5
+    static GPP::Vector3 ClosestPointOnTriangle(const GPP::Vector3& coord, const GPP::Vector3& a, const GPP::Vector3& b,
+        const GPP::Vector3& c)
+    {
+        GPP::Vector3 ab = b - a;
+        GPP::Vector3 ac = c - a;
+        GPP::Vector3 ap = coord - a;
+        GPP::Real d1 = ab * ap;
+        GPP::Real d2 = ac * ap;
+        if (d1 <= 0 && d2 <= 0)
+        {
+            return a;
+        }
+        GPP::Vector3 bp = coord - b;
+        GPP::Real d3 = ab * bp;
+        GPP::Real d4 = ac * bp;
+        if (d3 >= 0 && d4 <= d3)
+        {
+            return b;
+        }
+        GPP::Real vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            return a + ab * (d1 / (d1 - d3));
+        }
+        GPP::Vector3 cp = coord - c;
+        GPP::Real d5 = ab * cp;
+        GPP::Real d6 = ac * cp;
+        if (d6 >= 0 && d5 <= d6)
+        {
+            return c;
+        }
+        GPP::Real vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            return a + ac * (d2 / (d2 - d6));
+        }
+        GPP::Real va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        GPP::Real denom = 1.0 / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    class CentroidLess
+    {
+    public:
+        CentroidLess(const std::vector<float>* centroids, int axis) :
+            mpCentroids(centroids),
+            mAxis(axis)
+        {
+        }
+
+        bool operator()(GPP::Int leftId, GPP::Int rightId) const
+        {
+            return (*mpCentroids)[leftId * 3 + mAxis] < (*mpCentroids)[rightId * 3 + mAxis];
+        }
+
+    private:
+        const std::vector<float>* mpCentroids;
+        int mAxis;
+    };
+
+    class TriangleCentroidTask : public ParallelTask
+    {
+    public:
+        TriangleCentroidTask(const std::vector<GPP::Vector3>* vertexCoords, const std::vector<GPP::Int>* triangleVertexIds,
+            std::vector<float>* centroids) :
+            mpVertexCoords(vertexCoords),
+            mpTriangleVertexIds(triangleVertexIds),
+            mpCentroids(centroids)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int fid = startId; fid < endId; fid++)
+            {
+                const GPP::Vector3& v0 = (*mpVertexCoords)[(*mpTriangleVertexIds)[fid * 3]];
+                const GPP::Vector3& v1 = (*mpVertexCoords)[(*mpTriangleVertexIds)[fid * 3 + 1]];
+                const GPP::Vector3& v2 = (*mpVertexCoords)[(*mpTriangleVertexIds)[fid * 3 + 2]];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    (*mpCentroids)[fid * 3 + axis] = float((v0[axis] + v1[axis] + v2[axis]) / 3.0);
+                }
+            }
+        }
+
+    private:
+        const std::vector<GPP::Vector3>* mpVertexCoords;
+        const std::vector<GPP::Int>* mpTriangleVertexIds;
+        std::vector<float>* mpCentroids;
+    };
+
+    class LeafRefitTask : public ParallelTask
+    {
+    public:
+        LeafRefitTask(std::vector<BvhNode>* nodes, const std::vector<GPP::Int>* triangleIds, const MeshQueryEngine* engine) :
+            mpNodes(nodes),
+            mpTriangleIds(triangleIds),
+            mpEngine(engine)
+        {
+        }
+
+        virtual void Run(int startId, int endId);
+
+    private:
+        std::vector<BvhNode>* mpNodes;
+        const std::vector<GPP::Int>* mpTriangleIds;
+        const MeshQueryEngine* mpEngine;
+    };
+
+    class NearestQueryTask : public ParallelTask
+    {
+    public:
+        NearestQueryTask(const MeshQueryEngine* engine, const std::vector<GPP::Vector3>* coords, GPP::Real maxDistance,
+            std::vector<GPP::Int>* faceIds, std::vector<GPP::Real>* distances, std::vector<GPP::Vector3>* projectCoords) :
+            mpEngine(engine),
+            mpCoords(coords),
+            mMaxDistance(maxDistance),
+            mpFaceIds(faceIds),
+            mpDistances(distances),
+            mpProjectCoords(projectCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int qid = startId; qid < endId; qid++)
+            {
+                GPP::Real distance = -1;
+                GPP::Vector3 projectCoord;
+                GPP::Int faceId = mpEngine->QueryNearestTriangle((*mpCoords)[qid], mMaxDistance, &distance, &projectCoord);
+                if (mpFaceIds)
+                {
+                    (*mpFaceIds)[qid] = faceId;
+                }
+                if (mpDistances)
+                {
+                    (*mpDistances)[qid] = distance;
+                }
+                if (mpProjectCoords)
+                {
+                    (*mpProjectCoords)[qid] = projectCoord;
+                }
+            }
+        }
+
+    private:
+        const MeshQueryEngine* mpEngine;
+        const std::vector<GPP::Vector3>* mpCoords;
+        GPP::Real mMaxDistance;
+        std::vector<GPP::Int>* mpFaceIds;
+        std::vector<GPP::Real>* mpDistances;
+        std::vector<GPP::Vector3>* mpProjectCoords;
+    };
+
+    class RayQueryTask : public ParallelTask
+    {
+    public:
+        RayQueryTask(const MeshQueryEngine* engine, const std::vector<GPP::Vector3>* rayOrigins,
+            const std::vector<GPP::Vector3>* rayDirections, GPP::Real maxDistance, std::vector<GPP::Int>* faceIds,
+            std::vector<GPP::Real>* distances, std::vector<int>* hitFlags) :
+            mpEngine(engine),
+            mpRayOrigins(rayOrigins),
+            mpRayDirections(rayDirections),
+            mMaxDistance(maxDistance),
+            mpFaceIds(faceIds),
+            mpDistances(distances),
+            mpHitFlags(hitFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int qid = startId; qid < endId; qid++)
+            {
+                if (mpHitFlags)
+                {
+                    (*mpHitFlags)[qid] = mpEngine->RayAnyHit((*mpRayOrigins)[qid], (*mpRayDirections)[qid], mMaxDistance) ? 1 : 0;
+                    continue;
+                }
+                GPP::Real distance = -1;
+                GPP::Int faceId = mpEngine->RayIntersect((*mpRayOrigins)[qid], (*mpRayDirections)[qid], mMaxDistance, &distance);
+                if (mpFaceIds)
+                {
+                    (*mpFaceIds)[qid] = faceId;
+                }
+                if (mpDistances)
+                {
+                    (*mpDistances)[qid] = distance;
+                }
+            }
+        }
+
+    private:
+        const MeshQueryEngine* mpEngine;
+        const std::vector<GPP::Vector3>* mpRayOrigins;
+        const std::vector<GPP::Vector3>* mpRayDirections;
+        GPP::Real mMaxDistance;
+        std::vector<GPP::Int>* mpFaceIds;
+        std::vector<GPP::Real>* mpDistances;
+        std::vector<int>* mpHitFlags;
+    };
+
+    class ThicknessTask : public ParallelTask
+    {
+    public:
+        ThicknessTask(const MeshQueryEngine* engine, const std::vector<GPP::Vector3>* coords, const std::vector<GPP::Vector3>* normals,
+            GPP::Real coneAngle, int rayCount, GPP::Real originOffset, std::vector<GPP::Real>* thickness) :
+            mpEngine(engine),
+            mpCoords(coords),
+            mpNormals(normals),
+            mConeAngle(coneAngle),
+            mRayCount(rayCount),
+            mOriginOffset(originOffset),
+            mpThickness(thickness)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            std::vector<GPP::Vector3> rayDirs(mRayCount);
+            std::vector<GPP::Real> rayDistances(mRayCount);
+            std::vector<GPP::Real> hitDistances;
+            hitDistances.reserve(mRayCount);
+            GPP::Real sinCone = sin(mConeAngle / 2.0);
+            GPP::Real cosCone = cos(mConeAngle / 2.0);
+            for (int vid = startId; vid < endId; vid++)
+            {
+                GPP::Vector3 centerDir = (*mpNormals)[vid] * -1.0;
+                if (centerDir.Normalise() < GPP::REAL_TOL)
+                {
+                    (*mpThickness)[vid] = 0;
+                    continue;
+                }
+                GPP::Vector3 axisU = fabs(centerDir[0]) < 0.9 ? GPP::Vector3(1, 0, 0) : GPP::Vector3(0, 1, 0);
+                axisU = centerDir.CrossProduct(axisU);
+                axisU.Normalise();
+                GPP::Vector3 axisV = centerDir.CrossProduct(axisU);
+                GPP::Vector3 rayOrigin = (*mpCoords)[vid] + centerDir * mOriginOffset;
+                for (int rid = 0; rid < mRayCount; rid++)
+                {
+                    rayDirs[rid] = centerDir;
+                    if (rid > 0)
+                    {
+                        GPP::Real phi = 2.0 * 3.14159265358979 * (rid - 1) / (mRayCount - 1);
+                        rayDirs[rid] = centerDir * cosCone + (axisU * cos(phi) + axisV * sin(phi)) * sinCone;
+                    }
+                }
+                mpEngine->RayIntersectPacket(rayOrigin, &rayDirs[0], mRayCount, FLT_MAX, &rayDistances[0]);
+                hitDistances.clear();
+                for (int rid = 0; rid < mRayCount; rid++)
+                {
+                    if (rayDistances[rid] >= 0)
+                    {
+                        hitDistances.push_back(rayDistances[rid] + mOriginOffset);
+                    }
+                }
+                if (hitDistances.empty())
+                {
+                    (*mpThickness)[vid] = 0;
+                    continue;
+                }
+                std::nth_element(hitDistances.begin(), hitDistances.begin() + hitDistances.size() / 2, hitDistances.end());
+                (*mpThickness)[vid] = hitDistances.at(hitDistances.size() / 2);
+            }
+        }
+
+    private:
+        const MeshQueryEngine* mpEngine;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<GPP::Vector3>* mpNormals;
+        GPP::Real mConeAngle;
+        int mRayCount;
+        GPP::Real mOriginOffset;
+        std::vector<GPP::Real>* mpThickness;
+    };
+
+    void LeafRefitTask::Run(int startId, int endId)
+    {
+        for (int nid = startId; nid < endId; nid++)
+        {
+            BvhNode& node = (*mpNodes)[nid];
+            if (node.count == 0)
+            {
+                continue;
+            }
+            ResetBox(node.bboxMin, node.bboxMax);
+            for (GPP::Int tid = node.leftOrFirst; tid < node.leftOrFirst + node.count; tid++)
+            {
+                float triMin[3], triMax[3];
+                mpEngine->UpdateTriangleBox((*mpTriangleIds)[tid], triMin, triMax);
+                UnionBox(node.bboxMin, node.bboxMax, triMin, triMax);
+            }
+        }
+    }
+
+    MeshQueryEngine::MeshQueryEngine() :
+        mpTriMesh(NULL),
+        mVertexCount(0),
+        mVertexCoords(),
+        mTriangleVertexIds(),
+        mTriangleIds(),
+        mNodes(),
+        mCoordHash(0),
+        mTopologyHash(0),
+        mGeneration(0)
+    {
+    }
+
+    MeshQueryEngine::~MeshQueryEngine()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode MeshQueryEngine::Init(const GPP::ITriMesh* triMesh, GPP::Int generation)
+    {
+        Clear();
+        if (triMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int faceCount = triMesh->GetTriangleCount();
+        if (faceCount == 0)
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        mpTriMesh = triMesh;
+        mVertexCount = triMesh->GetVertexCount();
+        mVertexCoords.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = triMesh->GetVertexCoord(vid);
+        }
+        mTriangleVertexIds.resize(faceCount * 3);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, &(mTriangleVertexIds[fid * 3]));
+        }
+        ComputeMeshHash(triMesh, mCoordHash, mTopologyHash);
+        mGeneration = generation;
+        BuildNodes();
+        InfoLog << "MeshQueryEngine::Init faceCount=" << faceCount << " nodeCount=" << mNodes.size() << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode MeshQueryEngine::Refit(GPP::Int generation)
+    {
+        if (mpTriMesh == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (mpTriMesh->GetVertexCount() != mVertexCount || mpTriMesh->GetTriangleCount() * 3 != mTriangleVertexIds.size())
+        {
+            return Init(mpTriMesh, generation);
+        }
+        GPP::ULongInt coordHash = 0;
+        GPP::ULongInt topologyHash = 0;
+        ComputeMeshHash(mpTriMesh, coordHash, topologyHash);
+        if (topologyHash != mTopologyHash)
+        {
+            return Init(mpTriMesh, generation);
+        }
+        mGeneration = generation;
+        if (coordHash == mCoordHash)
+        {
+            return GPP_NO_ERROR;
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = mpTriMesh->GetVertexCoord(vid);
+        }
+        RefitNodes();
+        mCoordHash = coordHash;
+        return GPP_NO_ERROR;
+    }
+
+    void MeshQueryEngine::Clear()
+    {
+        mpTriMesh = NULL;
+        mVertexCount = 0;
+        mVertexCoords.clear();
+        mTriangleVertexIds.clear();
+        mTriangleIds.clear();
+        mNodes.clear();
+        mCoordHash = 0;
+        mTopologyHash = 0;
+        mGeneration = 0;
+    }
+
+    const GPP::ITriMesh* MeshQueryEngine::GetMesh() const
+    {
+        return mpTriMesh;
+    }
+
+    GPP::Int MeshQueryEngine::GetGeneration() const
+    {
+        return mGeneration;
+    }
+
+    bool MeshQueryEngine::IsValid(const GPP::ITriMesh* triMesh) const
+    {
+        return triMesh != NULL && triMesh == mpTriMesh && triMesh->GetVertexCount() == mVertexCount &&
+            triMesh->GetTriangleCount() * 3 == mTriangleVertexIds.size();
+    }
+
+    void MeshQueryEngine::ComputeMeshHash(const GPP::ITriMesh* triMesh, GPP::ULongInt& coordHash, GPP::ULongInt& topologyHash)
+    {
+        coordHash = 0;
+        topologyHash = 0;
+        if (triMesh == NULL)
+        {
+            return;
+        }
+        GPP::Int maxCount = triMesh->GetVertexCount() > triMesh->GetTriangleCount() ? triMesh->GetVertexCount() : triMesh->GetTriangleCount();
+        int chunkCount = int((maxCount + gMeshHashChunkSize - 1) / gMeshHashChunkSize);
+        std::vector<GPP::ULongInt> coordHashes(chunkCount);
+        std::vector<GPP::ULongInt> topologyHashes(chunkCount);
+        MeshHashTask hashTask(triMesh, &coordHashes, &topologyHashes);
+        ThreadPool::Get()->ParallelFor(chunkCount, &hashTask, 1);
+        coordHash = HashWord(14695981039346656037ULL, triMesh->GetVertexCount());
+        topologyHash = HashWord(14695981039346656037ULL, triMesh->GetTriangleCount());
+        for (int chunkId = 0; chunkId < chunkCount; chunkId++)
+        {
+            coordHash = HashWord(coordHash, coordHashes[chunkId]);
+            topologyHash = HashWord(topologyHash, topologyHashes[chunkId]);
+        }
+    }
+
+    GPP::Int MeshQueryEngine::QueryNearestTriangle(const GPP::Vector3& coord, GPP::Real maxDistance, GPP::Real* distance,
+        GPP::Vector3* projectCoord) const
+    {
+        if (mNodes.empty())
+        {
+            return -1;
+        }
+        GPP::Real bestDistanceSquared = maxDistance < sqrt(DBL_MAX) ? maxDistance * maxDistance : DBL_MAX;
+        GPP::Int bestFaceId = -1;
+        GPP::Vector3 bestCoord;
+        TraversalStack<GPP::Int> nodeStack;
+        nodeStack.Push(0);
+        while (!nodeStack.IsEmpty())
+        {
+            const BvhNode& node = mNodes[nodeStack.Pop()];
+            if (BoxDistanceSquared(node, coord) >= bestDistanceSquared)
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (GPP::Int tid = node.leftOrFirst; tid < node.leftOrFirst + node.count; tid++)
+                {
+                    GPP::Int fid = mTriangleIds[tid];
+                    GPP::Vector3 closestCoord = ClosestPointOnTriangle(coord, mVertexCoords[mTriangleVertexIds[fid * 3]],
+                        mVertexCoords[mTriangleVertexIds[fid * 3 + 1]], mVertexCoords[mTriangleVertexIds[fid * 3 + 2]]);
+                    GPP::Real distanceSquared = (closestCoord - coord).LengthSquared();
+                    if (distanceSquared < bestDistanceSquared)
+                    {
+                        bestDistanceSquared = distanceSquared;
+                        bestFaceId = fid;
+                        bestCoord = closestCoord;
+                    }
+                }
+                continue;
+            }
+            // Push the far child first so the near child is visited first
+            GPP::Int leftId = node.leftOrFirst;
+            GPP::Real leftDistance = BoxDistanceSquared(mNodes[leftId], coord);
+            GPP::Real rightDistance = BoxDistanceSquared(mNodes[leftId + 1], coord);
+            if (leftDistance < rightDistance)
+            {
+                nodeStack.Push(leftId + 1);
+                nodeStack.Push(leftId);
+            }
+            else
+            {
+                nodeStack.Push(leftId);
+                nodeStack.Push(leftId + 1);
+            }
+        }
+        if (bestFaceId >= 0)
+        {
+            if (distance)
+            {
+                *distance = sqrt(bestDistanceSquared);
+            }
+            if (projectCoord)
+            {
+                *projectCoord = bestCoord;
+            }
+        }
+        return bestFaceId;
+    }
+
+    GPP::Int MeshQueryEngine::RayIntersect(const GPP::Vector3& rayOrigin, const GPP::Vector3& rayDirection, GPP::Real maxDistance,
+        GPP::Real* distance) const
+    {
+        if (mNodes.empty())
+        {
+            return -1;
+        }
+        GPP::Vector3 direction = rayDirection;
+        if (direction.Normalise() < GPP::REAL_TOL)
+        {
+            return -1;
+        }
+        GPP::Real invDirection[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            invDirection[axis] = fabs(direction[axis]) > 1.0e-20 ? 1.0 / direction[axis] : (direction[axis] < 0 ? -1.0e20 : 1.0e20);
+        }
+        GPP::Real bestDistance = maxDistance;
+        GPP::Int bestFaceId = -1;
+        TraversalStack<GPP::Int> nodeStack;
+        nodeStack.Push(0);
+        while (!nodeStack.IsEmpty())
+        {
+            const BvhNode& node = mNodes[nodeStack.Pop()];
+            if (RayBoxEntry(node, rayOrigin, invDirection, bestDistance) < 0)
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (GPP::Int tid = node.leftOrFirst; tid < node.leftOrFirst + node.count; tid++)
+                {
+                    GPP::Int fid = mTriangleIds[tid];
+                    GPP::Real hitDistance = RayTriangle(rayOrigin, direction, mVertexCoords[mTriangleVertexIds[fid * 3]],
+                        mVertexCoords[mTriangleVertexIds[fid * 3 + 1]], mVertexCoords[mTriangleVertexIds[fid * 3 + 2]]);
+                    if (hitDistance >= 0 && hitDistance < bestDistance)
+                    {
+                        bestDistance = hitDistance;
+                        bestFaceId = fid;
+                    }
+                }
+                continue;
+            }
+            GPP::Int leftId = node.leftOrFirst;
+            GPP::Real leftEntry = RayBoxEntry(mNodes[leftId], rayOrigin, invDirection, bestDistance);
+            GPP::Real rightEntry = RayBoxEntry(mNodes[leftId + 1], rayOrigin, invDirection, bestDistance);
+            if (leftEntry >= 0 && rightEntry >= 0)
+            {
+                if (leftEntry < rightEntry)
+                {
+                    nodeStack.Push(leftId + 1);
+                    nodeStack.Push(leftId);
+                }
+                else
+                {
+                    nodeStack.Push(leftId);
+                    nodeStack.Push(leftId + 1);
+                }
+            }
+            else if (leftEntry >= 0)
+            {
+                nodeStack.Push(leftId);
+            }
+            else if (rightEntry >= 0)
+            {
+                nodeStack.Push(leftId + 1);
+            }
+        }
+        if (bestFaceId >= 0 && distance)
+        {
+            *distance = bestDistance;
+        }
+        return bestFaceId;
+    }
+
+    bool MeshQueryEngine::RayAnyHit(const GPP::Vector3& rayOrigin, const GPP::Vector3& rayDirection, GPP::Real maxDistance) const
+    {
+        if (mNodes.empty())
+        {
+            return false;
+        }
+        GPP::Vector3 direction = rayDirection;
+        if (direction.Normalise() < GPP::REAL_TOL)
+        {
+            return false;
+        }
+        GPP::Real invDirection[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            invDirection[axis] = fabs(direction[axis]) > 1.0e-20 ? 1.0 / direction[axis] : (direction[axis] < 0 ? -1.0e20 : 1.0e20);
+        }
+        TraversalStack<GPP::Int> nodeStack;
+        nodeStack.Push(0);
+        while (!nodeStack.IsEmpty())
+        {
+            const BvhNode& node = mNodes[nodeStack.Pop()];
+            if (RayBoxEntry(node, rayOrigin, invDirection, maxDistance) < 0)
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (GPP::Int tid = node.leftOrFirst; tid < node.leftOrFirst + node.count; tid++)
+                {
+                    GPP::Int fid = mTriangleIds[tid];
+                    GPP::Real hitDistance = RayTriangle(rayOrigin, direction, mVertexCoords[mTriangleVertexIds[fid * 3]],
+                        mVertexCoords[mTriangleVertexIds[fid * 3 + 1]], mVertexCoords[mTriangleVertexIds[fid * 3 + 2]]);
+                    if (hitDistance >= 0 && hitDistance < maxDistance)
+                    {
+                        return true;
+                    }
+                }
+                continue;
+            }
+            nodeStack.Push(node.leftOrFirst + 1);
+            nodeStack.Push(node.leftOrFirst);
+        }
+        return false;
+    }
+
+    void MeshQueryEngine::RayIntersectPacket(const GPP::Vector3& rayOrigin, const GPP::Vector3* rayDirections, int rayCount,
+        GPP::Real maxDistance, GPP::Real* distances) const
+    {
+        for (int rid = 0; rid < rayCount; rid++)
+        {
+            distances[rid] = -1;
+        }
+        if (mNodes.empty())
+        {
+            return;
+        }
+        GPP::Vector3 directions[gRayPacketSize];
+        GPP::Real invDirections[gRayPacketSize][3];
+        GPP::Real bestDistances[gRayPacketSize];
+        TraversalStack<PacketStackItem> nodeStack;
+        for (int packetStart = 0; packetStart < rayCount; packetStart += gRayPacketSize)
+        {
+            int packetSize = rayCount - packetStart < gRayPacketSize ? rayCount - packetStart : gRayPacketSize;
+            unsigned int packetMask = 0;
+            unsigned int hitMask = 0;
+            GPP::Vector3 meanDirection(0, 0, 0);
+            for (int rid = 0; rid < packetSize; rid++)
+            {
+                directions[rid] = rayDirections[packetStart + rid];
+                if (directions[rid].Normalise() < GPP::REAL_TOL)
+                {
+                    continue;
+                }
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    GPP::Real component = directions[rid][axis];
+                    invDirections[rid][axis] = fabs(component) > 1.0e-20 ? 1.0 / component : (component < 0 ? -1.0e20 : 1.0e20);
+                }
+                bestDistances[rid] = maxDistance;
+                packetMask |= (1u << rid);
+                meanDirection += directions[rid];
+            }
+            PacketStackItem stackItem;
+            stackItem.nodeId = 0;
+            stackItem.rayMask = packetMask;
+            nodeStack.Push(stackItem);
+            while (!nodeStack.IsEmpty())
+            {
+                stackItem = nodeStack.Pop();
+                const BvhNode& node = mNodes[stackItem.nodeId];
+                unsigned int parentMask = stackItem.rayMask;
+                // The slabs relative to the shared origin are computed once for the packet.
+                // Rays which missed the parent, or found a closer hit since the node is pushed, are not tested.
+                GPP::Real lowDelta[3], highDelta[3];
+                bool isOriginInside = true;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    lowDelta[axis] = node.bboxMin[axis] - rayOrigin[axis];
+                    highDelta[axis] = node.bboxMax[axis] - rayOrigin[axis];
+                    isOriginInside = isOriginInside && lowDelta[axis] <= 0 && highDelta[axis] >= 0;
+                }
+                unsigned int nodeMask = isOriginInside ? parentMask : 0;
+                for (int rid = 0; rid < packetSize && !isOriginInside; rid++)
+                {
+                    if ((parentMask & (1u << rid)) == 0)
+                    {
+                        continue;
+                    }
+                    GPP::Real tNear = 0;
+                    GPP::Real tFar = bestDistances[rid];
+                    for (int axis = 0; axis < 3 && tNear <= tFar; axis++)
+                    {
+                        GPP::Real t0 = lowDelta[axis] * invDirections[rid][axis];
+                        GPP::Real t1 = highDelta[axis] * invDirections[rid][axis];
+                        if (t0 > t1)
+                        {
+                            std::swap(t0, t1);
+                        }
+                        tNear = t0 > tNear ? t0 : tNear;
+                        tFar = t1 < tFar ? t1 : tFar;
+                    }
+                    if (tNear <= tFar)
+                    {
+                        nodeMask |= (1u << rid);
+                    }
+                }
+                if (nodeMask == 0)
+                {
+                    continue;
+                }
+                if (node.count > 0)
+                {
+                    // Moller-Trumbore with the origin terms shared by the packet
+                    for (GPP::Int tid = node.leftOrFirst; tid < node.leftOrFirst + node.count; tid++)
+                    {
+                        GPP::Int fid = mTriangleIds[tid];
+                        const GPP::Vector3& v0 = mVertexCoords[mTriangleVertexIds[fid * 3]];
+                        GPP::Vector3 edge1 = mVertexCoords[mTriangleVertexIds[fid * 3 + 1]] - v0;
+                        GPP::Vector3 edge2 = mVertexCoords[mTriangleVertexIds[fid * 3 + 2]] - v0;
+                        GPP::Vector3 tVec = rayOrigin - v0;
+                        GPP::Vector3 qVec = tVec.CrossProduct(edge1);
+                        GPP::Real tNumerator = edge2 * qVec;
+                        for (int rid = 0; rid < packetSize; rid++)
+                        {
+                            if ((nodeMask & (1u << rid)) == 0)
+                            {
+                                continue;
+                            }
+                            GPP::Vector3 pVec = directions[rid].CrossProduct(edge2);
+                            GPP::Real det = edge1 * pVec;
+                            if (fabs(det) < 1.0e-20)
+                            {
+                                continue;
+                            }
+                            GPP::Real invDet = 1.0 / det;
+                            GPP::Real u = (tVec * pVec) * invDet;
+                            if (u < 0 || u > 1)
+                            {
+                                continue;
+                            }
+                            GPP::Real v = (directions[rid] * qVec) * invDet;
+                            if (v < 0 || u + v > 1)
+                            {
+                                continue;
+                            }
+                            GPP::Real hitDistance = tNumerator * invDet;
+                            if (hitDistance > 0 && hitDistance < bestDistances[rid])
+                            {
+                                bestDistances[rid] = hitDistance;
+                                hitMask |= (1u << rid);
+                            }
+                        }
+                    }
+                    continue;
+                }
+                // The child in front along the mean packet direction is visited first
+                GPP::Int leftId = node.leftOrFirst;
+                const BvhNode& leftNode = mNodes[leftId];
+                const BvhNode& rightNode = mNodes[leftId + 1];
+                GPP::Real centerDelta = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    centerDelta += (GPP::Real(rightNode.bboxMin[axis]) + rightNode.bboxMax[axis] - leftNode.bboxMin[axis] -
+                        leftNode.bboxMax[axis]) * meanDirection[axis];
+                }
+                bool isLeftNear = centerDelta >= 0;
+                stackItem.rayMask = nodeMask;
+                stackItem.nodeId = isLeftNear ? leftId + 1 : leftId;
+                nodeStack.Push(stackItem);
+                stackItem.nodeId = isLeftNear ? leftId : leftId + 1;
+                nodeStack.Push(stackItem);
+            }
+            for (int rid = 0; rid < packetSize; rid++)
+            {
+                if (hitMask & (1u << rid))
+                {
+                    distances[packetStart + rid] = bestDistances[rid];
+                }
+            }
+        }
+    }
+
+    void MeshQueryEngine::QueryNearestTriangles(const std::vector<GPP::Vector3>& coords, GPP::Real maxDistance,
+        std::vector<GPP::Int>* faceIds, std::vector<GPP::Real>* distances, std::vector<GPP::Vector3>* projectCoords) const
+    {
+        int queryCount = coords.size();
+        if (faceIds)
+        {
+            faceIds->resize(queryCount);
+        }
+        if (distances)
+        {
+            distances->resize(queryCount);
+        }
+        if (projectCoords)
+        {
+            projectCoords->resize(queryCount);
+        }
+        NearestQueryTask queryTask(this, &coords, maxDistance, faceIds, distances, projectCoords);
+        ThreadPool::Get()->ParallelFor(queryCount, &queryTask, 256);
+    }
+
+    void MeshQueryEngine::RayIntersections(const std::vector<GPP::Vector3>& rayOrigins, const std::vector<GPP::Vector3>& rayDirections,
+        GPP::Real maxDistance, std::vector<GPP::Int>* faceIds, std::vector<GPP::Real>* distances) const
+    {
+        int queryCount = rayOrigins.size() < rayDirections.size() ? rayOrigins.size() : rayDirections.size();
+        if (faceIds)
+        {
+            faceIds->resize(queryCount);
+        }
+        if (distances)
+        {
+            distances->resize(queryCount);
+        }
+        RayQueryTask queryTask(this, &rayOrigins, &rayDirections, maxDistance, faceIds, distances, NULL);
+        ThreadPool::Get()->ParallelFor(queryCount, &queryTask, 256);
+    }
+
+    void MeshQueryEngine::RayAnyHits(const std::vector<GPP::Vector3>& rayOrigins, const std::vector<GPP::Vector3>& rayDirections,
+        GPP::Real maxDistance, std::vector<int>* hitFlags) const
+    {
+        if (hitFlags == NULL)
+        {
+            return;
+        }
+        int queryCount = rayOrigins.size() < rayDirections.size() ? rayOrigins.size() : rayDirections.size();
+        hitFlags->resize(queryCount);
+        RayQueryTask queryTask(this, &rayOrigins, &rayDirections, maxDistance, NULL, NULL, hitFlags);
+        ThreadPool::Get()->ParallelFor(queryCount, &queryTask, 256);
+    }
+
+    void MeshQueryEngine::ComputeThickness(const std::vector<GPP::Vector3>& coords, const std::vector<GPP::Vector3>& normals,
+        GPP::Real coneAngle, int rayCount, std::vector<GPP::Real>& thickness) const
+    {
+        int queryCount = coords.size() < normals.size() ? coords.size() : normals.size();
+        thickness.clear();
+        thickness.resize(queryCount, 0);
+        if (mNodes.empty())
+        {
+            return;
+        }
+        if (rayCount < 1)
+        {
+            rayCount = 1;
+        }
+        // Rays start slightly inside, so they do not hit the triangles around the query point
+        const BvhNode& root = mNodes.at(0);
+        GPP::Vector3 diagonal(root.bboxMax[0] - root.bboxMin[0], root.bboxMax[1] - root.bboxMin[1], root.bboxMax[2] - root.bboxMin[2]);
+        GPP::Real originOffset = diagonal.Length() * 1.0e-6;
+        ThicknessTask thicknessTask(this, &coords, &normals, coneAngle, rayCount, originOffset, &thickness);
+        ThreadPool::Get()->ParallelFor(queryCount, &thicknessTask, 64);
+    }
+
+    void MeshQueryEngine::BuildNodes()
+    {
+        GPP::Int faceCount = mTriangleVertexIds.size() / 3;
+        std::vector<float> centroids(faceCount * 3);
+        TriangleCentroidTask centroidTask(&mVertexCoords, &mTriangleVertexIds, &centroids);
+        ThreadPool::Get()->ParallelFor(faceCount, &centroidTask, 4096);
+        mTriangleIds.resize(faceCount);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            mTriangleIds[fid] = fid;
+        }
+        mNodes.clear();
+        mNodes.reserve(faceCount / gBvhLeafSize * 2 + 1);
+        BvhNode rootNode;
+        rootNode.leftOrFirst = 0;
+        rootNode.count = faceCount;
+        mNodes.push_back(rootNode);
+
+        // Binned SAH build, nodes are split in depth first order so children are always after their parent
+        std::vector<GPP::Int> splitStack;
+        splitStack.push_back(0);
+        while (!splitStack.empty())
+        {
+            GPP::Int nodeId = splitStack.back();
+            splitStack.pop_back();
+            GPP::Int first = mNodes[nodeId].leftOrFirst;
+            GPP::Int count = mNodes[nodeId].count;
+            float bboxMin[3], bboxMax[3], centroidMin[3], centroidMax[3];
+            ResetBox(bboxMin, bboxMax);
+            ResetBox(centroidMin, centroidMax);
+            for (GPP::Int tid = first; tid < first + count; tid++)
+            {
+                float triMin[3], triMax[3];
+                UpdateTriangleBox(mTriangleIds[tid], triMin, triMax);
+                UnionBox(bboxMin, bboxMax, triMin, triMax);
+                const float* centroid = &(centroids[mTriangleIds[tid] * 3]);
+                UnionBox(centroidMin, centroidMax, centroid, centroid);
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                mNodes[nodeId].bboxMin[axis] = bboxMin[axis];
+                mNodes[nodeId].bboxMax[axis] = bboxMax[axis];
+            }
+            if (count <= gBvhLeafSize)
+            {
+                continue;
+            }
+            int splitAxis = 0;
+            for (int axis = 1; axis < 3; axis++)
+            {
+                if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis])
+                {
+                    splitAxis = axis;
+                }
+            }
+            float extent = centroidMax[splitAxis] - centroidMin[splitAxis];
+            GPP::Int splitCount = 0;
+            if (extent > FLT_EPSILON * (fabs(centroidMax[splitAxis]) + fabs(centroidMin[splitAxis]) + FLT_MIN))
+            {
+                GPP::Int binCounts[gBvhBinCount];
+                float binMin[gBvhBinCount][3], binMax[gBvhBinCount][3];
+                for (int bid = 0; bid < gBvhBinCount; bid++)
+                {
+                    binCounts[bid] = 0;
+                    ResetBox(binMin[bid], binMax[bid]);
+                }
+                float binScale = gBvhBinCount / extent * 0.99999f;
+                for (GPP::Int tid = first; tid < first + count; tid++)
+                {
+                    int bid = int((centroids[mTriangleIds[tid] * 3 + splitAxis] - centroidMin[splitAxis]) * binScale);
+                    bid = bid < 0 ? 0 : (bid >= gBvhBinCount ? gBvhBinCount - 1 : bid);
+                    float triMin[3], triMax[3];
+                    UpdateTriangleBox(mTriangleIds[tid], triMin, triMax);
+                    binCounts[bid]++;
+                    UnionBox(binMin[bid], binMax[bid], triMin, triMax);
+                }
+                // Sweep from the right to get the suffix areas, then from the left to evaluate every split
+                float rightAreas[gBvhBinCount];
+                GPP::Int rightCounts[gBvhBinCount];
+                float sweepMin[3], sweepMax[3];
+                ResetBox(sweepMin, sweepMax);
+                GPP::Int sweepCount = 0;
+                for (int bid = gBvhBinCount - 1; bid > 0; bid--)
+                {
+                    UnionBox(sweepMin, sweepMax, binMin[bid], binMax[bid]);
+                    sweepCount += binCounts[bid];
+                    rightAreas[bid] = BoxArea(sweepMin, sweepMax);
+                    rightCounts[bid] = sweepCount;
+                }
+                ResetBox(sweepMin, sweepMax);
+                sweepCount = 0;
+                float bestCost = FLT_MAX;
+                int bestBin = -1;
+                for (int bid = 0; bid < gBvhBinCount - 1; bid++)
+                {
+                    UnionBox(sweepMin, sweepMax, binMin[bid], binMax[bid]);
+                    sweepCount += binCounts[bid];
+                    if (sweepCount == 0 || rightCounts[bid + 1] == 0)
+                    {
+                        continue;
+                    }
+                    float cost = BoxArea(sweepMin, sweepMax) * sweepCount + rightAreas[bid + 1] * rightCounts[bid + 1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestBin = bid;
+                    }
+                }
+                float leafCost = BoxArea(bboxMin, bboxMax) * count;
+                if (bestCost >= leafCost && count <= gBvhMaxLeafSize)
+                {
+                    continue;
+                }
+                if (bestBin >= 0)
+                {
+                    GPP::Int* begin = &(mTriangleIds[first]);
+                    GPP::Int* end = begin + count;
+                    GPP::Int* middle = begin;
+                    for (GPP::Int* itr = begin; itr != end; ++itr)
+                    {
+                        int bid = int((centroids[*itr * 3 + splitAxis] - centroidMin[splitAxis]) * binScale);
+                        if (bid <= bestBin)
+                        {
+                            std::swap(*itr, *middle);
+                            ++middle;
+                        }
+                    }
+                    splitCount = GPP::Int(middle - begin);
+                }
+            }
+            if (splitCount <= 0 || splitCount >= count)
+            {
+                // Degenerated distribution: split by median so the tree depth is bounded
+                splitCount = count / 2;
+                CentroidLess centroidLess(&centroids, splitAxis);
+                std::nth_element(mTriangleIds.begin() + first, mTriangleIds.begin() + first + splitCount,
+                    mTriangleIds.begin() + first + count, centroidLess);
+            }
+            GPP::Int leftId = mNodes.size();
+            BvhNode childNode;
+            childNode.leftOrFirst = first;
+            childNode.count = splitCount;
+            mNodes.push_back(childNode);
+            childNode.leftOrFirst = first + splitCount;
+            childNode.count = count - splitCount;
+            mNodes.push_back(childNode);
+            mNodes[nodeId].leftOrFirst = leftId;
+            mNodes[nodeId].count = 0;
+            splitStack.push_back(leftId + 1);
+            splitStack.push_back(leftId);
+        }
+    }
+
+    void MeshQueryEngine::RefitNodes()
+    {
+        LeafRefitTask leafTask(&mNodes, &mTriangleIds, this);
+        ThreadPool::Get()->ParallelFor(mNodes.size(), &leafTask, 1024);
+        for (GPP::Int nid = GPP::Int(mNodes.size()) - 1; nid >= 0; nid--)
+        {
+            BvhNode& node = mNodes[nid];
+            if (node.count > 0)
+            {
+                continue;
+            }
+            const BvhNode& leftNode = mNodes[node.leftOrFirst];
+            const BvhNode& rightNode = mNodes[node.leftOrFirst + 1];
+            ResetBox(node.bboxMin, node.bboxMax);
+            UnionBox(node.bboxMin, node.bboxMax, leftNode.bboxMin, leftNode.bboxMax);
+            UnionBox(node.bboxMin, node.bboxMax, rightNode.bboxMin, rightNode.bboxMax);
+        }
+    }
+
+    void MeshQueryEngine::UpdateTriangleBox(GPP::Int fid, float bboxMin[3], float bboxMax[3]) const
+    {
+        const GPP::Vector3& v0 = mVertexCoords[mTriangleVertexIds[fid * 3]];
+        const GPP::Vector3& v1 = mVertexCoords[mTriangleVertexIds[fid * 3 + 1]];
+        const GPP::Vector3& v2 = mVertexCoords[mTriangleVertexIds[fid * 3 + 2]];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GPP::Real minValue = v0[axis] < v1[axis] ? v0[axis] : v1[axis];
+            minValue = v2[axis] < minValue ? v2[axis] : minValue;
+            GPP::Real maxValue = v0[axis] > v1[axis] ? v0[axis] : v1[axis];
+            maxValue = v2[axis] > maxValue ? v2[axis] : maxValue;
+            bboxMin[axis] = FloorFloat(minValue);
+            bboxMax[axis] = CeilFloat(maxValue);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "ITriMesh.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // count > 0: leaf whose triangles are mTriangleIds[leftOrFirst, leftOrFirst + count)
+    // count == 0: children are leftOrFirst and leftOrFirst + 1
+    struct BvhNode
+    {
+        float bboxMin[3];
+        float bboxMax[3];
+        GPP::Int leftOrFirst;
+        GPP::Int count;
+    };
+
+    // Persistent bounding volume hierarchy over the triangles of a mesh.
+    // It is built once and refitted when vertices move, so repeated queries do not pay for construction.
+    // Single queries are thread safe; batched queries run on ThreadPool.
+    class MeshQueryEngine
+    {
+    public:
+        MeshQueryEngine();
+        ~MeshQueryEngine();
+
+        // generation is the edit generation of triMesh kept by the owner, see ModelManager
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, GPP::Int generation = 0);
+        // Vertex coordinates are changed but topology is not: bounding boxes are updated without rebuilding.
+        // Nothing is done if the mesh is unchanged, and it is rebuilt if the topology is changed.
+        // Coordinates and triangles are hashed to tell them apart, so call it once per edit, not per query.
+        GPP::ErrorCode Refit(GPP::Int generation);
+        void Clear(void);
+
+        const GPP::ITriMesh* GetMesh(void) const;
+        GPP::Int GetGeneration(void) const;
+        // Whether the engine is built on triMesh and its vertex and triangle counts are unchanged.
+        // Edits which keep the counts are only seen through the generation.
+        bool IsValid(const GPP::ITriMesh* triMesh) const;
+        // Hash of vertex coordinates and hash of triangle vertex ids
+        static void ComputeMeshHash(const GPP::ITriMesh* triMesh, GPP::ULongInt& coordHash, GPP::ULongInt& topologyHash);
+
+        // Return face id, -1 if there is no triangle within maxDistance
+        GPP::Int QueryNearestTriangle(const GPP::Vector3& coord, GPP::Real maxDistance, GPP::Real* distance = NULL,
+            GPP::Vector3* projectCoord = NULL) const;
+        // Return the first hit face id along the ray, -1 if there is no hit within maxDistance
+        GPP::Int RayIntersect(const GPP::Vector3& rayOrigin, const GPP::Vector3& rayDirection, GPP::Real maxDistance,
+            GPP::Real* distance = NULL) const;
+        // Whether the ray hits any triangle within maxDistance, it stops at the first hit found
+        bool RayAnyHit(const GPP::Vector3& rayOrigin, const GPP::Vector3& rayDirection, GPP::Real maxDistance) const;
+        // Rays share the origin, so each packet of up to 32 rays traverses the hierarchy once: nodes are visited near to
+        // far and skipped when all rays of the packet miss them. distances[i] is -1 if ray i has no hit within maxDistance.
+        void RayIntersectPacket(const GPP::Vector3& rayOrigin, const GPP::Vector3* rayDirections, int rayCount,
+            GPP::Real maxDistance, GPP::Real* distances) const;
+
+        // Batched queries are parallelized over query points. Output vectors could be NULL.
+        void QueryNearestTriangles(const std::vector<GPP::Vector3>& coords, GPP::Real maxDistance, std::vector<GPP::Int>* faceIds,
+            std::vector<GPP::Real>* distances, std::vector<GPP::Vector3>* projectCoords) const;
+        void RayIntersections(const std::vector<GPP::Vector3>& rayOrigins, const std::vector<GPP::Vector3>& rayDirections,
+            GPP::Real maxDistance, std::vector<GPP::Int>* faceIds, std::vector<GPP::Real>* distances) const;
+        // hitFlags: 1 if hit, 0 if not
+        void RayAnyHits(const std::vector<GPP::Vector3>& rayOrigins, const std::vector<GPP::Vector3>& rayDirections,
+            GPP::Real maxDistance, std::vector<int>* hitFlags) const;
+
+        // Shape diameter: rays are cast inside a cone around the inverse normal, the median hit distance is the thickness.
+        // Thickness is 0 if no ray hits.
+        void ComputeThickness(const std::vector<GPP::Vector3>& coords, const std::vector<GPP::Vector3>& normals,
+            GPP::Real coneAngle, int rayCount, std::vector<GPP::Real>& thickness) const;
+
+    private:
+        friend class LeafRefitTask;
+        void BuildNodes(void);
+        void RefitNodes(void);
+        void UpdateTriangleBox(GPP::Int fid, float bboxMin[3], float bboxMax[3]) const;
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mVertexCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Int> mTriangleIds;
+        std::vector<BvhNode> mNodes;
+        GPP::ULongInt mCoordHash;
+        GPP::ULongInt mTopologyHash;
+        GPP::Int mGeneration;
+    };
+}
@@ -0,0 +1,635 @@
+#include "MeshSlicer.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+namespace MagicCore
+{
+    // Triangles are bucketed by blocks of this size in parallel
+    static const GPP::Int gSliceTriangleBlockSize = 65536;
+    // Planes which are sliced together, it bounds the memory of SliceToFile
+    static const GPP::Int gSliceBatchSize = 64;
+
+    struct SliceSegment
+    {
+        // Mesh edges of the segment ends, the segment goes from the edge where the triangle enters the upper side
+        GPP::ULongInt startKey;
+        GPP::ULongInt endKey;
+        GPP::Vector3 startCoord;
+        GPP::Vector3 endCoord;
+    };
+
+    struct SegmentKey
+    {
+        GPP::ULongInt key;
+        GPP::Int segmentId;
+
+        bool operator < (const SegmentKey& other) const
+        {
+            return key < other.key || (key == other.key && segmentId < other.segmentId);
+        }
+    };
+
+    class SliceCountTask : public ParallelTask
+    {
+    public:
+        SliceCountTask(MeshSlicer* slicer, const GPP::Real* batchHeights, GPP::Int batchCount, GPP::Int triangleStart,
+            GPP::Int triangleEnd) :
+            mpSlicer(slicer),
+            mpBatchHeights(batchHeights),
+            mBatchCount(batchCount),
+            mTriangleStart(triangleStart),
+            mTriangleEnd(triangleEnd)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                GPP::Int* counts = &(mpSlicer->mBlockCounts[blockId * mBatchCount]);
+                GPP::Int blockEnd = std::min(mTriangleStart + (blockId + 1) * gSliceTriangleBlockSize, mTriangleEnd);
+                for (GPP::Int sortedFid = mTriangleStart + blockId * gSliceTriangleBlockSize; sortedFid < blockEnd; sortedFid++)
+                {
+                    GPP::Int firstId, lastId;
+                    mpSlicer->GetCrossedPlanes(sortedFid, mpBatchHeights, mBatchCount, firstId, lastId);
+                    for (GPP::Int pid = firstId; pid < lastId; pid++)
+                    {
+                        counts[pid]++;
+                    }
+                }
+            }
+        }
+
+    private:
+        MeshSlicer* mpSlicer;
+        const GPP::Real* mpBatchHeights;
+        GPP::Int mBatchCount;
+        GPP::Int mTriangleStart;
+        GPP::Int mTriangleEnd;
+    };
+
+    class SliceFillTask : public ParallelTask
+    {
+    public:
+        SliceFillTask(MeshSlicer* slicer, const GPP::Real* batchHeights, GPP::Int batchCount, GPP::Int triangleStart,
+            GPP::Int triangleEnd) :
+            mpSlicer(slicer),
+            mpBatchHeights(batchHeights),
+            mBatchCount(batchCount),
+            mTriangleStart(triangleStart),
+            mTriangleEnd(triangleEnd)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int blockId = startId; blockId < endId; blockId++)
+            {
+                // Write positions of this block in every bucket
+                GPP::Int* offsets = &(mpSlicer->mBlockCounts[blockId * mBatchCount]);
+                GPP::Int blockEnd = std::min(mTriangleStart + (blockId + 1) * gSliceTriangleBlockSize, mTriangleEnd);
+                for (GPP::Int sortedFid = mTriangleStart + blockId * gSliceTriangleBlockSize; sortedFid < blockEnd; sortedFid++)
+                {
+                    GPP::Int firstId, lastId;
+                    mpSlicer->GetCrossedPlanes(sortedFid, mpBatchHeights, mBatchCount, firstId, lastId);
+                    for (GPP::Int pid = firstId; pid < lastId; pid++)
+                    {
+                        mpSlicer->mBucketFids[offsets[pid]] = sortedFid;
+                        offsets[pid]++;
+                    }
+                }
+            }
+        }
+
+    private:
+        MeshSlicer* mpSlicer;
+        const GPP::Real* mpBatchHeights;
+        GPP::Int mBatchCount;
+        GPP::Int mTriangleStart;
+        GPP::Int mTriangleEnd;
+    };
+
+    class SlicePlaneTask : public ParallelTask
+    {
+    public:
+        SlicePlaneTask(const MeshSlicer* slicer, const GPP::Real* batchHeights, std::vector<SlicePolyline>* batchPolylines,
+            SliceStatistics* batchStatistics) :
+            mpSlicer(slicer),
+            mpBatchHeights(batchHeights),
+            mpBatchPolylines(batchPolylines),
+            mpBatchStatistics(batchStatistics)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Int bucketStart = mpSlicer->mBucketStarts[pid];
+                GPP::Int bucketSize = mpSlicer->mBucketStarts[pid + 1] - bucketStart;
+                mpSlicer->SlicePlane(mpBatchHeights[pid], bucketSize > 0 ? &(mpSlicer->mBucketFids[bucketStart]) : NULL,
+                    bucketSize, mpBatchPolylines[pid], mpBatchStatistics[pid]);
+            }
+        }
+
+    private:
+        const MeshSlicer* mpSlicer;
+        const GPP::Real* mpBatchHeights;
+        std::vector<SlicePolyline>* mpBatchPolylines;
+        SliceStatistics* mpBatchStatistics;
+    };
+
+    class TriangleMinHeightLess
+    {
+    public:
+        explicit TriangleMinHeightLess(const std::vector<GPP::Real>* minHeights) :
+            mpMinHeights(minHeights)
+        {
+        }
+
+        bool operator () (GPP::Int fid0, GPP::Int fid1) const
+        {
+            return (*mpMinHeights)[fid0] < (*mpMinHeights)[fid1] || ((*mpMinHeights)[fid0] == (*mpMinHeights)[fid1] && fid0 < fid1);
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpMinHeights;
+    };
+
+    class HeightIdLess
+    {
+    public:
+        explicit HeightIdLess(const std::vector<GPP::Real>* heights) :
+            mpHeights(heights)
+        {
+        }
+
+        bool operator () (GPP::Int id0, GPP::Int id1) const
+        {
+            return (*mpHeights)[id0] < (*mpHeights)[id1] || ((*mpHeights)[id0] == (*mpHeights)[id1] && id0 < id1);
+        }
+
+    private:
+        const std::vector<GPP::Real>* mpHeights;
+    };
+
+    static bool IsSameCoord(const GPP::Vector3& coord0, const GPP::Vector3& coord1)
+    {
+        return coord0[0] == coord1[0] && coord0[1] == coord1[1] && coord0[2] == coord1[2];
+    }
+
+    MeshSlicer::MeshSlicer() :
+        mSweepDirection(0, 0, 1),
+        mVertexCount(0),
+        mVertexCoords(),
+        mVertexHeights(),
+        mTriangleVertexIds(),
+        mMinHeights(),
+        mMaxHeights(),
+        mMaxTriangleExtent(0),
+        mBucketStarts(),
+        mBucketFids(),
+        mBlockCounts()
+    {
+    }
+
+    MeshSlicer::~MeshSlicer()
+    {
+    }
+
+    GPP::ErrorCode MeshSlicer::Init(const GPP::ITriMesh* triMesh, const GPP::Vector3& sweepDirection)
+    {
+        Clear();
+        if (triMesh == NULL || triMesh->GetVertexCount() < 3 || triMesh->GetTriangleCount() < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mSweepDirection = sweepDirection;
+        if (mSweepDirection.Normalise() < GPP::REAL_TOL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        mVertexCount = triMesh->GetVertexCount();
+        mVertexCoords.resize(mVertexCount);
+        mVertexHeights.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = triMesh->GetVertexCoord(vid);
+            mVertexHeights[vid] = mVertexCoords[vid] * mSweepDirection;
+        }
+        GPP::Int faceCount = triMesh->GetTriangleCount();
+        std::vector<GPP::Int> triangleVertexIds(faceCount * 3);
+        std::vector<GPP::Real> minHeights(faceCount);
+        GPP::Int vertexIds[3] = {-1, -1, -1};
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            triMesh->GetTriangleVertexIds(fid, vertexIds);
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                if (vertexIds[fvid] < 0 || vertexIds[fvid] >= mVertexCount)
+                {
+                    Clear();
+                    return GPP_INVALID_INPUT;
+                }
+                triangleVertexIds[fid * 3 + fvid] = vertexIds[fvid];
+            }
+            minHeights[fid] = std::min(mVertexHeights[vertexIds[0]], std::min(mVertexHeights[vertexIds[1]], mVertexHeights[vertexIds[2]]));
+        }
+        std::vector<GPP::Int> sortedFids(faceCount);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            sortedFids[fid] = fid;
+        }
+        std::sort(sortedFids.begin(), sortedFids.end(), TriangleMinHeightLess(&minHeights));
+        mTriangleVertexIds.resize(faceCount * 3);
+        mMinHeights.resize(faceCount);
+        mMaxHeights.resize(faceCount);
+        mMaxTriangleExtent = 0;
+        for (GPP::Int sortedFid = 0; sortedFid < faceCount; sortedFid++)
+        {
+            GPP::Int fid = sortedFids[sortedFid];
+            GPP::Real maxHeight = minHeights[fid];
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vid = triangleVertexIds[fid * 3 + fvid];
+                mTriangleVertexIds[sortedFid * 3 + fvid] = vid;
+                maxHeight = std::max(maxHeight, mVertexHeights[vid]);
+            }
+            mMinHeights[sortedFid] = minHeights[fid];
+            mMaxHeights[sortedFid] = maxHeight;
+            mMaxTriangleExtent = std::max(mMaxTriangleExtent, maxHeight - minHeights[fid]);
+        }
+        InfoLog << "MeshSlicer::Init: " << mVertexCount << " vertices, " << faceCount << " triangles, max extent "
+            << mMaxTriangleExtent << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    void MeshSlicer::Clear()
+    {
+        mVertexCount = 0;
+        mVertexCoords.clear();
+        mVertexHeights.clear();
+        mTriangleVertexIds.clear();
+        mMinHeights.clear();
+        mMaxHeights.clear();
+        mMaxTriangleExtent = 0;
+        mBucketStarts.clear();
+        mBucketFids.clear();
+        mBlockCounts.clear();
+    }
+
+    void MeshSlicer::GetHeightRange(GPP::Real& minHeight, GPP::Real& maxHeight) const
+    {
+        minHeight = 0;
+        maxHeight = 0;
+        if (mVertexHeights.empty())
+        {
+            return;
+        }
+        minHeight = *std::min_element(mVertexHeights.begin(), mVertexHeights.end());
+        maxHeight = *std::max_element(mVertexHeights.begin(), mVertexHeights.end());
+    }
+
+    void MeshSlicer::GetUniformHeights(GPP::Int count, std::vector<GPP::Real>& heights) const
+    {
+        heights.clear();
+        if (count < 1)
+        {
+            return;
+        }
+        GPP::Real minHeight, maxHeight;
+        GetHeightRange(minHeight, maxHeight);
+        GPP::Real step = (maxHeight - minHeight) / count;
+        heights.reserve(count);
+        for (GPP::Int pid = 0; pid < count; pid++)
+        {
+            heights.push_back(minHeight + (pid + 0.5) * step);
+        }
+    }
+
+    GPP::ErrorCode MeshSlicer::Slice(const std::vector<GPP::Real>& heights, std::vector<std::vector<SlicePolyline> >& polylines,
+        std::vector<SliceStatistics>& statistics)
+    {
+        if (mMinHeights.empty() || heights.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<GPP::Real> sortedHeights;
+        std::vector<GPP::Int> heightIds;
+        SortHeights(heights, sortedHeights, heightIds);
+        GPP::Int planeCount = sortedHeights.size();
+        std::vector<std::vector<SlicePolyline> > sortedPolylines(planeCount);
+        std::vector<SliceStatistics> sortedStatistics(planeCount);
+        for (GPP::Int batchStart = 0; batchStart < planeCount; batchStart += gSliceBatchSize)
+        {
+            SliceBatch(sortedHeights, batchStart, std::min(batchStart + gSliceBatchSize, planeCount), sortedPolylines, sortedStatistics);
+        }
+        polylines.clear();
+        polylines.resize(planeCount);
+        statistics.resize(planeCount);
+        for (GPP::Int sortedId = 0; sortedId < planeCount; sortedId++)
+        {
+            polylines[heightIds[sortedId]].swap(sortedPolylines[sortedId]);
+            statistics[heightIds[sortedId]] = sortedStatistics[sortedId];
+        }
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode MeshSlicer::SliceToFile(const std::vector<GPP::Real>& heights, const std::string& fileName,
+        GPP::Real outputScale, const GPP::Vector3& outputOffset, std::vector<SliceStatistics>* statistics)
+    {
+        if (mMinHeights.empty() || heights.empty())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::ofstream fout(fileName.c_str());
+        if (!fout)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<GPP::Real> sortedHeights;
+        std::vector<GPP::Int> heightIds;
+        SortHeights(heights, sortedHeights, heightIds);
+        GPP::Int planeCount = sortedHeights.size();
+        if (statistics)
+        {
+            statistics->resize(planeCount);
+        }
+        GPP::Real heightOffset = outputOffset * mSweepDirection;
+        fout.precision(9);
+        fout << "slices " << planeCount << " direction " << mSweepDirection[0] << " " << mSweepDirection[1] << " "
+            << mSweepDirection[2] << "\n";
+        std::vector<std::vector<SlicePolyline> > batchPolylines(planeCount);
+        std::vector<SliceStatistics> batchStatistics(planeCount);
+        for (GPP::Int batchStart = 0; batchStart < planeCount; batchStart += gSliceBatchSize)
+        {
+            GPP::Int batchEnd = std::min(batchStart + gSliceBatchSize, planeCount);
+            SliceBatch(sortedHeights, batchStart, batchEnd, batchPolylines, batchStatistics);
+            for (GPP::Int sortedId = batchStart; sortedId < batchEnd; sortedId++)
+            {
+                SliceStatistics& sliceStatistics = batchStatistics[sortedId];
+                sliceStatistics.height = sliceStatistics.height * outputScale + heightOffset;
+                sliceStatistics.area *= outputScale * outputScale;
+                sliceStatistics.perimeter *= outputScale;
+                if (sliceStatistics.polylineCount > 0)
+                {
+                    sliceStatistics.bboxMin = sliceStatistics.bboxMin * outputScale + outputOffset;
+                    sliceStatistics.bboxMax = sliceStatistics.bboxMax * outputScale + outputOffset;
+                }
+                fout << "slice " << heightIds[sortedId] << " height " << sliceStatistics.height << " polylines "
+                    << sliceStatistics.polylineCount << " closed " << sliceStatistics.closedCount << " area "
+                    << sliceStatistics.area << " perimeter " << sliceStatistics.perimeter << " bbox "
+                    << sliceStatistics.bboxMin[0] << " " << sliceStatistics.bboxMin[1] << " " << sliceStatistics.bboxMin[2] << " "
+                    << sliceStatistics.bboxMax[0] << " " << sliceStatistics.bboxMax[1] << " " << sliceStatistics.bboxMax[2] << "\n";
+                std::vector<SlicePolyline>& slicePolylines = batchPolylines[sortedId];
+                for (std::vector<SlicePolyline>::const_iterator itr = slicePolylines.begin(); itr != slicePolylines.end(); ++itr)
+                {
+                    fout << "polyline " << itr->coords.size() << " " << (itr->isClosed ? 1 : 0) << "\n";
+                    for (std::vector<GPP::Vector3>::const_iterator coordItr = itr->coords.begin(); coordItr != itr->coords.end(); ++coordItr)
+                    {
+                        GPP::Vector3 coord = (*coordItr) * outputScale + outputOffset;
+                        fout << coord[0] << " " << coord[1] << " " << coord[2] << "\n";
+                    }
+                }
+                std::vector<SlicePolyline>().swap(slicePolylines);
+                if (statistics)
+                {
+                    statistics->at(heightIds[sortedId]) = sliceStatistics;
+                }
+            }
+        }
+        fout.close();
+        return GPP_NO_ERROR;
+    }
+
+    void MeshSlicer::SliceBatch(const std::vector<GPP::Real>& sortedHeights, GPP::Int startId, GPP::Int endId,
+        std::vector<std::vector<SlicePolyline> >& polylines, std::vector<SliceStatistics>& statistics)
+    {
+        GPP::Int batchCount = endId - startId;
+        const GPP::Real* batchHeights = &sortedHeights[startId];
+        // A triangle crosses a plane if minHeight < height <= maxHeight, and maxHeight <= minHeight + mMaxTriangleExtent
+        GPP::Int triangleStart = std::lower_bound(mMinHeights.begin(), mMinHeights.end(), batchHeights[0] - mMaxTriangleExtent) - mMinHeights.begin();
+        GPP::Int triangleEnd = std::lower_bound(mMinHeights.begin(), mMinHeights.end(), batchHeights[batchCount - 1]) - mMinHeights.begin();
+        GPP::Int blockCount = (std::max(triangleEnd - triangleStart, GPP::Int(0)) + gSliceTriangleBlockSize - 1) / gSliceTriangleBlockSize;
+
+        mBlockCounts.assign(blockCount * batchCount, 0);
+        if (blockCount > 0)
+        {
+            SliceCountTask countTask(this, batchHeights, batchCount, triangleStart, triangleEnd);
+            ThreadPool::Get()->ParallelFor(blockCount, &countTask, 1);
+        }
+        // Buckets keep the sorted triangle order, block by block
+        mBucketStarts.assign(batchCount + 1, 0);
+        GPP::Int offset = 0;
+        for (GPP::Int pid = 0; pid < batchCount; pid++)
+        {
+            mBucketStarts[pid] = offset;
+            for (GPP::Int blockId = 0; blockId < blockCount; blockId++)
+            {
+                GPP::Int count = mBlockCounts[blockId * batchCount + pid];
+                mBlockCounts[blockId * batchCount + pid] = offset;
+                offset += count;
+            }
+        }
+        mBucketStarts[batchCount] = offset;
+        mBucketFids.resize(offset);
+        if (blockCount > 0)
+        {
+            SliceFillTask fillTask(this, batchHeights, batchCount, triangleStart, triangleEnd);
+            ThreadPool::Get()->ParallelFor(blockCount, &fillTask, 1);
+        }
+
+        SlicePlaneTask planeTask(this, batchHeights, &polylines[startId], &statistics[startId]);
+        ThreadPool::Get()->ParallelFor(batchCount, &planeTask, 1);
+    }
+
+    void MeshSlicer::GetCrossedPlanes(GPP::Int sortedFid, const GPP::Real* batchHeights, GPP::Int batchCount,
+        GPP::Int& firstId, GPP::Int& lastId) const
+    {
+        firstId = std::upper_bound(batchHeights, batchHeights + batchCount, mMinHeights[sortedFid]) - batchHeights;
+        lastId = std::upper_bound(batchHeights + firstId, batchHeights + batchCount, mMaxHeights[sortedFid]) - batchHeights;
+    }
+
+    void MeshSlicer::SlicePlane(GPP::Real height, const GPP::Int* sortedFids, GPP::Int sortedFidCount,
+        std::vector<SlicePolyline>& polylines, SliceStatistics& statistics) const
+    {
+        polylines.clear();
+        statistics.height = height;
+        statistics.polylineCount = 0;
+        statistics.closedCount = 0;
+        statistics.area = 0;
+        statistics.perimeter = 0;
+        statistics.bboxMin = GPP::Vector3(0, 0, 0);
+        statistics.bboxMax = GPP::Vector3(0, 0, 0);
+        if (sortedFidCount == 0)
+        {
+            return;
+        }
+
+        std::vector<SliceSegment> segments(sortedFidCount);
+        for (GPP::Int sid = 0; sid < sortedFidCount; sid++)
+        {
+            const GPP::Int* vertexIds = &mTriangleVertexIds[sortedFids[sid] * 3];
+            SliceSegment& segment = segments[sid];
+            for (int fvid = 0; fvid < 3; fvid++)
+            {
+                GPP::Int vid0 = vertexIds[fvid];
+                GPP::Int vid1 = vertexIds[(fvid + 1) % 3];
+                bool isUpper0 = mVertexHeights[vid0] >= height;
+                bool isUpper1 = mVertexHeights[vid1] >= height;
+                if (isUpper0 == isUpper1)
+                {
+                    continue;
+                }
+                // The crossing point is computed from the lower vertex id, so both triangles of the edge agree on it
+                GPP::Int lowId = std::min(vid0, vid1);
+                GPP::Int highId = std::max(vid0, vid1);
+                GPP::Real ratio = (height - mVertexHeights[lowId]) / (mVertexHeights[highId] - mVertexHeights[lowId]);
+                GPP::Vector3 coord = mVertexCoords[lowId] + (mVertexCoords[highId] - mVertexCoords[lowId]) * ratio;
+                GPP::ULongInt key = GPP::ULongInt(lowId) * GPP::ULongInt(mVertexCount) + GPP::ULongInt(highId);
+                if (isUpper1)
+                {
+                    segment.startKey = key;
+                    segment.startCoord = coord;
+                }
+                else
+                {
+                    segment.endKey = key;
+                    segment.endCoord = coord;
+                }
+            }
+        }
+
+        std::vector<SegmentKey> startKeys(sortedFidCount);
+        std::vector<GPP::ULongInt> endKeys(sortedFidCount);
+        for (GPP::Int sid = 0; sid < sortedFidCount; sid++)
+        {
+            startKeys[sid].key = segments[sid].startKey;
+            startKeys[sid].segmentId = sid;
+            endKeys[sid] = segments[sid].endKey;
+        }
+        std::sort(startKeys.begin(), startKeys.end());
+        std::sort(endKeys.begin(), endKeys.end());
+        std::vector<int> usedFlags(sortedFidCount, 0);
+        // Open polylines start from a segment without predecessor, the remaining segments form closed loops
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (GPP::Int firstId = 0; firstId < sortedFidCount; firstId++)
+            {
+                if (usedFlags[firstId])
+                {
+                    continue;
+                }
+                if (pass == 0 && std::binary_search(endKeys.begin(), endKeys.end(), segments[firstId].startKey))
+                {
+                    continue;
+                }
+                SlicePolyline polyline;
+                polyline.isClosed = false;
+                polyline.coords.push_back(segments[firstId].startCoord);
+                GPP::Int currentId = firstId;
+                while (true)
+                {
+                    usedFlags[currentId] = 1;
+                    const SliceSegment& segment = segments[currentId];
+                    if (pass == 1 && segment.endKey == segments[firstId].startKey)
+                    {
+                        polyline.isClosed = true;
+                        break;
+                    }
+                    if (!IsSameCoord(polyline.coords.back(), segment.endCoord))
+                    {
+                        polyline.coords.push_back(segment.endCoord);
+                    }
+                    SegmentKey searchKey = {segment.endKey, -1};
+                    GPP::Int nextId = -1;
+                    for (std::vector<SegmentKey>::const_iterator itr = std::lower_bound(startKeys.begin(), startKeys.end(), searchKey);
+                        itr != startKeys.end() && itr->key == segment.endKey; ++itr)
+                    {
+                        if (!usedFlags[itr->segmentId])
+                        {
+                            nextId = itr->segmentId;
+                            break;
+                        }
+                    }
+                    if (nextId < 0)
+                    {
+                        break;
+                    }
+                    currentId = nextId;
+                }
+                if (polyline.isClosed && polyline.coords.size() > 1 && IsSameCoord(polyline.coords.front(), polyline.coords.back()))
+                {
+                    polyline.coords.pop_back();
+                }
+                if (polyline.coords.size() < 2)
+                {
+                    // All segments are degenerated at a vertex on the plane
+                    continue;
+                }
+                polylines.push_back(SlicePolyline());
+                polylines.back().coords.swap(polyline.coords);
+                polylines.back().isClosed = polyline.isClosed;
+            }
+        }
+
+        GPP::Real signedArea = 0;
+        bool hasBox = false;
+        for (std::vector<SlicePolyline>::const_iterator itr = polylines.begin(); itr != polylines.end(); ++itr)
+        {
+            GPP::Int coordCount = itr->coords.size();
+            GPP::Int edgeCount = itr->isClosed ? coordCount : coordCount - 1;
+            GPP::Vector3 areaVector(0, 0, 0);
+            for (GPP::Int eid = 0; eid < edgeCount; eid++)
+            {
+                const GPP::Vector3& coord0 = itr->coords[eid];
+                const GPP::Vector3& coord1 = itr->coords[(eid + 1) % coordCount];
+                statistics.perimeter += (coord1 - coord0).Length();
+                areaVector += coord0.CrossProduct(coord1);
+            }
+            if (itr->isClosed)
+            {
+                signedArea += 0.5 * (areaVector * mSweepDirection);
+                statistics.closedCount++;
+            }
+            for (GPP::Int cid = 0; cid < coordCount; cid++)
+            {
+                const GPP::Vector3& coord = itr->coords[cid];
+                if (!hasBox)
+                {
+                    statistics.bboxMin = coord;
+                    statistics.bboxMax = coord;
+                    hasBox = true;
+                    continue;
+                }
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    statistics.bboxMin[axis] = std::min(statistics.bboxMin[axis], coord[axis]);
+                    statistics.bboxMax[axis] = std::max(statistics.bboxMax[axis], coord[axis]);
+                }
+            }
+        }
+        statistics.polylineCount = polylines.size();
+        statistics.area = fabs(signedArea);
+    }
+
+    void MeshSlicer::SortHeights(const std::vector<GPP::Real>& heights, std::vector<GPP::Real>& sortedHeights,
+        std::vector<GPP::Int>& heightIds) const
+    {
+        GPP::Int planeCount = heights.size();
+        heightIds.resize(planeCount);
+        for (GPP::Int pid = 0; pid < planeCount; pid++)
+        {
+            heightIds[pid] = pid;
+        }
+        std::sort(heightIds.begin(), heightIds.end(), HeightIdLess(&heights));
+        sortedHeights.resize(planeCount);
+        for (GPP::Int sortedId = 0; sortedId < planeCount; sortedId++)
+        {
+            sortedHeights[sortedId] = heights[heightIds[sortedId]];
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "ITriMesh.h"
+#include <vector>
+#include <string>
+
+namespace MagicCore
+{
+    struct SlicePolyline
+    {
+        // The first point is not repeated at the end of a closed polyline
+        std::vector<GPP::Vector3> coords;
+        bool isClosed;
+    };
+
+    struct SliceStatistics
+    {
+        GPP::Real height;
+        GPP::Int polylineCount;
+        GPP::Int closedCount;
+        // Enclosed area of the closed polylines, holes are subtracted if the mesh is consistently oriented
+        GPP::Real area;
+        GPP::Real perimeter;
+        GPP::Vector3 bboxMin;
+        GPP::Vector3 bboxMax;
+    };
+
+    // Cross sections of a mesh by many parallel planes.
+    // Init sorts the triangles by their lowest height along the sweep direction, so the triangles which could cross a
+    // batch of neighboring planes are a contiguous range. Every batch buckets its triangles by the planes they cross,
+    // then all planes of the batch are sliced in parallel. Segments are chained through their mesh edges into
+    // polylines. A vertex on a plane counts as above it, so every crossed triangle has exactly one segment and the
+    // polylines close without tolerance.
+    class MeshSlicer
+    {
+    public:
+        MeshSlicer();
+        ~MeshSlicer();
+
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, const GPP::Vector3& sweepDirection);
+        void Clear(void);
+
+        // Height of a point is its projection on the normalized sweep direction
+        void GetHeightRange(GPP::Real& minHeight, GPP::Real& maxHeight) const;
+        // count heights evenly inside the height range, without the two ends
+        void GetUniformHeights(GPP::Int count, std::vector<GPP::Real>& heights) const;
+
+        // Results are in the order of heights
+        GPP::ErrorCode Slice(const std::vector<GPP::Real>& heights, std::vector<std::vector<SlicePolyline> >& polylines,
+            std::vector<SliceStatistics>& statistics);
+        // Slices are written in ascending height order as soon as their batch is done, so only one batch is in memory.
+        // Output coordinates are coord * outputScale + outputOffset, statistics are scaled in the same way.
+        // statistics could be NULL, they are in the order of heights.
+        GPP::ErrorCode SliceToFile(const std::vector<GPP::Real>& heights, const std::string& fileName,
+            GPP::Real outputScale, const GPP::Vector3& outputOffset, std::vector<SliceStatistics>* statistics);
+
+    private:
+        friend class SliceCountTask;
+        friend class SliceFillTask;
+        friend class SlicePlaneTask;
+        // Slice sortedHeights[startId, endId), results are indexed from startId
+        void SliceBatch(const std::vector<GPP::Real>& sortedHeights, GPP::Int startId, GPP::Int endId,
+            std::vector<std::vector<SlicePolyline> >& polylines, std::vector<SliceStatistics>& statistics);
+        // Range of the batch planes crossed by sorted triangle sortedFid
+        void GetCrossedPlanes(GPP::Int sortedFid, const GPP::Real* batchHeights, GPP::Int batchCount,
+            GPP::Int& firstId, GPP::Int& lastId) const;
+        void SlicePlane(GPP::Real height, const GPP::Int* sortedFids, GPP::Int sortedFidCount,
+            std::vector<SlicePolyline>& polylines, SliceStatistics& statistics) const;
+        void SortHeights(const std::vector<GPP::Real>& heights, std::vector<GPP::Real>& sortedHeights,
+            std::vector<GPP::Int>& heightIds) const;
+
+    private:
+        GPP::Vector3 mSweepDirection;
+        GPP::Int mVertexCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Real> mVertexHeights;
+        // Triangles are sorted by mMinHeights
+        std::vector<GPP::Int> mTriangleVertexIds;
+        std::vector<GPP::Real> mMinHeights;
+        std::vector<GPP::Real> mMaxHeights;
+        GPP::Real mMaxTriangleExtent;
+        // Per batch buckets: triangles of plane pid are mBucketFids[mBucketStarts[pid], mBucketStarts[pid + 1])
+        std::vector<GPP::Int> mBucketStarts;
+        std::vector<GPP::Int> mBucketFids;
+        std::vector<GPP::Int> mBlockCounts;
+    };
+}
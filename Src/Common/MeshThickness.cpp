@@ -0,0 +1,620 @@
+#include "MeshThickness.h"
+#include "MeshQueryEngine.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+#include <cfloat>
+#include <cmath>
+
+namespace MagicCore
+{
+    static const int gRayPacketSize = 8;
+    static const int gMinRayCount = 8;
+    static const int gMaxRayCount = 64;
+    // A sample stops tracing when the standard error of its mean hit distance is below this ratio of the mean
+    static const GPP::Real gRayRelativeError = 0.1;
+    // Head of the sample order is stratified over grid cells, it is picked from a random pool of this many times its size
+    static const GPP::Int gStratifiedSampleCount = 16384;
+    static const GPP::Int gStratifiedPoolFactor = 8;
+    static const int gMaxGridResolution = 1024;
+    static const int gSmoothIterationCount = 2;
+    static const GPP::Real gGoldenAngle = 2.39996322972865332;
+
+    // xorshift, the sample order does not depend on the C runtime
+    static inline GPP::ULongInt NextRandom(GPP::ULongInt& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Van der Corput sequence in base 2
+    static inline GPP::Real RadicalInverse(unsigned int index)
+    {
+        GPP::Real result = 0;
+        GPP::Real digit = 0.5;
+        while (index > 0)
+        {
+            if (index & 1)
+            {
+                result += digit;
+            }
+            index >>= 1;
+            digit *= 0.5;
+        }
+        return result;
+    }
+
+    static inline GPP::ULongInt GridCellKey(const GPP::Vector3& coord, const GPP::Vector3& bboxMin, const GPP::Vector3& bboxSize,
+        int resolution)
+    {
+        GPP::ULongInt cellKey = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int cellId = int((coord[axis] - bboxMin[axis]) / bboxSize[axis] * resolution);
+            cellId = cellId < resolution ? cellId : resolution - 1;
+            cellKey = cellKey * resolution + cellId;
+        }
+        return cellKey;
+    }
+
+    class SampleTraceTask : public ParallelTask
+    {
+    public:
+        SampleTraceTask(MeshThickness* thickness, GPP::Int startRank) :
+            mpThickness(thickness),
+            mStartRank(startRank)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int sid = startId; sid < endId; sid++)
+            {
+                mpThickness->TraceSample(mStartRank + sid);
+            }
+        }
+
+    private:
+        MeshThickness* mpThickness;
+        GPP::Int mStartRank;
+    };
+
+    class ThicknessInterpolateTask : public ParallelTask
+    {
+    public:
+        explicit ThicknessInterpolateTask(MeshThickness* thickness) :
+            mpThickness(thickness)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                mpThickness->InterpolateVertex(vid);
+            }
+        }
+
+    private:
+        MeshThickness* mpThickness;
+    };
+
+    class ThicknessSmoothTask : public ParallelTask
+    {
+    public:
+        explicit ThicknessSmoothTask(MeshThickness* thickness) :
+            mpThickness(thickness)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int vid = startId; vid < endId; vid++)
+            {
+                mpThickness->SmoothVertex(vid);
+            }
+        }
+
+    private:
+        MeshThickness* mpThickness;
+    };
+
+    MeshThickness::MeshThickness() :
+        mpTriMesh(NULL),
+        mpQueryEngine(NULL),
+        mVertexCount(0),
+        mVertexCoords(),
+        mVertexNormals(),
+        mNeighborStarts(),
+        mNeighborIds(),
+        mConeDirections(),
+        mOriginOffset(0),
+        mSampleOrder(),
+        mSampleRanks(),
+        mSampleCount(0),
+        mSampleThickness(),
+        mSampleRayCounts(),
+        mTotalRayCount(0),
+        mRegionSampleRanks(),
+        mRegionDistances(),
+        mSampleNeighborStarts(),
+        mSampleNeighborIds(),
+        mThickness(),
+        mSmoothThickness()
+    {
+    }
+
+    MeshThickness::~MeshThickness()
+    {
+        Clear();
+    }
+
+    GPP::ErrorCode MeshThickness::Init(const GPP::ITriMesh* triMesh, const MeshQueryEngine* queryEngine, GPP::Real coneAngle)
+    {
+        Clear();
+        if (triMesh == NULL || queryEngine == NULL || queryEngine->IsValid(triMesh) == false)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int vertexCount = triMesh->GetVertexCount();
+        if (vertexCount == 0 || triMesh->GetTriangleCount() == 0)
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        mpTriMesh = triMesh;
+        mpQueryEngine = queryEngine;
+        mVertexCount = vertexCount;
+        mVertexCoords.resize(mVertexCount);
+        mVertexNormals.resize(mVertexCount);
+        GPP::Vector3 bboxMin(DBL_MAX, DBL_MAX, DBL_MAX);
+        GPP::Vector3 bboxMax(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mVertexCoords[vid] = triMesh->GetVertexCoord(vid);
+            mVertexNormals[vid] = triMesh->GetVertexNormal(vid);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = mVertexCoords[vid][axis] < bboxMin[axis] ? mVertexCoords[vid][axis] : bboxMin[axis];
+                bboxMax[axis] = mVertexCoords[vid][axis] > bboxMax[axis] ? mVertexCoords[vid][axis] : bboxMax[axis];
+            }
+        }
+        // Rays start slightly inside, so they do not hit the triangles around the sample
+        mOriginOffset = (bboxMax - bboxMin).Length() * 1.0e-6;
+        BuildNeighbors();
+        BuildConeDirections(coneAngle);
+        BuildSampleOrder();
+        mSampleThickness.assign(mVertexCount, 0);
+        mSampleRayCounts.assign(mVertexCount, 0);
+        mRegionSampleRanks.assign(mVertexCount, -1);
+        mRegionDistances.assign(mVertexCount, DBL_MAX);
+        mThickness.assign(mVertexCount, 0);
+        return GPP_NO_ERROR;
+    }
+
+    void MeshThickness::Clear()
+    {
+        mpTriMesh = NULL;
+        mpQueryEngine = NULL;
+        mVertexCount = 0;
+        mVertexCoords.clear();
+        mVertexNormals.clear();
+        mNeighborStarts.clear();
+        mNeighborIds.clear();
+        mConeDirections.clear();
+        mOriginOffset = 0;
+        mSampleOrder.clear();
+        mSampleRanks.clear();
+        mSampleCount = 0;
+        mSampleThickness.clear();
+        mSampleRayCounts.clear();
+        mTotalRayCount = 0;
+        mRegionSampleRanks.clear();
+        mRegionDistances.clear();
+        mSampleNeighborStarts.clear();
+        mSampleNeighborIds.clear();
+        mThickness.clear();
+        mSmoothThickness.clear();
+    }
+
+    GPP::ErrorCode MeshThickness::Refine(GPP::Int sampleCount)
+    {
+        if (mpQueryEngine == NULL || mpQueryEngine->IsValid(mpTriMesh) == false)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int endRank = sampleCount < mVertexCount ? sampleCount : mVertexCount;
+        if (endRank > mSampleCount)
+        {
+            SampleTraceTask traceTask(this, mSampleCount);
+            ThreadPool::Get()->ParallelFor(endRank - mSampleCount, &traceTask, 16);
+            UpdateRegions(mSampleCount, endRank);
+            mSampleCount = endRank;
+        }
+        // A component without samples is not reached by Dijkstra, its first unreached vertex becomes the next sample
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            if (mRegionSampleRanks[vid] >= 0)
+            {
+                continue;
+            }
+            GPP::Int rank = mSampleRanks[vid];
+            GPP::Int swapVertexId = mSampleOrder[mSampleCount];
+            mSampleOrder[mSampleCount] = vid;
+            mSampleRanks[vid] = mSampleCount;
+            mSampleOrder[rank] = swapVertexId;
+            mSampleRanks[swapVertexId] = rank;
+            TraceSample(mSampleCount);
+            UpdateRegions(mSampleCount, mSampleCount + 1);
+            mSampleCount++;
+        }
+        mTotalRayCount = 0;
+        for (GPP::Int rank = 0; rank < mSampleCount; rank++)
+        {
+            mTotalRayCount += mSampleRayCounts[rank];
+        }
+        if (mSampleCount < mVertexCount)
+        {
+            BuildSampleNeighbors();
+        }
+        ThicknessInterpolateTask interpolateTask(this);
+        ThreadPool::Get()->ParallelFor(mVertexCount, &interpolateTask, 1024);
+        if (mSampleCount < mVertexCount)
+        {
+            mSmoothThickness.resize(mVertexCount);
+            for (int iteration = 0; iteration < gSmoothIterationCount; iteration++)
+            {
+                ThicknessSmoothTask smoothTask(this);
+                ThreadPool::Get()->ParallelFor(mVertexCount, &smoothTask, 1024);
+                mThickness.swap(mSmoothThickness);
+            }
+        }
+        InfoLog << "MeshThickness::Refine sampleCount=" << mSampleCount << " averageRayCount=" << GetAverageRayCount() << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    bool MeshThickness::IsComplete() const
+    {
+        return mVertexCount > 0 && mSampleCount == mVertexCount;
+    }
+
+    GPP::Int MeshThickness::GetSampleCount() const
+    {
+        return mSampleCount;
+    }
+
+    GPP::Real MeshThickness::GetAverageRayCount() const
+    {
+        return mSampleCount > 0 ? GPP::Real(mTotalRayCount) / mSampleCount : 0;
+    }
+
+    const std::vector<GPP::Real>& MeshThickness::GetThickness() const
+    {
+        return mThickness;
+    }
+
+    void MeshThickness::BuildNeighbors()
+    {
+        // Every corner adds its two triangle neighbors, duplicates of shared edges are removed per vertex
+        GPP::Int faceCount = mpTriMesh->GetTriangleCount();
+        mNeighborStarts.assign(mVertexCount + 1, 0);
+        std::vector<GPP::Int> triangleVertexIds(faceCount * 3);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            mpTriMesh->GetTriangleVertexIds(fid, &triangleVertexIds[fid * 3]);
+            for (int localId = 0; localId < 3; localId++)
+            {
+                mNeighborStarts[triangleVertexIds[fid * 3 + localId] + 1] += 2;
+            }
+        }
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mNeighborStarts[vid + 1] += mNeighborStarts[vid];
+        }
+        mNeighborIds.resize(mNeighborStarts[mVertexCount]);
+        std::vector<GPP::Int> fillIds(mNeighborStarts.begin(), mNeighborStarts.end() - 1);
+        for (GPP::Int fid = 0; fid < faceCount; fid++)
+        {
+            for (int localId = 0; localId < 3; localId++)
+            {
+                GPP::Int vid = triangleVertexIds[fid * 3 + localId];
+                mNeighborIds[fillIds[vid]++] = triangleVertexIds[fid * 3 + (localId + 1) % 3];
+                mNeighborIds[fillIds[vid]++] = triangleVertexIds[fid * 3 + (localId + 2) % 3];
+            }
+        }
+        std::vector<GPP::Int>().swap(triangleVertexIds);
+        std::vector<GPP::Int>().swap(fillIds);
+        GPP::Int compactCount = 0;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            std::vector<GPP::Int>::iterator startItr = mNeighborIds.begin() + mNeighborStarts[vid];
+            std::vector<GPP::Int>::iterator endItr = mNeighborIds.begin() + mNeighborStarts[vid + 1];
+            std::sort(startItr, endItr);
+            endItr = std::unique(startItr, endItr);
+            mNeighborStarts[vid] = compactCount;
+            for (std::vector<GPP::Int>::iterator itr = startItr; itr != endItr; ++itr)
+            {
+                mNeighborIds[compactCount++] = *itr;
+            }
+        }
+        mNeighborStarts[mVertexCount] = compactCount;
+        std::vector<GPP::Int>(mNeighborIds.begin(), mNeighborIds.begin() + compactCount).swap(mNeighborIds);
+    }
+
+    void MeshThickness::BuildSampleOrder()
+    {
+        mSampleOrder.resize(mVertexCount);
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            mSampleOrder[vid] = vid;
+        }
+        GPP::ULongInt randomState = 88172645463325252ULL;
+        for (GPP::Int vid = mVertexCount - 1; vid > 0; vid--)
+        {
+            GPP::Int swapId = GPP::Int(NextRandom(randomState) % GPP::ULongInt(vid + 1));
+            std::swap(mSampleOrder[vid], mSampleOrder[swapId]);
+        }
+
+        // Grid is refined level by level, the first pool vertex of every empty cell joins the stratified head
+        GPP::Vector3 bboxMin = mVertexCoords[0];
+        GPP::Vector3 bboxMax = mVertexCoords[0];
+        for (GPP::Int vid = 1; vid < mVertexCount; vid++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bboxMin[axis] = mVertexCoords[vid][axis] < bboxMin[axis] ? mVertexCoords[vid][axis] : bboxMin[axis];
+                bboxMax[axis] = mVertexCoords[vid][axis] > bboxMax[axis] ? mVertexCoords[vid][axis] : bboxMax[axis];
+            }
+        }
+        GPP::Vector3 bboxSize = bboxMax - bboxMin;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bboxSize[axis] = bboxSize[axis] > GPP::REAL_TOL ? bboxSize[axis] : GPP::REAL_TOL;
+        }
+        GPP::Int poolSize = gStratifiedSampleCount * gStratifiedPoolFactor;
+        poolSize = poolSize < mVertexCount ? poolSize : mVertexCount;
+        std::vector<GPP::Int> stratifiedIds;
+        std::vector<bool> stratifiedFlags(poolSize, false);
+        std::set<GPP::ULongInt> occupiedCells;
+        for (int resolution = 2; resolution <= gMaxGridResolution && GPP::Int(stratifiedIds.size()) < gStratifiedSampleCount; resolution *= 2)
+        {
+            occupiedCells.clear();
+            for (std::vector<GPP::Int>::iterator itr = stratifiedIds.begin(); itr != stratifiedIds.end(); ++itr)
+            {
+                occupiedCells.insert(GridCellKey(mVertexCoords[*itr], bboxMin, bboxSize, resolution));
+            }
+            for (GPP::Int poolId = 0; poolId < poolSize && GPP::Int(stratifiedIds.size()) < gStratifiedSampleCount; poolId++)
+            {
+                if (stratifiedFlags[poolId] == false &&
+                    occupiedCells.insert(GridCellKey(mVertexCoords[mSampleOrder[poolId]], bboxMin, bboxSize, resolution)).second)
+                {
+                    stratifiedFlags[poolId] = true;
+                    stratifiedIds.push_back(mSampleOrder[poolId]);
+                }
+            }
+        }
+        std::vector<GPP::Int> sampleOrder;
+        sampleOrder.reserve(mVertexCount);
+        sampleOrder.insert(sampleOrder.end(), stratifiedIds.begin(), stratifiedIds.end());
+        for (GPP::Int orderId = 0; orderId < mVertexCount; orderId++)
+        {
+            if (orderId >= poolSize || stratifiedFlags[orderId] == false)
+            {
+                sampleOrder.push_back(mSampleOrder[orderId]);
+            }
+        }
+        mSampleOrder.swap(sampleOrder);
+        mSampleRanks.resize(mVertexCount);
+        for (GPP::Int rank = 0; rank < mVertexCount; rank++)
+        {
+            mSampleRanks[mSampleOrder[rank]] = rank;
+        }
+    }
+
+    void MeshThickness::BuildConeDirections(GPP::Real coneAngle)
+    {
+        // Uniform in the solid angle of the cone: the first ray is the axis, the radial part follows the Van der Corput
+        // sequence and the azimuth turns by the golden angle
+        GPP::Real cosCone = cos(coneAngle / 2.0);
+        mConeDirections.resize(gMaxRayCount);
+        for (int rid = 0; rid < gMaxRayCount; rid++)
+        {
+            GPP::Real cosTheta = 1.0 - RadicalInverse(rid) * (1.0 - cosCone);
+            GPP::Real sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+            GPP::Real phi = gGoldenAngle * rid;
+            mConeDirections[rid] = GPP::Vector3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+        }
+    }
+
+    void MeshThickness::TraceSample(GPP::Int rank)
+    {
+        GPP::Int vid = mSampleOrder[rank];
+        mSampleThickness[rank] = 0;
+        mSampleRayCounts[rank] = 0;
+        GPP::Vector3 centerDir = mVertexNormals[vid] * -1.0;
+        if (centerDir.Normalise() < GPP::REAL_TOL)
+        {
+            return;
+        }
+        GPP::Vector3 axisU = fabs(centerDir[0]) < 0.9 ? GPP::Vector3(1, 0, 0) : GPP::Vector3(0, 1, 0);
+        axisU = centerDir.CrossProduct(axisU);
+        axisU.Normalise();
+        GPP::Vector3 axisV = centerDir.CrossProduct(axisU);
+        GPP::Vector3 rayOrigin = mVertexCoords[vid] + centerDir * mOriginOffset;
+        GPP::Vector3 rayDirs[gRayPacketSize];
+        GPP::Real rayDistances[gRayPacketSize];
+        GPP::Real hitDistances[gMaxRayCount];
+        int hitCount = 0;
+        int rayCount = 0;
+        while (rayCount < gMaxRayCount)
+        {
+            for (int rid = 0; rid < gRayPacketSize; rid++)
+            {
+                const GPP::Vector3& localDir = mConeDirections[rayCount + rid];
+                rayDirs[rid] = axisU * localDir[0] + axisV * localDir[1] + centerDir * localDir[2];
+            }
+            mpQueryEngine->RayIntersectPacket(rayOrigin, rayDirs, gRayPacketSize, FLT_MAX, rayDistances);
+            rayCount += gRayPacketSize;
+            for (int rid = 0; rid < gRayPacketSize; rid++)
+            {
+                if (rayDistances[rid] >= 0)
+                {
+                    hitDistances[hitCount++] = rayDistances[rid] + mOriginOffset;
+                }
+            }
+            if (rayCount < gMinRayCount)
+            {
+                continue;
+            }
+            // Rays escape through an opening, more rays seldom hit
+            if (hitCount == 0)
+            {
+                break;
+            }
+            if (hitCount > 1)
+            {
+                GPP::Real meanDistance = 0;
+                for (int hid = 0; hid < hitCount; hid++)
+                {
+                    meanDistance += hitDistances[hid];
+                }
+                meanDistance /= hitCount;
+                GPP::Real variance = 0;
+                for (int hid = 0; hid < hitCount; hid++)
+                {
+                    variance += (hitDistances[hid] - meanDistance) * (hitDistances[hid] - meanDistance);
+                }
+                variance /= (hitCount - 1);
+                if (variance <= gRayRelativeError * gRayRelativeError * meanDistance * meanDistance * hitCount)
+                {
+                    break;
+                }
+            }
+        }
+        mSampleRayCounts[rank] = rayCount;
+        if (hitCount > 0)
+        {
+            std::nth_element(hitDistances, hitDistances + hitCount / 2, hitDistances + hitCount);
+            mSampleThickness[rank] = hitDistances[hitCount / 2];
+        }
+    }
+
+    void MeshThickness::UpdateRegions(GPP::Int startRank, GPP::Int endRank)
+    {
+        typedef std::pair<GPP::Real, GPP::Int> DistanceVertex;
+        std::priority_queue<DistanceVertex, std::vector<DistanceVertex>, std::greater<DistanceVertex> > candidates;
+        for (GPP::Int rank = startRank; rank < endRank; rank++)
+        {
+            GPP::Int vid = mSampleOrder[rank];
+            mRegionDistances[vid] = 0;
+            mRegionSampleRanks[vid] = rank;
+            candidates.push(DistanceVertex(0, vid));
+        }
+        while (!candidates.empty())
+        {
+            DistanceVertex candidate = candidates.top();
+            candidates.pop();
+            GPP::Int vid = candidate.second;
+            if (candidate.first > mRegionDistances[vid])
+            {
+                continue;
+            }
+            for (GPP::Int nid = mNeighborStarts[vid]; nid < mNeighborStarts[vid + 1]; nid++)
+            {
+                GPP::Int neighborId = mNeighborIds[nid];
+                GPP::Real distance = candidate.first + (mVertexCoords[neighborId] - mVertexCoords[vid]).Length();
+                if (distance < mRegionDistances[neighborId])
+                {
+                    mRegionDistances[neighborId] = distance;
+                    mRegionSampleRanks[neighborId] = mRegionSampleRanks[vid];
+                    candidates.push(DistanceVertex(distance, neighborId));
+                }
+            }
+        }
+    }
+
+    void MeshThickness::BuildSampleNeighbors()
+    {
+        std::vector<std::pair<GPP::Int, GPP::Int> > regionPairs;
+        for (GPP::Int vid = 0; vid < mVertexCount; vid++)
+        {
+            GPP::Int regionRank = mRegionSampleRanks[vid];
+            for (GPP::Int nid = mNeighborStarts[vid]; nid < mNeighborStarts[vid + 1]; nid++)
+            {
+                GPP::Int neighborRank = mRegionSampleRanks[mNeighborIds[nid]];
+                if (mNeighborIds[nid] > vid && neighborRank != regionRank)
+                {
+                    regionPairs.push_back(std::make_pair(regionRank, neighborRank));
+                    regionPairs.push_back(std::make_pair(neighborRank, regionRank));
+                }
+            }
+        }
+        std::sort(regionPairs.begin(), regionPairs.end());
+        regionPairs.erase(std::unique(regionPairs.begin(), regionPairs.end()), regionPairs.end());
+        mSampleNeighborStarts.assign(mSampleCount + 1, 0);
+        mSampleNeighborIds.resize(regionPairs.size());
+        for (GPP::Int pid = 0; pid < GPP::Int(regionPairs.size()); pid++)
+        {
+            mSampleNeighborStarts[regionPairs[pid].first + 1]++;
+            mSampleNeighborIds[pid] = regionPairs[pid].second;
+        }
+        for (GPP::Int rank = 0; rank < mSampleCount; rank++)
+        {
+            mSampleNeighborStarts[rank + 1] += mSampleNeighborStarts[rank];
+        }
+    }
+
+    void MeshThickness::InterpolateVertex(GPP::Int vid)
+    {
+        if (mSampleRanks[vid] < mSampleCount)
+        {
+            mThickness[vid] = mSampleThickness[mSampleRanks[vid]];
+            return;
+        }
+        // Inverse squared distance blending of the own region sample and its adjacent region samples.
+        // Samples without hits carry no thickness, they are skipped.
+        GPP::Int regionRank = mRegionSampleRanks[vid];
+        GPP::Real weightSum = 0;
+        GPP::Real thicknessSum = 0;
+        for (GPP::Int nid = mSampleNeighborStarts[regionRank] - 1; nid < mSampleNeighborStarts[regionRank + 1]; nid++)
+        {
+            GPP::Int sampleRank = nid < mSampleNeighborStarts[regionRank] ? regionRank : mSampleNeighborIds[nid];
+            if (mSampleThickness[sampleRank] <= 0)
+            {
+                continue;
+            }
+            GPP::Real weight = 1.0 / ((mVertexCoords[vid] - mVertexCoords[mSampleOrder[sampleRank]]).LengthSquared() + 1.0e-20);
+            weightSum += weight;
+            thicknessSum += weight * mSampleThickness[sampleRank];
+        }
+        mThickness[vid] = weightSum > 0 ? thicknessSum / weightSum : 0;
+    }
+
+    void MeshThickness::SmoothVertex(GPP::Int vid)
+    {
+        mSmoothThickness[vid] = mThickness[vid];
+        if (mSampleRanks[vid] < mSampleCount || mThickness[vid] <= 0)
+        {
+            return;
+        }
+        GPP::Real neighborSum = 0;
+        int neighborCount = 0;
+        for (GPP::Int nid = mNeighborStarts[vid]; nid < mNeighborStarts[vid + 1]; nid++)
+        {
+            GPP::Real neighborThickness = mThickness[mNeighborIds[nid]];
+            if (neighborThickness > 0)
+            {
+                neighborSum += neighborThickness;
+                neighborCount++;
+            }
+        }
+        if (neighborCount > 0)
+        {
+            mSmoothThickness[vid] = (mThickness[vid] + neighborSum / neighborCount) * 0.5;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "ITriMesh.h"
+#include <vector>
+
+namespace MagicCore
+{
+    class MeshQueryEngine;
+
+    // Progressive shape diameter of a triangle mesh.
+    // Vertices are traced in a fixed sample order whose head is stratified over a grid, so any prefix covers the mesh.
+    // Every sample casts packets of rays inside a cone around its inverse normal and stops once the standard error of
+    // the hit distances is small, the median hit distance is its thickness. Other vertices take the geodesically
+    // nearest sample region found by Dijkstra over the mesh edges, blended with the samples of the adjacent regions
+    // only, so values do not leak across thin walls. Refine adds samples and keeps the traced ones.
+    class MeshThickness
+    {
+    public:
+        MeshThickness();
+        ~MeshThickness();
+
+        // queryEngine should be built on triMesh and kept until Clear. Vertex normals of triMesh should be updated.
+        GPP::ErrorCode Init(const GPP::ITriMesh* triMesh, const MeshQueryEngine* queryEngine, GPP::Real coneAngle);
+        void Clear(void);
+
+        // Trace samples until sampleCount vertices are sampled, then interpolate to all vertices.
+        // Every connected component gets at least one sample.
+        GPP::ErrorCode Refine(GPP::Int sampleCount);
+        // Whether all vertices are sampled
+        bool IsComplete(void) const;
+        GPP::Int GetSampleCount(void) const;
+        GPP::Real GetAverageRayCount(void) const;
+        // Thickness of every vertex, it is 0 if no ray hits
+        const std::vector<GPP::Real>& GetThickness(void) const;
+
+    private:
+        friend class SampleTraceTask;
+        friend class ThicknessInterpolateTask;
+        friend class ThicknessSmoothTask;
+        void BuildNeighbors(void);
+        void BuildSampleOrder(void);
+        void BuildConeDirections(GPP::Real coneAngle);
+        void TraceSample(GPP::Int rank);
+        // Multi source Dijkstra from the samples of rank in [startRank, endRank), only improved vertices are visited
+        void UpdateRegions(GPP::Int startRank, GPP::Int endRank);
+        void BuildSampleNeighbors(void);
+        void InterpolateVertex(GPP::Int vid);
+        void SmoothVertex(GPP::Int vid);
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        const MeshQueryEngine* mpQueryEngine;
+        GPP::Int mVertexCount;
+        std::vector<GPP::Vector3> mVertexCoords;
+        std::vector<GPP::Vector3> mVertexNormals;
+        // Neighbors of vertex vid are mNeighborIds[mNeighborStarts[vid], mNeighborStarts[vid + 1])
+        std::vector<GPP::Int> mNeighborStarts;
+        std::vector<GPP::Int> mNeighborIds;
+        // Ray directions in the local frame whose z axis is the cone axis, any prefix is spread over the cone
+        std::vector<GPP::Vector3> mConeDirections;
+        GPP::Real mOriginOffset;
+        // Vertices of rank in [0, mSampleCount) are sampled
+        std::vector<GPP::Int> mSampleOrder;
+        std::vector<GPP::Int> mSampleRanks;
+        GPP::Int mSampleCount;
+        std::vector<GPP::Real> mSampleThickness;
+        std::vector<int> mSampleRayCounts;
+        GPP::ULongInt mTotalRayCount;
+        // Rank of the geodesically nearest sample, -1 if no sample is connected
+        std::vector<GPP::Int> mRegionSampleRanks;
+        std::vector<GPP::Real> mRegionDistances;
+        // Samples whose regions share an edge: mSampleNeighborIds[mSampleNeighborStarts[rank], mSampleNeighborStarts[rank + 1])
+        std::vector<GPP::Int> mSampleNeighborStarts;
+        std::vector<GPP::Int> mSampleNeighborIds;
+        std::vector<GPP::Real> mThickness;
+        std::vector<GPP::Real> mSmoothThickness;
+    };
+}
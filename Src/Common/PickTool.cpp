@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "PickTool.h"
 #include "RenderSystem.h"
+#include "MeshQueryEngine.h"
+#include <cfloat>
 
 namespace MagicCore
 {
@@ -10,6 +12,7 @@ namespace MagicCore
         mMouseCoord(),
         mpPointCloud(NULL),
         mpTriMesh(NULL),
+        mpQueryEngine(NULL),
         mModelNodeName(),
         mPickPointIds(),
         mPickVertexIds(),
@@ -27,6 +30,7 @@ namespace MagicCore
         mIgnoreBack = ignoreBack;
         mpPointCloud = pointCloud;
         mpTriMesh = triMesh;
+        mpQueryEngine = NULL;
         mModelNodeName = modelNodeName;
     }
 
@@ -34,6 +38,11 @@ namespace MagicCore
     {
         mModelNodeName = modelNodeName;
     }
+
+    void PickTool::SetMeshQueryEngine(const MeshQueryEngine* queryEngine)
+    {
+        mpQueryEngine = queryEngine;
+    }
     
     void PickTool::Reset()
     {
@@ -174,6 +183,10 @@ namespace MagicCore
         {
             return -1;
         }
+        if (mpQueryEngine && mpQueryEngine->IsValid(triMesh))
+        {
+            return PickVertexByRay(triMesh, mouseCoord);
+        }
         double pointSizeSquared = 0.01 * 0.01;
         Ogre::Matrix4 worldM = MagicCore::RenderSystem::Get()->GetSceneManager()->getSceneNode(mModelNodeName)->_getFullTransform();
         Ogre::Matrix4 viewM  = MagicCore::RenderSystem::Get()->GetMainCamera()->getViewMatrix();
@@ -226,4 +239,39 @@ namespace MagicCore
         }
         return pickIndex;
     }
+
+    GPP::Int PickTool::PickVertexByRay(const GPP::TriMesh* triMesh, const GPP::Vector2& mouseCoord)
+    {
+        // The first hit is the visible surface, so occluded vertices are never picked
+        Ogre::Ray ray = MagicCore::RenderSystem::Get()->GetMainCamera()->getCameraToViewportRay((mouseCoord[0] + 1.0) / 2.0, 
+            (1.0 - mouseCoord[1]) / 2.0);
+        Ogre::Matrix4 worldM = MagicCore::RenderSystem::Get()->GetSceneManager()->getSceneNode(mModelNodeName)->_getFullTransform();
+        Ogre::Matrix4 invWorldM = worldM.inverseAffine();
+        Ogre::Vector3 ogreOrigin = invWorldM * ray.getOrigin();
+        Ogre::Vector3 ogreTarget = invWorldM * ray.getPoint(1.0);
+        GPP::Vector3 rayOrigin(ogreOrigin.x, ogreOrigin.y, ogreOrigin.z);
+        GPP::Vector3 rayDirection(ogreTarget.x - ogreOrigin.x, ogreTarget.y - ogreOrigin.y, ogreTarget.z - ogreOrigin.z);
+        GPP::Real hitDistance = 0;
+        GPP::Int faceId = mpQueryEngine->RayIntersect(rayOrigin, rayDirection, DBL_MAX, &hitDistance);
+        if (faceId < 0)
+        {
+            return -1;
+        }
+        rayDirection.Normalise();
+        GPP::Vector3 hitCoord = rayOrigin + rayDirection * hitDistance;
+        GPP::Int vertexIds[3];
+        triMesh->GetTriangleVertexIds(faceId, vertexIds);
+        GPP::Int pickIndex = vertexIds[0];
+        GPP::Real minDistance = triMesh->GetVertexCoord(vertexIds[0]).DistanceSquared(hitCoord);
+        for (int localId = 1; localId < 3; localId++)
+        {
+            GPP::Real distance = triMesh->GetVertexCoord(vertexIds[localId]).DistanceSquared(hitCoord);
+            if (distance < minDistance)
+            {
+                minDistance = distance;
+                pickIndex = vertexIds[localId];
+            }
+        }
+        return pickIndex;
+    }
 }
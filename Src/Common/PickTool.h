@@ -13,6 +13,8 @@ namespace MagicCore
         PM_CYCLE
     };
 
+    class MeshQueryEngine;
+
     class PickTool
     {
     public:
@@ -21,6 +23,8 @@ namespace MagicCore
 
         void SetPickParameter(PickMode pm, bool ignoreBack, GPP::PointCloud* pointCloud, GPP::TriMesh* triMesh, std::string modelNodeName);
         void SetModelNodeName(std::string modelNodeName);
+        // If queryEngine is built on the picked mesh, vertex is picked by ray casting against it
+        void SetMeshQueryEngine(const MeshQueryEngine* queryEngine);
         void Reset(void);
 
         void MousePressed(int mouseCoordX, int mouseCoordY);
@@ -34,6 +38,7 @@ namespace MagicCore
     private:
         GPP::Int PickPointByPoint(const GPP::PointCloud* pointCloud, const GPP::Vector2& mouseCoord, bool ignoreBack);
         GPP::Int PickVertexByPoint(const GPP::TriMesh* triMesh, const GPP::Vector2& mouseCoord, bool ignoreBack);
+        GPP::Int PickVertexByRay(const GPP::TriMesh* triMesh, const GPP::Vector2& mouseCoord);
 
     private:
         PickMode mPickMode;
@@ -41,6 +46,7 @@ namespace MagicCore
         GPP::Vector2 mMouseCoord;
         GPP::PointCloud* mpPointCloud;
         GPP::TriMesh* mpTriMesh;
+        const MeshQueryEngine* mpQueryEngine;
         std::string mModelNodeName;
         std::vector<GPP::Int> mPickPointIds;
         std::vector<GPP::Int> mPickVertexIds;
@@ -0,0 +1,472 @@
+#include "PointNeighborGraph.h"
+#include "ThreadPool.h"
+#include "PointQueryEngine.h"
+#include <cmath>
+
+namespace MagicCore
+{
+    static const int gNeighborQueryChunkSize = 1048576;
+
+    class NeighborMoveTask : public ParallelTask
+    {
+    public:
+        NeighborMoveTask(const GPP::IPointCloud* pointCloud, std::vector<GPP::Vector3>* refCoords,
+            std::vector<float>* moveDistances) :
+            mpPointCloud(pointCloud),
+            mpRefCoords(refCoords),
+            mpMoveDistances(moveDistances)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(pid);
+                mpMoveDistances->at(pid) = float(coord.Distance(mpRefCoords->at(pid)));
+                mpRefCoords->at(pid) = coord;
+            }
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        std::vector<GPP::Vector3>* mpRefCoords;
+        std::vector<float>* mpMoveDistances;
+    };
+
+    class NeighborResortTask : public ParallelTask
+    {
+    public:
+        NeighborResortTask(const std::vector<GPP::Vector3>* refCoords, GPP::Int neighborCount, float maxMoveDistance,
+            std::vector<GPP::Int>* neighborIds, std::vector<float>* squaredDistances, std::vector<float>* guardRadius,
+            std::vector<char>* dirtyFlags) :
+            mpRefCoords(refCoords),
+            mNeighborCount(neighborCount),
+            mMaxMoveDistance(maxMoveDistance),
+            mpNeighborIds(neighborIds),
+            mpSquaredDistances(squaredDistances),
+            mpGuardRadius(guardRadius),
+            mpDirtyFlags(dirtyFlags)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                GPP::Int* ids = &mpNeighborIds->at(pid * mNeighborCount);
+                float* distances = &mpSquaredDistances->at(pid * mNeighborCount);
+                const GPP::Vector3& coord = mpRefCoords->at(pid);
+                for (GPP::Int nid = 0; nid < mNeighborCount; nid++)
+                {
+                    float distance = float(coord.DistanceSquared(mpRefCoords->at(ids[nid])));
+                    GPP::Int neighborId = ids[nid];
+                    // Rows are almost sorted after a small move, insertion sort is nearly linear
+                    GPP::Int insertId = nid;
+                    while (insertId > 0 && distances[insertId - 1] > distance)
+                    {
+                        distances[insertId] = distances[insertId - 1];
+                        ids[insertId] = ids[insertId - 1];
+                        insertId--;
+                    }
+                    distances[insertId] = distance;
+                    ids[insertId] = neighborId;
+                }
+                // Any distance changes at most 2 * mMaxMoveDistance, so the row is still exact
+                // if its farthest neighbor is nearer than every other point could be
+                float guardRadius = mpGuardRadius->at(pid) - 2.f * mMaxMoveDistance;
+                mpGuardRadius->at(pid) = guardRadius;
+                mpDirtyFlags->at(pid) = (guardRadius > 0 && guardRadius * guardRadius > distances[mNeighborCount - 1]) ? 0 : 1;
+            }
+        }
+
+    private:
+        const std::vector<GPP::Vector3>* mpRefCoords;
+        GPP::Int mNeighborCount;
+        float mMaxMoveDistance;
+        std::vector<GPP::Int>* mpNeighborIds;
+        std::vector<float>* mpSquaredDistances;
+        std::vector<float>* mpGuardRadius;
+        std::vector<char>* mpDirtyFlags;
+    };
+
+    PointNeighborGraph::PointNeighborGraph() :
+        mpPointCloud(NULL),
+        mPointCount(0),
+        mNeighborCount(0),
+        mGeneration(-1),
+        mNeighborIds(),
+        mSquaredDistances(),
+        mGuardRadius(),
+        mRefCoords()
+    {
+    }
+
+    PointNeighborGraph::~PointNeighborGraph()
+    {
+    }
+
+    GPP::ErrorCode PointNeighborGraph::Init(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount, GPP::Int generation)
+    {
+        Clear();
+        if (pointCloud == NULL || neighborCount < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        if (pointCount <= neighborCount + 1)
+        {
+            return GPP_NOT_ENOUGH_INPUT;
+        }
+        mpPointCloud = pointCloud;
+        mPointCount = pointCount;
+        mNeighborCount = neighborCount;
+        mGeneration = generation;
+        mNeighborIds.resize(pointCount * neighborCount);
+        mSquaredDistances.resize(pointCount * neighborCount);
+        mGuardRadius.resize(pointCount);
+        mRefCoords.resize(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            mRefCoords.at(pid) = pointCloud->GetPointCoord(pid);
+        }
+        GPP::ErrorCode res = QueryNeighbors(NULL);
+        if (res != GPP_NO_ERROR)
+        {
+            Clear();
+        }
+        return res;
+    }
+
+    GPP::ErrorCode PointNeighborGraph::Refresh()
+    {
+        if (mpPointCloud == NULL)
+        {
+            return GPP_NOT_INITIALIZED;
+        }
+        if (mpPointCloud->GetPointCount() != mPointCount)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<float> moveDistances(mPointCount);
+        NeighborMoveTask moveTask(mpPointCloud, &mRefCoords, &moveDistances);
+        ThreadPool::Get()->ParallelFor(mPointCount, &moveTask, 8192);
+        float maxMoveDistance = 0;
+        for (std::vector<float>::iterator itr = moveDistances.begin(); itr != moveDistances.end(); ++itr)
+        {
+            if (*itr > maxMoveDistance)
+            {
+                maxMoveDistance = *itr;
+            }
+        }
+        std::vector<float>().swap(moveDistances);
+        if (maxMoveDistance == 0)
+        {
+            return GPP_NO_ERROR;
+        }
+        std::vector<char> dirtyFlags(mPointCount, 0);
+        NeighborResortTask resortTask(&mRefCoords, mNeighborCount, maxMoveDistance, &mNeighborIds, &mSquaredDistances,
+            &mGuardRadius, &dirtyFlags);
+        ThreadPool::Get()->ParallelFor(mPointCount, &resortTask, 8192);
+        std::vector<GPP::Int> dirtyIds;
+        for (GPP::Int pid = 0; pid < mPointCount; pid++)
+        {
+            if (dirtyFlags[pid])
+            {
+                dirtyIds.push_back(pid);
+            }
+        }
+        if (dirtyIds.empty())
+        {
+            return GPP_NO_ERROR;
+        }
+        return QueryNeighbors(&dirtyIds);
+    }
+
+    GPP::ErrorCode PointNeighborGraph::QueryNeighbors(const std::vector<GPP::Int>* pointIds)
+    {
+        GPP::PointCloudPointList pointList(mpPointCloud);
+        PointQueryEngine queryEngine;
+        GPP::ErrorCode res = queryEngine.Init(&pointList);
+        if (res != GPP_NO_ERROR)
+        {
+            return res;
+        }
+        // One more for the point itself and one more for the guard radius
+        GPP::Int queryCount = mNeighborCount + 2;
+        GPP::Int totalCount = pointIds == NULL ? mPointCount : GPP::Int(pointIds->size());
+        std::vector<GPP::Vector3> searchCoords;
+        std::vector<GPP::Int> indexRes;
+        std::vector<GPP::Real> distanceRes;
+        for (GPP::Int chunkStart = 0; chunkStart < totalCount; chunkStart += gNeighborQueryChunkSize)
+        {
+            GPP::Int chunkCount = totalCount - chunkStart;
+            if (chunkCount > gNeighborQueryChunkSize)
+            {
+                chunkCount = gNeighborQueryChunkSize;
+            }
+            searchCoords.resize(chunkCount);
+            for (GPP::Int qid = 0; qid < chunkCount; qid++)
+            {
+                GPP::Int pid = pointIds == NULL ? chunkStart + qid : pointIds->at(chunkStart + qid);
+                searchCoords[qid] = mRefCoords.at(pid);
+            }
+            queryEngine.QueryNearestPoints(searchCoords, queryCount, 0, &indexRes, &distanceRes);
+            for (GPP::Int qid = 0; qid < chunkCount; qid++)
+            {
+                GPP::Int pid = pointIds == NULL ? chunkStart + qid : pointIds->at(chunkStart + qid);
+                GPP::Int* ids = &mNeighborIds.at(pid * mNeighborCount);
+                float* distances = &mSquaredDistances.at(pid * mNeighborCount);
+                const GPP::Int* queryIds = &indexRes[qid * queryCount];
+                const GPP::Real* queryDistances = &distanceRes[qid * queryCount];
+                // Skip pid itself once. Duplicated points may push it out of the result, then the last one is dropped.
+                bool isSelfSkipped = false;
+                GPP::Int neighborId = 0;
+                for (GPP::Int rid = 0; rid < queryCount; rid++)
+                {
+                    if (!isSelfSkipped && queryIds[rid] == pid)
+                    {
+                        isSelfSkipped = true;
+                        continue;
+                    }
+                    if (neighborId < mNeighborCount)
+                    {
+                        ids[neighborId] = queryIds[rid];
+                        distances[neighborId] = float(queryDistances[rid]);
+                        neighborId++;
+                    }
+                    else
+                    {
+                        mGuardRadius.at(pid) = float(sqrt(queryDistances[rid]));
+                        break;
+                    }
+                }
+            }
+        }
+        return GPP_NO_ERROR;
+    }
+
+    void PointNeighborGraph::Clear()
+    {
+        mpPointCloud = NULL;
+        mPointCount = 0;
+        mNeighborCount = 0;
+        mGeneration = -1;
+        std::vector<GPP::Int>().swap(mNeighborIds);
+        std::vector<float>().swap(mSquaredDistances);
+        std::vector<float>().swap(mGuardRadius);
+        std::vector<GPP::Vector3>().swap(mRefCoords);
+    }
+
+    const GPP::IPointCloud* PointNeighborGraph::GetPointCloud() const
+    {
+        return mpPointCloud;
+    }
+
+    GPP::Int PointNeighborGraph::GetPointCount() const
+    {
+        return mPointCount;
+    }
+
+    GPP::Int PointNeighborGraph::GetNeighborCount() const
+    {
+        return mNeighborCount;
+    }
+
+    GPP::Int PointNeighborGraph::GetGeneration() const
+    {
+        return mGeneration;
+    }
+
+    bool PointNeighborGraph::IsValid(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount, GPP::Int generation) const
+    {
+        return pointCloud != NULL && pointCloud == mpPointCloud && generation == mGeneration &&
+            neighborCount <= mNeighborCount && pointCloud->GetPointCount() == mPointCount;
+    }
+
+    static inline GPP::Real NeighborWeight(float squaredDistance, float squaredRadius)
+    {
+        return squaredRadius > 0 ? exp(-GPP::Real(squaredDistance) / GPP::Real(squaredRadius)) : 1.0;
+    }
+
+    class GraphSmoothNormalTask : public ParallelTask
+    {
+    public:
+        GraphSmoothNormalTask(const GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Real normalWeight,
+            GPP::Int neighborCount, std::vector<GPP::Vector3>* smoothNormals) :
+            mpPointCloud(pointCloud),
+            mpGraph(graph),
+            mNormalWeight(normalWeight),
+            mNeighborCount(neighborCount),
+            mpSmoothNormals(smoothNormals)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                const GPP::Int* ids = mpGraph->GetNeighborIds(pid);
+                const float* distances = mpGraph->GetSquaredDistances(pid);
+                float squaredRadius = distances[mNeighborCount - 1];
+                GPP::Vector3 normal = mpPointCloud->GetPointNormal(pid);
+                GPP::Vector3 neighborNormal(0, 0, 0);
+                GPP::Real weightSum = 0;
+                for (GPP::Int nid = 0; nid < mNeighborCount; nid++)
+                {
+                    GPP::Vector3 curNormal = mpPointCloud->GetPointNormal(ids[nid]);
+                    GPP::Real weight = NeighborWeight(distances[nid], squaredRadius);
+                    if (curNormal * normal < 0)
+                    {
+                        weight = -weight;
+                    }
+                    neighborNormal += curNormal * weight;
+                    weightSum += fabs(weight);
+                }
+                GPP::Vector3 smoothNormal = normal * mNormalWeight;
+                if (weightSum > GPP::REAL_TOL)
+                {
+                    smoothNormal += neighborNormal / weightSum;
+                }
+                if (smoothNormal.Normalise() < GPP::REAL_TOL)
+                {
+                    smoothNormal = normal;
+                }
+                mpSmoothNormals->at(pid) = smoothNormal;
+            }
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        const PointNeighborGraph* mpGraph;
+        GPP::Real mNormalWeight;
+        GPP::Int mNeighborCount;
+        std::vector<GPP::Vector3>* mpSmoothNormals;
+    };
+
+    class GraphSmoothGeometryTask : public ParallelTask
+    {
+    public:
+        GraphSmoothGeometryTask(const GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int neighborCount,
+            std::vector<GPP::Vector3>* smoothCoords) :
+            mpPointCloud(pointCloud),
+            mpGraph(graph),
+            mNeighborCount(neighborCount),
+            mpSmoothCoords(smoothCoords)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                const GPP::Int* ids = mpGraph->GetNeighborIds(pid);
+                const float* distances = mpGraph->GetSquaredDistances(pid);
+                float squaredRadius = distances[mNeighborCount - 1];
+                GPP::Vector3 coord = mpPointCloud->GetPointCoord(pid);
+                GPP::Vector3 normal = mpPointCloud->GetPointNormal(pid);
+                GPP::Real offset = 0;
+                GPP::Real weightSum = 0;
+                for (GPP::Int nid = 0; nid < mNeighborCount; nid++)
+                {
+                    GPP::Real weight = NeighborWeight(distances[nid], squaredRadius);
+                    offset += (mpPointCloud->GetPointCoord(ids[nid]) - coord) * normal * weight;
+                    weightSum += weight;
+                }
+                if (weightSum > GPP::REAL_TOL)
+                {
+                    coord += normal * (offset / weightSum);
+                }
+                mpSmoothCoords->at(pid) = coord;
+            }
+        }
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        const PointNeighborGraph* mpGraph;
+        GPP::Int mNeighborCount;
+        std::vector<GPP::Vector3>* mpSmoothCoords;
+    };
+
+    class GraphWritePointTask : public ParallelTask
+    {
+    public:
+        GraphWritePointTask(GPP::IPointCloud* pointCloud, const std::vector<GPP::Vector3>* values, bool isNormal) :
+            mpPointCloud(pointCloud),
+            mpValues(values),
+            mIsNormal(isNormal)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            for (int pid = startId; pid < endId; pid++)
+            {
+                if (mIsNormal)
+                {
+                    mpPointCloud->SetPointNormal(pid, mpValues->at(pid));
+                }
+                else
+                {
+                    mpPointCloud->SetPointCoord(pid, mpValues->at(pid));
+                }
+            }
+        }
+
+    private:
+        GPP::IPointCloud* mpPointCloud;
+        const std::vector<GPP::Vector3>* mpValues;
+        bool mIsNormal;
+    };
+
+    static bool IsGraphUsable(const GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int generation,
+        GPP::Int neighborCount)
+    {
+        return pointCloud != NULL && graph != NULL && neighborCount >= 1 && graph->IsValid(pointCloud, neighborCount, generation);
+    }
+
+    GPP::ErrorCode GraphConsolidation::SmoothNormal(GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int generation,
+        GPP::Real normalWeight, GPP::Int neighborCount)
+    {
+        if (!IsGraphUsable(pointCloud, graph, generation, neighborCount) || normalWeight < GPP::REAL_TOL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (!pointCloud->HasNormal())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        std::vector<GPP::Vector3> smoothNormals(pointCount);
+        GraphSmoothNormalTask smoothTask(pointCloud, graph, normalWeight, neighborCount, &smoothNormals);
+        ThreadPool::Get()->ParallelFor(pointCount, &smoothTask, 4096);
+        GraphWritePointTask writeTask(pointCloud, &smoothNormals, true);
+        ThreadPool::Get()->ParallelFor(pointCount, &writeTask, 8192);
+        return GPP_NO_ERROR;
+    }
+
+    GPP::ErrorCode GraphConsolidation::SmoothGeometry(GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int generation,
+        GPP::Int neighborCount, GPP::Int iterationCount)
+    {
+        if (!IsGraphUsable(pointCloud, graph, generation, neighborCount) || iterationCount < 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (!pointCloud->HasNormal())
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointCloud->GetPointCount();
+        std::vector<GPP::Vector3> smoothCoords(pointCount);
+        for (GPP::Int iterationId = 0; iterationId < iterationCount; iterationId++)
+        {
+            GraphSmoothGeometryTask smoothTask(pointCloud, graph, neighborCount, &smoothCoords);
+            ThreadPool::Get()->ParallelFor(pointCount, &smoothTask, 4096);
+            // Points only move a fraction of the neighbor distance per iteration, re-querying the rows here would
+            // rebuild the kd-tree every iteration
+            GraphWritePointTask writeTask(pointCloud, &smoothCoords, false);
+            ThreadPool::Get()->ParallelFor(pointCount, &writeTask, 8192);
+        }
+        return GPP_NO_ERROR;
+    }
+}
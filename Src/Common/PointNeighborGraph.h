@@ -0,0 +1,76 @@
+#pragma once
+#include "IPointCloud.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // k nearest neighbor graph of a point cloud. Rows are stored back to back (CSR with a fixed row length):
+    // neighbors of point pid are mNeighborIds[pid * k, (pid + 1) * k), sorted by distance, pid itself excluded.
+    // A graph built with k neighbors also serves any query with fewer neighbors through the row prefix.
+    // generation is the edit generation of the point cloud when the graph is built, the owner increases it whenever
+    // points are inserted, deleted or reordered.
+    class PointNeighborGraph
+    {
+    public:
+        PointNeighborGraph();
+        ~PointNeighborGraph();
+
+        // point count > neighborCount + 1
+        GPP::ErrorCode Init(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount, GPP::Int generation);
+        // Coordinates are moved slightly but points are not inserted or deleted.
+        // Rows are re-sorted in place, only the points whose neighbor set could change are queried again.
+        GPP::ErrorCode Refresh(void);
+        void Clear(void);
+
+        const GPP::IPointCloud* GetPointCloud(void) const;
+        GPP::Int GetPointCount(void) const;
+        GPP::Int GetNeighborCount(void) const;
+        GPP::Int GetGeneration(void) const;
+        // Whether it is built on pointCloud of this generation with at least neighborCount neighbors
+        bool IsValid(const GPP::IPointCloud* pointCloud, GPP::Int neighborCount, GPP::Int generation) const;
+
+        inline const GPP::Int* GetNeighborIds(GPP::Int pid) const
+        {
+            return &mNeighborIds[pid * mNeighborCount];
+        }
+        inline const float* GetSquaredDistances(GPP::Int pid) const
+        {
+            return &mSquaredDistances[pid * mNeighborCount];
+        }
+
+    private:
+        // pointIds == NULL: query every point
+        GPP::ErrorCode QueryNeighbors(const std::vector<GPP::Int>* pointIds);
+
+    private:
+        const GPP::IPointCloud* mpPointCloud;
+        GPP::Int mPointCount;
+        GPP::Int mNeighborCount;
+        GPP::Int mGeneration;
+        std::vector<GPP::Int> mNeighborIds;
+        std::vector<float> mSquaredDistances;
+        // Lower bound of the distance from a point to any point which is not its neighbor
+        std::vector<float> mGuardRadius;
+        // Coordinates when rows are last updated
+        std::vector<GPP::Vector3> mRefCoords;
+    };
+
+    // Consolidation filters which run on a shared PointNeighborGraph instead of building their own neighborhoods.
+    // They are not GPP::ConsolidatePointCloud: both use Gaussian weights exp(-d^2 / r^2) over the k nearest neighbors,
+    // r is the distance of the k-th neighbor, so results are close to but not the same as the GPP filters.
+    // neighborCount <= graph->GetNeighborCount(), generation is the current edit generation of pointCloud,
+    // GPP_INVALID_INPUT if the graph is built on another generation.
+    class GraphConsolidation
+    {
+    public:
+        // pointCloud should have normals. normal = normalize(normalWeight * normal + weighted mean of oriented neighbor normals)
+        // normalWeight: (REAL_TOL, +). Larger value will smooth less.
+        static GPP::ErrorCode SmoothNormal(GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int generation,
+            GPP::Real normalWeight, GPP::Int neighborCount);
+
+        // pointCloud should have normals. Points move along their normals towards the tangent planes of neighbors.
+        // Neighborhoods of the graph are kept for all iterations, refresh the graph after it.
+        static GPP::ErrorCode SmoothGeometry(GPP::IPointCloud* pointCloud, const PointNeighborGraph* graph, GPP::Int generation,
+            GPP::Int neighborCount, GPP::Int iterationCount);
+    };
+}
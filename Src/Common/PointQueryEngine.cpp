@@ -0,0 +1,635 @@
+#include "PointQueryEngine.h"
+#include "ThreadPool.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace MagicCore
+{
+    static const int gKdLeafSize = 16;
+    static const int gKdStackSize = 128;
+    static const int gQueryTileSize = 256;
+
+    class KdAxisLess
+    {
+    public:
+        KdAxisLess(const std::vector<float>* coords, int axis) :
+            mpCoords(coords),
+            mAxis(axis)
+        {
+        }
+
+        bool operator()(GPP::Int pointId0, GPP::Int pointId1) const
+        {
+            return (*mpCoords)[pointId0 * 3 + mAxis] < (*mpCoords)[pointId1 * 3 + mAxis];
+        }
+
+    private:
+        const std::vector<float>* mpCoords;
+        int mAxis;
+    };
+
+    // Keep the first neighborCount smallest distances sorted
+    static inline void InsertNeighbor(GPP::Int pointId, float distance, GPP::Int neighborCount, GPP::Int& foundCount,
+        GPP::Int* ids, float* squaredDistances)
+    {
+        GPP::Int insertId = foundCount < neighborCount ? foundCount++ : neighborCount - 1;
+        while (insertId > 0 && squaredDistances[insertId - 1] > distance)
+        {
+            squaredDistances[insertId] = squaredDistances[insertId - 1];
+            ids[insertId] = ids[insertId - 1];
+            insertId--;
+        }
+        squaredDistances[insertId] = distance;
+        ids[insertId] = pointId;
+    }
+
+    static inline void ToFloatQuery(const GPP::Vector3& coord, float query[3])
+    {
+        query[0] = float(coord[0]);
+        query[1] = float(coord[1]);
+        query[2] = float(coord[2]);
+    }
+
+    static inline unsigned int SpreadBits(unsigned int value)
+    {
+        value &= 0x3FF;
+        value = (value | (value << 16)) & 0x030000FF;
+        value = (value | (value << 8)) & 0x0300F00F;
+        value = (value | (value << 4)) & 0x030C30C3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+
+    class NearestQueryTileTask : public ParallelTask
+    {
+    public:
+        NearestQueryTileTask(const PointQueryEngine* engine, const std::vector<GPP::Vector3>* coords,
+            const std::vector<GPP::Int>* sortedIds, GPP::Int neighborCount, float pruneScale,
+            std::vector<GPP::Int>* indexRes, std::vector<GPP::Real>* squaredDistances) :
+            mpEngine(engine),
+            mpCoords(coords),
+            mpSortedIds(sortedIds),
+            mNeighborCount(neighborCount),
+            mPruneScale(pruneScale),
+            mpIndexRes(indexRes),
+            mpSquaredDistances(squaredDistances)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            std::vector<GPP::Int> ids(mNeighborCount);
+            std::vector<float> distances(mNeighborCount);
+            float query[3];
+            for (int sortId = startId; sortId < endId; sortId++)
+            {
+                GPP::Int qid = mpSortedIds->at(sortId);
+                ToFloatQuery(mpCoords->at(qid), query);
+                GPP::Int foundCount = mpEngine->SearchNearest(query, mNeighborCount, mPruneScale, &ids[0], &distances[0]);
+                GPP::Int baseId = qid * mNeighborCount;
+                for (GPP::Int nid = 0; nid < mNeighborCount; nid++)
+                {
+                    if (mpIndexRes)
+                    {
+                        mpIndexRes->at(baseId + nid) = nid < foundCount ? ids[nid] : -1;
+                    }
+                    if (mpSquaredDistances)
+                    {
+                        mpSquaredDistances->at(baseId + nid) = nid < foundCount ? GPP::Real(distances[nid]) : -1.0;
+                    }
+                }
+            }
+        }
+
+    private:
+        const PointQueryEngine* mpEngine;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<GPP::Int>* mpSortedIds;
+        GPP::Int mNeighborCount;
+        float mPruneScale;
+        std::vector<GPP::Int>* mpIndexRes;
+        std::vector<GPP::Real>* mpSquaredDistances;
+    };
+
+    class RadiusQueryTileTask : public ParallelTask
+    {
+    public:
+        RadiusQueryTileTask(const PointQueryEngine* engine, const std::vector<GPP::Vector3>* coords,
+            const std::vector<GPP::Int>* sortedIds, float squaredRadius, std::vector<GPP::Int>* resultCounts,
+            std::vector<std::vector<GPP::Int> >* tileIds, std::vector<std::vector<float> >* tileDistances) :
+            mpEngine(engine),
+            mpCoords(coords),
+            mpSortedIds(sortedIds),
+            mSquaredRadius(squaredRadius),
+            mpResultCounts(resultCounts),
+            mpTileIds(tileIds),
+            mpTileDistances(tileDistances)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int sortedCount = mpSortedIds->size();
+            float query[3];
+            for (int tileId = startId; tileId < endId; tileId++)
+            {
+                std::vector<GPP::Int>& ids = mpTileIds->at(tileId);
+                std::vector<float>& distances = mpTileDistances->at(tileId);
+                GPP::Int tileEnd = (tileId + 1) * gQueryTileSize;
+                tileEnd = tileEnd < sortedCount ? tileEnd : sortedCount;
+                for (GPP::Int sortId = tileId * gQueryTileSize; sortId < tileEnd; sortId++)
+                {
+                    GPP::Int qid = mpSortedIds->at(sortId);
+                    ToFloatQuery(mpCoords->at(qid), query);
+                    GPP::Int beforeCount = ids.size();
+                    mpEngine->SearchRadius(query, mSquaredRadius, ids, distances);
+                    mpResultCounts->at(qid) = GPP::Int(ids.size()) - beforeCount;
+                }
+            }
+        }
+
+    private:
+        const PointQueryEngine* mpEngine;
+        const std::vector<GPP::Vector3>* mpCoords;
+        const std::vector<GPP::Int>* mpSortedIds;
+        float mSquaredRadius;
+        std::vector<GPP::Int>* mpResultCounts;
+        std::vector<std::vector<GPP::Int> >* mpTileIds;
+        std::vector<std::vector<float> >* mpTileDistances;
+    };
+
+    class RadiusGatherTileTask : public ParallelTask
+    {
+    public:
+        RadiusGatherTileTask(const std::vector<GPP::Int>* sortedIds, const std::vector<GPP::Int>* offsets,
+            std::vector<std::vector<GPP::Int> >* tileIds, std::vector<std::vector<float> >* tileDistances,
+            std::vector<GPP::Int>* ids, std::vector<GPP::Real>* squaredDistances) :
+            mpSortedIds(sortedIds),
+            mpOffsets(offsets),
+            mpTileIds(tileIds),
+            mpTileDistances(tileDistances),
+            mpIds(ids),
+            mpSquaredDistances(squaredDistances)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int sortedCount = mpSortedIds->size();
+            for (int tileId = startId; tileId < endId; tileId++)
+            {
+                std::vector<GPP::Int>& tileIds = mpTileIds->at(tileId);
+                std::vector<float>& tileDistances = mpTileDistances->at(tileId);
+                GPP::Int tileEnd = (tileId + 1) * gQueryTileSize;
+                tileEnd = tileEnd < sortedCount ? tileEnd : sortedCount;
+                GPP::Int cursor = 0;
+                for (GPP::Int sortId = tileId * gQueryTileSize; sortId < tileEnd; sortId++)
+                {
+                    GPP::Int qid = mpSortedIds->at(sortId);
+                    for (GPP::Int resultId = mpOffsets->at(qid); resultId < mpOffsets->at(qid + 1); resultId++)
+                    {
+                        mpIds->at(resultId) = tileIds[cursor];
+                        if (mpSquaredDistances)
+                        {
+                            mpSquaredDistances->at(resultId) = GPP::Real(tileDistances[cursor]);
+                        }
+                        cursor++;
+                    }
+                }
+                std::vector<GPP::Int>().swap(tileIds);
+                std::vector<float>().swap(tileDistances);
+            }
+        }
+
+    private:
+        const std::vector<GPP::Int>* mpSortedIds;
+        const std::vector<GPP::Int>* mpOffsets;
+        std::vector<std::vector<GPP::Int> >* mpTileIds;
+        std::vector<std::vector<float> >* mpTileDistances;
+        std::vector<GPP::Int>* mpIds;
+        std::vector<GPP::Real>* mpSquaredDistances;
+    };
+
+    PointQueryEngine::PointQueryEngine() :
+        mCoordX(),
+        mCoordY(),
+        mCoordZ(),
+        mPointIds(),
+        mNodes()
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mBboxMin[axis] = 0;
+            mBboxMax[axis] = 0;
+        }
+    }
+
+    PointQueryEngine::~PointQueryEngine()
+    {
+    }
+
+    GPP::ErrorCode PointQueryEngine::Init(const GPP::IPointList* pointList)
+    {
+        Clear();
+        if (pointList == NULL)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        GPP::Int pointCount = pointList->GetPointCount();
+        if (pointCount < 1)
+        {
+            return GPP_EMPTY_INPUT;
+        }
+        std::vector<float> coords(pointCount * 3);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            GPP::Vector3 coord = pointList->GetPointCoord(pid);
+            coords[pid * 3] = float(coord[0]);
+            coords[pid * 3 + 1] = float(coord[1]);
+            coords[pid * 3 + 2] = float(coord[2]);
+        }
+        BuildNodes(coords);
+        InfoLog << "PointQueryEngine::Init pointCount=" << pointCount << " nodeCount=" << mNodes.size() << std::endl;
+        return GPP_NO_ERROR;
+    }
+
+    void PointQueryEngine::Clear()
+    {
+        std::vector<float>().swap(mCoordX);
+        std::vector<float>().swap(mCoordY);
+        std::vector<float>().swap(mCoordZ);
+        std::vector<GPP::Int>().swap(mPointIds);
+        mNodes.clear();
+    }
+
+    GPP::Int PointQueryEngine::GetPointCount() const
+    {
+        return mPointIds.size();
+    }
+
+    void PointQueryEngine::BuildNodes(const std::vector<float>& coords)
+    {
+        GPP::Int pointCount = coords.size() / 3;
+        mPointIds.resize(pointCount);
+        for (GPP::Int pid = 0; pid < pointCount; pid++)
+        {
+            mPointIds[pid] = pid;
+        }
+        mNodes.clear();
+        mNodes.reserve(pointCount / gKdLeafSize * 2 + 1);
+        KdNode rootNode;
+        rootNode.splitValue = 0;
+        rootNode.splitAxis = 0;
+        rootNode.leftOrFirst = 0;
+        rootNode.count = pointCount;
+        mNodes.push_back(rootNode);
+
+        // Median split along the longest axis, children are always after their parent
+        std::vector<GPP::Int> splitStack;
+        splitStack.push_back(0);
+        while (!splitStack.empty())
+        {
+            GPP::Int nodeId = splitStack.back();
+            splitStack.pop_back();
+            GPP::Int first = mNodes[nodeId].leftOrFirst;
+            GPP::Int count = mNodes[nodeId].count;
+            float bboxMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+            float bboxMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            for (GPP::Int localId = first; localId < first + count; localId++)
+            {
+                const float* coord = &coords[mPointIds[localId] * 3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    bboxMin[axis] = coord[axis] < bboxMin[axis] ? coord[axis] : bboxMin[axis];
+                    bboxMax[axis] = coord[axis] > bboxMax[axis] ? coord[axis] : bboxMax[axis];
+                }
+            }
+            if (nodeId == 0)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    mBboxMin[axis] = bboxMin[axis];
+                    mBboxMax[axis] = bboxMax[axis];
+                }
+            }
+            if (count <= gKdLeafSize)
+            {
+                continue;
+            }
+            int splitAxis = 0;
+            for (int axis = 1; axis < 3; axis++)
+            {
+                if (bboxMax[axis] - bboxMin[axis] > bboxMax[splitAxis] - bboxMin[splitAxis])
+                {
+                    splitAxis = axis;
+                }
+            }
+            if (bboxMax[splitAxis] <= bboxMin[splitAxis])
+            {
+                // Duplicated points stay in one leaf
+                continue;
+            }
+            GPP::Int middle = first + count / 2;
+            std::nth_element(mPointIds.begin() + first, mPointIds.begin() + middle, mPointIds.begin() + first + count,
+                KdAxisLess(&coords, splitAxis));
+            GPP::Int childId = mNodes.size();
+            KdNode leftNode;
+            leftNode.splitValue = 0;
+            leftNode.splitAxis = 0;
+            leftNode.leftOrFirst = first;
+            leftNode.count = middle - first;
+            KdNode rightNode = leftNode;
+            rightNode.leftOrFirst = middle;
+            rightNode.count = first + count - middle;
+            mNodes.push_back(leftNode);
+            mNodes.push_back(rightNode);
+            KdNode& node = mNodes[nodeId];
+            node.splitValue = coords[mPointIds[middle] * 3 + splitAxis];
+            node.splitAxis = splitAxis;
+            node.leftOrFirst = childId;
+            node.count = 0;
+            splitStack.push_back(childId);
+            splitStack.push_back(childId + 1);
+        }
+
+        mCoordX.resize(pointCount);
+        mCoordY.resize(pointCount);
+        mCoordZ.resize(pointCount);
+        for (GPP::Int localId = 0; localId < pointCount; localId++)
+        {
+            const float* coord = &coords[mPointIds[localId] * 3];
+            mCoordX[localId] = coord[0];
+            mCoordY[localId] = coord[1];
+            mCoordZ[localId] = coord[2];
+        }
+    }
+
+    GPP::Int PointQueryEngine::SearchNearest(const float query[3], GPP::Int neighborCount, float pruneScale,
+        GPP::Int* ids, float* squaredDistances) const
+    {
+        GPP::Int foundCount = 0;
+        if (mNodes.empty() || neighborCount < 1)
+        {
+            return foundCount;
+        }
+        GPP::Int nodeStack[gKdStackSize];
+        float boundStack[gKdStackSize];
+        int stackSize = 0;
+        nodeStack[stackSize] = 0;
+        boundStack[stackSize++] = 0;
+        float leafDistances[gKdLeafSize];
+        while (stackSize > 0)
+        {
+            stackSize--;
+            const KdNode& node = mNodes[nodeStack[stackSize]];
+            if (foundCount == neighborCount && boundStack[stackSize] * pruneScale >= squaredDistances[neighborCount - 1])
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                GPP::Int leafEnd = node.leftOrFirst + node.count;
+                for (GPP::Int blockStart = node.leftOrFirst; blockStart < leafEnd; blockStart += gKdLeafSize)
+                {
+                    int blockCount = int(leafEnd - blockStart < gKdLeafSize ? leafEnd - blockStart : gKdLeafSize);
+                    const float* coordX = &mCoordX[blockStart];
+                    const float* coordY = &mCoordY[blockStart];
+                    const float* coordZ = &mCoordZ[blockStart];
+                    for (int localId = 0; localId < blockCount; localId++)
+                    {
+                        float dx = coordX[localId] - query[0];
+                        float dy = coordY[localId] - query[1];
+                        float dz = coordZ[localId] - query[2];
+                        leafDistances[localId] = dx * dx + dy * dy + dz * dz;
+                    }
+                    for (int localId = 0; localId < blockCount; localId++)
+                    {
+                        if (foundCount < neighborCount || leafDistances[localId] < squaredDistances[neighborCount - 1])
+                        {
+                            InsertNeighbor(mPointIds[blockStart + localId], leafDistances[localId], neighborCount, foundCount,
+                                ids, squaredDistances);
+                        }
+                    }
+                }
+                continue;
+            }
+            float diff = query[node.splitAxis] - node.splitValue;
+            float farBound = diff * diff;
+            farBound = farBound > boundStack[stackSize] ? farBound : boundStack[stackSize];
+            float nearBound = boundStack[stackSize];
+            GPP::Int nearId = diff < 0 ? node.leftOrFirst : node.leftOrFirst + 1;
+            GPP::Int farId = diff < 0 ? node.leftOrFirst + 1 : node.leftOrFirst;
+            nodeStack[stackSize] = farId;
+            boundStack[stackSize++] = farBound;
+            nodeStack[stackSize] = nearId;
+            boundStack[stackSize++] = nearBound;
+        }
+        return foundCount;
+    }
+
+    void PointQueryEngine::SearchRadius(const float query[3], float squaredRadius, std::vector<GPP::Int>& ids,
+        std::vector<float>& squaredDistances) const
+    {
+        if (mNodes.empty())
+        {
+            return;
+        }
+        GPP::Int nodeStack[gKdStackSize];
+        float boundStack[gKdStackSize];
+        int stackSize = 0;
+        nodeStack[stackSize] = 0;
+        boundStack[stackSize++] = 0;
+        float leafDistances[gKdLeafSize];
+        while (stackSize > 0)
+        {
+            stackSize--;
+            if (boundStack[stackSize] > squaredRadius)
+            {
+                continue;
+            }
+            const KdNode& node = mNodes[nodeStack[stackSize]];
+            if (node.count > 0)
+            {
+                GPP::Int leafEnd = node.leftOrFirst + node.count;
+                for (GPP::Int blockStart = node.leftOrFirst; blockStart < leafEnd; blockStart += gKdLeafSize)
+                {
+                    int blockCount = int(leafEnd - blockStart < gKdLeafSize ? leafEnd - blockStart : gKdLeafSize);
+                    const float* coordX = &mCoordX[blockStart];
+                    const float* coordY = &mCoordY[blockStart];
+                    const float* coordZ = &mCoordZ[blockStart];
+                    for (int localId = 0; localId < blockCount; localId++)
+                    {
+                        float dx = coordX[localId] - query[0];
+                        float dy = coordY[localId] - query[1];
+                        float dz = coordZ[localId] - query[2];
+                        leafDistances[localId] = dx * dx + dy * dy + dz * dz;
+                    }
+                    for (int localId = 0; localId < blockCount; localId++)
+                    {
+                        if (leafDistances[localId] <= squaredRadius)
+                        {
+                            ids.push_back(mPointIds[blockStart + localId]);
+                            squaredDistances.push_back(leafDistances[localId]);
+                        }
+                    }
+                }
+                continue;
+            }
+            float diff = query[node.splitAxis] - node.splitValue;
+            float farBound = diff * diff;
+            farBound = farBound > boundStack[stackSize] ? farBound : boundStack[stackSize];
+            float nearBound = boundStack[stackSize];
+            GPP::Int nearId = diff < 0 ? node.leftOrFirst : node.leftOrFirst + 1;
+            GPP::Int farId = diff < 0 ? node.leftOrFirst + 1 : node.leftOrFirst;
+            nodeStack[stackSize] = farId;
+            boundStack[stackSize++] = farBound;
+            nodeStack[stackSize] = nearId;
+            boundStack[stackSize++] = nearBound;
+        }
+    }
+
+    void PointQueryEngine::SortQueries(const std::vector<GPP::Vector3>& coords, std::vector<GPP::Int>& sortedIds) const
+    {
+        GPP::Int queryCount = coords.size();
+        float scale[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = mBboxMax[axis] - mBboxMin[axis];
+            scale[axis] = extent > 0 ? 1023.f / extent : 0.f;
+        }
+        std::vector<std::pair<unsigned int, GPP::Int> > codes(queryCount);
+        for (GPP::Int qid = 0; qid < queryCount; qid++)
+        {
+            unsigned int code = 0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float cell = (float(coords[qid][axis]) - mBboxMin[axis]) * scale[axis];
+                cell = cell < 0 ? 0 : (cell > 1023.f ? 1023.f : cell);
+                code |= SpreadBits((unsigned int)(cell)) << axis;
+            }
+            codes[qid] = std::make_pair(code, qid);
+        }
+        std::sort(codes.begin(), codes.end());
+        sortedIds.resize(queryCount);
+        for (GPP::Int qid = 0; qid < queryCount; qid++)
+        {
+            sortedIds[qid] = codes[qid].second;
+        }
+    }
+
+    GPP::Int PointQueryEngine::QueryNearestPoint(const GPP::Vector3& coord, GPP::Real* squaredDistance) const
+    {
+        float query[3];
+        ToFloatQuery(coord, query);
+        GPP::Int pointId = -1;
+        float distance = 0;
+        if (SearchNearest(query, 1, 1.f, &pointId, &distance) == 0)
+        {
+            return -1;
+        }
+        if (squaredDistance)
+        {
+            *squaredDistance = distance;
+        }
+        return pointId;
+    }
+
+    GPP::Int PointQueryEngine::QueryNearestPoints(const GPP::Vector3& coord, GPP::Int neighborCount, GPP::Real approximation,
+        GPP::Int* ids, GPP::Real* squaredDistances) const
+    {
+        if (neighborCount < 1 || ids == NULL)
+        {
+            return 0;
+        }
+        float query[3];
+        ToFloatQuery(coord, query);
+        float pruneScale = float((1.0 + approximation) * (1.0 + approximation));
+        std::vector<float> distances(neighborCount);
+        GPP::Int foundCount = SearchNearest(query, neighborCount, pruneScale, ids, &distances[0]);
+        if (squaredDistances)
+        {
+            for (GPP::Int nid = 0; nid < foundCount; nid++)
+            {
+                squaredDistances[nid] = distances[nid];
+            }
+        }
+        return foundCount;
+    }
+
+    void PointQueryEngine::QueryNearestPoints(const std::vector<GPP::Vector3>& coords, GPP::Int neighborCount,
+        GPP::Real approximation, std::vector<GPP::Int>* indexRes, std::vector<GPP::Real>* squaredDistances) const
+    {
+        GPP::Int queryCount = coords.size();
+        if (indexRes)
+        {
+            indexRes->assign(queryCount * neighborCount, -1);
+        }
+        if (squaredDistances)
+        {
+            squaredDistances->assign(queryCount * neighborCount, -1.0);
+        }
+        if (queryCount == 0 || neighborCount < 1 || mNodes.empty())
+        {
+            return;
+        }
+        std::vector<GPP::Int> sortedIds;
+        SortQueries(coords, sortedIds);
+        float pruneScale = float((1.0 + approximation) * (1.0 + approximation));
+        NearestQueryTileTask queryTask(this, &coords, &sortedIds, neighborCount, pruneScale, indexRes, squaredDistances);
+        ThreadPool::Get()->ParallelFor(queryCount, &queryTask, gQueryTileSize);
+    }
+
+    void PointQueryEngine::QueryRadius(const std::vector<GPP::Vector3>& coords, GPP::Real radius, std::vector<GPP::Int>& offsets,
+        std::vector<GPP::Int>& ids, std::vector<GPP::Real>* squaredDistances) const
+    {
+        GPP::Int queryCount = coords.size();
+        offsets.assign(queryCount + 1, 0);
+        ids.clear();
+        if (squaredDistances)
+        {
+            squaredDistances->clear();
+        }
+        if (queryCount == 0 || radius < 0 || mNodes.empty())
+        {
+            return;
+        }
+        std::vector<GPP::Int> sortedIds;
+        SortQueries(coords, sortedIds);
+        GPP::Int tileCount = (queryCount + gQueryTileSize - 1) / gQueryTileSize;
+        std::vector<GPP::Int> resultCounts(queryCount, 0);
+        std::vector<std::vector<GPP::Int> > tileIds(tileCount);
+        std::vector<std::vector<float> > tileDistances(tileCount);
+        RadiusQueryTileTask queryTask(this, &coords, &sortedIds, float(radius * radius), &resultCounts, &tileIds, &tileDistances);
+        ThreadPool::Get()->ParallelFor(tileCount, &queryTask, 1);
+        for (GPP::Int qid = 0; qid < queryCount; qid++)
+        {
+            offsets[qid + 1] = offsets[qid] + resultCounts[qid];
+        }
+        ids.resize(offsets[queryCount]);
+        if (squaredDistances)
+        {
+            squaredDistances->resize(offsets[queryCount]);
+        }
+        RadiusGatherTileTask gatherTask(&sortedIds, &offsets, &tileIds, &tileDistances, &ids, squaredDistances);
+        ThreadPool::Get()->ParallelFor(tileCount, &gatherTask, 1);
+    }
+
+    void PointQueryEngine::QueryRadius(const GPP::Vector3& coord, GPP::Real radius, std::vector<GPP::Int>& ids,
+        std::vector<GPP::Real>* squaredDistances) const
+    {
+        if (radius < 0)
+        {
+            return;
+        }
+        float query[3];
+        ToFloatQuery(coord, query);
+        std::vector<float> distances;
+        SearchRadius(query, float(radius * radius), ids, distances);
+        if (squaredDistances)
+        {
+            squaredDistances->insert(squaredDistances->end(), distances.begin(), distances.end());
+        }
+    }
+}
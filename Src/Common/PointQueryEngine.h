@@ -0,0 +1,74 @@
+#pragma once
+#include "IPointList.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // count > 0: leaf whose points are [leftOrFirst, leftOrFirst + count) in leaf order
+    // count == 0: children are leftOrFirst and leftOrFirst + 1, split by the plane coord[splitAxis] = splitValue
+    struct KdNode
+    {
+        float splitValue;
+        GPP::Int splitAxis;
+        GPP::Int leftOrFirst;
+        GPP::Int count;
+    };
+
+    // Kd tree over a point list for nearest neighbor and fixed radius queries.
+    // Coordinates are stored as float in leaf order, x, y and z in separate arrays, so a leaf scan is a short
+    // contiguous loop the compiler could vectorize. Reported distances are computed from the float coordinates.
+    // Single queries are thread safe. Batched queries are sorted along a Morton curve and processed in tiles
+    // on ThreadPool, so neighboring queries of a tile walk the same part of the tree.
+    class PointQueryEngine
+    {
+    public:
+        PointQueryEngine();
+        ~PointQueryEngine();
+
+        GPP::ErrorCode Init(const GPP::IPointList* pointList);
+        void Clear(void);
+        GPP::Int GetPointCount(void) const;
+
+        // Return point id, -1 if the engine is empty
+        GPP::Int QueryNearestPoint(const GPP::Vector3& coord, GPP::Real* squaredDistance = NULL) const;
+        // approximation >= 0: the i-th returned distance is within (1 + approximation) times of the exact i-th distance.
+        // ids and squaredDistances hold neighborCount elements, sorted by distance. Return the found count.
+        GPP::Int QueryNearestPoints(const GPP::Vector3& coord, GPP::Int neighborCount, GPP::Real approximation,
+            GPP::Int* ids, GPP::Real* squaredDistances) const;
+
+        // Neighbors of query qid are indexRes[qid * neighborCount, (qid + 1) * neighborCount), -1 if there are not
+        // enough points. Output vectors could be NULL.
+        void QueryNearestPoints(const std::vector<GPP::Vector3>& coords, GPP::Int neighborCount, GPP::Real approximation,
+            std::vector<GPP::Int>* indexRes, std::vector<GPP::Real>* squaredDistances) const;
+        // CSR result: points within radius of query qid are ids[offsets[qid], offsets[qid + 1]), in no particular order.
+        // squaredDistances could be NULL.
+        void QueryRadius(const std::vector<GPP::Vector3>& coords, GPP::Real radius, std::vector<GPP::Int>& offsets,
+            std::vector<GPP::Int>& ids, std::vector<GPP::Real>* squaredDistances) const;
+
+        // Search a single query within radius, results are appended
+        void QueryRadius(const GPP::Vector3& coord, GPP::Real radius, std::vector<GPP::Int>& ids,
+            std::vector<GPP::Real>* squaredDistances) const;
+
+    private:
+        friend class NearestQueryTileTask;
+        friend class RadiusQueryTileTask;
+        void BuildNodes(const std::vector<float>& coords);
+        // Search in float, ids and squaredDistances hold neighborCount elements. Return the found count.
+        GPP::Int SearchNearest(const float query[3], GPP::Int neighborCount, float pruneScale, GPP::Int* ids,
+            float* squaredDistances) const;
+        // Results are appended
+        void SearchRadius(const float query[3], float squaredRadius, std::vector<GPP::Int>& ids,
+            std::vector<float>& squaredDistances) const;
+        // Query ids sorted along the Morton curve of the engine bounding box
+        void SortQueries(const std::vector<GPP::Vector3>& coords, std::vector<GPP::Int>& sortedIds) const;
+
+    private:
+        std::vector<float> mCoordX;
+        std::vector<float> mCoordY;
+        std::vector<float> mCoordZ;
+        std::vector<GPP::Int> mPointIds;
+        std::vector<KdNode> mNodes;
+        float mBboxMin[3];
+        float mBboxMax[3];
+    };
+}
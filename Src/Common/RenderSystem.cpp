@@ -1,11 +1,25 @@
 #include "stdafx.h"
 #include "RenderSystem.h"
 #include "../Common/LogSystem.h"
+#include "SelectionSet.h"
 #include "MagicListener.h"
+#include "MeshLodProxy.h"
+#include "ToolKit.h"
 #include "GPP.h"
 
 namespace MagicCore
 {
+    // Meshes with more triangles get a decimated proxy for interaction
+    static const int gProxyMinTriangleCount = 1000000;
+    static const double gFrameTimeBudget = 1.0 / 30.0;
+    // The view is idle if it does not move for gViewIdleTime seconds
+    static const double gViewIdleTime = 0.25;
+
+    static std::string GetProxyName(const std::string& meshName)
+    {
+        return meshName + "_Proxy";
+    }
+
     RenderSystem* RenderSystem::mpRenderSystem = NULL;
 
     RenderSystem::RenderSystem(void) : 
@@ -13,7 +27,13 @@ namespace MagicCore
         mpMainCamera(NULL), 
         mpRenderWindow(NULL), 
         mpSceneManager(NULL),
-        mpViewport(NULL)
+        mpViewport(NULL),
+        mMeshProxies(),
+        mRetiredMeshProxies(),
+        mViewState(),
+        mLastMoveTime(0),
+        mFullDetailFrameTime(0),
+        mIsProxyShown(false)
     {
     }
 
@@ -90,7 +110,13 @@ namespace MagicCore
 
     void RenderSystem::Update()
     {
+        UpdateMeshProxies();
+        double startTime = ToolKit::GetTime();
         mpRoot->renderOneFrame();
+        if (!mIsProxyShown)
+        {
+            mFullDetailFrameTime = ToolKit::GetTime() - startTime;
+        }
     }
 
     Ogre::RenderWindow* RenderSystem::GetRenderWindow()
@@ -133,7 +159,7 @@ namespace MagicCore
     }
 
     void RenderSystem::RenderPointCloud(std::string pointCloudName, std::string materialName, const GPP::PointCloud* pointCloud, 
-        ModelNodeType nodeType, std::vector<bool>* selectFlags, GPP::Vector3* selectColor)
+        ModelNodeType nodeType, const SelectionSet* selection, GPP::Vector3* selectColor)
     {
         if (mpSceneManager == NULL)
         {
@@ -164,7 +190,7 @@ namespace MagicCore
                 GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
                 GPP::Vector3 normal = pointCloud->GetPointNormal(pid);
                 GPP::Vector3 color;
-                if (selectFlags && selectFlags->at(pid))
+                if (selection && selection->IsSelected(pid))
                 {
                     color = *selectColor;
                 }
@@ -186,7 +212,7 @@ namespace MagicCore
             {
                 GPP::Vector3 coord = pointCloud->GetPointCoord(pid);
                 GPP::Vector3 color;
-                if (selectFlags && selectFlags->at(pid))
+                if (selection && selection->IsSelected(pid))
                 {
                     color = *selectColor;
                 }
@@ -289,7 +315,7 @@ namespace MagicCore
     }
 
     void RenderSystem::RenderMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType,
-        std::vector<bool>* selectFlags, GPP::Vector3* selectColor, bool isFlat)
+        const SelectionSet* selection, GPP::Vector3* selectColor, bool isFlat)
     {
         Ogre::ManualObject* manualObj = NULL;
         if (mpSceneManager->hasManualObject(meshName))
@@ -304,12 +330,14 @@ namespace MagicCore
         }
         if (mesh == NULL)
         {
+            RemoveMeshProxy(meshName);
             return;
         }
-        if (selectFlags && (selectFlags->size() != mesh->GetVertexCount()))
+        if (selection && (selection->GetSize() != mesh->GetVertexCount()))
         {
             InfoLog << "Internal Error: mesh vertexCount = " << mesh->GetVertexCount()
-                << " and flagCount = " << selectFlags->size() << std::endl;
+                << " and flagCount = " << selection->GetSize() << std::endl;
+            RemoveMeshProxy(meshName);
             return;
         }
         manualObj->begin(materialName, Ogre::RenderOperation::OT_TRIANGLE_LIST);
@@ -325,7 +353,7 @@ namespace MagicCore
                 {
                     GPP::Vector3 coord = mesh->GetVertexCoord(vertexIds[fvid]);
                     GPP::Vector3 color;
-                    if (selectFlags && selectFlags->at(vertexIds[fvid]))
+                    if (selection && selection->IsSelected(vertexIds[fvid]))
                     {
                         color = *selectColor;
                     }
@@ -352,7 +380,7 @@ namespace MagicCore
                 GPP::Vector3 coord = mesh->GetVertexCoord(vid);
                 GPP::Vector3 normal = mesh->GetVertexNormal(vid);
                 GPP::Vector3 color;
-                if (selectFlags && selectFlags->at(vid))
+                if (selection && selection->IsSelected(vid))
                 {
                     color = *selectColor;
                 }
@@ -373,6 +401,7 @@ namespace MagicCore
             }
         }
         manualObj->end();
+        UpdateMeshProxy(meshName, materialName, mesh, selection, selectColor, isFlat);
     }
 
     void RenderSystem::RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType)
@@ -580,6 +609,7 @@ namespace MagicCore
 
     void RenderSystem::HideRenderingObject(std::string objName)
     {
+        RemoveMeshProxy(objName);
         if (mpSceneManager != NULL)
         {
             if (mpSceneManager->hasManualObject(objName))
@@ -621,6 +651,16 @@ namespace MagicCore
 
     RenderSystem::~RenderSystem(void)
     {
+        for (std::map<std::string, MeshProxyInfo>::iterator itr = mMeshProxies.begin(); itr != mMeshProxies.end(); ++itr)
+        {
+            GPPFREEPOINTER(itr->second.proxy);
+        }
+        mMeshProxies.clear();
+        for (std::vector<MeshLodProxy*>::iterator itr = mRetiredMeshProxies.begin(); itr != mRetiredMeshProxies.end(); ++itr)
+        {
+            GPPFREEPOINTER(*itr);
+        }
+        mRetiredMeshProxies.clear();
     }
 
     void RenderSystem::AttachManualObjectToSceneNode(ModelNodeType nodeType, Ogre::ManualObject* manualObj)
@@ -661,4 +701,209 @@ namespace MagicCore
             break;
         }
     }
+
+    void RenderSystem::UpdateMeshProxy(const std::string& meshName, const std::string& materialName, const GPP::TriMesh* mesh,
+        const SelectionSet* selection, const GPP::Vector3* selectColor, bool isFlat)
+    {
+        if (mesh->GetTriangleCount() < gProxyMinTriangleCount || isFlat || mesh->HasTriangleColor())
+        {
+            RemoveMeshProxy(meshName);
+            return;
+        }
+        std::map<std::string, MeshProxyInfo>::iterator itr = mMeshProxies.find(meshName);
+        if (itr == mMeshProxies.end())
+        {
+            MeshProxyInfo proxyInfo;
+            proxyInfo.proxy = new MeshLodProxy;
+            proxyInfo.triangleCount = 0;
+            itr = mMeshProxies.insert(std::make_pair(meshName, proxyInfo)).first;
+        }
+        // The mesh is changed, the old proxy is not shown any more
+        itr->second.materialName = materialName;
+        itr->second.isUploaded = false;
+        // The snapshot is a pass over the whole mesh on this thread, skip it while the full detail frames fit in
+        // the budget and the mesh does not grow, the proxy would not be shown anyway
+        bool isGrown = mesh->GetTriangleCount() > itr->second.triangleCount;
+        itr->second.triangleCount = mesh->GetTriangleCount();
+        if (mFullDetailFrameTime > gFrameTimeBudget || isGrown)
+        {
+            itr->second.proxy->Update(mesh, selection, selectColor);
+        }
+        else
+        {
+            itr->second.proxy->Invalidate();
+        }
+    }
+
+    void RenderSystem::RemoveMeshProxy(const std::string& meshName)
+    {
+        std::map<std::string, MeshProxyInfo>::iterator itr = mMeshProxies.find(meshName);
+        if (itr == mMeshProxies.end())
+        {
+            return;
+        }
+        if (itr->second.proxy->IsBuilding())
+        {
+            mRetiredMeshProxies.push_back(itr->second.proxy);
+        }
+        else
+        {
+            GPPFREEPOINTER(itr->second.proxy);
+        }
+        mMeshProxies.erase(itr);
+        if (mpSceneManager == NULL)
+        {
+            return;
+        }
+        std::string proxyName = GetProxyName(meshName);
+        if (mpSceneManager->hasManualObject(proxyName))
+        {
+            mpSceneManager->destroyManualObject(proxyName);
+        }
+        if (mpSceneManager->hasManualObject(meshName))
+        {
+            mpSceneManager->getManualObject(meshName)->setVisible(true);
+        }
+    }
+
+    void RenderSystem::UpdateMeshProxies()
+    {
+        for (std::vector<MeshLodProxy*>::iterator itr = mRetiredMeshProxies.begin(); itr != mRetiredMeshProxies.end(); )
+        {
+            if ((*itr)->IsBuilding())
+            {
+                ++itr;
+            }
+            else
+            {
+                delete (*itr);
+                itr = mRetiredMeshProxies.erase(itr);
+            }
+        }
+        mIsProxyShown = false;
+        if (mpSceneManager == NULL || mpMainCamera == NULL || mMeshProxies.empty())
+        {
+            return;
+        }
+        double currentTime = ToolKit::GetTime();
+        if (IsViewMoving())
+        {
+            mLastMoveTime = currentTime;
+        }
+        // mFullDetailFrameTime is kept from the last full detail frame while proxies are shown
+        bool needProxy = (currentTime - mLastMoveTime < gViewIdleTime) && (mFullDetailFrameTime > gFrameTimeBudget);
+        for (std::map<std::string, MeshProxyInfo>::iterator itr = mMeshProxies.begin(); itr != mMeshProxies.end(); ++itr)
+        {
+            MeshProxyInfo& proxyInfo = itr->second;
+            if (proxyInfo.proxy->FetchResult())
+            {
+                proxyInfo.isUploaded = false;
+            }
+            if (!proxyInfo.isUploaded && proxyInfo.proxy->IsUpToDate() && !proxyInfo.proxy->GetTriangleVertexIds().empty())
+            {
+                RenderMeshProxy(itr->first, proxyInfo);
+                proxyInfo.isUploaded = true;
+            }
+            bool useProxy = needProxy && proxyInfo.isUploaded && proxyInfo.proxy->IsUpToDate();
+            if (mpSceneManager->hasManualObject(itr->first))
+            {
+                mpSceneManager->getManualObject(itr->first)->setVisible(!useProxy);
+            }
+            std::string proxyName = GetProxyName(itr->first);
+            if (mpSceneManager->hasManualObject(proxyName))
+            {
+                mpSceneManager->getManualObject(proxyName)->setVisible(useProxy);
+            }
+            if (useProxy)
+            {
+                mIsProxyShown = true;
+            }
+        }
+    }
+
+    void RenderSystem::RenderMeshProxy(const std::string& meshName, const MeshProxyInfo& proxyInfo)
+    {
+        if (!mpSceneManager->hasManualObject(meshName))
+        {
+            return;
+        }
+        std::string proxyName = GetProxyName(meshName);
+        Ogre::ManualObject* manualObj = NULL;
+        if (mpSceneManager->hasManualObject(proxyName))
+        {
+            manualObj = mpSceneManager->getManualObject(proxyName);
+            manualObj->clear();
+        }
+        else
+        {
+            manualObj = mpSceneManager->createManualObject(proxyName);
+            // The proxy follows the full mesh on its scene node
+            Ogre::SceneNode* sceneNode = mpSceneManager->getManualObject(meshName)->getParentSceneNode();
+            if (sceneNode == NULL)
+            {
+                mpSceneManager->destroyManualObject(proxyName);
+                return;
+            }
+            sceneNode->attachObject(manualObj);
+        }
+        manualObj->setVisible(false);
+        const std::vector<float>& vertexCoords = proxyInfo.proxy->GetVertexCoords();
+        const std::vector<float>& vertexNormals = proxyInfo.proxy->GetVertexNormals();
+        const std::vector<float>& vertexColors = proxyInfo.proxy->GetVertexColors();
+        const std::vector<GPP::Int>& triangleVertexIds = proxyInfo.proxy->GetTriangleVertexIds();
+        manualObj->begin(proxyInfo.materialName, Ogre::RenderOperation::OT_TRIANGLE_LIST);
+        int vertexCount = vertexCoords.size() / 3;
+        for (int vid = 0; vid < vertexCount; vid++)
+        {
+            manualObj->position(vertexCoords[vid * 3], vertexCoords[vid * 3 + 1], vertexCoords[vid * 3 + 2]);
+            manualObj->normal(vertexNormals[vid * 3], vertexNormals[vid * 3 + 1], vertexNormals[vid * 3 + 2]);
+            manualObj->colour(vertexColors[vid * 3], vertexColors[vid * 3 + 1], vertexColors[vid * 3 + 2]);
+        }
+        int triangleCount = triangleVertexIds.size() / 3;
+        for (int fid = 0; fid < triangleCount; fid++)
+        {
+            manualObj->triangle(triangleVertexIds[fid * 3], triangleVertexIds[fid * 3 + 1], triangleVertexIds[fid * 3 + 2]);
+        }
+        manualObj->end();
+    }
+
+    bool RenderSystem::IsViewMoving()
+    {
+        std::vector<double> viewState;
+        viewState.reserve(37);
+        Ogre::Vector3 position = mpMainCamera->getPosition();
+        Ogre::Quaternion orientation = mpMainCamera->getOrientation();
+        viewState.push_back(position.x);
+        viewState.push_back(position.y);
+        viewState.push_back(position.z);
+        viewState.push_back(orientation.w);
+        viewState.push_back(orientation.x);
+        viewState.push_back(orientation.y);
+        viewState.push_back(orientation.z);
+        const char* nodeNames[3] = {"ModelNode", "ModelNodeLeft", "ModelNodeRight"};
+        for (int nodeId = 0; nodeId < 3; nodeId++)
+        {
+            if (!mpSceneManager->hasSceneNode(nodeNames[nodeId]))
+            {
+                continue;
+            }
+            Ogre::SceneNode* sceneNode = mpSceneManager->getSceneNode(nodeNames[nodeId]);
+            position = sceneNode->getPosition();
+            orientation = sceneNode->getOrientation();
+            Ogre::Vector3 scale = sceneNode->getScale();
+            viewState.push_back(position.x);
+            viewState.push_back(position.y);
+            viewState.push_back(position.z);
+            viewState.push_back(orientation.w);
+            viewState.push_back(orientation.x);
+            viewState.push_back(orientation.y);
+            viewState.push_back(orientation.z);
+            viewState.push_back(scale.x);
+            viewState.push_back(scale.y);
+            viewState.push_back(scale.z);
+        }
+        bool isMoving = !mViewState.empty() && viewState != mViewState;
+        mViewState.swap(viewState);
+        return isMoving;
+    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <map>
 #include "Vector3.h"
 
 namespace Ogre
@@ -22,6 +23,9 @@ namespace GPP
 
 namespace MagicCore
 {
+    class SelectionSet;
+    class MeshLodProxy;
+
     class RenderSystem
     {
     private:
@@ -37,6 +41,8 @@ namespace MagicCore
 
         static RenderSystem* Get(void);
         void Init(void);
+        // Meshes with a proxy are drawn by their proxy while the view is moving, if the last full detail frame
+        // exceeded the frame time budget. Full detail comes back when the view is idle.
         void Update(void);
 
         Ogre::RenderWindow* GetRenderWindow(void);
@@ -50,11 +56,11 @@ namespace MagicCore
 
         //Rendering tools
         void RenderPointCloud(std::string pointCloudName, std::string materialName, const GPP::PointCloud* pointCloud, 
-            ModelNodeType nodeType = MODEL_NODE_CENTER, std::vector<bool>* selectFlags = NULL, GPP::Vector3* selectColor = NULL);
+            ModelNodeType nodeType = MODEL_NODE_CENTER, const SelectionSet* selection = NULL, GPP::Vector3* selectColor = NULL);
         void RenderPointCloudList(std::string pointCloudListName, std::string materialName, const std::vector<GPP::PointCloud*>& pointCloudList, bool hasNormal, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderPointList(std::string pointListName, std::string materialName, const GPP::Vector3& color, const std::vector<GPP::Vector3>& pointCoords, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, 
-            ModelNodeType nodeType = MODEL_NODE_CENTER, std::vector<bool>* selectFlags = NULL, GPP::Vector3* selectColor = NULL, bool isFlat = false);
+            ModelNodeType nodeType = MODEL_NODE_CENTER, const SelectionSet* selection = NULL, GPP::Vector3* selectColor = NULL, bool isFlat = false);
         void RenderTextureMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderUVMesh(std::string meshName, std::string materialName, const GPP::TriMesh* mesh, ModelNodeType nodeType = MODEL_NODE_CENTER);
         void RenderLineSegments(std::string lineName, std::string materialName, const std::vector<GPP::Vector3>& startCoords, const std::vector<GPP::Vector3>& endCoords);
@@ -67,7 +73,25 @@ namespace MagicCore
         virtual ~RenderSystem(void);
 
     private:
+        struct MeshProxyInfo
+        {
+            MeshLodProxy* proxy;
+            std::string materialName;
+            bool isUploaded;
+            // Triangle count of the last rendered mesh
+            int triangleCount;
+        };
+
         void AttachManualObjectToSceneNode(ModelNodeType nodeType, Ogre::ManualObject* manualObj);
+        // Start a proxy build for a big mesh, remove the proxy of a small one or of a flat or triangle colored one,
+        // which the proxy could not draw
+        void UpdateMeshProxy(const std::string& meshName, const std::string& materialName, const GPP::TriMesh* mesh,
+            const SelectionSet* selection, const GPP::Vector3* selectColor, bool isFlat);
+        void RemoveMeshProxy(const std::string& meshName);
+        // Upload finished proxies and choose between proxy and full detail
+        void UpdateMeshProxies(void);
+        void RenderMeshProxy(const std::string& meshName, const MeshProxyInfo& proxyInfo);
+        bool IsViewMoving(void);
 
     private:
         Ogre::Root*    mpRoot;
@@ -75,6 +99,14 @@ namespace MagicCore
         Ogre::RenderWindow* mpRenderWindow;
         Ogre::SceneManager* mpSceneManager;
         Ogre::Viewport* mpViewport;
+        std::map<std::string, MeshProxyInfo> mMeshProxies;
+        // Proxies of removed meshes, they are deleted after their builds finish
+        std::vector<MeshLodProxy*> mRetiredMeshProxies;
+        // Camera and model node transforms of the last frame
+        std::vector<double> mViewState;
+        double mLastMoveTime;
+        double mFullDetailFrameTime;
+        bool mIsProxyShown;
     };
 }
 
@@ -0,0 +1,680 @@
+#include "SelectionEngine.h"
+#include "ThreadPool.h"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+namespace MagicCore
+{
+    // Every partition owns a full depth buffer, the partition count is bounded by this pixel budget
+    static const GPP::LongInt gMaxDepthPartitionPixelCount = 1 << 26;
+    // Elements below this count are not worth a partition of their own
+    static const GPP::Int gMinDepthPartitionElementCount = 8192;
+
+    // depth is the distance to the camera plane, false if the point is behind the camera
+    static bool ProjectToPixel(const GPP::Real* worldView, const GPP::Real* worldViewProj, GPP::Int width, GPP::Int height,
+        const GPP::Vector3& coord, GPP::Real& pixelX, GPP::Real& pixelY, GPP::Real& depth)
+    {
+        depth = -(worldView[8] * coord[0] + worldView[9] * coord[1] + worldView[10] * coord[2] + worldView[11]);
+        GPP::Real clipW = worldViewProj[12] * coord[0] + worldViewProj[13] * coord[1] + worldViewProj[14] * coord[2] + worldViewProj[15];
+        if (depth <= 0 || clipW <= GPP::REAL_TOL)
+        {
+            return false;
+        }
+        GPP::Real clipX = worldViewProj[0] * coord[0] + worldViewProj[1] * coord[1] + worldViewProj[2] * coord[2] + worldViewProj[3];
+        GPP::Real clipY = worldViewProj[4] * coord[0] + worldViewProj[5] * coord[1] + worldViewProj[6] * coord[2] + worldViewProj[7];
+        pixelX = (clipX / clipW + 1.0) * 0.5 * width;
+        pixelY = (1.0 - clipY / clipW) * 0.5 * height;
+        return true;
+    }
+
+    static inline void WriteDepth(std::vector<float>& depthBuffer, GPP::Int pixelId, float depth)
+    {
+        if (depth < depthBuffer[pixelId])
+        {
+            depthBuffer[pixelId] = depth;
+        }
+    }
+
+    // Every partition splats its own point range into its own buffer, no synchronization is needed
+    class PointSplatTask : public ParallelTask
+    {
+    public:
+        PointSplatTask(const GPP::IPointList* pointList, GPP::Int splatRadius, GPP::Int partitionCount, const GPP::Real* worldView,
+            const GPP::Real* worldViewProj, GPP::Int width, GPP::Int height, std::vector<std::vector<float> >* partitionBuffers,
+            std::vector<GPP::Real>* depthRanges) :
+            mpPointList(pointList),
+            mSplatRadius(splatRadius),
+            mPartitionCount(partitionCount),
+            mpWorldView(worldView),
+            mpWorldViewProj(worldViewProj),
+            mWidth(width),
+            mHeight(height),
+            mpPartitionBuffers(partitionBuffers),
+            mpDepthRanges(depthRanges)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int pointCount = mpPointList->GetPointCount();
+            for (int partId = startId; partId < endId; partId++)
+            {
+                std::vector<float>& depthBuffer = (*mpPartitionBuffers)[partId];
+                GPP::Real minDepth = DBL_MAX;
+                GPP::Real maxDepth = 0;
+                GPP::Int startPointId = GPP::Int((GPP::LongInt)pointCount * partId / mPartitionCount);
+                GPP::Int endPointId = GPP::Int((GPP::LongInt)pointCount * (partId + 1) / mPartitionCount);
+                GPP::Real pixelX, pixelY, depth;
+                for (GPP::Int pid = startPointId; pid < endPointId; pid++)
+                {
+                    if (!ProjectToPixel(mpWorldView, mpWorldViewProj, mWidth, mHeight, mpPointList->GetPointCoord(pid), pixelX, pixelY, depth))
+                    {
+                        continue;
+                    }
+                    GPP::Int centerX = GPP::Int(floor(pixelX));
+                    GPP::Int centerY = GPP::Int(floor(pixelY));
+                    if (centerX < -mSplatRadius || centerX >= mWidth + mSplatRadius || centerY < -mSplatRadius || centerY >= mHeight + mSplatRadius)
+                    {
+                        continue;
+                    }
+                    minDepth = depth < minDepth ? depth : minDepth;
+                    maxDepth = depth > maxDepth ? depth : maxDepth;
+                    GPP::Int startX = std::max(centerX - mSplatRadius, 0);
+                    GPP::Int endX = std::min(centerX + mSplatRadius, mWidth - 1);
+                    GPP::Int startY = std::max(centerY - mSplatRadius, 0);
+                    GPP::Int endY = std::min(centerY + mSplatRadius, mHeight - 1);
+                    for (GPP::Int y = startY; y <= endY; y++)
+                    {
+                        for (GPP::Int x = startX; x <= endX; x++)
+                        {
+                            WriteDepth(depthBuffer, y * mWidth + x, float(depth));
+                        }
+                    }
+                }
+                (*mpDepthRanges)[partId * 2] = minDepth;
+                (*mpDepthRanges)[partId * 2 + 1] = maxDepth;
+            }
+        }
+
+    private:
+        const GPP::IPointList* mpPointList;
+        GPP::Int mSplatRadius;
+        GPP::Int mPartitionCount;
+        const GPP::Real* mpWorldView;
+        const GPP::Real* mpWorldViewProj;
+        GPP::Int mWidth;
+        GPP::Int mHeight;
+        std::vector<std::vector<float> >* mpPartitionBuffers;
+        std::vector<GPP::Real>* mpDepthRanges;
+    };
+
+    class TriangleRasterTask : public ParallelTask
+    {
+    public:
+        TriangleRasterTask(const GPP::ITriMesh* triMesh, GPP::Int partitionCount, const GPP::Real* worldView,
+            const GPP::Real* worldViewProj, GPP::Int width, GPP::Int height, std::vector<std::vector<float> >* partitionBuffers,
+            std::vector<GPP::Real>* depthRanges) :
+            mpTriMesh(triMesh),
+            mPartitionCount(partitionCount),
+            mpWorldView(worldView),
+            mpWorldViewProj(worldViewProj),
+            mWidth(width),
+            mHeight(height),
+            mpPartitionBuffers(partitionBuffers),
+            mpDepthRanges(depthRanges)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int faceCount = mpTriMesh->GetTriangleCount();
+            GPP::Int vertexIds[3];
+            ClipCoord clipCoords[3];
+            ClipCoord polygon[4];
+            for (int partId = startId; partId < endId; partId++)
+            {
+                std::vector<float>& depthBuffer = (*mpPartitionBuffers)[partId];
+                GPP::Real minDepth = DBL_MAX;
+                GPP::Real maxDepth = 0;
+                GPP::Int startFaceId = GPP::Int((GPP::LongInt)faceCount * partId / mPartitionCount);
+                GPP::Int endFaceId = GPP::Int((GPP::LongInt)faceCount * (partId + 1) / mPartitionCount);
+                for (GPP::Int fid = startFaceId; fid < endFaceId; fid++)
+                {
+                    mpTriMesh->GetTriangleVertexIds(fid, vertexIds);
+                    int insideCount = 0;
+                    for (int localId = 0; localId < 3; localId++)
+                    {
+                        ToClipSpace(mpTriMesh->GetVertexCoord(vertexIds[localId]), clipCoords[localId]);
+                        if (NearPlaneDistance(clipCoords[localId]) >= 0)
+                        {
+                            insideCount++;
+                        }
+                    }
+                    if (insideCount == 0)
+                    {
+                        continue;
+                    }
+                    if (insideCount == 3)
+                    {
+                        RasterTriangle(clipCoords[0], clipCoords[1], clipCoords[2], depthBuffer, minDepth, maxDepth);
+                        continue;
+                    }
+                    // Triangle crosses the near plane, the clipped part is a triangle or a quad
+                    int polygonSize = 0;
+                    for (int localId = 0; localId < 3; localId++)
+                    {
+                        const ClipCoord& cur = clipCoords[localId];
+                        const ClipCoord& next = clipCoords[(localId + 1) % 3];
+                        GPP::Real curDistance = NearPlaneDistance(cur);
+                        GPP::Real nextDistance = NearPlaneDistance(next);
+                        if (curDistance >= 0)
+                        {
+                            polygon[polygonSize++] = cur;
+                        }
+                        if ((curDistance >= 0) != (nextDistance >= 0))
+                        {
+                            GPP::Real t = curDistance / (curDistance - nextDistance);
+                            ClipCoord& cross = polygon[polygonSize++];
+                            for (int cid = 0; cid < 5; cid++)
+                            {
+                                cross.value[cid] = cur.value[cid] + (next.value[cid] - cur.value[cid]) * t;
+                            }
+                        }
+                    }
+                    for (int pid = 1; pid + 1 < polygonSize; pid++)
+                    {
+                        RasterTriangle(polygon[0], polygon[pid], polygon[pid + 1], depthBuffer, minDepth, maxDepth);
+                    }
+                }
+                (*mpDepthRanges)[partId * 2] = minDepth;
+                (*mpDepthRanges)[partId * 2 + 1] = maxDepth;
+            }
+        }
+
+    private:
+        // Clip space x, y, z, w and the view depth, all of them are affine in the view coordinate
+        struct ClipCoord
+        {
+            GPP::Real value[5];
+        };
+
+        void ToClipSpace(const GPP::Vector3& coord, ClipCoord& clipCoord) const
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                const GPP::Real* m = mpWorldViewProj + row * 4;
+                clipCoord.value[row] = m[0] * coord[0] + m[1] * coord[1] + m[2] * coord[2] + m[3];
+            }
+            clipCoord.value[4] = -(mpWorldView[8] * coord[0] + mpWorldView[9] * coord[1] + mpWorldView[10] * coord[2] + mpWorldView[11]);
+        }
+
+        // Inside is z >= -w, the near plane of an OpenGL style projection
+        static GPP::Real NearPlaneDistance(const ClipCoord& clipCoord)
+        {
+            return clipCoord.value[2] + clipCoord.value[3];
+        }
+
+        void RasterTriangle(const ClipCoord& c0, const ClipCoord& c1, const ClipCoord& c2, std::vector<float>& depthBuffer,
+            GPP::Real& minDepth, GPP::Real& maxDepth) const
+        {
+            const ClipCoord* clipCoords[3] = {&c0, &c1, &c2};
+            GPP::Real pixelX[3], pixelY[3], depth[3];
+            for (int localId = 0; localId < 3; localId++)
+            {
+                const GPP::Real* value = clipCoords[localId]->value;
+                if (value[3] <= GPP::REAL_TOL || value[4] <= 0)
+                {
+                    return;
+                }
+                pixelX[localId] = (value[0] / value[3] + 1.0) * 0.5 * mWidth;
+                pixelY[localId] = (1.0 - value[1] / value[3]) * 0.5 * mHeight;
+                depth[localId] = value[4];
+            }
+            GPP::Real area = (pixelX[1] - pixelX[0]) * (pixelY[2] - pixelY[0]) - (pixelX[2] - pixelX[0]) * (pixelY[1] - pixelY[0]);
+            if (fabs(area) < GPP::REAL_TOL)
+            {
+                return;
+            }
+            GPP::Int startX = std::max(GPP::Int(floor(std::min(pixelX[0], std::min(pixelX[1], pixelX[2])))), 0);
+            GPP::Int endX = std::min(GPP::Int(ceil(std::max(pixelX[0], std::max(pixelX[1], pixelX[2])))), mWidth - 1);
+            GPP::Int startY = std::max(GPP::Int(floor(std::min(pixelY[0], std::min(pixelY[1], pixelY[2])))), 0);
+            GPP::Int endY = std::min(GPP::Int(ceil(std::max(pixelY[0], std::max(pixelY[1], pixelY[2])))), mHeight - 1);
+            if (startX > endX || startY > endY)
+            {
+                return;
+            }
+            for (int localId = 0; localId < 3; localId++)
+            {
+                minDepth = depth[localId] < minDepth ? depth[localId] : minDepth;
+                maxDepth = depth[localId] > maxDepth ? depth[localId] : maxDepth;
+            }
+            // Reciprocal depth is linear in screen space
+            GPP::Real invArea = 1.0 / area;
+            GPP::Real edgeTol = -1.0e-6;
+            for (GPP::Int y = startY; y <= endY; y++)
+            {
+                GPP::Real sampleY = y + 0.5;
+                for (GPP::Int x = startX; x <= endX; x++)
+                {
+                    GPP::Real sampleX = x + 0.5;
+                    GPP::Real w0 = ((pixelX[1] - sampleX) * (pixelY[2] - sampleY) - (pixelX[2] - sampleX) * (pixelY[1] - sampleY)) * invArea;
+                    GPP::Real w1 = ((pixelX[2] - sampleX) * (pixelY[0] - sampleY) - (pixelX[0] - sampleX) * (pixelY[2] - sampleY)) * invArea;
+                    GPP::Real w2 = 1.0 - w0 - w1;
+                    if (w0 < edgeTol || w1 < edgeTol || w2 < edgeTol)
+                    {
+                        continue;
+                    }
+                    GPP::Real invDepth = w0 / depth[0] + w1 / depth[1] + w2 / depth[2];
+                    WriteDepth(depthBuffer, y * mWidth + x, float(1.0 / invDepth));
+                }
+            }
+        }
+
+    private:
+        const GPP::ITriMesh* mpTriMesh;
+        GPP::Int mPartitionCount;
+        const GPP::Real* mpWorldView;
+        const GPP::Real* mpWorldViewProj;
+        GPP::Int mWidth;
+        GPP::Int mHeight;
+        std::vector<std::vector<float> >* mpPartitionBuffers;
+        std::vector<GPP::Real>* mpDepthRanges;
+    };
+
+    class DepthMergeTask : public ParallelTask
+    {
+    public:
+        DepthMergeTask(std::vector<std::vector<float> >* partitionBuffers) :
+            mpPartitionBuffers(partitionBuffers)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            std::vector<float>& depthBuffer = (*mpPartitionBuffers)[0];
+            int partitionCount = mpPartitionBuffers->size();
+            for (int partId = 1; partId < partitionCount; partId++)
+            {
+                const std::vector<float>& partBuffer = (*mpPartitionBuffers)[partId];
+                for (int pixelId = startId; pixelId < endId; pixelId++)
+                {
+                    WriteDepth(depthBuffer, pixelId, partBuffer[pixelId]);
+                }
+            }
+        }
+
+    private:
+        std::vector<std::vector<float> >* mpPartitionBuffers;
+    };
+
+    class SelectTestTask : public ParallelTask
+    {
+    public:
+        SelectTestTask(const SelectionEngine* engine, const GPP::IPointList* pointList, bool ignoreBack, GPP::Int chunkCount,
+            std::vector<std::vector<GPP::Int> >* chunkIds) :
+            mpEngine(engine),
+            mpPointList(pointList),
+            mIgnoreBack(ignoreBack),
+            mChunkCount(chunkCount),
+            mpChunkIds(chunkIds)
+        {
+        }
+
+        virtual void Run(int startId, int endId)
+        {
+            GPP::Int pointCount = mpPointList->GetPointCount();
+            GPP::Vector3 normal;
+            for (int chunkId = startId; chunkId < endId; chunkId++)
+            {
+                std::vector<GPP::Int>& selectedIds = (*mpChunkIds)[chunkId];
+                GPP::Int startPointId = GPP::Int((GPP::LongInt)pointCount * chunkId / mChunkCount);
+                GPP::Int endPointId = GPP::Int((GPP::LongInt)pointCount * (chunkId + 1) / mChunkCount);
+                for (GPP::Int pid = startPointId; pid < endPointId; pid++)
+                {
+                    if (mIgnoreBack)
+                    {
+                        normal = mpPointList->GetPointNormal(pid);
+                    }
+                    if (mpEngine->IsPointSelected(mpPointList->GetPointCoord(pid), normal, mIgnoreBack))
+                    {
+                        selectedIds.push_back(pid);
+                    }
+                }
+            }
+        }
+
+    private:
+        const SelectionEngine* mpEngine;
+        const GPP::IPointList* mpPointList;
+        bool mIgnoreBack;
+        GPP::Int mChunkCount;
+        std::vector<std::vector<GPP::Int> >* mpChunkIds;
+    };
+
+    SelectionEngine::SelectionEngine() :
+        mWidth(0),
+        mHeight(0),
+        mDepthBuffer(),
+        mHasDepthBuffer(false),
+        mMinDepth(0),
+        mMaxDepth(0),
+        mRelativeTolerance(0.01),
+        mDepthTolerance(0),
+        mShapeMask(),
+        mShapeMinX(0),
+        mShapeMinY(0),
+        mShapeMaxX(-1),
+        mShapeMaxY(-1)
+    {
+        for (int mid = 0; mid < 16; mid++)
+        {
+            mWorldViewMatrix[mid] = (mid % 5 == 0) ? 1 : 0;
+            mWorldViewProjMatrix[mid] = mWorldViewMatrix[mid];
+        }
+    }
+
+    SelectionEngine::~SelectionEngine()
+    {
+    }
+
+    void SelectionEngine::SetView(const GPP::Real* worldViewMatrix, const GPP::Real* projectionMatrix, GPP::Int width, GPP::Int height)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            for (int col = 0; col < 4; col++)
+            {
+                mWorldViewMatrix[row * 4 + col] = worldViewMatrix[row * 4 + col];
+                GPP::Real value = 0;
+                for (int k = 0; k < 4; k++)
+                {
+                    value += projectionMatrix[row * 4 + k] * worldViewMatrix[k * 4 + col];
+                }
+                mWorldViewProjMatrix[row * 4 + col] = value;
+            }
+        }
+        if (width != mWidth || height != mHeight)
+        {
+            mWidth = width;
+            mHeight = height;
+            ClearShape();
+        }
+        // A depth buffer of another view is useless
+        ClearDepthBuffer();
+    }
+
+    GPP::Int SelectionEngine::GetPartitionCount(GPP::Int elementCount) const
+    {
+        GPP::Int partitionCount = ThreadPool::Get()->GetThreadCount();
+        GPP::LongInt pixelCount = (GPP::LongInt)mWidth * mHeight;
+        if (pixelCount > 0 && partitionCount > gMaxDepthPartitionPixelCount / pixelCount)
+        {
+            partitionCount = GPP::Int(gMaxDepthPartitionPixelCount / pixelCount);
+        }
+        if (partitionCount > elementCount / gMinDepthPartitionElementCount)
+        {
+            partitionCount = elementCount / gMinDepthPartitionElementCount;
+        }
+        return partitionCount < 1 ? 1 : partitionCount;
+    }
+
+    void SelectionEngine::BuildDepthBuffer(const GPP::IPointList* pointList, GPP::Int splatRadius)
+    {
+        ClearDepthBuffer();
+        if (pointList == NULL || mWidth <= 0 || mHeight <= 0)
+        {
+            return;
+        }
+        GPP::Int partitionCount = GetPartitionCount(pointList->GetPointCount());
+        std::vector<std::vector<float> > partitionBuffers(partitionCount);
+        for (GPP::Int partId = 0; partId < partitionCount; partId++)
+        {
+            partitionBuffers.at(partId).assign(mWidth * mHeight, FLT_MAX);
+        }
+        std::vector<GPP::Real> depthRanges(partitionCount * 2, 0);
+        PointSplatTask splatTask(pointList, splatRadius < 0 ? 0 : splatRadius, partitionCount, mWorldViewMatrix, mWorldViewProjMatrix,
+            mWidth, mHeight, &partitionBuffers, &depthRanges);
+        ThreadPool::Get()->ParallelFor(partitionCount, &splatTask, 1);
+        MergeDepthBuffers(partitionBuffers, depthRanges);
+    }
+
+    void SelectionEngine::BuildDepthBuffer(const GPP::ITriMesh* triMesh)
+    {
+        ClearDepthBuffer();
+        if (triMesh == NULL || mWidth <= 0 || mHeight <= 0)
+        {
+            return;
+        }
+        GPP::Int partitionCount = GetPartitionCount(triMesh->GetTriangleCount());
+        std::vector<std::vector<float> > partitionBuffers(partitionCount);
+        for (GPP::Int partId = 0; partId < partitionCount; partId++)
+        {
+            partitionBuffers.at(partId).assign(mWidth * mHeight, FLT_MAX);
+        }
+        std::vector<GPP::Real> depthRanges(partitionCount * 2, 0);
+        TriangleRasterTask rasterTask(triMesh, partitionCount, mWorldViewMatrix, mWorldViewProjMatrix,
+            mWidth, mHeight, &partitionBuffers, &depthRanges);
+        ThreadPool::Get()->ParallelFor(partitionCount, &rasterTask, 1);
+        MergeDepthBuffers(partitionBuffers, depthRanges);
+    }
+
+    void SelectionEngine::MergeDepthBuffers(std::vector<std::vector<float> >& partitionBuffers, const std::vector<GPP::Real>& depthRanges)
+    {
+        if (partitionBuffers.size() > 1)
+        {
+            DepthMergeTask mergeTask(&partitionBuffers);
+            ThreadPool::Get()->ParallelFor(mWidth * mHeight, &mergeTask, 16384);
+        }
+        mDepthBuffer.swap(partitionBuffers.at(0));
+        mMinDepth = DBL_MAX;
+        mMaxDepth = 0;
+        for (GPP::Int partId = 0; partId < partitionBuffers.size(); partId++)
+        {
+            mMinDepth = depthRanges.at(partId * 2) < mMinDepth ? depthRanges.at(partId * 2) : mMinDepth;
+            mMaxDepth = depthRanges.at(partId * 2 + 1) > mMaxDepth ? depthRanges.at(partId * 2 + 1) : mMaxDepth;
+        }
+        mHasDepthBuffer = true;
+        UpdateDepthTolerance();
+    }
+
+    void SelectionEngine::ClearDepthBuffer()
+    {
+        mDepthBuffer.clear();
+        mHasDepthBuffer = false;
+        mMinDepth = 0;
+        mMaxDepth = 0;
+        mDepthTolerance = 0;
+    }
+
+    void SelectionEngine::SetDepthTolerance(GPP::Real relativeTolerance)
+    {
+        mRelativeTolerance = relativeTolerance;
+        UpdateDepthTolerance();
+    }
+
+    void SelectionEngine::UpdateDepthTolerance()
+    {
+        if (!mHasDepthBuffer || mMaxDepth < mMinDepth)
+        {
+            mDepthTolerance = 0;
+            return;
+        }
+        GPP::Real depthRange = mMaxDepth - mMinDepth;
+        if (depthRange < mMaxDepth * GPP::REAL_TOL)
+        {
+            // Flat view, fall back to the distance of the model
+            depthRange = mMaxDepth;
+        }
+        mDepthTolerance = mRelativeTolerance * depthRange;
+    }
+
+    void SelectionEngine::ClearShape()
+    {
+        mShapeMask.assign(mWidth * mHeight, 0);
+        mShapeMinX = mWidth;
+        mShapeMinY = mHeight;
+        mShapeMaxX = -1;
+        mShapeMaxY = -1;
+    }
+
+    void SelectionEngine::FillShapeSpan(GPP::Int y, GPP::Int startX, GPP::Int endX)
+    {
+        if (y < 0 || y >= mHeight)
+        {
+            return;
+        }
+        startX = startX < 0 ? 0 : startX;
+        endX = endX >= mWidth ? mWidth - 1 : endX;
+        if (startX > endX)
+        {
+            return;
+        }
+        std::fill(mShapeMask.begin() + y * mWidth + startX, mShapeMask.begin() + y * mWidth + endX + 1, 1);
+        mShapeMinX = startX < mShapeMinX ? startX : mShapeMinX;
+        mShapeMaxX = endX > mShapeMaxX ? endX : mShapeMaxX;
+        mShapeMinY = y < mShapeMinY ? y : mShapeMinY;
+        mShapeMaxY = y > mShapeMaxY ? y : mShapeMaxY;
+    }
+
+    void SelectionEngine::SetRectangle(GPP::Int startX, GPP::Int startY, GPP::Int endX, GPP::Int endY)
+    {
+        ClearShape();
+        GPP::Int minX = startX < endX ? startX : endX;
+        GPP::Int maxX = startX > endX ? startX : endX;
+        GPP::Int minY = startY < endY ? startY : endY;
+        GPP::Int maxY = startY > endY ? startY : endY;
+        for (GPP::Int y = minY; y <= maxY; y++)
+        {
+            FillShapeSpan(y, minX, maxX);
+        }
+    }
+
+    void SelectionEngine::SetLasso(const std::vector<GPP::Vector2>& polygon)
+    {
+        ClearShape();
+        GPP::Int vertexCount = polygon.size();
+        if (vertexCount < 3)
+        {
+            return;
+        }
+        GPP::Real minY = polygon.at(0)[1];
+        GPP::Real maxY = polygon.at(0)[1];
+        for (GPP::Int vid = 1; vid < vertexCount; vid++)
+        {
+            minY = polygon.at(vid)[1] < minY ? polygon.at(vid)[1] : minY;
+            maxY = polygon.at(vid)[1] > maxY ? polygon.at(vid)[1] : maxY;
+        }
+        GPP::Int startY = std::max(GPP::Int(floor(minY)), 0);
+        GPP::Int endY = std::min(GPP::Int(ceil(maxY)), mHeight - 1);
+        // Even-odd scanline fill at pixel centers
+        std::vector<GPP::Real> crossX;
+        for (GPP::Int y = startY; y <= endY; y++)
+        {
+            GPP::Real sampleY = y + 0.5;
+            crossX.clear();
+            for (GPP::Int vid = 0; vid < vertexCount; vid++)
+            {
+                const GPP::Vector2& v0 = polygon.at(vid);
+                const GPP::Vector2& v1 = polygon.at((vid + 1) % vertexCount);
+                if ((v0[1] <= sampleY && v1[1] > sampleY) || (v1[1] <= sampleY && v0[1] > sampleY))
+                {
+                    crossX.push_back(v0[0] + (sampleY - v0[1]) / (v1[1] - v0[1]) * (v1[0] - v0[0]));
+                }
+            }
+            std::sort(crossX.begin(), crossX.end());
+            for (GPP::Int cid = 0; cid + 1 < crossX.size(); cid += 2)
+            {
+                FillShapeSpan(y, GPP::Int(ceil(crossX.at(cid) - 0.5)), GPP::Int(floor(crossX.at(cid + 1) - 0.5)));
+            }
+        }
+    }
+
+    void SelectionEngine::AddBrush(const GPP::Vector2& center, GPP::Real radius)
+    {
+        if (mShapeMask.size() != mWidth * mHeight)
+        {
+            ClearShape();
+        }
+        GPP::Int startY = GPP::Int(floor(center[1] - radius));
+        GPP::Int endY = GPP::Int(ceil(center[1] + radius));
+        for (GPP::Int y = startY; y <= endY; y++)
+        {
+            GPP::Real deltaY = y + 0.5 - center[1];
+            GPP::Real halfWidthSquared = radius * radius - deltaY * deltaY;
+            if (halfWidthSquared < 0)
+            {
+                continue;
+            }
+            GPP::Real halfWidth = sqrt(halfWidthSquared);
+            FillShapeSpan(y, GPP::Int(ceil(center[0] - halfWidth - 0.5)), GPP::Int(floor(center[0] + halfWidth - 0.5)));
+        }
+    }
+
+    bool SelectionEngine::IsPointSelected(const GPP::Vector3& coord, const GPP::Vector3& normal, bool ignoreBack) const
+    {
+        GPP::Real pixelX, pixelY, depth;
+        if (!ProjectToPixel(mWorldViewMatrix, mWorldViewProjMatrix, mWidth, mHeight, coord, pixelX, pixelY, depth))
+        {
+            return false;
+        }
+        GPP::Int x = GPP::Int(floor(pixelX));
+        GPP::Int y = GPP::Int(floor(pixelY));
+        if (x < mShapeMinX || x > mShapeMaxX || y < mShapeMinY || y > mShapeMaxY)
+        {
+            return false;
+        }
+        GPP::Int pixelId = y * mWidth + x;
+        if (mShapeMask[pixelId] == 0)
+        {
+            return false;
+        }
+        if (ignoreBack)
+        {
+            // Front facing if the normal points to the camera at the origin of view space
+            const GPP::Real* m = mWorldViewMatrix;
+            GPP::Real facing = 0;
+            for (int row = 0; row < 3; row++)
+            {
+                GPP::Real viewCoord = m[row * 4] * coord[0] + m[row * 4 + 1] * coord[1] + m[row * 4 + 2] * coord[2] + m[row * 4 + 3];
+                GPP::Real viewNormal = m[row * 4] * normal[0] + m[row * 4 + 1] * normal[1] + m[row * 4 + 2] * normal[2];
+                facing -= viewCoord * viewNormal;
+            }
+            if (facing <= 0)
+            {
+                return false;
+            }
+        }
+        if (mHasDepthBuffer && depth > mDepthBuffer[pixelId] + mDepthTolerance)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void SelectionEngine::Select(const GPP::IPointList* pointList, bool ignoreBack, std::vector<GPP::Int>& selectedIds) const
+    {
+        selectedIds.clear();
+        if (pointList == NULL || mShapeMaxX < mShapeMinX || mShapeMaxY < mShapeMinY)
+        {
+            return;
+        }
+        GPP::Int pointCount = pointList->GetPointCount();
+        GPP::Int chunkCount = ThreadPool::Get()->GetThreadCount() * 8;
+        GPP::Int maxChunkCount = pointCount / 4096 + 1;
+        chunkCount = chunkCount > maxChunkCount ? maxChunkCount : chunkCount;
+        chunkCount = chunkCount < 1 ? 1 : chunkCount;
+        std::vector<std::vector<GPP::Int> > chunkIds(chunkCount);
+        SelectTestTask testTask(this, pointList, ignoreBack, chunkCount, &chunkIds);
+        ThreadPool::Get()->ParallelFor(chunkCount, &testTask, 1);
+        GPP::Int selectCount = 0;
+        for (GPP::Int chunkId = 0; chunkId < chunkCount; chunkId++)
+        {
+            selectCount += chunkIds.at(chunkId).size();
+        }
+        selectedIds.reserve(selectCount);
+        for (GPP::Int chunkId = 0; chunkId < chunkCount; chunkId++)
+        {
+            selectedIds.insert(selectedIds.end(), chunkIds.at(chunkId).begin(), chunkIds.at(chunkId).end());
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "IPointList.h"
+#include "ITriMesh.h"
+#include "Vector2.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // Screen space selection with occlusion test.
+    // A depth buffer of the current view is rasterized in software once per selection, so it works without GPU
+    // read back, and candidate points are tested against it and against the selection shape in parallel.
+    // Matrices are row major 4x4 which transform column vectors, the same layout as Ogre::Matrix4.
+    // Pixel coordinates start from the top left corner of the viewport, the same as mouse coordinates.
+    class SelectionEngine
+    {
+    public:
+        SelectionEngine();
+        ~SelectionEngine();
+
+        void SetView(const GPP::Real* worldViewMatrix, const GPP::Real* projectionMatrix, GPP::Int width, GPP::Int height);
+
+        // Points are splatted as squares of (2 * splatRadius + 1) pixels to close the gaps between them
+        void BuildDepthBuffer(const GPP::IPointList* pointList, GPP::Int splatRadius);
+        // Triangles crossing the near plane are clipped against it
+        void BuildDepthBuffer(const GPP::ITriMesh* triMesh);
+        // Without depth buffer no point is occluded
+        void ClearDepthBuffer(void);
+        // Relative to the depth range of the buffer, default is 0.01
+        void SetDepthTolerance(GPP::Real relativeTolerance);
+
+        // Shape setters replace the current shape, AddBrush accumulates brush strokes
+        void SetRectangle(GPP::Int startX, GPP::Int startY, GPP::Int endX, GPP::Int endY);
+        void SetLasso(const std::vector<GPP::Vector2>& polygon);
+        void AddBrush(const GPP::Vector2& center, GPP::Real radius);
+        void ClearShape(void);
+
+        // Points in the shape which are not occluded. Back facing points are skipped if ignoreBack is true.
+        void Select(const GPP::IPointList* pointList, bool ignoreBack, std::vector<GPP::Int>& selectedIds) const;
+        // Single point test of Select, normal is only used if ignoreBack is true
+        bool IsPointSelected(const GPP::Vector3& coord, const GPP::Vector3& normal, bool ignoreBack) const;
+
+    private:
+        GPP::Int GetPartitionCount(GPP::Int elementCount) const;
+        void MergeDepthBuffers(std::vector<std::vector<float> >& partitionBuffers, const std::vector<GPP::Real>& depthRanges);
+        void UpdateDepthTolerance(void);
+        void FillShapeSpan(GPP::Int y, GPP::Int startX, GPP::Int endX);
+
+    private:
+        GPP::Real mWorldViewMatrix[16];
+        GPP::Real mWorldViewProjMatrix[16];
+        GPP::Int mWidth;
+        GPP::Int mHeight;
+        std::vector<float> mDepthBuffer;
+        bool mHasDepthBuffer;
+        GPP::Real mMinDepth;
+        GPP::Real mMaxDepth;
+        GPP::Real mRelativeTolerance;
+        GPP::Real mDepthTolerance;
+        std::vector<unsigned char> mShapeMask;
+        GPP::Int mShapeMinX;
+        GPP::Int mShapeMinY;
+        GPP::Int mShapeMaxX;
+        GPP::Int mShapeMaxY;
+    };
+}
@@ -0,0 +1,331 @@
+#include "SelectionSet.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace MagicCore
+{
+    static inline GPP::Int PopCount(GPP::ULongInt word)
+    {
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return GPP::Int((word * 0x0101010101010101ULL) >> 56);
+    }
+
+    // word should not be 0
+    static inline GPP::Int LowestBit(GPP::ULongInt word)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward64(&index, word);
+        return GPP::Int(index);
+#else
+        return GPP::Int(__builtin_ctzll(word));
+#endif
+    }
+
+    static inline GPP::Int GetWordCount(GPP::Int size)
+    {
+        return (size + 63) >> 6;
+    }
+
+    SelectionSet::SelectionSet() :
+        mWords(),
+        mSize(0)
+    {
+    }
+
+    SelectionSet::SelectionSet(GPP::Int size) :
+        mWords(),
+        mSize(0)
+    {
+        Resize(size);
+    }
+
+    SelectionSet::~SelectionSet()
+    {
+    }
+
+    void SelectionSet::Resize(GPP::Int size)
+    {
+        mSize = size > 0 ? size : 0;
+        mWords.assign(GetWordCount(mSize), 0);
+    }
+
+    GPP::Int SelectionSet::GetSize() const
+    {
+        return mSize;
+    }
+
+    void SelectionSet::Clear()
+    {
+        std::vector<GPP::ULongInt>().swap(mWords);
+        mSize = 0;
+    }
+
+    void SelectionSet::UnselectAll()
+    {
+        mWords.assign(mWords.size(), 0);
+    }
+
+    void SelectionSet::SelectAll()
+    {
+        mWords.assign(mWords.size(), ~GPP::ULongInt(0));
+        ClearTailBits();
+    }
+
+    void SelectionSet::ClearTailBits()
+    {
+        GPP::Int tailBitCount = mSize & 63;
+        if (tailBitCount > 0 && !mWords.empty())
+        {
+            mWords.back() &= (GPP::ULongInt(1) << tailBitCount) - 1;
+        }
+    }
+
+    void SelectionSet::Set(GPP::Int id, bool selected)
+    {
+        if (selected)
+        {
+            Select(id);
+        }
+        else
+        {
+            Unselect(id);
+        }
+    }
+
+    void SelectionSet::SetIds(const std::vector<GPP::Int>& ids, bool selected)
+    {
+        if (selected)
+        {
+            for (std::vector<GPP::Int>::const_iterator itr = ids.begin(); itr != ids.end(); ++itr)
+            {
+                Select(*itr);
+            }
+        }
+        else
+        {
+            for (std::vector<GPP::Int>::const_iterator itr = ids.begin(); itr != ids.end(); ++itr)
+            {
+                Unselect(*itr);
+            }
+        }
+    }
+
+    bool SelectionSet::IsEmpty() const
+    {
+        for (std::vector<GPP::ULongInt>::const_iterator itr = mWords.begin(); itr != mWords.end(); ++itr)
+        {
+            if (*itr)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    GPP::Int SelectionSet::GetSelectedCount() const
+    {
+        GPP::Int selectCount = 0;
+        for (std::vector<GPP::ULongInt>::const_iterator itr = mWords.begin(); itr != mWords.end(); ++itr)
+        {
+            selectCount += PopCount(*itr);
+        }
+        return selectCount;
+    }
+
+    GPP::Int SelectionSet::FindNext(GPP::Int startId) const
+    {
+        if (startId < 0)
+        {
+            startId = 0;
+        }
+        if (startId >= mSize)
+        {
+            return -1;
+        }
+        GPP::Int wordId = startId >> 6;
+        GPP::ULongInt word = mWords[wordId] & (~GPP::ULongInt(0) << (startId & 63));
+        GPP::Int wordCount = mWords.size();
+        while (word == 0)
+        {
+            wordId++;
+            if (wordId >= wordCount)
+            {
+                return -1;
+            }
+            word = mWords[wordId];
+        }
+        return (wordId << 6) + LowestBit(word);
+    }
+
+    void SelectionSet::GetSelectedIds(std::vector<GPP::Int>& selectedIds) const
+    {
+        selectedIds.clear();
+        selectedIds.reserve(GetSelectedCount());
+        GPP::Int wordCount = mWords.size();
+        for (GPP::Int wordId = 0; wordId < wordCount; wordId++)
+        {
+            GPP::ULongInt word = mWords[wordId];
+            while (word)
+            {
+                selectedIds.push_back((wordId << 6) + LowestBit(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    void SelectionSet::Union(const SelectionSet& selection)
+    {
+        GPP::Int wordCount = mWords.size() < selection.mWords.size() ? mWords.size() : selection.mWords.size();
+        for (GPP::Int wordId = 0; wordId < wordCount; wordId++)
+        {
+            mWords[wordId] |= selection.mWords[wordId];
+        }
+    }
+
+    void SelectionSet::Subtract(const SelectionSet& selection)
+    {
+        GPP::Int wordCount = mWords.size() < selection.mWords.size() ? mWords.size() : selection.mWords.size();
+        for (GPP::Int wordId = 0; wordId < wordCount; wordId++)
+        {
+            mWords[wordId] &= ~selection.mWords[wordId];
+        }
+    }
+
+    void SelectionSet::Intersect(const SelectionSet& selection)
+    {
+        GPP::Int wordCount = mWords.size();
+        GPP::Int otherCount = selection.mWords.size();
+        for (GPP::Int wordId = 0; wordId < wordCount; wordId++)
+        {
+            mWords[wordId] &= (wordId < otherCount) ? selection.mWords[wordId] : 0;
+        }
+    }
+
+    void SelectionSet::Invert()
+    {
+        for (std::vector<GPP::ULongInt>::iterator itr = mWords.begin(); itr != mWords.end(); ++itr)
+        {
+            *itr = ~(*itr);
+        }
+        ClearTailBits();
+    }
+
+    void SelectionSet::ToFlags(std::vector<bool>& flags) const
+    {
+        flags.assign(mSize, false);
+        GPP::Int wordCount = mWords.size();
+        for (GPP::Int wordId = 0; wordId < wordCount; wordId++)
+        {
+            GPP::ULongInt word = mWords[wordId];
+            while (word)
+            {
+                flags[(wordId << 6) + LowestBit(word)] = true;
+                word &= word - 1;
+            }
+        }
+    }
+
+    void SelectionSet::FromFlags(const std::vector<bool>& flags)
+    {
+        Resize(flags.size());
+        for (GPP::Int id = 0; id < mSize; id++)
+        {
+            if (flags[id])
+            {
+                Select(id);
+            }
+        }
+    }
+
+    void SelectionSet::Compress(std::vector<GPP::Int>& runs) const
+    {
+        runs.clear();
+        GPP::Int startId = FindNext(0);
+        while (startId != -1)
+        {
+            // Extend the run over full words at once
+            GPP::Int endId = startId;
+            while (endId < mSize)
+            {
+                GPP::Int wordId = endId >> 6;
+                GPP::ULongInt word = ~mWords[wordId] & (~GPP::ULongInt(0) << (endId & 63));
+                if (word)
+                {
+                    endId = (wordId << 6) + LowestBit(word);
+                    break;
+                }
+                endId = (wordId + 1) << 6;
+            }
+            endId = endId < mSize ? endId : mSize;
+            runs.push_back(startId);
+            runs.push_back(endId - startId);
+            startId = FindNext(endId);
+        }
+    }
+
+    void SelectionSet::Decompress(const std::vector<GPP::Int>& runs, GPP::Int size)
+    {
+        Resize(size);
+        GPP::Int runCount = runs.size() / 2;
+        for (GPP::Int runId = 0; runId < runCount; runId++)
+        {
+            GPP::Int startId = runs[runId * 2];
+            GPP::Int endId = startId + runs[runId * 2 + 1];
+            endId = endId < mSize ? endId : mSize;
+            for (GPP::Int id = startId; id < endId; id++)
+            {
+                Select(id);
+            }
+        }
+    }
+
+    SelectionSetStore::SelectionSetStore() :
+        mSelections()
+    {
+    }
+
+    SelectionSetStore::~SelectionSetStore()
+    {
+    }
+
+    void SelectionSetStore::Save(const std::string& name, const SelectionSet& selection)
+    {
+        SavedSelection& saved = mSelections[name];
+        saved.size = selection.GetSize();
+        selection.Compress(saved.runs);
+    }
+
+    bool SelectionSetStore::Load(const std::string& name, GPP::Int expectSize, SelectionSet& selection) const
+    {
+        std::map<std::string, SavedSelection>::const_iterator itr = mSelections.find(name);
+        if (itr == mSelections.end() || itr->second.size != expectSize)
+        {
+            return false;
+        }
+        selection.Decompress(itr->second.runs, itr->second.size);
+        return true;
+    }
+
+    void SelectionSetStore::Remove(const std::string& name)
+    {
+        mSelections.erase(name);
+    }
+
+    void SelectionSetStore::GetNames(std::vector<std::string>& names) const
+    {
+        names.clear();
+        for (std::map<std::string, SavedSelection>::const_iterator itr = mSelections.begin(); itr != mSelections.end(); ++itr)
+        {
+            names.push_back(itr->first);
+        }
+    }
+
+    void SelectionSetStore::Clear()
+    {
+        mSelections.clear();
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "GppDefines.h"
+#include <vector>
+#include <map>
+#include <string>
+
+namespace MagicCore
+{
+    // Compact selection of element ids [0, size), one bit per element.
+    // Set operations and counting work on 64 bit words; iteration skips empty words, so it scales with the
+    // number of selected elements rather than the model size for sparse selections.
+    class SelectionSet
+    {
+    public:
+        SelectionSet();
+        explicit SelectionSet(GPP::Int size);
+        ~SelectionSet();
+
+        // Every element is unselected after resize
+        void Resize(GPP::Int size);
+        GPP::Int GetSize(void) const;
+        // Release memory, size becomes 0
+        void Clear(void);
+        void UnselectAll(void);
+        void SelectAll(void);
+
+        inline bool IsSelected(GPP::Int id) const
+        {
+            return (mWords[id >> 6] >> (id & 63)) & 1;
+        }
+        inline void Select(GPP::Int id)
+        {
+            mWords[id >> 6] |= (GPP::ULongInt(1) << (id & 63));
+        }
+        inline void Unselect(GPP::Int id)
+        {
+            mWords[id >> 6] &= ~(GPP::ULongInt(1) << (id & 63));
+        }
+        void Set(GPP::Int id, bool selected);
+        void SetIds(const std::vector<GPP::Int>& ids, bool selected);
+
+        bool IsEmpty(void) const;
+        GPP::Int GetSelectedCount(void) const;
+        // First selected id >= startId, -1 if there is none
+        GPP::Int FindNext(GPP::Int startId) const;
+        // Selected ids in increasing order
+        void GetSelectedIds(std::vector<GPP::Int>& selectedIds) const;
+
+        // Sizes should be the same
+        void Union(const SelectionSet& selection);
+        void Subtract(const SelectionSet& selection);
+        void Intersect(const SelectionSet& selection);
+        void Invert(void);
+
+        void ToFlags(std::vector<bool>& flags) const;
+        void FromFlags(const std::vector<bool>& flags);
+
+        // Run length form: (startId, length) pairs of the selected runs
+        void Compress(std::vector<GPP::Int>& runs) const;
+        void Decompress(const std::vector<GPP::Int>& runs, GPP::Int size);
+
+    private:
+        void ClearTailBits(void);
+
+    private:
+        std::vector<GPP::ULongInt> mWords;
+        GPP::Int mSize;
+    };
+
+    // Named selections saved in run length form
+    class SelectionSetStore
+    {
+    public:
+        SelectionSetStore();
+        ~SelectionSetStore();
+
+        void Save(const std::string& name, const SelectionSet& selection);
+        // Return false if name does not exist or its size is different from expectSize
+        bool Load(const std::string& name, GPP::Int expectSize, SelectionSet& selection) const;
+        void Remove(const std::string& name);
+        void GetNames(std::vector<std::string>& names) const;
+        void Clear(void);
+
+    private:
+        struct SavedSelection
+        {
+            GPP::Int size;
+            std::vector<GPP::Int> runs;
+        };
+        std::map<std::string, SavedSelection> mSelections;
+    };
+}
@@ -0,0 +1,213 @@
+#include "SparseCholesky.h"
+#include "LogSystem.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MagicCore
+{
+    SparseCholesky::SparseCholesky() :
+        mDimension(0),
+        mPermutation(),
+        mColStarts(),
+        mRowIds(),
+        mValues(),
+        mDiagonal()
+    {
+    }
+
+    SparseCholesky::~SparseCholesky()
+    {
+    }
+
+    GPP::ErrorCode SparseCholesky::Factorize(const SparseSymMatrix& matrix, const std::vector<GPP::Int>& permutation)
+    {
+        Clear();
+        GPP::Int dimension = matrix.dimension;
+        if (dimension < 1 || GPP::Int(matrix.colStarts.size()) != dimension + 1)
+        {
+            return GPP_INVALID_INPUT;
+        }
+        if (permutation.empty())
+        {
+            mPermutation.resize(dimension);
+            for (GPP::Int nid = 0; nid < dimension; nid++)
+            {
+                mPermutation[nid] = nid;
+            }
+        }
+        else if (GPP::Int(permutation.size()) == dimension)
+        {
+            mPermutation = permutation;
+        }
+        else
+        {
+            return GPP_INVALID_INPUT;
+        }
+        std::vector<GPP::Int> inversePermutation(dimension, -1);
+        for (GPP::Int nid = 0; nid < dimension; nid++)
+        {
+            GPP::Int oid = mPermutation[nid];
+            if (oid < 0 || oid >= dimension || inversePermutation[oid] != -1)
+            {
+                mPermutation.clear();
+                return GPP_INVALID_INPUT;
+            }
+            inversePermutation[oid] = nid;
+        }
+
+        // Symbolic: elimination tree and column counts of L
+        std::vector<GPP::Int> parents(dimension, -1);
+        std::vector<GPP::Int> flags(dimension, -1);
+        std::vector<GPP::Int> colCounts(dimension, 0);
+        for (GPP::Int kid = 0; kid < dimension; kid++)
+        {
+            flags[kid] = kid;
+            GPP::Int oid = mPermutation[kid];
+            for (GPP::Int pid = matrix.colStarts[oid]; pid < matrix.colStarts[oid + 1]; pid++)
+            {
+                GPP::Int rid = inversePermutation[matrix.rowIds[pid]];
+                if (rid >= kid)
+                {
+                    continue;
+                }
+                for (; flags[rid] != kid; rid = parents[rid])
+                {
+                    if (parents[rid] == -1)
+                    {
+                        parents[rid] = kid;
+                    }
+                    colCounts[rid]++;
+                    flags[rid] = kid;
+                }
+            }
+        }
+        mColStarts.resize(dimension + 1);
+        mColStarts[0] = 0;
+        for (GPP::Int kid = 0; kid < dimension; kid++)
+        {
+            mColStarts[kid + 1] = mColStarts[kid] + colCounts[kid];
+        }
+        GPP::ULongInt nonZeroCount = mColStarts[dimension];
+        mRowIds.resize(nonZeroCount);
+        mValues.resize(nonZeroCount);
+        mDiagonal.resize(dimension);
+
+        // Numeric: row k of L is the solution of a triangular system whose pattern is a path of the elimination tree
+        std::vector<GPP::Real> rowValues(dimension, 0);
+        std::vector<GPP::Int> pattern(dimension);
+        std::fill(colCounts.begin(), colCounts.end(), 0);
+        std::fill(flags.begin(), flags.end(), -1);
+        for (GPP::Int kid = 0; kid < dimension; kid++)
+        {
+            GPP::Int top = dimension;
+            flags[kid] = kid;
+            GPP::Int oid = mPermutation[kid];
+            for (GPP::Int pid = matrix.colStarts[oid]; pid < matrix.colStarts[oid + 1]; pid++)
+            {
+                GPP::Int rid = inversePermutation[matrix.rowIds[pid]];
+                if (rid > kid)
+                {
+                    continue;
+                }
+                rowValues[rid] += matrix.values[pid];
+                GPP::Int pathLength = 0;
+                for (; flags[rid] != kid; rid = parents[rid])
+                {
+                    pattern[pathLength++] = rid;
+                    flags[rid] = kid;
+                }
+                while (pathLength > 0)
+                {
+                    pattern[--top] = pattern[--pathLength];
+                }
+            }
+            GPP::Real diagonal = rowValues[kid];
+            rowValues[kid] = 0;
+            for (; top < dimension; top++)
+            {
+                GPP::Int rid = pattern[top];
+                GPP::Real rowValue = rowValues[rid];
+                rowValues[rid] = 0;
+                GPP::ULongInt colEnd = mColStarts[rid] + colCounts[rid];
+                for (GPP::ULongInt lid = mColStarts[rid]; lid < colEnd; lid++)
+                {
+                    rowValues[mRowIds[lid]] -= mValues[lid] * rowValue;
+                }
+                GPP::Real factor = rowValue / mDiagonal[rid];
+                diagonal -= factor * rowValue;
+                mRowIds[colEnd] = kid;
+                mValues[colEnd] = factor;
+                colCounts[rid]++;
+            }
+            if (diagonal <= 0 || diagonal != diagonal)
+            {
+                ErrorLog << "SparseCholesky::Factorize: matrix is not positive definite at " << kid << std::endl;
+                Clear();
+                return GPP_INVALID_RESULT;
+            }
+            mDiagonal[kid] = diagonal;
+        }
+        mDimension = dimension;
+        return GPP_NO_ERROR;
+    }
+
+    bool SparseCholesky::IsFactorized() const
+    {
+        return mDimension > 0;
+    }
+
+    GPP::Int SparseCholesky::GetDimension() const
+    {
+        return mDimension;
+    }
+
+    GPP::ULongInt SparseCholesky::GetFactorNonZeroCount() const
+    {
+        return mRowIds.size();
+    }
+
+    void SparseCholesky::Clear()
+    {
+        mDimension = 0;
+        mPermutation.clear();
+        mColStarts.clear();
+        mRowIds.clear();
+        mValues.clear();
+        mDiagonal.clear();
+    }
+
+    void SparseCholesky::Solve(const std::vector<GPP::Real>& rhs, std::vector<GPP::Real>& result, std::vector<GPP::Real>& workSpace) const
+    {
+        workSpace.resize(mDimension);
+        for (GPP::Int kid = 0; kid < mDimension; kid++)
+        {
+            workSpace[kid] = rhs[mPermutation[kid]];
+        }
+        for (GPP::Int kid = 0; kid < mDimension; kid++)
+        {
+            GPP::Real value = workSpace[kid];
+            for (GPP::ULongInt lid = mColStarts[kid]; lid < mColStarts[kid + 1]; lid++)
+            {
+                workSpace[mRowIds[lid]] -= mValues[lid] * value;
+            }
+        }
+        for (GPP::Int kid = 0; kid < mDimension; kid++)
+        {
+            workSpace[kid] /= mDiagonal[kid];
+        }
+        for (GPP::Int kid = mDimension - 1; kid >= 0; kid--)
+        {
+            GPP::Real value = workSpace[kid];
+            for (GPP::ULongInt lid = mColStarts[kid]; lid < mColStarts[kid + 1]; lid++)
+            {
+                value -= mValues[lid] * workSpace[mRowIds[lid]];
+            }
+            workSpace[kid] = value;
+        }
+        result.resize(mDimension);
+        for (GPP::Int kid = 0; kid < mDimension; kid++)
+        {
+            result[mPermutation[kid]] = workSpace[kid];
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "GppDefines.h"
+#include <vector>
+
+namespace MagicCore
+{
+    // Symmetric matrix of which both triangles are stored column by column
+    struct SparseSymMatrix
+    {
+        GPP::Int dimension;
+        std::vector<GPP::Int> colStarts;  // dimension + 1
+        std::vector<GPP::Int> rowIds;
+        std::vector<GPP::Real> values;
+    };
+
+    // Sparse LDL^T factorization: P * A * P^T = L * D * L^T.
+    // The factor is computed once and each Solve costs two triangular substitutions, so a matrix which is
+    // solved with many right hand sides is factorized only once.
+    // Solve only reads the factor and is thread safe.
+    class SparseCholesky
+    {
+    public:
+        SparseCholesky();
+        ~SparseCholesky();
+
+        // permutation: new id -> old id, the identity is used if it is empty. A fill reducing permutation,
+        // like a nested dissection one, keeps the factor small.
+        GPP::ErrorCode Factorize(const SparseSymMatrix& matrix, const std::vector<GPP::Int>& permutation);
+        bool IsFactorized(void) const;
+        GPP::Int GetDimension(void) const;
+        GPP::ULongInt GetFactorNonZeroCount(void) const;
+        void Clear(void);
+
+        // rhs and result could be the same vector. workSpace is resized to dimension.
+        void Solve(const std::vector<GPP::Real>& rhs, std::vector<GPP::Real>& result, std::vector<GPP::Real>& workSpace) const;
+
+    private:
+        GPP::Int mDimension;
+        std::vector<GPP::Int> mPermutation;
+        std::vector<GPP::ULongInt> mColStarts;
+        std::vector<GPP::Int> mRowIds;
+        std::vector<GPP::Real> mValues;
+        std::vector<GPP::Real> mDiagonal;
+    };
+}
@@ -0,0 +1,298 @@
+#include "ThreadPool.h"
+#include <windows.h>
+#include <process.h>
+#include <deque>
+#include <vector>
+#include "LogSystem.h"
+
+namespace MagicCore
+{
+    struct QueuedTask
+    {
+        ThreadTask* task;
+        TaskGroup* group;
+    };
+
+    // ThreadPool is a singleton, so its synchronization objects are kept here to keep windows.h out of the header.
+    static CRITICAL_SECTION gPoolLock;
+    static CONDITION_VARIABLE gPoolChanged;
+    static std::deque<QueuedTask> gTaskQueue;
+    static std::vector<HANDLE> gThreadHandles;
+
+    static unsigned __stdcall RunWorkerThread(void *arg)
+    {
+        ThreadPool* pool = (ThreadPool*)arg;
+        if (pool == NULL)
+        {
+            return 0;
+        }
+        pool->RunWorker();
+        return 1;
+    }
+
+    class ParallelForTask : public ThreadTask
+    {
+    public:
+        ParallelForTask(ParallelTask* task, int count, int grainSize, volatile long* nextPiece) :
+            mpTask(task),
+            mCount(count),
+            mGrainSize(grainSize),
+            mpNextPiece(nextPiece)
+        {
+        }
+
+        virtual void Run(void)
+        {
+            while (true)
+            {
+                long pieceId = InterlockedIncrement(mpNextPiece) - 1;
+                long long startId = (long long)pieceId * mGrainSize;
+                if (startId >= mCount)
+                {
+                    break;
+                }
+                int endId = int(startId) + mGrainSize;
+                if (endId > mCount)
+                {
+                    endId = mCount;
+                }
+                mpTask->Run(int(startId), endId);
+            }
+        }
+
+    private:
+        ParallelTask* mpTask;
+        int mCount;
+        int mGrainSize;
+        volatile long* mpNextPiece;
+    };
+
+    ThreadTask::ThreadTask()
+    {
+    }
+
+    ThreadTask::~ThreadTask()
+    {
+    }
+
+    ParallelTask::ParallelTask()
+    {
+    }
+
+    ParallelTask::~ParallelTask()
+    {
+    }
+
+    TaskGroup::TaskGroup() :
+        mPendingCount(0)
+    {
+    }
+
+    bool TaskGroup::IsFinished() const
+    {
+        return mPendingCount == 0;
+    }
+
+    TaskGroup::~TaskGroup()
+    {
+    }
+
+    ThreadPool* ThreadPool::mpThreadPool = NULL;
+
+    ThreadPool::ThreadPool() :
+        mThreadCount(0),
+        mIsShutdown(false)
+    {
+        InitializeCriticalSection(&gPoolLock);
+        InitializeConditionVariable(&gPoolChanged);
+    }
+
+    ThreadPool* ThreadPool::Get()
+    {
+        if (mpThreadPool == NULL)
+        {
+            mpThreadPool = new ThreadPool;
+            mpThreadPool->Init();
+        }
+        return mpThreadPool;
+    }
+
+    void ThreadPool::Init(int threadCount)
+    {
+        Shutdown();
+        if (threadCount <= 0)
+        {
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            threadCount = int(systemInfo.dwNumberOfProcessors);
+        }
+        if (threadCount < 1)
+        {
+            threadCount = 1;
+        }
+        mThreadCount = threadCount;
+        mIsShutdown = false;
+        // The thread which calls ParallelFor or Wait also does work, so one less worker is needed.
+        for (int tid = 1; tid < mThreadCount; tid++)
+        {
+            HANDLE handle = (HANDLE)_beginthreadex(NULL, 0, RunWorkerThread, (void *)this, 0, NULL);
+            if (handle != NULL)
+            {
+                gThreadHandles.push_back(handle);
+            }
+        }
+        InfoLog << "ThreadPool::Init threadCount=" << mThreadCount << std::endl;
+    }
+
+    int ThreadPool::GetThreadCount() const
+    {
+        return mThreadCount;
+    }
+
+    void ThreadPool::Submit(ThreadTask* task, TaskGroup* group)
+    {
+        if (task == NULL)
+        {
+            return;
+        }
+        QueuedTask queuedTask;
+        queuedTask.task = task;
+        queuedTask.group = group;
+        EnterCriticalSection(&gPoolLock);
+        if (group)
+        {
+            group->mPendingCount++;
+        }
+        gTaskQueue.push_back(queuedTask);
+        WakeAllConditionVariable(&gPoolChanged);
+        LeaveCriticalSection(&gPoolLock);
+        if (gThreadHandles.empty())
+        {
+            // No worker thread: run it in place
+            RunQueuedTask();
+        }
+    }
+
+    void ThreadPool::Wait(TaskGroup* group)
+    {
+        if (group == NULL)
+        {
+            return;
+        }
+        EnterCriticalSection(&gPoolLock);
+        while (group->mPendingCount > 0)
+        {
+            LeaveCriticalSection(&gPoolLock);
+            bool isRun = RunQueuedTask(group);
+            EnterCriticalSection(&gPoolLock);
+            // The remaining tasks of group are running on the workers
+            if (!isRun && group->mPendingCount > 0)
+            {
+                SleepConditionVariableCS(&gPoolChanged, &gPoolLock, INFINITE);
+            }
+        }
+        LeaveCriticalSection(&gPoolLock);
+    }
+
+    void ThreadPool::ParallelFor(int count, ParallelTask* task, int grainSize)
+    {
+        if (count <= 0 || task == NULL)
+        {
+            return;
+        }
+        if (grainSize < 1)
+        {
+            grainSize = 1;
+        }
+        int pieceCount = (count - 1) / grainSize + 1;
+        int helperCount = (pieceCount < mThreadCount ? pieceCount : mThreadCount) - 1;
+        if (helperCount < 1)
+        {
+            task->Run(0, count);
+            return;
+        }
+        volatile long nextPiece = 0;
+        std::vector<ParallelForTask> helpers(helperCount, ParallelForTask(task, count, grainSize, &nextPiece));
+        TaskGroup group;
+        for (int hid = 0; hid < helperCount; hid++)
+        {
+            Submit(&helpers.at(hid), &group);
+        }
+        ParallelForTask selfTask(task, count, grainSize, &nextPiece);
+        selfTask.Run();
+        Wait(&group);
+    }
+
+    void ThreadPool::RunWorker()
+    {
+        EnterCriticalSection(&gPoolLock);
+        while (true)
+        {
+            while (gTaskQueue.empty() && !mIsShutdown)
+            {
+                SleepConditionVariableCS(&gPoolChanged, &gPoolLock, INFINITE);
+            }
+            if (gTaskQueue.empty() && mIsShutdown)
+            {
+                break;
+            }
+            LeaveCriticalSection(&gPoolLock);
+            RunQueuedTask();
+            EnterCriticalSection(&gPoolLock);
+        }
+        LeaveCriticalSection(&gPoolLock);
+    }
+
+    bool ThreadPool::RunQueuedTask(TaskGroup* group)
+    {
+        EnterCriticalSection(&gPoolLock);
+        std::deque<QueuedTask>::iterator taskItr = gTaskQueue.begin();
+        while (group && taskItr != gTaskQueue.end() && taskItr->group != group)
+        {
+            ++taskItr;
+        }
+        if (taskItr == gTaskQueue.end())
+        {
+            LeaveCriticalSection(&gPoolLock);
+            return false;
+        }
+        QueuedTask queuedTask = *taskItr;
+        gTaskQueue.erase(taskItr);
+        LeaveCriticalSection(&gPoolLock);
+
+        queuedTask.task->Run();
+
+        EnterCriticalSection(&gPoolLock);
+        if (queuedTask.group)
+        {
+            queuedTask.group->mPendingCount--;
+        }
+        WakeAllConditionVariable(&gPoolChanged);
+        LeaveCriticalSection(&gPoolLock);
+        return true;
+    }
+
+    void ThreadPool::Shutdown()
+    {
+        if (gThreadHandles.empty())
+        {
+            return;
+        }
+        EnterCriticalSection(&gPoolLock);
+        mIsShutdown = true;
+        WakeAllConditionVariable(&gPoolChanged);
+        LeaveCriticalSection(&gPoolLock);
+        for (std::vector<HANDLE>::iterator itr = gThreadHandles.begin(); itr != gThreadHandles.end(); ++itr)
+        {
+            WaitForSingleObject(*itr, INFINITE);
+            CloseHandle(*itr);
+        }
+        gThreadHandles.clear();
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        Shutdown();
+        DeleteCriticalSection(&gPoolLock);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+namespace MagicCore
+{
+    // A task which is submitted to ThreadPool. It is not owned by the pool, so it should be alive
+    // until its TaskGroup is finished.
+    class ThreadTask
+    {
+    public:
+        ThreadTask();
+        virtual void Run(void) = 0;
+        virtual ~ThreadTask();
+    };
+
+    // Body of ThreadPool::ParallelFor, it processes the element range [startId, endId)
+    class ParallelTask
+    {
+    public:
+        ParallelTask();
+        virtual void Run(int startId, int endId) = 0;
+        virtual ~ParallelTask();
+    };
+
+    class TaskGroup
+    {
+    public:
+        TaskGroup();
+        bool IsFinished(void) const;
+        ~TaskGroup();
+
+    private:
+        friend class ThreadPool;
+        volatile long mPendingCount;
+    };
+
+    class ThreadPool
+    {
+    private:
+        static ThreadPool* mpThreadPool;
+        ThreadPool(void);
+    public:
+        static ThreadPool* Get(void);
+
+        // threadCount == 0: it will use processor count
+        void Init(int threadCount = 0);
+        int GetThreadCount(void) const;
+
+        // Run task asynchronously, group could be NULL if nobody waits for it
+        void Submit(ThreadTask* task, TaskGroup* group);
+        // Block until all tasks of group are finished. Queued tasks of group are executed by the waiting thread,
+        // so it is safe to wait inside a pool thread. Tasks of other groups are left to the workers, a long task
+        // of another group never stalls the waiting thread.
+        void Wait(TaskGroup* group);
+
+        // Split [0, count) into pieces of grainSize and run them on all threads including the calling one.
+        // It returns after all pieces are done.
+        void ParallelFor(int count, ParallelTask* task, int grainSize = 1024);
+
+        // Used by worker threads only
+        void RunWorker(void);
+
+        ~ThreadPool(void);
+
+    private:
+        // Run the first queued task of group, or of any group if group is NULL
+        bool RunQueuedTask(TaskGroup* group = NULL);
+        void Shutdown(void);
+
+    private:
+        int mThreadCount;
+        bool mIsShutdown;
+    };
+}
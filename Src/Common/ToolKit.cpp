@@ -78,15 +78,15 @@ namespace MagicCore
             lstrcpyn(szPath, szOpenFileNames, file.nFileOffset);
             szPath[ file.nFileOffset ] = '\0';
             int nLen = lstrlen(szPath);
-            if( szPath[nLen-1] != '\\' )   //ѡ˶ļ,'\\'
+            if( szPath[nLen-1] != '\\' )   //如果选了多个文件,则必须加上'\\'
             {
                 lstrcat(szPath, TEXT("\\"));
             }
-            p = szOpenFileNames + file.nFileOffset; //ָƵһļ
+            p = szOpenFileNames + file.nFileOffset; //把指针移到第一个文件
             while( *p )
             {
                 selectFileNames.push_back(std::string(szPath) + std::string(p)); 
-                p += lstrlen(p) +1;     //һļ
+                p += lstrlen(p) +1;     //移至下一个文件
             }
             return true;
         }